@@ -59,13 +59,23 @@ target_sources(rocclr PRIVATE
   ${ROCCLR_SRC_DIR}/device/blit.cpp
   ${ROCCLR_SRC_DIR}/device/blitcl.cpp
   ${ROCCLR_SRC_DIR}/device/comgrctx.cpp
+  ${ROCCLR_SRC_DIR}/device/devbundle.cpp
+  ${ROCCLR_SRC_DIR}/device/devcodecache.cpp
   ${ROCCLR_SRC_DIR}/device/devhcmessages.cpp
   ${ROCCLR_SRC_DIR}/device/devhcprintf.cpp
   ${ROCCLR_SRC_DIR}/device/devhostcall.cpp
   ${ROCCLR_SRC_DIR}/device/device.cpp
   ${ROCCLR_SRC_DIR}/device/devkernel.cpp
+  ${ROCCLR_SRC_DIR}/device/devmapcache.cpp
+  ${ROCCLR_SRC_DIR}/device/devmemdependency.cpp
+  ${ROCCLR_SRC_DIR}/device/devmempool.cpp
+  ${ROCCLR_SRC_DIR}/device/devmetrics.cpp
+  ${ROCCLR_SRC_DIR}/device/devprintf.cpp
   ${ROCCLR_SRC_DIR}/device/devprogram.cpp
+  ${ROCCLR_SRC_DIR}/device/devspecializer.cpp
+  ${ROCCLR_SRC_DIR}/device/devtuning.cpp
   ${ROCCLR_SRC_DIR}/device/devwavelimiter.cpp
+  ${ROCCLR_SRC_DIR}/device/devwgtuner.cpp
   ${ROCCLR_SRC_DIR}/device/hsailctx.cpp
   ${ROCCLR_SRC_DIR}/device/hwdebug.cpp
   ${ROCCLR_SRC_DIR}/elf/elf.cpp
@@ -75,9 +85,11 @@ target_sources(rocclr PRIVATE
   ${ROCCLR_SRC_DIR}/os/os.cpp
   ${ROCCLR_SRC_DIR}/platform/activity.cpp
   ${ROCCLR_SRC_DIR}/platform/agent.cpp
+  ${ROCCLR_SRC_DIR}/platform/cmdrecord.cpp
   ${ROCCLR_SRC_DIR}/platform/command.cpp
   ${ROCCLR_SRC_DIR}/platform/commandqueue.cpp
   ${ROCCLR_SRC_DIR}/platform/context.cpp
+  ${ROCCLR_SRC_DIR}/platform/devicegroup.cpp
   ${ROCCLR_SRC_DIR}/platform/kernel.cpp
   ${ROCCLR_SRC_DIR}/platform/memory.cpp
   ${ROCCLR_SRC_DIR}/platform/ndrange.cpp
@@ -86,8 +98,10 @@ target_sources(rocclr PRIVATE
   ${ROCCLR_SRC_DIR}/thread/monitor.cpp
   ${ROCCLR_SRC_DIR}/thread/semaphore.cpp
   ${ROCCLR_SRC_DIR}/thread/thread.cpp
+  ${ROCCLR_SRC_DIR}/utils/bintrace.cpp
   ${ROCCLR_SRC_DIR}/utils/debug.cpp
-  ${ROCCLR_SRC_DIR}/utils/flags.cpp)
+  ${ROCCLR_SRC_DIR}/utils/flags.cpp
+  ${ROCCLR_SRC_DIR}/utils/timeline.cpp)
 
 if(WIN32)
   target_compile_definitions(rocclr PUBLIC ATI_OS_WIN)
@@ -124,6 +138,17 @@ if(UNIX)
   target_link_libraries(rocclr PUBLIC rt)
 endif()
 
+# The compressed code object bundles require zstd
+find_package(zstd QUIET CONFIG)
+if(zstd_FOUND)
+  target_compile_definitions(rocclr PRIVATE ROCCLR_SUPPORT_ZSTD)
+  if(TARGET zstd::libzstd_shared)
+    target_link_libraries(rocclr PUBLIC zstd::libzstd_shared)
+  else()
+    target_link_libraries(rocclr PUBLIC zstd::libzstd_static)
+  endif()
+endif()
+
 if(ROCCLR_ENABLE_HSAIL)
   include(ROCclrHSAIL)
 endif()
@@ -27,6 +27,16 @@ find_package(hsa-runtime64 1.3 REQUIRED CONFIG
     lib64/cmake/hsa-runtime64)
 target_link_libraries(rocclr PUBLIC hsa-runtime64::hsa-runtime64)
 
+# The virtual memory management API is available in the newer ROCr versions only
+include(CheckSymbolExists)
+get_target_property(HSA_INCLUDE_DIRS hsa-runtime64::hsa-runtime64 INTERFACE_INCLUDE_DIRECTORIES)
+set(CMAKE_REQUIRED_INCLUDES ${HSA_INCLUDE_DIRS})
+check_symbol_exists(hsa_amd_vmem_address_reserve "hsa_ext_amd.h" ROCCLR_HSA_VMM_FOUND)
+unset(CMAKE_REQUIRED_INCLUDES)
+if(ROCCLR_HSA_VMM_FOUND)
+  target_compile_definitions(rocclr PUBLIC ROCCLR_SUPPORT_VMM)
+endif()
+
 find_package(NUMA QUIET)
 if(NUMA_FOUND)
   target_compile_definitions(rocclr PUBLIC ROCCLR_SUPPORT_NUMA_POLICY)
@@ -39,6 +49,7 @@ target_sources(rocclr PRIVATE
   ${ROCCLR_SRC_DIR}/device/rocm/roccounters.cpp
   ${ROCCLR_SRC_DIR}/device/rocm/rocdevice.cpp
   ${ROCCLR_SRC_DIR}/device/rocm/rocglinterop.cpp
+  ${ROCCLR_SRC_DIR}/device/rocm/rocgraph.cpp
   ${ROCCLR_SRC_DIR}/device/rocm/rockernel.cpp
   ${ROCCLR_SRC_DIR}/device/rocm/rocmemory.cpp
   ${ROCCLR_SRC_DIR}/device/rocm/rocprintf.cpp
@@ -46,6 +57,7 @@ target_sources(rocclr PRIVATE
   ${ROCCLR_SRC_DIR}/device/rocm/rocschedcl.cpp
   ${ROCCLR_SRC_DIR}/device/rocm/rocsettings.cpp
   ${ROCCLR_SRC_DIR}/device/rocm/rocsignal.cpp
+  ${ROCCLR_SRC_DIR}/device/rocm/rocthreadtrace.cpp
   ${ROCCLR_SRC_DIR}/device/rocm/rocvirtual.cpp
   ${ROCCLR_SRC_DIR}/device/rocm/rocurilocator.cpp)
 
@@ -18,8 +18,13 @@
  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  THE SOFTWARE. */
 
+#include <algorithm>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <cstring>
 #include <cstdlib>
 #include <sstream>
@@ -89,12 +94,32 @@ OptionDescriptor OptDescTable[] = {
    Any prefix option (-f/-fno, -m/-mno) has no long name, and must have
    a value separator if it requires a value.
 */
-std::map <std::string, int> OptionNameMap[2] ROCCLR_INIT_PRIORITY(101);
-std::map <std::string, int> NoneSeparatorOptionMap[2] ROCCLR_INIT_PRIORITY(101);
+std::unordered_map <std::string, int> OptionNameMap[2] ROCCLR_INIT_PRIORITY(101);
+std::unordered_map <std::string, int> NoneSeparatorOptionMap[2] ROCCLR_INIT_PRIORITY(101);
+// the longest name in NoneSeparatorOptionMap, which bounds the prefix search
+size_t NoneSeparatorMaxLen[2] = { 0, 0 };
 // prefix -f/-fno- options
-std::map <std::string, int> FOptionMap ROCCLR_INIT_PRIORITY(101);
+std::unordered_map <std::string, int> FOptionMap ROCCLR_INIT_PRIORITY(101);
 // prefix -m/-mno- options
-std::map <std::string, int> MOptionMap ROCCLR_INIT_PRIORITY(101);
+std::unordered_map <std::string, int> MOptionMap ROCCLR_INIT_PRIORITY(101);
+
+// An option matched in the option string. The match doesn't depend on
+// the build, so the list is shared by all builds with the same options
+struct ParsedOption {
+    int         ndx;        // OptDescTable's index
+    std::string value;      // the option's value
+    std::string str;        // the option's name and value without "-"/"--"
+    size_t      bpos;       // the start of the option in the option string
+    size_t      epos;       // the end of the option in the option string
+    bool        isPrefix;   // -f/-m prefix option
+    bool        isPrefixNo; // -fno-/-mno- prefix option
+};
+
+// the cache of the matched options, keyed by the option string
+const size_t MaxParsedOptionsCacheSize = 256;
+std::unordered_map <std::string, std::shared_ptr<const std::vector<ParsedOption>>>
+    ParsedOptionsCache ROCCLR_INIT_PRIORITY(101);
+std::mutex ParsedOptionsLock ROCCLR_INIT_PRIORITY(101);
 
 bool setOptionVariable (
     OptionDescriptor* oDesc,
@@ -524,7 +549,7 @@ getOptionDesc(std::string& options, size_t StartPos, bool IsShortForm,
     }
     std::string name = options.substr(sPos, len);
 
-    std::map <std::string, int>::const_iterator I, IE;
+    std::unordered_map <std::string, int>::const_iterator I, IE;
     switch (oForm) {
     case OFA_NORMAL:
         I  = OptionNameMap[map_ndx].find(name);
@@ -551,22 +576,16 @@ getOptionDesc(std::string& options, size_t StartPos, bool IsShortForm,
         return -1;
     }
     else {
-        I  = NoneSeparatorOptionMap[map_ndx].begin();
+        // Look up the longest name, which is a proper prefix of the option
         IE = NoneSeparatorOptionMap[map_ndx].end();
         size_t len1 = 0;
-        for (; I != IE; ++I) {
-            std::string namevalue = I->first;
-            size_t n = namevalue.size();
-            if (n >= len) {
-                // Not substr, skip
-                continue;
-            }
-            if (name.compare(0, n, namevalue) == 0) {
-                // found the substr
-                if (n > len1) {
-                    len1 = n;
-                    option_ndx = I->second;
-                }
+        size_t n = name.empty() ? 0 : std::min(NoneSeparatorMaxLen[map_ndx], name.size() - 1);
+        for (; n > 0; --n) {
+            I = NoneSeparatorOptionMap[map_ndx].find(name.substr(0, n));
+            if (I != IE) {
+                len1 = n;
+                option_ndx = I->second;
+                break;
             }
          }
          if (len1 == 0) {
@@ -1023,40 +1042,12 @@ static void logInvalidOption(std::string& options, size_t bpos,
     log += msg + "\n";
 }
 
-} // namespace
-
-namespace amd {
-
-namespace option {
-
-bool
-parseAllOptions(std::string& options, Options& Opts, bool linkOptsOnly, bool isLC)
+// Splits the option string into the matched options. It doesn't depend on
+// the build, hence the result is cached for the option string
+static bool
+tokenizeOptions(std::string& options, std::vector<ParsedOption>& parsed,
+                std::string& log)
 {
-    Opts.origOptionStr = options;
-    OptionVariables*  ovars = Opts.oVariables;
-    OptionDescriptor* od = OptDescTable;
-
-    // Initialize all options to the default
-    for (int i =0; i < OID_LAST; ++i, ++od) {
-        if (!OPTIONHasOVariable(od)) {
-            continue;
-        }
-        if (!setOptionVariable(od, ovars, OPTION_default(od),
-                               OPTION_defaultstr(od))) {
-            Opts.optionsLog() = "Internal Error: option processing failed\n";
-            return false;
-        }
-    }
-    Opts.clangOptions.push_back("-cl-kernel-arg-info");
-
-    // Parse options
-    if (options.empty()) {
-        Opts.postParseInit();
-        return true;
-    }
-
-    bool isLibLinkOpts = false; // is this set of options for linking library?
-    bool firstOpt = true;
     for (size_t pos = options.find_first_not_of(' ', 0);
          pos != std::string::npos;
          pos = options.find_first_not_of(" ", pos))
@@ -1071,7 +1062,7 @@ parseAllOptions(std::string& options, Options& Opts, bool linkOptsOnly, bool isL
         }
         else {
             // options should start with "-"
-            logInvalidOption(options, bpos, Opts.optionsLog(),
+            logInvalidOption(options, bpos, log,
                              "  (expected - at the beginning)");
             return false;
         }
@@ -1084,7 +1075,7 @@ parseAllOptions(std::string& options, Options& Opts, bool linkOptsOnly, bool isL
         if ((pos == std::string::npos)
             || OPTION_valueSeparator(options.at(pos)))
         {
-            logInvalidOption(options, bpos, Opts.optionsLog(),
+            logInvalidOption(options, bpos, log,
                              "  (expected an option name)");
             return false;
         }
@@ -1118,24 +1109,87 @@ parseAllOptions(std::string& options, Options& Opts, bool linkOptsOnly, bool isL
             }
 
             if (option_ndx < 0) {
-                logInvalidOption(options, bpos, Opts.optionsLog(), "");
+                logInvalidOption(options, bpos, log, "");
                 return false;
             }
         }
 
-        od = &OptDescTable[option_ndx];
-
 #ifdef SKIP_INTERNAL_OPTION
-        if (OPTION_vis(od) == OVIS_INTERNAL) {
+        if (OPTION_vis(&OptDescTable[option_ndx]) == OVIS_INTERNAL) {
             // Internal options are not support in the product
-            logInvalidOption(options, bpos, Opts.optionsLog(), "");
+            logInvalidOption(options, bpos, log, "");
             return false;
         }
 #endif
 
+        size_t sPos1 = (isShortName ? sPos - 1 : sPos - 2);
+        parsed.push_back({option_ndx, value, options.substr(sPos1, pos - sPos1), bpos, pos,
+                          isPrefix_option, (isPrefix_mno || isPrefix_fno)});
+    }
+    return true;
+}
+
+} // namespace
+
+namespace amd {
+
+namespace option {
+
+bool
+parseAllOptions(std::string& options, Options& Opts, bool linkOptsOnly, bool isLC)
+{
+    Opts.origOptionStr = options;
+    OptionVariables*  ovars = Opts.oVariables;
+    OptionDescriptor* od = OptDescTable;
+
+    // Initialize all options to the default
+    for (int i =0; i < OID_LAST; ++i, ++od) {
+        if (!OPTIONHasOVariable(od)) {
+            continue;
+        }
+        if (!setOptionVariable(od, ovars, OPTION_default(od),
+                               OPTION_defaultstr(od))) {
+            Opts.optionsLog() = "Internal Error: option processing failed\n";
+            return false;
+        }
+    }
+    Opts.clangOptions.push_back("-cl-kernel-arg-info");
+
+    // Parse options
+    if (options.empty()) {
+        Opts.postParseInit();
+        return true;
+    }
+
+    // Repeated builds use the same option strings, so reuse the matched options
+    std::shared_ptr<const std::vector<ParsedOption>> parsed;
+    {
+        std::lock_guard<std::mutex> lock(ParsedOptionsLock);
+        auto it = ParsedOptionsCache.find(options);
+        if (it != ParsedOptionsCache.end()) {
+            parsed = it->second;
+        }
+    }
+    if (parsed == nullptr) {
+        auto tokens = std::make_shared<std::vector<ParsedOption>>();
+        if (!tokenizeOptions(options, *tokens, Opts.optionsLog())) {
+            return false;
+        }
+        parsed = tokens;
+        std::lock_guard<std::mutex> lock(ParsedOptionsLock);
+        if (ParsedOptionsCache.size() >= MaxParsedOptionsCacheSize) {
+            ParsedOptionsCache.clear();
+        }
+        ParsedOptionsCache.emplace(options, parsed);
+    }
+
+    bool isLibLinkOpts = false; // is this set of options for linking library?
+    bool firstOpt = true;
+    for (const auto& opt : *parsed) {
+        od = &OptDescTable[opt.ndx];
+
         if (!linkOptsOnly && (OPTION_info(od) & OA_CLC)) {
-            size_t sPos1 = (isShortName ? sPos - 1 : sPos - 2);
-            std::string oStr = options.substr(sPos1, pos - sPos1);
+            const std::string& oStr = opt.str;
             if (OPTION_info(od) & OA_CLC) {
                Opts.clcOptions.append(" " + oStr);
                if (!oStr.compare(0, 2, "-D") ||
@@ -1146,7 +1200,7 @@ parseAllOptions(std::string& options, Options& Opts, bool linkOptsOnly, bool isL
                  size_t vPos1 = oStr.find_first_not_of(" ", 2);
                  if (vPos1 == std::string::npos) {
                    // Do not allow blank macro and include directories
-                   logInvalidOption(options, bpos, Opts.optionsLog(),
+                   logInvalidOption(options, opt.bpos, Opts.optionsLog(),
                                  "  (expected value)");
                    return false;
                  }
@@ -1171,7 +1225,7 @@ parseAllOptions(std::string& options, Options& Opts, bool linkOptsOnly, bool isL
                 || (!isLibLinkOpts && !(OPTION_info(od) & OA_LINK_EXE))
                 || (isLibLinkOpts && !(OPTION_info(od) & OA_LINK_LIB))) {
                 // Do not allow non-link-time options
-                logInvalidOption(options, bpos, Opts.optionsLog(),
+                logInvalidOption(options, opt.bpos, Opts.optionsLog(),
                                  "  (bad link-time option)");
                 return false;
             }
@@ -1180,18 +1234,17 @@ parseAllOptions(std::string& options, Options& Opts, bool linkOptsOnly, bool isL
             if (!(OPTION_info(od) & OA_RUNTIME)) continue;
         }
 
-        if (!processOption(option_ndx, Opts, value, isPrefix_option,
-                           (isPrefix_mno || isPrefix_fno), isLC)) {
+        if (!processOption(opt.ndx, Opts, opt.value, opt.isPrefix, opt.isPrefixNo, isLC)) {
             // Keep the optionsLog set in processOption().
             std::string tmpStr("Invalid option: ");
-            tmpStr += options.substr(bpos, (pos == std::string::npos)
-                                           ? pos : pos - bpos);
+            tmpStr += options.substr(opt.bpos, (opt.epos == std::string::npos)
+                                               ? opt.epos : opt.epos - opt.bpos);
             tmpStr += "\n    ";
             Opts.optionsLog().insert(0, tmpStr);
             return false;
         }
 
-        Opts.setFlag(option_ndx, 1);
+        Opts.setFlag(opt.ndx, 1);
     }
 
     if (Opts.isOptionSeen(OID_ShowHelp)) {
@@ -1319,8 +1372,13 @@ init()
             MOptionMap[sname] = i;
         }
     }
+    for (int i = 0; i < 2; ++i) {
+        for (const auto& it : NoneSeparatorOptionMap[i]) {
+            NoneSeparatorMaxLen[i] = std::max(NoneSeparatorMaxLen[i], it.first.size());
+        }
+    }
 #if 0
-    std::map <std::string, int>::const_iterator I, IE;
+    std::unordered_map <std::string, int>::const_iterator I, IE;
     IE = OptionNameMap[0].end();
     for (I = OptionNameMap[0].begin(); I != IE; ++I) {
         printf (" %s : %d \n", I->first.c_str(), I->second);
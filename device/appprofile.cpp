@@ -21,9 +21,12 @@
 #include "top.hpp"
 #include "os/os.hpp"
 #include "utils/flags.hpp"
+#include "utils/debug.hpp"
 #include "appprofile.hpp"
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <sstream>
 
 typedef void* ADLApplicationProfile;
 int SearchProfileOfAnApplication(const wchar_t* fileName, ADLApplicationProfile** lppProfile)
@@ -35,7 +38,11 @@ int SearchProfileOfAnApplication(const wchar_t* fileName, ADLApplicationProfile*
 
 namespace amd {
 
-AppProfile::AppProfile() : gpuvmHighAddr_(false), profileOverridesAllSettings_(false) {
+AppProfile::AppProfile()
+    : gpuvmHighAddr_(false),
+      profileOverridesAllSettings_(false),
+      tuningLock_("Tuning profile lock"),
+      tuningLoaded_(false) {
   amd::Os::getAppPathAndFileName(appFileName_, appPathAndFileName_);
   propertyDataMap_.insert(
       DataMap::value_type("BuildOptsAppend", PropertyData(DataType_String, &buildOptsAppend_)));
@@ -89,4 +96,99 @@ bool AppProfile::ParseApplicationProfile() {
 
   return true;
 }
+
+const std::string& AppProfile::tuningFile() const {
+  if (!tuningLoaded_) {
+    tuningLoaded_ = true;
+    std::string path = GPU_TUNING_PROFILE_PATH;
+    if (path.empty() || appFileName_.empty()) {
+      return tuningFile_;
+    }
+    if (!amd::Os::pathExists(path) && !amd::Os::createPath(path)) {
+      LogPrintfWarning("Tuning profile is disabled, can't create the path: %s", path.c_str());
+      return tuningFile_;
+    }
+    tuningFile_ = path + amd::Os::fileSeparator() + appFileName_ + ".tuning";
+
+    // The executable size and time identify the application version, so a rebuilt
+    // application doesn't reuse the decisions, tuned for the old binary
+    amd::Os::FileInfo info = {};
+    amd::Os::fileInfo(appPathAndFileName_, &info);
+    std::ostringstream version;
+    version << "# " << std::hex << info.size_ << '-' << info.time_;
+    tuningVersion_ = version.str();
+
+    // The first line is the version, each next line is the value, followed by the key
+    std::ifstream file(tuningFile_);
+    std::string line;
+    if (std::getline(file, line) && (line != tuningVersion_)) {
+      ClPrint(amd::LOG_INFO, amd::LOG_INIT, "Tuning profile is outdated: %s",
+              tuningFile_.c_str());
+      return tuningFile_;
+    }
+    while (std::getline(file, line)) {
+      std::istringstream str(line);
+      uint32_t value = 0;
+      std::string key;
+      if ((str >> value) && std::getline(str >> std::ws, key) && !key.empty()) {
+        tuning_[key] = value;
+      }
+    }
+  }
+  return tuningFile_;
+}
+
+bool AppProfile::GetTunedValue(const std::string& key, uint32_t* value) const {
+  amd::ScopedLock lock(tuningLock_);
+  if (tuningFile().empty()) {
+    return false;
+  }
+  auto it = tuning_.find(key);
+  if (it == tuning_.end()) {
+    return false;
+  }
+  *value = it->second;
+  return true;
+}
+
+void AppProfile::SetTunedValue(const std::string& key, uint32_t value) const {
+  SetTunedValues({std::make_pair(key, value)});
+}
+
+void AppProfile::SetTunedValues(
+    const std::vector<std::pair<std::string, uint32_t>>& values) const {
+  amd::ScopedLock lock(tuningLock_);
+  if (tuningFile().empty()) {
+    return;
+  }
+  bool changed = false;
+  for (const auto& value : values) {
+    auto it = tuning_.find(value.first);
+    if ((it == tuning_.end()) || (it->second != value.second)) {
+      tuning_[value.first] = value.second;
+      changed = true;
+    }
+  }
+  if (!changed) {
+    return;
+  }
+
+  // The tuned values converge once per key, so the whole profile is rewritten.
+  // The rename publishes the complete file for the concurrent processes
+  std::ostringstream tempName;
+  tempName << tuningFile_ << '.' << std::hex << amd::Os::timeNanos() << ".tmp";
+  std::ofstream file(tempName.str(), std::ios::out | std::ios::trunc);
+  if (!file.is_open()) {
+    return;
+  }
+  file << tuningVersion_ << '\n';
+  for (const auto& entry : tuning_) {
+    file << entry.second << ' ' << entry.first << '\n';
+  }
+  file.close();
+  if (file.fail() || !amd::Os::renameFile(tempName.str(), tuningFile_)) {
+    LogPrintfWarning("Failed to store the tuning profile: %s", tuningFile_.c_str());
+    amd::Os::unlink(tempName.str());
+  }
+}
 }
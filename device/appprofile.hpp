@@ -21,8 +21,13 @@
 #ifndef APPPROFILE_HPP_
 #define APPPROFILE_HPP_
 
+#include "thread/monitor.hpp"
+
+#include <cstdint>
 #include <unordered_map>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace amd {
 
@@ -38,6 +43,15 @@ class AppProfile {
   const std::string& appFileName() const { return appFileName_; }
   const std::wstring& wsAppPathAndFileName() const { return wsAppPathAndFileName_; }
 
+  //! Finds the value for the key in the persistent tuning profile of the application
+  bool GetTunedValue(const std::string& key, uint32_t* value) const;
+
+  //! Stores the value for the key in the persistent tuning profile of the application
+  void SetTunedValue(const std::string& key, uint32_t value) const;
+
+  //! Stores the values in the persistent tuning profile of the application with one update
+  void SetTunedValues(const std::vector<std::pair<std::string, uint32_t>>& values) const;
+
  protected:
   enum DataTypes {
     DataType_Unknown = 0,
@@ -64,6 +78,16 @@ class AppProfile {
   bool gpuvmHighAddr_;                // Currently not used.
   bool profileOverridesAllSettings_;  // Overrides hint flags and env.var.
   std::string buildOptsAppend_;
+
+ private:
+  //! Returns the file of the tuning profile and loads the profile on the first use
+  const std::string& tuningFile() const;
+
+  mutable amd::Monitor tuningLock_;  //!< Lock for the tuning profile
+  mutable std::unordered_map<std::string, uint32_t> tuning_;  //!< The tuned values
+  mutable std::string tuningFile_;   //!< The tuning profile file, empty if disabled
+  mutable std::string tuningVersion_;  //!< The executable version, the profile belongs to
+  mutable bool tuningLoaded_;        //!< The tuning profile was loaded
 };
 }
 #endif
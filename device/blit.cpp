@@ -22,11 +22,50 @@
 #include "device/device.hpp"
 #include "device/blit.hpp"
 #include "utils/debug.hpp"
+#include "utils/flags.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 namespace device {
 
+//! The size of the expanded fill pattern, which is copied into the memory
+static constexpr size_t kFillBlockSize = 64 * Ki;
+
+//! Copies the rows of a 3D region. Big regions are split between the host threads by rows,
+//! offsets(row, slice, &dstOffset, &srcOffset) returns the offsets of each row
+template <typename Offsets>
+static void copyRows(void* dst, const void* src, size_t rowSize, size_t numRows,
+                     size_t numSlices, Offsets offsets) {
+  const size_t count = numRows * numSlices;
+  auto body = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      size_t dstOffset;
+      size_t srcOffset;
+      offsets(i % numRows, i / numRows, &dstOffset, &srcOffset);
+      amd::Os::fastMemcpy((reinterpret_cast<address>(dst) + dstOffset),
+                          (reinterpret_cast<const_address>(src) + srcOffset), rowSize);
+    }
+  };
+  if ((count > 1) && ((rowSize * count) >= AMD_PARALLEL_COPY_SIZE * Ki)) {
+    amd::Os::parallelFor(count, body);
+  } else {
+    body(0, count);
+  }
+}
+
+//! Expands the pattern into the block by doubling the filled part, so the fill is done
+//! with a few big copies instead of a copy per pattern
+static void expandPattern(std::vector<char>* block, const void* pattern, size_t patternSize,
+                          size_t size) {
+  block->resize(std::max(std::min(size, kFillBlockSize) / patternSize, size_t(1)) * patternSize);
+  memcpy(block->data(), pattern, patternSize);
+  for (size_t filled = patternSize; filled < block->size(); filled *= 2) {
+    memcpy(block->data() + filled, block->data(), std::min(filled, block->size() - filled));
+  }
+}
+
 HostBlitManager::HostBlitManager(VirtualDevice& vDev, Setup setup)
     : BlitManager(setup), vDev_(vDev), dev_(vDev.device()) {}
 
@@ -41,7 +80,7 @@ bool HostBlitManager::readBuffer(device::Memory& srcMemory, void* dstHost,
   }
 
   // Copy memory
-  amd::Os::fastMemcpy(dstHost, reinterpret_cast<const_address>(src) + origin[0], size[0]);
+  amd::Os::parallelMemcpy(dstHost, reinterpret_cast<const_address>(src) + origin[0], size[0]);
 
   // Unmap device memory
   srcMemory.cpuUnmap(vDev_);
@@ -60,19 +99,12 @@ bool HostBlitManager::readBufferRect(device::Memory& srcMemory, void* dstHost,
     return false;
   }
 
-  size_t srcOffset;
-  size_t dstOffset;
-
-  for (size_t z = 0; z < size[2]; ++z) {
-    for (size_t y = 0; y < size[1]; ++y) {
-      srcOffset = bufRect.offset(0, y, z);
-      dstOffset = hostRect.offset(0, y, z);
-
-      // Copy memory line by line
-      amd::Os::fastMemcpy((reinterpret_cast<address>(dstHost) + dstOffset),
-                          (reinterpret_cast<const_address>(src) + srcOffset), size[0]);
-    }
-  }
+  // Copy memory line by line
+  copyRows(dstHost, src, size[0], size[1], size[2],
+           [&](size_t y, size_t z, size_t* dstOffset, size_t* srcOffset) {
+             *dstOffset = hostRect.offset(0, y, z);
+             *srcOffset = bufRect.offset(0, y, z);
+           });
 
   // Unmap source memory
   srcMemory.cpuUnmap(vDev_);
@@ -105,8 +137,6 @@ bool HostBlitManager::readImage(device::Memory& srcMemory, void* dstHost,
   size_t elementSize = srcMemory.owner()->asImage()->getImageFormat().getElementSize();
   size_t srcOffsBase = origin[0] * elementSize;
   size_t copySize = size[0] * elementSize;
-  size_t srcOffs;
-  size_t dstOffs = 0;
 
   // Make sure we use the right pitch if it's not specified
   if (rowPitch == 0) {
@@ -125,20 +155,11 @@ bool HostBlitManager::readImage(device::Memory& srcMemory, void* dstHost,
   srcOffsBase += srcSlicePitch * origin[2];
 
   // Copy memory line by line
-  for (size_t slice = 0; slice < size[2]; ++slice) {
-    srcOffs = srcOffsBase + slice * srcSlicePitch;
-    dstOffs = slice * slicePitch;
-
-    // Copy memory line by line
-    for (size_t row = 0; row < size[1]; ++row) {
-      // Copy memory
-      amd::Os::fastMemcpy((reinterpret_cast<address>(dstHost) + dstOffs),
-                          (reinterpret_cast<const_address>(src) + srcOffs), copySize);
-
-      srcOffs += srcRowPitch;
-      dstOffs += rowPitch;
-    }
-  }
+  copyRows(dstHost, src, copySize, size[1], size[2],
+           [&](size_t row, size_t slice, size_t* dstOffset, size_t* srcOffset) {
+             *dstOffset = slice * slicePitch + row * rowPitch;
+             *srcOffset = srcOffsBase + slice * srcSlicePitch + row * srcRowPitch;
+           });
 
   // Unmap the device memory
   srcMemory.cpuUnmap(vDev_);
@@ -162,7 +183,7 @@ bool HostBlitManager::writeBuffer(const void* srcHost, device::Memory& dstMemory
   }
 
   // Copy memory
-  amd::Os::fastMemcpy(reinterpret_cast<address>(dst) + origin[0], srcHost, size[0]);
+  amd::Os::parallelMemcpy(reinterpret_cast<address>(dst) + origin[0], srcHost, size[0]);
 
   // Unmap the device memory
   dstMemory.cpuUnmap(vDev_);
@@ -181,19 +202,12 @@ bool HostBlitManager::writeBufferRect(const void* srcHost, device::Memory& dstMe
     return false;
   }
 
-  size_t srcOffset;
-  size_t dstOffset;
-
-  for (size_t z = 0; z < size[2]; ++z) {
-    for (size_t y = 0; y < size[1]; ++y) {
-      srcOffset = hostRect.offset(0, y, z);
-      dstOffset = bufRect.offset(0, y, z);
-
-      // Copy memory line by line
-      amd::Os::fastMemcpy((reinterpret_cast<address>(dst) + dstOffset),
-                          (reinterpret_cast<const_address>(srcHost) + srcOffset), size[0]);
-    }
-  }
+  // Copy memory line by line
+  copyRows(dst, srcHost, size[0], size[1], size[2],
+           [&](size_t y, size_t z, size_t* dstOffset, size_t* srcOffset) {
+             *dstOffset = bufRect.offset(0, y, z);
+             *srcOffset = hostRect.offset(0, y, z);
+           });
 
   // Unmap destination memory
   dstMemory.cpuUnmap(vDev_);
@@ -227,10 +241,8 @@ bool HostBlitManager::writeImage(const void* srcHost, device::Memory& dstMemory,
   }
 
   size_t elementSize = dstMemory.owner()->asImage()->getImageFormat().getElementSize();
-  size_t srcOffs = 0;
   size_t copySize = size[0] * elementSize;
   size_t dstOffsBase = origin[0] * elementSize;
-  size_t dstOffs;
 
   // Make sure we use the right pitch if it's not specified
   if (rowPitch == 0) {
@@ -248,21 +260,12 @@ bool HostBlitManager::writeImage(const void* srcHost, device::Memory& dstMemory,
   // Adjust the destination offset with Z dimension
   dstOffsBase += dstSlicePitch * origin[2];
 
-  // Copy memory slice by slice
-  for (size_t slice = 0; slice < size[2]; ++slice) {
-    dstOffs = dstOffsBase + slice * dstSlicePitch;
-    srcOffs = slice * slicePitch;
-
-    // Copy memory line by line
-    for (size_t row = 0; row < size[1]; ++row) {
-      // Copy memory
-      amd::Os::fastMemcpy((reinterpret_cast<address>(dst) + dstOffs),
-                          (reinterpret_cast<const_address>(srcHost) + srcOffs), copySize);
-
-      dstOffs += dstRowPitch;
-      srcOffs += rowPitch;
-    }
-  }
+  // Copy memory line by line
+  copyRows(dst, srcHost, copySize, size[1], size[2],
+           [&](size_t row, size_t slice, size_t* dstOffset, size_t* srcOffset) {
+             *dstOffset = dstOffsBase + slice * dstSlicePitch + row * dstRowPitch;
+             *srcOffset = slice * slicePitch + row * rowPitch;
+           });
 
   // Unmap the device memory
   dstMemory.cpuUnmap(vDev_);
@@ -290,8 +293,8 @@ bool HostBlitManager::copyBuffer(device::Memory& srcMemory, device::Memory& dstM
   }
 
   // Straight forward buffer copy
-  amd::Os::fastMemcpy((reinterpret_cast<address>(dst) + dstOrigin[0]),
-                      (reinterpret_cast<const_address>(src) + srcOrigin[0]), size[0]);
+  amd::Os::parallelMemcpy((reinterpret_cast<address>(dst) + dstOrigin[0]),
+                          (reinterpret_cast<const_address>(src) + srcOrigin[0]), size[0]);
 
   // Unmap source and destination memory
   dstMemory.cpuUnmap(vDev_);
@@ -319,16 +322,12 @@ bool HostBlitManager::copyBufferRect(device::Memory& srcMemory, device::Memory&
     return false;
   }
 
-  for (size_t z = 0; z < size[2]; ++z) {
-    for (size_t y = 0; y < size[1]; ++y) {
-      size_t srcOffset = srcRect.offset(0, y, z);
-      size_t dstOffset = dstRect.offset(0, y, z);
-
-      // Copy memory line by line
-      amd::Os::fastMemcpy((reinterpret_cast<address>(dst) + dstOffset),
-                          (reinterpret_cast<const_address>(src) + srcOffset), size[0]);
-    }
-  }
+  // Copy memory line by line
+  copyRows(dst, src, size[0], size[1], size[2],
+           [&](size_t y, size_t z, size_t* dstOffset, size_t* srcOffset) {
+             *dstOffset = dstRect.offset(0, y, z);
+             *srcOffset = srcRect.offset(0, y, z);
+           });
 
   // Unmap source and destination memory
   dstMemory.cpuUnmap(vDev_);
@@ -381,19 +380,12 @@ bool HostBlitManager::copyImageToBuffer(device::Memory& srcMemory, device::Memor
 
   srcOffsOrg = srcOffs;
 
-  // Copy memory slice by slice
-  for (size_t slice = 0; slice < size[2]; ++slice) {
-    srcOffs = srcOffsOrg + slice * srcSlicePitch;
-
-    // Copy memory line by line
-    for (size_t rows = 0; rows < size[1]; ++rows) {
-      amd::Os::fastMemcpy((reinterpret_cast<address>(dst) + dstOffs),
-                          (reinterpret_cast<const_address>(src) + srcOffs), copySize);
-
-      srcOffs += srcRowPitch;
-      dstOffs += copySize;
-    }
-  }
+  // Copy memory line by line
+  copyRows(dst, src, copySize, size[1], size[2],
+           [&](size_t row, size_t slice, size_t* dstOffset, size_t* srcOffset) {
+             *dstOffset = dstOffs + (slice * size[1] + row) * copySize;
+             *srcOffset = srcOffsOrg + slice * srcSlicePitch + row * srcRowPitch;
+           });
 
   // Unmap source and destination memory
   srcMemory.cpuUnmap(vDev_);
@@ -446,19 +438,12 @@ bool HostBlitManager::copyBufferToImage(device::Memory& srcMemory, device::Memor
 
   dstOffsOrg = dstOffs;
 
-  // Copy memory slice by slice
-  for (size_t slice = 0; slice < size[2]; ++slice) {
-    dstOffs = dstOffsOrg + slice * dstSlicePitch;
-
-    // Copy memory line by line
-    for (size_t rows = 0; rows < size[1]; ++rows) {
-      amd::Os::fastMemcpy((reinterpret_cast<address>(dst) + dstOffs),
-                          (reinterpret_cast<const_address>(src) + srcOffs), copySize);
-
-      srcOffs += copySize;
-      dstOffs += dstRowPitch;
-    }
-  }
+  // Copy memory line by line
+  copyRows(dst, src, copySize, size[1], size[2],
+           [&](size_t row, size_t slice, size_t* dstOffset, size_t* srcOffset) {
+             *dstOffset = dstOffsOrg + slice * dstSlicePitch + row * dstRowPitch;
+             *srcOffset = srcOffs + (slice * size[1] + row) * copySize;
+           });
 
   // Unmap source and destination memory
   srcMemory.cpuUnmap(vDev_);
@@ -530,20 +515,12 @@ bool HostBlitManager::copyImage(device::Memory& srcMemory, device::Memory& dstMe
   srcOffsOrg = srcOffs;
   dstOffsOrg = dstOffs;
 
-  // Copy memory slice by slice
-  for (size_t slice = 0; slice < size[2]; ++slice) {
-    srcOffs = srcOffsOrg + slice * srcSlicePitch;
-    dstOffs = dstOffsOrg + slice * dstSlicePitch;
-
-    // Copy memory line by line
-    for (size_t rows = 0; rows < size[1]; ++rows) {
-      amd::Os::fastMemcpy((reinterpret_cast<address>(dst) + dstOffs),
-                          (reinterpret_cast<const_address>(src) + srcOffs), copySize);
-
-      srcOffs += srcRowPitch;
-      dstOffs += dstRowPitch;
-    }
-  }
+  // Copy memory line by line
+  copyRows(dst, src, copySize, size[1], size[2],
+           [&](size_t row, size_t slice, size_t* dstOffset, size_t* srcOffset) {
+             *dstOffset = dstOffsOrg + slice * dstSlicePitch + row * dstRowPitch;
+             *srcOffset = srcOffsOrg + slice * srcSlicePitch + row * srcRowPitch;
+           });
 
   // Unmap source and destination memory
   srcMemory.cpuUnmap(vDev_);
@@ -569,11 +546,24 @@ bool HostBlitManager::fillBuffer(device::Memory& memory, const void* pattern, si
     LogError("Misaligned buffer size and pattern size!");
   }
 
-  // Fill the buffer memory with a pattern
-  for (size_t i = 0; i < (fillSize / patternSize); i++) {
-    memcpy((reinterpret_cast<address>(fillMem) + offset),
-           (reinterpret_cast<const_address>(pattern)), patternSize);
-    offset += patternSize;
+  // Fill the buffer memory with the expanded pattern block by block
+  fillSize -= fillSize % patternSize;
+  if (fillSize > 0) {
+    std::vector<char> block;
+    expandPattern(&block, pattern, patternSize, fillSize);
+    const size_t blockSize = block.size();
+    address dst = reinterpret_cast<address>(fillMem) + offset;
+    auto body = [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        memcpy(dst + i * blockSize, block.data(), std::min(blockSize, fillSize - i * blockSize));
+      }
+    };
+    const size_t numBlocks = amd::alignUp(fillSize, blockSize) / blockSize;
+    if (fillSize >= AMD_PARALLEL_COPY_SIZE * Ki) {
+      amd::Os::parallelFor(numBlocks, body);
+    } else {
+      body(0, numBlocks);
+    }
   }
 
   // Unmap source and destination memory
@@ -633,22 +623,23 @@ bool HostBlitManager::fillImage(device::Memory& memory, const void* pattern,
 
   offsetOrg = offset;
 
-  // Fill the image memory with a pattern
-  for (size_t slice = 0; slice < size[2]; ++slice) {
-    offset = offsetOrg + slice * devSlicePitch;
-
-    for (size_t rows = 0; rows < size[1]; ++rows) {
-      size_t pixOffset = offset;
-
-      // Copy memory pixel by pixel
-      for (size_t column = 0; column < size[0]; ++column) {
-        memcpy((reinterpret_cast<address>(fillMem) + pixOffset),
-               (reinterpret_cast<const_address>(fillValue)), elementSize);
-        pixOffset += elementSize;
-      }
-
-      offset += devRowPitch;
-    }
+  // Expand the pixel into a row once, then fill the image memory row by row
+  const size_t rowSize = size[0] * elementSize;
+  std::vector<char> row;
+  expandPattern(&row, fillValue, elementSize, rowSize);
+  const size_t blockSize = row.size();
+  copyRows(fillMem, row.data(), std::min(rowSize, blockSize),
+           size[1], size[2], [&](size_t y, size_t z, size_t* dstOffset, size_t* srcOffset) {
+             *dstOffset = offsetOrg + z * devSlicePitch + y * devRowPitch;
+             *srcOffset = 0;
+           });
+  // Rows wider than the expanded block are filled with the remaining blocks
+  for (size_t column = blockSize; column < rowSize; column += blockSize) {
+    copyRows(fillMem, row.data(), std::min(rowSize - column, blockSize),
+             size[1], size[2], [&](size_t y, size_t z, size_t* dstOffset, size_t* srcOffset) {
+               *dstOffset = offsetOrg + z * devSlicePitch + y * devRowPitch + column;
+               *srcOffset = 0;
+             });
   }
 
   // Unmap memory
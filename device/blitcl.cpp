@@ -58,7 +58,73 @@ const char* BlitSourceCode = BLIT_KERNELS(
                              __constant uchar* pattern, uint patternSize, ulong offset,
                              ulong size) {
       __amd_fillBuffer(bufUChar, bufUInt, pattern, patternSize, offset, size);
-    } extern void __amd_copyBufferToImage(__global uint*, __write_only image2d_array_t, ulong4,
+    }
+
+    __kernel void __amd_rocclr_copyBufferWide(__global uchar* src, __global uchar* dst,
+                                              ulong srcOrigin, ulong dstOrigin, ulong size,
+                                              ulong head) {
+      ulong id = get_global_id(0);
+      ulong stride = get_global_size(0);
+      ulong body = (size - head) / 16;
+      ulong tail = head + body * 16;
+      if (id < head) {
+        dst[dstOrigin + id] = src[srcOrigin + id];
+      }
+      if (id < (size - tail)) {
+        dst[dstOrigin + tail + id] = src[srcOrigin + tail + id];
+      }
+      __global const uint4* srcWide = (__global const uint4*)(src + srcOrigin + head);
+      __global uint4* dstWide = (__global uint4*)(dst + dstOrigin + head);
+      for (ulong i = id; i < body; i += stride) {
+        dstWide[i] = srcWide[i];
+      }
+    }
+
+    __kernel void __amd_rocclr_fillBufferWide(__global uchar* buf, uint4 pattern, ulong offset,
+                                              ulong size, ulong head) {
+      ulong id = get_global_id(0);
+      ulong stride = get_global_size(0);
+      ulong body = (size - head) / 16;
+      ulong tail = head + body * 16;
+      __private uint4 value = pattern;
+      __private uchar* bytes = (__private uchar*)&value;
+      __global uchar* dst = buf + offset;
+      if (id < head) {
+        dst[id] = bytes[id % 16];
+      }
+      if (id < (size - tail)) {
+        dst[tail + id] = bytes[(tail + id) % 16];
+      }
+      __global uint4* dstWide = (__global uint4*)(dst + head);
+      for (ulong i = id; i < body; i += stride) {
+        dstWide[i] = value;
+      }
+    }
+
+    __kernel void __amd_rocclr_copyBufferBatch(__global uchar* src, __global uchar* dst,
+                                               __global const ulong* regions, uint count) {
+      ulong lane = get_local_id(0);
+      ulong lanes = get_local_size(0);
+      // Each workgroup copies a region at a time, the regions are (src, dst, size) triples
+      for (uint r = get_group_id(0); r < count; r += get_num_groups(0)) {
+        __global uchar* srcRegion = src + regions[3 * r];
+        __global uchar* dstRegion = dst + regions[3 * r + 1];
+        ulong size = regions[3 * r + 2];
+        if ((((ulong)srcRegion | (ulong)dstRegion | size) % 16) == 0) {
+          __global const uint4* srcWide = (__global const uint4*)srcRegion;
+          __global uint4* dstWide = (__global uint4*)dstRegion;
+          for (ulong i = lane; i < (size / 16); i += lanes) {
+            dstWide[i] = srcWide[i];
+          }
+        } else {
+          for (ulong i = lane; i < size; i += lanes) {
+            dstRegion[i] = srcRegion[i];
+          }
+        }
+      }
+    }
+
+    extern void __amd_copyBufferToImage(__global uint*, __write_only image2d_array_t, ulong4,
                                           int4, int4, uint4, ulong4);
 
     extern void __amd_copyImageToBuffer(__read_only image2d_array_t, __global uint*,
@@ -27,6 +27,14 @@ namespace amd {
 std::once_flag Comgr::initialized;
 ComgrEntryPoints Comgr::cep_;
 bool Comgr::is_ready_ = false;
+std::mutex Comgr::cacheLock_;
+std::map<std::string, std::vector<amd_comgr_action_info_t>> Comgr::actionCache_;
+std::map<std::string, std::vector<amd_comgr_data_t>> Comgr::dataCache_;
+
+//! The limit of the cached keys. The options with unique paths would grow the caches forever
+static constexpr size_t kMaxCachedKeys = 64;
+//! The limit of the idle action infos per key
+static constexpr size_t kMaxIdleActions = 4;
 
 bool Comgr::LoadLib() {
 #if defined(COMGR_DYN_DLL)
@@ -88,5 +96,130 @@ bool Comgr::LoadLib() {
   return true;
 }
 
+// ================================================================================================
+amd_comgr_status_t Comgr::acquire_action_info(const std::string& key,
+                                              amd_comgr_action_info_t* action_info,
+                                              bool* created) {
+  {
+    std::lock_guard<std::mutex> lock(cacheLock_);
+    auto it = actionCache_.find(key);
+    if ((it != actionCache_.end()) && !it->second.empty()) {
+      *action_info = it->second.back();
+      it->second.pop_back();
+      *created = false;
+      return AMD_COMGR_STATUS_SUCCESS;
+    }
+  }
+  *created = true;
+  return create_action_info(action_info);
+}
+
+// ================================================================================================
+void Comgr::release_action_info(const std::string& key, amd_comgr_action_info_t action_info) {
+  {
+    std::lock_guard<std::mutex> lock(cacheLock_);
+    auto it = actionCache_.find(key);
+    if ((it == actionCache_.end()) && (actionCache_.size() < kMaxCachedKeys)) {
+      it = actionCache_.emplace(key, std::vector<amd_comgr_action_info_t>()).first;
+    }
+    if ((it != actionCache_.end()) && (it->second.size() < kMaxIdleActions)) {
+      it->second.push_back(action_info);
+      return;
+    }
+  }
+  destroy_action_info(action_info);
+}
+
+// ================================================================================================
+amd_comgr_status_t Comgr::copy_data_set(amd_comgr_data_set_t input, amd_comgr_data_set_t result) {
+  static constexpr amd_comgr_data_kind_t kinds[] = {
+      AMD_COMGR_DATA_KIND_SOURCE, AMD_COMGR_DATA_KIND_INCLUDE,
+      AMD_COMGR_DATA_KIND_PRECOMPILED_HEADER, AMD_COMGR_DATA_KIND_DIAGNOSTIC,
+      AMD_COMGR_DATA_KIND_BC, AMD_COMGR_DATA_KIND_RELOCATABLE,
+      AMD_COMGR_DATA_KIND_EXECUTABLE, AMD_COMGR_DATA_KIND_BYTES};
+  for (const auto kind : kinds) {
+    size_t count = 0;
+    amd_comgr_status_t status = action_data_count(input, kind, &count);
+    for (size_t i = 0; (status == AMD_COMGR_STATUS_SUCCESS) && (i < count); ++i) {
+      amd_comgr_data_t data;
+      status = action_data_get_data(input, kind, i, &data);
+      if (status == AMD_COMGR_STATUS_SUCCESS) {
+        status = data_set_add(result, data);
+        release_data(data);
+      }
+    }
+    if (status != AMD_COMGR_STATUS_SUCCESS) {
+      return status;
+    }
+  }
+  return AMD_COMGR_STATUS_SUCCESS;
+}
+
+// ================================================================================================
+amd_comgr_status_t Comgr::do_add_action(amd_comgr_action_kind_t kind,
+                                        amd_comgr_data_kind_t data_kind, const std::string& key,
+                                        amd_comgr_action_info_t info,
+                                        amd_comgr_data_set_t input, amd_comgr_data_set_t result) {
+  const std::string dataKey = std::to_string(kind) + '\n' + key;
+  std::vector<amd_comgr_data_t> added;
+  bool found = false;
+  {
+    std::lock_guard<std::mutex> lock(cacheLock_);
+    auto it = dataCache_.find(dataKey);
+    if (it != dataCache_.end()) {
+      added = it->second;
+      found = true;
+    }
+  }
+
+  if (!found) {
+    // Run the action without the user data once, so only the added data remains in the output
+    amd_comgr_data_set_t empty;
+    amd_comgr_data_set_t output;
+    if (create_data_set(&empty) != AMD_COMGR_STATUS_SUCCESS) {
+      return do_action(kind, info, input, result);
+    }
+    amd_comgr_status_t status = create_data_set(&output);
+    if (status == AMD_COMGR_STATUS_SUCCESS) {
+      status = do_action(kind, info, empty, output);
+      size_t count = 0;
+      if (status == AMD_COMGR_STATUS_SUCCESS) {
+        status = action_data_count(output, data_kind, &count);
+      }
+      for (size_t i = 0; (status == AMD_COMGR_STATUS_SUCCESS) && (i < count); ++i) {
+        amd_comgr_data_t data;
+        status = action_data_get_data(output, data_kind, i, &data);
+        if (status == AMD_COMGR_STATUS_SUCCESS) {
+          added.push_back(data);
+        }
+      }
+      destroy_data_set(output);
+    }
+    destroy_data_set(empty);
+
+    bool cached = false;
+    if (status == AMD_COMGR_STATUS_SUCCESS) {
+      std::lock_guard<std::mutex> lock(cacheLock_);
+      if (dataCache_.size() < kMaxCachedKeys) {
+        // Another thread could add the same key, but then the own objects are just released
+        cached = dataCache_.emplace(dataKey, added).second;
+      }
+    }
+    if (!cached) {
+      for (const auto& data : added) {
+        release_data(data);
+      }
+      // Let the real action run over the input and report the errors in the log
+      return do_action(kind, info, input, result);
+    }
+  }
+
+  amd_comgr_status_t status = copy_data_set(input, result);
+  for (size_t i = 0; (status == AMD_COMGR_STATUS_SUCCESS) && (i < added.size()); ++i) {
+    status = data_set_add(result, added[i]);
+  }
+  return status;
+}
+
 }
 #endif
@@ -25,6 +25,10 @@
 #include "top.hpp"
 #include "amd_comgr.h"
 
+#include <map>
+#include <string>
+#include <vector>
+
 namespace amd {
 typedef void (*t_amd_comgr_get_version)(size_t *major, size_t *minor);
 typedef amd_comgr_status_t (*t_amd_comgr_status_string)(amd_comgr_status_t status, const char ** status_string);
@@ -275,9 +279,35 @@ public:
     return COMGR_DYN(amd_comgr_symbol_get_info)(symbol, attribute, value);
   }
 
+  //! Returns an idle action info for the key from the cache. Otherwise creates a new one and
+  //! sets @p created, so the caller initializes the language, ISA and options of the key
+  static amd_comgr_status_t acquire_action_info(const std::string& key,
+                                                amd_comgr_action_info_t* action_info,
+                                                bool* created);
+  //! Returns the action info into the cache for the next compilation with the same key
+  static void release_action_info(const std::string& key, amd_comgr_action_info_t action_info);
+  //! Runs an action, which copies the input set and adds the data of @p data_kind,
+  //! i.e. the device libraries or the precompiled headers. The added data objects are created
+  //! once for the action kind and the action info key and are reused by the next compilations
+  static amd_comgr_status_t do_add_action(amd_comgr_action_kind_t kind,
+                                          amd_comgr_data_kind_t data_kind,
+                                          const std::string& key,
+                                          amd_comgr_action_info_t info,
+                                          amd_comgr_data_set_t input,
+                                          amd_comgr_data_set_t result);
+
 private:
+  //! Copies all data objects of the input set, except the logs, into the result set
+  static amd_comgr_status_t copy_data_set(amd_comgr_data_set_t input, amd_comgr_data_set_t result);
+
   static ComgrEntryPoints cep_;
   static bool is_ready_;
+
+  static std::mutex cacheLock_;  //!< Lock for the action info and data caches
+  //! Idle action infos, indexed by the language, ISA and options
+  static std::map<std::string, std::vector<amd_comgr_action_info_t>> actionCache_;
+  //! Data objects, which were added by the actions, indexed by the action kind and key
+  static std::map<std::string, std::vector<amd_comgr_data_t>> dataCache_;
 };
 
 }
@@ -0,0 +1,346 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/devbundle.hpp"
+#include "device/device.hpp"
+#include "utils/debug.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(ROCCLR_SUPPORT_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace device {
+
+namespace {
+
+constexpr char kBundleMagic[] = "__CLANG_OFFLOAD_BUNDLE__";
+constexpr size_t kBundleMagicSize = sizeof(kBundleMagic) - 1;
+constexpr char kCompressedMagic[] = "CCOB";
+constexpr size_t kCompressedMagicSize = sizeof(kCompressedMagic) - 1;
+
+//! The compression method of llvm::compression::Format
+constexpr uint16_t kMethodZstd = 1;
+//! The maximum length of the entry id
+constexpr uint64_t kMaxIdSize = 4 * Ki;
+//! The chunk of the dropped data in the compressed stream
+constexpr size_t kSkipChunkSize = 256 * Ki;
+
+//! An entry of the bundle index
+struct Entry {
+  uint64_t offset_;  //!< The offset of the code object in the bundle
+  uint64_t size_;    //!< The code object size
+  std::string id_;   //!< <offload kind>-<target triple>-<target id>
+};
+
+//! Reads the bundle sequentially from the start
+class Reader {
+ public:
+  Reader() : pos_(0) {}
+  virtual ~Reader() {}
+
+  //! Reads the next bytes of the bundle
+  virtual bool read(void* dst, size_t size) = 0;
+
+  //! Drops the next bytes of the bundle
+  virtual bool skip(size_t size) = 0;
+
+  //! Returns the current position in the bundle
+  uint64_t pos() const { return pos_; }
+
+ protected:
+  uint64_t pos_;  //!< The current position in the bundle
+};
+
+//! Reads the regular bundle from memory
+class PlainReader : public Reader {
+ public:
+  PlainReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  bool read(void* dst, size_t size) override {
+    if (size > (size_ - pos_)) {
+      return false;
+    }
+    ::memcpy(dst, data_ + pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  bool skip(size_t size) override {
+    if (size > (size_ - pos_)) {
+      return false;
+    }
+    pos_ += size;
+    return true;
+  }
+
+ private:
+  const uint8_t* data_;  //!< The bundle image
+  size_t size_;          //!< The bundle size
+};
+
+#if defined(ROCCLR_SUPPORT_ZSTD)
+//! Decompresses the bundle from the zstd stream, only up to the last requested byte
+class ZstdReader : public Reader {
+ public:
+  ZstdReader(const uint8_t* data, size_t size) : stream_(ZSTD_createDStream()) {
+    input_.src = data;
+    input_.size = size;
+    input_.pos = 0;
+    if (stream_ != nullptr) {
+      ZSTD_initDStream(stream_);
+    }
+  }
+  ~ZstdReader() override { ZSTD_freeDStream(stream_); }
+
+  bool read(void* dst, size_t size) override {
+    if (stream_ == nullptr) {
+      return false;
+    }
+    // The output is limited with the requested size, so the stream stops right after it
+    ZSTD_outBuffer output = {dst, size, 0};
+    while (output.pos < output.size) {
+      const size_t inPos = input_.pos;
+      const size_t outPos = output.pos;
+      const size_t result = ZSTD_decompressStream(stream_, &output, &input_);
+      if (ZSTD_isError(result)) {
+        LogPrintfError("Code object bundle decompression failed: %s",
+                       ZSTD_getErrorName(result));
+        return false;
+      }
+      if ((inPos == input_.pos) && (outPos == output.pos)) {
+        LogError("Code object bundle is truncated");
+        return false;
+      }
+    }
+    pos_ += size;
+    return true;
+  }
+
+  bool skip(size_t size) override {
+    std::vector<uint8_t> chunk(std::min(size, kSkipChunkSize));
+    while (size > 0) {
+      const size_t count = std::min(size, chunk.size());
+      if (!read(chunk.data(), count)) {
+        return false;
+      }
+      size -= count;
+    }
+    return true;
+  }
+
+ private:
+  ZSTD_DStream* stream_;  //!< The decompression stream
+  ZSTD_inBuffer input_;   //!< The compressed data
+};
+#endif
+
+// ================================================================================================
+//! Reads the index from the start of the bundle
+bool readIndex(Reader& reader, std::vector<Entry>* entries) {
+  char magic[kBundleMagicSize];
+  uint64_t count = 0;
+  if (!reader.read(magic, sizeof(magic)) ||
+      (::memcmp(magic, kBundleMagic, kBundleMagicSize) != 0) ||
+      !reader.read(&count, sizeof(count))) {
+    LogError("Invalid code object bundle header");
+    return false;
+  }
+  for (uint64_t i = 0; i < count; ++i) {
+    Entry entry;
+    uint64_t idSize = 0;
+    if (!reader.read(&entry.offset_, sizeof(entry.offset_)) ||
+        !reader.read(&entry.size_, sizeof(entry.size_)) ||
+        !reader.read(&idSize, sizeof(idSize)) || (idSize > kMaxIdSize)) {
+      LogError("Invalid code object bundle index");
+      return false;
+    }
+    entry.id_.resize(idSize);
+    if (!reader.read(&entry.id_[0], idSize)) {
+      LogError("Invalid code object bundle index");
+      return false;
+    }
+    entries->push_back(entry);
+  }
+  return true;
+}
+
+// ================================================================================================
+//! Returns the ISA of the bundle entry or nullptr if the entry isn't a device code object
+const amd::Isa* entryIsa(const std::string& id) {
+  static constexpr char kTriple[] = "amdgcn-amd-amdhsa-";
+  const size_t kindEnd = id.find('-');
+  if (kindEnd == std::string::npos) {
+    return nullptr;
+  }
+  const std::string kind = id.substr(0, kindEnd);
+  if ((kind != "hip") && (kind != "hipv4") && (kind != "hcc")) {
+    return nullptr;
+  }
+  if (id.compare(kindEnd + 1, sizeof(kTriple) - 1, kTriple) != 0) {
+    return nullptr;
+  }
+  // The new bundles have the empty environment component in the triple
+  size_t targetId = kindEnd + sizeof(kTriple);
+  if ((targetId < id.size()) && (id[targetId] == '-')) {
+    ++targetId;
+  }
+  const std::string isaName = std::string(kTriple) + "-" + id.substr(targetId);
+  return amd::Isa::findIsa(isaName.c_str());
+}
+
+// ================================================================================================
+//! Returns the entry for the ISA or nullptr if the bundle doesn't have it
+const Entry* findEntry(const std::vector<Entry>& entries, const amd::Isa& isa) {
+  const Entry* compatible = nullptr;
+  for (const auto& entry : entries) {
+    const amd::Isa* codeObjectIsa = entryIsa(entry.id_);
+    if (codeObjectIsa == nullptr) {
+      continue;
+    }
+    // The exact target id wins over the code object, which works with any feature setting
+    if (codeObjectIsa == &isa) {
+      return &entry;
+    }
+    if ((compatible == nullptr) && amd::Isa::isCompatible(*codeObjectIsa, isa)) {
+      compatible = &entry;
+    }
+  }
+  return compatible;
+}
+
+}  // namespace
+
+// ================================================================================================
+bool CodeObjectBundle::isBundle(const void* image, size_t size) {
+  return ((size >= kBundleMagicSize) && (::memcmp(image, kBundleMagic, kBundleMagicSize) == 0)) ||
+         ((size >= kCompressedMagicSize) &&
+          (::memcmp(image, kCompressedMagic, kCompressedMagicSize) == 0));
+}
+
+// ================================================================================================
+bool CodeObjectBundle::extract(const void* image, size_t size, const amd::Isa& isa,
+                               const uint8_t** codeObject, size_t* codeObjectSize,
+                               bool* allocated) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(image);
+  std::vector<Entry> entries;
+
+  if ((size >= kBundleMagicSize) && (::memcmp(image, kBundleMagic, kBundleMagicSize) == 0)) {
+    // The regular bundle is in memory already, so the code object is referenced in place
+    PlainReader reader(data, size);
+    if (!readIndex(reader, &entries)) {
+      return false;
+    }
+    const Entry* entry = findEntry(entries, isa);
+    if ((entry == nullptr) || (entry->offset_ > size) || (entry->size_ > (size - entry->offset_))) {
+      LogPrintfError("Code object bundle doesn't have a valid code object for %s",
+                     isa.targetId());
+      return false;
+    }
+    *codeObject = data + entry->offset_;
+    *codeObjectSize = entry->size_;
+    *allocated = false;
+    return true;
+  }
+
+  // The header of the compressed bundle. Version 1 doesn't have the total size,
+  // version 3 has 64 bit sizes
+  uint16_t version = 0;
+  uint16_t method = 0;
+  size_t headerSize = 0;
+  uint64_t uncompressedSize = 0;
+  if (size >= (kCompressedMagicSize + 2 * sizeof(uint16_t))) {
+    ::memcpy(&version, data + kCompressedMagicSize, sizeof(version));
+    ::memcpy(&method, data + kCompressedMagicSize + sizeof(version), sizeof(method));
+  }
+  const size_t sizes = kCompressedMagicSize + 2 * sizeof(uint16_t);
+  switch (version) {
+    case 1:
+      headerSize = sizes + sizeof(uint32_t) + sizeof(uint64_t);
+      if (size >= headerSize) {
+        uint32_t value = 0;
+        ::memcpy(&value, data + sizes, sizeof(value));
+        uncompressedSize = value;
+      }
+      break;
+    case 2:
+      headerSize = sizes + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+      if (size >= headerSize) {
+        uint32_t value = 0;
+        ::memcpy(&value, data + sizes + sizeof(uint32_t), sizeof(value));
+        uncompressedSize = value;
+      }
+      break;
+    case 3:
+      headerSize = sizes + 3 * sizeof(uint64_t);
+      if (size >= headerSize) {
+        ::memcpy(&uncompressedSize, data + sizes + sizeof(uint64_t), sizeof(uncompressedSize));
+      }
+      break;
+    default:
+      break;
+  }
+  if ((headerSize == 0) || (size < headerSize)) {
+    LogPrintfError("Unsupported compressed code object bundle version %d", version);
+    return false;
+  }
+  if (method != kMethodZstd) {
+    LogPrintfError("Unsupported code object bundle compression method %d", method);
+    return false;
+  }
+
+#if defined(ROCCLR_SUPPORT_ZSTD)
+  ZstdReader reader(data + headerSize, size - headerSize);
+  if (!readIndex(reader, &entries)) {
+    return false;
+  }
+  const Entry* entry = findEntry(entries, isa);
+  // The stream can't go back, so the code object must follow the index
+  if ((entry == nullptr) || (entry->offset_ < reader.pos()) ||
+      (entry->offset_ > uncompressedSize) || (entry->size_ > (uncompressedSize - entry->offset_))) {
+    LogPrintfError("Code object bundle doesn't have a valid code object for %s",
+                   isa.targetId());
+    return false;
+  }
+  std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[entry->size_]);
+  if ((buffer == nullptr) || !reader.skip(entry->offset_ - reader.pos()) ||
+      !reader.read(buffer.get(), entry->size_)) {
+    LogPrintfError("Code object decompression failed for %s", isa.targetId());
+    return false;
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_CODE, "Decompressed %s code object, size 0x%zx of 0x%zx",
+          entry->id_.c_str(), static_cast<size_t>(entry->size_),
+          static_cast<size_t>(uncompressedSize));
+  *codeObject = buffer.release();
+  *codeObjectSize = entry->size_;
+  *allocated = true;
+  return true;
+#else
+  LogError("Runtime was built without zstd, compressed code object bundles aren't supported");
+  return false;
+#endif
+}
+
+}  // namespace device
@@ -0,0 +1,54 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+
+#include <cstdint>
+
+namespace amd {
+class Isa;
+}
+
+namespace device {
+
+//! Reads the clang offload bundles, which keep the code objects of all targets in one image.
+//! The bundle starts with the index of the entries, hence only the entry of the device is read.
+//! The compressed bundle is a zstd stream of the regular bundle. It's decompressed in chunks:
+//! the entries before the device entry are dropped and the device entry is written straight
+//! into the code object buffer, the rest of the stream isn't decompressed at all
+class CodeObjectBundle : public amd::AllStatic {
+ public:
+  //! Returns TRUE if the image is a regular or a compressed bundle
+  static bool isBundle(const void* image, size_t size);
+
+  //! Finds the code object for the ISA. The code object of a regular bundle points into
+  //! the image, the code object of a compressed bundle is allocated and owned by the caller
+  static bool extract(const void* image,          //!< The bundle image
+                      size_t size,                //!< The bundle size
+                      const amd::Isa& isa,        //!< The ISA of the device
+                      const uint8_t** codeObject, //!< The code object of the ISA
+                      size_t* codeObjectSize,     //!< The code object size
+                      bool* allocated             //!< The code object was allocated
+  );
+};
+
+}  // namespace device
@@ -0,0 +1,234 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/devcodecache.hpp"
+#include "os/os.hpp"
+#include "utils/debug.hpp"
+#include "utils/flags.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+namespace device {
+
+amd::Monitor CodeCache::lock_("Code cache lock");
+std::string CodeCache::path_;
+bool CodeCache::initialized_ = false;
+bool CodeCache::available_ = false;
+
+//! The extension of the cache entries
+static constexpr const char* kEntryExt = ".bin";
+//! The extension of the temporary files, which are renamed into the entries
+static constexpr const char* kTempExt = ".tmp";
+//! Temporary files older than the limit (in seconds) are leftovers of the crashed processes
+static constexpr uint64_t kStaleTempAge = 3600;
+
+// ================================================================================================
+static bool hasExtension(const std::string& name, const char* ext) {
+  const size_t len = strlen(ext);
+  return (name.size() > len) && (name.compare(name.size() - len, len, ext) == 0);
+}
+
+// ================================================================================================
+CodeCache::Key& CodeCache::Key::add(const void* data, size_t size) {
+  // Hash the size first, so the components can't shift into each other
+  const uint64_t length = size;
+  const uint8_t* lengthBytes = reinterpret_cast<const uint8_t*>(&length);
+  for (size_t i = 0; i < sizeof(length); ++i) {
+    low_ = (low_ ^ lengthBytes[i]) * kPrime;
+    high_ = (high_ ^ lengthBytes[i]) * kPrime;
+  }
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    low_ = (low_ ^ bytes[i]) * kPrime;
+    // The high half mixes the position in, so it doesn't repeat the low half
+    high_ = (high_ ^ bytes[i] ^ (i & 0xff)) * kPrime;
+  }
+  return *this;
+}
+
+// ================================================================================================
+std::string CodeCache::Key::str() const {
+  std::ostringstream str;
+  str << std::hex;
+  str.fill('0');
+  str.width(16);
+  str << high_;
+  str.width(16);
+  str << low_;
+  return str.str();
+}
+
+// ================================================================================================
+bool CodeCache::enabled(bool internal) {
+  if (!OCL_CODE_CACHE_ENABLE && !(internal && GPU_BLIT_CODE_CACHE)) {
+    return false;
+  }
+  amd::ScopedLock lock(lock_);
+  if (!initialized_) {
+    initialized_ = true;
+    available_ = init();
+  }
+  return available_;
+}
+
+// ================================================================================================
+bool CodeCache::init() {
+  path_ = OCL_CODE_CACHE_PATH;
+  if (path_.empty()) {
+    path_ = amd::Os::getTempPath() + amd::Os::fileSeparator() + "amd_code_cache";
+  }
+  if (!amd::Os::pathExists(path_) && !amd::Os::createPath(path_)) {
+    LogPrintfWarning("Code cache is disabled, can't create the path: %s", path_.c_str());
+    return false;
+  }
+
+  if (OCL_CODE_CACHE_RESET) {
+    std::vector<amd::Os::FileInfo> files;
+    amd::Os::listFiles(path_, &files);
+    for (const auto& file : files) {
+      if (hasExtension(file.name_, kEntryExt)) {
+        amd::Os::unlink(path_ + amd::Os::fileSeparator() + file.name_);
+      }
+    }
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_CODE, "Code cache path: %s", path_.c_str());
+  return true;
+}
+
+// ================================================================================================
+std::string CodeCache::fileName(const std::string& key) {
+  return path_ + amd::Os::fileSeparator() + key + kEntryExt;
+}
+
+// ================================================================================================
+bool CodeCache::find(const std::string& key, std::string* executable) {
+  const std::string name = fileName(key);
+  std::ifstream file(name, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  Header header = {};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  bool valid = file.good() && (header.magic_ == kMagic) && (header.version_ == kVersion);
+  if (valid) {
+    executable->resize(header.size_);
+    file.read(&(*executable)[0], header.size_);
+    Key checksum;
+    checksum.add(executable->data(), executable->size());
+    valid = file.good() && (std::hash<std::string>()(checksum.str()) == header.checksum_);
+  }
+  file.close();
+
+  if (!valid) {
+    // The entry is corrupted, so remove it and let the caller rebuild the program
+    LogPrintfWarning("Code cache entry is corrupted: %s", name.c_str());
+    amd::Os::unlink(name);
+    executable->clear();
+    return false;
+  }
+
+  // Mark the entry as the most recently used
+  amd::Os::touchFile(name);
+  ClPrint(amd::LOG_INFO, amd::LOG_CODE, "Code cache hit: %s", key.c_str());
+  return true;
+}
+
+// ================================================================================================
+void CodeCache::insert(const std::string& key, const void* executable, size_t size) {
+  Key checksum;
+  checksum.add(executable, size);
+  Header header = {kMagic, kVersion, size, std::hash<std::string>()(checksum.str())};
+
+  // Each writer uses an unique temporary file, so the concurrent processes don't collide
+  std::ostringstream tempName;
+  tempName << path_ << amd::Os::fileSeparator() << key << '.' << std::hex
+           << amd::Os::timeNanos() << '.' << std::hash<std::thread::id>()(std::this_thread::get_id())
+           << kTempExt;
+
+  std::ofstream file(tempName.str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    return;
+  }
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(executable), size);
+  file.close();
+
+  // The rename atomically publishes the complete entry
+  if (file.fail() || !amd::Os::renameFile(tempName.str(), fileName(key))) {
+    LogPrintfWarning("Code cache failed to store the entry: %s", key.c_str());
+    amd::Os::unlink(tempName.str());
+    return;
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_CODE, "Code cache stored: %s, %zu bytes", key.c_str(), size);
+
+  evict();
+}
+
+// ================================================================================================
+void CodeCache::evict() {
+  // Serialize the eviction in the process. The other processes can remove the same files,
+  // but unlink of a missing file is harmless
+  amd::ScopedLock lock(lock_);
+  std::vector<amd::Os::FileInfo> files;
+  if (!amd::Os::listFiles(path_, &files)) {
+    return;
+  }
+
+  const uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+  std::vector<amd::Os::FileInfo> entries;
+  uint64_t total = 0;
+  for (const auto& file : files) {
+    if (hasExtension(file.name_, kEntryExt)) {
+      total += file.size_;
+      entries.push_back(file);
+    } else if (hasExtension(file.name_, kTempExt) && (file.time_ + kStaleTempAge < now)) {
+      amd::Os::unlink(path_ + amd::Os::fileSeparator() + file.name_);
+    }
+  }
+
+  const uint64_t budget = static_cast<uint64_t>(OCL_CODE_CACHE_SIZE) * Mi;
+  if (total <= budget) {
+    return;
+  }
+
+  // Remove the least recently used entries first
+  std::sort(entries.begin(), entries.end(),
+            [](const amd::Os::FileInfo& a, const amd::Os::FileInfo& b) {
+              return a.time_ < b.time_;
+            });
+  for (const auto& entry : entries) {
+    if (total <= budget) {
+      break;
+    }
+    if (amd::Os::unlink(path_ + amd::Os::fileSeparator() + entry.name_) == 0) {
+      ClPrint(amd::LOG_INFO, amd::LOG_CODE, "Code cache evicted: %s", entry.name_.c_str());
+    }
+    total -= entry.size_;
+  }
+}
+
+}  // namespace device
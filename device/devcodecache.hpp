@@ -0,0 +1,96 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+#include "thread/monitor.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace device {
+
+//! Persistent on-disk cache of the executables, built from the sources with the LC path.
+//! The entries are content addressed files, which are shared between processes.
+//! A new entry is written into a temporary file and renamed, so readers never see
+//! a partial file. The least recently used entries are evicted over the size budget.
+class CodeCache : public amd::AllStatic {
+ public:
+  //! Builds the content address from all inputs, which affect the executable
+  class Key {
+   public:
+    Key() : low_(kOffsetBasis), high_(kOffsetBasis ^ kSeed) {}
+
+    //! Adds the next component of the key
+    Key& add(const void* data, size_t size);
+    Key& add(const std::string& str) { return add(str.data(), str.size()); }
+
+    //! Returns the hex string of the key
+    std::string str() const;
+
+   private:
+    static constexpr uint64_t kOffsetBasis = 0xcbf29ce484222325ULL;
+    static constexpr uint64_t kPrime = 0x100000001b3ULL;
+    static constexpr uint64_t kSeed = 0x9e3779b97f4a7c15ULL;
+
+    uint64_t low_;   //!< Low half of the 128 bit hash
+    uint64_t high_;  //!< High half of the 128 bit hash
+  };
+
+  //! Returns TRUE if the cache is enabled and the storage is available.
+  //! The internal runtime kernels can use the cache, even if it's disabled for the apps
+  static bool enabled(bool internal = false);
+
+  //! Finds the executable for the key. Returns TRUE on a cache hit
+  static bool find(const std::string& key, std::string* executable);
+
+  //! Stores the executable for the key and evicts the old entries over the budget
+  static void insert(const std::string& key, const void* executable, size_t size);
+
+ private:
+  //! The header of each cache entry, followed by the executable
+  struct Header {
+    uint32_t magic_;     //!< Cache entry signature
+    uint32_t version_;   //!< Cache format version
+    uint64_t size_;      //!< The executable size in bytes
+    uint64_t checksum_;  //!< The executable checksum for corruption detection
+  };
+
+  static constexpr uint32_t kMagic = 0x45444f43;  //!< "CODE"
+  static constexpr uint32_t kVersion = 1;
+
+  //! Initializes the cache storage on the first use
+  static bool init();
+
+  //! Returns the file name of the cache entry for the key
+  static std::string fileName(const std::string& key);
+
+  //! Removes the least recently used entries, if the cache exceeded the budget
+  static void evict();
+
+  static amd::Monitor lock_;   //!< Lock for the cache initialization and eviction
+  static std::string path_;    //!< The cache directory
+  static bool initialized_;    //!< The storage initialization was attempted
+  static bool available_;      //!< The storage is available
+};
+
+}  // namespace device
@@ -24,6 +24,7 @@
 
 #include "devhcmessages.hpp"
 
+#include <cstdio>
 #include <vector>
 
 enum {
@@ -133,7 +134,7 @@ void MessageHandler::discardMessage(Message* message) {
 }
 
 // Defined in devhcprintf.cpp
-void handlePrintf(uint64_t* output, const uint64_t* input, uint64_t len);
+void handlePrintf(uint64_t* output, const uint64_t* input, uint64_t len, std::string* streams);
 
 bool MessageHandler::handlePayload(uint32_t service, uint64_t* payload) {
   Message* message = nullptr;
@@ -166,7 +167,7 @@ bool MessageHandler::handlePayload(uint32_t service, uint64_t* payload) {
 
   switch (service) {
     case SERVICE_PRINTF:
-      handlePrintf(payload, message->data_.data(), message->data_.size());
+      handlePrintf(payload, message->data_.data(), message->data_.size(), output_);
       break;
     default:
       ClPrint(amd::LOG_ERROR, amd::LOG_ALWAYS, "Hostcall: Messages not supported for service %d",
@@ -176,3 +177,15 @@ bool MessageHandler::handlePayload(uint32_t service, uint64_t* payload) {
   discardMessage(message);
   return true;
 }
+
+void MessageHandler::flush() {
+  FILE* const streams[] = {stdout, stderr};
+  for (uint32_t i = 0; i < 2; ++i) {
+    if (!output_[i].empty()) {
+      // A single write keeps the lines of all work-items together and locks the stream once
+      fwrite(output_[i].data(), 1, output_[i].size(), streams[i]);
+      fflush(streams[i]);
+      output_[i].clear();
+    }
+  }
+}
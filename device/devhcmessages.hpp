@@ -64,6 +64,7 @@
 
 #pragma once
 
+#include <string>
 #include <vector>
 
 enum ServiceID {
@@ -83,6 +84,8 @@ struct Message;
 class MessageHandler {
   std::vector<uint64_t> freeSlots_;
   std::vector<Message*> messageSlots_;
+  //! The printf output for stdout and stderr, which is written once per processing pass
+  std::string output_[2];
 
   Message* newMessage();
   Message* getMessage(uint64_t desc);
@@ -91,4 +94,6 @@ class MessageHandler {
  public:
   ~MessageHandler();
   bool handlePayload(uint32_t service, uint64_t* payload);
+  //! Writes the accumulated output of all messages, handled in the current pass
+  void flush();
 };
@@ -21,19 +21,40 @@
 /** \file Format string processing for printf based on hostcall messages.
  */
 
+#include <algorithm>
 #include <assert.h>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
 #include <string>
 
-static void checkPrintf(FILE* stream, int* outCount, const char* fmt, ...) {
+//! Formats into the output of the stream, which is written once for all ready messages
+static void checkPrintf(std::string* stream, int* outCount, const char* fmt, ...) {
+  char local[256];
   va_list args;
   va_start(args, fmt);
-  int retval = vfprintf(stream, fmt, args);
+  int retval = vsnprintf(local, sizeof(local), fmt, args);
+  va_end(args);
+  if ((retval >= 0) && (static_cast<size_t>(retval) >= sizeof(local))) {
+    // The output doesn't fit, so format straight into the stream buffer
+    const size_t size = stream->size();
+    stream->resize(size + retval + 1);
+    va_start(args, fmt);
+    retval = vsnprintf(&(*stream)[size], retval + 1, fmt, args);
+    va_end(args);
+    stream->resize(size + std::max(retval, 0));
+  } else if (retval > 0) {
+    stream->append(local, retval);
+  }
   *outCount = retval < 0 ? retval : *outCount + retval;
 }
 
+//! Appends the literal part of the format string without the format processing
+static void appendLiteral(std::string* stream, int* outCount, const char* str, size_t len) {
+  stream->append(str, len);
+  *outCount += static_cast<int>(len);
+}
+
 static int countStars(const std::string& spec) {
   int stars = 0;
   for (auto c : spec) {
@@ -45,14 +66,14 @@ static int countStars(const std::string& spec) {
 }
 
 template <typename... Args>
-static const uint64_t* consumeInteger(FILE* stream, int* outCount, const std::string& spec,
+static const uint64_t* consumeInteger(std::string* stream, int* outCount, const std::string& spec,
                                       const uint64_t* ptr, Args... args) {
   checkPrintf(stream, outCount, spec.c_str(), args..., ptr[0]);
   return ptr + 1;
 }
 
 template <typename... Args>
-static const uint64_t* consumeFloatingPoint(FILE* stream, int* outCount, const std::string& spec,
+static const uint64_t* consumeFloatingPoint(std::string* stream, int* outCount, const std::string& spec,
                                             const uint64_t* ptr, Args... args) {
   double d;
   memcpy(&d, ptr, 8);
@@ -61,7 +82,7 @@ static const uint64_t* consumeFloatingPoint(FILE* stream, int* outCount, const s
 }
 
 template <typename... Args>
-static const uint64_t* consumeCstring(FILE* stream, int* outCount, const std::string& spec,
+static const uint64_t* consumeCstring(std::string* stream, int* outCount, const std::string& spec,
                                       const uint64_t* ptr, Args... args) {
   auto str = reinterpret_cast<const char*>(ptr);
   auto old = *outCount;
@@ -71,7 +92,7 @@ static const uint64_t* consumeCstring(FILE* stream, int* outCount, const std::st
 }
 
 template <typename... Args>
-static const uint64_t* consumePointer(FILE* stream, int* outCount, const std::string& spec,
+static const uint64_t* consumePointer(std::string* stream, int* outCount, const std::string& spec,
                                       const uint64_t* ptr, Args... args) {
   auto vptr = reinterpret_cast<void*>(*ptr);
   checkPrintf(stream, outCount, spec.c_str(), args..., vptr);
@@ -79,7 +100,7 @@ static const uint64_t* consumePointer(FILE* stream, int* outCount, const std::st
 }
 
 template <typename... Args>
-static const uint64_t* consumeArgument(FILE* stream, int* outCount, const std::string& spec,
+static const uint64_t* consumeArgument(std::string* stream, int* outCount, const std::string& spec,
                                        const uint64_t* ptr, const uint64_t* end, Args... args) {
   switch (spec.back()) {
     case 'd':
@@ -111,7 +132,7 @@ static const uint64_t* consumeArgument(FILE* stream, int* outCount, const std::s
   return end;
 }
 
-static const uint64_t* processSpec(FILE* stream, int* outCount, const std::string& spec,
+static const uint64_t* processSpec(std::string* stream, int* outCount, const std::string& spec,
                                    const uint64_t* ptr, const uint64_t* end) {
   auto stars = countStars(spec);
   assert(stars < 3 && "cannot have more than two placeholders");
@@ -161,7 +182,7 @@ static const uint64_t* processSpec(FILE* stream, int* outCount, const std::strin
  * - Behaviour is undefined with wide characters and strings.
  * - %n specifier is ignored and the corresponding argument is skipped.
  */
-static int format(FILE* stream, const uint64_t* begin, const uint64_t* end) {
+static int format(std::string* stream, const uint64_t* begin, const uint64_t* end) {
   const char convSpecifiers[] = "diouxXfFeEgGaAcspn";
   auto ptr = begin;
 
@@ -180,23 +201,17 @@ static int format(FILE* stream, const uint64_t* begin, const uint64_t* end) {
     // 1. When the point reaches the end of the format string.
     // 2. When the point is at the start of a format specifier.
     if (point == std::string::npos) {
-      checkPrintf(stream, &outCount, "%s", &fmt[mark]);
-      return outCount;
-    }
-    checkPrintf(stream, &outCount, "%.*s", (int)(point - mark), &fmt[mark]);
-    if (outCount < 0) {
+      appendLiteral(stream, &outCount, &fmt[mark], fmt.length() - mark);
       return outCount;
     }
+    appendLiteral(stream, &outCount, &fmt[mark], point - mark);
 
     mark = point;
     ++point;
 
     // Handle the simplest specifier, '%%'.
     if (fmt[point] == '%') {
-      checkPrintf(stream, &outCount, "%%");
-      if (outCount < 0) {
-        return outCount;
-      }
+      appendLiteral(stream, &outCount, "%", 1);
       ++point;
       continue;
     }
@@ -223,10 +238,10 @@ static int format(FILE* stream, const uint64_t* begin, const uint64_t* end) {
   }
 }
 
-void handlePrintf(uint64_t* output, const uint64_t* input, uint64_t len) {
+void handlePrintf(uint64_t* output, const uint64_t* input, uint64_t len, std::string* streams) {
   auto end = input + len;
   auto control = *input++;
-  FILE* stream = stdout;
+  std::string* stream = &streams[0];
 
   // Only the LSB in the control word is used.
   uint64_t CTRL_MASK = 1;
@@ -238,7 +253,7 @@ void handlePrintf(uint64_t* output, const uint64_t* input, uint64_t len) {
 
   // Output goes to stderr if LSB is set.
   if (control & CTRL_MASK) {
-    stream = stderr;
+    stream = &streams[1];
   }
 
   *output = format(stream, input, end);
@@ -32,9 +32,13 @@
 #include "utils/debug.hpp"
 #include "utils/flags.hpp"
 
+#include <algorithm>
 #include <assert.h>
 #include <string.h>
+#include <map>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #if defined(__clang__)
 #if __has_feature(address_sanitizer)
@@ -71,6 +75,121 @@ static uint32_t resetReadyFlag(uint32_t control) {
  */
 typedef void (*HostcallFunctionCall)(uint64_t* output, const uint64_t* input);
 
+//! The smallest block of the device memory heap is 16 bytes
+static constexpr uint kDevMemMinClass = 4;
+//! The biggest block of the device memory heap is 64 KiB
+static constexpr uint kDevMemMaxClass = 16;
+//! The heap carves the free blocks of a size class in batches of this size
+static constexpr uint64_t kDevMemRefillSize = 256 * Ki;
+
+/** \brief Heap for the small allocations of the devmem service.
+ *
+ *  The blocks are carved in bulk from the large buffers, so most of the
+ *  requests are served from the free lists without a new memory object or
+ *  a memory object map update. Each block size is a power of two. The freed
+ *  blocks are reused for the same size class, and the chunks stay allocated
+ *  for the lifetime of the device.
+ */
+class DevMemHeap {
+ public:
+  explicit DevMemHeap(const amd::Device& dev)
+      : dev_(dev), lock_("Device memory heap lock"), top_(0), end_(0) {}
+
+  //! Returns the device address of the block, or 0 if the size can't be served from the heap
+  uint64_t alloc(size_t size);
+
+  //! Returns true if the address is a heap block, which was freed
+  bool free(uint64_t va);
+
+ private:
+  //! Allocates a new chunk for the heap
+  bool grow(uint64_t blockSize);
+
+  const amd::Device& dev_;                      //!< The device of the heap
+  amd::Monitor lock_;                           //!< The lock for the listener threads
+  uint64_t top_;                                //!< The first unused address of the chunk
+  uint64_t end_;                                //!< The end address of the chunk
+  std::vector<uint64_t> free_[kDevMemMaxClass - kDevMemMinClass + 1];  //!< Free blocks
+  std::unordered_map<uint64_t, uint> blocks_;   //!< The size class of each allocated block
+};
+
+bool DevMemHeap::grow(uint64_t blockSize) {
+  const size_t chunkSize = static_cast<size_t>(AMD_DEVMEM_HEAP_CHUNK) * Mi;
+  if (chunkSize < blockSize) {
+    return false;
+  }
+  amd::Context& ctx = dev_.context();
+  amd::Buffer* chunk = new (ctx) amd::Buffer(ctx, CL_MEM_READ_WRITE, chunkSize);
+  if ((chunk == nullptr) || !chunk->create()) {
+    if (chunk != nullptr) {
+      chunk->release();
+    }
+    return false;
+  }
+  top_ = chunk->getDeviceMemory(dev_)->virtualAddress();
+  end_ = top_ + chunkSize;
+  // The kernel arguments with the heap pointers resolve to the chunk
+  amd::MemObjMap::AddMemObj(reinterpret_cast<void*>(top_), chunk);
+  ClPrint(amd::LOG_INFO, amd::LOG_MEM, "Hostcall: device memory heap chunk of %zu bytes at %p",
+          chunkSize, reinterpret_cast<void*>(top_));
+  return true;
+}
+
+uint64_t DevMemHeap::alloc(size_t size) {
+  if ((size == 0) || (size > (static_cast<size_t>(1) << kDevMemMaxClass))) {
+    return 0;
+  }
+  const uint sizeClass = std::max(amd::log2(amd::nextPowerOfTwo(size)), kDevMemMinClass);
+  const uint64_t blockSize = static_cast<uint64_t>(1) << sizeClass;
+  std::vector<uint64_t>& blocks = free_[sizeClass - kDevMemMinClass];
+
+  amd::ScopedLock lock(lock_);
+  if (blocks.empty()) {
+    // The blocks are naturally aligned. The tail of the old chunk is abandoned on the growth
+    top_ = amd::alignUp(top_, blockSize);
+    if (((top_ + blockSize) > end_) && !grow(blockSize)) {
+      return 0;
+    }
+    const uint64_t count =
+        std::max<uint64_t>(std::min(kDevMemRefillSize, end_ - top_) / blockSize, 1);
+    for (uint64_t i = count; i > 0; --i) {
+      blocks.push_back(top_ + (i - 1) * blockSize);
+    }
+    top_ += count * blockSize;
+  }
+  const uint64_t va = blocks.back();
+  blocks.pop_back();
+  blocks_[va] = sizeClass;
+  return va;
+}
+
+bool DevMemHeap::free(uint64_t va) {
+  amd::ScopedLock lock(lock_);
+  auto it = blocks_.find(va);
+  if (it == blocks_.end()) {
+    return false;
+  }
+  free_[it->second - kDevMemMinClass].push_back(va);
+  blocks_.erase(it);
+  return true;
+}
+
+//! The device memory heaps, created on the first devmem request of each device
+static std::map<const amd::Device*, DevMemHeap*> devMemHeaps;
+static amd::Monitor devMemHeapsLock("Device memory heaps lock");
+
+static DevMemHeap* getDevMemHeap(const amd::Device& dev) {
+  if (AMD_DEVMEM_HEAP_CHUNK == 0) {
+    return nullptr;
+  }
+  amd::ScopedLock lock(devMemHeapsLock);
+  DevMemHeap*& heap = devMemHeaps[&dev];
+  if (heap == nullptr) {
+    heap = new DevMemHeap(dev);
+  }
+  return heap;
+}
+
 static void handlePayload(MessageHandler& messages, uint32_t service, uint64_t* payload, const amd::Device &dev) {
   switch (service) {
     case SERVICE_FUNCTION_CALL: {
@@ -88,7 +207,11 @@ static void handlePayload(MessageHandler& messages, uint32_t service, uint64_t*
       }
       return;
     case SERVICE_DEVMEM: {
+      DevMemHeap* heap = getDevMemHeap(dev);
       if (payload[0]) {
+        if ((heap != nullptr) && heap->free(payload[0])) {
+          return;
+        }
         amd::Memory* mem = amd::MemObjMap::FindMemObj(reinterpret_cast<void*>(payload[0]));
         if (mem) {
           amd::MemObjMap::RemoveMemObj(reinterpret_cast<void*>(payload[0]));
@@ -97,6 +220,12 @@ static void handlePayload(MessageHandler& messages, uint32_t service, uint64_t*
           ClPrint(amd::LOG_ERROR, amd::LOG_ALWAYS, "Hostcall: Unknown pointer in devmem service\n");
         }
       } else {
+        if (heap != nullptr) {
+          payload[0] = heap->alloc(payload[1]);
+          if (payload[0] != 0) {
+            return;
+          }
+        }
         amd::Context& ctx = dev.context();
         amd::Buffer* buf = new(ctx) amd::Buffer(ctx, CL_MEM_READ_WRITE, payload[1]);
         uint64_t va = 0;
@@ -219,6 +348,8 @@ void HostcallBuffer::initialize(uint32_t num_packets) {
  */
 class HostcallListener {
   std::set<HostcallBuffer*> buffers_;
+  amd::Monitor lock_;  //!< Serializes the buffers update with the packets processing
+  int numaNode_;       //!< The NUMA node of the listener thread
   device::Signal* doorbell_;
   MessageHandler messages_;
 #if defined(__clang__)
@@ -240,6 +371,8 @@ class HostcallListener {
   void consumePackets();
 
  public:
+  HostcallListener() : lock_("Hostcall listener buffers lock"), numaNode_(-1) {}
+
   /** \brief Add a buffer to the listener.
    *
    *  Behaviour is undefined if:
@@ -263,11 +396,29 @@ class HostcallListener {
     return buffers_.empty();
   }
 
+  /* \brief Return true if the buffer is registered with the listener.
+  */
+  bool hasBuffer(HostcallBuffer* buffer) {
+    amd::ScopedLock lock{lock_};
+    return buffers_.count(buffer) != 0;
+  }
+
+  /* \brief Return the number of registered buffers.
+  */
+  size_t numBuffers() const {
+    return buffers_.size();
+  }
+
+  /* \brief Return the NUMA node of the listener thread or -1.
+  */
+  int numaNode() const { return numaNode_; }
+
   void terminate();
   bool initialize(const amd::Device &dev);
 };
 
-HostcallListener* hostcallListener = nullptr;
+//! The pool of the hostcall listeners, each with a distinct set of buffers
+std::vector<HostcallListener*> hostcallListeners;
 amd::Monitor listenerLock("Hostcall listener lock");
 
 void HostcallListener::consumePackets() {
@@ -286,11 +437,18 @@ void HostcallListener::consumePackets() {
       return;
     }
 
-    amd::ScopedLock lock{listenerLock};
+    // Only this listener's buffers are locked, so the other listeners and
+    // the buffers registration don't wait for the packets processing
+    amd::ScopedLock lock{lock_};
 
     for (auto ii : buffers_) {
-      ii->processPackets(messages_);
+      // Skip the buffers without the new packets, so the idle queues don't add latency
+      if (ii->isReady()) {
+        ii->processPackets(messages_);
+      }
     }
+    // The printf output of all buffers in the pass is written at once
+    messages_.flush();
   }
 
   return;
@@ -318,6 +476,7 @@ void HostcallListener::terminate() {
 }
 
 void HostcallListener::addBuffer(HostcallBuffer* buffer) {
+  amd::ScopedLock lock{lock_};
   assert(buffers_.count(buffer) == 0 && "buffer already present");
   buffer->setDoorbell(doorbell_->getHandle());
 #if defined(__clang__)
@@ -329,6 +488,8 @@ void HostcallListener::addBuffer(HostcallBuffer* buffer) {
 }
 
 void HostcallListener::removeBuffer(HostcallBuffer* buffer) {
+  // The lock guarantees the listener doesn't access the buffer after the removal
+  amd::ScopedLock lock{lock_};
   assert(buffers_.count(buffer) != 0 && "unknown buffer");
   buffers_.erase(buffer);
 }
@@ -362,6 +523,8 @@ bool HostcallListener::initialize(const amd::Device &dev) {
     return false;
   }
 
+  // The listener reads the buffers in the host memory, which is close to the device
+  numaNode_ = dev.setNumaAffinity(thread_) ? dev.numaNode() : -1;
   thread_.start(this);
   return true;
 }
@@ -372,37 +535,64 @@ bool enableHostcalls(const amd::Device &dev, void* bfr, uint32_t numPackets) {
   buffer->setDevice(&dev);
 
   amd::ScopedLock lock(listenerLock);
-  if (!hostcallListener) {
-    hostcallListener = new HostcallListener();
-    if (!hostcallListener->initialize(dev)) {
+  // Pick the least loaded listener on the NUMA node of the device
+  const int numaNode = (AMD_NUMA_AFFINITY && !AMD_CPU_AFFINITY) ? dev.numaNode() : -1;
+  HostcallListener* listener = nullptr;
+  size_t numListeners = 0;
+  for (auto it : hostcallListeners) {
+    if (it->numaNode() != numaNode) {
+      continue;
+    }
+    ++numListeners;
+    if ((listener == nullptr) || (it->numBuffers() < listener->numBuffers())) {
+      listener = it;
+    }
+  }
+  // Launch a new listener if all listeners are busy and the pool can grow
+  if ((listener == nullptr) ||
+      (!listener->idle() && (numListeners < std::max(AMD_HOSTCALL_LISTENERS, 1u)))) {
+    auto newListener = new HostcallListener();
+    if (!newListener->initialize(dev)) {
       ClPrint(amd::LOG_ERROR, (amd::LOG_INIT | amd::LOG_QUEUE | amd::LOG_RESOURCE),
               "Failed to launch hostcall listener");
-      delete hostcallListener;
-      hostcallListener = nullptr;
-      return false;
+      delete newListener;
+      // The existing listeners can still service the buffer
+      if (listener == nullptr) {
+        return false;
+      }
+    } else {
+      ClPrint(amd::LOG_INFO, (amd::LOG_INIT | amd::LOG_QUEUE | amd::LOG_RESOURCE),
+              "Launched hostcall listener at %p", newListener);
+      hostcallListeners.push_back(newListener);
+      listener = newListener;
     }
-    ClPrint(amd::LOG_INFO, (amd::LOG_INIT | amd::LOG_QUEUE | amd::LOG_RESOURCE),
-            "Launched hostcall listener at %p", hostcallListener);
   }
-  hostcallListener->addBuffer(buffer);
+  listener->addBuffer(buffer);
   ClPrint(amd::LOG_INFO, amd::LOG_QUEUE, "Registered hostcall buffer %p with listener %p", buffer,
-          hostcallListener);
+          listener);
   return true;
 }
 
 void disableHostcalls(void* bfr) {
   amd::ScopedLock lock(listenerLock);
-  if (!hostcallListener) {
+  if (hostcallListeners.empty()) {
     return;
   }
   assert(bfr && "expected a hostcall buffer");
   auto buffer = reinterpret_cast<HostcallBuffer*>(bfr);
-  hostcallListener->removeBuffer(buffer);
+  for (auto it = hostcallListeners.begin(); it != hostcallListeners.end(); ++it) {
+    HostcallListener* listener = *it;
+    if (!listener->hasBuffer(buffer)) {
+      continue;
+    }
+    listener->removeBuffer(buffer);
 
-  if (hostcallListener->idle()) {
-    hostcallListener->terminate();
-    delete hostcallListener;
-    hostcallListener = nullptr;
-    ClPrint(amd::LOG_INFO, amd::LOG_INIT, "Terminated hostcall listener");
+    if (listener->idle()) {
+      listener->terminate();
+      delete listener;
+      hostcallListeners.erase(it);
+      ClPrint(amd::LOG_INFO, amd::LOG_INIT, "Terminated hostcall listener");
+    }
+    return;
   }
 }
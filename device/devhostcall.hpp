@@ -68,7 +68,9 @@
  *  A single listener is sufficient to correctly handle all hostcall
  *  buffers created in the application. The client may also launch
  *  multiple listeners, as long the same hostcall buffer is not
- *  registered with multiple listeners.
+ *  registered with multiple listeners. The runtime grows a pool of up to
+ *  AMD_HOSTCALL_LISTENERS listeners with the number of registered buffers,
+ *  and each listener services only the buffers with ready packets.
  */
 
 /** \brief Determine the buffer size to be allocated
@@ -160,6 +162,8 @@ class HostcallBuffer {
  public:
   void processPackets(MessageHandler& messages);
   void initialize(uint32_t num_packets);
+  //! Returns true if the device pushed packets, which weren't processed yet
+  bool isReady() const { return ready_stack_.load(std::memory_order_relaxed) != 0; }
   void setDoorbell(void* doorbell) { doorbell_ = doorbell; };
   void setDevice(const amd::Device* dptr) { device_ = dptr; };
 
@@ -19,6 +19,7 @@
  THE SOFTWARE. */
 
 #include "device/device.hpp"
+#include "device/devtuning.hpp"
 #include "thread/monitor.hpp"
 #include "utils/options.hpp"
 #include "comgrctx.hpp"
@@ -267,18 +268,16 @@ Context* Device::glb_ctx_ = nullptr;
 Monitor Device::p2p_stage_ops_("P2P Staging Lock", true);
 Memory* Device::p2p_stage_ = nullptr;
 
-Monitor MemObjMap::AllocatedLock_ ROCCLR_INIT_PRIORITY(101) ("Guards MemObjMap allocation list");
-std::map<uintptr_t, amd::Memory*> MemObjMap::MemObjMap_ ROCCLR_INIT_PRIORITY(101);
+ConcurrentRangeIndex<amd::Memory> MemObjMap::index_ ROCCLR_INIT_PRIORITY(101) (
+    "Guards MemObjMap allocation list");
 
-size_t MemObjMap::size() {
-  amd::ScopedLock lock(AllocatedLock_);
-  return MemObjMap_.size();
-}
+std::atomic<uint64_t> MemObjMap::generation_(0);
+
+size_t MemObjMap::size() { return index_.size(); }
 
 void MemObjMap::AddMemObj(const void* k, amd::Memory* v) {
-  amd::ScopedLock lock(AllocatedLock_);
-  auto rval = MemObjMap_.insert({ reinterpret_cast<uintptr_t>(k), v });
-  if (!rval.second) {
+  uintptr_t key = reinterpret_cast<uintptr_t>(k);
+  if (!index_.insert(key, key + v->getSize(), v)) {
     DevLogPrintfError("Memobj map already has an entry for ptr: 0x%x",
                       reinterpret_cast<uintptr_t>(k));
     guarantee(false, "Memobj map already has an entry for ptr");
@@ -286,9 +285,9 @@ void MemObjMap::AddMemObj(const void* k, amd::Memory* v) {
 }
 
 void MemObjMap::RemoveMemObj(const void* k) {
-  amd::ScopedLock lock(AllocatedLock_);
-  auto rval = MemObjMap_.erase(reinterpret_cast<uintptr_t>(k));
-  if (rval != 1) {
+  // Invalidate the cached lookups before the object can be destroyed
+  generation_.fetch_add(1, std::memory_order_acq_rel);
+  if (index_.erase(reinterpret_cast<uintptr_t>(k)) == nullptr) {
     DevLogPrintfError("Memobj map does not have ptr: 0x%x",
                       reinterpret_cast<uintptr_t>(k));
     guarantee(false, "Memobj map does not have ptr");
@@ -296,21 +295,7 @@ void MemObjMap::RemoveMemObj(const void* k) {
 }
 
 amd::Memory* MemObjMap::FindMemObj(const void* k) {
-  amd::ScopedLock lock(AllocatedLock_);
-  uintptr_t key = reinterpret_cast<uintptr_t>(k);
-  auto it = MemObjMap_.upper_bound(key);
-  if (it == MemObjMap_.begin()) {
-    return nullptr;
-  }
-
-  --it;
-  amd::Memory* mem = it->second;
-  if (key >= it->first && key < (it->first + mem->getSize())) {
-    // the k is in the range
-    return mem;
-  } else {
-    return nullptr;
-  }
+  return index_.find(reinterpret_cast<uintptr_t>(k));
 }
 
 void MemObjMap::UpdateAccess(amd::Device *peerDev) {
@@ -320,33 +305,53 @@ void MemObjMap::UpdateAccess(amd::Device *peerDev) {
 
   // Provides access to all memory allocated on peerDev but
   // hsa_amd_agents_allow_access was not called because there was no peer
-  amd::ScopedLock lock(AllocatedLock_);
-  for (auto it : MemObjMap_) {
-    const std::vector<Device*>& devices = it.second->getContext().devices();
+  index_.forEach([peerDev](const ConcurrentRangeIndex<amd::Memory>::Range& range) {
+    const std::vector<Device*>& devices = range.value_->getContext().devices();
     if (devices.size() == 1 && devices[0] == peerDev) {
-      device::Memory* devMem = it.second->getDeviceMemory(*devices[0]);
+      device::Memory* devMem = range.value_->getDeviceMemory(*devices[0]);
       if (!devMem->getAllowedPeerAccess()) {
-        peerDev->deviceAllowAccess(reinterpret_cast<void*>(it.first));
+        peerDev->deviceAllowAccess(reinterpret_cast<void*>(range.start_));
         devMem->setAllowedPeerAccess(true);
       }
     }
-  }
+  });
 }
 
 void MemObjMap::Purge(amd::Device* dev) {
   assert(dev != nullptr);
 
-  amd::ScopedLock lock(AllocatedLock_);
-  for (auto it = MemObjMap_.cbegin(); it != MemObjMap_.cend(); ) {
-    amd::Memory* memObj = it->second;
+  generation_.fetch_add(1, std::memory_order_acq_rel);
+  index_.removeIf([dev](const ConcurrentRangeIndex<amd::Memory>::Range& range) {
+    amd::Memory* memObj = range.value_;
     unsigned int flags = memObj->getMemFlags();
     const std::vector<Device*>& devices = memObj->getContext().devices();
-    if (devices.size() == 1 && devices[0] == dev && !(flags & ROCCLR_MEM_INTERNAL_MEMORY)) {
-      it = MemObjMap_.erase(it);
+    return devices.size() == 1 && devices[0] == dev && !(flags & ROCCLR_MEM_INTERNAL_MEMORY);
+  });
+}
+
+void CoalesceSvmRanges(std::vector<SvmRange>* ranges) {
+  if (ranges->size() < 2) {
+    return;
+  }
+  std::sort(ranges->begin(), ranges->end(), [](const SvmRange& a, const SvmRange& b) {
+    return a.ptr_ < b.ptr_;
+  });
+  size_t last = 0;
+  for (size_t i = 1; i < ranges->size(); ++i) {
+    SvmRange& merged = (*ranges)[last];
+    const SvmRange& range = (*ranges)[i];
+    const_address end = reinterpret_cast<const_address>(merged.ptr_) + merged.size_;
+    if (reinterpret_cast<const_address>(range.ptr_) <= end) {
+      // The range is adjacent or overlaps the merged one, so extend the merged range
+      const_address rangeEnd = reinterpret_cast<const_address>(range.ptr_) + range.size_;
+      if (rangeEnd > end) {
+        merged.size_ = rangeEnd - reinterpret_cast<const_address>(merged.ptr_);
+      }
     } else {
-      ++it;
+      (*ranges)[++last] = range;
     }
   }
+  ranges->resize(last + 1);
 }
 
 Device::BlitProgram::~BlitProgram() {
@@ -401,7 +406,8 @@ bool Device::init() {
   bool ret = false;
   devices_ = nullptr;
   appProfile_.init();
-
+  // The config file overrides must be in place before the devices create the queues
+  device::Tuning::init();
 
 // IMPORTANT: Note that we are initialiing HSA stack first and then
 // GPU stack. The order of initialization is signiicant and if changed
@@ -412,7 +418,10 @@ bool Device::init() {
     // If returned false, error initializing HSA stack.
     // If returned true, either HSA not installed or HSA stack
     //                   successfully initialized.
-    ret = roc::Device::init();
+    {
+      amd::InitPhase phase("roc::Device::init");
+      ret = roc::Device::init();
+    }
     if (!ret) {
       // abort() commentted because this is the only indication
       // that KFD is not installed.
@@ -427,11 +436,13 @@ bool Device::init() {
 #endif  // WITH_HSA_DEVICE
 #if defined(WITH_GPU_DEVICE)
   if (GPU_ENABLE_PAL != 1) {
+    amd::InitPhase phase("gpu::DeviceLoad");
     ret |= DeviceLoad();
   }
 #endif  // WITH_GPU_DEVICE
 #if defined(WITH_PAL_DEVICE)
   if (GPU_ENABLE_PAL != 0) {
+    amd::InitPhase phase("pal::DeviceLoad");
     ret |= PalDeviceLoad();
   }
 #endif  // WITH_PAL_DEVICE
@@ -469,21 +480,16 @@ Device::Device()
       hwDebugMgr_(nullptr),
       context_(nullptr),
       arena_mem_obj_(nullptr),
-      vaCacheAccess_(nullptr),
-      vaCacheMap_(nullptr),
-      index_(0) {
+      vaCache_("VA Cache Ops Lock"),
+      index_(0),
+      numaNode_(-1) {
   memset(&info_, '\0', sizeof(info_));
+  device::MetricsRegistry::addDevice(this, &metrics_, &memoryUsage_);
 }
 
 Device::~Device() {
-  if (vaCacheMap_) {
-    CondLog(vaCacheMap_->size() != 0, "Application didn't unmap all host memory!");
-    delete vaCacheMap_;
-  }
-
-  if (vaCacheAccess_) {
-    delete vaCacheAccess_;
-  }
+  device::MetricsRegistry::removeDevice(this);
+  CondLog(vaCache_.size() != 0, "Application didn't unmap all host memory!");
 
   if (arena_mem_obj_ != nullptr) {
     arena_mem_obj_->release();
@@ -503,6 +509,7 @@ bool Device::ValidateComgr() {
 #if defined(USE_COMGR_LIBRARY)
   // Check if Lightning compiler was requested
   if (settings_->useLightning_) {
+    amd::InitPhase phase("ValidateComgr");
     std::call_once(amd::Comgr::initialized, amd::Comgr::LoadLib);
     // Use Lightning only if it's available
     settings_->useLightning_ = amd::Comgr::IsReady();
@@ -516,6 +523,7 @@ bool Device::ValidateHsail() {
 #if defined(WITH_COMPILER_LIB)
   // Check if HSAIL compiler was requested
   if (!settings_->useLightning_) {
+    amd::InitPhase phase("ValidateHsail");
     std::call_once(amd::Hsail::initialized, amd::Hsail::LoadLib);
     // Use Hsail only if it's available
     return amd::Hsail::IsReady();
@@ -525,16 +533,7 @@ bool Device::ValidateHsail() {
 }
 
 bool Device::create(const Isa &isa) {
-  assert(!vaCacheAccess_ && !vaCacheMap_);
   isa_ = &isa;
-  vaCacheAccess_ = new amd::Monitor("VA Cache Ops Lock", true);
-  if (nullptr == vaCacheAccess_) {
-    return false;
-  }
-  vaCacheMap_ = new std::map<uintptr_t, device::Memory*>();
-  if (nullptr == vaCacheMap_) {
-    return false;
-  }
   return true;
 }
 
@@ -559,24 +558,44 @@ void Device::registerDevice() {
         index_++;
       }
     }
+    setupNumaNode();
   }
   devices_->push_back(this);
 }
 
+void Device::setupNumaNode() {
+  if (info_.deviceTopology_.pcie.type != CL_DEVICE_TOPOLOGY_TYPE_PCIE_AMD) {
+    return;
+  }
+  numaNode_ = Os::getPciNumaNode(info_.pciDomainID, info_.deviceTopology_.pcie.bus,
+                                 info_.deviceTopology_.pcie.device,
+                                 info_.deviceTopology_.pcie.function);
+  if (!Os::getNumaNodeCpus(numaNode_, &numaCpus_)) {
+    numaNode_ = -1;
+    ClPrint(LOG_INFO, LOG_INIT, "Device %u has no NUMA affinity", index_);
+    return;
+  }
+  ClPrint(LOG_INFO, LOG_INIT, "Device %u is closest to NUMA node %d with %u cpus, first cpu %u",
+          index_, numaNode_, numaCpus_.countSet(), numaCpus_.getFirstSet());
+}
+
+bool Device::setNumaAffinity(const amd::Thread& thread) const {
+  // The explicit process affinity has the priority over the NUMA placement
+  if (!AMD_NUMA_AFFINITY || AMD_CPU_AFFINITY || (numaNode_ < 0)) {
+    return false;
+  }
+  thread.setAffinity(numaCpus_);
+  ClPrint(LOG_DEBUG, LOG_INIT, "Thread %s is placed on NUMA node %d", thread.name().c_str(),
+          numaNode_);
+  return true;
+}
+
 void Device::addVACache(device::Memory* memory) const {
   // Make sure system memory has direct access
   if (memory->isHostMemDirectAccess()) {
-    // VA cache access must be serialised
-    amd::ScopedLock lk(*vaCacheAccess_);
-    void* start = memory->owner()->getHostMem();
-    size_t offset;
-    device::Memory* doubleMap = findMemoryFromVA(start, &offset);
-
-    if (doubleMap == nullptr) {
-      // Insert the new entry
-      vaCacheMap_->insert(
-          std::pair<uintptr_t, device::Memory*>(reinterpret_cast<uintptr_t>(start), memory));
-    } else {
+    uintptr_t start = reinterpret_cast<uintptr_t>(memory->owner()->getHostMem());
+    // The ranges can't overlap, since the lookup must be unique
+    if (!vaCache_.insert(start, start + memory->size(), memory, true)) {
       LogError("Unexpected double map() call from the app!");
     }
   }
@@ -585,31 +604,36 @@ void Device::addVACache(device::Memory* memory) const {
 void Device::removeVACache(const device::Memory* memory) const {
   // Make sure system memory has direct access
   if (memory->isHostMemDirectAccess() && memory->owner()) {
-    // VA cache access must be serialised
-    amd::ScopedLock lk(*vaCacheAccess_);
-    void* start = memory->owner()->getHostMem();
-    vaCacheMap_->erase(reinterpret_cast<uintptr_t>(start));
+    vaCache_.erase(reinterpret_cast<uintptr_t>(memory->owner()->getHostMem()));
   }
 }
 
 device::Memory* Device::findMemoryFromVA(const void* ptr, size_t* offset) const {
-  // VA cache access must be serialised
-  amd::ScopedLock lk(*vaCacheAccess_);
-
   uintptr_t key = reinterpret_cast<uintptr_t>(ptr);
-  auto it = vaCacheMap_->upper_bound(reinterpret_cast<uintptr_t>(ptr));
-  if (it == vaCacheMap_->begin()) {
-    return nullptr;
+  uintptr_t start = 0;
+  device::Memory* mem = vaCache_.find(key, &start);
+  if (mem != nullptr) {
+    // ptr is in the range
+    *offset = key - start;
   }
+  return mem;
+}
 
-  --it;
-  device::Memory* mem = it->second;
-  if (key >= it->first && key < (it->first + mem->size())) {
-    // ptr is in the range
-    *offset = key - it->first;
-    return mem;
+bool Device::IpcAttach(const void* const* handles, const size_t* mem_sizes,
+                       const size_t* mem_offsets, size_t count, unsigned int flags,
+                       void** dev_ptrs) const {
+  for (size_t i = 0; i < count; ++i) {
+    if (!IpcAttach(handles[i], mem_sizes[i], mem_offsets[i], flags, &dev_ptrs[i])) {
+      // Roll back the batch, so the caller doesn't track a partial import
+      for (size_t j = 0; j < i; ++j) {
+        IpcDetach(dev_ptrs[j]);
+        dev_ptrs[j] = nullptr;
+      }
+      dev_ptrs[i] = nullptr;
+      return false;
+    }
   }
-  return nullptr;
+  return true;
 }
 
 bool Device::IsTypeMatching(cl_device_type type, bool offlineDevices) {
@@ -904,6 +928,8 @@ bool ClBinary::isRecompilable(std::string& llvmBinary, amd::Elf::ElfPlatform the
 }
 
 void ClBinary::release() {
+  // The input ELF can reference the binary, so it's destroyed first
+  resetElfIn();
   if (isBinaryAllocated() && (binary_ != nullptr)) {
     delete[] binary_;
     binary_ = nullptr;
@@ -1070,7 +1096,9 @@ bool ClBinary::setElfIn() {
   if (binary_ == nullptr) {
     return false;
   }
-  elfIn_ = new amd::Elf(ELFCLASSNONE, binary_, size_, nullptr, amd::Elf::ELF_C_READ);
+  // LC code objects are parsed in place, since the binary outlives the input ELF
+  elfIn_ = new amd::Elf(ELFCLASSNONE, binary_, size_, nullptr, amd::Elf::ELF_C_READ,
+                        dev_.settings().useLightning_);
   if ((elfIn_ == nullptr) || !elfIn_->isSuccessful()) {
     if (elfIn_) {
       delete elfIn_;
@@ -28,11 +28,13 @@
 #include "platform/object.hpp"
 #include "platform/memory.hpp"
 #include "utils/util.hpp"
+#include "utils/concurrent.hpp"
 #include "amdocl/cl_kernel.h"
 #include "elf/elf.hpp"
 #include "appprofile.hpp"
 #include "devprogram.hpp"
 #include "devkernel.hpp"
+#include "devmetrics.hpp"
 #include "amdocl/cl_profile_amd.h"
 #if defined(WITH_COMPILER_LIB)
 #include "hsailctx.hpp"
@@ -46,6 +48,7 @@
 #endif
 #endif
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
@@ -91,6 +94,9 @@ class SvmUnmapMemoryCommand;
 class SvmPrefetchAsyncCommand;
 class TransferBufferFileCommand;
 class StreamOperationCommand;
+class BatchStreamOperationCommand;
+class BatchCopyMemoryCommand;
+class MipChainCommand;
 class ExternalSemaphoreCmd;
 class HwDebugManager;
 class Isa;
@@ -111,6 +117,15 @@ enum MemoryAdvice : uint32_t {
   UnsetCoarseGrain = 101      ///< Restore coherent cache policy at the cost of some performance
 };
 
+//! A range of SVM memory for the prefetch and advise operations
+struct SvmRange {
+  const void* ptr_;  //!< Start address of the range
+  size_t size_;      //!< Size of the range in bytes
+};
+
+//! Sorts the ranges and merges the adjacent and overlapping ranges
+void CoalesceSvmRanges(std::vector<SvmRange>* ranges);
+
 enum MemRangeAttribute : uint32_t {
     ReadMostly = 1,           ///< Whether the range will mostly be read and only
                               ///< occassionally be written to
@@ -612,7 +627,8 @@ class Settings : public amd::HeapObject {
       uint enableCoopMultiDeviceGroups_ : 1; //!< Enable cooperative groups multi device
       uint fenceScopeAgent_ : 1;      //!< Enable fence scope agent in AQL dispatch packet
       uint rocr_backend_ : 1;         //!< Device uses ROCr backend for submissions
-      uint reserved_ : 10;
+      uint directKernArgs_ : 1;       //!< Serialize kernel arguments into kernarg memory on submit
+      uint reserved_ : 9;
     };
     uint value_;
   };
@@ -1152,6 +1168,41 @@ class ThreadTrace : public amd::HeapObject {
   ThreadTrace& operator=(const ThreadTrace&);
 };
 
+/*! \class LaunchGraph
+ *
+ *  \brief The device interface class for the recorded kernel launches
+ *
+ *  The graph records kernel launches once and replays the prebuilt dispatches
+ *  without the per launch argument processing on the host.
+ */
+class LaunchGraph : public amd::HeapObject {
+ public:
+  //! Constructor for the launch graph
+  LaunchGraph() {}
+
+  //! Records a kernel launch into the graph. Returns the node index or -1 on a failure
+  virtual int32_t record(amd::NDRangeKernelCommand& command) = 0;
+
+  //! Updates the raw value of the kernel argument in the recorded node
+  virtual bool setArgument(uint32_t node, uint32_t index, const void* value, size_t size) = 0;
+
+  //! Submits all recorded launches to the queue
+  virtual bool replay() = 0;
+
+  //! Returns the number of recorded nodes
+  virtual uint32_t numNodes() const = 0;
+
+  //! Destructor for LaunchGraph class
+  virtual ~LaunchGraph() {}
+
+ private:
+  //! Disable default copy constructor
+  LaunchGraph(const LaunchGraph&);
+
+  //! Disable default operator=
+  LaunchGraph& operator=(const LaunchGraph&);
+};
+
 //! A device execution environment.
 class VirtualDevice : public amd::HeapObject {
  public:
@@ -1160,10 +1211,12 @@ class VirtualDevice : public amd::HeapObject {
     : device_(device)
     , blitMgr_(NULL)
     , execution_("Virtual device execution lock", true)
-    , index_(0) {}
+    , index_(0) {
+    MetricsRegistry::addQueue(this, &metrics_);
+  }
 
   //! Destroy this virtual device.
-  virtual ~VirtualDevice() {}
+  virtual ~VirtualDevice() { MetricsRegistry::removeQueue(this); }
 
   //! Return the physical device for this virtual device.
   const amd::Device& device() const { return device_(); }
@@ -1201,8 +1254,33 @@ class VirtualDevice : public amd::HeapObject {
     ShouldNotReachHere();
   }
   virtual void submitStreamOperation(amd::StreamOperationCommand& cmd) { ShouldNotReachHere(); }
+  virtual void submitBatchStreamOperation(amd::BatchStreamOperationCommand& cmd) {
+    ShouldNotReachHere();
+  }
+  virtual void submitMipChain(amd::MipChainCommand& cmd) { ShouldNotReachHere(); }
+  virtual void submitBatchCopyMemory(amd::BatchCopyMemoryCommand& cmd) { ShouldNotReachHere(); }
 
   virtual void profilerAttach(bool enable) = 0;
+
+  //! Creates a graph for the recording of kernel launches. Returns nullptr if not supported
+  virtual LaunchGraph* createLaunchGraph() { return nullptr; }
+
+  //! Resizes the queue to a CU partition with the percentage of the device CUs.
+  //! Returns false if the queue can't change the CU mask
+  virtual bool setCuPartition(uint32_t percent) { return false; }
+
+  //! Makes the queue wait in GPU for the dispatched command from another queue.
+  //! Returns false if the dependency can't be tracked in GPU and CPU has to wait
+  virtual bool waitForCommand(amd::Command& command) { return false; }
+
+  //! Waits for all submitted work of the queue without a marker command.
+  //! Returns false if the queue can't wait directly and requires a marker
+  virtual bool waitCompletion() { return false; }
+
+  //! Prepares the command on the submitting thread before the execution lock is taken.
+  //! The preparation can't change the queue state
+  virtual void prepareCommand(amd::Command& command) {}
+
   //! Get the blit manager object
   device::BlitManager& blitMgr() const { return *blitMgr_; }
 
@@ -1215,6 +1293,9 @@ class VirtualDevice : public amd::HeapObject {
   //! Returns true if device has active wait setting
   bool ActiveWait() const;
 
+  //! Returns the metrics of the queue
+  Metrics& metrics() const { return metrics_; }
+
  private:
   //! Disable default copy constructor
   VirtualDevice& operator=(const VirtualDevice&);
@@ -1230,6 +1311,7 @@ class VirtualDevice : public amd::HeapObject {
 
   amd::Monitor execution_;  //!< Lock to serialise access to all device objects
   uint index_;              //!< The virtual device unique index
+  mutable Metrics metrics_; //!< The metrics of the queue
 };
 
 }  // namespace device
@@ -1247,10 +1329,13 @@ class MemObjMap : public AllStatic {
       const void* k);  //!< find the mem object based on the input pointer
   static void UpdateAccess(amd::Device *peerDev);
   static void Purge(amd::Device* dev); //!< Purge all user allocated memories on the given device
+  //! Returns the generation of the map, which changes on each removal. The cached lookups
+  //! are valid, while the generation is the same
+  static uint64_t generation() { return generation_.load(std::memory_order_acquire); }
  private:
-  static std::map<uintptr_t, amd::Memory*>
-      MemObjMap_;                      //!< the mem object<->hostptr information container
-  static amd::Monitor AllocatedLock_;  //!< amd monitor locker
+  //! Concurrent index of the allocations with the lock-free lookups
+  static ConcurrentRangeIndex<amd::Memory> index_;
+  static std::atomic<uint64_t> generation_;  //!< The number of the removals
 };
 
 /// @brief Instruction Set Architecture properties.
@@ -1685,6 +1770,17 @@ class Device : public RuntimeObject {
     return false;
   }
 
+  /**
+   * @return True if the device successfully applied all SVM attributes to all ranges in HMM.
+   * The ranges are coalesced and each range is updated with all attributes at once
+   */
+  virtual bool SetSvmAttributes(const std::vector<amd::SvmRange>& ranges,
+                                const std::vector<amd::MemoryAdvice>& advices,
+                                bool use_cpu = false) const {
+    ShouldNotCallThis();
+    return false;
+  }
+
   /**
    * @return True if the device successfully retrieved the SVM attributes from HMM for device memory
    */
@@ -1806,6 +1902,49 @@ class Device : public RuntimeObject {
     return false;
   }
 
+  //! Attaches a batch of IPC handles. On a failure all attached handles are detached
+  virtual bool IpcAttach(const void* const* handles, const size_t* mem_sizes,
+                         const size_t* mem_offsets, size_t count, unsigned int flags,
+                         void** dev_ptrs) const;
+
+  //! Returns the granularity of the virtual memory management, 0 if it isn't supported
+  virtual size_t VirtualGranularity() const { return 0; }
+
+  //! Reserves a device virtual address range without the physical backing
+  virtual void* VirtualReserve(void* addr, size_t size) const { return nullptr; }
+
+  //! Releases the reserved range. All mappings in the range must be removed
+  virtual bool VirtualFree(void* addr, size_t size) const { return false; }
+
+  //! Allocates device physical memory, which can be mapped into the reserved ranges
+  virtual bool PhysicalCreate(size_t size, bool atomics, uint64_t* handle) const { return false; }
+
+  //! Releases the physical memory. The memory is freed after the last unmap
+  virtual bool PhysicalRelease(uint64_t handle) const { return false; }
+
+  //! Maps the physical memory at the offset into the reserved range
+  virtual bool VirtualMap(void* addr, size_t size, size_t offset, uint64_t handle) const {
+    return false;
+  }
+
+  //! Removes the mapping of the range
+  virtual bool VirtualUnmap(void* addr, size_t size) const { return false; }
+
+  //! Grants the access to the mapped range for this device and the enabled peers
+  virtual bool VirtualSetAccess(void* addr, size_t size, bool readOnly) const { return false; }
+
+  //! Creates a memory object over the mapped range, so the range can be used in the commands
+  virtual Memory* VirtualView(void* addr, size_t size, cl_mem_flags flags) const {
+    return nullptr;
+  }
+
+  //! Computes a CU mask with the percentage of the available CUs, balanced across the shader
+  //! engines. The least used CUs are selected, so the partitions don't overlap if possible
+  virtual bool CreateCuPartition(uint32_t percent, std::vector<uint32_t>* mask) { return false; }
+
+  //! Releases the CUs of the partition, computed with CreateCuPartition()
+  virtual void ReleaseCuPartition(const std::vector<uint32_t>& mask) {}
+
   //! Return context
   amd::Context& context() const { return *context_; }
 
@@ -1827,6 +1966,19 @@ class Device : public RuntimeObject {
   //! Returns index of current device
   uint32_t index() const { return index_; }
 
+  //! Returns the metrics of the device events
+  device::Metrics& metrics() const { return metrics_; }
+
+  //! Returns the per category accounting of the device memory usage
+  device::MemoryUsage& memoryUsage() const { return memoryUsage_; }
+
+  //! Returns the NUMA node closest to the device or -1 if the node is unknown
+  int numaNode() const { return numaNode_; }
+
+  //! Restricts the thread to the cpus of the closest NUMA node with AMD_NUMA_AFFINITY.
+  //! Returns false if the thread placement didn't change
+  bool setNumaAffinity(const amd::Thread& thread) const;
+
   //! Returns value for LinkAttribute for lost of vectors
   virtual bool findLinkInfo(const amd::Device& other_device,
                             std::vector<LinkAttrType>* link_attr) {
@@ -1886,9 +2038,16 @@ class Device : public RuntimeObject {
 
   static std::vector<Device*>* devices_;  //!< All known devices
 
-  Monitor* vaCacheAccess_;                            //!< Lock to serialize VA caching access
-  std::map<uintptr_t, device::Memory*>* vaCacheMap_;  //!< VA cache map
+  //! Finds the closest NUMA node from the PCI topology and reports the affinity
+  void setupNumaNode();
+
+  //! VA cache of the host memory with the direct access, shares the lookups with MemObjMap
+  mutable ConcurrentRangeIndex<device::Memory> vaCache_;
   uint32_t index_;  //!< Unique device index
+  int numaNode_;    //!< The closest NUMA node or -1
+  Os::ThreadAffinityMask numaCpus_;  //!< The cpus of the closest NUMA node
+  mutable device::Metrics metrics_;  //!< The metrics of the device events
+  mutable device::MemoryUsage memoryUsage_;  //!< The memory usage of the device
 };
 
 /*! @}
@@ -30,6 +30,7 @@
 #endif
 #include "comgrctx.hpp"
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <sstream>
@@ -587,7 +588,9 @@ Kernel::Kernel(const amd::Device& dev, const std::string& name, const Program& p
   , name_(name)
   , prog_(prog)
   , signature_(nullptr)
-  , waveLimiter_(this, dev.info().cuPerShaderArray_ * dev.info().simdPerCU_) {
+  , waveLimiter_(this, dev.info().cuPerShaderArray_ * dev.info().simdPerCU_)
+  , workGroupTuner_(this)
+  , specializer_(this) {
   // Instead of memset(&workGroupInfo_, '\0', sizeof(workGroupInfo_));
   // Due to std::string not being able to be memset to 0
   workGroupInfo_.size_ = 0;
@@ -616,6 +619,7 @@ Kernel::Kernel(const amd::Device& dev, const std::string& name, const Program& p
   workGroupInfo_.compileVecTypeHint_ = "";
   workGroupInfo_.uniformWorkGroupSize_ = false;
   workGroupInfo_.wavesPerSimdHint_ = 0;
+  workGroupInfo_.maxOccupancyPerCu_ = 0;
 }
 
 // ================================================================================================
@@ -661,7 +665,122 @@ bool Kernel::createSignature(
 }
 
 // ================================================================================================
-Kernel::~Kernel() { delete signature_; }
+Kernel::~Kernel() {
+  if (stats_.registered_.load(std::memory_order_relaxed)) {
+    // Keep the statistics of the destroyed kernel for the dump
+    amd::ScopedLock lock(statsLock_);
+    retiredStats_->push_back(statsEntry());
+    statsRegistry_->erase(std::find(statsRegistry_->begin(), statsRegistry_->end(), this));
+  }
+  delete signature_;
+}
+
+// ================================================================================================
+amd::Monitor Kernel::lazyInitLock_("Kernel lazy init lock", true);
+
+// ================================================================================================
+// The registry is used at the runtime shutdown, so it's never destroyed
+amd::Monitor Kernel::statsLock_("Kernel statistics lock");
+std::vector<const Kernel*>* Kernel::statsRegistry_ = nullptr;
+std::vector<Kernel::StatsEntry>* Kernel::retiredStats_ = nullptr;
+
+// ================================================================================================
+void Kernel::addLaunch(uint64_t enqueueTime, uint64_t kernargBytes, bool barrier) const {
+  if (!stats_.registered_.load(std::memory_order_acquire)) {
+    registerStats();
+  }
+  stats_.launches_.fetch_add(1, std::memory_order_relaxed);
+  stats_.enqueueTime_.fetch_add(enqueueTime, std::memory_order_relaxed);
+  stats_.kernargBytes_.fetch_add(kernargBytes, std::memory_order_relaxed);
+  if (barrier) {
+    stats_.barriers_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// ================================================================================================
+void Kernel::addGpuTime(uint64_t time) const {
+  stats_.gpuSamples_.fetch_add(1, std::memory_order_relaxed);
+  stats_.gpuTime_.fetch_add(time, std::memory_order_relaxed);
+  uint64_t maxTime = stats_.gpuMaxTime_.load(std::memory_order_relaxed);
+  while ((time > maxTime) &&
+         !stats_.gpuMaxTime_.compare_exchange_weak(maxTime, time, std::memory_order_relaxed)) {
+  }
+}
+
+// ================================================================================================
+void Kernel::registerStats() const {
+  amd::ScopedLock lock(statsLock_);
+  if (!stats_.registered_.load(std::memory_order_relaxed)) {
+    if (statsRegistry_ == nullptr) {
+      statsRegistry_ = new std::vector<const Kernel*>();
+      retiredStats_ = new std::vector<StatsEntry>();
+    }
+    statsRegistry_->push_back(this);
+    stats_.registered_.store(true, std::memory_order_release);
+  }
+}
+
+// ================================================================================================
+Kernel::StatsEntry Kernel::statsEntry() const {
+  return {name(), stats_.launches_.load(std::memory_order_relaxed),
+          stats_.gpuSamples_.load(std::memory_order_relaxed),
+          stats_.gpuTime_.load(std::memory_order_relaxed),
+          stats_.gpuMaxTime_.load(std::memory_order_relaxed),
+          stats_.enqueueTime_.load(std::memory_order_relaxed),
+          stats_.kernargBytes_.load(std::memory_order_relaxed),
+          stats_.barriers_.load(std::memory_order_relaxed)};
+}
+
+// ================================================================================================
+void Kernel::dumpStats() {
+  std::vector<StatsEntry> entries;
+  {
+    // The log can take monitors, hence the statistics are copied before the output
+    amd::ScopedLock lock(statsLock_);
+    if (statsRegistry_ == nullptr) {
+      return;
+    }
+    entries = *retiredStats_;
+    for (const auto kernel : *statsRegistry_) {
+      entries.push_back(kernel->statsEntry());
+    }
+  }
+  std::sort(entries.begin(), entries.end(), [](const StatsEntry& a, const StatsEntry& b) {
+    return a.enqueueTime_ > b.enqueueTime_;
+  });
+
+  ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Kernel statistics: name, launches, enqueue time (us), "
+          "GPU samples, GPU total/avg/max time (us), kernarg bytes, dependency barriers");
+  for (const auto& entry : entries) {
+    const uint64_t avgTime = (entry.gpuSamples_ != 0) ? (entry.gpuTime_ / entry.gpuSamples_) : 0;
+    ClPrint(amd::LOG_INFO, amd::LOG_KERN, "%s: %llu, %llu, %llu, %llu/%llu/%llu, %llu, %llu",
+            entry.name_.c_str(), static_cast<unsigned long long>(entry.launches_),
+            static_cast<unsigned long long>(entry.enqueueTime_ / 1000),
+            static_cast<unsigned long long>(entry.gpuSamples_),
+            static_cast<unsigned long long>(entry.gpuTime_ / 1000),
+            static_cast<unsigned long long>(avgTime / 1000),
+            static_cast<unsigned long long>(entry.gpuMaxTime_ / 1000),
+            static_cast<unsigned long long>(entry.kernargBytes_),
+            static_cast<unsigned long long>(entry.barriers_));
+  }
+}
+
+// ================================================================================================
+bool Kernel::deferredInit() {
+  amd::ScopedLock lock(lazyInitLock_);
+  // Another thread could finish the initialization
+  if (initDeferred_.load(std::memory_order_relaxed)) {
+    initFailed_ = !lazyInit();
+    if (initFailed_) {
+      DevLogPrintfError("Deferred initialization failed for kernel: %s \n", name().c_str());
+    } else {
+      ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Deferred initialization of kernel: %s",
+              name().c_str());
+    }
+    initDeferred_.store(false, std::memory_order_release);
+  }
+  return !initFailed_;
+}
 
 // ================================================================================================
 #if defined(WITH_COMPILER_LIB)
@@ -783,6 +902,114 @@ void Kernel::FindLocalWorkSize(size_t workDim, const amd::NDRange& gblWorkSize,
   }
 }
 
+//! The maximum number of workgroups, resident in a CU
+static constexpr uint32_t kMaxWorkGroupsPerCu = 16;
+//! LDS allocation granularity in bytes
+static constexpr uint32_t kLdsGranularity = 512;
+//! SGPRs per SIMD on GFX9 and the allocation granularity. SGPRs don't limit waves on GFX10+
+static constexpr uint32_t kSgprsPerSimdGfx9 = 800;
+static constexpr uint32_t kSgprGranularity = 16;
+
+// ================================================================================================
+bool Kernel::occupancy(size_t workGroupSize, size_t sharedMemBytes,
+                       const std::vector<uint32_t>& cuMask, Occupancy* result) const {
+  const Info& info = device().info();
+  *result = {};
+  result->limit_ = OccupancyLimit::Invalid;
+
+  const size_t lds = workGroupInfo_.usedLDSSize_ + sharedMemBytes;
+  if ((workGroupSize == 0) || (workGroupSize > workGroupInfo_.size_) ||
+      (lds > info.localMemSizePerCU_) || (info.simdPerCU_ == 0) ||
+      (info.wavefrontWidth_ == 0) || (info.maxThreadsPerCU_ == 0)) {
+    return false;
+  }
+
+  const uint32_t waveSize = (workGroupInfo_.wavefrontSize_ != 0)
+      ? static_cast<uint32_t>(workGroupInfo_.wavefrontSize_) : info.wavefrontWidth_;
+  const uint32_t wavesPerGroup = static_cast<uint32_t>(amd::alignUp(workGroupSize, waveSize) /
+                                                       waveSize);
+  // The waves of a workgroup are spread over the SIMDs of the CU
+  const uint32_t groupWavesPerSimd = (wavesPerGroup + info.simdPerCU_ - 1) / info.simdPerCU_;
+  // The wave slots are counted in the waves of the device mode
+  const uint32_t maxWavesPerSimd =
+      std::max(info.maxThreadsPerCU_ / info.wavefrontWidth_ / info.simdPerCU_, 1u);
+
+  uint32_t groups = maxWavesPerSimd / groupWavesPerSimd;
+  OccupancyLimit limit = OccupancyLimit::None;
+  auto apply = [&](uint32_t value, OccupancyLimit reason) {
+    if (value < groups) {
+      groups = value;
+      limit = reason;
+    }
+  };
+
+  const uint32_t gfx = device().isa().versionMajor();
+  if (workGroupInfo_.usedVGPRs_ > 0) {
+    // A SIMD lane holds 256 VGPRs on GFX9 and 512 on GFX90A with the unified register file.
+    // RDNA has 1024 VGPRs per lane in wave32 mode and half of that in wave64 mode
+    uint32_t vgprFile = 256;
+    uint32_t vgprGranularity = 4;
+    if (gfx >= 10) {
+      vgprFile = (waveSize == 32) ? 1024 : 512;
+      vgprGranularity = (waveSize == 32) ? 8 : 4;
+    } else if (workGroupInfo_.availableVGPRs_ > 256) {
+      vgprFile = 512;
+      vgprGranularity = 8;
+    }
+    const uint32_t vgprs = amd::alignUp(static_cast<uint32_t>(workGroupInfo_.usedVGPRs_),
+                                        vgprGranularity);
+    apply(std::min(vgprFile / vgprs, maxWavesPerSimd) / groupWavesPerSimd, OccupancyLimit::Vgprs);
+  }
+  if ((gfx < 10) && (workGroupInfo_.usedSGPRs_ > 0)) {
+    const uint32_t sgprs = amd::alignUp(static_cast<uint32_t>(workGroupInfo_.usedSGPRs_),
+                                        kSgprGranularity);
+    apply(std::min(kSgprsPerSimdGfx9 / sgprs, maxWavesPerSimd) / groupWavesPerSimd,
+          OccupancyLimit::Sgprs);
+  }
+  if (lds > 0) {
+    apply(static_cast<uint32_t>(info.localMemSizePerCU_ / amd::alignUp(lds, kLdsGranularity)),
+          OccupancyLimit::Lds);
+  }
+  apply(kMaxWorkGroupsPerCu, OccupancyLimit::WorkGroups);
+
+  uint32_t activeCus = 0;
+  for (auto mask : cuMask) {
+    activeCus += amd::countBitsSet(mask);
+  }
+  result->activeCus_ = ((activeCus == 0) || (activeCus > info.maxComputeUnits_))
+      ? info.maxComputeUnits_ : activeCus;
+  result->workGroupsPerCu_ = groups;
+  result->wavesPerCu_ = groups * wavesPerGroup;
+  result->wavesPerSimd_ = groups * groupWavesPerSimd;
+  result->limit_ = (groups == 0) ? OccupancyLimit::Invalid : limit;
+  return (groups != 0);
+}
+
+// ================================================================================================
+bool Kernel::suggestLaunch(size_t sharedMemBytes, const std::vector<uint32_t>& cuMask,
+                           size_t* workGroupSize, size_t* minGridSize) const {
+  const size_t wave = std::max(workGroupInfo_.wavefrontSize_, static_cast<size_t>(1));
+  size_t bestSize = 0;
+  Occupancy best = {};
+  // The larger workgroup wins with the same occupancy, since it has less scheduling overhead
+  for (size_t size = amd::alignDown(workGroupInfo_.size_, wave); size >= wave; size -= wave) {
+    Occupancy current;
+    if (occupancy(size, sharedMemBytes, cuMask, &current) &&
+        (current.wavesPerCu_ > best.wavesPerCu_)) {
+      best = current;
+      bestSize = size;
+    }
+  }
+  if (bestSize == 0) {
+    return false;
+  }
+  *workGroupSize = bestSize;
+  *minGridSize = static_cast<size_t>(best.workGroupsPerCu_) * best.activeCus_;
+  ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Launch advisor %s: workgroup %zu, grid %zu, %u waves/CU",
+          name().c_str(), bestSize, *minGridSize, best.wavesPerCu_);
+  return true;
+}
+
 // ================================================================================================
 #if defined(WITH_COMPILER_LIB)
 static inline uint32_t GetOclArgumentTypeOCL(const aclArgData* argInfo, bool* isHidden) {
@@ -27,6 +27,11 @@
 #include "platform/object.hpp"
 #include "platform/memory.hpp"
 #include "devwavelimiter.hpp"
+#include "devwgtuner.hpp"
+#include "devspecializer.hpp"
+#include "thread/monitor.hpp"
+
+#include <atomic>
 
 namespace amd {
 class Device;
@@ -398,11 +403,55 @@ class Kernel : public amd::HeapObject {
 
   size_t getWorkGroupSizeHint(int dim) const { return workGroupInfo_.compileSizeHint_[dim]; }
 
-  //! Get profiling callback object
-  amd::ProfilingCallback* getProfilingCallback(const device::VirtualDevice* vdev) {
-    return waveLimiter_.getProfilingCallback(vdev);
+  //! Get profiling callback object for the dispatch and the waves per shader array.
+  //! Returns nullptr if the dispatch doesn't require profiling
+  amd::ProfilingCallback* getProfilingCallback(const device::VirtualDevice* vdev,
+                                               const amd::NDRangeContainer& sizes,
+                                               uint* waves) {
+    return waveLimiter_.getProfilingCallback(vdev, WaveLimiterManager::sizeBucket(sizes), waves);
+  };
+
+  //! Selects the local workgroup size, if the application didn't provide it.
+  //! Returns the profiling callback if the dispatch measures a candidate size
+  amd::ProfilingCallback* tuneWorkGroupSize(const amd::NDRange& global, amd::NDRange& local) {
+    return workGroupTuner_.select(global, local);
+  }
+
+  //! The resource, which limits the occupancy of a launch
+  enum class OccupancyLimit : uint32_t {
+    None = 0,    //!< The launch fills the wave slots of the CU
+    Vgprs,       //!< VGPRs of the kernel
+    Sgprs,       //!< SGPRs of the kernel
+    Lds,         //!< Static and dynamic LDS of the workgroup
+    WorkGroups,  //!< Workgroup slots of the CU
+    Invalid      //!< The workgroup can't be launched
+  };
+
+  //! The achievable occupancy of a launch
+  struct Occupancy {
+    uint32_t workGroupsPerCu_;  //!< Resident workgroups per CU
+    uint32_t wavesPerCu_;       //!< Resident waves per CU
+    uint32_t wavesPerSimd_;     //!< Resident waves per SIMD
+    uint32_t activeCus_;        //!< CUs, enabled by the CU mask
+    OccupancyLimit limit_;      //!< The resource, which limits the occupancy
   };
 
+  //! Computes the achievable occupancy for the workgroup size, the dynamic LDS of the launch
+  //! and the CU mask of the queue. Returns FALSE if the workgroup can't be launched
+  bool occupancy(size_t workGroupSize, size_t sharedMemBytes,
+                 const std::vector<uint32_t>& cuMask, Occupancy* result) const;
+
+  //! Proposes the workgroup size with the best occupancy for the dynamic LDS of the launch and
+  //! the minimum grid size in workgroups, which fills the enabled CUs
+  bool suggestLaunch(size_t sharedMemBytes, const std::vector<uint32_t>& cuMask,
+                     size_t* workGroupSize, size_t* minGridSize) const;
+
+  //! Returns the device kernel of the variant, specialized on the argument values of the launch,
+  //! or nullptr if the launch must use this kernel
+  Kernel* specialize(const amd::Kernel& kernel, const_address params) {
+    return specializer_.select(kernel, params);
+  }
+
   //! Get waves per shader array to be used for kernel execution.
   uint getWavesPerSH(const device::VirtualDevice* vdev) const {
     return waveLimiter_.getWavesPerSH(vdev);
@@ -476,7 +525,33 @@ class Kernel : public amd::HeapObject {
 
   void SetSymbolName(const std::string& name) { symbolName_ = name; }
 
+  //! Defers the kernel initialization from metadata until the first use
+  void deferInit() { initDeferred_.store(true, std::memory_order_relaxed); }
+
+  //! Returns TRUE if the kernel initialization is still deferred
+  bool initDeferred() const { return initDeferred_.load(std::memory_order_acquire); }
+
+  //! Runs the deferred initialization on the first use. Returns FALSE on a failure
+  bool ensureInit() const {
+    return initDeferred() ? const_cast<Kernel*>(this)->deferredInit() : !initFailed_;
+  }
+
+  //! Records a submission of the kernel with AMD_KERNEL_STATS
+  void addLaunch(uint64_t enqueueTime,   //!< CPU time of the submission in ns
+                 uint64_t kernargBytes,  //!< The size of the kernel arguments
+                 bool barrier            //!< The memory dependency serialized the launch
+                 ) const;
+
+  //! Records the GPU time (ns) of a profiled launch with AMD_KERNEL_STATS
+  void addGpuTime(uint64_t time) const;
+
+  //! Prints the launch statistics of all kernels
+  static void dumpStats();
+
  protected:
+  //! Initializes the kernel from metadata, if the initialization was deferred
+  virtual bool lazyInit() { return true; }
+
   //! Initializes the abstraction layer kernel parameters
 #if defined(USE_COMGR_LIBRARY)
   void InitParameters(const amd_comgr_metadata_node_t kernelMD);
@@ -518,6 +593,8 @@ class Kernel : public amd::HeapObject {
   std::string buildLog_;            //!< build log
   std::vector<PrintfInfo> printf_;  //!< Format strings for GPU printf support
   WaveLimiterManager waveLimiter_;  //!< adaptively control number of waves
+  WorkGroupTuner workGroupTuner_;   //!< tunes the local workgroup size
+  KernelSpecializer specializer_;   //!< specializes the kernel on the argument values
   std::string runtimeHandle_;       //!< Runtime handle for context loader
 
   uint64_t kernelCodeHandle_ = 0;   //!< Kernel code handle (aka amd_kernel_code_t)
@@ -540,13 +617,58 @@ class Kernel : public amd::HeapObject {
 
 
  private:
+  friend class KernelSpecializer;
+
   //! Disable default copy constructor
   Kernel(const Kernel&);
 
   //! Disable operator=
   Kernel& operator=(const Kernel&);
 
+  //! Runs lazyInit() once under the lock
+  bool deferredInit();
+
   std::unordered_map<size_t, size_t> patchReferences_;  //!< Patch table for references
+
+  std::atomic<bool> initDeferred_{false};  //!< The initialization is deferred to the first use
+  bool initFailed_ = false;                //!< The deferred initialization failed
+
+  static amd::Monitor lazyInitLock_;       //!< Serializes the deferred initializations
+
+  //! The launch statistics of the kernel
+  struct LaunchStats {
+    std::atomic<uint64_t> launches_{0};      //!< The number of the submissions
+    std::atomic<uint64_t> gpuSamples_{0};    //!< The number of the launches with the GPU time
+    std::atomic<uint64_t> gpuTime_{0};       //!< Total GPU time of the sampled launches (ns)
+    std::atomic<uint64_t> gpuMaxTime_{0};    //!< The longest sampled launch (ns)
+    std::atomic<uint64_t> enqueueTime_{0};   //!< Total CPU time of the submissions (ns)
+    std::atomic<uint64_t> kernargBytes_{0};  //!< Total size of the kernel arguments
+    std::atomic<uint64_t> barriers_{0};      //!< The launches serialized by memory dependency
+    std::atomic<bool> registered_{false};    //!< The kernel is in the statistics registry
+  };
+  mutable LaunchStats stats_;              //!< The launch statistics with AMD_KERNEL_STATS
+
+  //! The copy of the launch statistics for the dump
+  struct StatsEntry {
+    std::string name_;
+    uint64_t launches_;
+    uint64_t gpuSamples_;
+    uint64_t gpuTime_;
+    uint64_t gpuMaxTime_;
+    uint64_t enqueueTime_;
+    uint64_t kernargBytes_;
+    uint64_t barriers_;
+  };
+
+  //! Adds the kernel into the statistics registry on the first launch
+  void registerStats() const;
+
+  //! Returns the copy of the launch statistics
+  StatsEntry statsEntry() const;
+
+  static amd::Monitor statsLock_;                    //!< Lock for the statistics registry
+  static std::vector<const Kernel*>* statsRegistry_; //!< The kernels with the statistics
+  static std::vector<StatsEntry>* retiredStats_;     //!< The statistics of destroyed kernels
 };
 
 #if defined(USE_COMGR_LIBRARY)
@@ -0,0 +1,127 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+
+#include "device/devmapcache.hpp"
+#include "device/devmetrics.hpp"
+#include "platform/memory.hpp"
+#include "utils/debug.hpp"
+#include "utils/flags.hpp"
+
+#include <iterator>
+
+namespace device {
+
+// ================================================================================================
+MapCache::~MapCache() {
+  for (auto memory : lru_) {
+    memory->release();
+  }
+  if (usage_ != nullptr) {
+    usage_->remove(VDI_MEMORY_MAP_CACHE, total_);
+  }
+}
+
+// ================================================================================================
+amd::Memory* MapCache::remove(std::multimap<size_t, LruList::iterator>::iterator it) {
+  amd::Memory* memory = *it->second;
+  total_ -= it->first;
+  if (usage_ != nullptr) {
+    usage_->remove(VDI_MEMORY_MAP_CACHE, it->first);
+  }
+  lru_.erase(it->second);
+  bySize_.erase(it);
+  return memory;
+}
+
+// ================================================================================================
+amd::Memory* MapCache::removeLast() {
+  LruList::iterator last = std::prev(lru_.end());
+  auto range = bySize_.equal_range((*last)->getSize());
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == last) {
+      ClPrint(amd::LOG_INFO, amd::LOG_RESOURCE, "Map cache evicted: %zu bytes", it->first);
+      return remove(it);
+    }
+  }
+  ShouldNotReachHere();
+  return nullptr;
+}
+
+// ================================================================================================
+amd::Memory* MapCache::find(size_t size) {
+  amd::ScopedLock lock(lock_);
+  auto it = bySize_.lower_bound(size);
+  if (it == bySize_.end()) {
+    return nullptr;
+  }
+  return remove(it);
+}
+
+// ================================================================================================
+bool MapCache::add(amd::Memory* memory) {
+  // The svm memory shouldn't be cached
+  const size_t size = memory->getSize();
+  if (!memory->canBeCached() || (size > budget_)) {
+    return false;
+  }
+
+  LruList evicted;
+  {
+    amd::ScopedLock lock(lock_);
+    lru_.push_front(memory);
+    bySize_.insert(std::make_pair(size, lru_.begin()));
+    total_ += size;
+    if (usage_ != nullptr) {
+      usage_->add(VDI_MEMORY_MAP_CACHE, size);
+    }
+
+    // Remove the least recently used entries over the budget
+    while (total_ > budget_) {
+      evicted.push_back(removeLast());
+    }
+  }
+
+  // Release the evicted entries outside of the lock, since the destruction can be slow
+  for (auto entry : evicted) {
+    entry->release();
+  }
+  return true;
+}
+
+// ================================================================================================
+size_t MapCache::trim(size_t size) {
+  LruList evicted;
+  size_t released = 0;
+  {
+    amd::ScopedLock lock(lock_);
+    while (!lru_.empty() && (released < size)) {
+      released += lru_.back()->getSize();
+      evicted.push_back(removeLast());
+    }
+  }
+
+  for (auto entry : evicted) {
+    entry->release();
+  }
+  return released;
+}
+
+}  // namespace device
@@ -0,0 +1,83 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+
+#pragma once
+
+#include "top.hpp"
+#include "thread/monitor.hpp"
+
+#include <list>
+#include <map>
+
+namespace amd {
+class Memory;
+}
+
+namespace device {
+
+class MemoryUsage;
+
+//! The cache of the staging memory objects for the indirect maps. The entries are indexed
+//! by the size for the best fit lookup, and the least recently used entries are released
+//! over the byte budget.
+class MapCache : public amd::HeapObject {
+ public:
+  //! Constructor, the budget is in bytes. The cached bytes are accounted in the memory usage
+  MapCache(size_t budget, MemoryUsage* usage = nullptr)
+      : lock_("Map Cache Lock", true), budget_(budget), total_(0), usage_(usage) {}
+
+  //! Releases all cached map targets
+  ~MapCache();
+
+  //! Returns the smallest map target, which has at least the requested size,
+  //! or nullptr if the cache doesn't have one. The caller owns the returned entry
+  amd::Memory* find(size_t size);
+
+  //! Adds the map target into the cache. Returns FALSE if the caller must release it
+  bool add(amd::Memory* memory);
+
+  //! Releases the least recently used entries for the size. Returns the released bytes
+  size_t trim(size_t size);
+
+ private:
+  //! Disable copy constructor
+  MapCache(const MapCache&);
+
+  //! Disable assignment operator
+  MapCache& operator=(const MapCache&);
+
+  typedef std::list<amd::Memory*> LruList;
+
+  //! Removes the entry from the size index and the LRU list and returns the memory
+  amd::Memory* remove(std::multimap<size_t, LruList::iterator>::iterator it);
+
+  //! Removes the least recently used entry and returns the memory, must be called under the lock
+  amd::Memory* removeLast();
+
+  amd::Monitor lock_;                                 //!< Lock to serialise the cache access
+  LruList lru_;                                       //!< The entries, the most recent first
+  std::multimap<size_t, LruList::iterator> bySize_;  //!< The entries, indexed by the size
+  size_t budget_;                                     //!< The cache budget in bytes
+  size_t total_;                                      //!< The total size of the entries
+  MemoryUsage* usage_;                                //!< The memory usage of the device
+};
+
+}  // namespace device
@@ -0,0 +1,156 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/devmemdependency.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <iterator>
+
+namespace device {
+
+// ================================================================================================
+bool MemoryDependency::RangeSet::overlaps(uint64_t start, uint64_t end) const {
+  // Find the last range, which starts before the end of the current one
+  auto it = ranges_.lower_bound(end);
+  if (it == ranges_.begin()) {
+    return false;
+  }
+  --it;
+  // The ranges are disjoint, hence only the last one can reach the current start
+  return it->second > start;
+}
+
+// ================================================================================================
+void MemoryDependency::RangeSet::insert(uint64_t start, uint64_t end) {
+  auto it = ranges_.upper_bound(start);
+  // Check if the previous range overlaps or touches the current one
+  if (it != ranges_.begin()) {
+    auto prev = std::prev(it);
+    if (prev->second >= start) {
+      if (prev->second >= end) {
+        // The range is already covered
+        return;
+      }
+      start = prev->first;
+      it = ranges_.erase(prev);
+    }
+  }
+  // Absorb all ranges, which start inside or right after the current one
+  while ((it != ranges_.end()) && (it->first <= end)) {
+    end = std::max(end, it->second);
+    it = ranges_.erase(it);
+  }
+  ranges_.emplace_hint(it, start, end);
+}
+
+// ================================================================================================
+bool MemoryDependency::create(size_t numMemObj) {
+  if (numMemObj > 0) {
+    // The value is just a hint for the number of objects in a single kernel,
+    // since the tracker doesn't have a limit
+    curKernel_.reserve(numMemObj);
+    enabled_ = true;
+  }
+
+  return true;
+}
+
+// ================================================================================================
+void MemoryDependency::newKernel() {
+  // Move the objects of the previous kernel into the busy ranges
+  for (const auto& it : curKernel_) {
+    if (it.readOnly_) {
+      readRanges_.insert(it.start_, it.end_);
+    } else {
+      writeRanges_.insert(it.start_, it.end_);
+    }
+  }
+  curKernel_.clear();
+}
+
+// ================================================================================================
+bool MemoryDependency::validate(uint64_t start, uint64_t end, bool readOnly, bool skipCheck) {
+  // Check if the busy region was written or the current one is for write
+  // @note don't include objects from the current kernel
+  bool flushL1Cache = !skipCheck && (writeRanges_.overlaps(start, end) ||
+                                     (!readOnly && readRanges_.overlaps(start, end)));
+
+  if (flushL1Cache) {
+    // Clear memory dependency state
+    const static bool All = true;
+    clear(!All);
+  }
+
+  // Insert current memory object into the queue always,
+  // since runtime calls flush before kernel execution and it has to keep
+  // current kernel in tracking
+  if (start < end) {
+    curKernel_.push_back({start, end, readOnly});
+  }
+
+  return flushL1Cache;
+}
+
+// ================================================================================================
+void MemoryDependency::clear(bool all) {
+  readRanges_.clear();
+  writeRanges_.clear();
+  // Preserve all objects from the current kernel
+  if (all) {
+    curKernel_.clear();
+  }
+}
+
+// ================================================================================================
+void MemoryDependency::RangeSet::print(std::string* str) const {
+  // Limit the output, since the set is unbounded
+  static constexpr size_t kMaxPrinted = 8;
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%zu", ranges_.size());
+  str->append(buf);
+  size_t count = 0;
+  for (const auto& it : ranges_) {
+    if (count++ == kMaxPrinted) {
+      str->append(" ...");
+      break;
+    }
+    snprintf(buf, sizeof(buf), " [0x%" PRIx64 ", 0x%" PRIx64 ")", it.first, it.second);
+    str->append(buf);
+  }
+}
+
+// ================================================================================================
+std::string MemoryDependency::state() const {
+  if (!enabled_) {
+    return "disabled";
+  }
+  std::string str = "read ranges: ";
+  readRanges_.print(&str);
+  str += ", write ranges: ";
+  writeRanges_.print(&str);
+  char buf[64];
+  snprintf(buf, sizeof(buf), ", current kernel objects: %zu", curKernel_.size());
+  str += buf;
+  return str;
+}
+
+}  // namespace device
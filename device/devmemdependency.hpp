@@ -0,0 +1,98 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace device {
+
+//! Tracks the address ranges accessed by the kernels in the queue since the last
+//! cache invalidation and detects the memory hazards between the kernels.
+//! The ranges are kept in two sorted sets of disjoint intervals (read-only and written),
+//! so the overlap check is a logarithmic lookup and the number of tracked objects is unbounded.
+class MemoryDependency : public amd::EmbeddedObject {
+ public:
+  //! Sorted set of disjoint address ranges with merging of the adjacent ones
+  class RangeSet {
+   public:
+    //! Returns TRUE if [start, end) overlaps any range in the set
+    bool overlaps(uint64_t start, uint64_t end) const;
+
+    //! Inserts [start, end) into the set and merges it with the overlapped/adjacent ranges
+    void insert(uint64_t start, uint64_t end);
+
+    //! Removes all ranges from the set
+    void clear() { ranges_.clear(); }
+
+    //! Returns TRUE if the set is empty
+    bool empty() const { return ranges_.empty(); }
+
+    //! Appends the first ranges of the set to the string
+    void print(std::string* str) const;
+
+   private:
+    std::map<uint64_t, uint64_t> ranges_;  //!< Busy ranges, indexed by the start address
+  };
+
+  //! Default constructor
+  MemoryDependency() : enabled_(false) {}
+
+  //! Creates memory dependecy structure. numMemObj == 0 disables the tracking
+  bool create(size_t numMemObj);
+
+  //! Returns TRUE if memory dependency tracking is enabled
+  bool enabled() const { return enabled_; }
+
+  //! Notify the tracker about new kernel
+  void newKernel();
+
+  //! Validates memory range on dependency. Returns TRUE if the caches have to be flushed
+  bool validate(uint64_t start,       //!< Start address of the memory range
+                uint64_t end,         //!< End address of the memory range
+                bool readOnly,        //!< The range is read-only in the current kernel
+                bool skipCheck = false  //!< Track the range only, without the hazard check
+                );
+
+  //! Clear memory dependency
+  void clear(bool all = true);
+
+  //! Returns the description of the tracked ranges for the diagnostics
+  std::string state() const;
+
+ private:
+  struct MemoryState {
+    uint64_t start_;  //! Busy memory start address
+    uint64_t end_;    //! Busy memory end address
+    bool readOnly_;   //! Current GPU state in the queue
+  };
+
+  RangeSet readRanges_;                  //!< Read-only ranges, used by the previous kernels
+  RangeSet writeRanges_;                 //!< Written ranges, used by the previous kernels
+  std::vector<MemoryState> curKernel_;   //!< Memory objects of the current kernel
+  bool enabled_;                         //!< Memory dependency tracking is enabled
+};
+
+}  // namespace device
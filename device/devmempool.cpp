@@ -0,0 +1,183 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/devmempool.hpp"
+#include "device/device.hpp"
+#include "platform/command.hpp"
+#include "platform/memory.hpp"
+#include "utils/debug.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace device {
+
+//! The allocation sizes are rounded up to the granularity, so the close sizes share blocks
+static constexpr size_t kGranularity = 256;
+
+// ================================================================================================
+MemoryPool::MemoryPool(amd::Context& context, amd::Device& device, size_t releaseThreshold)
+    : context_(context),
+      device_(device),
+      releaseThreshold_(releaseThreshold),
+      usedSize_(0),
+      freeSize_(0),
+      lock_("Memory pool lock", true) {}
+
+// ================================================================================================
+MemoryPool::~MemoryPool() {
+  // The last uses of the free blocks can be still in flight
+  for (auto& it : freeBlocks_) {
+    it.second.queue_->waitTimeline(it.second.value_);
+    it.second.queue_->release();
+    amd::SvmBuffer::free(context_, it.second.ptr_);
+  }
+  if (usedSize_ != 0) {
+    LogPrintfWarning("Memory pool is destroyed with %zu bytes in use", usedSize_);
+  }
+}
+
+// ================================================================================================
+void* MemoryPool::findBlock(amd::HostQueue& queue, size_t size, Block* pending) {
+  // Don't waste more than a half of the block
+  for (auto it = freeBlocks_.lower_bound(size);
+       (it != freeBlocks_.end()) && (it->first <= 2 * size); ++it) {
+    Block& block = it->second;
+    if (isReady(block, queue)) {
+      block.queue_->release();
+    } else if (pending != nullptr) {
+      // The caller takes the queue reference for the wait
+      *pending = block;
+    } else {
+      continue;
+    }
+    void* ptr = block.ptr_;
+    allocations_[ptr] = it->first;
+    usedSize_ += it->first;
+    freeSize_ -= it->first;
+    freeBlocks_.erase(it);
+    return ptr;
+  }
+  return nullptr;
+}
+
+// ================================================================================================
+void MemoryPool::waitBlock(amd::HostQueue& queue, const Block& block) {
+  // The use on the current queue must wait for the last use on the other queue
+  amd::Command* marker = new amd::Marker(queue, false);
+  if ((marker != nullptr) && marker->addTimelineWait(*block.queue_, block.value_)) {
+    marker->enqueue();
+  } else {
+    block.queue_->waitTimeline(block.value_);
+  }
+  if (marker != nullptr) {
+    marker->release();
+  }
+  block.queue_->release();
+}
+
+// ================================================================================================
+void* MemoryPool::allocate(amd::HostQueue& queue, size_t size) {
+  size = amd::alignUp(std::max(size, static_cast<size_t>(1)), kGranularity);
+  {
+    amd::ScopedLock lock(lock_);
+    void* ptr = findBlock(queue, size, nullptr);
+    if (ptr != nullptr) {
+      return ptr;
+    }
+  }
+
+  void* ptr = amd::SvmBuffer::malloc(context_, 0, size, device_.info().memBaseAddrAlign_,
+                                     &device_);
+  if (ptr == nullptr) {
+    // Release the free blocks, which are not in use anymore, and try again
+    trim(0);
+    ptr = amd::SvmBuffer::malloc(context_, 0, size, device_.info().memBaseAddrAlign_, &device_);
+  }
+
+  if (ptr == nullptr) {
+    // The last resort is a block, which is still in use on another queue
+    Block pending = {nullptr, nullptr, 0};
+    {
+      amd::ScopedLock lock(lock_);
+      ptr = findBlock(queue, size, &pending);
+    }
+    if (pending.queue_ != nullptr) {
+      waitBlock(queue, pending);
+    }
+    return ptr;
+  }
+
+  amd::ScopedLock lock(lock_);
+  allocations_[ptr] = size;
+  usedSize_ += size;
+  return ptr;
+}
+
+// ================================================================================================
+bool MemoryPool::free(amd::HostQueue& queue, void* ptr) {
+  {
+    amd::ScopedLock lock(lock_);
+    auto it = allocations_.find(ptr);
+    if (it == allocations_.end()) {
+      return false;
+    }
+    const size_t size = it->second;
+    allocations_.erase(it);
+    usedSize_ -= size;
+
+    // The block is free after all commands, which are already enqueued into the queue
+    queue.retain();
+    freeBlocks_.insert(std::make_pair(size, Block{ptr, &queue, queue.timelineValue()}));
+    freeSize_ += size;
+    if (freeSize_ <= releaseThreshold_) {
+      return true;
+    }
+  }
+  trim(releaseThreshold_);
+  return true;
+}
+
+// ================================================================================================
+void MemoryPool::trim(size_t minBytesToKeep) {
+  std::vector<void*> released;
+  {
+    amd::ScopedLock lock(lock_);
+    // Release the biggest blocks first, so the pool keeps more blocks for the reuse
+    auto it = freeBlocks_.end();
+    while ((freeSize_ > minBytesToKeep) && (it != freeBlocks_.begin())) {
+      --it;
+      Block& block = it->second;
+      if (block.queue_->isTimelineReached(block.value_)) {
+        block.queue_->release();
+        released.push_back(block.ptr_);
+        freeSize_ -= it->first;
+        it = freeBlocks_.erase(it);
+      }
+    }
+  }
+
+  // The memory release can be slow, hence it's done outside of the lock
+  for (auto ptr : released) {
+    amd::SvmBuffer::free(context_, ptr);
+  }
+}
+
+}  // namespace device
@@ -0,0 +1,99 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+#include "thread/monitor.hpp"
+#include "platform/commandqueue.hpp"
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+namespace device {
+
+//! Stream ordered pool of device memory. The free doesn't release the memory, but records
+//! the timeline point of the queue, after which the block is free in the queue order.
+//! The block is reused right away on the same queue, since the queue executes in order,
+//! and on other queues after the point was reached. If the pool has to reuse a pending block
+//! on another queue, then a marker, which waits for the point, is enqueued before the use.
+//! The free blocks over the release threshold are returned to the device.
+class MemoryPool : public amd::HeapObject {
+ public:
+  //! Default constructor
+  MemoryPool(amd::Context& context, amd::Device& device, size_t releaseThreshold = 0);
+
+  //! Default destructor, releases all free blocks
+  ~MemoryPool();
+
+  //! Allocates memory in the order of the queue. Returns nullptr on failure
+  void* allocate(amd::HostQueue& queue, size_t size);
+
+  //! Frees memory in the order of the queue. Returns FALSE if the pool doesn't own the pointer
+  bool free(amd::HostQueue& queue, void* ptr);
+
+  //! Releases the completed free blocks until the pool keeps the requested amount of memory
+  void trim(size_t minBytesToKeep);
+
+  //! Sets the amount of free memory, which the pool keeps for the reuse
+  void setReleaseThreshold(size_t size) { releaseThreshold_ = size; }
+
+  //! Returns the amount of free memory, which the pool keeps for the reuse
+  size_t releaseThreshold() const { return releaseThreshold_; }
+
+  //! Returns the amount of the allocated memory, used by the application
+  size_t usedSize() const { return usedSize_; }
+
+  //! Returns the amount of the free memory, kept in the pool
+  size_t freeSize() const { return freeSize_; }
+
+ private:
+  //! The free block with the timeline point of the queue, after which the block is free
+  struct Block {
+    void* ptr_;               //!< The allocation
+    amd::HostQueue* queue_;   //!< The queue of the free
+    uint64_t value_;          //!< The timeline value of the queue
+  };
+
+  //! Returns TRUE if the free block can be used without a wait on the queue
+  static bool isReady(const Block& block, const amd::HostQueue& queue) {
+    return (block.queue_ == &queue) || block.queue_->isTimelineReached(block.value_);
+  }
+
+  //! Finds a free block for the size and the queue, must be called under the lock.
+  //! A block, which isn't ready on the queue, is taken only if \a pending is provided
+  void* findBlock(amd::HostQueue& queue, size_t size, Block* pending);
+
+  //! Makes the queue wait for the last use of the block on another queue
+  static void waitBlock(amd::HostQueue& queue, const Block& block);
+
+  amd::Context& context_;   //!< The context of the allocations
+  amd::Device& device_;     //!< The device of the allocations
+  size_t releaseThreshold_; //!< The free memory, kept for the reuse
+  size_t usedSize_;         //!< The memory, allocated by the application
+  size_t freeSize_;         //!< The free memory in the pool
+
+  std::multimap<size_t, Block> freeBlocks_;        //!< Free blocks, indexed by the size
+  std::unordered_map<void*, size_t> allocations_;  //!< Allocated blocks with their sizes
+  amd::Monitor lock_;                              //!< Lock for the pool access
+};
+
+}  // namespace device
@@ -0,0 +1,303 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/devmetrics.hpp"
+#include "device/device.hpp"
+#include "os/os.hpp"
+#include "thread/thread.hpp"
+#include "utils/debug.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+
+namespace device {
+
+amd::Monitor MetricsRegistry::lock_("Metrics registry lock");
+std::vector<MetricsRegistry::Entry> MetricsRegistry::devices_;
+std::vector<MetricsRegistry::Entry> MetricsRegistry::queues_;
+Metrics MetricsRegistry::process_;
+bool MetricsRegistry::dumpStarted_ = false;
+
+//! The names of the counters in the dump
+static constexpr const char* kMetricNames[VDI_METRIC_NUMBER] = {
+    "dispatches", "kernarg_bytes", "dependency_barriers", "staging_bytes",  "pin_calls",
+    "unpin_calls", "queue_wakeups", "signal_waits", "signal_wait_ns", "scratch_bytes",
+    "signal_wrap_waits", "signal_pool_grows"};
+
+//! The names of the memory categories in the dump
+static constexpr const char* kMemoryNames[VDI_MEMORY_NUMBER] = {
+    "user", "staging", "map_cache", "kernarg", "scratch", "printf", "hostcall", "code",
+    "resource_cache"};
+
+//! The thread, which prints the metrics on the interval
+class MetricsDumpThread : public amd::Thread {
+ public:
+  MetricsDumpThread() : amd::Thread("Metrics Dump", CQ_THREAD_STACK_SIZE) {}
+
+  //! The dump thread entry point
+  void run(void* data) { MetricsRegistry::dumpLoop(); }
+};
+
+// ================================================================================================
+void Metrics::addWait(uint64_t ns) {
+  if (AMD_METRICS) {
+    counters_[VDI_METRIC_SIGNAL_WAITS].fetch_add(1, std::memory_order_relaxed);
+    counters_[VDI_METRIC_SIGNAL_WAIT_NS].fetch_add(ns, std::memory_order_relaxed);
+    uint bucket = 0;
+    while (((ns >> 1) != 0) && (bucket < (VDI_METRICS_HISTOGRAM_BUCKETS - 1))) {
+      ns >>= 1;
+      ++bucket;
+    }
+    waitHistogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// ================================================================================================
+void Metrics::read(vdi_metrics_t* snapshot) const {
+  for (uint i = 0; i < VDI_METRIC_NUMBER; ++i) {
+    snapshot->counters[i] += counters_[i].load(std::memory_order_relaxed);
+  }
+  for (uint i = 0; i < VDI_METRICS_HISTOGRAM_BUCKETS; ++i) {
+    snapshot->wait_histogram[i] += waitHistogram_[i].load(std::memory_order_relaxed);
+  }
+}
+
+// ================================================================================================
+void Metrics::accumulate(const Metrics& other) {
+  for (uint i = 0; i < VDI_METRIC_NUMBER; ++i) {
+    counters_[i].fetch_add(other.counters_[i].load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+  }
+  for (uint i = 0; i < VDI_METRICS_HISTOGRAM_BUCKETS; ++i) {
+    waitHistogram_[i].fetch_add(other.waitHistogram_[i].load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+  }
+}
+
+// ================================================================================================
+void Metrics::reset() {
+  for (auto& counter : counters_) {
+    counter.store(0, std::memory_order_relaxed);
+  }
+  for (auto& bucket : waitHistogram_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+// ================================================================================================
+void MemoryUsage::read(vdi_memory_usage_t* snapshot) const {
+  for (uint i = 0; i < VDI_MEMORY_NUMBER; ++i) {
+    snapshot->current[i] += current_[i].load(std::memory_order_relaxed);
+    snapshot->peak[i] += peak_[i].load(std::memory_order_relaxed);
+    snapshot->allocations[i] += allocations_[i].load(std::memory_order_relaxed);
+  }
+}
+
+// ================================================================================================
+void MemoryUsage::report(uint32_t device, size_t size) const {
+  std::string usage;
+  char entry[64];
+  for (uint i = 0; i < VDI_MEMORY_NUMBER; ++i) {
+    snprintf(entry, sizeof(entry), " %s=%" PRIu64 "KB", kMemoryNames[i],
+             current_[i].load(std::memory_order_relaxed) / Ki);
+    usage.append(entry);
+  }
+  LogPrintfError("Out of memory on device %u, requested %zu bytes. Memory usage:%s", device,
+                 size, usage.c_str());
+}
+
+// ================================================================================================
+void MetricsRegistry::addDevice(const amd::Device* device, Metrics* metrics,
+                                MemoryUsage* memory) {
+  amd::ScopedLock lock(lock_);
+  devices_.push_back({device, metrics, memory});
+
+  if (!dumpStarted_ && AMD_METRICS && (AMD_METRICS_DUMP_INTERVAL != 0)) {
+    dumpStarted_ = true;
+    MetricsDumpThread* thread = new MetricsDumpThread();
+    if ((thread == nullptr) || (thread->state() < amd::Thread::INITIALIZED) ||
+        !thread->start()) {
+      LogWarning("Metrics dump thread creation failed");
+      delete thread;
+    }
+  }
+}
+
+// ================================================================================================
+void MetricsRegistry::removeDevice(const amd::Device* device) {
+  amd::ScopedLock lock(lock_);
+  for (auto it = devices_.begin(); it != devices_.end(); ++it) {
+    if (it->owner_ == device) {
+      process_.accumulate(*it->metrics_);
+      devices_.erase(it);
+      break;
+    }
+  }
+}
+
+// ================================================================================================
+void MetricsRegistry::addQueue(const VirtualDevice* queue, Metrics* metrics) {
+  amd::ScopedLock lock(lock_);
+  queues_.push_back({queue, metrics, nullptr});
+}
+
+// ================================================================================================
+void MetricsRegistry::removeQueue(const VirtualDevice* queue) {
+  amd::ScopedLock lock(lock_);
+  for (auto it = queues_.begin(); it != queues_.end(); ++it) {
+    if (it->owner_ == queue) {
+      // Keep the queue events in the device total
+      const amd::Device* device = &queue->device();
+      Metrics* total = &process_;
+      for (const auto& entry : devices_) {
+        if (entry.owner_ == device) {
+          total = entry.metrics_;
+          break;
+        }
+      }
+      total->accumulate(*it->metrics_);
+      queues_.erase(it);
+      break;
+    }
+  }
+}
+
+// ================================================================================================
+bool MetricsRegistry::query(uint32_t device, uint32_t queue, vdi_metrics_t* snapshot) {
+  if (snapshot == nullptr) {
+    return false;
+  }
+  *snapshot = {};
+  snapshot->version = VDI_METRICS_VERSION_1_0;
+  snapshot->num_counters = VDI_METRIC_NUMBER;
+
+  amd::ScopedLock lock(lock_);
+  bool found = (device == VDI_METRICS_ALL);
+  if (found) {
+    process_.read(snapshot);
+  }
+  for (const auto& entry : devices_) {
+    const amd::Device* dev = reinterpret_cast<const amd::Device*>(entry.owner_);
+    if ((device == VDI_METRICS_ALL) || ((dev->index() == device) && (queue == VDI_METRICS_ALL))) {
+      entry.metrics_->read(snapshot);
+      found = true;
+    }
+  }
+  for (const auto& entry : queues_) {
+    const VirtualDevice* vdev = reinterpret_cast<const VirtualDevice*>(entry.owner_);
+    if ((device == VDI_METRICS_ALL) ||
+        ((vdev->device().index() == device) &&
+         ((queue == VDI_METRICS_ALL) || (vdev->index() == queue)))) {
+      entry.metrics_->read(snapshot);
+      found = true;
+    }
+  }
+  return found;
+}
+
+// ================================================================================================
+bool MetricsRegistry::queryMemory(uint32_t device, vdi_memory_usage_t* snapshot) {
+  if (snapshot == nullptr) {
+    return false;
+  }
+  *snapshot = {};
+  snapshot->version = VDI_MEMORY_USAGE_VERSION_1_0;
+  snapshot->num_types = VDI_MEMORY_NUMBER;
+
+  amd::ScopedLock lock(lock_);
+  bool found = false;
+  for (const auto& entry : devices_) {
+    const amd::Device* dev = reinterpret_cast<const amd::Device*>(entry.owner_);
+    if ((device == VDI_METRICS_ALL) || (dev->index() == device)) {
+      entry.memory_->read(snapshot);
+      found = true;
+    }
+  }
+  return found;
+}
+
+// ================================================================================================
+void MetricsRegistry::reset() {
+  amd::ScopedLock lock(lock_);
+  process_.reset();
+  for (const auto& entry : devices_) {
+    entry.metrics_->reset();
+  }
+  for (const auto& entry : queues_) {
+    entry.metrics_->reset();
+  }
+}
+
+// ================================================================================================
+void MetricsRegistry::dump() {
+  std::vector<uint32_t> devices;
+  {
+    amd::ScopedLock lock(lock_);
+    for (const auto& entry : devices_) {
+      devices.push_back(reinterpret_cast<const amd::Device*>(entry.owner_)->index());
+    }
+  }
+  for (auto index : devices) {
+    vdi_metrics_t snapshot;
+    if (!query(index, VDI_METRICS_ALL, &snapshot)) {
+      continue;
+    }
+    fprintf(amd::outFile, "Metrics of device %u:", index);
+    for (uint i = 0; i < VDI_METRIC_NUMBER; ++i) {
+      fprintf(amd::outFile, " %s=%" PRIu64, kMetricNames[i], snapshot.counters[i]);
+    }
+    fprintf(amd::outFile, "\n");
+
+    vdi_memory_usage_t usage;
+    if (queryMemory(index, &usage)) {
+      fprintf(amd::outFile, "Memory usage of device %u:", index);
+      for (uint i = 0; i < VDI_MEMORY_NUMBER; ++i) {
+        fprintf(amd::outFile, " %s=%" PRIu64 "/%" PRIu64, kMemoryNames[i], usage.current[i],
+                usage.peak[i]);
+      }
+      fprintf(amd::outFile, "\n");
+    }
+  }
+  fflush(amd::outFile);
+}
+
+// ================================================================================================
+void MetricsRegistry::dumpLoop() {
+  while (true) {
+    amd::Os::sleep(AMD_METRICS_DUMP_INTERVAL);
+    dump();
+  }
+}
+
+}  // namespace device
+
+// ================================================================================================
+int32_t vdiMetricsQuery(uint32_t device, uint32_t queue, vdi_metrics_t* metrics) {
+  return device::MetricsRegistry::query(device, queue, metrics) ? 0 : -1;
+}
+
+// ================================================================================================
+void vdiMetricsReset(void) { device::MetricsRegistry::reset(); }
+
+// ================================================================================================
+int32_t vdiMemoryUsageQuery(uint32_t device, vdi_memory_usage_t* usage) {
+  return device::MetricsRegistry::queryMemory(device, usage) ? 0 : -1;
+}
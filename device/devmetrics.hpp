@@ -0,0 +1,158 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+#include "thread/monitor.hpp"
+#include "utils/flags.hpp"
+#include "vdi_metrics_amd.h"
+
+#include <atomic>
+#include <vector>
+
+namespace amd {
+class Device;
+}
+
+namespace device {
+
+class VirtualDevice;
+
+//! Atomic counters and the wait time histogram of the runtime events.
+//! An update is a relaxed atomic add on the owner's cache line, so the metrics stay always on
+class Metrics : public amd::EmbeddedObject {
+ public:
+  Metrics() { reset(); }
+
+  //! Adds the value to the counter
+  void add(vdi_metric_t counter, uint64_t value = 1) {
+    if (AMD_METRICS) {
+      counters_[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+  }
+
+  //! Records a signal wait of the duration in ns
+  void addWait(uint64_t ns);
+
+  //! Adds the metrics into the snapshot
+  void read(vdi_metrics_t* snapshot) const;
+
+  //! Adds the metrics of another object, so the metrics outlive the destroyed object
+  void accumulate(const Metrics& other);
+
+  //! Sets all metrics to zero
+  void reset();
+
+ private:
+  std::atomic<uint64_t> counters_[VDI_METRIC_NUMBER];                    //!< Event counters
+  std::atomic<uint64_t> waitHistogram_[VDI_METRICS_HISTOGRAM_BUCKETS];  //!< Wait time buckets
+};
+
+//! Per category accounting of the device memory usage. The updates are relaxed atomics,
+//! so the accounting is always on and the report is available on an allocation failure
+class MemoryUsage : public amd::EmbeddedObject {
+ public:
+  MemoryUsage() {
+    for (uint i = 0; i < VDI_MEMORY_NUMBER; ++i) {
+      current_[i].store(0, std::memory_order_relaxed);
+      peak_[i].store(0, std::memory_order_relaxed);
+      allocations_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  //! Accounts an allocation of the category
+  void add(vdi_memory_type_t type, size_t size) {
+    const uint64_t current = current_[type].fetch_add(size, std::memory_order_relaxed) + size;
+    allocations_[type].fetch_add(1, std::memory_order_relaxed);
+    uint64_t peak = peak_[type].load(std::memory_order_relaxed);
+    while ((current > peak) &&
+           !peak_[type].compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+    }
+  }
+
+  //! Accounts a release of the category
+  void remove(vdi_memory_type_t type, size_t size) {
+    current_[type].fetch_sub(size, std::memory_order_relaxed);
+  }
+
+  //! Adds the usage into the snapshot
+  void read(vdi_memory_usage_t* snapshot) const;
+
+  //! Prints the usage of the device, i.e. on an allocation failure of the size
+  void report(uint32_t device, size_t size) const;
+
+ private:
+  std::atomic<uint64_t> current_[VDI_MEMORY_NUMBER];      //!< The allocated bytes
+  std::atomic<uint64_t> peak_[VDI_MEMORY_NUMBER];         //!< The peak of the allocated bytes
+  std::atomic<uint64_t> allocations_[VDI_MEMORY_NUMBER];  //!< The number of the allocations
+};
+
+//! Registry of the device and the queue metrics for the queries and the periodic dump
+class MetricsRegistry : public amd::AllStatic {
+ public:
+  //! Returns the metrics of the events without a device context
+  static Metrics& process() { return process_; }
+
+  //! Registers the device metrics and memory usage
+  static void addDevice(const amd::Device* device, Metrics* metrics, MemoryUsage* memory);
+
+  //! Removes the device metrics and keeps them in the process total
+  static void removeDevice(const amd::Device* device);
+
+  //! Registers the queue metrics
+  static void addQueue(const VirtualDevice* queue, Metrics* metrics);
+
+  //! Removes the queue metrics and keeps them in the device total
+  static void removeQueue(const VirtualDevice* queue);
+
+  //! Returns the snapshot of the metrics. VDI_METRICS_ALL selects all queues or all devices
+  static bool query(uint32_t device, uint32_t queue, vdi_metrics_t* snapshot);
+
+  //! Returns the memory usage of the device. VDI_METRICS_ALL sums all devices
+  static bool queryMemory(uint32_t device, vdi_memory_usage_t* snapshot);
+
+  //! Sets all metrics to zero
+  static void reset();
+
+  //! Prints the metrics of all devices and queues
+  static void dump();
+
+ private:
+  //! Registered metrics of a device or a queue
+  struct Entry {
+    const void* owner_;    //!< amd::Device or VirtualDevice object
+    Metrics* metrics_;     //!< The metrics of the owner
+    MemoryUsage* memory_;  //!< The memory usage of the device or nullptr for a queue
+  };
+
+  //! Prints the metrics periodically
+  static void dumpLoop();
+
+  friend class MetricsDumpThread;
+
+  static amd::Monitor lock_;           //!< Lock for the registry
+  static std::vector<Entry> devices_;  //!< Registered devices
+  static std::vector<Entry> queues_;   //!< Registered queues
+  static Metrics process_;             //!< Metrics without context and of destroyed devices
+  static bool dumpStarted_;            //!< The dump thread was started
+};
+
+}  // namespace device
@@ -0,0 +1,452 @@
+/* Copyright (c) 2010 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/devprintf.hpp"
+#include "utils/debug.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace device {
+
+//! The output is written to stdout in chunks of this size
+static constexpr size_t kOutputChunkSize = 64 * Ki;
+
+//! Formats the value into the output
+template <typename T>
+static void appendFormat(std::string& out, const std::string& fmt, T value) {
+  char local[256];
+  int length = snprintf(local, sizeof(local), fmt.c_str(), value);
+  if (length < 0) {
+    return;
+  }
+  if (static_cast<size_t>(length) < sizeof(local)) {
+    out.append(local, length);
+  } else {
+    size_t pos = out.size();
+    out.resize(pos + length + 1);
+    snprintf(&out[pos], length + 1, fmt.c_str(), value);
+    out.resize(pos + length);
+  }
+}
+
+// ================================================================================================
+bool PrintfDecoder::checkFloat(const std::string& fmt) const {
+  switch (fmt[fmt.size() - 1]) {
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'g':
+    case 'G':
+    case 'a':
+      return true;
+      break;
+    default:
+      break;
+  }
+  return false;
+}
+
+// ================================================================================================
+bool PrintfDecoder::checkString(const std::string& fmt) const {
+  if (fmt[fmt.size() - 1] == 's') return true;
+  return false;
+}
+
+// ================================================================================================
+int PrintfDecoder::checkVectorSpecifier(const std::string& fmt, size_t startPos,
+                                        size_t& curPos) const {
+  int vectorSize = 0;
+  size_t pos = curPos;
+  size_t size = curPos - startPos;
+
+  if (size >= 3) {
+    size = 0;
+    // no modifiers
+    if (fmt[curPos - 3] == 'v') {
+      size = 2;
+    }
+    // the modifiers are "h" or "l"
+    else if (fmt[curPos - 4] == 'v') {
+      size = 3;
+    }
+    // the modifier is "hh"
+    else if ((curPos >= 5) && (fmt[curPos - 5] == 'v')) {
+      size = 4;
+    }
+    if (size > 0) {
+      curPos = size;
+      pos -= curPos;
+
+      // Get vector size
+      vectorSize = fmt[pos++] - '0';
+      // PrintfDbg supports only 2, 3, 4, 8 and 16 wide vectors
+      switch (vectorSize) {
+        case 1:
+          if ((fmt[pos++] - '0') == 6) {
+            vectorSize = 16;
+          } else {
+            vectorSize = 0;
+          }
+          break;
+        case 2:
+        case 3:
+        case 4:
+        case 8:
+          break;
+        default:
+          vectorSize = 0;
+          break;
+      }
+    }
+  }
+
+  return vectorSize;
+}
+
+// ================================================================================================
+void PrintfDecoder::initSpec(const std::string& fmt, PrintfSpec& spec) const {
+  spec.fmt_ = fmt;
+  spec.string_ = !fmt.empty() && checkString(fmt);
+  spec.hhModifier_ = (fmt.find("hh") != std::string::npos);
+
+  // current implementation of printf in gcc 4.5.2 runtime libraries,
+  // doesn`t recognize "hh" modifier ==>
+  // argument should be explicitly converted to  unsigned char (uchar)
+  // before printing and
+  // fmt should be updated not to contain "hh" modifier
+  spec.plain_ = fmt;
+  if (spec.hhModifier_) {
+    spec.plain_.erase(spec.plain_.find_first_of("h"), 2);
+  } else if (fmt.find("hl") != std::string::npos) {
+    spec.plain_.erase(spec.plain_.find_first_of("hl"), 2);
+  }
+
+  // Use 'll' for 64 bit printf
+  spec.fmt64_ = fmt;
+  if (!fmt.empty()) {
+    spec.fmt64_.insert((spec.fmt64_.size() - 1), 1, 'l');
+  }
+
+  // Infinity and nan are printed as strings
+  static const char* fSpecifiers = "eEfgGa";
+  spec.special_ = fmt;
+  size_t posS = spec.special_.find_first_of("%");
+  size_t posE = spec.special_.find_first_of(fSpecifiers);
+  if (posS != std::string::npos && posE != std::string::npos) {
+    spec.special_.replace(posS + 1, posE - posS, "s");
+  }
+}
+
+// ================================================================================================
+size_t PrintfDecoder::outputArgument(const PrintfSpec& spec, bool printFloat, size_t size,
+                                     const uint32_t* argument, std::string& out) const {
+  size_t copiedBytes = size;
+  // Print the string argument
+  if (spec.string_) {
+    // copiedBytes should be as number of printed chars
+    copiedBytes = 0;
+    //(null) should be printed
+    if (*argument == 0) {
+      appendFormat(out, spec.fmt_, static_cast<const char*>(nullptr));
+      // copiedBytes = strlen("(null)")
+      copiedBytes = 6;
+    } else {
+      const char* argumentStr = reinterpret_cast<const char*>(argument);
+      appendFormat(out, spec.fmt_, argumentStr);
+      // copiedBytes = strlen(argumentStr)
+      copiedBytes = strlen(argumentStr) + 1;
+    }
+    return copiedBytes;
+  }
+
+  // Print the argument(except for string)
+  switch (size) {
+    case 0: {
+      const char* str = reinterpret_cast<const char*>(argument);
+      appendFormat(out, spec.fmt_, str);
+      // Find the string length
+      copiedBytes = strlen(str) + 1;
+    } break;
+    case 1:
+      appendFormat(out, spec.fmt_, *(reinterpret_cast<const unsigned char*>(argument)));
+      break;
+    case 2:
+    case 4:
+      if (printFloat) {
+        float fArg = *(reinterpret_cast<const float*>(argument));
+        float fSign = std::copysign(1.0f, fArg);
+        if (std::isinf(fArg) && !std::isnan(fArg)) {
+          appendFormat(out, spec.special_, (fSign < 0) ? "-infinity" : "infinity");
+        } else if (std::isnan(fArg)) {
+          appendFormat(out, spec.special_, (fSign < 0) ? "-nan" : "nan");
+        } else {
+          appendFormat(out, spec.plain_, fArg);
+        }
+      } else if (spec.hhModifier_) {
+        appendFormat(out, spec.plain_, *(reinterpret_cast<const unsigned char*>(argument)));
+      } else {
+        appendFormat(out, spec.plain_, *argument);
+      }
+      break;
+    case 8:
+      if (printFloat) {
+        appendFormat(out, spec.plain_, *(reinterpret_cast<const double*>(argument)));
+      } else {
+        appendFormat(out, spec.fmt64_, *(reinterpret_cast<const uint64_t*>(argument)));
+      }
+      break;
+    default:
+      appendFormat(out, std::string("Error: Unsupported data size for PrintfDbg. %d bytes"),
+                   static_cast<int>(size));
+      return 0;
+  }
+  return copiedBytes;
+}
+
+// ================================================================================================
+void PrintfDecoder::parseFormat(const PrintfInfo& info, PrintfFormat& format) const {
+  // The record holds the PrintfID and the arguments
+  format.recordSize_ = sizeof(uint32_t);
+  for (const auto& size : info.arguments_) {
+    format.recordSize_ += size;
+  }
+
+  static const char* specifiers = "cdieEfgGaosuxXp";
+  static const char* modifiers = "hl";
+  static const char* special = "%n";
+  size_t pos = 0;
+
+  // Find the format string
+  std::string str = info.fmtString_;
+  std::string fmt;
+  size_t posStart, posEnd;
+
+  // Split all arguments
+  // Note: the following code walks through all arguments, provided by the
+  // kernel and
+  // finds the corresponding specifier in the format string.
+  // Then it splits the original string into substrings with a single specifier,
+  // so the output can use standard PrintfDbg() to print each argument
+  for (uint j = 0; j < info.arguments_.size(); ++j) {
+    do {
+      posStart = str.find_first_of("%", pos);
+      if (posStart != std::string::npos) {
+        posStart++;
+        // Erase all spaces after %
+        while (str[posStart] == ' ') {
+          str.erase(posStart, 1);
+        }
+        size_t tmp = str.find_first_of(special, posStart);
+        size_t tmp2 = str.find_first_of(specifiers, posStart);
+        // Special cases. Special symbol is located before any specifier
+        if (tmp < tmp2) {
+          posEnd = posStart + 1;
+          fmt = str.substr(pos, posEnd - pos);
+          fmt.erase(posStart - pos - 1, 1);
+          pos = posStart = posEnd;
+          format.ops_.push_back({PrintfOp::Literal, fmt});
+          continue;
+        }
+        break;
+      } else if (pos < str.length()) {
+        format.ops_.push_back({PrintfOp::Literal, str.substr(pos)});
+      }
+    } while (posStart != std::string::npos);
+
+    if (posStart != std::string::npos) {
+      PrintfOp op = {PrintfOp::Argument};
+      size_t idPos = 0;
+
+      // Search for PrintfDbg specifier in the format string.
+      // It will be a split point for the output
+      posEnd = str.find_first_of(specifiers, posStart);
+      if (posEnd == std::string::npos) {
+        return;
+      }
+      posEnd++;
+
+      size_t curPos = posEnd;
+      op.vectorSize_ = checkVectorSpecifier(str, posStart, curPos);
+
+      // Get substring from the last position to the current specifier
+      fmt = str.substr(pos, posEnd - pos);
+
+      // Readjust the string pointer if PrintfDbg outputs a vector
+      if (op.vectorSize_ != 0) {
+        size_t posVecSpec = fmt.length() - (curPos + 1);
+        size_t posVecMod = fmt.find_first_of(modifiers, posVecSpec + 1);
+        size_t posMod = str.find_first_of(modifiers, posStart);
+        if (posMod < posEnd) {
+          fmt = fmt.erase(posVecSpec, posVecMod - posVecSpec);
+        } else {
+          fmt = fmt.erase(posVecSpec, curPos);
+        }
+        idPos = posStart - pos - 1;
+        op.elementFmt_ = fmt.substr(idPos, fmt.size());
+      }
+      pos = posStart = posEnd;
+
+      // Find out if the argument is a float
+      op.printFloat_ = checkFloat(fmt);
+      op.fmt_ = fmt;
+      initSpec(op.fmt_, op.spec_);
+      initSpec(op.elementFmt_, op.elementSpec_);
+      format.ops_.push_back(op);
+    } else {
+      format.ops_.push_back({PrintfOp::Mismatch});
+      return;
+    }
+  }
+
+  if (pos != std::string::npos) {
+    format.ops_.push_back({PrintfOp::Literal, str.substr(pos, str.size() - pos)});
+  }
+}
+
+// ================================================================================================
+const PrintfDecoder::PrintfFormat& PrintfDecoder::findFormat(const PrintfInfo& info) {
+  // The key includes the number of arguments, since the split depends on it
+  std::string key = info.fmtString_;
+  key.push_back('\0');
+  key.append(std::to_string(info.arguments_.size()));
+  auto it = formatCache_.find(key);
+  if (it == formatCache_.end()) {
+    it = formatCache_.emplace(std::move(key), PrintfFormat()).first;
+    parseFormat(info, it->second);
+  }
+  return it->second;
+}
+
+// ================================================================================================
+void PrintfDecoder::outputRecord(const PrintfInfo& info, const PrintfFormat& format,
+                                 const uint32_t* workitemData, size_t& i, std::string& out) const {
+  const uint32_t* s = workitemData;
+  uint j = 0;
+
+  // Print all arguments with the substrings of the parsed format string
+  for (const auto& op : format.ops_) {
+    switch (op.kind_) {
+      case PrintfOp::Literal:
+        out.append(op.fmt_);
+        break;
+      case PrintfOp::Mismatch:
+        appendFormat(out, std::string("Error: The arguments don't match the printf format "
+                                      "string. printf(%s)"), info.fmtString_.data());
+        return;
+      case PrintfOp::Argument:
+        // Is it a scalar value?
+        if (op.vectorSize_ == 0) {
+          size_t length =
+              outputArgument(op.spec_, op.printFloat_, info.arguments_[j], &s[i], out);
+          if (0 == length) {
+            return;
+          }
+          i += amd::alignUp(length, sizeof(uint32_t)) / sizeof(uint32_t);
+        } else {
+          // 3-component vector's size is defined as 4 * size of each scalar
+          // component
+          size_t elemSize = info.arguments_[j] / (op.vectorSize_ == 3 ? 4 : op.vectorSize_);
+          size_t k = i * sizeof(uint32_t);
+
+          // Print first element with full string
+          if (0 == outputArgument(op.spec_, op.printFloat_, elemSize, &s[i], out)) {
+            return;
+          }
+
+          // Print other elemnts with separator if available
+          for (int e = 1; e < op.vectorSize_; ++e) {
+            const char* t = reinterpret_cast<const char*>(s);
+            // Output the vector separator
+            out.push_back(',');
+
+            // Output the next element
+            outputArgument(op.elementSpec_, op.printFloat_, elemSize,
+                           reinterpret_cast<const uint32_t*>(&t[k + e * elemSize]), out);
+          }
+          i += (amd::alignUp(info.arguments_[j], sizeof(uint32_t))) / sizeof(uint32_t);
+        }
+        ++j;
+        break;
+    }
+  }
+}
+
+// ================================================================================================
+void PrintfDecoder::outputRecord(const PrintfInfo& info, const uint32_t* data, size_t& i) {
+  outputRecord(info, findFormat(info), data, i, out_);
+  if (out_.size() >= kOutputChunkSize) {
+    flush();
+  }
+}
+
+// ================================================================================================
+bool PrintfDecoder::outputRecords(const std::vector<PrintfInfo>& printfInfo, const uint32_t* data,
+                                  size_t size, size_t* consumed, size_t* maxRecord) {
+  // The parsed formats of the kernel, indexed by PrintfID. The record boundaries come
+  // from the cached record sizes, so the walk doesn't sum the arguments of each record
+  formats_.assign(printfInfo.size(), nullptr);
+  bool result = true;
+  size_t offset = 0;
+  while ((offset + sizeof(uint32_t)) <= size) {
+    const uint32_t* record = data + offset / sizeof(uint32_t);
+    if (*record >= printfInfo.size()) {
+      LogError("Couldn't find the reported PrintfID!");
+      result = false;
+      break;
+    }
+    const PrintfInfo& info = printfInfo[*record];
+    if (formats_[*record] == nullptr) {
+      formats_[*record] = &findFormat(info);
+    }
+    const PrintfFormat& format = *formats_[*record];
+    if ((offset + format.recordSize_) > size) {
+      // The record continues in the next portion of the data
+      break;
+    }
+
+    size_t idx = 1;
+    outputRecord(info, format, record, idx, out_);
+    if (out_.size() >= kOutputChunkSize) {
+      flush();
+    }
+    offset += format.recordSize_;
+    if (maxRecord != nullptr) {
+      *maxRecord = std::max(*maxRecord, format.recordSize_);
+    }
+  }
+  if (consumed != nullptr) {
+    *consumed = offset;
+  }
+  return result;
+}
+
+// ================================================================================================
+void PrintfDecoder::flush() {
+  if (!out_.empty()) {
+    fwrite(out_.data(), 1, out_.size(), stdout);
+    out_.clear();
+  }
+  fflush(stdout);
+}
+
+}  // namespace device
@@ -0,0 +1,146 @@
+/* Copyright (c) 2010 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+#include "device/devkernel.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace device {
+
+//! Decodes the printf records, which the kernels wrote into the debug buffer.
+//! Each record starts with the PrintfID, followed by the arguments. The format strings are
+//! parsed once and the output is formatted into a buffer, so stdout gets a few big writes.
+class PrintfDecoder : public amd::EmbeddedObject {
+ public:
+  PrintfDecoder() {}
+
+  //! Formats a single record into the output
+  void outputRecord(const PrintfInfo& info,  //!< printf info
+                    const uint32_t* data,    //!< The record data after the PrintfID
+                    size_t& i                //!< index to the data in the record
+                    );
+
+  //! Formats the records of the buffer into the output. Returns FALSE on an unknown PrintfID
+  bool outputRecords(const std::vector<PrintfInfo>& printfInfo,  //!< printf info
+                     const uint32_t* data,  //!< The records
+                     size_t size,           //!< The size of the records in bytes
+                     size_t* consumed,      //!< The size of the complete records in bytes
+                     size_t* maxRecord      //!< The size of the biggest record
+                     );
+
+  //! Writes the formatted output to stdout
+  void flush();
+
+ private:
+  //! The format of a single argument with the variants, which the output can choose
+  struct PrintfSpec {
+    std::string fmt_;      //!< The substring of the format string
+    std::string plain_;    //!< The format without the "hh" or "hl" modifiers
+    std::string fmt64_;    //!< The format with the 64 bit integer modifier
+    std::string special_;  //!< The format, which prints infinity and nan as a string
+    bool string_;          //!< The argument is a string
+    bool hhModifier_;      //!< The argument is printed as unsigned char
+  };
+
+  //! A step of the printf output, produced by the format string parsing
+  struct PrintfOp {
+    enum Kind {
+      Literal,   //!< Prints the constant substring
+      Argument,  //!< Prints the next argument with the substring up to its specifier
+      Mismatch   //!< The arguments don't match the format string
+    };
+    Kind kind_;
+    std::string fmt_;         //!< The substring of the format string
+    std::string elementFmt_;  //!< The format of the vector elements after the first one
+    bool printFloat_;         //!< Argument is a float value
+    int vectorSize_;          //!< The vector size or 0 for a scalar argument
+    PrintfSpec spec_;         //!< The argument format
+    PrintfSpec elementSpec_;  //!< The format of the vector elements after the first one
+  };
+
+  //! The parsed format string
+  struct PrintfFormat {
+    std::vector<PrintfOp> ops_;  //!< The output steps
+    size_t recordSize_;          //!< The record size in bytes, including the PrintfID
+  };
+
+  //! Returns TRUE if a float value has to be printed
+  bool checkFloat(const std::string& fmt  //!< Format string
+                  ) const;
+
+  //! Returns TRUE if a string value has to be printed
+  bool checkString(const std::string& fmt  //!< Format string
+                   ) const;
+
+  //! Finds the specifier in the format string
+  int checkVectorSpecifier(const std::string& fmt,  //!< Format string
+                           size_t startPos,         //!< Start position for processing
+                           size_t& curPos           //!< End position for processing
+                           ) const;
+
+  //! Builds the format variants of the argument
+  void initSpec(const std::string& fmt,  //!< Format string
+                PrintfSpec& spec         //!< The argument format
+                ) const;
+
+  //! Formats an argument into the output
+  size_t outputArgument(const PrintfSpec& spec,    //!< The argument format
+                        bool printFloat,           //!< Argument is a float value
+                        size_t size,               //!< Argument's size
+                        const uint32_t* argument,  //!< Argument's location
+                        std::string& out           //!< The output
+                        ) const;
+
+  //! Splits the format string into the output steps
+  void parseFormat(const PrintfInfo& info,  //!< printf info
+                   PrintfFormat& format     //!< The parsed format
+                   ) const;
+
+  //! Returns the parsed format for the printf info, parsing it on the first use
+  const PrintfFormat& findFormat(const PrintfInfo& info  //!< printf info
+                                 );
+
+  //! Formats a single record with the parsed format
+  void outputRecord(const PrintfInfo& info,        //!< printf info
+                    const PrintfFormat& format,    //!< The parsed format
+                    const uint32_t* workitemData,  //!< The record data
+                    size_t& i,                     //!< index to the data in the record
+                    std::string& out               //!< The output
+                    ) const;
+
+  //! The parsed format strings, so the output doesn't scan them for every record
+  std::unordered_map<std::string, PrintfFormat> formatCache_;
+  //! The parsed formats of the current kernel, indexed by PrintfID
+  std::vector<const PrintfFormat*> formats_;
+  std::string out_;  //!< The formatted output, which wasn't written yet
+
+  //! Disable copy constructor
+  PrintfDecoder(const PrintfDecoder&);
+
+  //! Disable assignment
+  PrintfDecoder& operator=(const PrintfDecoder&);
+};
+
+}  // namespace device
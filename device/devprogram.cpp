@@ -23,6 +23,7 @@
 #include "platform/ndrange.hpp"
 #include "devprogram.hpp"
 #include "devkernel.hpp"
+#include "devcodecache.hpp"
 #include "utils/macros.hpp"
 #include "utils/options.hpp"
 #if defined(WITH_COMPILER_LIB)
@@ -308,20 +309,29 @@ void Program::setLanguage(const char* clStd, amd_comgr_language_t* langver) {
 amd_comgr_status_t Program::createAction(const amd_comgr_language_t oclver,
                                          const std::vector<std::string>& options,
                                          amd_comgr_action_info_t* action,
-                                         bool* hasAction) {
+                                         bool* hasAction, std::string* actionKey) {
 
   *hasAction = false;
-  amd_comgr_status_t status = amd::Comgr::create_action_info(action);
+  // The action infos are reused across the compilations with the same language, ISA and options
+  const std::string isaName = device().isa().isaName();
+  *actionKey = std::to_string(oclver) + '\n' + isaName;
+  for (const auto& option : options) {
+    *actionKey += '\n' + option;
+  }
 
-  if (status == AMD_COMGR_STATUS_SUCCESS) {
-    *hasAction = true;
-    if (oclver != AMD_COMGR_LANGUAGE_NONE) {
-      status = amd::Comgr::action_info_set_language(*action, oclver);
-    }
+  bool created = false;
+  amd_comgr_status_t status = amd::Comgr::acquire_action_info(*actionKey, action, &created);
+  if ((status != AMD_COMGR_STATUS_SUCCESS) || !created) {
+    *hasAction = (status == AMD_COMGR_STATUS_SUCCESS);
+    return status;
+  }
+
+  if (oclver != AMD_COMGR_LANGUAGE_NONE) {
+    status = amd::Comgr::action_info_set_language(*action, oclver);
   }
 
   if (status == AMD_COMGR_STATUS_SUCCESS) {
-    status = amd::Comgr::action_info_set_isa_name(*action, device().isa().isaName().c_str());
+    status = amd::Comgr::action_info_set_isa_name(*action, isaName.c_str());
   }
 
   if (status == AMD_COMGR_STATUS_SUCCESS) {
@@ -337,6 +347,13 @@ amd_comgr_status_t Program::createAction(const amd_comgr_language_t oclver,
     status = amd::Comgr::action_info_set_logging(*action, true);
   }
 
+  if (status == AMD_COMGR_STATUS_SUCCESS) {
+    *hasAction = true;
+  } else {
+    // A partially initialized action info can't be reused
+    amd::Comgr::destroy_action_info(*action);
+  }
+
   return status;
 }
 
@@ -344,6 +361,7 @@ bool Program::linkLLVMBitcode(const amd_comgr_data_set_t inputs,
                               const std::vector<std::string>& options, const bool requiredDump,
                               amd::option::Options* amdOptions, amd_comgr_data_set_t* output,
                               char* binaryData[], size_t* binarySize) {
+  amd::InitPhase phase("link bitcode", amd::Timeline::kCompile);
 
   amd_comgr_language_t langver;
   setLanguage(amdOptions->oVariables->CLStd, &langver);
@@ -356,10 +374,11 @@ bool Program::linkLLVMBitcode(const amd_comgr_data_set_t inputs,
   //  Create the action for linking
   amd_comgr_action_info_t action;
   amd_comgr_data_set_t dataSetDevLibs;
+  std::string actionKey;
   bool hasAction = false;
   bool hasDataSetDevLibs = false;
 
-  amd_comgr_status_t status = createAction(langver, options, &action, &hasAction);
+  amd_comgr_status_t status = createAction(langver, options, &action, &hasAction, &actionKey);
 
   if (status == AMD_COMGR_STATUS_SUCCESS) {
     status = amd::Comgr::create_data_set(&dataSetDevLibs);
@@ -367,8 +386,9 @@ bool Program::linkLLVMBitcode(const amd_comgr_data_set_t inputs,
 
   if (status == AMD_COMGR_STATUS_SUCCESS) {
     hasDataSetDevLibs = true;
-    status = amd::Comgr::do_action(AMD_COMGR_ACTION_ADD_DEVICE_LIBRARIES, action, inputs,
-                                   dataSetDevLibs);
+    status = amd::Comgr::do_add_action(AMD_COMGR_ACTION_ADD_DEVICE_LIBRARIES,
+                                       AMD_COMGR_DATA_KIND_BC, actionKey, action, inputs,
+                                       dataSetDevLibs);
     extractBuildLog(dataSetDevLibs);
   }
 
@@ -388,7 +408,7 @@ bool Program::linkLLVMBitcode(const amd_comgr_data_set_t inputs,
   }
 
   if (hasAction) {
-    amd::Comgr::destroy_action_info(action);
+    amd::Comgr::release_action_info(actionKey, action);
   }
 
   if (hasDataSetDevLibs) {
@@ -402,6 +422,7 @@ bool Program::compileToLLVMBitcode(const amd_comgr_data_set_t compileInputs,
                                    const std::vector<std::string>& options,
                                    amd::option::Options* amdOptions,
                                    char* binaryData[], size_t* binarySize) {
+  amd::InitPhase phase("compile to bitcode", amd::Timeline::kCompile);
 
   amd_comgr_language_t langver;
   setLanguage(amdOptions->oVariables->CLStd, &langver);
@@ -416,12 +437,13 @@ bool Program::compileToLLVMBitcode(const amd_comgr_data_set_t compileInputs,
   amd_comgr_data_set_t output{};
   amd_comgr_data_set_t dataSetPCH{};
   amd_comgr_data_set_t input = compileInputs ;
+  std::string actionKey;
 
   bool hasAction = false;
   bool hasOutput = false;
   bool hasDataSetPCH = false;
 
-  amd_comgr_status_t status = createAction(langver, options, &action, &hasAction);
+  amd_comgr_status_t status = createAction(langver, options, &action, &hasAction, &actionKey);
 
   if (status == AMD_COMGR_STATUS_SUCCESS) {
     status = amd::Comgr::create_data_set(&output);
@@ -467,8 +489,9 @@ bool Program::compileToLLVMBitcode(const amd_comgr_data_set_t compileInputs,
 
   if (!isHIP()) {
     if (status == AMD_COMGR_STATUS_SUCCESS) {
-      status = amd::Comgr::do_action(AMD_COMGR_ACTION_ADD_PRECOMPILED_HEADERS,
-                                     action, input, dataSetPCH);
+      status = amd::Comgr::do_add_action(AMD_COMGR_ACTION_ADD_PRECOMPILED_HEADERS,
+                                         AMD_COMGR_DATA_KIND_PRECOMPILED_HEADER, actionKey,
+                                         action, input, dataSetPCH);
       extractBuildLog(dataSetPCH);
     }
 
@@ -493,7 +516,7 @@ bool Program::compileToLLVMBitcode(const amd_comgr_data_set_t compileInputs,
   }
 
   if (hasAction) {
-    amd::Comgr::destroy_action_info(action);
+    amd::Comgr::release_action_info(actionKey, action);
   }
 
   if (hasDataSetPCH) {
@@ -514,6 +537,7 @@ bool Program::compileAndLinkExecutable(const amd_comgr_data_set_t inputs,
                                        const std::vector<std::string>& options,
                                        amd::option::Options* amdOptions,
                                        char* executable[], size_t* executableSize) {
+  amd::InitPhase phase("codegen", amd::Timeline::kCompile);
 
   // create the linked output
   amd_comgr_action_info_t action;
@@ -522,8 +546,10 @@ bool Program::compileAndLinkExecutable(const amd_comgr_data_set_t inputs,
   bool hasAction = false;
   bool hasOutput = false;
   bool hasRelocatableData = false;
+  std::string actionKey;
 
-  amd_comgr_status_t status = createAction(AMD_COMGR_LANGUAGE_NONE, options, &action, &hasAction);
+  amd_comgr_status_t status = createAction(AMD_COMGR_LANGUAGE_NONE, options, &action, &hasAction,
+                                           &actionKey);
 
   if (status == AMD_COMGR_STATUS_SUCCESS) {
     status = amd::Comgr::create_data_set(&output);
@@ -588,7 +614,7 @@ bool Program::compileAndLinkExecutable(const amd_comgr_data_set_t inputs,
   }
 
   if (hasAction) {
-    amd::Comgr::destroy_action_info(action);
+    amd::Comgr::release_action_info(actionKey, action);
   }
 
   if (hasRelocatableData) {
@@ -603,6 +629,31 @@ bool Program::compileAndLinkExecutable(const amd_comgr_data_set_t inputs,
 }
 #endif  // defined(USE_COMGR_LIBRARY)
 
+// ================================================================================================
+bool Program::lcWavefrontSize64(const amd::option::Options* options) const {
+  // Only the targets with wave32 support can switch the wavefront size
+  if ((device().isa().versionMajor() >= 10) && (options != nullptr)) {
+    switch (options->oVariables->WaveSize) {
+      case 32: return false;
+      case 64: return true;
+      default: break;
+    }
+  }
+  return device().settings().lcWavefrontSize64_;
+}
+
+// ================================================================================================
+bool Program::lcWgpMode(const amd::option::Options* options) const {
+  if ((device().isa().versionMajor() >= 10) && (options != nullptr)) {
+    switch (options->oVariables->WgpMode) {
+      case 1: return true;
+      case 2: return false;
+      default: break;
+    }
+  }
+  return device().settings().enableWgpMode_;
+}
+
 bool Program::compileImplLC(const std::string& sourceCode,
                             const std::vector<const std::string*>& headers,
                             const char** headerIncludeNames, amd::option::Options* options,
@@ -666,11 +717,11 @@ bool Program::compileImplLC(const std::string& sourceCode,
   driverOptions.push_back("-mllvm");
   driverOptions.push_back("-amdgpu-prelink");
 
-  if (!device().settings().enableWgpMode_) {
+  if (!lcWgpMode(options)) {
     driverOptions.push_back("-mcumode");
   }
 
-  if (device().settings().lcWavefrontSize64_) {
+  if (lcWavefrontSize64(options)) {
     driverOptions.push_back("-mwavefrontsize64");
   }
 
@@ -1177,7 +1228,7 @@ bool Program::linkImplLC(amd::option::Options* options) {
     if (options->oVariables->UnsafeMathOpt || options->oVariables->FastRelaxedMath) {
         linkOptions.push_back("unsafe_math");
     }
-    if (device().settings().lcWavefrontSize64_) {
+    if (lcWavefrontSize64(options)) {
         linkOptions.push_back("wavefrontsize64");
     }
 
@@ -1248,11 +1299,11 @@ bool Program::linkImplLC(amd::option::Options* options) {
   codegenOptions.push_back("-amdgpu-early-inline-all");
 #endif
 
-  if (!device().settings().enableWgpMode_) {
+  if (!lcWgpMode(options)) {
     codegenOptions.push_back("-mcumode");
   }
 
-  if (device().settings().lcWavefrontSize64_) {
+  if (lcWavefrontSize64(options)) {
     codegenOptions.push_back("-mwavefrontsize64");
   }
 
@@ -1360,11 +1411,7 @@ bool Program::linkImplHSAIL(amd::option::Options* options) {
       fin_options.append(" -xnack");
     }
 
-    errorCode = amd::Hsail::Compile(device().compiler(), binaryElf_, fin_options.c_str(), ACL_TYPE_CG,
-      ACL_TYPE_ISA, logFunction);
-    buildLog_ += amd::Hsail::GetCompilerLog(device().compiler());
-    if (errorCode != ACL_SUCCESS) {
-      buildLog_ += "Error: BRIG finalization to ISA failed.\n";
+    if (!finalizeHSAIL(fin_options, options)) {
       return false;
     }
   }
@@ -1393,6 +1440,64 @@ bool Program::linkImplHSAIL(amd::option::Options* options) {
 #endif // defined(WITH_COMPILER_LIB)
 }
 
+// ================================================================================================
+bool Program::finalizeHSAIL(const std::string& finOptions, amd::option::Options* options) {
+#if  defined(WITH_COMPILER_LIB)
+  acl_error errorCode;
+  std::string cacheKey;
+  // The finalization is the most expensive step of the HSAIL path, hence the finalized
+  // binary is cached by the content of the BRIG binary. The dumps require the real finalization
+  if (device::CodeCache::enabled(internal_) && (options->oVariables->DumpFlags == 0)) {
+    void* mem = nullptr;
+    size_t size = 0;
+    if (amd::Hsail::WriteToMem(binaryElf_, &mem, &size) == ACL_SUCCESS) {
+      device::CodeCache::Key key;
+      key.add(std::string("HSAIL finalized"));
+      const aclCLVersion version = amd::Hsail::CompilerVersion(device().compiler(), &errorCode);
+      key.add(&version, sizeof(version));
+      key.add(device().isa().isaName());
+      key.add(finOptions);
+      key.add(mem, size);
+      cacheKey = key.str();
+      amd::Hsail::FreeMem(binaryElf_, mem);
+    }
+  }
+
+  std::string executable;
+  if (!cacheKey.empty() && device::CodeCache::find(cacheKey, &executable)) {
+    aclBinary* binary = amd::Hsail::ReadFromMem(executable.data(), executable.size(),
+                                                &errorCode);
+    if (errorCode == ACL_SUCCESS) {
+      amd::Hsail::BinaryFini(binaryElf_);
+      binaryElf_ = binary;
+      return true;
+    }
+    // Fall back to the finalization, which reports the real errors
+    LogWarning("Cannot read the finalized binary from the code cache entry");
+  }
+
+  errorCode = amd::Hsail::Compile(device().compiler(), binaryElf_, finOptions.c_str(), ACL_TYPE_CG,
+    ACL_TYPE_ISA, logFunction);
+  buildLog_ += amd::Hsail::GetCompilerLog(device().compiler());
+  if (errorCode != ACL_SUCCESS) {
+    buildLog_ += "Error: BRIG finalization to ISA failed.\n";
+    return false;
+  }
+
+  if (!cacheKey.empty()) {
+    void* mem = nullptr;
+    size_t size = 0;
+    if (amd::Hsail::WriteToMem(binaryElf_, &mem, &size) == ACL_SUCCESS) {
+      device::CodeCache::insert(cacheKey, mem, size);
+      amd::Hsail::FreeMem(binaryElf_, mem);
+    }
+  }
+  return true;
+#else
+  return false;
+#endif // defined(WITH_COMPILER_LIB)
+}
+
 // ================================================================================================
 bool Program::initClBinary() {
   if (clBinary_ == nullptr) {
@@ -1700,9 +1805,17 @@ int32_t Program::build(const std::string& sourceCode, const char* origOptions,
     headers.push_back(&tmpHeaders[i]);
     headerIncludeNames.push_back(tmpHeaderNames[i].c_str());
   }
+  // Check the code cache for the executable, built earlier from the same inputs
+  std::string cacheKey;
+  bool cacheHit = false;
+  if ((buildStatus_ == CL_BUILD_IN_PROGRESS) && !sourceCode.empty()) {
+    cacheKey = codeCacheKey(sourceCode, options, preCompiledHeaders);
+    cacheHit = !cacheKey.empty() && loadFromCodeCache(cacheKey, options);
+  }
+
   // Compile the source code if any
   bool compileStatus = true;
-  if ((buildStatus_ == CL_BUILD_IN_PROGRESS) && !sourceCode.empty()) {
+  if ((buildStatus_ == CL_BUILD_IN_PROGRESS) && !sourceCode.empty() && !cacheHit) {
     if (!headerIncludeNames.empty()) {
       compileStatus =
           compileImpl(sourceCode, headers, &headerIncludeNames[0], options, preCompiledHeaders);
@@ -1716,11 +1829,15 @@ int32_t Program::build(const std::string& sourceCode, const char* origOptions,
       buildLog_ = "Internal error: Compilation failed.";
     }
   }
-  if ((buildStatus_ == CL_BUILD_IN_PROGRESS) && !linkImpl(options)) {
-    buildStatus_ = CL_BUILD_ERROR;
-    if (buildLog_.empty()) {
-      buildLog_ += "Internal error: Link failed.\n";
-      buildLog_ += "Make sure the system setup is correct.";
+  if ((buildStatus_ == CL_BUILD_IN_PROGRESS) && !cacheHit) {
+    if (!linkImpl(options)) {
+      buildStatus_ = CL_BUILD_ERROR;
+      if (buildLog_.empty()) {
+        buildLog_ += "Internal error: Link failed.\n";
+        buildLog_ += "Make sure the system setup is correct.";
+      }
+    } else if (!cacheKey.empty()) {
+      device::CodeCache::insert(cacheKey, clBinary()->data().first, clBinary()->data().second);
     }
   }
 
@@ -1768,6 +1885,72 @@ int32_t Program::build(const std::string& sourceCode, const char* origOptions,
   return buildError();
 }
 
+// ================================================================================================
+std::string Program::codeCacheKey(const std::string& sourceCode, amd::option::Options* options,
+                                  const std::vector<std::string>& preCompiledHeaders) {
+  // Only the LC executables are cached. The dumps and the saved intermediate sections
+  // require the real compilation. The blit kernels are built on each device and process
+  // start, hence they use the cache unless it's disabled for the internal kernels too
+  const bool internal = (options->origOptionStr.find("-cl-internal-kernel") != std::string::npos);
+  if (!isLC() || !device::CodeCache::enabled(internal) || (options->oVariables->DumpFlags != 0) ||
+      clBinary()->saveSOURCE() || clBinary()->saveLLVMIR()) {
+    return std::string();
+  }
+
+  device::CodeCache::Key key;
+  key.add(std::string("LC executable"));
+#if defined(USE_COMGR_LIBRARY)
+  size_t comgrVersion[2] = {0, 0};
+  amd::Comgr::get_version(&comgrVersion[0], &comgrVersion[1]);
+  key.add(comgrVersion, sizeof(comgrVersion));
+#endif
+  key.add(device().isa().isaName());
+  const uint32_t modes[] = {lcWgpMode(options), lcWavefrontSize64(options),
+                            static_cast<uint32_t>(AMD_GPU_FORCE_SINGLE_FP_DENORM), isHIP(),
+                            static_cast<uint32_t>(options->oVariables->OptLevel)};
+  key.add(modes, sizeof(modes));
+  key.add(options->origOptionStr);
+  key.add(ProcessOptionsFlattened(options));
+  key.add(options->llvmOptions);
+  for (const auto& option : options->clangOptions) {
+    key.add(option);
+  }
+
+  const std::vector<std::string>& headerNames = owner()->headerNames();
+  const std::vector<std::string>& headers = owner()->headers();
+  for (size_t i = 0; i < headers.size(); ++i) {
+    key.add(headerNames[i]);
+    key.add(headers[i]);
+  }
+  for (const auto& header : preCompiledHeaders) {
+    key.add(header);
+  }
+  key.add(sourceCode);
+  return key.str();
+}
+
+// ================================================================================================
+bool Program::loadFromCodeCache(const std::string& key, amd::option::Options* options) {
+  std::string executable;
+  if (!device::CodeCache::find(key, &executable)) {
+    return false;
+  }
+
+  internal_ = (compileOptions_.find("-cl-internal-kernel") != std::string::npos) ? true : false;
+
+  // Save the binary and type, the same way as the link step does
+  clBinary()->saveBIFBinary(executable.data(), executable.size());
+  if (!createKernels(const_cast<void*>(clBinary()->data().first), clBinary()->data().second,
+                     options->oVariables->UniformWorkGroupSize, internal_)) {
+    // Fall back to the compilation, which reports the real errors
+    LogWarning("Cannot create kernels from the code cache entry");
+    clear();
+    return false;
+  }
+  setType(TYPE_EXECUTABLE);
+  return true;
+}
+
 // ================================================================================================
 bool Program::loadHSAIL() {
 #if  defined(WITH_COMPILER_LIB)
@@ -2087,6 +2270,7 @@ bool Program::initClBinary(const char* binaryIn, size_t size, amd::Os::FileDesc
 // ================================================================================================
 bool Program::setBinary(const char* binaryIn, size_t size, const device::Program* same_dev_prog,
                         amd::Os::FileDesc fdesc, size_t foffset, std::string uri) {
+  amd::InitPhase phase("setBinary", amd::Timeline::kCompile);
   if (!initClBinary(binaryIn, size, fdesc, foffset, uri)) {
     DevLogError("Init CL Binary failed \n");
     return false;
@@ -2437,6 +2621,7 @@ Program::file_type_t Program::getNextCompilationStageFromBinary(amd::option::Opt
 // ================================================================================================
 #if defined(USE_COMGR_LIBRARY)
 bool Program::createKernelMetadataMap() {
+  amd::InitPhase phase("kernel metadata", amd::Timeline::kCompile);
 
   amd_comgr_status_t status;
   amd_comgr_metadata_node_t kernelsMD;
@@ -2581,7 +2766,7 @@ bool Program::FindGlobalVarSize(void* binary, size_t binSize) {
   size_t progvarsWriteSize = 0;
 
   amd::Elf elfIn(ELFCLASSNONE, reinterpret_cast<const char *>(binary), binSize,
-                    nullptr, amd::Elf::ELF_C_READ);
+                    nullptr, amd::Elf::ELF_C_READ, true);
 
   if (!elfIn.isSuccessful()) {
     buildLog_ += "Creating input amd::Elf object failed\n";
@@ -2667,6 +2852,11 @@ bool Program::FindGlobalVarSize(void* binary, size_t binSize) {
     return false;
   }
 
+  // The symbol lookups by name don't need to parse the code object again
+  if (!buildCodeObjSymbolIndex(binary, binSize)) {
+    LogWarning("Cannot build the code object symbol index");
+  }
+
   progvarsTotalSize -= dynamicSize;
   setGlobalVariableTotalSize(progvarsTotalSize);
 
@@ -2720,7 +2910,74 @@ amd_comgr_status_t getSymbolFromModule(amd_comgr_symbol_t symbol, void* userData
   return status;
 }
 
+// ================================================================================================
+static amd_comgr_status_t addSymbolToIndex(amd_comgr_symbol_t symbol, void* userData) {
+  auto symbols =
+      reinterpret_cast<std::vector<std::pair<std::string, amd_comgr_symbol_type_t>>*>(userData);
+
+  size_t nlen = 0;
+  amd_comgr_status_t status =
+      amd::Comgr::symbol_get_info(symbol, AMD_COMGR_SYMBOL_INFO_NAME_LENGTH, &nlen);
+  if (status != AMD_COMGR_STATUS_SUCCESS) {
+    return status;
+  }
+
+  std::string name(nlen + 1, '\0');
+  status = amd::Comgr::symbol_get_info(symbol, AMD_COMGR_SYMBOL_INFO_NAME, &name[0]);
+  if (status != AMD_COMGR_STATUS_SUCCESS) {
+    return status;
+  }
+  name.resize(nlen);
+
+  amd_comgr_symbol_type_t type;
+  status = amd::Comgr::symbol_get_info(symbol, AMD_COMGR_SYMBOL_INFO_TYPE, &type);
+  if ((status == AMD_COMGR_STATUS_SUCCESS) && !name.empty()) {
+    symbols->push_back(std::make_pair(std::move(name), type));
+  }
+  return status;
+}
+
+// ================================================================================================
+bool Program::buildCodeObjSymbolIndex(const void* binary, size_t binSize) {
+  codeObjSymbols_.clear();
+  codeObjSymbolIndex_.clear();
+  codeObjSymbolsValid_ = false;
+
+  amd_comgr_data_t dataObject;
+  if (amd::Comgr::create_data(AMD_COMGR_DATA_KIND_EXECUTABLE, &dataObject) !=
+      AMD_COMGR_STATUS_SUCCESS) {
+    return false;
+  }
+  amd_comgr_status_t status =
+      amd::Comgr::set_data(dataObject, binSize, reinterpret_cast<const char*>(binary));
+  if (status == AMD_COMGR_STATUS_SUCCESS) {
+    status = amd::Comgr::iterate_symbols(dataObject, addSymbolToIndex, &codeObjSymbols_);
+  }
+  amd::Comgr::release_data(dataObject);
+
+  if (status != AMD_COMGR_STATUS_SUCCESS) {
+    codeObjSymbols_.clear();
+    return false;
+  }
+  codeObjSymbolIndex_.reserve(codeObjSymbols_.size());
+  for (size_t i = 0; i < codeObjSymbols_.size(); ++i) {
+    // Keep the first symbol, if a name repeats
+    codeObjSymbolIndex_.emplace(codeObjSymbols_[i].first, i);
+  }
+  codeObjSymbolsValid_ = true;
+  return true;
+}
+
 bool Program::getSymbolsFromCodeObj(std::vector<std::string>* var_names, amd_comgr_symbol_type_t sym_type) const {
+  if (codeObjSymbolsValid_) {
+    for (const auto& symbol : codeObjSymbols_) {
+      if (symbol.second == sym_type) {
+        var_names->push_back(symbol.first);
+      }
+    }
+    return true;
+  }
+
   amd_comgr_status_t status = AMD_COMGR_STATUS_SUCCESS;
   amd_comgr_data_t dataObject;
   SymbolInfo sym_info;
@@ -156,7 +156,13 @@ class Program : public amd::HeapObject {
 #if defined(USE_COMGR_LIBRARY)
   amd_comgr_metadata_node_t metadata_ = {}; //!< COMgr metadata
   uint32_t codeObjectVer_;                  //!< version of code object
-  std::map<std::string, amd_comgr_metadata_node_t> kernelMetadataMap_; //!< Map of kernel metadata
+  //! Map of kernel metadata
+  std::unordered_map<std::string, amd_comgr_metadata_node_t> kernelMetadataMap_;
+  //! The code object symbols in the comgr order, collected once at the load
+  std::vector<std::pair<std::string, amd_comgr_symbol_type_t>> codeObjSymbols_;
+  //! The index of the code object symbols by name
+  std::unordered_map<std::string, size_t> codeObjSymbolIndex_;
+  bool codeObjSymbolsValid_ = false;  //!< The code object symbols were collected
 #endif
 
  public:
@@ -269,11 +275,32 @@ class Program : public amd::HeapObject {
   }
 
   const uint32_t codeObjectVer() const { return codeObjectVer_; }
+
+  //! Finds the code object symbol by name. Returns FALSE if the symbol doesn't exist
+  //! or the symbols weren't collected at the load
+  bool findCodeObjSymbol(const std::string& name, amd_comgr_symbol_type_t* type) const {
+    auto it = codeObjSymbolIndex_.find(name);
+    if (it == codeObjSymbolIndex_.end()) {
+      return false;
+    }
+    *type = codeObjSymbols_[it->second].second;
+    return true;
+  }
+
+  //! Returns TRUE if the code object symbols were collected at the load
+  bool hasCodeObjSymbols() const { return codeObjSymbolsValid_; }
 #endif
 
   //! Check if program is HIP based
   const bool isHIP() const { return (isHIP_ == 1); }
 
+  //! Returns TRUE if LC compiles the program for wave64. The build options can override
+  //! the device mode on the targets with wave32 support
+  bool lcWavefrontSize64(const amd::option::Options* options) const;
+
+  //! Returns TRUE if LC compiles the program in WGP mode
+  bool lcWgpMode(const amd::option::Options* options) const;
+
   //! Get mangled name of a name expresion
   const bool getLoweredNames(std::vector<std::string>* mangledNames) const;
 
@@ -377,6 +404,9 @@ class Program : public amd::HeapObject {
 
 #if defined(USE_COMGR_LIBRARY)
   bool getSymbolsFromCodeObj(std::vector<std::string>* var_names, amd_comgr_symbol_type_t sym_type) const;
+
+  //! Collects the code object symbols into the name index
+  bool buildCodeObjSymbolIndex(const void* binary, size_t binSize);
 #endif
   bool getUndefinedVarInfo(std::string var_name, void** var_addr, size_t* var_size);
   bool defineUndefinedVars();
@@ -406,6 +436,16 @@ class Program : public amd::HeapObject {
   //! Link the device program with HSAIL path
   bool linkImplHSAIL(amd::option::Options* options);
 
+  //! Finalizes BRIG to ISA or loads the finalized binary from the code cache
+  bool finalizeHSAIL(const std::string& finOptions, amd::option::Options* options);
+
+  //! Returns the code cache key of the LC build, or an empty string if the build can't be cached
+  std::string codeCacheKey(const std::string& sourceCode, amd::option::Options* options,
+                           const std::vector<std::string>& preCompiledHeaders);
+
+  //! Loads the LC executable from the code cache. Returns TRUE on a cache hit
+  bool loadFromCodeCache(const std::string& key, amd::option::Options* options);
+
   //! Load the device program with LC path
   bool loadLC();
 
@@ -432,10 +472,11 @@ class Program : public amd::HeapObject {
   amd_comgr_status_t addPreCompiledHeader(amd_comgr_data_set_t* dataSet,
                                           const std::vector<std::string>& preCompiledHeaders);
 
-  //! Create action for the specified language, target and options
+  //! Create action for the specified language, target and options or reuse a cached one.
+  //! The action must be returned with amd::Comgr::release_action_info() and @p actionKey
   amd_comgr_status_t createAction(const amd_comgr_language_t oclvar,
     const std::vector<std::string>& options, amd_comgr_action_info_t* action,
-    bool* hasAction);
+    bool* hasAction, std::string* actionKey);
 
   //! Create the bitcode of the linked input dataset
   bool linkLLVMBitcode(const amd_comgr_data_set_t inputs,
@@ -0,0 +1,325 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/devspecializer.hpp"
+#include "device/device.hpp"
+#include "device/devkernel.hpp"
+#include "device/devprogram.hpp"
+#include "platform/kernel.hpp"
+#include "platform/program.hpp"
+#include "utils/debug.hpp"
+#include "utils/flags.hpp"
+
+#include <cstring>
+#include <sstream>
+
+namespace device {
+
+//! The integer types, which can be folded into the variants
+static const char* const kScalarTypes[] = {
+    "char", "uchar", "short", "ushort", "int", "uint", "long", "ulong",
+    "unsigned char", "unsigned short", "unsigned int", "unsigned long"};
+
+// ================================================================================================
+static bool isScalarType(const std::string& type) {
+  for (const auto& it : kScalarTypes) {
+    if (type == it) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ================================================================================================
+KernelSpecializer::~KernelSpecializer() {
+  {
+    // The build callbacks update the variants, so they must finish first
+    amd::ScopedLock lock(lock_);
+    while (pendingBuilds_ > 0) {
+      lock_.wait();
+    }
+  }
+  auto destroy = [](Variant* variant) {
+    if (variant->kernel_ != nullptr) {
+      variant->kernel_->release();
+    }
+    if (variant->program_ != nullptr) {
+      variant->program_->release();
+    }
+    delete variant;
+  };
+  for (auto& it : variants_) {
+    destroy(it.second);
+  }
+  if (modeVariant_ != nullptr) {
+    destroy(modeVariant_);
+  }
+}
+
+// ================================================================================================
+std::string KernelSpecializer::modeOptions() const {
+  const Program& prog = owner_->prog();
+  const amd::Device& device = owner_->device();
+  std::string options;
+  // Both modes exist only on the targets with wave32 support
+  if (device.isa().versionMajor() < 10) {
+    return options;
+  }
+  const std::string suffix = ":" + owner_->name() + ":" + device.info().name_;
+  uint32_t value = 0;
+  if (amd::Device::appProfile()->GetTunedValue("WaveSize" + suffix, &value) &&
+      ((value == 32) || (value == 64)) &&
+      ((value == 64) != prog.lcWavefrontSize64(prog.getCompilerOptions()))) {
+    options += " -wave-size=" + std::to_string(value);
+  }
+  // 1 - WGP mode, 2 - CU mode
+  if (amd::Device::appProfile()->GetTunedValue("WgpMode" + suffix, &value) &&
+      ((value == 1) || (value == 2)) &&
+      ((value == 1) != prog.lcWgpMode(prog.getCompilerOptions()))) {
+    options += " -wgp-mode=" + std::to_string(value);
+  }
+  return options;
+}
+
+// ================================================================================================
+bool KernelSpecializer::init(const amd::Kernel& kernel) {
+  const Program& prog = owner_->prog();
+  const amd::Program* program = prog.owner();
+  // Only the LC builds of the OpenCL sources without the separate headers can be rebuilt
+  if (!prog.isLC() || prog.isInternal() || prog.isHIP() ||
+      (program->language() != amd::Program::OpenCL_C) || program->sourceCode().empty() ||
+      !program->headers().empty() || owner_->dynamicParallelism()) {
+    return false;
+  }
+  const std::string mode = modeOptions();
+  options_ = prog.lastBuildOptionsArg() + mode;
+  if (!mode.empty()) {
+    modeVariant_ = build(nullptr);
+  }
+
+  const amd::KernelSignature& signature = kernel.signature();
+  if (OCL_KERNEL_SPECIALIZE != 0) {
+    for (uint32_t i = 0; i < signature.numParameters(); ++i) {
+      const amd::KernelParameterDescriptor& desc = signature.at(i);
+      if (desc.info_.hidden_) {
+        continue;
+      }
+      // The wrapper declares the same parameters, hence all type names must be known.
+      // Images, samplers and queues have the access qualifiers, which aren't tracked
+      if (desc.typeName_.empty() ||
+          ((desc.info_.oclObject_ != amd::KernelParameterDescriptor::Value) &&
+           (desc.info_.oclObject_ != amd::KernelParameterDescriptor::MemoryObject) &&
+           (desc.info_.oclObject_ != amd::KernelParameterDescriptor::ReferenceObject))) {
+        scalars_.clear();
+        break;
+      }
+      if ((desc.info_.oclObject_ == amd::KernelParameterDescriptor::Value) &&
+          (desc.type_ != T_POINTER) && (desc.size_ <= sizeof(uint64_t)) &&
+          isScalarType(desc.typeName_)) {
+        scalars_.push_back(i);
+      }
+    }
+  }
+  return !scalars_.empty() || (modeVariant_ != nullptr);
+}
+
+// ================================================================================================
+std::string KernelSpecializer::wrapperSource(const std::string& name, const Key& values) const {
+  const amd::KernelSignature& signature = owner_->signature();
+  const auto* info = owner_->workGroupInfo();
+  std::ostringstream src;
+  src << "\n__kernel ";
+  if (info->compileSize_[0] != 0) {
+    src << "__attribute__((reqd_work_group_size(" << info->compileSize_[0] << ", "
+        << info->compileSize_[1] << ", " << info->compileSize_[2] << "))) ";
+  }
+  src << "void " << name << "(";
+  std::ostringstream call;
+  call << owner_->name() << "(";
+  size_t scalar = 0;
+  bool first = true;
+  for (uint32_t i = 0; i < signature.numParameters(); ++i) {
+    const amd::KernelParameterDescriptor& desc = signature.at(i);
+    if (desc.info_.hidden_) {
+      continue;
+    }
+    if (!first) {
+      src << ", ";
+      call << ", ";
+    }
+    first = false;
+    if (desc.type_ == T_POINTER) {
+      switch (desc.addressQualifier_) {
+        case CL_KERNEL_ARG_ADDRESS_GLOBAL:   src << "__global ";   break;
+        case CL_KERNEL_ARG_ADDRESS_CONSTANT: src << "__constant "; break;
+        case CL_KERNEL_ARG_ADDRESS_LOCAL:    src << "__local ";    break;
+        default: break;
+      }
+      if (desc.typeQualifier_ & CL_KERNEL_ARG_TYPE_CONST) {
+        src << "const ";
+      }
+      if (desc.typeQualifier_ & CL_KERNEL_ARG_TYPE_VOLATILE) {
+        src << "volatile ";
+      }
+    }
+    src << desc.typeName_ << " a" << i;
+    if ((scalar < scalars_.size()) && (scalars_[scalar] == i)) {
+      // The value is zero extended, so the cast restores the original bits
+      call << "((" << desc.typeName_ << ")0x" << std::hex << values[scalar] << std::dec << "ul)";
+      scalar++;
+    } else {
+      call << "a" << i;
+    }
+  }
+  src << ") {\n  " << call.str() << ");\n}\n";
+  return src.str();
+}
+
+// ================================================================================================
+bool KernelSpecializer::compatible(const Kernel& variant) const {
+  const amd::KernelSignature& original = owner_->signature();
+  const amd::KernelSignature& signature = variant.signature();
+  if ((signature.numParameters() != original.numParameters()) ||
+      (signature.paramsSize() != original.paramsSize()) ||
+      (variant.KernargSegmentByteSize() != owner_->KernargSegmentByteSize())) {
+    return false;
+  }
+  for (uint32_t i = 0; i < signature.numParameters(); ++i) {
+    const amd::KernelParameterDescriptor& desc = signature.at(i);
+    const amd::KernelParameterDescriptor& orig = original.at(i);
+    if ((desc.offset_ != orig.offset_) || (desc.size_ != orig.size_) ||
+        (desc.info_.allValues_ != orig.info_.allValues_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+KernelSpecializer::Variant* KernelSpecializer::build(const Key* values) {
+  Variant* variant = new Variant();
+  variant->owner_ = this;
+  variant->kernel_ = nullptr;
+  variant->devKernel_ = nullptr;
+  variant->ready_ = false;
+
+  const Program& prog = owner_->prog();
+  amd::Program* program = prog.owner();
+  std::string source = program->sourceCode();
+  if (values != nullptr) {
+    variant->name_ = "__rocclr_spec" + std::to_string(variants_.size()) + "_" + owner_->name();
+    source += wrapperSource(variant->name_, *values);
+    variants_[*values] = variant;
+  } else {
+    // The mode variant is the same kernel, compiled with the different options
+    variant->name_ = owner_->name();
+  }
+  variant->program_ = new amd::Program(const_cast<amd::Context&>(program->context()), source,
+                                       amd::Program::OpenCL_C);
+  std::vector<amd::Device*> devices = {const_cast<amd::Device*>(&owner_->device())};
+  ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Building the variant %s with options:%s",
+          variant->name_.c_str(), options_.c_str());
+  pendingBuilds_++;
+  // The variant builds on the compile threads with AMD_ASYNC_BUILD, otherwise
+  // the launch waits for the build. The lock is released, since the callback takes it
+  const std::string options = options_;
+  lock_.unlock();
+  variant->program_->build(devices, options.c_str(), buildDone, variant);
+  lock_.lock();
+  return variant;
+}
+
+// ================================================================================================
+void CL_CALLBACK KernelSpecializer::buildDone(cl_program program, void* data) {
+  Variant* variant = reinterpret_cast<Variant*>(data);
+  KernelSpecializer* specializer = variant->owner_;
+  const amd::Device& device = specializer->owner_->device();
+  device::Program* devProgram = variant->program_->getDeviceProgram(device);
+
+  amd::ScopedLock lock(specializer->lock_);
+  const amd::Symbol* symbol = (devProgram != nullptr) &&
+      (devProgram->buildStatus() == CL_BUILD_SUCCESS) ?
+      variant->program_->findSymbol(variant->name_.c_str()) : nullptr;
+  if (symbol != nullptr) {
+    variant->kernel_ = new amd::Kernel(*variant->program_, *symbol, variant->name_);
+    Kernel* devKernel = const_cast<Kernel*>(variant->kernel_->getDeviceKernel(device));
+    if ((devKernel != nullptr) && devKernel->ensureInit() &&
+        specializer->compatible(*devKernel)) {
+      variant->devKernel_ = devKernel;
+      variant->ready_.store(true, std::memory_order_release);
+    }
+  }
+  if (!variant->ready_.load(std::memory_order_relaxed)) {
+    // The variant stays in the map, so the same values don't trigger a rebuild
+    LogPrintfWarning("Kernel %s can't be specialized", specializer->owner_->name().c_str());
+  }
+  specializer->pendingBuilds_--;
+  specializer->lock_.notifyAll();
+}
+
+// ================================================================================================
+Kernel* KernelSpecializer::select(const amd::Kernel& kernel, const_address params) {
+  if (disabled_.load(std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  amd::ScopedLock lock(lock_);
+  if (!initialized_) {
+    initialized_ = true;
+    if (!init(kernel)) {
+      disabled_.store(true, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+
+  // The launch falls back to the mode variant or the original kernel
+  Kernel* fallback = ((modeVariant_ != nullptr) &&
+                      modeVariant_->ready_.load(std::memory_order_acquire)) ?
+      modeVariant_->devKernel_ : nullptr;
+  if (scalars_.empty()) {
+    return fallback;
+  }
+
+  const amd::KernelSignature& signature = kernel.signature();
+  Key values(scalars_.size(), 0);
+  for (size_t i = 0; i < scalars_.size(); ++i) {
+    const amd::KernelParameterDescriptor& desc = signature.at(scalars_[i]);
+    memcpy(&values[i], params + desc.offset_, desc.size_);
+  }
+
+  auto it = variants_.find(values);
+  if (it != variants_.end()) {
+    return it->second->ready_.load(std::memory_order_acquire) ? it->second->devKernel_ :
+                                                                 fallback;
+  }
+
+  if (values == lastValues_) {
+    launches_++;
+  } else {
+    lastValues_ = values;
+    launches_ = 1;
+  }
+  // Only the values, which repeat for a while, are worth the compilation
+  if ((launches_ >= OCL_KERNEL_SPECIALIZE) && (variants_.size() < MaxVariants)) {
+    build(&values);
+  }
+  return fallback;
+}
+
+}  // namespace device
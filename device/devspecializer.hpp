@@ -0,0 +1,105 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+#include "thread/monitor.hpp"
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace amd {
+class Kernel;
+class Program;
+}
+
+namespace device {
+
+class Kernel;
+
+//! Specializes an OpenCL kernel on the integer scalar arguments, which don't change between
+//! the launches. The variant is a wrapper kernel, appended to the original source, which calls
+//! the kernel with the argument values as literals, so LC can fold them. The wrapper keeps
+//! the original signature, hence the variant reuses the captured arguments of the launch.
+//! The argument type names are required, so the program must be built with -cl-kernel-arg-info.
+//! The kernel can also have a variant in the other wavefront size or workgroup processor mode,
+//! if the tuning profile of the application prefers it. All variants are built in that mode
+class KernelSpecializer {
+ public:
+  explicit KernelSpecializer(Kernel* owner)
+      : owner_(owner), lock_("Kernel specializer lock"), disabled_(false),
+        initialized_(false), launches_(0), pendingBuilds_(0), modeVariant_(nullptr) {}
+  ~KernelSpecializer();
+
+  //! Returns the device kernel of the variant for the argument values of the launch
+  //! or nullptr if the variant isn't ready
+  Kernel* select(const amd::Kernel& kernel, const_address params);
+
+ private:
+  typedef std::vector<uint64_t> Key;
+
+  //! A specialized version of the kernel for the argument values or the mode
+  struct Variant {
+    KernelSpecializer* owner_;  //!< The specializer, which builds the variant
+    std::string name_;          //!< The name of the wrapper kernel
+    amd::Program* program_;     //!< The program with the wrapper kernel
+    amd::Kernel* kernel_;       //!< The wrapper kernel
+    Kernel* devKernel_;         //!< The device kernel of the wrapper
+    std::atomic<bool> ready_;   //!< The variant can be dispatched
+  };
+
+  static constexpr uint32_t MaxVariants = 8;  //!< Maximum variants of a kernel
+
+  //! Collects the candidate arguments. Returns FALSE if the kernel can't be specialized
+  bool init(const amd::Kernel& kernel);
+
+  //! Returns the wrapper kernel source for the argument values
+  std::string wrapperSource(const std::string& name, const Key& values) const;
+
+  //! Returns the build options, which select the preferred mode of the kernel,
+  //! or an empty string if the kernel is compiled in that mode
+  std::string modeOptions() const;
+
+  //! Starts the build of the variant for the argument values or the mode variant
+  Variant* build(const Key* values);
+
+  //! Finishes the variant after the build of its program
+  static void CL_CALLBACK buildDone(cl_program program, void* data);
+
+  //! Returns TRUE if the variant has the same arguments layout as the original kernel
+  bool compatible(const Kernel& variant) const;
+
+  Kernel* owner_;                     //!< The kernel, which owns this object
+  amd::Monitor lock_;                 //!< Lock for the specialization state
+  std::atomic<bool> disabled_;        //!< The kernel can't be specialized
+  bool initialized_;                  //!< The candidate arguments were collected
+  std::vector<uint32_t> scalars_;     //!< The integer scalar arguments
+  Key lastValues_;                    //!< The values of the last launch
+  uint32_t launches_;                 //!< The launches in a row with the same values
+  uint32_t pendingBuilds_;            //!< The variants in the build
+  std::string options_;               //!< The build options of the variants
+  Variant* modeVariant_;              //!< The kernel in the preferred mode
+  std::map<Key, Variant*> variants_;  //!< The variants, indexed by the argument values
+};
+
+}  // namespace device
@@ -0,0 +1,289 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/devtuning.hpp"
+#include "os/os.hpp"
+#include "thread/thread.hpp"
+#include "utils/debug.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace device {
+
+amd::Monitor Tuning::lock_("Tuning lock");
+std::vector<Tuning::Override> Tuning::overrides_;
+std::atomic<uint64_t> Tuning::generation_(0);
+
+//! The flag names of the knobs
+static constexpr const char* kKnobNames[Tuning::NumKnobs] = {
+    "GPU_STAGING_BUFFER_SIZE", "GPU_STAGING_BUFFER_CHUNKS", "ROC_ACTIVE_WAIT_TIMEOUT",
+    "HSA_KERNARG_POOL_SIZE", "GPU_NUM_MEM_DEPENDENCY"};
+
+// ================================================================================================
+class TuningWatchThread : public amd::Thread {
+ public:
+  TuningWatchThread() : amd::Thread("Tuning Watch", CQ_THREAD_STACK_SIZE) {}
+
+  //! The watch thread entry point
+  void run(void* data) { Tuning::watchLoop(); }
+};
+
+// ================================================================================================
+void Tuning::init() {
+  if (flagIsDefault(AMD_TUNING_FILE) || (AMD_TUNING_FILE[0] == '\0')) {
+    return;
+  }
+  // The initial values must be in place before the first queue
+  loadFile(AMD_TUNING_FILE);
+  TuningWatchThread* thread = new TuningWatchThread();
+  if ((thread == nullptr) || (thread->state() < amd::Thread::INITIALIZED) ||
+      !thread->start()) {
+    LogWarning("Tuning file watch thread creation failed");
+    delete thread;
+  }
+}
+
+// ================================================================================================
+bool Tuning::findKnob(const char* name, Knob* knob) {
+  for (uint32_t i = 0; i < NumKnobs; ++i) {
+    if (strcmp(name, kKnobNames[i]) == 0) {
+      *knob = static_cast<Knob>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// ================================================================================================
+bool Tuning::parse(Knob knob, const char* value, uint64_t* result) {
+  char* end = nullptr;
+  errno = 0;
+  const unsigned long long parsed = strtoull(value, &end, 0);
+  if ((end == value) || (*end != '\0') || (errno != 0) || (value[0] == '-')) {
+    return false;
+  }
+  // Zero disables the active wait, but the sizes and the counts must be valid
+  if ((parsed == 0) && (knob != ActiveWaitTimeout)) {
+    return false;
+  }
+  *result = parsed;
+  return true;
+}
+
+// ================================================================================================
+void Tuning::apply(const Override& entry) {
+  for (auto& it : overrides_) {
+    if ((it.device_ == entry.device_) && (it.queue_ == entry.queue_) &&
+        (it.knob_ == entry.knob_)) {
+      it = entry;
+      return;
+    }
+  }
+  overrides_.push_back(entry);
+}
+
+// ================================================================================================
+bool Tuning::set(uint32_t device, uint32_t queue, const char* name, const char* value) {
+  Knob knob;
+  uint64_t result = 0;
+  if ((name == nullptr) || (value == nullptr) || !findKnob(name, &knob) ||
+      !parse(knob, value, &result) || ((device == VDI_TUNING_ALL) && (queue != VDI_TUNING_ALL))) {
+    return false;
+  }
+  amd::ScopedLock lock(lock_);
+  apply({device, queue, knob, result, false});
+  generation_.fetch_add(1, std::memory_order_relaxed);
+  ClPrint(amd::LOG_INFO, amd::LOG_INIT, "Tuning device %u queue %u: %s=%llu", device, queue,
+          name, static_cast<unsigned long long>(result));
+  return true;
+}
+
+// ================================================================================================
+bool Tuning::get(uint32_t device, uint32_t queue, const char* name, uint64_t* value) {
+  Knob knob;
+  if ((name == nullptr) || (value == nullptr) || !findKnob(name, &knob)) {
+    return false;
+  }
+  uint64_t defaultValue = 0;
+  switch (knob) {
+    case StagingBufferSize:
+      defaultValue = GPU_STAGING_BUFFER_SIZE;
+      break;
+    case StagingBufferChunks:
+      defaultValue = GPU_STAGING_BUFFER_CHUNKS;
+      break;
+    case ActiveWaitTimeout:
+      defaultValue = ROC_ACTIVE_WAIT_TIMEOUT;
+      break;
+    case KernargPoolSize:
+      defaultValue = HSA_KERNARG_POOL_SIZE;
+      break;
+    case NumMemDependency:
+      defaultValue = GPU_NUM_MEM_DEPENDENCY;
+      break;
+    default:
+      return false;
+  }
+  *value = Tuning::value(knob, device, queue, defaultValue);
+  return true;
+}
+
+// ================================================================================================
+void Tuning::reset(uint32_t device, uint32_t queue) {
+  amd::ScopedLock lock(lock_);
+  for (auto it = overrides_.begin(); it != overrides_.end();) {
+    const bool match = ((device == VDI_TUNING_ALL) || (it->device_ == device)) &&
+                       ((queue == VDI_TUNING_ALL) || (it->queue_ == queue));
+    it = match ? overrides_.erase(it) : (it + 1);
+  }
+  generation_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ================================================================================================
+uint64_t Tuning::value(Knob knob, uint32_t device, uint32_t queue, uint64_t defaultValue) {
+  if (generation() == 0) {
+    // Nothing was tuned
+    return defaultValue;
+  }
+  amd::ScopedLock lock(lock_);
+  // The queue scope wins over the device scope, which wins over the process scope
+  int best = -1;
+  uint64_t result = defaultValue;
+  for (const auto& it : overrides_) {
+    if (it.knob_ != knob) {
+      continue;
+    }
+    int rank = -1;
+    if ((it.device_ == device) && (it.queue_ == queue)) {
+      rank = 2;
+    } else if ((it.device_ == device) && (it.queue_ == VDI_TUNING_ALL)) {
+      rank = 1;
+    } else if (it.device_ == VDI_TUNING_ALL) {
+      rank = 0;
+    }
+    if (rank > best) {
+      best = rank;
+      result = it.value_;
+    }
+  }
+  return result;
+}
+
+// ================================================================================================
+bool Tuning::loadFile(const char* path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::vector<Override> entries;
+  std::string line;
+  uint32_t number = 0;
+  while (std::getline(file, line)) {
+    ++number;
+    line = line.substr(0, line.find('#'));
+    line.erase(0, line.find_first_not_of(" \t\r"));
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (line.empty()) {
+      continue;
+    }
+    // The optional scope prefix is "device:" or "device:queue:"
+    Override entry = {VDI_TUNING_ALL, VDI_TUNING_ALL, NumKnobs, 0, true};
+    const size_t equal = line.find('=');
+    size_t start = 0;
+    bool valid = (equal != std::string::npos);
+    for (uint32_t* scope : {&entry.device_, &entry.queue_}) {
+      const size_t colon = line.find(':', start);
+      if (!valid || (colon == std::string::npos) || (colon > equal)) {
+        break;
+      }
+      char* end = nullptr;
+      *scope = static_cast<uint32_t>(strtoul(line.c_str() + start, &end, 10));
+      valid = (end == (line.c_str() + colon)) && (colon > start);
+      start = colon + 1;
+    }
+    if (valid) {
+      const std::string name = line.substr(start, equal - start);
+      const std::string value = line.substr(equal + 1);
+      valid = findKnob(name.c_str(), &entry.knob_) &&
+              parse(entry.knob_, value.c_str(), &entry.value_);
+    }
+    if (!valid) {
+      LogPrintfWarning("Invalid tuning in %s:%u: %s", path, number, line.c_str());
+      continue;
+    }
+    entries.push_back(entry);
+  }
+
+  amd::ScopedLock lock(lock_);
+  for (auto it = overrides_.begin(); it != overrides_.end();) {
+    it = it->file_ ? overrides_.erase(it) : (it + 1);
+  }
+  for (const auto& entry : entries) {
+    apply(entry);
+  }
+  generation_.fetch_add(1, std::memory_order_relaxed);
+  ClPrint(amd::LOG_INFO, amd::LOG_INIT, "Loaded %zu tunings from %s", entries.size(), path);
+  return true;
+}
+
+// ================================================================================================
+void Tuning::watchLoop() {
+  std::string last;
+  {
+    std::ifstream file(AMD_TUNING_FILE);
+    std::stringstream content;
+    content << file.rdbuf();
+    last = content.str();
+  }
+  while (true) {
+    amd::Os::sleep(AMD_TUNING_FILE_INTERVAL);
+    // The file is small, so the content comparison is simpler and more reliable than mtime
+    std::ifstream file(AMD_TUNING_FILE);
+    if (!file.is_open()) {
+      continue;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    if (content.str() != last) {
+      last = content.str();
+      loadFile(AMD_TUNING_FILE);
+    }
+  }
+}
+
+}  // namespace device
+
+// ================================================================================================
+int32_t vdiTuningSet(uint32_t device, uint32_t queue, const char* name, const char* value) {
+  return device::Tuning::set(device, queue, name, value) ? 0 : -1;
+}
+
+// ================================================================================================
+int32_t vdiTuningGet(uint32_t device, uint32_t queue, const char* name, uint64_t* value) {
+  return device::Tuning::get(device, queue, name, value) ? 0 : -1;
+}
+
+// ================================================================================================
+void vdiTuningReset(uint32_t device, uint32_t queue) { device::Tuning::reset(device, queue); }
@@ -0,0 +1,101 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+#include "thread/monitor.hpp"
+#include "utils/flags.hpp"
+#include "vdi_tuning_amd.h"
+
+#include <atomic>
+#include <vector>
+
+namespace device {
+
+//! The overrides of the tunable flags, which change without a process restart. The overrides
+//! come from the vdiTuning API or from the AMD_TUNING_FILE config file, which is watched for
+//! the changes. The queues use the overrides only on the safe boundaries: the creation or
+//! the flush, and check the generation there, so an unchanged state costs a relaxed load.
+//! A file line is "[device:[queue:]]NAME=value", '#' starts a comment. The file owns its
+//! overrides, hence a reload replaces them, but keeps the overrides of the API
+class Tuning : public amd::AllStatic {
+ public:
+  enum Knob : uint32_t {
+    StagingBufferSize = 0,  //!< GPU_STAGING_BUFFER_SIZE in KB
+    StagingBufferChunks,    //!< GPU_STAGING_BUFFER_CHUNKS
+    ActiveWaitTimeout,      //!< ROC_ACTIVE_WAIT_TIMEOUT
+    KernargPoolSize,        //!< HSA_KERNARG_POOL_SIZE in bytes
+    NumMemDependency,       //!< GPU_NUM_MEM_DEPENDENCY
+    NumKnobs
+  };
+
+  //! Starts the watch of the config file
+  static void init();
+
+  //! Overrides the flag in the scope. Returns FALSE if the flag isn't tunable or the value
+  //! is invalid
+  static bool set(uint32_t device, uint32_t queue, const char* name, const char* value);
+
+  //! Returns the effective value of the flag in the scope
+  static bool get(uint32_t device, uint32_t queue, const char* name, uint64_t* value);
+
+  //! Removes the overrides of the scope
+  static void reset(uint32_t device, uint32_t queue);
+
+  //! Returns the generation of the overrides, which changes on every update
+  static uint64_t generation() { return generation_.load(std::memory_order_relaxed); }
+
+  //! Returns the most specific override of the knob for the queue or the default value
+  static uint64_t value(Knob knob, uint32_t device, uint32_t queue, uint64_t defaultValue);
+
+ private:
+  //! The override of a knob in the scope
+  struct Override {
+    uint32_t device_;  //!< The device index or VDI_TUNING_ALL
+    uint32_t queue_;   //!< The queue index or VDI_TUNING_ALL
+    Knob knob_;        //!< The overridden knob
+    uint64_t value_;   //!< The value of the override
+    bool file_;        //!< The override came from the config file
+  };
+
+  //! Returns the knob of the flag name. Returns FALSE if the flag isn't tunable
+  static bool findKnob(const char* name, Knob* knob);
+
+  //! Parses the value of the knob. Returns FALSE if the value is invalid
+  static bool parse(Knob knob, const char* value, uint64_t* result);
+
+  //! Adds or replaces the override. Must be called under the lock
+  static void apply(const Override& entry);
+
+  //! Replaces the overrides of the config file
+  static bool loadFile(const char* path);
+
+  //! Reloads the config file on the changes
+  static void watchLoop();
+
+  friend class TuningWatchThread;
+
+  static amd::Monitor lock_;                  //!< Lock for the overrides
+  static std::vector<Override> overrides_;    //!< The overrides of all scopes
+  static std::atomic<uint64_t> generation_;   //!< The generation of the overrides
+};
+
+}  // namespace device
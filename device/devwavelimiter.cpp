@@ -32,14 +32,18 @@ namespace device {
 uint WaveLimiter::MaxWave;
 uint WaveLimiter::RunCount;
 uint WaveLimiter::AdaptCount;
+uint WaveLimiter::SampleRate;
 
 // ================================================================================================
-WaveLimiter::WaveLimiter(WaveLimiterManager* manager, uint seqNum, bool enable, bool enableDump)
-    : manager_(manager), dumper_(manager_->name() + "_" + std::to_string(seqNum), enableDump) {
+WaveLimiter::WaveLimiter(WaveLimiterManager* manager, uint seqNum, bool enable, bool enableDump,
+                         const std::string& key)
+    : manager_(manager), dumper_(manager_->name() + "_" + std::to_string(seqNum), enableDump),
+      key_(key) {
   setIfNotDefault(SIMDPerSH_, GPU_WAVE_LIMIT_CU_PER_SH, manager->getSimdPerSH());
   MaxWave = GPU_WAVE_LIMIT_MAX_WAVE;
   RunCount = GPU_WAVE_LIMIT_RUN * MaxWave;
   AdaptCount = MaxContinuousSamples * 2 * (MaxWave + 1);
+  SampleRate = (GPU_WAVE_LIMIT_SAMPLE == 0) ? 1 : GPU_WAVE_LIMIT_SAMPLE;
 
   state_ = WARMUP;
   if (!flagIsDefault(GPU_WAVE_LIMIT_TRACE)) {
@@ -53,6 +57,15 @@ WaveLimiter::WaveLimiter(WaveLimiterManager* manager, uint seqNum, bool enable,
   sampleCount_ = 0;
   resultCount_ = 0;
   numContinuousSamples_ = 0;
+  dispatchCount_ = 0;
+  stableCount_ = 0;
+
+  // The wave count, found in the previous runs of the application, is final
+  uint32_t tuned = 0;
+  if (enable_ && amd::Device::appProfile()->GetTunedValue(key_, &tuned) && (tuned <= MaxWave)) {
+    bestWave_ = waves_ = tuned;
+    state_ = DONE;
+  }
 }
 
 // ================================================================================================
@@ -63,9 +76,9 @@ WaveLimiter::~WaveLimiter() {
 }
 
 // ================================================================================================
-uint WaveLimiter::getWavesPerSH() {
+uint WaveLimiter::getWavesPerSH(bool sampled) {
   // Generate different wave counts in the adaptation mode
-  if ((state_ == ADAPT) && (sampleCount_ < AdaptCount)) {
+  if (sampled && (state_ == ADAPT) && (sampleCount_ < AdaptCount)) {
     if (numContinuousSamples_ == 0) {
         ++waves_;
         waves_ %= MaxWave + 1;
@@ -87,10 +100,33 @@ uint WaveLimiter::getWavesPerSH() {
   return waves_ * SIMDPerSH_;
 }
 
+// ================================================================================================
+bool WaveLimiter::sample() {
+  switch (state_) {
+    case ADAPT:
+      // All wave counts must be measured for the adaptation
+      return true;
+    case DONE:
+      return false;
+    default:
+      return (dispatchCount_++ % SampleRate) == 0;
+  }
+}
+
+// ================================================================================================
+void WaveLimiter::converge() {
+  state_ = DONE;
+  amd::Device::appProfile()->SetTunedValue(key_, bestWave_);
+  if (traceStream_.is_open()) {
+    traceStream_ << "[WaveLimiter] " << manager_->name() << " converged bestWave=" << bestWave_
+                 << "\n\n";
+  }
+}
+
 // ================================================================================================
 WLAlgorithmSmooth::WLAlgorithmSmooth(WaveLimiterManager* manager, uint seqNum, bool enable,
-                                     bool enableDump)
-    : WaveLimiter(manager, seqNum, enable, enableDump) {
+                                     bool enableDump, const std::string& key)
+    : WaveLimiter(manager, seqNum, enable, enableDump, key) {
   dynRunCount_ = RunCount;
   adpMeasure_.resize(MaxWave + 1);
   adpSampleCnt_.resize(MaxWave + 1);
@@ -143,7 +179,7 @@ void WLAlgorithmSmooth::outputTrace() {
 void WLAlgorithmSmooth::callback(ulong duration, uint32_t waves) {
   dumper_.addData(duration, waves, static_cast<char>(state_));
 
-  if (!enable_ || (duration == 0)) {
+  if (!enable_ || (duration == 0) || (state_ == DONE)) {
     return;
   }
 
@@ -204,9 +240,11 @@ void WLAlgorithmSmooth::callback(ulong duration, uint32_t waves) {
             // Increase the run time if the same wave count is the best
             dynRunCount_ += RunCount;
             dynRunCount_++;
+            stableCount_++;
           }
           else {
             dynRunCount_ = RunCount;
+            stableCount_ = 0;
           }
           // Find the middle between the best and the worst
           if (worstWave_ < bestWave_) {
@@ -216,6 +254,10 @@ void WLAlgorithmSmooth::callback(ulong duration, uint32_t waves) {
           }
           state_ = RUN;
           outputTrace();
+          if (stableCount_ >= ConvergeCount) {
+            converge();
+            return;
+          }
           // Start to collect the new data for the best wave
           countAll_ = 0;
           runMeasure_[bestWave_] = 0;
@@ -288,14 +330,14 @@ WaveLimiterManager::~WaveLimiterManager() {
 const std::string& WaveLimiterManager::name() const { return owner_->name(); }
 
 // ================================================================================================
-uint WaveLimiterManager::getWavesPerSH(const device::VirtualDevice* vdev) const {
+uint WaveLimiterManager::getWavesPerSH(const device::VirtualDevice* vdev, uint bucket) const {
   if (fixed_ > 0) {
     return fixed_;
   }
   if (!enable_) {
     return 0;
   }
-  auto loc = limiters_.find(vdev);
+  auto loc = limiters_.find(std::make_pair(vdev, bucket));
   if (loc == limiters_.end()) {
     return 0;
   }
@@ -304,25 +346,51 @@ uint WaveLimiterManager::getWavesPerSH(const device::VirtualDevice* vdev) const
 }
 
 amd::ProfilingCallback* WaveLimiterManager::getProfilingCallback(
-    const device::VirtualDevice* vdev) {
+    const device::VirtualDevice* vdev, uint bucket, uint* waves) {
   assert(vdev != nullptr);
+  *waves = fixed_;
   if (!enable_ && !enableDump_) {
     return nullptr;
   }
 
   amd::ScopedLock SL(monitor_);
-  auto loc = limiters_.find(vdev);
+  WaveLimiter* limiter = nullptr;
+  auto key = std::make_pair(vdev, bucket);
+  auto loc = limiters_.find(key);
   if (loc != limiters_.end()) {
-    return loc->second;
+    limiter = loc->second;
+  } else {
+    const std::string tuningKey = "WaveLimiter:" + name() + ":" + std::to_string(bucket) + ":" +
+                                  owner_->device().info().name_;
+    limiter = new WLAlgorithmSmooth(this, limiters_.size(), enable_, enableDump_, tuningKey);
+    if (limiter == nullptr) {
+      enable_ = false;
+      return nullptr;
+    }
+    limiters_[key] = limiter;
   }
 
-  auto limiter = new WLAlgorithmSmooth(this, limiters_.size(), enable_, enableDump_);
-  if (limiter == nullptr) {
-    enable_ = false;
-    return nullptr;
+  // Only the sampled dispatches are profiled, the rest run with the best wave count
+  const bool sampled = limiter->sample() || enableDump_;
+  if (fixed_ == 0) {
+    *waves = limiter->getWavesPerSH(sampled);
+  }
+  return sampled ? limiter : nullptr;
+}
+
+// ================================================================================================
+uint WaveLimiterManager::sizeBucket(const amd::NDRangeContainer& sizes) {
+  size_t total = 1;
+  for (uint i = 0; i < sizes.dimensions(); ++i) {
+    total *= sizes.global()[i];
+  }
+  // The power of 2 of the grid size
+  uint bucket = 0;
+  while (total > 1) {
+    total >>= 1;
+    ++bucket;
   }
-  limiters_[vdev] = limiter;
-  return limiter;
+  return bucket;
 }
 
 // ================================================================================================
@@ -25,9 +25,12 @@
 #include <cstdlib>
 #include <cstdint>
 #include <fstream>
+#include <map>
 #include <unordered_map>
 
 namespace amd {
+  class NDRangeContainer;
+
   struct ProfilingCallback : public amd::HeapObject {
     virtual void callback(ulong duration, uint32_t waves) = 0;
   };
@@ -42,14 +45,19 @@ class Kernel;
 // Adaptively limit the number of waves per SIMD based on kernel execution time
 class WaveLimiter : public amd::ProfilingCallback {
  public:
-  explicit WaveLimiter(WaveLimiterManager* manager, uint seqNum, bool enable, bool enableDump);
+  explicit WaveLimiter(WaveLimiterManager* manager, uint seqNum, bool enable, bool enableDump,
+                       const std::string& key);
   virtual ~WaveLimiter();
 
   //! Get waves per shader array to be used for kernel execution.
-  uint getWavesPerSH();
+  //! Only the sampled dispatches try the new wave counts in the adaptation mode
+  uint getWavesPerSH(bool sampled = true);
+
+  //! Returns TRUE if the next dispatch must be profiled
+  bool sample();
 
  protected:
-  enum StateKind { WARMUP, ADAPT, RUN };
+  enum StateKind { WARMUP, ADAPT, RUN, DONE };
 
   class DataDumper {
    public:
@@ -83,11 +91,20 @@ class WaveLimiter : public amd::ProfilingCallback {
   uint32_t sampleCount_;            //!< The number of samples for adaptive mode
   uint32_t resultCount_;            //!< The number of results for adaptive mode
   uint32_t numContinuousSamples_;   //!< The number of samples with the same wave count
+  uint32_t dispatchCount_;          //!< The number of dispatches out of the adaptation
+  uint32_t stableCount_;            //!< The number of adaptations with the same best wave
+  std::string key_;                 //!< The key of the wave count in the tuning profile
 
   static uint MaxWave;      // Maximum number of waves per SIMD
   static uint RunCount;     // Number of kernel executions for normal run
   static uint AdaptCount;   // Number of kernel executions for adapting
+  static uint SampleRate;   // Profile 1 in SampleRate dispatches out of the adaptation
   static constexpr uint MaxContinuousSamples = 2;
+  //! The number of adaptations with the same result, after which the wave count is final
+  static constexpr uint ConvergeCount = 3;
+
+  //! Finishes the tuning with the best wave count and stores it in the tuning profile
+  void converge();
 
   //! Call back from Event::recordProfilingInfo to get execution time.
   virtual void callback(ulong duration, uint32_t waves) = 0;
@@ -115,7 +132,7 @@ class WaveLimiter : public amd::ProfilingCallback {
 class WLAlgorithmSmooth : public WaveLimiter {
  public:
   explicit WLAlgorithmSmooth(WaveLimiterManager* manager, uint seqNum, bool enable,
-                             bool enableDump);
+                             bool enableDump, const std::string& key);
   virtual ~WLAlgorithmSmooth();
 
  private:
@@ -146,10 +163,15 @@ class WaveLimiterManager {
   virtual ~WaveLimiterManager();
 
   //! Get waves per shader array for a specific virtual device.
-  uint getWavesPerSH(const VirtualDevice*) const;
+  uint getWavesPerSH(const VirtualDevice*, uint bucket = 0) const;
+
+  //! Provide call back function for a specific virtual device and the grid size bucket.
+  //! Returns nullptr if the dispatch isn't sampled. The waves per shader array are
+  //! returned for every dispatch
+  amd::ProfilingCallback* getProfilingCallback(const VirtualDevice*, uint bucket, uint* waves);
 
-  //! Provide call back function for a specific virtual device.
-  amd::ProfilingCallback* getProfilingCallback(const VirtualDevice*);
+  //! Returns the grid size bucket of the dispatch. The limiter converges for each bucket
+  static uint sizeBucket(const amd::NDRangeContainer& sizes);
 
   //! Enable wave limiter manager by kernel metadata and flags.
   void enable(bool isSupported = true);
@@ -163,8 +185,8 @@ class WaveLimiterManager {
  private:
   device::Kernel* owner_;  // The kernel which owns this object
   uint simdPerSH_;         // Simd Per SH
-  std::unordered_map<const VirtualDevice*, WaveLimiter*>
-    limiters_;            // Maps virtual device to wave limiter
+  std::map<std::pair<const VirtualDevice*, uint>, WaveLimiter*>
+    limiters_;            // Maps virtual device and grid size bucket to wave limiter
   bool enable_;           // Whether the adaptation is enabled
   bool enableDump_;       // Whether the data dumper is enabled
   uint fixed_;            // The fixed waves/simd value if not zero
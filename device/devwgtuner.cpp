@@ -0,0 +1,238 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/devwgtuner.hpp"
+#include "device/device.hpp"
+#include "device/devkernel.hpp"
+#include "platform/ndrange.hpp"
+#include "utils/debug.hpp"
+#include "utils/flags.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace device {
+
+//! The number of bits for each dimension of the stored workgroup size
+static constexpr uint32_t kSizeBits = 11;
+
+// ================================================================================================
+static uint32_t log2Size(size_t value) {
+  uint32_t result = 0;
+  while (value > 1) {
+    value >>= 1;
+    ++result;
+  }
+  return result;
+}
+
+// ================================================================================================
+WorkGroupTuner::~WorkGroupTuner() {
+  for (auto& it : classes_) {
+    for (auto candidate : it.second.candidates_) {
+      delete candidate;
+    }
+  }
+}
+
+// ================================================================================================
+void WorkGroupTuner::Candidate::callback(ulong duration, uint32_t waves) {
+  if (duration == 0) {
+    return;
+  }
+  amd::ScopedLock lock(tuner_->lock_);
+  time_ += duration;
+  samples_++;
+  if (sizeClass_->locked_) {
+    return;
+  }
+  for (auto candidate : sizeClass_->candidates_) {
+    if (candidate->samples_ < SamplesPerCandidate) {
+      return;
+    }
+  }
+  tuner_->lockBest(sizeClass_);
+}
+
+// ================================================================================================
+void WorkGroupTuner::createCandidates(SizeClass* sizeClass, const amd::NDRange& global) {
+  const size_t dims = global.dimensions();
+  const auto* info = owner_->workGroupInfo();
+  // The launch advisor proposes the size with the best occupancy, if the device has the model
+  size_t advised = 0;
+  size_t minGrid = 0;
+  const bool modeled = owner_->suggestLaunch(0, {}, &advised, &minGrid);
+  auto fits = [&](const Size& size) {
+    size_t threads = 1;
+    for (uint d = 0; d < dims; ++d) {
+      if ((size[d] == 0) || ((global[d] % size[d]) != 0)) {
+        return false;
+      }
+      threads *= size[d];
+    }
+    // Skip the sizes, which can't be resident on the CU, e.g. because of LDS
+    Kernel::Occupancy occupancy;
+    return !modeled || owner_->occupancy(threads, 0, {}, &occupancy);
+  };
+  auto add = [&](const Size& size) {
+    if ((sizeClass->candidates_.size() >= MaxCandidates) || !fits(size)) {
+      return;
+    }
+    for (auto candidate : sizeClass->candidates_) {
+      if (candidate->size_ == size) {
+        return;
+      }
+    }
+    sizeClass->candidates_.push_back(new Candidate(this, sizeClass, size));
+  };
+
+  // The runtime heuristic is always measured, so the tuning can't lose to it
+  amd::NDRange heuristic(dims);
+  for (uint d = 0; d < dims; ++d) {
+    heuristic[d] = 0;
+  }
+  owner_->FindLocalWorkSize(dims, global, heuristic);
+  Size size = {1, 1, 1};
+  for (uint d = 0; d < dims; ++d) {
+    size[d] = static_cast<uint32_t>(heuristic[d]);
+  }
+  add(size);
+
+  if (modeled) {
+    add({static_cast<uint32_t>(advised), 1, 1});
+  }
+
+  // The full wavefronts up to the kernel limit, as a row and as a square-like tile
+  const size_t wave = std::max(info->wavefrontSize_, static_cast<size_t>(1));
+  for (size_t threads = wave; threads <= info->size_; threads *= 2) {
+    add({static_cast<uint32_t>(threads), 1, 1});
+    if (dims > 1) {
+      const uint32_t x = 1u << ((log2Size(threads) + 1) / 2);
+      add({x, static_cast<uint32_t>(threads / x), 1});
+    }
+  }
+}
+
+// ================================================================================================
+void WorkGroupTuner::lockBest(SizeClass* sizeClass) {
+  uint64_t bestTime = std::numeric_limits<uint64_t>::max();
+  for (auto candidate : sizeClass->candidates_) {
+    if (candidate->samples_ == 0) {
+      continue;
+    }
+    const uint64_t average = candidate->time_ / candidate->samples_;
+    if (average < bestTime) {
+      bestTime = average;
+      sizeClass->best_ = candidate->size_;
+    }
+  }
+  if (bestTime == std::numeric_limits<uint64_t>::max()) {
+    return;
+  }
+  sizeClass->locked_ = true;
+  const uint32_t value = sizeClass->best_[0] | (sizeClass->best_[1] << kSizeBits) |
+                         (sizeClass->best_[2] << (2 * kSizeBits));
+  amd::Device::appProfile()->SetTunedValue(sizeClass->key_, value);
+  ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Workgroup tuner locked %s: [%u, %u, %u]",
+          sizeClass->key_.c_str(), sizeClass->best_[0], sizeClass->best_[1],
+          sizeClass->best_[2]);
+}
+
+// ================================================================================================
+amd::ProfilingCallback* WorkGroupTuner::select(const amd::NDRange& global, amd::NDRange& local) {
+  const size_t dims = global.dimensions();
+  if (!GPU_WORKGROUP_TUNING || (dims == 0) || (local[0] != 0) ||
+      (owner_->workGroupInfo()->compileSize_[0] != 0) ||
+      ((owner_->device().settings().overrideLclSet & (1 << (dims - 1))) != 0)) {
+    return nullptr;
+  }
+
+  // The class key is the number of dimensions and the power of 2 of the global size
+  uint64_t key = dims;
+  for (uint d = 0; d < dims; ++d) {
+    key |= static_cast<uint64_t>(log2Size(global[d])) << (2 + 8 * d);
+  }
+
+  amd::ScopedLock lock(lock_);
+  auto it = classes_.find(key);
+  if (it == classes_.end()) {
+    SizeClass& sizeClass = classes_[key];
+    sizeClass.key_ = "WorkGroup:" + owner_->name() + ":" + std::to_string(key) + ":" +
+                     owner_->device().info().name_;
+    uint32_t value = 0;
+    if (amd::Device::appProfile()->GetTunedValue(sizeClass.key_, &value)) {
+      const uint32_t mask = (1u << kSizeBits) - 1;
+      sizeClass.best_ = {value & mask, (value >> kSizeBits) & mask,
+                         (value >> (2 * kSizeBits)) & mask};
+      sizeClass.locked_ = true;
+    } else {
+      createCandidates(&sizeClass, global);
+    }
+    it = classes_.find(key);
+  }
+  SizeClass& sizeClass = it->second;
+
+  auto fits = [&](const Size& size) {
+    size_t threads = 1;
+    for (uint d = 0; d < dims; ++d) {
+      if ((size[d] == 0) || ((global[d] % size[d]) != 0)) {
+        return false;
+      }
+      threads *= size[d];
+    }
+    return threads <= owner_->workGroupInfo()->size_;
+  };
+  auto apply = [&](const Size& size) {
+    for (uint d = 0; d < dims; ++d) {
+      local[d] = size[d];
+    }
+  };
+
+  if (sizeClass.locked_) {
+    // The global sizes in the class may have different factors, so use the heuristic then
+    if (fits(sizeClass.best_)) {
+      apply(sizeClass.best_);
+    }
+    return nullptr;
+  }
+
+  const uint32_t numCandidates = static_cast<uint32_t>(sizeClass.candidates_.size());
+  if (numCandidates == 0) {
+    return nullptr;
+  }
+  // Some candidates may never fit the later global sizes, so the tuning is limited
+  if (++sizeClass.launches_ > 4 * numCandidates * SamplesPerCandidate) {
+    lockBest(&sizeClass);
+    return nullptr;
+  }
+  for (uint32_t i = 0; i < numCandidates; ++i) {
+    const uint32_t idx = (sizeClass.next_ + i) % numCandidates;
+    Candidate* candidate = sizeClass.candidates_[idx];
+    if ((candidate->launches_ < SamplesPerCandidate) && fits(candidate->size_)) {
+      sizeClass.next_ = idx + 1;
+      candidate->launches_++;
+      apply(candidate->size_);
+      return candidate;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace device
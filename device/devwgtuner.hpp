@@ -0,0 +1,94 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "devwavelimiter.hpp"
+#include "thread/monitor.hpp"
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace amd {
+class NDRange;
+}
+
+namespace device {
+
+class Kernel;
+
+//! Tunes the local workgroup size of a kernel, when the application doesn't provide it.
+//! The early launches in each global size class measure the candidate sizes with profiling,
+//! then the fastest candidate is locked in and stored in the tuning profile of the application
+class WorkGroupTuner {
+ public:
+  explicit WorkGroupTuner(Kernel* owner) : owner_(owner), lock_("Workgroup tuner lock") {}
+  ~WorkGroupTuner();
+
+  //! Selects the local workgroup size for the dispatch. Returns the profiling callback
+  //! if the dispatch measures a candidate, otherwise nullptr
+  amd::ProfilingCallback* select(const amd::NDRange& global, amd::NDRange& local);
+
+ private:
+  typedef std::array<uint32_t, 3> Size;
+  struct SizeClass;
+
+  //! A candidate workgroup size, which receives the execution time of the dispatches
+  struct Candidate : public amd::ProfilingCallback {
+    Candidate(WorkGroupTuner* tuner, SizeClass* sizeClass, const Size& size)
+        : tuner_(tuner), sizeClass_(sizeClass), size_(size), time_(0), samples_(0),
+          launches_(0) {}
+    void callback(ulong duration, uint32_t waves) override;
+
+    WorkGroupTuner* tuner_;   //!< The owner of the candidate
+    SizeClass* sizeClass_;    //!< The size class of the candidate
+    Size size_;               //!< The workgroup size
+    uint64_t time_;           //!< Accumulated execution time
+    uint32_t samples_;        //!< The number of measurements
+    uint32_t launches_;       //!< The number of dispatches with this size
+  };
+
+  //! The state of the tuning for the global sizes with the same power of 2 in each dimension
+  struct SizeClass {
+    std::vector<Candidate*> candidates_;  //!< Candidate sizes, the heuristic size is first
+    std::string key_;       //!< The key in the tuning profile
+    uint32_t next_ = 0;     //!< The next candidate for the round robin measurements
+    uint32_t launches_ = 0; //!< The number of dispatches in the tuning
+    bool locked_ = false;   //!< The best size was found
+    Size best_ = {};        //!< The best size
+  };
+
+  static constexpr uint32_t SamplesPerCandidate = 3;  //!< Measurements of each candidate
+  static constexpr uint32_t MaxCandidates = 8;        //!< Maximum candidates in a size class
+
+  //! Generates the candidate sizes for the global size
+  void createCandidates(SizeClass* sizeClass, const amd::NDRange& global);
+
+  //! Locks in the fastest candidate of the size class
+  void lockBest(SizeClass* sizeClass);
+
+  Kernel* owner_;                             //!< The kernel, which owns this object
+  amd::Monitor lock_;                         //!< Lock for the tuning state
+  std::map<uint64_t, SizeClass> classes_;     //!< Size classes, indexed by the class key
+};
+
+}  // namespace device
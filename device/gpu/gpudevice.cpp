@@ -231,7 +231,7 @@ bool NullDevice::create(const char* calName, const amd::Isa& isa, CALtarget targ
   calTarget_ = target;
   calName_ = calName;
 
-  // sets up vaCacheAccess_ and vaCacheMap_.
+  // sets up the ISA of the device
   if (!amd::Device::create(isa)) {
     LogPrintfError("Unable to setup offline device for CAL device %s", isa.targetId());
     return false;
@@ -1456,10 +1456,8 @@ gpu::Memory* Device::createBuffer(amd::Memory& owner, bool directAccess) const {
     if (result) {
       // Initialize if the memory is a pipe object
       if (owner.getType() == CL_MEM_OBJECT_PIPE) {
-        // Pipe initialize in order read_idx, write_idx, end_idx. Refer clk_pipe_t structure.
-        // Init with 3 DWORDS for 32bit addressing and 6 DWORDS for 64bit
-        size_t pipeInit[3] = {0, 0, owner.asPipe()->getMaxNumPackets()};
-        gpuMemory->writeRawData(*xferQueue_, sizeof(pipeInit), pipeInit, true);
+        const amd::Pipe::Header pipeInit = owner.asPipe()->initialHeader();
+        gpuMemory->writeRawData(*xferQueue_, sizeof(pipeInit), &pipeInit, true);
       }
       // If memory has direct access from host, then get CPU address
       if (gpuMemory->isHostMemDirectAccess() && (type != Resource::ExternalPhysical)) {
@@ -21,6 +21,7 @@
 #ifndef GPUPRINTFDBG_HPP_
 #define GPUPRINTFDBG_HPP_
 
+#include "device/devprintf.hpp"
 #include "device/gpu/gpumemory.hpp"
 
 /*! \addtogroup GPU GPU Device Implementation
@@ -100,32 +101,7 @@ class PrintfDbg : public amd::HeapObject {
   bool allocate(bool realloc = false  //!< If TRUE then reallocate the debug memory
                 );
 
-  //! Returns TRUE if a float value has to be printed
-  bool checkFloat(const std::string& fmt  //!< Format string
-                  ) const;
-
-  //! Returns TRUE if a string value has to be printed
-  bool checkString(const std::string& fmt  //!< Format string
-                   ) const;
-
-  //! Finds the specifier in the format string
-  int checkVectorSpecifier(const std::string& fmt,  //!< Format string
-                           size_t startPos,         //!< Start position for processing
-                           size_t& curPos           //!< End position for processing
-                           ) const;
-
-  //! Outputs an argument
-  size_t outputArgument(const std::string& fmt,   //!< Format strint
-                        bool printFloat,          //!< Argument is a float value
-                        size_t size,              //!< Argument's size
-                        const uint32_t* argument  //!< Argument's location
-                        ) const;
-
-  //! Displays the PrintfDbg
-  void outputDbgBuffer(const device::PrintfInfo& info,//!< printf info
-                       const uint32_t* workitemData,  //!< The PrintfDbg dump buffer
-                       size_t& i                      //!< index to the data in the buffer
-                       ) const;
+  device::PrintfDecoder decoder_;  //!< The printf records decoder
 
  private:
   //! Disable copy constructor
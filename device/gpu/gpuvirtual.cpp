@@ -2574,6 +2574,10 @@ void VirtualGPU::flush(amd::Command* list, bool wait) {
   }
 
   wait |= state_.forceWait_;
+  // Resolve all completed batches at once, so the loop below doesn't query each event
+  if (!wait && (cbList_.size() > 1)) {
+    retireEvents();
+  }
   // Loop through all outstanding command batches
   while (!cbList_.empty()) {
     const auto it = cbList_.cbegin();
@@ -29,9 +29,9 @@ EventQueue::EventQueue()
     m_queueSize     = c_staticQueueSize;
 
     memset(m_queries,0,sizeof(m_queries));
-    memset(m_flushed,0,sizeof(m_flushed));
 
     m_latestRetired = 0;
+    m_flushedId = 0;
     m_headId   = m_queueSize - 1 ;
     m_tail = 0;
 }
@@ -56,6 +56,7 @@ EventQueue::open(gsCtx* cs, gslQueryTarget target, EQManagerConfig config, uint3
     m_headId   = m_queueSize - 1 ;
     m_tail = 0;
     m_latestRetired = 0;
+    m_flushedId = 0;
     m_target = target;
     m_engineMask = engineMask;
 
@@ -80,8 +81,8 @@ EventQueue::close()
         m_cs->destroyQuery(m_queries[i]);
     }
     memset(m_queries, 0, sizeof(m_queries));
-    memset(m_flushed, 0, sizeof(m_flushed));
     m_latestRetired = 0;
+    m_flushedId = 0;
     m_headId   = m_queueSize - 1 ;
     m_tail = 0;
     m_cs = NULL;
@@ -93,8 +94,6 @@ EventQueue::begin()
     const CALuint slot = m_headId % m_queueSize;
     gslErrorCode ec =  m_queries[slot]->BeginQuery(m_cs, m_target, 0, m_engineMask);
     assert(ec == GSL_NO_ERROR);
-
-    m_flushed[slot] = false;  // we've started a query, but it hasn't been checked yet...
 }
 
 uint32
@@ -114,6 +113,7 @@ EventQueue::end()
          flush();
          //roll numbers back to the beginning
          m_latestRetired = 0;
+         m_flushedId = 0;
          m_headId = m_headId % m_queueSize;
          m_tail = m_tail % m_queueSize;
     }
@@ -142,11 +142,11 @@ EventQueue::isDone(uint32 event)
     //  If we've never called flush on the query object, go ahead flush the first time to ensure
     //  we never infinite loop
     //
-    const uint32 slot = event % m_queueSize;
-    if (!m_flushed[slot])
+    if (event >= m_flushedId)
     {
         flush();
     }
+    const uint32 slot = event % m_queueSize;
 
     //
     // Since we're in between, we actually have to check to see if things are truely done
@@ -182,11 +182,11 @@ EventQueue::waitForEvent(uint32 event, uint32 waitType)
     //  If we've never called flush on the query object, go ahead flush the first time to ensure
     //  we never infinite loop
     //
-    const uint32 slot = event % m_queueSize;
-    if (!m_flushed[slot])
+    if (event >= m_flushedId)
     {
         flush();
     }
+    const uint32 slot = event % m_queueSize;
     uint64 param;
     m_queries[slot]->GetResult(m_cs, &param, (IOSyncWaitType) waitType);
 
@@ -203,10 +203,31 @@ bool
 EventQueue::flush()
 {
     m_cs->Flush(false, m_engineMask);
-    memset(m_flushed, 1, sizeof(m_flushed));
+    // every event issued so far was submitted with the flush
+    m_flushedId = m_headId;
     return true;
 }
 
+//
+//  The events on the engine retire in order, hence a single query of the most recently
+//  flushed event resolves all older events at once. Returns the most recently retired event.
+//
+uint32
+EventQueue::retire()
+{
+    if (!m_cs || (m_flushedId <= m_latestRetired + 1))
+    {
+        return m_latestRetired;
+    }
+
+    const uint32 event = m_flushedId - 1;
+    if ((event >= m_tail) && m_queries[event % m_queueSize]->IsResultAvailable(m_cs))
+    {
+        m_latestRetired = event;
+    }
+    return m_latestRetired;
+}
+
 
 void
 EventQueue::setSlotCount(uint32 slotCount)
@@ -51,6 +51,7 @@ public:
     bool        isDone(uint32 event);
     bool        waitForEvent(uint32 event, uint32 waitType);
     bool        flush();
+    uint32      retire();
 
 private:
 
@@ -62,8 +63,8 @@ private:
     uint32           m_tail; //represents the oldest event we have
     uint32           m_headId;
     uint32           m_latestRetired; //!< most recentyl retired event.
+    uint32           m_flushedId;     //!< all events below the id were flushed
     gslQueryObject   m_queries[c_staticQueueSize];
-    bool             m_flushed[c_staticQueueSize];
     ///////////////////////
     // private functions //
     ///////////////////////
@@ -327,6 +327,16 @@ CALGSLContext::waitForEvent(GpuEvent* event)
     }
 }
 
+void
+CALGSLContext::retireEvents()
+{
+    // A single query per engine retires all flushed events, which are complete
+    for (uint32 i = 0; i < AllEngines; ++i)
+    {
+        m_eventQueue[i].retire();
+    }
+}
+
 void
 CALGSLContext::flushCUCaches(bool flushL2) const
 {
@@ -59,6 +59,7 @@ public:
     void             setUAVChannelOrder(uint32 physUnit, gslMemObject mem);
     bool             isDone(GpuEvent* event);
     void             waitForEvent(GpuEvent* event);
+    void             retireEvents();
     void             flushCUCaches(bool flushL2 = false) const;
     void             eventBegin(EngineType engId)
     {
@@ -722,7 +722,8 @@ bool KernelBlitManager::createProgram(Device& device) {
     for (uint i = 0; i < BlitTotal; ++i) {
       const amd::Symbol* symbol = program_->findSymbol(BlitName[i]);
       if (symbol == NULL) {
-        break;
+        // The optional kernels are built only in some configurations
+        continue;
       }
       kernels_[i] = new amd::Kernel(*program_, *symbol, BlitName[i]);
       if (kernels_[i] == NULL) {
@@ -793,6 +794,30 @@ static constexpr FormatConvertion RejectedOrder[] = {
 const uint RejectedFormatDataTotal = sizeof(RejectedData) / sizeof(FormatConvertion);
 const uint RejectedFormatChannelTotal = sizeof(RejectedOrder) / sizeof(FormatConvertion);
 
+// A 16x16 workgroup of the mip generation reduces a tile to 1x1 in 5 levels
+static constexpr uint kMipsPerDispatch = 5;
+
+// Converts the format into the unsigned integer format for the raw blits.
+// Returns TRUE if the format was changed
+static bool rawBlitFormat(amd::Image::Format* format) {
+  bool rejected = false;
+  for (uint i = 0; i < RejectedFormatDataTotal; ++i) {
+    if (RejectedData[i].clOldType_ == format->image_channel_data_type) {
+      format->image_channel_data_type = RejectedData[i].clNewType_;
+      rejected = true;
+      break;
+    }
+  }
+  for (uint i = 0; i < RejectedFormatChannelTotal; ++i) {
+    if (RejectedOrder[i].clOldType_ == format->image_channel_order) {
+      format->image_channel_order = RejectedOrder[i].clNewType_;
+      rejected = true;
+      break;
+    }
+  }
+  return rejected;
+}
+
 bool KernelBlitManager::copyBufferToImage(device::Memory& srcMemory, device::Memory& dstMemory,
                                           const amd::Coord3D& srcOrigin,
                                           const amd::Coord3D& dstOrigin, const amd::Coord3D& size,
@@ -2463,6 +2488,150 @@ bool KernelBlitManager::RunGwsInit(
     return result;
 }
 
+bool KernelBlitManager::copyBufferToImageMips(device::Memory& srcMemory,
+                                              device::Memory& dstMemory,
+                                              size_t srcOffset) const {
+  amd::ScopedLock k(lockXferOps_);
+  const Resource::Descriptor& desc = gpuMem(dstMemory).desc();
+  // The 1D arrays swap the layer on gfx10+, hence they use the per level blits
+  if ((kernels_[BlitCopyBufferToImageMips] == nullptr) || desc.buffer_ ||
+      (desc.topology_ == CL_MEM_OBJECT_IMAGE1D_ARRAY) || (desc.baseLevel_ != 0)) {
+    return false;
+  }
+
+  amd::Image::Format format(desc.format_);
+  Memory* dstView = &gpuMem(dstMemory);
+  bool releaseView = false;
+  if (rawBlitFormat(&format)) {
+    dstView = createView(gpuMem(dstMemory), format, true);
+    if (dstView == nullptr) {
+      return false;
+    }
+    releaseView = true;
+  }
+
+  const uint32_t components = format.getNumChannels();
+  const uint32_t componentSize = format.getElementSize() / components;
+  CondLog(((srcOffset % componentSize) != 0), "Unaligned offset in blit!");
+
+  // The depth of 3D images is reduced with the levels, but the array layers aren't
+  const bool mipDepth = (desc.topology_ == CL_MEM_OBJECT_IMAGE3D);
+  int32_t size[4] = {static_cast<int32_t>(desc.width_), static_cast<int32_t>(desc.height_),
+                     static_cast<int32_t>(desc.depth_), mipDepth ? 1 : 0};
+  size_t texels = 0;
+  size_t width = desc.width_;
+  size_t height = desc.height_;
+  size_t depth = desc.depth_;
+  for (uint level = 0; level < desc.mipLevels_; ++level) {
+    texels += width * height * depth;
+    width = std::max(width >> 1, static_cast<size_t>(1));
+    height = std::max(height >> 1, static_cast<size_t>(1));
+    depth = mipDepth ? std::max(depth >> 1, static_cast<size_t>(1)) : depth;
+  }
+
+  // A single dispatch covers all levels, each work item finds its level
+  size_t globalWorkOffset[1] = {0};
+  size_t globalWorkSize[1] = {amd::alignUp(texels, 256)};
+  size_t localWorkSize[1] = {256};
+
+  const uint blitType = BlitCopyBufferToImageMips;
+  Memory* mem = &gpuMem(srcMemory);
+  setArgument(kernels_[blitType], 0, sizeof(cl_mem), &mem);
+  mem = dstView;
+  setArgument(kernels_[blitType], 1, sizeof(cl_mem), &mem);
+  uint64_t offset = srcOffset;
+  setArgument(kernels_[blitType], 2, sizeof(offset), &offset);
+  setArgument(kernels_[blitType], 3, sizeof(size), size);
+  uint32_t blitFormat[4] = {components, componentSize, 0, 0};
+  setArgument(kernels_[blitType], 4, sizeof(blitFormat), blitFormat);
+  uint32_t numLevels = desc.mipLevels_;
+  setArgument(kernels_[blitType], 5, sizeof(numLevels), &numLevels);
+
+  amd::NDRangeContainer ndrange(1, globalWorkOffset, globalWorkSize, localWorkSize);
+  address parameters = kernels_[blitType]->parameters().values();
+  bool result = gpu().submitKernelInternal(ndrange, *kernels_[blitType], parameters);
+  if (releaseView) {
+    delete dstView;
+  }
+
+  synchronize();
+
+  return result;
+}
+
+bool KernelBlitManager::generateMips(device::Memory& memory) const {
+  amd::ScopedLock k(lockXferOps_);
+  const Resource::Descriptor& desc = gpuMem(memory).desc();
+  // The 3D images require a 2x2x2 filter, which the local memory reduction doesn't cover
+  if ((kernels_[BlitGenerateMips] == nullptr) || (desc.mipLevels_ <= 1) ||
+      ((desc.topology_ != CL_MEM_OBJECT_IMAGE2D) &&
+       (desc.topology_ != CL_MEM_OBJECT_IMAGE2D_ARRAY))) {
+    return false;
+  }
+
+  // The sampler filters only the normalized and float formats. The sRGB writes
+  // would require the encoding in the kernel
+  switch (desc.format_.image_channel_data_type) {
+    case CL_UNORM_INT8:
+    case CL_UNORM_INT16:
+    case CL_SNORM_INT8:
+    case CL_SNORM_INT16:
+    case CL_HALF_FLOAT:
+    case CL_FLOAT:
+      break;
+    default:
+      return false;
+  }
+  switch (desc.format_.image_channel_order) {
+    case CL_sRGB:
+    case CL_sRGBx:
+    case CL_sRGBA:
+    case CL_sBGRA:
+    case CL_DEPTH:
+      return false;
+    default:
+      break;
+  }
+
+  const uint blitType = BlitGenerateMips;
+  const size_t layers = (desc.topology_ == CL_MEM_OBJECT_IMAGE2D_ARRAY) ? desc.depth_ : 1;
+  bool result = true;
+  size_t width = desc.width_;
+  size_t height = desc.height_;
+  for (uint srcLevel = 0; result && ((srcLevel + 1) < desc.mipLevels_);
+       srcLevel += kMipsPerDispatch) {
+    const uint32_t numLevels = std::min(kMipsPerDispatch, desc.mipLevels_ - 1 - srcLevel);
+
+    // Each work item produces a texel of the first generated level
+    size_t globalWorkOffset[3] = {0, 0, 0};
+    size_t globalWorkSize[3] = {amd::alignUp(std::max(width >> 1, static_cast<size_t>(1)), 16),
+                                amd::alignUp(std::max(height >> 1, static_cast<size_t>(1)), 16),
+                                layers};
+    size_t localWorkSize[3] = {16, 16, 1};
+
+    Memory* mem = &gpuMem(memory);
+    setArgument(kernels_[blitType], 0, sizeof(cl_mem), &mem);
+    setArgument(kernels_[blitType], 1, sizeof(cl_mem), &mem);
+    int32_t size[4] = {static_cast<int32_t>(width), static_cast<int32_t>(height),
+                       static_cast<int32_t>(layers), 0};
+    setArgument(kernels_[blitType], 2, sizeof(size), size);
+    uint32_t level = srcLevel;
+    setArgument(kernels_[blitType], 3, sizeof(level), &level);
+    setArgument(kernels_[blitType], 4, sizeof(numLevels), &numLevels);
+
+    amd::NDRangeContainer ndrange(3, globalWorkOffset, globalWorkSize, localWorkSize);
+    address parameters = kernels_[blitType]->parameters().values();
+    result = gpu().submitKernelInternal(ndrange, *kernels_[blitType], parameters);
+
+    width = std::max(width >> numLevels, static_cast<size_t>(1));
+    height = std::max(height >> numLevels, static_cast<size_t>(1));
+  }
+
+  synchronize();
+
+  return result;
+}
+
 amd::Memory* DmaBlitManager::pinHostMemory(const void* hostMem, size_t pinSize,
                                            size_t& partial) const {
   size_t pinAllocSize;
@@ -2510,10 +2679,12 @@ amd::Memory* DmaBlitManager::pinHostMemory(const void* hostMem, size_t pinSize,
   return amdMemory;
 }
 
-Memory* KernelBlitManager::createView(const Memory& parent, const cl_image_format format) const {
+Memory* KernelBlitManager::createView(const Memory& parent, const cl_image_format format,
+                                      bool mipChain) const {
   assert(!parent.desc().buffer_ && "View supports images only");
   Memory* gpuImage = new Image(dev(), parent.size(), parent.desc().width_, parent.desc().height_,
-                               parent.desc().depth_, format, parent.desc().topology_, 1);
+                               parent.desc().depth_, format, parent.desc().topology_,
+                               mipChain ? parent.desc().mipLevels_ : 1);
 
   // Create resource
   if (NULL != gpuImage) {
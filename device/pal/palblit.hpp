@@ -223,6 +223,8 @@ class KernelBlitManager : public DmaBlitManager {
     FillImage,
     Scheduler,
     GwsInit,
+    BlitCopyBufferToImageMips,
+    BlitGenerateMips,
     BlitTotal
   };
 
@@ -375,6 +377,19 @@ class KernelBlitManager : public DmaBlitManager {
   bool RunGwsInit(uint32_t value             //!< Initial value for GWS resource
                   ) const;
 
+  //! Copies all mip levels, packed one after another in the buffer, into the image
+  //! with a single dispatch. Returns FALSE if the image can't use the batched upload
+  bool copyBufferToImageMips(device::Memory& srcMemory,  //!< Source buffer with the levels
+                             device::Memory& dstMemory,  //!< Destination mipmapped image
+                             size_t srcOffset            //!< Offset of the base level
+                             ) const;
+
+  //! Generates the mip levels from the base level with a box filter. Each dispatch
+  //! reduces up to 5 levels in the local memory.
+  //! Returns FALSE if the image format isn't filterable
+  bool generateMips(device::Memory& memory  //!< Mipmapped image
+                    ) const;
+
   virtual amd::Monitor* lockXfer() const { return &lockXferOps_; }
 
  private:
@@ -408,8 +423,9 @@ class KernelBlitManager : public DmaBlitManager {
   );
 
   //! Creates a view memory object
-  Memory* createView(const Memory& parent,         //!< Parent memory object
-                     const cl_image_format format  //!< The new format for a view
+  Memory* createView(const Memory& parent,          //!< Parent memory object
+                     const cl_image_format format,  //!< The new format for a view
+                     bool mipChain = false          //!< The view includes all mip levels
                      ) const;
 
   //! Disable copy constructor
@@ -429,7 +445,8 @@ static const char* BlitName[KernelBlitManager::BlitTotal] = {
     "__amd_rocclr_copyImage", "__amd_rocclr_copyImage1DA", "__amd_rocclr_copyImageToBuffer",
     "__amd_rocclr_copyBufferToImage", "__amd_rocclr_copyBufferRect", "__amd_rocclr_copyBufferRectAligned",
     "__amd_rocclr_copyBuffer", "__amd_rocclr_copyBufferAligned", "__amd_rocclr_fillBuffer",
-    "__amd_rocclr_fillImage", "__amd_rocclr_scheduler", "__amd_rocclr_gwsInit"
+    "__amd_rocclr_fillImage", "__amd_rocclr_scheduler", "__amd_rocclr_gwsInit",
+    "__amd_rocclr_copyBufferToImageMips", "__amd_rocclr_generateMips"
 };
 
 /*@}*/  // namespace pal
@@ -28,11 +28,12 @@ namespace pal {
 // ================================================================================================
 ManagedBuffer::ManagedBuffer(VirtualGPU& gpu, uint32_t size)
     : gpu_(gpu),
-      pool_(MaxNumberOfBuffers),
+      pool_(InitNumberOfBuffers),
       activeBuffer_(0),
       size_(size),
       wrtOffset_(0),
-      wrtAddress_(nullptr) {}
+      wrtAddress_(nullptr),
+      type_(Resource::Remote) {}
 
 // ================================================================================================
 void ManagedBuffer::release() {
@@ -44,31 +45,49 @@ void ManagedBuffer::release() {
   }
 }
 
+// ================================================================================================
+bool ManagedBuffer::createBuffer(TimeStampedBuffer* buffer) {
+  buffer->buf = new Memory(const_cast<pal::Device&>(gpu_.dev()), size_);
+  if (nullptr == buffer->buf || !buffer->buf->create(type_)) {
+    LogPrintfError("We couldn't create HW constant buffer, size(%d)!", size_);
+    return false;
+  }
+  // Assign virtual gpu to the allocation. Buffer will be used only on a particular queue
+  buffer->buf->memRef()->gpu_ = &gpu_;
+  void* wrtAddress = buffer->buf->map(&gpu_);
+  if (wrtAddress == nullptr) {
+    LogPrintfError("We couldn't map HW constant buffer, size(%d)!", size_);
+    return false;
+  }
+  // Make sure OCL touches every buffer in the queue to avoid delays on the first submit
+  uint dummy = 0;
+  static constexpr bool Wait = true;
+  // Write 0 for the buffer paging by VidMM
+  buffer->buf->writeRawData(gpu_, 0, sizeof(dummy), &dummy, Wait);
+  return true;
+}
+
 // ================================================================================================
 bool ManagedBuffer::create(Resource::MemoryType type) {
+  type_ = type;
   for (uint i = 0; i < pool_.size(); ++i) {
-    pool_[i].buf = new Memory(const_cast<pal::Device&>(gpu_.dev()), size_);
-    if (nullptr == pool_[i].buf || !pool_[i].buf->create(type)) {
-      LogPrintfError("We couldn't create HW constant buffer, size(%d)!", size_);
+    if (!createBuffer(&pool_[i])) {
       return false;
     }
-    // Assign virtual gpu to the allocation. Buffer will be used only on a particular queue
-    pool_[i].buf->memRef()->gpu_ = &gpu_;
-    void* wrtAddress = pool_[i].buf->map(&gpu_);
-    if (wrtAddress == nullptr) {
-      LogPrintfError("We couldn't map HW constant buffer, size(%d)!", size_);
-      return false;
-    }
-    // Make sure OCL touches every buffer in the queue to avoid delays on the first submit
-    uint dummy = 0;
-    static constexpr bool Wait = true;
-    // Write 0 for the buffer paging by VidMM
-    pool_[i].buf->writeRawData(gpu_, 0, sizeof(dummy), &dummy, Wait);
   }
   wrtAddress_ = pool_[activeBuffer_].buf->data();
   return true;
 }
 
+// ================================================================================================
+bool ManagedBuffer::isBusy(TimeStampedBuffer* buffer) {
+  bool busy = !gpu().isDone(&buffer->events[MainEngine]);
+  if (!gpu().dev().settings().disableSdma_) {
+    busy |= !gpu().isDone(&buffer->events[SdmaEngine]);
+  }
+  return busy;
+}
+
 // ================================================================================================
 address ManagedBuffer::reserve(uint32_t size, uint64_t* gpu_address) {
   // Align to the maximum data size available in OpenCL
@@ -84,7 +103,23 @@ address ManagedBuffer::reserve(uint32_t size, uint64_t* gpu_address) {
   if ((wrtOffset_ + count) > size_) {
     // Get the next buffer in the list
     ++activeBuffer_;
-    activeBuffer_ %= MaxNumberOfBuffers;
+    activeBuffer_ %= pool_.size();
+    // A burst of the dispatches wrapped the pool, hence insert a new buffer instead of a stall.
+    // The buffers are fenced once per segment, so only the reused buffer needs the wait
+    if ((pool_.size() < MaxNumberOfBuffers) && isBusy(&pool_[activeBuffer_])) {
+      TimeStampedBuffer buffer = {};
+      if (createBuffer(&buffer)) {
+        pool_.insert(pool_.begin() + activeBuffer_, buffer);
+      } else {
+        if (buffer.buf != nullptr) {
+          if (buffer.buf->data() != nullptr) {
+            buffer.buf->unmap(&gpu_);
+          }
+          delete buffer.buf;
+        }
+        LogWarning("Managed buffer pool can't grow, waiting for the next buffer");
+      }
+    }
     if (!gpu().dev().settings().disableSdma_) {
       // Make sure the buffer isn't busy
       gpu().waitForEvent(&pool_[activeBuffer_].events[SdmaEngine]);
@@ -62,6 +62,9 @@ class ManagedBuffer : public amd::EmbeddedObject {
   //! Update the timestamp for the HW operation
   void pinGpuEvent();
 
+  //! Returns the current number of the managed buffers
+  uint32_t numBuffers() const { return static_cast<uint32_t>(pool_.size()); }
+
   //! Returns VirtualGPU object this managed resource associated
   VirtualGPU& gpu() const { return gpu_; }
 
@@ -71,8 +74,16 @@ class ManagedBuffer : public amd::EmbeddedObject {
     GpuEvent events[AllEngines];
   };
 
-  //! The maximum number of the managed buffers
-  static constexpr uint32_t MaxNumberOfBuffers = 3;
+  //! The initial number of the managed buffers
+  static constexpr uint32_t InitNumberOfBuffers = 3;
+  //! The maximum number of the managed buffers, the pool grows to on the bursts
+  static constexpr uint32_t MaxNumberOfBuffers = 16;
+
+  //! Creates and maps a single managed buffer
+  bool createBuffer(TimeStampedBuffer* buffer);
+
+  //! Returns TRUE if HW still uses the buffer
+  bool isBusy(TimeStampedBuffer* buffer);
 
   //! Disable copy constructor
   ManagedBuffer(const ManagedBuffer&) = delete;
@@ -86,6 +97,7 @@ class ManagedBuffer : public amd::EmbeddedObject {
   uint32_t size_;                        //!< Constant buffer size
   uint32_t wrtOffset_;                   //!< Current write offset
   address wrtAddress_;                   //!< Write address in CB
+  Resource::MemoryType type_;            //!< Memory type of the managed buffers
 };
 
 //! Constant buffer
@@ -20,6 +20,7 @@
 
 #include "platform/program.hpp"
 #include "platform/kernel.hpp"
+#include "platform/runtime.hpp"
 #include "os/os.hpp"
 #include "device/device.hpp"
 #include "device/pal/paldefs.hpp"
@@ -309,6 +310,7 @@ void NullDevice::fillDeviceInfo(const Pal::DeviceProperties& palProp,
                                 const Pal::GpuMemoryHeapProperties heaps[Pal::GpuHeapCount],
                                 size_t maxTextureSize, uint numComputeRings,
                                 uint numExclusiveComputeRings) {
+  amd::InitPhase phase("fillDeviceInfo");
   info_.type_ = CL_DEVICE_TYPE_GPU;
   info_.vendorId_ = palProp.vendorId;
 
@@ -722,7 +724,6 @@ Device::Device()
       lockPAL_("PAL Ops Lock", true),
       vgpusAccess_("Virtual GPU List Ops Lock", true),
       scratchAlloc_("Scratch Allocation Lock", true),
-      mapCacheOps_("Map Cache Lock", true),
       lockResourceOps_("Resource List Ops Lock", true),
       xferRead_(nullptr),
       mapCache_(nullptr),
@@ -731,7 +732,10 @@ Device::Device()
       heapInitComplete_(false),
       xferQueue_(nullptr),
       globalScratchBuf_(nullptr),
+      scratchReserved_(0),
       srdManager_(nullptr),
+      samplerLock_("Sampler cache lock"),
+      interopLock_("Interop memory cache lock"),
       resourceList_(nullptr),
       rgpCaptureMgr_(nullptr) {}
 
@@ -772,16 +776,14 @@ Device::~Device() {
   delete blitProgram_;
 
   // Release cached map targets
-  for (uint i = 0; mapCache_ != nullptr && i < mapCache_->size(); ++i) {
-    if ((*mapCache_)[i] != nullptr) {
-      (*mapCache_)[i]->release();
-    }
-  }
   delete mapCache_;
 
   // Destroy temporary buffers for read/write
   delete xferRead_;
 
+  // Close the cached interop memory
+  releaseInteropMemory();
+
   // Destroy resource cache
   delete resourceCache_;
 
@@ -799,11 +801,13 @@ Device::~Device() {
 
 extern const char* SchedulerSourceCode;
 extern const char* GwsInitSourceCode;
+extern const char* MipmapSourceCode;
 Pal::IDevice* gDeviceList[Pal::MaxDevices] = {};
 uint32_t gStartDevice = 0;
 uint32_t gNumDevices = 0;
 
 bool Device::create(Pal::IDevice* device) {
+  amd::InitPhase phase("pal::Device::create");
   resourceList_ = new std::unordered_set<Resource*>();
   if (nullptr == resourceList_) {
     return false;
@@ -938,12 +942,10 @@ bool Device::create(Pal::IDevice* device) {
     return false;
   }
 
-  mapCache_ = new std::vector<amd::Memory*>();
+  mapCache_ = new device::MapCache(GPU_MAP_CACHE_SIZE * Mi, &memoryUsage());
   if (mapCache_ == nullptr) {
     return false;
   }
-  // Use just 1 entry by default for the map cache
-  mapCache_->push_back(nullptr);
 
   size_t resourceCacheSize = settings().resourceCacheSize_;
   // Create resource cache.
@@ -1524,11 +1526,9 @@ pal::Memory* Device::createBuffer(amd::Memory& owner, bool directAccess) const {
     if (result) {
       // Initialize if the memory is a pipe object
       if (owner.getType() == CL_MEM_OBJECT_PIPE) {
-        // Pipe initialize in order read_idx, write_idx, end_idx. Refer clk_pipe_t structure.
-        // Init with 3 DWORDS for 32bit addressing and 6 DWORDS for 64bit
-        size_t pipeInit[3] = {0, 0, owner.asPipe()->getMaxNumPackets()};
+        const amd::Pipe::Header pipeInit = owner.asPipe()->initialHeader();
         static_cast<const KernelBlitManager&>(xferMgr()).writeRawData(*gpuMemory, sizeof(pipeInit),
-                                                                      pipeInit);
+                                                                      &pipeInit);
       }
       // If memory has direct access from host, then get CPU address
       if (gpuMemory->isHostMemDirectAccess() && (type != Resource::ExternalPhysical) &&
@@ -1850,80 +1850,21 @@ bool Device::globalFreeMemory(size_t* freeMemory) const {
 }
 
 amd::Memory* Device::findMapTarget(size_t size) const {
-  // Must be serialised for access
-  amd::ScopedLock lk(mapCacheOps_);
-
-  amd::Memory* map = nullptr;
-  size_t minSize = 0;
-  size_t maxSize = 0;
-  uint mapId = mapCache_->size();
-  uint releaseId = mapCache_->size();
-
-  // Find if the list has a map target of appropriate size
-  for (uint i = 0; i < mapCache_->size(); i++) {
-    if ((*mapCache_)[i] != nullptr) {
-      // Requested size is smaller than the entry size
-      if (size < (*mapCache_)[i]->getSize()) {
-        if ((minSize == 0) || (minSize > (*mapCache_)[i]->getSize())) {
-          minSize = (*mapCache_)[i]->getSize();
-          mapId = i;
-        }
-      }
-      // Requeted size matches the entry size
-      else if (size == (*mapCache_)[i]->getSize()) {
-        mapId = i;
-        break;
-      } else {
-        // Find the biggest map target in the list
-        if (maxSize < (*mapCache_)[i]->getSize()) {
-          maxSize = (*mapCache_)[i]->getSize();
-          releaseId = i;
-        }
-      }
-    }
-  }
-
-  // Check if we found any map target
-  if (mapId < mapCache_->size()) {
-    map = (*mapCache_)[mapId];
-    (*mapCache_)[mapId] = nullptr;
+  amd::Memory* map = mapCache_->find(size);
+  if (map != nullptr) {
     Memory* gpuMemory = reinterpret_cast<Memory*>(map->getDeviceMemory(*this));
 
     // Get the base pointer for the map resource
     if ((gpuMemory == nullptr) || (nullptr == gpuMemory->map(nullptr))) {
-      (*mapCache_)[mapId]->release();
+      map->release();
       map = nullptr;
     }
   }
-  // If cache is full, then release the biggest map target
-  else if (releaseId < mapCache_->size()) {
-    (*mapCache_)[releaseId]->release();
-    (*mapCache_)[releaseId] = nullptr;
-  }
-
   return map;
 }
 
 bool Device::addMapTarget(amd::Memory* memory) const {
-  // Must be serialised for access
-  amd::ScopedLock lk(mapCacheOps_);
-
-  // the svm memory shouldn't be cached
-  if (!memory->canBeCached()) {
-    return false;
-  }
-  // Find if the list has a map target of appropriate size
-  for (uint i = 0; i < mapCache_->size(); ++i) {
-    if ((*mapCache_)[i] == nullptr) {
-      (*mapCache_)[i] = memory;
-      return true;
-    }
-  }
-
-  // Add a new entry
-  mapCache_->push_back(memory);
-
-  return true;
+  return mapCache_->add(memory);
 }
 
 Device::ScratchBuffer::~ScratchBuffer() { destroyMemory(); }
@@ -1934,6 +1875,12 @@ void Device::ScratchBuffer::destroyMemory() {
   memObj_ = nullptr;
 }
 
+void Device::updateScratchReserved(uint64_t size) const {
+  // The metrics are counters, so the wrapped delta makes the sum equal to the current size
+  metrics().add(VDI_METRIC_SCRATCH_BYTES, size - scratchReserved_);
+  const_cast<Device*>(this)->scratchReserved_ = size;
+}
+
 bool Device::allocScratch(uint regNum, const VirtualGPU* vgpu, uint vgprs) {
   if (regNum > 0) {
     // Serialize the scratch buffer allocation code
@@ -1963,8 +1910,24 @@ bool Device::allocScratch(uint regNum, const VirtualGPU* vgpu, uint vgprs) {
     uint64_t newSize =
         static_cast<uint64_t>(info().wavefrontWidth_) * privateMemSize * numMaxWaves * numTotalCUs;
 
-    // Check if the current buffer isn't big enough
-    if (newSize > scratch_[sb]->size_) {
+    // A queue returns the scratch to the global store, if the large size wasn't needed
+    // for the timeout, so a single kernel doesn't hold the huge scratch forever
+    static constexpr uint64_t ShrinkRatio = 4;
+    const uint64_t now = amd::Os::timeNanos();
+    bool shrink = false;
+    if ((newSize * ShrinkRatio) > scratch_[sb]->size_) {
+      scratch_[sb]->lastUse_ = now;
+    } else if ((GPU_SCRATCH_SHRINK_TIMEOUT != 0) &&
+               ((now - scratch_[sb]->lastUse_) > GPU_SCRATCH_SHRINK_TIMEOUT * 1000000ULL)) {
+      ClPrint(amd::LOG_INFO, amd::LOG_RESOURCE, "Shrink scratch on queue %u: %llu -> %llu bytes",
+              sb, static_cast<unsigned long long>(scratch_[sb]->size_),
+              static_cast<unsigned long long>(newSize));
+      scratch_[sb]->lastUse_ = now;
+      shrink = true;
+    }
+
+    // Check if the current buffer isn't big enough or must be shrunk
+    if ((newSize > scratch_[sb]->size_) || shrink) {
       // Stall all command queues, since runtime will reallocate memory
       ScopedLockVgpus lock(*this);
 
@@ -2000,8 +1963,12 @@ bool Device::allocScratch(uint regNum, const VirtualGPU* vgpu, uint vgprs) {
         for (uint s = 0; s < scratch_.size(); ++s) {
           scratch_[s]->size_ = 0;
         }
+        delete globalScratchBuf_;
+        globalScratchBuf_ = nullptr;
+        updateScratchReserved(0);
         return false;
       }
+      updateScratchReserved(size);
 
       for (uint s = 0; s < scratch_.size(); ++s) {
         // Loop through all memory objects and reallocate them
@@ -2077,6 +2044,7 @@ void Device::destroyScratchBuffers() {
     }
     delete globalScratchBuf_;
     globalScratchBuf_ = nullptr;
+    updateScratchReserved(0);
   }
 }
 
@@ -2237,95 +2205,216 @@ void Device::ReleaseExclusiveGpuAccess(VirtualGPU& vgpu) const {
 }
 
 Device::SrdManager::~SrdManager() {
-  for (uint i = 0; i < pool_.size(); ++i) {
+  for (uint i = 0; i < numChunks_; ++i) {
     pool_[i].buf_->unmap(nullptr);
     delete pool_[i].buf_;
-    delete pool_[i].flags_;
+    delete[] pool_[i].flags_;
   }
 }
 
 bool Sampler::create(uint32_t oclSamplerState) {
-  hwSrd_ = dev_.srds().allocSrdSlot(&hwState_);
-  if (0 == hwSrd_) {
-    return false;
-  }
-  dev_.fillHwSampler(oclSamplerState, hwState_, HsaSamplerObjectSize);
-  return true;
+  return dev_.acquireSampler(oclSamplerState, CL_FILTER_NONE, 0.f, CL_MAXFLOAT, &hwSrd_,
+                             &hwState_);
 }
 
 bool Sampler::create(const amd::Sampler& owner) {
-  hwSrd_ = dev_.srds().allocSrdSlot(&hwState_);
-  if (0 == hwSrd_) {
+  return dev_.acquireSampler(owner.state(), owner.mipFilter(), owner.minLod(), owner.maxLod(),
+                             &hwSrd_, &hwState_);
+}
+
+Sampler::~Sampler() {
+  if (0 != hwSrd_) {
+    dev_.releaseSampler(hwSrd_);
+  }
+}
+
+bool Device::acquireSampler(uint32_t state, uint32_t mipFilter, float minLod, float maxLod,
+                            uint64_t* hwSrd, address* hwState) const {
+  const SamplerKey key(state, mipFilter, minLod, maxLod);
+  amd::ScopedLock lock(samplerLock_);
+  auto it = samplerCache_.find(key);
+  if (it != samplerCache_.end()) {
+    // The SRD is never modified after the creation, hence it's safe to share it
+    ++it->second.users_;
+    *hwSrd = it->second.hwSrd_;
+    *hwState = it->second.hwState_;
+    return true;
+  }
+
+  *hwSrd = srds().allocSrdSlot(hwState);
+  if (0 == *hwSrd) {
     return false;
   }
-  dev_.fillHwSampler(owner.state(), hwState_, HsaSamplerObjectSize, owner.mipFilter(),
-                     owner.minLod(), owner.maxLod());
+  fillHwSampler(state, *hwState, HsaSamplerObjectSize, mipFilter, minLod, maxLod);
+  samplerCache_[key] = {*hwSrd, *hwState, 1};
   return true;
 }
 
-Sampler::~Sampler() { dev_.srds().freeSrdSlot(hwSrd_); }
+void Device::releaseSampler(uint64_t hwSrd) const {
+  amd::ScopedLock lock(samplerLock_);
+  // The cache holds a few entries, one per distinct sampler state
+  for (auto it = samplerCache_.begin(); it != samplerCache_.end(); ++it) {
+    if (it->second.hwSrd_ == hwSrd) {
+      if (--it->second.users_ == 0) {
+        srds().freeSrdSlot(hwSrd);
+        samplerCache_.erase(it);
+      }
+      return;
+    }
+  }
+  assert(false && "Sampler isn't in the cache!");
+}
+
+GpuMemoryReference* Device::findInteropMemory(Pal::OsExternalHandle handle) const {
+  if (PAL_INTEROP_CACHE_SIZE == 0) {
+    return nullptr;
+  }
+  amd::ScopedLock lock(interopLock_);
+  for (auto it = interopMemory_.begin(); it != interopMemory_.end(); ++it) {
+    if (it->first == handle) {
+      // Move the entry to the front, so the frequently acquired resources stay open
+      interopMemory_.splice(interopMemory_.begin(), interopMemory_, it);
+      it->second->retain();
+      return it->second;
+    }
+  }
+  return nullptr;
+}
+
+void Device::cacheInteropMemory(Pal::OsExternalHandle handle, GpuMemoryReference* memRef) const {
+  if (PAL_INTEROP_CACHE_SIZE == 0) {
+    return;
+  }
+  GpuMemoryReference* evicted = nullptr;
+  {
+    amd::ScopedLock lock(interopLock_);
+    memRef->retain();
+    interopMemory_.push_front(std::make_pair(handle, memRef));
+    if (interopMemory_.size() > PAL_INTEROP_CACHE_SIZE) {
+      evicted = interopMemory_.back().second;
+      interopMemory_.pop_back();
+    }
+  }
+  // The last release closes the shared resource, hence it's done outside of the lock
+  if (evicted != nullptr) {
+    evicted->release();
+  }
+}
+
+void Device::releaseInteropMemory() const {
+  std::list<std::pair<Pal::OsExternalHandle, GpuMemoryReference*>> entries;
+  {
+    amd::ScopedLock lock(interopLock_);
+    entries.swap(interopMemory_);
+  }
+  for (const auto& it : entries) {
+    it.second->release();
+  }
+}
+
+int Device::SrdManager::claimSlot(const Chunk& ch, uint start) {
+  for (uint i = 0; i < numFlags_; ++i) {
+    const uint s = (start + i) % numFlags_;
+    uint mask = ch.flags_[s].load(std::memory_order_relaxed);
+    while (mask != 0) {
+      // Find the first empty index and mark the slot as busy
+      const uint idx = amd::leastBitSet(mask);
+      if (ch.flags_[s].compare_exchange_weak(mask, mask & ~(1u << idx),
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+        return static_cast<int>(s * MaskBits + idx);
+      }
+    }
+  }
+  return -1;
+}
 
 uint64_t Device::SrdManager::allocSrdSlot(address* cpuAddr) {
-  amd::ScopedLock lock(ml_);
-  // Check all buffers in the pool of chunks
-  for (uint i = 0; i < pool_.size(); ++i) {
-    const Chunk& ch = pool_[i];
-    // Search for an empty slot
-    for (uint s = 0; s < numFlags_; ++s) {
-      uint mask = ch.flags_[s];
-      // Check if there is an empty slot in this group
-      if (mask != 0) {
-        uint idx;
-        // Find the first empty index
-        for (idx = 0; (mask & 0x1) == 0; mask >>= 1, ++idx)
-          ;
-        // Mark the slot as busy
-        ch.flags_[s] &= ~(1 << idx);
+  // Each thread starts the search from a different word, so the concurrent
+  // allocations don't contend on the same bitmap word
+  static std::atomic<uint> threadCount(0);
+  thread_local const uint threadStart = threadCount++;
+
+  while (true) {
+    const uint numChunks = numChunks_.load(std::memory_order_acquire);
+    // Check all buffers in the pool of chunks, starting from the first one with free slots
+    for (uint i = firstFree_.load(std::memory_order_relaxed); i < numChunks; ++i) {
+      const Chunk& ch = pool_[i];
+      int slot = claimSlot(ch, threadStart % numFlags_);
+      if (slot >= 0) {
         // Calculate SRD offset in the buffer
-        uint offset = (s * MaskBits + idx) * srdSize_;
+        uint offset = slot * srdSize_;
         *cpuAddr = ch.buf_->data() + offset;
         return ch.buf_->vmAddress() + offset;
       }
+      // The chunk is full, so move the hint to the next chunk
+      uint hint = i;
+      firstFree_.compare_exchange_strong(hint, i + 1, std::memory_order_relaxed);
+    }
+    // At this point the manager doesn't have empty slots
+    // and has to allocate a new chunk
+    uint64_t vmAddr = 0;
+    if (growPool(numChunks, cpuAddr, &vmAddr)) {
+      return vmAddr;
     }
   }
-  // At this point the manager doesn't have empty slots
-  // and has to allocate a new chunk
-  Chunk chunk;
-  chunk.flags_ = new uint[numFlags_];
+}
+
+bool Device::SrdManager::growPool(uint numChunks, address* cpuAddr, uint64_t* vmAddr) {
+  amd::ScopedLock lock(ml_);
+  if (numChunks_.load(std::memory_order_relaxed) != numChunks) {
+    return false;
+  }
+  *vmAddr = 0;
+  if (numChunks == MaxChunks) {
+    LogError("SRD manager is out of the chunks");
+    return true;
+  }
+  Chunk& chunk = pool_[numChunks];
+  chunk.flags_ = new std::atomic<uint>[numFlags_];
   if (chunk.flags_ == nullptr) {
-    return 0;
+    return true;
   }
   chunk.buf_ = new Memory(dev_, bufSize_);
   if (chunk.buf_ == nullptr || !chunk.buf_->create(Resource::Remote) ||
       (nullptr == chunk.buf_->map(nullptr))) {
     delete[] chunk.flags_;
     delete chunk.buf_;
-    return 0;
+    chunk = Chunk();
+    return true;
+  }
+  // All slots in the chunk are in "free" state. Take the first one...
+  chunk.flags_[0].store(~0x1u, std::memory_order_relaxed);
+  for (uint s = 1; s < numFlags_; ++s) {
+    chunk.flags_[s].store(~0u, std::memory_order_relaxed);
   }
-  // All slots in the chunk are in "free" state
-  memset(chunk.flags_, 0xff, numFlags_ * sizeof(uint));
-  // Take the first one...
-  chunk.flags_[0] &= ~0x1;
-  pool_.push_back(chunk);
+  // Publish the chunk to the lock free searches
+  numChunks_.store(numChunks + 1, std::memory_order_release);
   *cpuAddr = chunk.buf_->data();
-  return chunk.buf_->vmAddress();
+  *vmAddr = chunk.buf_->vmAddress();
+  return true;
 }
 
 void Device::SrdManager::freeSrdSlot(uint64_t addr) {
-  amd::ScopedLock lock(ml_);
   if (addr == 0) return;
+  const uint numChunks = numChunks_.load(std::memory_order_acquire);
   // Check all buffers in the pool of chunks
-  for (uint i = 0; i < pool_.size(); ++i) {
-    Chunk* ch = &pool_[i];
+  for (uint i = 0; i < numChunks; ++i) {
+    const Chunk& ch = pool_[i];
     // Find the offset
-    int64_t offs = static_cast<int64_t>(addr) - static_cast<int64_t>(ch->buf_->vmAddress());
+    int64_t offs = static_cast<int64_t>(addr) - static_cast<int64_t>(ch.buf_->vmAddress());
     // Check if the offset inside the chunk buffer
     if ((offs >= 0) && (offs < bufSize_)) {
       // Find the index in the chunk
       uint idx = offs / srdSize_;
       uint s = idx / MaskBits;
       // Free the slot
-      ch->flags_[s] |= 1 << (idx % MaskBits);
+      ch.flags_[s].fetch_or(1u << (idx % MaskBits), std::memory_order_release);
+      // Move the hint back, if the chunk is before the first free one
+      uint hint = firstFree_.load(std::memory_order_relaxed);
+      while ((i < hint) &&
+             !firstFree_.compare_exchange_weak(hint, i, std::memory_order_relaxed)) {
+      }
       return;
     }
   }
@@ -2341,6 +2430,7 @@ void Device::updateAllocedMemory(Pal::GpuHeap heap, Pal::gpusize size, bool free
 }
 
 bool Device::createBlitProgram() {
+  amd::InitPhase phase("createBlitProgram");
   bool result = true;
 
   // Delayed compilation due to brig_loader memory allocation
@@ -2362,6 +2452,10 @@ bool Device::createBlitProgram() {
       if (info().cooperativeGroups_) {
         sch.append(GwsInitSourceCode);
       }
+      if (GPU_MIPMAP) {
+        // The kernels for the mip chain operations require the image writes with LOD
+        sch.append(MipmapSourceCode);
+      }
     }
     blits = sch.c_str();
     ocl20 = "-cl-std=CL2.0";
@@ -2379,7 +2473,8 @@ bool Device::createBlitProgram() {
 }
 
 void Device::SrdManager::fillResourceList(VirtualGPU& gpu) {
-  for (uint i = 0; i < pool_.size(); ++i) {
+  const uint numChunks = numChunks_.load(std::memory_order_acquire);
+  for (uint i = 0; i < numChunks; ++i) {
     gpu.addVmMemory(pool_[i].buf_);
   }
 }
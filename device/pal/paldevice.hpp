@@ -22,6 +22,7 @@
 
 #include "top.hpp"
 #include "device/device.hpp"
+#include "device/devmapcache.hpp"
 #include "platform/command.hpp"
 #include "platform/program.hpp"
 #include "platform/perfctr.hpp"
@@ -41,6 +42,8 @@
 #include "memory"
 
 #include <atomic>
+#include <list>
+#include <tuple>
 #include <unordered_set>
 
 #if defined(__clang__)
@@ -290,9 +293,10 @@ class Device : public NullDevice {
     Memory* memObj_;           //!< Memory objects for scratch buffers
     uint64_t offset_;          //!< Offset from the global scratch store
     uint64_t size_;            //!< Scratch buffer size on this queue
+    uint64_t lastUse_;         //!< The last time in ns, a kernel needed the current size
 
     //! Default constructor
-    ScratchBuffer() : memObj_(nullptr), offset_(0), size_(0) {}
+    ScratchBuffer() : memObj_(nullptr), offset_(0), size_(0), lastUse_(0) {}
 
     //! Default constructor
     ~ScratchBuffer();
@@ -302,10 +306,15 @@ class Device : public NullDevice {
   };
 
 
+  //! The allocator of the SRD slots. The slots are claimed lock free with a bitmap search.
+  //! The chunk array has a fixed capacity, so it's never reallocated and the chunk growth
+  //! doesn't block the allocations from the existing chunks
   class SrdManager : public amd::HeapObject {
    public:
     SrdManager(const Device& dev, uint srdSize, uint bufSize)
         : dev_(dev),
+          numChunks_(0),
+          firstFree_(0),
           numFlags_(bufSize / (srdSize * MaskBits)),
           srdSize_(srdSize),
           bufSize_(bufSize) {}
@@ -329,14 +338,24 @@ class Device : public NullDevice {
 
     struct Chunk {
       Memory* buf_;
-      uint* flags_;
+      std::atomic<uint>* flags_;  //!< The bitmap of the free slots
       Chunk() : buf_(NULL), flags_(NULL) {}
     };
 
+    //! Claims a free slot in the chunk. Returns the slot index or -1 if the chunk is full
+    int claimSlot(const Chunk& ch, uint start);
+
+    //! Adds a new chunk and takes its first slot. Returns FALSE if another thread
+    //! added a chunk already, then the search must be repeated
+    bool growPool(uint numChunks, address* cpuAddr, uint64_t* vmAddr);
+
     static constexpr uint MaskBits = 32;
+    static constexpr uint MaxChunks = 4096;
     const Device& dev_;        //!< GPU device for the chunk manager
-    amd::Monitor ml_;          //!< Global lock for the SRD manager
-    std::vector<Chunk> pool_;  //!< Pool of SRD buffers
+    amd::Monitor ml_;          //!< Lock for the chunk growth
+    Chunk pool_[MaxChunks];    //!< Pool of SRD buffers
+    std::atomic<uint> numChunks_;  //!< The number of the published chunks
+    std::atomic<uint> firstFree_;  //!< The first chunk, which may have free slots
     uint numFlags_;            //!< Total number of flags in array
     uint srdSize_;             //!< SRD size
     uint bufSize_;             //!< Buffer size that holds SRDs
@@ -396,7 +415,10 @@ class Device : public NullDevice {
   //! Free resource cache on device if OCL context was destroyed.
   //! @note: Backend device doesn't track resources per context and releases all resources, regardless
   //! the number of still active contexts
-  virtual void ContextDestroy() { resourceCache().free(); }
+  virtual void ContextDestroy() {
+    resourceCache().free();
+    releaseInteropMemory();
+  }
 
   //! Validates kernel before execution
   virtual bool validateKernel(const amd::Kernel& kernel,  //!< AMD kernel object
@@ -516,6 +538,22 @@ class Device : public NullDevice {
   //! Returns SRD manger object
   SrdManager& srds() const { return *srdManager_; }
 
+  //! Returns a shared sampler SRD for the state, which is created on the first use
+  bool acquireSampler(uint32_t state, uint32_t mipFilter, float minLod, float maxLod,
+                      uint64_t* hwSrd, address* hwState) const;
+
+  //! Releases the shared sampler SRD and frees the slot after the last user
+  void releaseSampler(uint64_t hwSrd) const;
+
+  //! Returns the retained memory, opened earlier for the shared handle, or nullptr
+  GpuMemoryReference* findInteropMemory(Pal::OsExternalHandle handle) const;
+
+  //! Keeps the opened memory of the shared handle, so the next open can reuse it
+  void cacheInteropMemory(Pal::OsExternalHandle handle, GpuMemoryReference* memRef) const;
+
+  //! Releases all opened memory of the shared handles
+  void releaseInteropMemory() const;
+
   //! Initial the Hardware Debug Manager
   int32_t hwDebugManagerInit(amd::Context* context, uintptr_t messageStorage);
 
@@ -634,6 +672,9 @@ class Device : public NullDevice {
                            bool directAccess    //!< Use direct host memory access
                            ) const;
 
+  //! Reports the new size of the global scratch store in the metrics
+  void updateScratchReserved(uint64_t size) const;
+
   //! Allocates/reallocates the scratch buffer, according to the usage
   bool allocScratch(uint regNum,             //!< Number of the scratch registers
                     const VirtualGPU* vgpu,  //!< Virtual GPU for the allocation
@@ -660,10 +701,9 @@ class Device : public NullDevice {
   mutable amd::Monitor lockPAL_;          //!< Lock to serialise PAL access
   mutable amd::Monitor vgpusAccess_;      //!< Lock to serialise virtual gpu list access
   mutable amd::Monitor scratchAlloc_;     //!< Lock to serialise scratch allocation
-  mutable amd::Monitor mapCacheOps_;      //!< Lock to serialise cache for the map resources
   mutable amd::Monitor lockResourceOps_;  //!< Lock to serialise resource access
   XferBuffers* xferRead_;                 //!< Transfer buffers read
-  std::vector<amd::Memory*>* mapCache_;   //!< Map cache info structure
+  device::MapCache* mapCache_;            //!< Map cache info structure
   ResourceCache* resourceCache_;          //!< Resource cache
   std::map<ExclusiveQueueType, uint32_t>
       exclusiveComputeEnginesId_;        //!< The number of available compute engines
@@ -673,7 +713,22 @@ class Device : public NullDevice {
   VirtualGPU* xferQueue_;                //!< Transfer queue
   std::vector<ScratchBuffer*> scratch_;  //!< Scratch buffers for kernels
   Memory* globalScratchBuf_;             //!< Global scratch buffer
+  uint64_t scratchReserved_;             //!< The size of the global scratch store
   SrdManager* srdManager_;               //!< SRD manager object
+
+  //! The sampler state: OCL state, mip filter, min and max LOD
+  typedef std::tuple<uint32_t, uint32_t, float, float> SamplerKey;
+  //! A sampler SRD, which is shared between the device samplers with the same state
+  struct SamplerEntry {
+    uint64_t hwSrd_;    //!< GPU address of the SRD slot
+    address hwState_;   //!< CPU pointer to the SRD slot
+    uint users_;        //!< The number of the device samplers, which share it
+  };
+  mutable amd::Monitor samplerLock_;                         //!< Lock for the sampler cache
+  mutable std::map<SamplerKey, SamplerEntry> samplerCache_;  //!< The samplers, keyed by the state
+  mutable amd::Monitor interopLock_;   //!< Lock for the interop memory cache
+  //! The opened memory of the shared handles, the most recently used first
+  mutable std::list<std::pair<Pal::OsExternalHandle, GpuMemoryReference*>> interopMemory_;
   static AppProfile appProfile_;         //!< application profile
   mutable bool freeCPUMem_;              //!< flag to mark GPU free SVM CPU mem
   Pal::DeviceProperties properties_;     //!< PAL device properties
@@ -51,6 +51,18 @@ RgpCaptureMgr::RgpCaptureMgr(Pal::IPlatform* platform, const Device& device)
       max_sqtt_disp_(device_.settings().rgpSqttDispCount_),
       trace_gpu_mem_limit_(0),
       global_disp_count_(1),  // Must start from 1 according to RGP spec
+      trigger_kernel_(PAL_RGP_TRIGGER_KERNEL),
+      trigger_first_(PAL_RGP_TRIGGER_FIRST),
+      trigger_last_(PAL_RGP_TRIGGER_LAST),
+      trigger_duration_(static_cast<uint64_t>(PAL_RGP_TRIGGER_DURATION) * 1000),
+      trigger_disp_count_(0),
+      trigger_queue_(nullptr),
+      count_disp_(true),
+      duration_armed_(false),
+      probe_ts_(nullptr),
+      probe_queue_(nullptr),
+      probe_cb_id_(0),
+      probe_open_(false),
       se_mask_(0),
       perf_counter_mem_limit_(0),
       perf_counter_frequency_(0),
@@ -247,8 +259,17 @@ void RgpCaptureMgr::WaitForDriverResume() {
 // is used to coordinate RGP trace start/stop.
 void RgpCaptureMgr::PostDispatch(VirtualGPU* gpu) {
   if (rgp_server_->TracesEnabled()) {
+    if (probe_open_ && (probe_queue_ == gpu)) {
+      amd::ScopedLock traceLock(&trace_mutex_);
+      // Close the timed dispatch
+      if (probe_open_ && (probe_queue_ == gpu)) {
+        probe_ts_->end();
+        probe_open_ = false;
+      }
+    }
+
     // If there's currently a trace running, submit the trace-end command buffer
-    if (trace_.status_ == TraceStatus::Running) {
+    if ((trace_.status_ == TraceStatus::Running) && count_disp_) {
       amd::ScopedLock traceLock(&trace_mutex_);
       trace_.sqtt_disp_count_++;
       if (trace_.sqtt_disp_count_ >= max_sqtt_disp_) {
@@ -331,10 +352,16 @@ void RgpCaptureMgr::PreDispatch(VirtualGPU* gpu, const HSAILKernel& kernel, size
   if (rgp_server_->TracesEnabled()) {
     amd::ScopedLock traceLock(&trace_mutex_);
 
+    const bool triggered = CheckTrigger(gpu, kernel);
+
     // Check if there's an RGP trace request pending and we're idle
-    if ((trace_.status_ == TraceStatus::Idle) && rgp_server_->IsTracePending()) {
+    if ((trace_.status_ == TraceStatus::Idle) && triggered && rgp_server_->IsTracePending()) {
       // Attempt to start preparing for a trace
       if (PrepareRGPTrace(gpu) == Pal::Result::Success) {
+        if (TriggersEnabled()) {
+          // The targeted capture traces only the queue of the trigger
+          trigger_queue_ = gpu;
+        }
         // Attempt to start the trace immediately if we do not need to prepare
         if (num_prep_disp_ == 0) {
           if (BeginRGPTrace(gpu) != Pal::Result::Success) {
@@ -391,7 +418,9 @@ void RgpCaptureMgr::PreDispatch(VirtualGPU* gpu, const HSAILKernel& kernel, size
       }
     }
 
-    if (trace_.status_ == TraceStatus::Running) {
+    // The targeted capture skips the markers of the other queues
+    if ((trace_.status_ == TraceStatus::Running) &&
+        (!TriggersEnabled() || (trigger_queue_ == gpu))) {
       RgpSqttMarkerEventType apiEvent = RgpSqttMarkerEventType::CmdNDRangeKernel;
       if (kernel.prog().isInternal()) {
         constexpr RgpSqttMarkerEventType ApiEvents[KernelBlitManager::BlitTotal] = {
@@ -445,6 +474,11 @@ Pal::Result RgpCaptureMgr::PrepareRGPTrace(VirtualGPU* gpu) {
     max_sqtt_disp_ = capture_disp;
   }
 
+  // The dispatch range trigger defines the trace length
+  if ((trigger_first_ != 0) && (trigger_last_ >= trigger_first_)) {
+    max_sqtt_disp_ = trigger_last_ - trigger_first_ + 1;
+  }
+
   trace_gpu_mem_limit_ = traceParameters.gpuMemoryLimitInMb * 1024 * 1024;
   inst_tracing_enabled_ = traceParameters.flags.enableInstructionTokens;
   se_mask_ = traceParameters.seMask;
@@ -708,6 +742,95 @@ void RgpCaptureMgr::FinishRGPTrace(VirtualGPU* gpu, bool aborted) {
   trace_.status_ = TraceStatus::Idle;
   trace_.prepare_queue_ = nullptr;
   trace_.begin_queue_ = nullptr;
+
+  // The duration trigger must find a new slow dispatch for the next trace
+  trigger_queue_ = nullptr;
+  duration_armed_ = false;
+}
+
+// ================================================================================================
+// Returns true if the dispatch matches the capture triggers. The dispatches of the trigger
+// kernel are counted here, so the range trigger selects the Nth through Mth dispatch of it.
+bool RgpCaptureMgr::CheckTrigger(VirtualGPU* gpu, const HSAILKernel& kernel) {
+  count_disp_ = true;
+  if (!TriggersEnabled()) {
+    return true;
+  }
+  count_disp_ = false;
+  if (!trigger_kernel_.empty() && (kernel.name() != trigger_kernel_)) {
+    return false;
+  }
+  if ((trigger_queue_ != nullptr) && (trigger_queue_ != gpu)) {
+    return false;
+  }
+  // Only the dispatches of the trigger kernel on the traced queue define the trace length
+  count_disp_ = true;
+  trigger_disp_count_++;
+  if (trigger_first_ != 0) {
+    if ((trigger_disp_count_ < trigger_first_) ||
+        ((trigger_last_ >= trigger_first_) && (trigger_disp_count_ > trigger_last_))) {
+      return false;
+    }
+  }
+  if (trigger_duration_ != 0) {
+    return CheckDurationTrigger(gpu);
+  }
+  return true;
+}
+
+// ================================================================================================
+// Times one dispatch of the trigger kernel at a time with a timestamp. The trace can't include
+// the dispatch, which was measured already, so it starts from the next dispatch on the queue.
+bool RgpCaptureMgr::CheckDurationTrigger(VirtualGPU* gpu) {
+  if (duration_armed_) {
+    return true;
+  }
+  if ((probe_ts_ != nullptr) && !probe_open_ &&
+      // Don't force a flush of the command buffer with the timed dispatch
+      (probe_queue_->queue(MainEngine).cmdBufId() != probe_cb_id_) &&
+      probe_queue_->queue(MainEngine).isDone(probe_cb_id_)) {
+    uint64_t start = 0;
+    uint64_t end = 0;
+    if (probe_ts_->isValid()) {
+      probe_ts_->value(&start, &end);
+    }
+    probe_queue_->tsCache()->freeTimeStamp(probe_ts_);
+    probe_ts_ = nullptr;
+    if ((end > start) && ((end - start) >= trigger_duration_)) {
+      ClPrint(amd::LOG_INFO, amd::LOG_KERN, "RGP trigger: %s took %llu ns",
+              trigger_kernel_.c_str(), static_cast<unsigned long long>(end - start));
+      duration_armed_ = true;
+      trigger_queue_ = probe_queue_;
+      return (gpu == trigger_queue_);
+    }
+  }
+  if (probe_ts_ == nullptr) {
+    probe_ts_ = gpu->tsCache()->allocTimeStamp();
+    if (probe_ts_ != nullptr) {
+      probe_ts_->begin();
+      probe_queue_ = gpu;
+      probe_cb_id_ = gpu->queue(MainEngine).cmdBufId();
+      probe_open_ = true;
+    }
+  }
+  return false;
+}
+
+// ================================================================================================
+void RgpCaptureMgr::ReleaseQueue(VirtualGPU* gpu) {
+  amd::ScopedLock traceLock(&trace_mutex_);
+  if (probe_queue_ == gpu) {
+    if (probe_ts_ != nullptr) {
+      gpu->tsCache()->freeTimeStamp(probe_ts_);
+      probe_ts_ = nullptr;
+    }
+    probe_queue_ = nullptr;
+    probe_open_ = false;
+  }
+  if (trigger_queue_ == gpu) {
+    trigger_queue_ = nullptr;
+    duration_armed_ = false;
+  }
 }
 
 // ================================================================================================
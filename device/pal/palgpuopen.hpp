@@ -42,6 +42,7 @@ class Settings;
 class Device;
 class VirtualGPU;
 class HSAILKernel;
+class TimeStamp;
 
 // ================================================================================================
 enum class RgpSqqtBarrierReason : uint32_t {
@@ -302,6 +303,8 @@ class RgpCaptureMgr {
   void PostDeviceCreate();
   void PreDeviceDestroy();
   void FinishRGPTrace(VirtualGPU* gpu, bool aborted);
+  // Releases the trigger state of a destroyed queue
+  void ReleaseQueue(VirtualGPU* gpu);
 
   bool IsQueueTimingActive() const;
 
@@ -360,6 +363,14 @@ class RgpCaptureMgr {
                                 uint32_t y, uint32_t z) const;
   void WriteUserEventMarker(const VirtualGPU* gpu, RgpSqttMarkerUserEventType eventType,
                             const std::string& name) const;
+  // Returns true if the targeted capture is requested with the triggers
+  bool TriggersEnabled() const {
+    return !trigger_kernel_.empty() || (trigger_first_ != 0) || (trigger_duration_ != 0);
+  }
+  // Returns true if the dispatch can start a trace
+  bool CheckTrigger(VirtualGPU* gpu, const HSAILKernel& kernel);
+  // Times the dispatches of the trigger kernel and arms the trigger after a slow one
+  bool CheckDurationTrigger(VirtualGPU* gpu);
 
   const Device& device_;
   DevDriver::DevDriverServer* dev_driver_server_;
@@ -373,6 +384,19 @@ class RgpCaptureMgr {
   uint32_t trace_gpu_mem_limit_;
   uint32_t global_disp_count_;
 
+  std::string trigger_kernel_;   // Only the dispatches of the kernel start a trace
+  uint32_t trigger_first_;       // The first dispatch of the trigger kernel in the trace
+  uint32_t trigger_last_;        // The last dispatch of the trigger kernel in the trace
+  uint64_t trigger_duration_;    // Trace after a dispatch of the kernel slower than the time in ns
+  uint32_t trigger_disp_count_;  // The number of the dispatches of the trigger kernel
+  VirtualGPU* trigger_queue_;    // The queue, the targeted capture is scoped to
+  bool count_disp_;              // The current dispatch is counted in the trace length
+  bool duration_armed_;          // A dispatch, slower than the threshold, was found
+  TimeStamp* probe_ts_;          // The timestamp around the timed dispatch
+  VirtualGPU* probe_queue_;      // The queue of the timed dispatch
+  uint probe_cb_id_;             // The command buffer of the timed dispatch
+  bool probe_open_;              // The end of the timed dispatch wasn't recorded yet
+
   uint32_t se_mask_;                 // Shader engine mask
   uint64_t perf_counter_mem_limit_;  // Memory limit for perf counters
   uint32_t perf_counter_frequency_;  // Counter sample frequency
@@ -411,6 +435,7 @@ class RgpCaptureMgr {
   void PreDispatch(VirtualGPU* gpu, const HSAILKernel& kernel, size_t x, size_t y, size_t z) {}
   void PostDispatch(VirtualGPU* gpu) {}
   void FinishRGPTrace(VirtualGPU* gpu, bool aborted) {}
+  void ReleaseQueue(VirtualGPU* gpu) {}
   bool RegisterTimedQueue(uint32_t queue_id, Pal::IQueue* iQueue, bool* debug_vmid) const { return true; }
   bool Update(Pal::IPlatform* platform) const { return true; }
 };
@@ -20,6 +20,7 @@
 
 #include "os/os.hpp"
 #include "utils/flags.hpp"
+#include "platform/runtime.hpp"
 #include "aclTypes.h"
 #include "device/pal/palprogram.hpp"
 #include "device/pal/palblit.hpp"
@@ -314,6 +315,7 @@ bool HSAILProgram::createKernels(void* binary, size_t binSize, bool useUniformWo
 
 bool HSAILProgram::setKernels(void* binary, size_t binSize,
                               amd::Os::FileDesc fdesc, size_t foffset, std::string uri) {
+  amd::InitPhase phase("code object load");
 #if defined(WITH_COMPILER_LIB)
   if (!device().isOnline()) {
     return true;
@@ -770,6 +772,7 @@ bool LightningProgram::createKernels(void* binary, size_t binSize, bool useUnifo
 
 bool LightningProgram::setKernels(void* binary, size_t binSize,
                                   amd::Os::FileDesc fdesc, size_t foffset, std::string uri) {
+  amd::InitPhase phase("code object load");
 #if defined(USE_COMGR_LIBRARY)
   // Stop compilation if it is an offline device - PAL runtime does not
   // support ISA compiled offline
@@ -220,7 +220,13 @@ GpuMemoryReference* GpuMemoryReference::Create(const Device& dev,
 
 // ================================================================================================
 GpuMemoryReference::GpuMemoryReference(const Device& dev)
-    : gpuMem_(nullptr), cpuAddress_(nullptr), device_(dev), gpu_(nullptr) {}
+    : gpuMem_(nullptr),
+      cpuAddress_(nullptr),
+      device_(dev),
+      gpu_(nullptr),
+      residencyQueue_(nullptr),
+      residencyStamp_(0),
+      queues_(0) {}
 
 // ================================================================================================
 GpuMemoryReference::~GpuMemoryReference() {
@@ -228,10 +234,15 @@ GpuMemoryReference::~GpuMemoryReference() {
     return;
   }
   if (gpu_ == nullptr) {
-    Device::ScopedLockVgpus lock(device_);
-    // Release all memory objects on all virtual GPUs
+    // Keep the list of virtual GPUs stable and stall only the queues, which referenced
+    // the memory. The other queues continue the execution
+    amd::ScopedLock lock(device_.vgpusAccess());
     for (uint idx = 1; idx < device_.vgpus().size(); ++idx) {
-      device_.vgpus()[idx]->releaseMemory(this);
+      VirtualGPU* gpu = device_.vgpus()[idx];
+      if (referencedBy(gpu)) {
+        amd::ScopedLock l(gpu->execution());
+        gpu->releaseMemory(this);
+      }
     }
   } else {
     amd::ScopedLock l(gpu_->execution());
@@ -478,6 +489,24 @@ void Resource::memTypeToHeap(Pal::GpuMemoryCreateInfo* createInfo) {
       createInfo->mallPolicy = Pal::GpuMemMallPolicy::Never;
       break;
   }
+
+  // The policy of the memory object overrides the global setting
+  switch (desc_.cachePolicy_) {
+    case amd::Memory::kCacheStreaming:
+      createInfo->mallPolicy = Pal::GpuMemMallPolicy::Never;
+      break;
+    case amd::Memory::kCacheResident:
+      if (desc_.cardMemory_) {
+        createInfo->mallPolicy = Pal::GpuMemMallPolicy::Always;
+      }
+      break;
+    case amd::Memory::kCacheUncached:
+      createInfo->mallPolicy = Pal::GpuMemMallPolicy::Never;
+      createInfo->flags.gl2Uncached = true;
+      break;
+    default:
+      break;
+  }
 }
 
 // ================================================================================================
@@ -777,9 +806,21 @@ bool Resource::CreateInterop(CreateParams* params) {
   }
 #endif  // 0
   if (desc().buffer_ || misc) {
-    memRef_ = GpuMemoryReference::Create(dev(), gpuMemOpenInfo);
+    // D3D apps usually create the objects from the same shared resources on each frame,
+    // so reuse the opened memory instead of opening the resource again
+    const bool cached = (memoryType() == D3D9Interop) || (memoryType() == D3D10Interop) ||
+                        (memoryType() == D3D11Interop);
+    if (cached) {
+      memRef_ = dev().findInteropMemory(openInfo.hExternalResource);
+    }
     if (nullptr == memRef_) {
-      return false;
+      memRef_ = GpuMemoryReference::Create(dev(), gpuMemOpenInfo);
+      if (nullptr == memRef_) {
+        return false;
+      }
+      if (cached) {
+        dev().cacheInteropMemory(openInfo.hExternalResource, memRef_);
+      }
     }
 
     if (misc) {
@@ -1217,6 +1258,13 @@ bool Resource::create(MemoryType memType, CreateParams* params, bool forceLinear
     return CreateImage(params, forceLinear);
   }
 
+  if ((nullptr != params) && (nullptr != params->owner_)) {
+    desc_.cachePolicy_ = params->owner_->cachePolicy();
+    if (desc_.cachePolicy_ == amd::Memory::kCacheUncached) {
+      desc_.gl2CacheDisabled_ = true;
+    }
+  }
+
   Pal::gpusize svmPtr = 0;
   if ((nullptr != params) && (nullptr != params->owner_) &&
       (nullptr != params->owner_->getSvmPtr())) {
@@ -1281,10 +1329,13 @@ void Resource::free() {
   // and resource can be reused on another async queue without a wait on a busy operation
   if (wait) {
     if (memRef_->gpu_ == nullptr) {
-      Device::ScopedLockVgpus lock(dev());
-      // Release all memory objects on all virtual GPUs
+      amd::ScopedLock lock(dev().vgpusAccess());
+      // Wait only on the virtual GPUs, which still have a pending event for the resource
       for (uint idx = 1; idx < dev().vgpus().size(); ++idx) {
-        dev().vgpus()[idx]->waitForEvent(&events_[idx]);
+        if (events_[idx].isValid()) {
+          amd::ScopedLock l(dev().vgpus()[idx]->execution());
+          dev().vgpus()[idx]->waitForEvent(&events_[idx]);
+        }
       }
     } else {
       amd::ScopedLock l(memRef_->gpu_->execution());
@@ -2099,7 +2150,20 @@ bool MemorySubAllocator::Free(amd::Monitor* monitor, GpuMemoryReference* ref, Pa
 }
 
 // ================================================================================================
-ResourceCache::~ResourceCache() { free(); }
+ResourceCache::~ResourceCache() {
+  if (trimmer_ != nullptr) {
+    {
+      amd::ScopedLock l(trimLock_);
+      trimTerminate_ = true;
+      trimLock_.notify();
+    }
+    while (trimmer_->state() < amd::Thread::FINISHED) {
+      amd::Os::yield();
+    }
+    delete trimmer_;
+  }
+  free();
+}
 
 // ================================================================================================
 //! \note the cache works in FILO mode
@@ -2130,25 +2194,39 @@ bool ResourceCache::addGpuMemory(Resource::Descriptor* desc, GpuMemoryReference*
   if (((desc->type_ == Resource::Local) || (desc->type_ == Resource::Persistent) ||
        (desc->type_ == Resource::Remote) || (desc->type_ == Resource::RemoteUSWC)) &&
       (size < cacheSizeLimit_) && !desc->SVMRes_) {
-    // Validate the cache size limit. Loop until we have enough space
-    while ((cacheSize_ + size) > cacheSizeLimit_) {
-      removeLast();
-    }
-
-    Resource::Descriptor* descCached = new Resource::Descriptor;
-    if (descCached != nullptr) {
+    CacheEntry* entry = new CacheEntry;
+    if (entry != nullptr) {
       // Copy the original desc to the cached version
-      memcpy(descCached, desc, sizeof(Resource::Descriptor));
-
-      amd::ScopedLock l(&lockCacheOps_);
-      // Add the current resource to the cache
-      resCache_.push_front({descCached, ref});
-      ref->gpu_ = nullptr;
-      cacheSize_ += size;
-      if (desc->type_ == Resource::Local) {
-        lclCacheSize_ += size;
+      memcpy(&entry->desc_, desc, sizeof(Resource::Descriptor));
+      entry->ref_ = ref;
+      entry->size_ = size;
+      entry->bin_ = binKey(desc->type_, amd::log2(size));
+
+      size_t cacheSize;
+      {
+        amd::ScopedLock l(&lockCacheOps_);
+        // Add the current resource to the cache
+        resCache_.push_front(entry);
+        entry->lruPos_ = resCache_.begin();
+        auto& bin = bins_[entry->bin_];
+        bin.push_front(entry);
+        entry->binPos_ = bin.begin();
+        ref->gpu_ = nullptr;
+        cacheSize_ += size;
+        if (desc->type_ == Resource::Local) {
+          lclCacheSize_ += size;
+        }
+        cacheSize = cacheSize_;
       }
       result = true;
+
+      // The background thread trims the cache over the limit. The allocating thread destroys
+      // the resources only if the trimmer can't keep up and the cache went over the double limit
+      if (cacheSize > cacheSizeLimit_) {
+        if ((cacheSize > 2 * cacheSizeLimit_) || !requestTrim()) {
+          trim(cacheSizeLimit_);
+        }
+      }
     }
   }
 
@@ -2163,8 +2241,11 @@ GpuMemoryReference* ResourceCache::findGpuMemory(Resource::Descriptor* desc, Pal
   amd::ScopedLock l(&lockCacheOps_);
   GpuMemoryReference* ref = nullptr;
 
-  // Check if the runtime can suballocate memory
-  if ((desc->type_ == Resource::Local) && !desc->SVMRes_) {
+  // Check if the runtime can suballocate memory. The chunks are allocated with the default
+  // cache policy, hence the resources with own policy can't be suballocated
+  if (desc->cachePolicy_ != amd::Memory::kCacheDefault) {
+    ref = nullptr;
+  } else if ((desc->type_ == Resource::Local) && !desc->SVMRes_) {
     ref = mem_sub_alloc_local_.Allocate(size, alignment, reserved_va, offset);
   } else if ((desc->type_ == Resource::Local) && desc->SVMRes_) {
     ref = mem_sub_alloc_coarse_.Allocate(size, alignment, reserved_va, offset);
@@ -2186,23 +2267,25 @@ GpuMemoryReference* ResourceCache::findGpuMemory(Resource::Descriptor* desc, Pal
     return ref;
   }
 
-  // Serach the right resource through the cache list
-  for (const auto& it : resCache_) {
-    Resource::Descriptor* entry = it.first;
-    size_t sizeRes = it.second->iMem()->Desc().size;
-    // Find if we can reuse this entry
-    if ((entry->type_ == desc->type_) && (entry->flags_ == desc->flags_) && (size <= sizeRes) &&
-        (size > (sizeRes >> 1)) && ((it.second->iMem()->Desc().gpuVirtAddr % alignment) == 0) &&
-        (entry->isAllocExecute_ == desc->isAllocExecute_)) {
-      ref = it.second;
-      cacheSize_ -= sizeRes;
-      if (entry->type_ == Resource::Local) {
-        lclCacheSize_ -= sizeRes;
+  // A reusable entry is less than twice bigger than the request, hence only the size class
+  // of the request and the next one have to be searched
+  const uint sizeClass = amd::log2(static_cast<size_t>(size));
+  for (uint idx = sizeClass; (idx <= sizeClass + 1) && (ref == nullptr); ++idx) {
+    auto bin = bins_.find(binKey(desc->type_, idx));
+    if (bin == bins_.end()) {
+      continue;
+    }
+    for (auto entry : bin->second) {
+      // Find if we can reuse this entry
+      if ((entry->desc_.flags_ == desc->flags_) && (size <= entry->size_) &&
+          (size > (entry->size_ >> 1)) &&
+          ((entry->ref_->iMem()->Desc().gpuVirtAddr % alignment) == 0) &&
+          (entry->desc_.isAllocExecute_ == desc->isAllocExecute_) &&
+          (entry->desc_.cachePolicy_ == desc->cachePolicy_)) {
+        // Remove the found etry from the cache
+        ref = removeEntry(entry);
+        break;
       }
-      delete it.first;
-      // Remove the found etry from the cache
-      resCache_.remove(it);
-      break;
     }
   }
 
@@ -2215,34 +2298,81 @@ bool ResourceCache::free(size_t minCacheEntries) {
   if (minCacheEntries < resCache_.size()) {
     result = true;
     // Clear the cache
-    while (static_cast<int64_t>(cacheSize_) > 0) {
-      removeLast();
-    }
+    trim(0);
     CondLog((cacheSize_ != 0), "Incorrect size for cache release!");
   }
   return result;
 }
 
 // ================================================================================================
-void ResourceCache::removeLast() {
-  std::pair<Resource::Descriptor*, GpuMemoryReference*> entry;
+GpuMemoryReference* ResourceCache::removeEntry(CacheEntry* entry) {
+  GpuMemoryReference* ref = entry->ref_;
+  resCache_.erase(entry->lruPos_);
+  bins_[entry->bin_].erase(entry->binPos_);
+  cacheSize_ -= entry->size_;
+  if (entry->desc_.type_ == Resource::Local) {
+    lclCacheSize_ -= entry->size_;
+  }
+  delete entry;
+  return ref;
+}
+
+// ================================================================================================
+void ResourceCache::trim(size_t targetSize) {
+  std::vector<GpuMemoryReference*> released;
   {
     // Protect access to the global data
     amd::ScopedLock l(&lockCacheOps_);
-    if (resCache_.size() > 0) {
-      entry = resCache_.back();
-      resCache_.pop_back();
-      cacheSize_ -= entry.second->iMem()->Desc().size;
-      if (entry.first->type_ == Resource::Local) {
-        lclCacheSize_ -= entry.second->iMem()->Desc().size;
-      }
-      // Delete Descriptor
-      delete entry.first;
+    while ((cacheSize_ > targetSize) && !resCache_.empty()) {
+      released.push_back(removeEntry(resCache_.back()));
     }
   }
 
-  // Destroy PAL resource
-  entry.second->release();
+  // Destroy PAL resources outside of the cache lock, since the release locks all queues
+  for (auto ref : released) {
+    ref->release();
+  }
+}
+
+// ================================================================================================
+bool ResourceCache::requestTrim() {
+  amd::ScopedLock l(trimLock_);
+  if (!asyncTrim_) {
+    return false;
+  }
+  if (trimmer_ == nullptr) {
+    trimmer_ = new Trimmer();
+    if ((trimmer_ == nullptr) || (trimmer_->state() < amd::Thread::INITIALIZED) ||
+        !trimmer_->start(this)) {
+      LogWarning("Resource cache trimmer creation failed, the trimming is synchronous");
+      delete trimmer_;
+      trimmer_ = nullptr;
+      asyncTrim_ = false;
+      return false;
+    }
+  }
+  trimRequested_ = true;
+  trimLock_.notify();
+  return true;
+}
+
+// ================================================================================================
+void ResourceCache::trimLoop() {
+  // Trim down to the low watermark, so the trimmer doesn't wake up on each cached resource
+  const size_t lowWatermark = cacheSizeLimit_ - cacheSizeLimit_ / 4;
+  while (true) {
+    {
+      amd::ScopedLock l(trimLock_);
+      while (!trimRequested_ && !trimTerminate_) {
+        trimLock_.wait();
+      }
+      if (trimTerminate_) {
+        return;
+      }
+      trimRequested_ = false;
+    }
+    trim(lowWatermark);
+  }
 }
 
 }  // namespace pal
@@ -26,6 +26,7 @@
 #include "util/palBuddyAllocatorImpl.h"
 
 #include <atomic>
+#include <list>
 #include <unordered_map>
 
 //! \namespace pal PAL Resource Implementation
@@ -63,11 +64,27 @@ class GpuMemoryReference : public amd::ReferenceCountedObject {
 
   Pal::Result MakeResident() const;
 
+  //! Returns the bit of the queue in the queue mask. The bits can collide, which causes
+  //! an extra release only, but a queue, which referenced the memory, is never missed
+  static uint64_t queueBit(const void* queue) {
+    return 1ULL << ((reinterpret_cast<uintptr_t>(queue) >> 6) & 63);
+  }
+
+  //! Marks the queue as the owner of a reference to the memory
+  void addQueue(const void* queue) { queues_.fetch_or(queueBit(queue)); }
+
+  //! Returns TRUE if the queue could reference the memory
+  bool referencedBy(const void* queue) const { return (queues_.load() & queueBit(queue)) != 0; }
+
   Pal::IGpuMemory* gpuMem_;  //!< PAL GPU memory object
   void* cpuAddress_;         //!< CPU address of this memory
   const Device& device_;     //!< GPU device
   //! @note: This field is necessary for the thread safe release only
   VirtualGPU* gpu_;  //!< Resource will be used only on this queue
+  //! @note: The residency stamp is valid for the last queue, which referenced the memory
+  const void* residencyQueue_;    //!< The last queue, which added the memory reference
+  uint64_t residencyStamp_;       //!< The command buffer serial of the last reference
+  std::atomic<uint64_t> queues_;  //!< Mask of the queues, which referenced the memory
 
  protected:
   //! Default destructor
@@ -208,6 +225,7 @@ class Resource : public amd::HeapObject {
         uint isAllocExecute_ : 1;  //!< SVM resource allocation attribute for shader\cmdbuf
         uint isDoppTexture_ : 1;   //!< PAL resource is for a DOPP desktop texture
         uint gl2CacheDisabled_ : 1;//!< PAL resource is allocated with GPU L2 cache disabled.
+        uint cachePolicy_ : 2;     //!< amd::Memory::CachePolicy of the allocation
       };
       uint state_;
     };
@@ -563,6 +581,11 @@ class ResourceCache : public amd::HeapObject {
         cacheSize_(0),
         lclCacheSize_(0),
         cacheSizeLimit_(cacheSizeLimit),
+        trimLock_("PAL resource cache trimmer"),
+        trimmer_(nullptr),
+        asyncTrim_(GPU_RESOURCE_CACHE_ASYNC_TRIM),
+        trimRequested_(false),
+        trimTerminate_(false),
         mem_sub_alloc_local_(device),
         mem_sub_alloc_coarse_(device),
         mem_sub_alloc_fine_(device),
@@ -601,8 +624,41 @@ class ResourceCache : public amd::HeapObject {
   //! Disable operator=
   ResourceCache& operator=(const ResourceCache&);
 
-  //! Removes one last entry from the cache
-  void removeLast();
+  //! The cached resource, linked into the LRU list and into the bin of its size class
+  struct CacheEntry {
+    Resource::Descriptor desc_;                 //!< Resource descriptor - cache key
+    GpuMemoryReference* ref_;                   //!< Resource reference
+    size_t size_;                               //!< Resource size in bytes
+    uint32_t bin_;                              //!< The bin key of the entry
+    std::list<CacheEntry*>::iterator lruPos_;   //!< Position in the LRU list
+    std::list<CacheEntry*>::iterator binPos_;   //!< Position in the bin
+  };
+
+  //! The background thread, which destroys the cached resources over the watermark
+  class Trimmer : public amd::Thread {
+   public:
+    Trimmer() : amd::Thread("PAL Resource Cache Trimmer", CQ_THREAD_STACK_SIZE) {}
+
+    //! The trimmer thread entry point
+    void run(void* data) { reinterpret_cast<ResourceCache*>(data)->trimLoop(); }
+  };
+
+  //! Returns the bin key for the memory type and the size class
+  static uint32_t binKey(Resource::MemoryType type, uint sizeClass) {
+    return (static_cast<uint32_t>(type) << 8) | sizeClass;
+  }
+
+  //! Unlinks the entry from the cache. The cache lock must be held
+  GpuMemoryReference* removeEntry(CacheEntry* entry);
+
+  //! Destroys the least recently used entries until the cache size drops to the target
+  void trim(size_t targetSize);
+
+  //! Wakes up the trimmer thread. Returns false if the trimming must be synchronous
+  bool requestTrim();
+
+  //! Waits for the trim requests and trims the cache to the low watermark
+  void trimLoop();
 
   amd::Monitor lockCacheOps_;  //!< Lock to serialise cache access
 
@@ -610,8 +666,17 @@ class ResourceCache : public amd::HeapObject {
   size_t lclCacheSize_;         //!< Local memory stored in the cache
   const size_t cacheSizeLimit_; //!< Cache size limit in bytes
 
-  //! PAL resource cache
-  std::list<std::pair<Resource::Descriptor*, GpuMemoryReference*> > resCache_;
+  //! PAL resource cache in LRU order, the most recent entries go first
+  std::list<CacheEntry*> resCache_;
+
+  //! The cached entries, binned by the memory type and the size class for the lookup
+  std::unordered_map<uint32_t, std::list<CacheEntry*>> bins_;
+
+  amd::Monitor trimLock_;  //!< Lock for the trimmer requests
+  Trimmer* trimmer_;       //!< The trimmer thread, created on the first request
+  bool asyncTrim_;         //!< The trimming runs in the background thread
+  bool trimRequested_;     //!< The cache went over the limit
+  bool trimTerminate_;     //!< The trimmer thread must exit
 
   MemorySubAllocator mem_sub_alloc_local_;                     //!< Allocator for suballocations in Local
   CoarseMemorySubAllocator mem_sub_alloc_coarse_;              //!< Allocator for suballocations in Coarse SVM
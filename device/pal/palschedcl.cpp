@@ -41,4 +41,83 @@ __kernel void __amd_rocclr_gwsInit(uint value) {
 }
 \n);
 
+const char* MipmapSourceCode = BLIT_KERNEL(
+\n #pragma OPENCL EXTENSION cl_khr_mipmap_image_writes : enable \n
+\n
+__constant sampler_t __amd_rocclr_mipSampler =
+    CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_LINEAR;
+\n
+__kernel void __amd_rocclr_copyBufferToImageMips(__global const uchar* src,
+                                                 __write_only image2d_array_t dst,
+                                                 ulong srcOrigin, int4 size, uint4 format,
+                                                 uint numLevels) {
+  ulong id = get_global_id(0);
+  ulong offset = srcOrigin;
+  int4 dim = size;
+  for (uint level = 0; level < numLevels; ++level) {
+    ulong count = (ulong)dim.x * dim.y * dim.z;
+    if (id < count) {
+      int4 coord = (int4)((int)(id % dim.x), (int)((id / dim.x) % dim.y),
+                          (int)(id / ((ulong)dim.x * dim.y)), 0);
+      __global const uchar* texel = src + offset + id * format.x * format.y;
+      uint value[4] = {0, 0, 0, 0};
+      for (uint c = 0; c < format.x; ++c) {
+        if (format.y == 1) {
+          value[c] = texel[c];
+        } else if (format.y == 2) {
+          value[c] = ((__global const ushort*)texel)[c];
+        } else {
+          value[c] = ((__global const uint*)texel)[c];
+        }
+      }
+      write_imageui(dst, coord, (int)level, (uint4)(value[0], value[1], value[2], value[3]));
+      return;
+    }
+    id -= count;
+    offset += count * format.x * format.y;
+    dim.x = max(dim.x >> 1, 1);
+    dim.y = max(dim.y >> 1, 1);
+    dim.z = (size.w != 0) ? max(dim.z >> 1, 1) : dim.z;
+  }
+}
+\n
+__kernel __attribute__((reqd_work_group_size(16, 16, 1)))
+void __amd_rocclr_generateMips(__read_only image2d_array_t src, __write_only image2d_array_t dst,
+                               int4 size, uint srcLevel, uint numLevels) {
+  __local float4 tile[256];
+  int lx = get_local_id(0);
+  int ly = get_local_id(1);
+  int x = get_global_id(0);
+  int y = get_global_id(1);
+  int layer = get_global_id(2);
+  int w = max(size.x >> 1, 1);
+  int h = max(size.y >> 1, 1);
+  float4 coord = (float4)((2.0f * x + 1.0f) / size.x, (2.0f * y + 1.0f) / size.y, layer, 0.0f);
+  float4 value = read_imagef(src, __amd_rocclr_mipSampler, coord, (float)srcLevel);
+  if ((x < w) && (y < h)) {
+    write_imagef(dst, (int4)(x, y, layer, 0), (int)srcLevel + 1, value);
+  }
+  tile[ly * 16 + lx] = value;
+  int step = 2;
+  for (uint level = 2; level <= numLevels; ++level, step <<= 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    w = max(w >> 1, 1);
+    h = max(h >> 1, 1);
+    bool active = ((lx % step) == 0) && ((ly % step) == 0);
+    if (active) {
+      int dist = step >> 1;
+      value = 0.25f * (tile[ly * 16 + lx] + tile[ly * 16 + lx + dist] +
+                       tile[(ly + dist) * 16 + lx] + tile[(ly + dist) * 16 + lx + dist]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (active) {
+      tile[ly * 16 + lx] = value;
+      if (((x / step) < w) && ((y / step) < h)) {
+        write_imagef(dst, (int4)(x / step, y / step, layer, 0), (int)(srcLevel + level), value);
+      }
+    }
+  }
+}
+\n);
+
 }  // namespace pal
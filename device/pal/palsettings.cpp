@@ -124,6 +124,9 @@ Settings::Settings() {
   minWorkloadTime_ = 1;       // 0.1 ms
   maxWorkloadTime_ = 500000;  // 500 ms
 
+  // The adaptive flush hides the submission latency of WDDM
+  adaptiveFlush_ = IS_WINDOWS;
+
   // Controls tiled images in persistent
   //!@note IOL for Linux doesn't setup tiling aperture in CMM/QS
   linearPersistentImage_ = false;
@@ -160,6 +163,7 @@ Settings::Settings() {
       std::min(static_cast<uint64_t>(GPU_MAX_SUBALLOC_SIZE) * Ki, subAllocationChunkSize_);
 
   maxCmdBuffers_ = 12;
+  cmdBuffersBudget_ = GPU_COMMAND_BUFFERS_BUDGET;
   useLightning_ = amd::IS_HIP ? true : ((!flagIsDefault(GPU_ENABLE_LC)) ? GPU_ENABLE_LC : false);
   enableWgpMode_ = false;
   enableWave32Mode_ = false;
@@ -357,6 +361,7 @@ bool Settings::create(const Pal::DeviceProperties& palProp,
       // with HWSC on pre-gfx9 devices in OCLPerfKernelArguments
       if (!aiPlus_) {
         maxCmdBuffers_ = 4;
+        cmdBuffersBudget_ = 0;
       }
 
       supportRA_ = false;
@@ -577,6 +582,10 @@ void Settings::override() {
     enableHwP2P_ = GPU_ENABLE_HW_P2P;
   }
 
+  if (!flagIsDefault(GPU_FLUSH_ADAPTIVE)) {
+    adaptiveFlush_ = GPU_FLUSH_ADAPTIVE;
+  }
+
   if (!flagIsDefault(AMD_GPU_FORCE_SINGLE_FP_DENORM)) {
     switch (AMD_GPU_FORCE_SINGLE_FP_DENORM) {
       case 0:
@@ -594,6 +603,10 @@ void Settings::override() {
     maxCmdBuffers_ = GPU_MAX_COMMAND_BUFFERS;
   }
 
+  if (!flagIsDefault(GPU_COMMAND_BUFFERS_BUDGET)) {
+    cmdBuffersBudget_ = GPU_COMMAND_BUFFERS_BUDGET;
+  }
+
   if (!flagIsDefault(GPU_ENABLE_COOP_GROUPS)) {
     enableCoopGroups_ = GPU_ENABLE_COOP_GROUPS;
     enableCoopMultiDeviceGroups_ = GPU_ENABLE_COOP_GROUPS;
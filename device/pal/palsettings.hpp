@@ -82,7 +82,8 @@ class Settings : public device::Settings {
       uint imageBufferWar_ : 1;         //!< Image buffer workaround for Gfx10
       uint disableSdma_ : 1;            //!< Disable SDMA support
       uint alwaysResident_ : 1;         //!< Make resources resident at allocation time
-      uint reserved_ : 7;
+      uint adaptiveFlush_ : 1;          //!< Flush DMA buffers by the estimated GPU idle
+      uint reserved_ : 6;
     };
     uint value_;
   };
@@ -112,6 +113,7 @@ class Settings : public device::Settings {
   uint64_t maxAllocSize_;        //!< Maximum single allocation size
   uint rgpSqttDispCount_;        //!< The number of dispatches captured in SQTT
   uint maxCmdBuffers_;           //!< Maximum number of command buffers allocated per queue
+  uint cmdBuffersBudget_;        //!< Memory budget in KB for the extra command buffers
   uint mallPolicy_;              //!< 0 - default, 1 - always bypass, 2 - always put
 
   uint64_t subAllocationMinSize_;    //!< Minimum size allowed for suballocations
@@ -64,7 +64,8 @@ uint32_t VirtualGPU::Queue::AllocedQueues(const VirtualGPU& gpu, Pal::EngineType
 VirtualGPU::Queue* VirtualGPU::Queue::Create(const VirtualGPU& gpu, Pal::QueueType queueType,
                                              uint engineIdx, Pal::ICmdAllocator* cmdAllocator,
                                              uint rtCU, amd::CommandQueue::Priority priority,
-                                             uint64_t residency_limit, uint max_command_buffers) {
+                                             uint64_t residency_limit, uint max_command_buffers,
+                                             uint elastic_limit) {
   Pal::IDevice* palDev = gpu.dev().iDev();
   Pal::Result result;
   Pal::CmdBufferCreateInfo cmdCreateInfo = {};
@@ -134,8 +135,13 @@ VirtualGPU::Queue* VirtualGPU::Queue::Create(const VirtualGPU& gpu, Pal::QueueTy
 
   size_t allocSize = qSize + max_command_buffers * (cmdSize + fSize);
   VirtualGPU::Queue* queue =
-      new (allocSize) VirtualGPU::Queue(gpu, palDev, residency_limit, max_command_buffers);
+      new (allocSize) VirtualGPU::Queue(gpu, palDev, residency_limit, max_command_buffers,
+                                        std::max(elastic_limit, max_command_buffers));
   if (queue != nullptr) {
+    // Save the creation info for the command buffers, added on demand
+    queue->cmdCreateInfo_ = cmdCreateInfo;
+    queue->cmdSize_ = cmdSize;
+    queue->fenceSize_ = fSize;
     address addrQ = nullptr;
     if (((qCreateInfo.engineType == Pal::EngineTypeCompute) ||
          (qCreateInfo.engineType == Pal::EngineTypeDma)) &&
@@ -214,6 +220,12 @@ VirtualGPU::Queue* VirtualGPU::Queue::Create(const VirtualGPU& gpu, Pal::QueueTy
         }
       }
     }
+    // The free slots are taken from the back, so keep the allocation order
+    for (uint i = max_command_buffers; i > 0; --i) {
+      if ((i - 1) != StartCmdBufIdx) {
+        queue->freeSlots_.push_back(i - 1);
+      }
+    }
   }
   return queue;
 }
@@ -236,7 +248,7 @@ VirtualGPU::Queue::~Queue() {
   }
   memReferences_.clear();
 
-  for (uint i = 0; i < max_command_buffers_; ++i) {
+  for (uint i = 0; i < iCmdBuffs_.size(); ++i) {
     if (nullptr != iCmdBuffs_[i]) {
       iCmdBuffs_[i]->Destroy();
     }
@@ -244,6 +256,15 @@ VirtualGPU::Queue::~Queue() {
       iCmdFences_[i]->Destroy();
     }
   }
+  for (auto mem : extraMem_) {
+    delete[] mem;
+  }
+  if ((waitOnWrap_ != 0) || (cmdBufGrowths_ != 0)) {
+    ClPrint(amd::LOG_INFO, amd::LOG_QUEUE,
+            "Queue %p: %u command buffers, %llu waits on wrap, %llu growths", this,
+            numCmdBuffers(), static_cast<unsigned long long>(waitOnWrap_),
+            static_cast<unsigned long long>(cmdBufGrowths_));
+  }
 
   if (nullptr != iQueue_) {
     // Find if this queue was used in recycling
@@ -284,6 +305,13 @@ void VirtualGPU::Queue::addCmdMemRef(GpuMemoryReference* mem) {
   if (gpu_.dev().settings().alwaysResident_) {
     return;
   }
+  // The memory is already tracked in the current command buffer, so skip the lookup
+  if ((mem->residencyQueue_ == this) && (mem->residencyStamp_ == cmdBufSerial_)) {
+    return;
+  }
+  mem->residencyQueue_ = this;
+  mem->residencyStamp_ = cmdBufSerial_;
+
   Pal::IGpuMemory* iMem = mem->iMem();
   auto it = memReferences_.find(mem);
   if (it != memReferences_.end()) {
@@ -291,6 +319,8 @@ void VirtualGPU::Queue::addCmdMemRef(GpuMemoryReference* mem) {
   } else {
     // Update runtime tracking with TS
     memReferences_[mem] = cmdBufIdSlot_;
+    // Track the queue ownership, so the release can skip the other queues
+    mem->addQueue(&gpu_);
     // Update PAL list with the new entry
     Pal::GpuMemoryRef memRef = {};
     memRef.pGpuMemory = iMem;
@@ -306,6 +336,9 @@ void VirtualGPU::Queue::addCmdMemRef(GpuMemoryReference* mem) {
 
 void VirtualGPU::Queue::removeCmdMemRef(GpuMemoryReference* mem) {
   Pal::IGpuMemory* iMem = mem->iMem();
+  if (mem->residencyQueue_ == this) {
+    mem->residencyQueue_ = nullptr;
+  }
   if (0 != memReferences_.erase(mem)) {
     iDev_->RemoveGpuMemoryReferences(1, &iMem, iQueue_);
     residency_size_ -= iMem->Desc().size;
@@ -401,27 +434,27 @@ bool VirtualGPU::Queue::flush() {
 
   // Reset the counter of commands
   cmdCnt_ = 0;
+  // Invalidate the residency stamps of the submitted command buffer
+  cmdBufSerial_++;
+
+  inFlight_.push_back(std::make_pair(cmdBufIdCurrent_, cmdBufIdSlot_));
 
   // Find the next command buffer
   cmdBufIdCurrent_++;
 
   if (cmdBufIdCurrent_ == GpuEvent::InvalidID) {
-    // Wait for the last one
+    // Wait for the last one, so all command buffers are idle
     waifForFence<!IbReuse>(cmdBufIdSlot_);
+    for (const auto& it : inFlight_) {
+      freeSlots_.push_back(it.second);
+    }
+    inFlight_.clear();
     cmdBufIdCurrent_ = 1;
     cmbBufIdRetired_ = 0;
   }
 
-  // Wrap current slot
-  cmdBufIdSlot_ = cmdBufIdCurrent_ % max_command_buffers_;
-
-  waifForFence<IbReuse>(cmdBufIdSlot_);
-
-  // Progress retired TS
-  if ((cmdBufIdCurrent_ > max_command_buffers_) &&
-      (cmbBufIdRetired_ < (cmdBufIdCurrent_ - max_command_buffers_))) {
-    cmbBufIdRetired_ = cmdBufIdCurrent_ - max_command_buffers_;
-  }
+  // Find the slot for the next command buffer
+  cmdBufIdSlot_ = acquireSlot();
 
   // Reset command buffer, so CB chunks could be reused
   if (Pal::Result::Success != iCmdBuffs_[cmdBufIdSlot_]->Reset(nullptr, false)) {
@@ -470,7 +503,10 @@ bool VirtualGPU::Queue::waitForEvent(uint id) {
     return false;
   }
 
-  uint slotId = id % max_command_buffers_;
+  uint slotId;
+  if (!findSlot(id, &slotId)) {
+    return true;
+  }
   constexpr bool IbReuse = true;
   bool result = waifForFence<!IbReuse>(slotId);
   cmbBufIdRetired_ = id;
@@ -490,13 +526,116 @@ bool VirtualGPU::Queue::isDone(uint id) {
     }
   }
 
-  if (Pal::Result::Success != iCmdFences_[id % max_command_buffers_]->GetStatus()) {
+  uint slotId;
+  if (findSlot(id, &slotId) &&
+      (Pal::Result::Success != iCmdFences_[slotId]->GetStatus())) {
     return false;
   }
   cmbBufIdRetired_ = id;
   return true;
 }
 
+bool VirtualGPU::Queue::findSlot(uint id, uint* slot) const {
+  // The submissions are ordered, so the older IDs are retired
+  for (const auto& it : inFlight_) {
+    if (it.first == id) {
+      *slot = it.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+void VirtualGPU::Queue::retireSlots() {
+  while (!inFlight_.empty() &&
+         (Pal::Result::Success == iCmdFences_[inFlight_.front().second]->GetStatus())) {
+    cmbBufIdRetired_ = std::max(cmbBufIdRetired_, inFlight_.front().first);
+    freeSlots_.push_back(inFlight_.front().second);
+    inFlight_.pop_front();
+  }
+}
+
+uint VirtualGPU::Queue::acquireSlot() {
+  retireSlots();
+
+  uint slot;
+  if (!freeSlots_.empty()) {
+    // Drop the extra command buffers after a long period without a pressure
+    if ((++idleFlushes_ > ShrinkIdleFlushes) && (iCmdBuffs_.size() > max_command_buffers_)) {
+      removeCmdBuffer();
+      idleFlushes_ = 0;
+    }
+    slot = freeSlots_.back();
+    freeSlots_.pop_back();
+    return slot;
+  }
+  idleFlushes_ = 0;
+
+  // All command buffers are busy, so add a new one if the budget allows it
+  if ((iCmdBuffs_.size() < elastic_limit_) && addCmdBuffer()) {
+    cmdBufGrowths_++;
+    slot = freeSlots_.back();
+    freeSlots_.pop_back();
+    return slot;
+  }
+
+  // Wait for the oldest command buffer
+  constexpr bool IbReuse = true;
+  waitOnWrap_++;
+  slot = inFlight_.front().second;
+  waifForFence<IbReuse>(slot);
+  cmbBufIdRetired_ = std::max(cmbBufIdRetired_, inFlight_.front().first);
+  inFlight_.pop_front();
+  return slot;
+}
+
+bool VirtualGPU::Queue::addCmdBuffer() {
+  char* mem = new char[cmdSize_ + fenceSize_];
+  if (mem == nullptr) {
+    return false;
+  }
+  Pal::ICmdBuffer* iCmd = nullptr;
+  if (Pal::Result::Success != iDev_->CreateCmdBuffer(cmdCreateInfo_, mem, &iCmd)) {
+    delete[] mem;
+    return false;
+  }
+  Pal::IFence* iFence = nullptr;
+  Pal::FenceCreateInfo fenceCreateinfo = {};
+  fenceCreateinfo.flags.signaled = false;
+  if (Pal::Result::Success != iDev_->CreateFence(fenceCreateinfo, mem + cmdSize_, &iFence)) {
+    iCmd->Destroy();
+    delete[] mem;
+    return false;
+  }
+  freeSlots_.push_back(static_cast<uint>(iCmdBuffs_.size()));
+  iCmdBuffs_.push_back(iCmd);
+  iCmdFences_.push_back(iFence);
+  extraMem_.push_back(mem);
+  return true;
+}
+
+void VirtualGPU::Queue::removeCmdBuffer() {
+  const uint last = static_cast<uint>(iCmdBuffs_.size()) - 1;
+  auto it = std::find(freeSlots_.begin(), freeSlots_.end(), last);
+  if (it == freeSlots_.end()) {
+    return;
+  }
+  freeSlots_.erase(it);
+  // The memory, used last in the removed slot, is idle. Hence any busy slot can track it
+  const uint busySlot = inFlight_.empty() ? cmdBufIdSlot_ : inFlight_.back().second;
+  for (auto& ref : memReferences_) {
+    if (ref.second == last) {
+      ref.second = busySlot;
+    }
+  }
+  iCmdBuffs_.back()->Destroy();
+  iCmdFences_.back()->Destroy();
+  iCmdBuffs_.pop_back();
+  iCmdFences_.pop_back();
+  delete[] extraMem_.back();
+  extraMem_.pop_back();
+}
+
 void VirtualGPU::Queue::DumpMemoryReferences() const {
   std::fstream dump;
   std::stringstream file_name("ocl_hang_dump.txt");
@@ -547,24 +686,8 @@ void VirtualGPU::Queue::DumpMemoryReferences() const {
   }
 }
 
-bool VirtualGPU::MemoryDependency::create(size_t numMemObj) {
-  if (numMemObj > 0) {
-    // Allocate the array of memory objects for dependency tracking
-    memObjectsInQueue_ = new MemoryState[numMemObj];
-    if (nullptr == memObjectsInQueue_) {
-      return false;
-    }
-    memset(memObjectsInQueue_, 0, sizeof(MemoryState) * numMemObj);
-    maxMemObjectsInQueue_ = numMemObj;
-  }
-
-  return true;
-}
-
 void VirtualGPU::MemoryDependency::validate(VirtualGPU& gpu, const Memory* memory, bool readOnly) {
-  bool flushL1Cache = false;
-
-  if (maxMemObjectsInQueue_ == 0) {
+  if (!enabled()) {
     // Return earlier if tracking is disabled
     return;
   }
@@ -572,97 +695,34 @@ void VirtualGPU::MemoryDependency::validate(VirtualGPU& gpu, const Memory* memor
   uint64_t curStart = memory->vmAddress();
   uint64_t curEnd = curStart + memory->size();
 
+  bool flushL1Cache = false;
   if (memory->isModified(gpu) || !readOnly) {
     // Mark resource as modified
     memory->setModified(gpu, !readOnly);
-
-    // Loop through all memory objects in the queue and find dependency
-    // @note don't include objects from the current kernel
-    for (size_t j = 0; j < endMemObjectsInQueue_; ++j) {
-      // Check if the queue already contains this mem object and
-      // GPU operations aren't readonly
-      uint64_t busyStart = memObjectsInQueue_[j].start_;
-      uint64_t busyEnd = memObjectsInQueue_[j].end_;
-
-      // Check if the start inside the busy region
-      if ((((curStart >= busyStart) && (curStart < busyEnd)) ||
-           // Check if the end inside the busy region
-           ((curEnd > busyStart) && (curEnd <= busyEnd)) ||
-           // Check if the start/end cover the busy region
-           ((curStart <= busyStart) && (curEnd >= busyEnd))) &&
-          // If the buys region was written or the current one is for write
-          (!memObjectsInQueue_[j].readOnly_ || !readOnly)) {
-        flushL1Cache = true;
-        break;
-      }
-    }
-  }
-
-  // Did we reach the limit?
-  if (maxMemObjectsInQueue_ <= numMemObjectsInQueue_) {
-    flushL1Cache = true;
+    flushL1Cache = device::MemoryDependency::validate(curStart, curEnd, readOnly);
+  } else {
+    // Read only resource without modifications can't cause a hazard,
+    // but it still has to be tracked
+    const static bool SkipCheck = true;
+    device::MemoryDependency::validate(curStart, curEnd, readOnly, SkipCheck);
   }
 
   if (flushL1Cache) {
     // Flush cache
     gpu.addBarrier(RgpSqqtBarrierReason::MemDependency);
-
-    // Clear memory dependency state
-    const static bool All = true;
-    clear(!All);
-  }
-
-  // Insert current memory object into the queue always,
-  // since runtime calls flush before kernel execution and it has to keep
-  // current kernel in tracking
-  memObjectsInQueue_[numMemObjectsInQueue_].start_ = curStart;
-  memObjectsInQueue_[numMemObjectsInQueue_].end_ = curEnd;
-  memObjectsInQueue_[numMemObjectsInQueue_].readOnly_ = readOnly;
-  numMemObjectsInQueue_++;
-}
-
-void VirtualGPU::MemoryDependency::clear(bool all) {
-  if (numMemObjectsInQueue_ > 0) {
-    size_t i, j;
-    if (all) {
-      endMemObjectsInQueue_ = numMemObjectsInQueue_;
-    }
-
-    // If the current launch didn't start from the beginning, then move the data
-    if (0 != endMemObjectsInQueue_) {
-      // Preserve all objects from the current kernel
-      for (i = 0, j = endMemObjectsInQueue_; j < numMemObjectsInQueue_; i++, j++) {
-        memObjectsInQueue_[i].start_ = memObjectsInQueue_[j].start_;
-        memObjectsInQueue_[i].end_ = memObjectsInQueue_[j].end_;
-        memObjectsInQueue_[i].readOnly_ = memObjectsInQueue_[j].readOnly_;
-      }
-    } else if (numMemObjectsInQueue_ >= maxMemObjectsInQueue_) {
-      // note: The array growth shouldn't occur under the normal conditions,
-      // but in a case when SVM path sends the amount of SVM ptrs over
-      // the max size of kernel arguments
-      MemoryState* ptr = new MemoryState[maxMemObjectsInQueue_ << 1];
-      if (nullptr == ptr) {
-        numMemObjectsInQueue_ = 0;
-        return;
-      }
-      maxMemObjectsInQueue_ <<= 1;
-      memcpy(ptr, memObjectsInQueue_, sizeof(MemoryState) * numMemObjectsInQueue_);
-      delete[] memObjectsInQueue_;
-      memObjectsInQueue_ = ptr;
-    }
-
-    // Adjust the number of active objects
-    numMemObjectsInQueue_ -= endMemObjectsInQueue_;
-    endMemObjectsInQueue_ = 0;
+    gpu.metrics().add(VDI_METRIC_DEPENDENCY_BARRIERS);
   }
 }
 
-VirtualGPU::DmaFlushMgmt::DmaFlushMgmt(const Device& dev) : cbWorkload_(0), dispatchSplitSize_(0) {
+VirtualGPU::DmaFlushMgmt::DmaFlushMgmt(const Device& dev)
+    : cbWorkload_(0), dispatchSplitSize_(0), cbId_(0), gpuDrainTime_(0) {
   aluCnt_ = dev.properties().gfxipProperties.shaderCore.numSimdsPerCu * dev.info().simdWidth_ *
       dev.info().maxComputeUnits_;
   maxDispatchWorkload_ = static_cast<uint64_t>(dev.info().maxEngineClockFrequency_) *
       // find time in us
       dev.settings().maxWorkloadTime_ * aluCnt_;
+  // Start with the peak rate of one operation per ALU per clock, until GPU time is measured
+  nsecPerOp_ = 1000.0 / (static_cast<double>(dev.info().maxEngineClockFrequency_) * aluCnt_);
   resetCbWorkload(dev);
 }
 
@@ -671,6 +731,51 @@ void VirtualGPU::DmaFlushMgmt::resetCbWorkload(const Device& dev) {
   maxCbWorkload_ = static_cast<uint64_t>(dev.info().maxEngineClockFrequency_) *
       // find time in us
       dev.settings().minWorkloadTime_ * aluCnt_;
+  // All command buffers are retired, hence GPU is idle
+  gpuDrainTime_ = 0;
+}
+
+void VirtualGPU::DmaFlushMgmt::update(VirtualGPU& gpu, uint64_t now) {
+  Queue& queue = gpu.queue(MainEngine);
+  // The command buffer of the accumulated workload was flushed to HW
+  if (cbId_ != queue.cmdBufId()) {
+    gpuDrainTime_ = std::max(gpuDrainTime_, now) +
+        static_cast<uint64_t>(static_cast<double>(cbWorkload_) * nsecPerOp_);
+    cbWorkload_ = 0;
+    cbId_ = queue.cmdBufId();
+  }
+
+  // Calibrate the GPU rate with the completed command buffers
+  while (!probes_.empty() && (probes_.front().cbId_ != cbId_) &&
+         queue.isDone(probes_.front().cbId_)) {
+    Probe& probe = probes_.front();
+    uint64_t startTime = 0;
+    uint64_t endTime = 0;
+    if (probe.ts_->isValid()) {
+      probe.ts_->value(&startTime, &endTime);
+    }
+    if ((endTime > startTime) && (probe.workload_ != 0)) {
+      const double rate = static_cast<double>(endTime - startTime) / probe.workload_;
+      // Smooth the rate, since the kernels in the batches are different
+      nsecPerOp_ = (nsecPerOp_ * 3 + rate) / 4;
+    }
+    gpu.tsCache_->freeTimeStamp(probe.ts_);
+    probes_.pop();
+  }
+}
+
+void VirtualGPU::DmaFlushMgmt::dispatchEnd(VirtualGPU& gpu) {
+  // The end timestamp is rewritten with each dispatch, so it reports the last one in the batch
+  if (!probes_.empty() && (probes_.back().cbId_ == gpu.queue(MainEngine).cmdBufId())) {
+    probes_.back().ts_->end();
+  }
+}
+
+void VirtualGPU::DmaFlushMgmt::release(VirtualGPU& gpu) {
+  while (!probes_.empty()) {
+    gpu.tsCache_->freeTimeStamp(probes_.front().ts_);
+    probes_.pop();
+  }
 }
 
 void VirtualGPU::DmaFlushMgmt::findSplitSize(const Device& dev, uint64_t threads,
@@ -694,18 +799,34 @@ void VirtualGPU::DmaFlushMgmt::findSplitSize(const Device& dev, uint64_t threads
 }
 
 bool VirtualGPU::DmaFlushMgmt::isCbReady(VirtualGPU& gpu, uint64_t threads, uint instructions) {
+  const uint64_t now = amd::Os::timeNanos();
+  update(gpu, now);
+
   bool cbReady = false;
   uint64_t workload = amd::alignUp(threads, 4 * aluCnt_) * instructions;
+  // Measure GPU time of the current DMA, starting from this dispatch
+  if ((probes_.empty() || (probes_.back().cbId_ != cbId_)) && (probes_.size() < MaxProbes)) {
+    TimeStamp* ts = gpu.tsCache_->allocTimeStamp();
+    if (ts != nullptr) {
+      ts->begin();
+      probes_.push({ts, cbId_, 0});
+    }
+  }
+  if (!probes_.empty() && (probes_.back().cbId_ == cbId_)) {
+    probes_.back().workload_ += workload;
+  }
   // Add current workload to the overall workload in the current DMA
   cbWorkload_ += workload;
-  // Did it exceed maximum?
-  if (cbWorkload_ > maxCbWorkload_) {
-    // Reset DMA workload
-    cbWorkload_ = 0;
-    // Increase workload of the next DMA buffer by 50%
-    maxCbWorkload_ = maxCbWorkload_ * 3 / 2;
-    if (maxCbWorkload_ > maxDispatchWorkload_) {
-      maxCbWorkload_ = maxDispatchWorkload_;
+
+  const uint64_t queuedTime = (gpuDrainTime_ > now) ? (gpuDrainTime_ - now) : 0;
+  if (queuedTime < IdleThresholdInNsec) {
+    // GPU is about to go idle, so submit the current work without batching
+    cbReady = true;
+  } else if (cbWorkload_ > maxCbWorkload_) {
+    // Increase workload of the next DMA buffer by 50%, if GPU is saturated
+    const double cbTime = static_cast<double>(maxCbWorkload_) * nsecPerOp_;
+    if (queuedTime > cbTime * SaturationFactor) {
+      maxCbWorkload_ = std::min(maxCbWorkload_ * 3 / 2, maxDispatchWorkload_);
     }
     cbReady = true;
   }
@@ -927,10 +1048,15 @@ bool VirtualGPU::create(bool profiling, uint deviceQueueSize, uint rtCUs,
       ? 0
       : (dev().properties().gpuMemoryProperties.maxLocalMemSize >> 2);
   uint max_cmd_buffers = dev().settings().maxCmdBuffers_;
+  // Extra command buffers can be added on demand, while their memory fits into the budget
+  uint elastic_cmd_buffers = max_cmd_buffers + static_cast<uint>(
+      static_cast<size_t>(dev().settings().cmdBuffersBudget_) * Ki /
+      createInfo.allocInfo[Pal::CommandDataAlloc].suballocSize);
 
   if (dev().numComputeEngines()) {
     queues_[MainEngine] = Queue::Create(*this, Pal::QueueTypeCompute, idx, cmdAllocator_, rtCUs,
-                                        priority, residency_limit, max_cmd_buffers);
+                                        priority, residency_limit, max_cmd_buffers,
+                                        elastic_cmd_buffers);
     if (nullptr == queues_[MainEngine]) {
       return false;
     }
@@ -950,7 +1076,8 @@ bool VirtualGPU::create(bool profiling, uint deviceQueueSize, uint rtCUs,
       }
       queues_[SdmaEngine] = Queue::Create(
           *this, Pal::QueueTypeDma, sdma, cmdAllocator_, amd::CommandQueue::RealTimeDisabled,
-          amd::CommandQueue::Priority::Normal, residency_limit, max_cmd_buffers);
+          amd::CommandQueue::Priority::Normal, residency_limit, max_cmd_buffers,
+          elastic_cmd_buffers);
       if (nullptr == queues_[SdmaEngine]) {
         return false;
       }
@@ -1066,6 +1193,9 @@ VirtualGPU::~VirtualGPU() {
   if (rgpCaptureEna()) {
     dev().rgpCaptureMgr()->FinishRGPTrace(this, true);
   }
+  if (dev().rgpCaptureMgr() != nullptr) {
+    dev().rgpCaptureMgr()->ReleaseQueue(this);
+  }
 
   // Not safe to remove a queue. So lock the device
   amd::ScopedLock k(dev().lockAsyncOps());
@@ -1081,6 +1211,7 @@ VirtualGPU::~VirtualGPU() {
   delete printfDbgHSA_;
 
   // Destroy TimeStamp cache
+  dmaFlushMgmt_.release(*this);
   delete tsCache_;
 
   // Destroy resource list with the constant buffers
@@ -1870,6 +2001,39 @@ void VirtualGPU::submitFillMemory(amd::FillMemoryCommand& vcmd) {
   profilingEnd(vcmd);
 }
 
+void VirtualGPU::submitMipChain(amd::MipChainCommand& vcmd) {
+  // Make sure VirtualGPU has an exclusive access to the resources
+  amd::ScopedLock lock(execution());
+
+  profilingBegin(vcmd, true);
+
+  KernelBlitManager& blit = static_cast<KernelBlitManager&>(blitMgr());
+  Memory* image = dev().getGpuMemory(&vcmd.image());
+  device::Memory::SyncFlags syncFlags;
+  bool result = false;
+  if (vcmd.operation() == amd::MipChainCommand::Upload) {
+    // The upload overwrites all levels
+    syncFlags.skipEntire_ = true;
+    image->syncCacheFromHost(*this, syncFlags);
+    Memory* buffer = dev().getGpuMemory(vcmd.buffer());
+    buffer->syncCacheFromHost(*this);
+    result = blit.copyBufferToImageMips(*buffer, *image, vcmd.offset());
+  } else {
+    image->syncCacheFromHost(*this, syncFlags);
+    result = blit.generateMips(*image);
+  }
+
+  if (!result) {
+    LogError("submitMipChain failed!");
+    vcmd.setStatus(CL_INVALID_OPERATION);
+  } else {
+    // Mark this as the most-recently written cache of the destination
+    vcmd.image().signalWrite(&gpuDevice_);
+  }
+
+  profilingEnd(vcmd);
+}
+
 void VirtualGPU::submitCopyMemoryP2P(amd::CopyMemoryP2PCommand& cmd) {
   // Make sure VirtualGPU has an exclusive access to the resources
   amd::ScopedLock lock(execution());
@@ -2479,6 +2643,10 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
     if (dmaFlushMgmt().dispatchSplitSize() != 0) {
       needFlush = true;
     }
+    if (dev().settings().adaptiveFlush_ && !GPU_FLUSH_ON_EXECUTION &&
+        dmaFlushMgmt_.isCbReady(*this, sizes.global().product(), hsaKernel.aqlCodeSize())) {
+      needFlush = true;
+    }
   }
 
   // Check if it is blit kernel. If it is, then check if split is needed.
@@ -2560,6 +2728,7 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
     // Run AQL dispatch in HW
     eventBegin(MainEngine);
     iCmd()->CmdDispatchAql(dispatchParam);
+    dmaFlushMgmt_.dispatchEnd(*this);
 
     if (id != gpuEvent.id_) {
       LogError("Something is wrong. ID mismatch!\n");
@@ -2672,13 +2841,9 @@ void VirtualGPU::submitPerfCounter(amd::PerfCounterCommand& vcmd) {
 
   const amd::PerfCounterCommand::PerfCounterList counters = vcmd.getCounters();
 
-  PalCounterReference* palRef = PalCounterReference::Create(*this);
-  if (palRef == nullptr) {
-    LogError("We failed to allocate memory for the GPU perfcounter");
-    vcmd.setStatus(CL_INVALID_OPERATION);
-    return;
-  }
-
+  // The device counters keep the experiment, so the reference is created
+  // only for the counters, which are used for the first time
+  PalCounterReference* palRef = nullptr;
   bool newExperiment = false;
 
   for (uint i = 0; i < vcmd.getNumCounters(); ++i) {
@@ -2687,6 +2852,14 @@ void VirtualGPU::submitPerfCounter(amd::PerfCounterCommand& vcmd) {
 
     // Make sure we have a valid gpu performance counter
     if (nullptr == counter) {
+      if (palRef == nullptr) {
+        palRef = PalCounterReference::Create(*this);
+        if (palRef == nullptr) {
+          LogError("We failed to allocate memory for the GPU perfcounter");
+          vcmd.setStatus(CL_INVALID_OPERATION);
+          return;
+        }
+      }
       amd::PerfCounter::Properties prop = amdCounter->properties();
       PerfCounter* gpuCounter = new PerfCounter(
           gpuDevice_, palRef, prop[CL_PERFCOUNTER_GPU_BLOCK_INDEX],
@@ -2712,7 +2885,9 @@ void VirtualGPU::submitPerfCounter(amd::PerfCounterCommand& vcmd) {
     palRef->finalize();
   }
 
-  palRef->release();
+  if (palRef != nullptr) {
+    palRef->release();
+  }
 
   Pal::IPerfExperiment* palPerf = nullptr;
   for (uint i = 0; i < vcmd.getNumCounters(); ++i) {
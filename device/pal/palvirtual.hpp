@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <deque>
 #include <queue>
 #include "device/pal/paldefs.hpp"
 #include "device/pal/palconstbuf.hpp"
@@ -30,6 +31,7 @@
 #include "device/pal/palgpuopen.hpp"
 #include "platform/commandqueue.hpp"
 #include "device/blit.hpp"
+#include "device/devmemdependency.hpp"
 #include "palUtil.h"
 #include "palCmdBuffer.h"
 #include "palCmdAllocator.h"
@@ -75,11 +77,12 @@ class VirtualGPU : public device::VirtualDevice {
                          uint rtCU,                             //!< The number of reserved CUs
                          amd::CommandQueue::Priority priority,  //!< Queue priority
                          uint64_t residency_limit,              //!< Enables residency limit
-                         uint max_command_buffers  //!< Number of allocated command buffers
+                         uint max_command_buffers,  //!< Number of allocated command buffers
+                         uint elastic_limit         //!< Maximum number of command buffers
     );
 
     Queue(const VirtualGPU& gpu, Pal::IDevice* iDev, uint64_t residency_limit,
-          uint max_command_buffers)
+          uint max_command_buffers, uint elastic_limit)
         : lock_(nullptr),
           iQueue_(nullptr),
           iCmdBuffs_(max_command_buffers, nullptr),
@@ -91,10 +94,17 @@ class VirtualGPU : public device::VirtualDevice {
           cmdBufIdCurrent_(StartCmdBufIdx),
           cmbBufIdRetired_(0),
           cmdCnt_(0),
+          cmdBufSerial_(0),
           vlAlloc_(64 * Ki),
           residency_size_(0),
           residency_limit_(residency_limit),
-          max_command_buffers_(max_command_buffers) {
+          max_command_buffers_(max_command_buffers),
+          elastic_limit_(elastic_limit),
+          cmdSize_(0),
+          fenceSize_(0),
+          waitOnWrap_(0),
+          cmdBufGrowths_(0),
+          idleFlushes_(0) {
       vlAlloc_.Init();
     }
 
@@ -167,6 +177,15 @@ class VirtualGPU : public device::VirtualDevice {
 
     uint cmdBufId() const { return cmdBufIdCurrent_; }
 
+    //! Returns the number of allocated command buffers
+    uint numCmdBuffers() const { return static_cast<uint>(iCmdBuffs_.size()); }
+
+    //! Returns the number of waits for a busy command buffer on the submission
+    uint64_t waitOnWrapCount() const { return waitOnWrap_; }
+
+    //! Returns the number of command buffers added on demand
+    uint64_t cmdBufGrowthCount() const { return cmdBufGrowths_; }
+
     static uint32_t AllocedQueues(const VirtualGPU& gpu, Pal::EngineType type);
 
     amd::Monitor* lock_;                       //!< Lock PAL queue for access
@@ -176,13 +195,33 @@ class VirtualGPU : public device::VirtualDevice {
     const amd::Kernel* last_kernel_;           //!< Last submitted kernel
 
    private:
+    //! Shrinks the command buffers to the base count after the number of flushes without a wait
+    static constexpr uint ShrinkIdleFlushes = 1024;
+
     void DumpMemoryReferences() const;
+
+    //! Finds the slot of a submitted command buffer, returns false if it was retired
+    bool findSlot(uint id, uint* slot) const;
+
+    //! Moves the completed command buffers to the free list
+    void retireSlots();
+
+    //! Finds a command buffer for the next submission. Adds a new one or waits for the oldest
+    uint acquireSlot();
+
+    //! Allocates an extra command buffer with a fence
+    bool addCmdBuffer();
+
+    //! Destroys the last extra command buffer, if it's idle
+    void removeCmdBuffer();
+
     const VirtualGPU& gpu_;  //!< OCL virtual GPU object
     Pal::IDevice* iDev_;     //!< PAL device
     uint cmdBufIdSlot_;      //!< Command buffer ID slot for submissions
     uint cmdBufIdCurrent_;   //!< Current global command buffer ID
     uint cmbBufIdRetired_;   //!< The last retired command buffer ID
     uint cmdCnt_;            //!< Counter of commands
+    uint64_t cmdBufSerial_;  //!< The number of flushes, which never wraps
     std::unordered_map<GpuMemoryReference*, uint> memReferences_;
     Util::VirtualLinearAllocator vlAlloc_;
     std::vector<Pal::GpuMemoryRef> palMemRefs_;
@@ -192,7 +231,17 @@ class VirtualGPU : public device::VirtualDevice {
     std::vector<const Pal::IGpuMemory*> palSdiRefs_;
     uint64_t residency_size_;   //!< Resource residency size
     uint64_t residency_limit_;  //!< Enables residency limit
-    uint max_command_buffers_;
+    uint max_command_buffers_;  //!< The number of preallocated command buffers
+    uint elastic_limit_;        //!< The maximum number of command buffers under the budget
+    Pal::CmdBufferCreateInfo cmdCreateInfo_;  //!< Creation info for the extra command buffers
+    size_t cmdSize_;                          //!< PAL command buffer object size
+    size_t fenceSize_;                        //!< PAL fence object size
+    std::vector<char*> extraMem_;             //!< Memory of the extra command buffers
+    std::deque<std::pair<uint, uint>> inFlight_;  //!< Submitted IDs and slots in the order
+    std::vector<uint> freeSlots_;                 //!< Idle command buffer slots
+    uint64_t waitOnWrap_;     //!< The number of waits for a busy command buffer
+    uint64_t cmdBufGrowths_;  //!< The number of command buffers added on demand
+    uint idleFlushes_;        //!< The number of flushes without a wait or a growth
   };
 
   struct CommandBatch : public amd::HeapObject {
@@ -235,47 +284,19 @@ class VirtualGPU : public device::VirtualDevice {
 
   typedef std::vector<ConstantBuffer*> constbufs_t;
 
-  class MemoryDependency : public amd::EmbeddedObject {
+  class MemoryDependency : public device::MemoryDependency {
    public:
-    //! Default constructor
-    MemoryDependency()
-        : memObjectsInQueue_(nullptr), numMemObjectsInQueue_(0), maxMemObjectsInQueue_(0) {}
-
-    ~MemoryDependency() { delete[] memObjectsInQueue_; }
-
-    //! Creates memory dependecy structure
-    bool create(size_t numMemObj);
-
-    //! Notify the tracker about new kernel
-    void newKernel() { endMemObjectsInQueue_ = numMemObjectsInQueue_; }
-
     //! Validates memory object on dependency
     void validate(VirtualGPU& gpu, const Memory* memory, bool readOnly);
 
     //! Invalidates GPU caches if memory dependency tracking is disabled
     void sync(VirtualGPU& gpu) const {
-      if (maxMemObjectsInQueue_ == 0) {
+      if (!enabled()) {
         gpu.addBarrier(RgpSqqtBarrierReason::MemDependency);
       }
     }
-
-    //! Clear memory dependency
-    void clear(bool all = true);
-
-   private:
-    struct MemoryState {
-      uint64_t start_;  //! Busy memory start address
-      uint64_t end_;    //! Busy memory end address
-      bool readOnly_;   //! Current GPU state in the queue
-    };
-
-    MemoryState* memObjectsInQueue_;  //!< Memory object state in the queue
-    size_t endMemObjectsInQueue_;     //!< End of mem objects in the queue
-    size_t numMemObjectsInQueue_;     //!< Number of mem objects in the queue
-    size_t maxMemObjectsInQueue_;     //!< Maximum number of mem objects in the queue
   };
 
-
   class DmaFlushMgmt : public amd::EmbeddedObject {
    public:
     DmaFlushMgmt(const Device& dev);
@@ -295,15 +316,42 @@ class VirtualGPU : public device::VirtualDevice {
                    uint instructions  //!< Number of ALU instructions
     );
 
+    // Marks the end of the dispatch for the GPU time measurement
+    void dispatchEnd(VirtualGPU& gpu);
+
+    // Releases the outstanding timestamps
+    void release(VirtualGPU& gpu);
+
     // Returns dispatch split size
     uint dispatchSplitSize() const { return dispatchSplitSize_; }
 
    private:
+    //! GPU is considered idle soon, if the submitted work will finish within the time
+    static constexpr uint64_t IdleThresholdInNsec = 100000;
+    //! GPU is considered saturated, if the queued work exceeds the batch time by the factor
+    static constexpr uint64_t SaturationFactor = 4;
+    //! The maximum number of command buffers with the outstanding time measurement
+    static constexpr uint MaxProbes = 4;
+
+    //! GPU time measurement of a command buffer
+    struct Probe {
+      TimeStamp* ts_;      //!< Timestamps around the dispatches in the command buffer
+      uint cbId_;          //!< The command buffer ID
+      uint64_t workload_;  //!< The number of operations between the timestamps
+    };
+
+    // Accounts the flushed workload and retires the measured command buffers
+    void update(VirtualGPU& gpu, uint64_t now);
+
     uint64_t maxDispatchWorkload_;  //!< Maximum number of operations for a single dispatch
     uint64_t maxCbWorkload_;        //!< Maximum number of operations for DMA command buffer
     uint64_t cbWorkload_;           //!< Current number of operations in DMA command buffer
     uint aluCnt_;                   //!< All ALUs on the chip
     uint dispatchSplitSize_;        //!< Dispath split size in elements
+    uint cbId_;                     //!< The command buffer ID of the current workload
+    double nsecPerOp_;              //!< Measured GPU time per operation
+    uint64_t gpuDrainTime_;         //!< Estimated CPU time, when GPU finishes the flushed work
+    std::queue<Probe> probes_;      //!< Outstanding GPU time measurements
   };
 
  public:
@@ -333,6 +381,7 @@ class VirtualGPU : public device::VirtualDevice {
   );
   void submitNativeFn(amd::NativeFnCommand& vcmd);
   void submitFillMemory(amd::FillMemoryCommand& vcmd);
+  void submitMipChain(amd::MipChainCommand& vcmd);
   void submitMigrateMemObjects(amd::MigrateMemObjectsCommand& cmd);
   void submitMarker(amd::Marker& vcmd);
   void submitAcquireExtObjects(amd::AcquireExtObjectsCommand& vcmd);
@@ -426,6 +475,9 @@ class VirtualGPU : public device::VirtualDevice {
   //! Return managed buffer for staging operations
   ManagedBuffer& managedBuffer() { return managedBuffer_; }
 
+  //! Returns the timestamp cache of the queue
+  TimeStampCache* tsCache() const { return tsCache_; }
+
   //! Adds a pinned memory object into a map
   void addPinnedMem(amd::Memory* mem);
 
@@ -0,0 +1,258 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <platform/runtime.hpp>
+#include <platform/context.hpp>
+#include <platform/memory.hpp>
+#include <os/os.hpp>
+#include <utils/flags.hpp>
+#include <utils/debug.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! The allocation sizes, from 64 B up to 1 GB
+static constexpr size_t kSizes[] = {64, 4 * Ki, 64 * Ki, 1 * Mi, 16 * Mi, 256 * Mi, 1 * Gi};
+//! The live allocations per thread, the oldest is freed after each new allocation
+static constexpr uint32_t kLiveAllocations = 4;
+//! The bytes per thread, which limit the iterations of the large sizes
+static constexpr size_t kBytesPerThread = 4 * Gi;
+//! The minimum iterations of any size
+static constexpr uint32_t kMinIterations = 8;
+
+static uint32_t iterations_ = 2000;
+static uint32_t maxThreads_ = 0;
+
+//! An allocator under the test
+struct Allocator {
+  const char* name_;                         //!< The name in the report
+  std::function<void*(size_t)> alloc_;       //!< Returns the allocation or nullptr
+  std::function<void(void*)> free_;          //!< Frees the allocation
+  size_t maxSize_;                           //!< The maximum allocation size
+  bool ownsMemory_;                          //!< The allocation takes the device memory
+};
+
+//! The latencies of a thread
+struct Samples {
+  std::vector<uint64_t> alloc_;  //!< The allocation times in ns
+  std::vector<uint64_t> free_;   //!< The free times in ns
+  bool failed_ = false;          //!< An allocation failed
+};
+
+// ================================================================================================
+static double percentile(std::vector<uint64_t>& values, double p) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  const size_t idx = std::min(values.size() - 1, static_cast<size_t>(values.size() * p));
+  std::nth_element(values.begin(), values.begin() + idx, values.end());
+  return values[idx] / 1000.0;
+}
+
+// ================================================================================================
+//! Runs the allocations of the size from the threads and prints the throughput and the latencies
+static void run(const Allocator& allocator, size_t size, uint32_t threads) {
+  const uint32_t iterations = static_cast<uint32_t>(std::max<size_t>(
+      std::min<size_t>(iterations_, kBytesPerThread / size), kMinIterations));
+  std::vector<Samples> samples(threads);
+  std::atomic<uint32_t> ready(0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> workers;
+  for (uint32_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      Samples& sample = samples[t];
+      sample.alloc_.reserve(iterations);
+      sample.free_.reserve(iterations);
+      std::deque<void*> live;
+      ready++;
+      while (!go.load(std::memory_order_acquire)) {
+        amd::Os::yield();
+      }
+      for (uint32_t i = 0; i < iterations; ++i) {
+        uint64_t start = amd::Os::timeNanos();
+        void* ptr = allocator.alloc_(size);
+        sample.alloc_.push_back(amd::Os::timeNanos() - start);
+        if (ptr == nullptr) {
+          sample.failed_ = true;
+          break;
+        }
+        live.push_back(ptr);
+        if (live.size() > kLiveAllocations) {
+          start = amd::Os::timeNanos();
+          allocator.free_(live.front());
+          sample.free_.push_back(amd::Os::timeNanos() - start);
+          live.pop_front();
+        }
+      }
+      for (auto ptr : live) {
+        allocator.free_(ptr);
+      }
+    });
+  }
+  while (ready.load() != threads) {
+    amd::Os::yield();
+  }
+  const uint64_t start = amd::Os::timeNanos();
+  go.store(true, std::memory_order_release);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  const uint64_t time = amd::Os::timeNanos() - start;
+
+  std::vector<uint64_t> alloc;
+  std::vector<uint64_t> frees;
+  bool failed = false;
+  for (const auto& sample : samples) {
+    alloc.insert(alloc.end(), sample.alloc_.begin(), sample.alloc_.end());
+    frees.insert(frees.end(), sample.free_.begin(), sample.free_.end());
+    failed |= sample.failed_;
+  }
+  const double ops = (time != 0) ? (alloc.size() * 1e9) / time : 0.0;
+  printf("%s,%zu,%u,%zu,%.0f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%s\n", allocator.name_, size, threads,
+         alloc.size(), ops, percentile(alloc, 0.5), percentile(alloc, 0.99),
+         percentile(alloc, 0.999), percentile(frees, 0.5), percentile(frees, 0.99),
+         percentile(frees, 0.999), failed ? "failed" : "ok");
+  fflush(stdout);
+}
+
+// ================================================================================================
+//! Creates the buffer with the flags and forces the device memory allocation
+static void* createBuffer(amd::Context& context, amd::Device& device, amd::Memory* parent,
+                          cl_mem_flags flags, size_t offset, size_t size) {
+  amd::Memory* buffer = (parent != nullptr)
+      ? new (context) amd::Buffer(*parent, flags, offset, size)
+      : new (context) amd::Buffer(context, flags, size);
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  if (!buffer->create() || (buffer->getDeviceMemory(device) == nullptr)) {
+    buffer->release();
+    return nullptr;
+  }
+  return buffer;
+}
+
+// ================================================================================================
+int main(int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string option = argv[i];
+    const uint32_t value = static_cast<uint32_t>(atoi(argv[i + 1]));
+    if (option == "-i") {
+      iterations_ = std::max(value, 1u);
+    } else if (option == "-t") {
+      maxThreads_ = value;
+    } else {
+      printf("Usage: %s [-i iterations] [-t max threads]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (maxThreads_ == 0) {
+    maxThreads_ = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  if (!amd::Runtime::init()) {
+    LogError("Runtime init failed");
+    return 1;
+  }
+  std::vector<amd::Device*> devices = amd::Device::getDevices(CL_DEVICE_TYPE_GPU, false);
+  if (devices.empty()) {
+    LogError("No GPU devices");
+    return 1;
+  }
+  devices.resize(1);
+  amd::Device& device = *devices[0];
+
+  amd::Context::Info info = {0};
+  amd::Context* context = new amd::Context(devices, info);
+  if ((context == nullptr) || (context->create(nullptr) != CL_SUCCESS)) {
+    LogError("Context creation failed");
+    return 1;
+  }
+
+  const size_t maxAlloc = static_cast<size_t>(device.info().maxMemAllocSize_);
+  // The sub-buffers are carved from one parent, so the test measures only the view creation
+  const size_t parentSize = std::min(maxAlloc, 1 * Gi);
+  amd::Memory* parent = static_cast<amd::Memory*>(
+      createBuffer(*context, device, nullptr, 0, 0, parentSize));
+  if (parent == nullptr) {
+    LogError("Parent buffer creation failed");
+    return 1;
+  }
+  const size_t alignment = device.info().memBaseAddrAlign_ / 8;
+  std::atomic<uint32_t> subIndex(0);
+
+  auto release = [](void* ptr) { static_cast<amd::Memory*>(ptr)->release(); };
+  const std::vector<Allocator> allocators = {
+      {"buffer", [&](size_t size) { return createBuffer(*context, device, nullptr, 0, 0, size); },
+       release, maxAlloc, true},
+      {"host_pinned", [&](size_t size) {
+         return createBuffer(*context, device, nullptr, CL_MEM_ALLOC_HOST_PTR, 0, size);
+       }, release, maxAlloc, true},
+      {"sub_buffer", [&](size_t size) {
+         // Rotate the origins over the parent, the sub-buffers don't own any memory
+         const size_t slots = std::max<size_t>(parentSize / size, 1);
+         const size_t offset = amd::alignDown((subIndex++ % slots) * size, alignment);
+         return createBuffer(*context, device, parent, 0, offset, size);
+       }, release, parentSize, false},
+      {"svm_coarse", [&](size_t size) { return amd::SvmBuffer::malloc(*context, 0, size, 0); },
+       [&](void* ptr) { amd::SvmBuffer::free(*context, ptr); }, maxAlloc, true},
+      {"svm_fine", [&](size_t size) {
+         return amd::SvmBuffer::malloc(*context, CL_MEM_SVM_FINE_GRAIN_BUFFER, size, 0);
+       }, [&](void* ptr) { amd::SvmBuffer::free(*context, ptr); }, maxAlloc, true},
+  };
+
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t threads = 1; threads < maxThreads_; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads_);
+
+  printf("Device %s, up to %u iterations per thread, %u live allocations per thread\n",
+         device.info().name_, iterations_, kLiveAllocations);
+  printf("allocator,size,threads,allocations,allocs_per_s,alloc_p50_us,alloc_p99_us,"
+         "alloc_p999_us,free_p50_us,free_p99_us,free_p999_us,status\n");
+  const size_t memoryBudget = static_cast<size_t>(device.info().globalMemSize_) / 2;
+  for (const auto& allocator : allocators) {
+    for (size_t size : kSizes) {
+      if (size > allocator.maxSize_) {
+        continue;
+      }
+      for (uint32_t threads : threadCounts) {
+        // The live allocations of all threads must fit in the device memory
+        if (allocator.ownsMemory_ &&
+            ((kLiveAllocations + 1) * threads * size > memoryBudget)) {
+          continue;
+        }
+        run(allocator, size, threads);
+      }
+    }
+  }
+
+  parent->release();
+  context->release();
+  return 0;
+}
@@ -0,0 +1,258 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <platform/runtime.hpp>
+#include <platform/context.hpp>
+#include <platform/program.hpp>
+#include <device/devprogram.hpp>
+#include <elf/elf.hpp>
+#include <os/os.hpp>
+#include <utils/flags.hpp>
+#include <utils/debug.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//! The phases in the report, recorded with amd::InitPhase
+static const char* const kPhases[] = {"build", "compile to bitcode", "link bitcode", "codegen",
+                                      "setBinary", "kernel metadata", "code object load"};
+//! The number of the kernels in the large code object
+static constexpr uint32_t kManyKernels = 256;
+
+static uint32_t repeats_ = 3;
+static std::string cacheDir_ = "/tmp/rocclr_build_cache";
+
+//! A build input
+struct Input {
+  std::string name_;                  //!< The name in the report
+  std::string source_;                //!< The source code
+  amd::Program::Language language_;   //!< The source language
+  std::string options_;               //!< The build options
+};
+
+// ================================================================================================
+//! The kernel with the loops and the math builtins
+static std::string mathSource() {
+  return "__kernel void math(__global float* out, __global const float* in, int n) {\n"
+         "  const int id = get_global_id(0);\n"
+         "  float acc = 0.0f;\n"
+         "  for (int i = 0; i < n; ++i) {\n"
+         "    const float x = in[(id + i) % n];\n"
+         "    acc += sin(x) * cos(acc) + exp(-x * x) + sqrt(fabs(x)) + pow(x, 1.5f);\n"
+         "  }\n"
+         "  out[id] = acc;\n"
+         "}\n";
+}
+
+// ================================================================================================
+//! The source with many kernels, which gives a large code object with many symbols
+static std::string manySource(uint32_t count) {
+  std::ostringstream src;
+  for (uint32_t i = 0; i < count; ++i) {
+    src << "__kernel void kernel" << i << "(__global int* out, int a) {\n"
+        << "  out[get_global_id(0)] = a * " << i + 1 << " + get_global_id(0);\n"
+        << "}\n";
+  }
+  return src.str();
+}
+
+// ================================================================================================
+//! The HIP source in the form of a HIPRTC input, without the HIP headers
+static std::string hipSource() {
+  return "extern \"C\" __attribute__((global)) void saxpy(float a, float* x, float* y, int n) {\n"
+         "  const int id = __builtin_amdgcn_workgroup_id_x() * 256 +\n"
+         "                 __builtin_amdgcn_workitem_id_x();\n"
+         "  if (id < n) {\n"
+         "    y[id] = a * x[id] + y[id];\n"
+         "  }\n"
+         "}\n";
+}
+
+// ================================================================================================
+//! Prints the time of each phase since the last reset
+static void report(const std::string& name, const char* mode, uint64_t time) {
+  std::map<std::string, uint64_t> phases;
+  for (const auto& phase : amd::InitProfile::phases()) {
+    phases[phase.name_] += phase.duration_;
+  }
+  printf("%s,%s,%.3f", name.c_str(), mode, time / 1e6);
+  for (const char* phase : kPhases) {
+    printf(",%.3f", phases[phase] / 1e6);
+  }
+  printf("\n");
+  fflush(stdout);
+  amd::InitProfile::reset();
+}
+
+// ================================================================================================
+//! Builds the input. Returns the program or nullptr
+static amd::Program* build(amd::Context& context, const std::vector<amd::Device*>& devices,
+                           const Input& input, const char* mode) {
+  amd::InitProfile::reset();
+  const uint64_t start = amd::Os::timeNanos();
+  amd::Program* program = new amd::Program(context, input.source_, input.language_);
+  if ((program == nullptr) ||
+      (program->build(devices, input.options_.c_str()) != CL_SUCCESS) || !program->load()) {
+    LogPrintfError("Build of %s failed", input.name_.c_str());
+    if (program != nullptr) {
+      program->release();
+    }
+    return nullptr;
+  }
+  report(input.name_, mode, amd::Os::timeNanos() - start);
+  return program;
+}
+
+// ================================================================================================
+//! Loads the code object into a new program
+static bool loadBinary(amd::Context& context, const std::vector<amd::Device*>& devices,
+                       const std::string& name, const void* image, size_t size) {
+  amd::InitProfile::reset();
+  const uint64_t start = amd::Os::timeNanos();
+  amd::Program* program = new amd::Program(context);
+  bool result = (program != nullptr) &&
+                (program->addDeviceProgram(*devices[0], image, size) == CL_SUCCESS) &&
+                (program->build(devices, "") == CL_SUCCESS) && program->load();
+  if (result) {
+    report(name, "binary", amd::Os::timeNanos() - start);
+  } else {
+    LogPrintfError("Load of the %s code object failed", name.c_str());
+  }
+  if (program != nullptr) {
+    program->release();
+  }
+  return result;
+}
+
+// ================================================================================================
+//! Parses the code object with amd::Elf and reads all symbols
+static bool parseElf(const std::string& name, const void* image, size_t size) {
+  const uint64_t start = amd::Os::timeNanos();
+  amd::Elf elf(ELFCLASS64, static_cast<const char*>(image), size, nullptr,
+               amd::Elf::ELF_C_READ);
+  if (!elf.isSuccessful()) {
+    LogPrintfError("ELF parsing of %s failed", name.c_str());
+    return false;
+  }
+  const unsigned int count = elf.getSymbolNum();
+  for (unsigned int i = 0; i < count; ++i) {
+    amd::Elf::SymbolInfo info;
+    elf.getSymbolInfo(i, &info);
+  }
+  const uint64_t time = amd::Os::timeNanos() - start;
+  printf("%s,elf,%.3f", name.c_str(), time / 1e6);
+  for (size_t i = 0; i < sizeof(kPhases) / sizeof(kPhases[0]); ++i) {
+    printf(",0.000");
+  }
+  printf("\n");
+  fflush(stdout);
+  return true;
+}
+
+// ================================================================================================
+int main(int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string option = argv[i];
+    if (option == "-r") {
+      repeats_ = static_cast<uint32_t>(atoi(argv[i + 1]));
+    } else if (option == "-c") {
+      cacheDir_ = argv[i + 1];
+    } else {
+      printf("Usage: %s [-r warm repeats] [-c code cache dir|none]\n", argv[0]);
+      return 1;
+    }
+  }
+  // The first build of each input runs against the empty code cache, the repeats hit it
+  if (cacheDir_ != "none") {
+    setenv("OCL_CODE_CACHE_ENABLE", "1", 1);
+    setenv("OCL_CODE_CACHE_PATH", cacheDir_.c_str(), 1);
+    setenv("OCL_CODE_CACHE_RESET", "1", 1);
+  }
+
+  if (!amd::Runtime::init()) {
+    LogError("Runtime init failed");
+    return 1;
+  }
+  std::vector<amd::Device*> devices = amd::Device::getDevices(CL_DEVICE_TYPE_GPU, false);
+  if (devices.empty()) {
+    LogError("No GPU devices");
+    return 1;
+  }
+  devices.resize(1);
+  amd::Context::Info info = {0};
+  amd::Context* context = new amd::Context(devices, info);
+  if ((context == nullptr) || (context->create(nullptr) != CL_SUCCESS)) {
+    LogError("Context creation failed");
+    return 1;
+  }
+
+  const std::vector<Input> inputs = {
+      {"empty", "__kernel void empty() {}\n", amd::Program::OpenCL_C, ""},
+      {"math", mathSource(), amd::Program::OpenCL_C, ""},
+      {"math_O0", mathSource(), amd::Program::OpenCL_C, "-cl-opt-disable"},
+      {"many" + std::to_string(kManyKernels), manySource(kManyKernels),
+       amd::Program::OpenCL_C, ""},
+      {"hip_saxpy", hipSource(), amd::Program::HIP, "-O3"},
+  };
+
+  printf("Device %s, code cache %s, %u warm repeats\n", devices[0]->info().name_,
+         cacheDir_.c_str(), repeats_);
+  printf("input,mode,total_ms");
+  for (const char* phase : kPhases) {
+    printf(",%s_ms", phase);
+  }
+  printf("\n");
+
+  bool result = true;
+  for (const auto& input : inputs) {
+    amd::Program* program = build(*context, devices, input, "cold");
+    if (program == nullptr) {
+      result = false;
+      continue;
+    }
+    for (uint32_t i = 0; i < repeats_; ++i) {
+      amd::Program* warm = build(*context, devices, input, "warm");
+      if (warm != nullptr) {
+        warm->release();
+      }
+    }
+
+    // The code object of the build goes through the binary load and the ELF parsing
+    const device::Program* devProgram = program->getDeviceProgram(*devices[0]);
+    const device::Program::binary_t binary = devProgram->binary();
+    if ((binary.first != nullptr) && (binary.second != 0)) {
+      const std::vector<char> image(static_cast<const char*>(binary.first),
+                                    static_cast<const char*>(binary.first) + binary.second);
+      for (uint32_t i = 0; i <= repeats_; ++i) {
+        result &= loadBinary(*context, devices, input.name_, image.data(), image.size());
+        result &= parseElf(input.name_, image.data(), image.size());
+      }
+    }
+    program->release();
+  }
+
+  context->release();
+  return result ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <platform/runtime.hpp>
+#include <platform/context.hpp>
+#include <platform/commandqueue.hpp>
+#include <platform/memory.hpp>
+#include <device/rocm/rocdevice.hpp>
+#include <device/rocm/rocvirtual.hpp>
+#include <thread/monitor.hpp>
+#include <utils/concurrent.hpp>
+#include <os/os.hpp>
+#include <utils/flags.hpp>
+#include <utils/debug.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! Each operation with the index multiple of the period is timed
+static constexpr uint32_t kSamplePeriod = 16;
+//! The number of the registered memory objects per thread in the MemObjMap test
+static constexpr uint32_t kObjectsPerThread = 64;
+//! The address space between the registered objects in the MemObjMap test
+static constexpr size_t kObjectStride = 64 * Ki;
+//! One update of MemObjMap per the number of the lookups
+static constexpr uint32_t kLookupsPerUpdate = 16;
+
+static uint32_t iterations_ = 100000;
+static uint32_t maxThreads_ = 0;
+
+//! A test operation, called with the thread index and the operation index
+typedef std::function<void(uint32_t, uint32_t)> Operation;
+
+// ================================================================================================
+//! Short work, which emulates the runtime code in and out of the critical sections
+static inline void work(uint32_t amount) {
+  volatile uint32_t sink = 0;
+  for (uint32_t i = 0; i < amount; ++i) {
+    sink = sink + i;
+  }
+}
+
+// ================================================================================================
+static double percentile(std::vector<uint64_t>& values, double p) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  const size_t idx = std::min(values.size() - 1, static_cast<size_t>(values.size() * p));
+  std::nth_element(values.begin(), values.begin() + idx, values.end());
+  return values[idx] / 1000.0;
+}
+
+// ================================================================================================
+//! Runs the operation from the threads and prints the throughput and the latencies
+static void run(const char* name, uint32_t threads, const Operation& operation) {
+  std::vector<std::vector<uint64_t>> samples(threads);
+  std::atomic<uint32_t> ready(0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> workers;
+  for (uint32_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      std::vector<uint64_t>& latency = samples[t];
+      latency.reserve(iterations_ / kSamplePeriod + 1);
+      ready++;
+      while (!go.load(std::memory_order_acquire)) {
+        amd::Os::yield();
+      }
+      for (uint32_t i = 0; i < iterations_; ++i) {
+        if ((i % kSamplePeriod) == 0) {
+          const uint64_t start = amd::Os::timeNanos();
+          operation(t, i);
+          latency.push_back(amd::Os::timeNanos() - start);
+        } else {
+          operation(t, i);
+        }
+      }
+    });
+  }
+  while (ready.load() != threads) {
+    amd::Os::yield();
+  }
+  const uint64_t start = amd::Os::timeNanos();
+  go.store(true, std::memory_order_release);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  const uint64_t time = amd::Os::timeNanos() - start;
+
+  std::vector<uint64_t> latency;
+  for (const auto& sample : samples) {
+    latency.insert(latency.end(), sample.begin(), sample.end());
+  }
+  const double ops = (time != 0) ? (static_cast<double>(threads) * iterations_ * 1e9) / time : 0.0;
+  printf("%-20s threads %3u | %12.0f ops/s | latency us p50 %8.3f p99 %8.3f p99.9 %8.3f\n",
+         name, threads, ops, percentile(latency, 0.5), percentile(latency, 0.99),
+         percentile(latency, 0.999));
+  fflush(stdout);
+}
+
+// ================================================================================================
+static void runMonitor(uint32_t threads) {
+  amd::Monitor lock("Bench lock");
+  run("Monitor", threads, [&](uint32_t, uint32_t) {
+    {
+      amd::ScopedLock sl(lock);
+      work(16);
+    }
+    work(64);
+  });
+}
+
+// ================================================================================================
+static void runQueue(uint32_t threads) {
+  amd::ConcurrentLinkedQueue<void*> queue;
+  // The odd threads consume, the even ones produce, so the queue stays short
+  run("ConcurrentLinkedQueue", threads, [&](uint32_t t, uint32_t i) {
+    if ((threads == 1) || ((t & 1) == 0)) {
+      queue.enqueue(reinterpret_cast<void*>(static_cast<uintptr_t>(i + 1)));
+    }
+    if ((threads == 1) || ((t & 1) != 0)) {
+      queue.dequeue();
+    }
+    work(16);
+  });
+  while (queue.dequeue() != nullptr) {
+  }
+}
+
+// ================================================================================================
+static void runMemObjMap(amd::Context& context, uint32_t threads) {
+  // The objects are registered at the synthetic addresses, so the test doesn't allocate
+  // a distinct host range for each object
+  amd::Memory* buffer = new (context) amd::Buffer(context, 0, 4 * Ki);
+  if ((buffer == nullptr) || !buffer->create()) {
+    LogError("Buffer creation failed");
+    return;
+  }
+  const uintptr_t base = 0x100000000000ULL;
+  auto key = [&](uint32_t t, uint32_t obj) {
+    return reinterpret_cast<const void*>(base + (t * kObjectsPerThread + obj) * kObjectStride);
+  };
+  for (uint32_t t = 0; t < threads; ++t) {
+    for (uint32_t obj = 0; obj < kObjectsPerThread; ++obj) {
+      amd::MemObjMap::AddMemObj(key(t, obj), buffer);
+    }
+  }
+  run("MemObjMap", threads, [&](uint32_t t, uint32_t i) {
+    if ((i % kLookupsPerUpdate) == 0) {
+      // The thread re-registers own object, like a free and an allocation
+      const void* ptr = key(t, (i / kLookupsPerUpdate) % kObjectsPerThread);
+      amd::MemObjMap::RemoveMemObj(ptr);
+      amd::MemObjMap::AddMemObj(ptr, buffer);
+    } else {
+      // Lookup an interior pointer of any thread's object
+      const uint32_t obj = (i * 2654435761u) % (threads * kObjectsPerThread);
+      amd::MemObjMap::FindMemObj(reinterpret_cast<const char*>(base) + obj * kObjectStride +
+                                 (i % (4 * Ki)));
+    }
+  });
+  for (uint32_t t = 0; t < threads; ++t) {
+    for (uint32_t obj = 0; obj < kObjectsPerThread; ++obj) {
+      amd::MemObjMap::RemoveMemObj(key(t, obj));
+    }
+  }
+  buffer->release();
+}
+
+// ================================================================================================
+static void runXferBuffers(amd::Context& context, roc::Device& device, uint32_t threads) {
+  // Each thread uses own queue, so the contention is only in the shared staging pool
+  std::vector<amd::HostQueue*> queues;
+  for (uint32_t t = 0; t < threads; ++t) {
+    amd::HostQueue* queue = new amd::HostQueue(context, device, 0);
+    if ((queue == nullptr) || !queue->create()) {
+      LogError("Queue creation failed");
+      return;
+    }
+    queues.push_back(queue);
+  }
+  roc::Device::XferBuffers& xfer = device.xferRead();
+  run("XferBuffers", threads, [&](uint32_t t, uint32_t i) {
+    roc::VirtualGPU& gpu = *static_cast<roc::VirtualGPU*>(queues[t]->vdev());
+    amd::ScopedLock lock(gpu.execution());
+    // Mix the full size and the small staging requests
+    const size_t size = ((i & 3) == 0) ? 0 : (4 * Ki << (i % 3));
+    roc::Memory& buffer = xfer.acquire(gpu, size);
+    work(16);
+    xfer.release(gpu, buffer);
+  });
+  for (auto queue : queues) {
+    queue->release();
+  }
+}
+
+// ================================================================================================
+static void runExecution(amd::HostQueue& queue, uint32_t threads) {
+  roc::VirtualGPU& gpu = *static_cast<roc::VirtualGPU*>(queue.vdev());
+  run("VirtualGPU::execution", threads, [&](uint32_t, uint32_t) {
+    {
+      amd::ScopedLock lock(gpu.execution());
+      work(64);
+    }
+    work(64);
+  });
+}
+
+// ================================================================================================
+int main(int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string option = argv[i];
+    const uint32_t value = static_cast<uint32_t>(atoi(argv[i + 1]));
+    if (option == "-i") {
+      iterations_ = std::max(value, 1u);
+    } else if (option == "-t") {
+      maxThreads_ = value;
+    } else {
+      printf("Usage: %s [-i iterations] [-t max threads]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (maxThreads_ == 0) {
+    maxThreads_ = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  if (!amd::Runtime::init()) {
+    LogError("Runtime init failed");
+    return 1;
+  }
+  std::vector<amd::Device*> devices = amd::Device::getDevices(CL_DEVICE_TYPE_GPU, false);
+  if (devices.empty()) {
+    LogError("No GPU devices");
+    return 1;
+  }
+  devices.resize(1);
+  roc::Device& device = *static_cast<roc::Device*>(devices[0]);
+
+  amd::Context::Info info = {0};
+  amd::Context* context = new amd::Context(devices, info);
+  if ((context == nullptr) || (context->create(nullptr) != CL_SUCCESS)) {
+    LogError("Context creation failed");
+    return 1;
+  }
+  amd::HostQueue* queue = new amd::HostQueue(*context, device, 0);
+  if ((queue == nullptr) || !queue->create()) {
+    LogError("Queue creation failed");
+    return 1;
+  }
+
+  printf("%u operations per thread, every %u-th operation is timed\n", iterations_,
+         kSamplePeriod);
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t threads = 1; threads < maxThreads_; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads_);
+
+  for (uint32_t threads : threadCounts) {
+    runMonitor(threads);
+  }
+  for (uint32_t threads : threadCounts) {
+    runQueue(threads);
+  }
+  for (uint32_t threads : threadCounts) {
+    runMemObjMap(*context, threads);
+  }
+  for (uint32_t threads : threadCounts) {
+    runXferBuffers(*context, device, threads);
+  }
+  for (uint32_t threads : threadCounts) {
+    runExecution(*queue, threads);
+  }
+
+  queue->release();
+  context->release();
+  return 0;
+}
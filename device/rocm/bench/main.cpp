@@ -0,0 +1,318 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <platform/runtime.hpp>
+#include <platform/context.hpp>
+#include <platform/commandqueue.hpp>
+#include <platform/command.hpp>
+#include <platform/program.hpp>
+#include <platform/kernel.hpp>
+#include <os/os.hpp>
+#include <utils/flags.hpp>
+#include <utils/debug.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! The numbers of the int arguments in the args count sweep
+static constexpr uint32_t kNumArgs[] = {0, 1, 4, 16, 64};
+//! The sizes of the by value struct argument in the kernarg size sweep
+static constexpr uint32_t kArgSizes[] = {16, 64, 256, 1024};
+//! The numbers of the events in the wait list in the fan-in sweep
+static constexpr uint32_t kFanIns[] = {0, 1, 4, 16};
+//! The number of the launches before the measurement
+static constexpr uint32_t kWarmup = 100;
+
+static uint32_t iterations_ = 2000;
+static uint32_t maxThreads_ = 4;
+
+//! A benchmark configuration
+struct Config {
+  std::string kernel_;   //!< The empty kernel name
+  uint32_t numArgs_;     //!< The number of the int arguments
+  uint32_t argSize_;     //!< The size of the struct argument, 0 if none
+  uint32_t fanIn_;       //!< The number of the previous events in the wait list
+  bool profiling_;       //!< The queue profiling is enabled
+  uint32_t threads_;     //!< The number of the submitting threads
+};
+
+//! The measurements of a thread
+struct Samples {
+  std::vector<uint64_t> enqueue_;   //!< Host time of the enqueue calls in ns
+  std::vector<uint64_t> submit_;    //!< Enqueue to the device submission in ns
+  uint64_t start_ = 0;              //!< The first measured enqueue
+  uint64_t end_ = 0;                //!< The end of the queue finish
+  bool result_ = false;
+};
+
+// ================================================================================================
+static std::string kernelSource() {
+  std::ostringstream src;
+  for (uint32_t num : kNumArgs) {
+    src << "__kernel void empty_args" << num << "(";
+    for (uint32_t i = 0; i < num; ++i) {
+      src << ((i != 0) ? ", " : "") << "int a" << i;
+    }
+    src << ") {}\n";
+  }
+  for (uint32_t size : kArgSizes) {
+    src << "typedef struct { uchar d[" << size << "]; } arg" << size << "_t;\n";
+    src << "__kernel void empty_size" << size << "(arg" << size << "_t a) {}\n";
+  }
+  return src.str();
+}
+
+// ================================================================================================
+static void submitter(amd::Context& context, amd::Device& device, amd::Program& program,
+                      const Config& config, Samples* samples) {
+  const amd::Symbol* symbol = program.findSymbol(config.kernel_.c_str());
+  if (symbol == nullptr) {
+    LogPrintfError("Can't find kernel %s", config.kernel_.c_str());
+    return;
+  }
+  // Each thread uses own kernel object, since the arguments are set per thread
+  amd::Kernel* kernel = new amd::Kernel(program, *symbol, config.kernel_);
+  int value = 0;
+  for (uint32_t i = 0; i < config.numArgs_; ++i) {
+    kernel->parameters().set(i, sizeof(value), &value);
+  }
+  std::vector<uint8_t> blob(config.argSize_, 0);
+  if (config.argSize_ != 0) {
+    kernel->parameters().set(0, blob.size(), blob.data());
+  }
+
+  amd::HostQueue* queue = new amd::HostQueue(context, device,
+      config.profiling_ ? CL_QUEUE_PROFILING_ENABLE : 0);
+  if ((queue == nullptr) || !queue->create()) {
+    LogError("Queue creation failed");
+    kernel->release();
+    return;
+  }
+
+  const size_t global = 1;
+  const size_t local = 1;
+  const amd::NDRangeContainer sizes(1, nullptr, &global, &local);
+  std::deque<amd::Command*> window;
+  std::vector<amd::Command*> profiled;
+  const uint32_t total = kWarmup + iterations_;
+  samples->enqueue_.reserve(iterations_);
+  bool result = true;
+
+  for (uint32_t i = 0; i < total; ++i) {
+    if (i == kWarmup) {
+      queue->finish();
+      samples->start_ = amd::Os::timeNanos();
+    }
+    amd::Command::EventWaitList waitList(window.begin(), window.end());
+    amd::NDRangeKernelCommand* command =
+        new amd::NDRangeKernelCommand(*queue, waitList, *kernel, sizes);
+    if (command->captureAndValidate() != CL_SUCCESS) {
+      LogError("Kernel validation failed");
+      command->release();
+      result = false;
+      break;
+    }
+    const uint64_t start = amd::Os::timeNanos();
+    command->enqueue();
+    const uint64_t end = amd::Os::timeNanos();
+    if (i >= kWarmup) {
+      samples->enqueue_.push_back(end - start);
+    }
+
+    // Keep the last events for the wait list of the next launches
+    if (config.fanIn_ != 0) {
+      window.push_back(command);
+      if (window.size() > config.fanIn_) {
+        window.front()->release();
+        window.pop_front();
+      }
+    } else if (config.profiling_ && (i >= kWarmup)) {
+      profiled.push_back(command);
+    } else {
+      command->release();
+    }
+  }
+  queue->finish();
+  samples->end_ = amd::Os::timeNanos();
+
+  for (auto command : profiled) {
+    const auto& info = command->profilingInfo();
+    samples->submit_.push_back(info.submitted_ - info.queued_);
+    command->release();
+  }
+  for (auto command : window) {
+    command->release();
+  }
+  queue->release();
+  kernel->release();
+  samples->result_ = result;
+}
+
+// ================================================================================================
+static double percentile(std::vector<uint64_t>& values, double p) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  const size_t idx = std::min(values.size() - 1, static_cast<size_t>(values.size() * p));
+  std::nth_element(values.begin(), values.begin() + idx, values.end());
+  return values[idx] / 1000.0;
+}
+
+// ================================================================================================
+static bool run(amd::Context& context, amd::Device& device, amd::Program& program,
+                const Config& config) {
+  std::vector<Samples> samples(config.threads_);
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < config.threads_; ++t) {
+    threads.emplace_back(submitter, std::ref(context), std::ref(device), std::ref(program),
+                         std::cref(config), &samples[t]);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<uint64_t> enqueue;
+  std::vector<uint64_t> submit;
+  uint64_t start = UINT64_MAX;
+  uint64_t end = 0;
+  for (const auto& sample : samples) {
+    if (!sample.result_) {
+      return false;
+    }
+    enqueue.insert(enqueue.end(), sample.enqueue_.begin(), sample.enqueue_.end());
+    submit.insert(submit.end(), sample.submit_.begin(), sample.submit_.end());
+    start = std::min(start, sample.start_);
+    end = std::max(end, sample.end_);
+  }
+  uint64_t sum = 0;
+  for (auto time : enqueue) {
+    sum += time;
+  }
+  const double mean = enqueue.empty() ? 0.0 : (sum / 1000.0) / enqueue.size();
+  const double launches = (end > start) ? (enqueue.size() * 1e9) / (end - start) : 0.0;
+
+  printf("%-16s args %2u size %4u fan-in %2u prof %u threads %u | enqueue %7.2f %7.2f %7.2f",
+         config.kernel_.c_str(), config.numArgs_, config.argSize_, config.fanIn_,
+         config.profiling_, config.threads_, mean, percentile(enqueue, 0.5),
+         percentile(enqueue, 0.99));
+  if (config.profiling_) {
+    printf(" | submit %7.2f %7.2f", percentile(submit, 0.5), percentile(submit, 0.99));
+  }
+  printf(" | %10.0f launches/s\n", launches);
+  fflush(stdout);
+  return true;
+}
+
+// ================================================================================================
+static bool runAll(amd::Context& context, amd::Device& device, amd::Program& program) {
+  std::vector<Config> configs;
+  for (uint32_t num : kNumArgs) {
+    configs.push_back({"empty_args" + std::to_string(num), num, 0, 0, false, 1});
+  }
+  for (uint32_t size : kArgSizes) {
+    configs.push_back({"empty_size" + std::to_string(size), 0, size, 0, false, 1});
+  }
+  for (uint32_t fanIn : kFanIns) {
+    configs.push_back({"empty_args0", 0, 0, fanIn, false, 1});
+  }
+  configs.push_back({"empty_args0", 0, 0, 0, true, 1});
+  configs.push_back({"empty_args4", 4, 0, 0, true, 1});
+  for (uint32_t threads = 2; threads <= maxThreads_; threads *= 2) {
+    configs.push_back({"empty_args4", 4, 0, 0, false, threads});
+  }
+
+  for (const auto& config : configs) {
+    if (!run(context, device, program, config)) {
+      LogPrintfError("Benchmark %s failed", config.kernel_.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+int main(int argc, char** argv) {
+  int direct = -1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string option = argv[i];
+    const uint32_t value = static_cast<uint32_t>(atoi(argv[i + 1]));
+    if (option == "-i") {
+      iterations_ = std::max(value, 1u);
+    } else if (option == "-t") {
+      maxThreads_ = std::max(value, 1u);
+    } else if (option == "-d") {
+      direct = (value != 0) ? 1 : 0;
+    } else {
+      printf("Usage: %s [-i iterations] [-t max threads] [-d 0|1]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (direct < 0) {
+    // AMD_DIRECT_DISPATCH is read at the runtime init, so each mode runs in own process
+    int result = 0;
+    for (int mode = 0; mode <= 1; ++mode) {
+      std::ostringstream cmd;
+      cmd << argv[0] << " -i " << iterations_ << " -t " << maxThreads_ << " -d " << mode;
+      result |= system(cmd.str().c_str());
+    }
+    return (result != 0) ? 1 : 0;
+  }
+  setenv("AMD_DIRECT_DISPATCH", (direct != 0) ? "1" : "0", 1);
+
+  if (!amd::Runtime::init()) {
+    LogError("Runtime init failed");
+    return 1;
+  }
+  std::vector<amd::Device*> devices = amd::Device::getDevices(CL_DEVICE_TYPE_GPU, false);
+  if (devices.empty()) {
+    LogError("No GPU devices");
+    return 1;
+  }
+  devices.resize(1);
+  amd::Device& device = *devices[0];
+
+  amd::Context::Info info = {0};
+  amd::Context* context = new amd::Context(devices, info);
+  if ((context == nullptr) || (context->create(nullptr) != CL_SUCCESS)) {
+    LogError("Context creation failed");
+    return 1;
+  }
+  amd::Program* program = new amd::Program(*context, kernelSource(), amd::Program::OpenCL_C);
+  if ((program == nullptr) || (program->build(devices, "") != CL_SUCCESS) ||
+      !program->load()) {
+    LogError("Program build failed");
+    return 1;
+  }
+
+  printf("Device %s, direct dispatch %d, %u launches per thread\n", device.info().name_,
+         AMD_DIRECT_DISPATCH ? 1 : 0, iterations_);
+  const bool result = runAll(*context, device, *program);
+
+  program->release();
+  context->release();
+  return result ? 0 : 1;
+}
@@ -0,0 +1,618 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <platform/runtime.hpp>
+#include <platform/context.hpp>
+#include <platform/commandqueue.hpp>
+#include <platform/command.hpp>
+#include <platform/cmdrecord.hpp>
+#include <platform/memory.hpp>
+#include <platform/program.hpp>
+#include <platform/kernel.hpp>
+#include <os/os.hpp>
+#include <utils/flags.hpp>
+#include <utils/debug.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using amd::CommandRecorder;
+
+//! The number of the last replayed commands, kept for the wait lists of the next ones
+static constexpr size_t kCommandWindow = 4096;
+
+static uint32_t repeats_ = 1;
+static bool timing_ = false;
+
+//! A record of the command stream
+struct Record {
+  uint16_t kind_;         //!< CommandRecorder::RecordKind
+  const uint8_t* data_;   //!< The payload
+  uint32_t size_;         //!< The payload size
+};
+
+//! Reads the values from a record payload
+class Reader {
+ public:
+  explicit Reader(const Record& record)
+      : pos_(record.data_), end_(record.data_ + record.size_), valid_(true) {}
+
+  template <typename T> T get() {
+    T value = T();
+    const uint8_t* data = bytes(sizeof(T));
+    if (data != nullptr) {
+      memcpy(&value, data, sizeof(T));
+    }
+    return value;
+  }
+
+  const uint8_t* bytes(size_t size) {
+    if (!valid_ || (size > static_cast<size_t>(end_ - pos_))) {
+      valid_ = false;
+      return nullptr;
+    }
+    const uint8_t* data = pos_;
+    pos_ += size;
+    return data;
+  }
+
+  amd::Coord3D coord() {
+    const size_t x = get<uint64_t>();
+    const size_t y = get<uint64_t>();
+    const size_t z = get<uint64_t>();
+    return amd::Coord3D(x, y, z);
+  }
+
+  bool valid() const { return valid_; }
+
+ private:
+  const uint8_t* pos_;  //!< The current position
+  const uint8_t* end_;  //!< The end of the payload
+  bool valid_;          //!< The payload wasn't truncated
+};
+
+//! The replay state of the recorded objects
+class Replayer {
+ public:
+  Replayer(amd::Context& context, const std::vector<amd::Device*>& devices)
+      : context_(context), devices_(devices), replayed_(0), skipped_(0) {}
+  ~Replayer();
+
+  //! Replays all records. The objects are created on the first pass only
+  bool run(const std::vector<Record>& records, bool create);
+
+  //! Waits for all queues
+  void finish();
+
+  uint64_t replayed() const { return replayed_; }
+  uint64_t skipped() const { return skipped_; }
+
+  //! Allocates the scratch host memory for the transfers without the recorded data
+  bool allocScratch(size_t size) {
+    scratch_.resize(size);
+    return true;
+  }
+
+ private:
+  bool createQueue(Reader& reader);
+  bool createMemory(Reader& reader);
+  bool createProgram(Reader& reader);
+  bool replayCommand(Reader& reader);
+
+  //! Returns the replay memory and the offset in it for the recorded memory
+  amd::Memory* memory(uint32_t id, size_t* offset);
+
+  //! Returns the kernel of the program, created on the first use
+  amd::Kernel* kernel(uint32_t program, const std::string& name);
+
+  //! Creates the launch of the recorded kernel
+  amd::Command* createLaunch(Reader& reader, amd::HostQueue& queue,
+                             const amd::Command::EventWaitList& waitList);
+
+  amd::Context& context_;
+  const std::vector<amd::Device*>& devices_;
+  std::unordered_map<uint32_t, amd::HostQueue*> queues_;
+  std::unordered_map<uint32_t, void*> memories_;        //!< The device pointers of the memory
+  std::vector<void*> allocations_;                      //!< The replay allocations
+  std::unordered_map<uint32_t, amd::Program*> programs_;
+  std::map<std::pair<uint32_t, std::string>, amd::Kernel*> kernels_;
+  std::unordered_map<uint32_t, amd::Command*> commands_;  //!< The commands for the wait lists
+  std::deque<uint32_t> window_;                          //!< The order of the kept commands
+  std::vector<uint8_t> scratch_;                         //!< The host memory of the transfers
+  uint64_t replayed_;
+  uint64_t skipped_;
+  uint64_t start_ = 0;
+};
+
+// ================================================================================================
+Replayer::~Replayer() {
+  for (auto& it : commands_) {
+    it.second->release();
+  }
+  for (auto& it : kernels_) {
+    it.second->release();
+  }
+  for (auto& it : programs_) {
+    it.second->release();
+  }
+  for (auto& it : queues_) {
+    it.second->release();
+  }
+  for (auto ptr : allocations_) {
+    amd::SvmBuffer::free(context_, ptr);
+  }
+}
+
+// ================================================================================================
+bool Replayer::createQueue(Reader& reader) {
+  const uint32_t id = reader.get<uint32_t>();
+  const uint32_t device = reader.get<uint32_t>();
+  const uint64_t properties = reader.get<uint64_t>();
+  if (!reader.valid()) {
+    return false;
+  }
+  amd::Device& dev = *devices_[(device < devices_.size()) ? device : 0];
+  // The profiling is kept, since it changes the submission cost
+  amd::HostQueue* queue =
+      new amd::HostQueue(context_, dev, properties & CL_QUEUE_PROFILING_ENABLE);
+  if ((queue == nullptr) || !queue->create()) {
+    LogError("Queue creation failed");
+    return false;
+  }
+  queues_[id] = queue;
+  return true;
+}
+
+// ================================================================================================
+bool Replayer::createMemory(Reader& reader) {
+  const uint32_t id = reader.get<uint32_t>();
+  const uint32_t parent = reader.get<uint32_t>();
+  const uint64_t origin = reader.get<uint64_t>();
+  const uint64_t size = reader.get<uint64_t>();
+  reader.get<uint64_t>();  // The memory flags
+  const uint32_t type = reader.get<uint32_t>();
+  if (!reader.valid()) {
+    return false;
+  }
+  if (type != CL_MEM_OBJECT_BUFFER) {
+    // The images aren't replayed, so the commands with them are skipped
+    return true;
+  }
+  // All buffers are device memory with a pointer, so the launches pass them as the raw pointers
+  if (parent != 0) {
+    auto it = memories_.find(parent);
+    if (it != memories_.end()) {
+      memories_[id] = reinterpret_cast<char*>(it->second) + origin;
+    }
+    return true;
+  }
+  void* ptr = amd::SvmBuffer::malloc(context_, 0, std::max(size, uint64_t(1)), 0);
+  if (ptr == nullptr) {
+    LogPrintfError("Can't allocate the recorded memory of %zu bytes", static_cast<size_t>(size));
+    return false;
+  }
+  allocations_.push_back(ptr);
+  memories_[id] = ptr;
+  return true;
+}
+
+// ================================================================================================
+bool Replayer::createProgram(Reader& reader) {
+  const uint32_t id = reader.get<uint32_t>();
+  reader.get<uint32_t>();
+  const uint64_t size = reader.get<uint64_t>();
+  const uint8_t* image = reader.bytes(size);
+  if (!reader.valid() || (size == 0)) {
+    LogPrintfError("Program %u doesn't have a code object", id);
+    return reader.valid();
+  }
+  amd::Program* program = new amd::Program(context_);
+  std::vector<amd::Device*> devices(1, devices_[0]);
+  if ((program == nullptr) ||
+      (program->addDeviceProgram(*devices_[0], image, size) != CL_SUCCESS) ||
+      (program->build(devices, "") != CL_SUCCESS) || !program->load()) {
+    LogPrintfError("Program %u build failed", id);
+    if (program != nullptr) {
+      program->release();
+    }
+    return true;
+  }
+  programs_[id] = program;
+  return true;
+}
+
+// ================================================================================================
+amd::Memory* Replayer::memory(uint32_t id, size_t* offset) {
+  auto it = memories_.find(id);
+  if (it == memories_.end()) {
+    return nullptr;
+  }
+  amd::Memory* mem = amd::MemObjMap::FindMemObj(it->second);
+  if (mem != nullptr) {
+    *offset = reinterpret_cast<char*>(it->second) - reinterpret_cast<char*>(mem->getSvmPtr());
+  }
+  return mem;
+}
+
+// ================================================================================================
+amd::Kernel* Replayer::kernel(uint32_t program, const std::string& name) {
+  const auto key = std::make_pair(program, name);
+  auto it = kernels_.find(key);
+  if (it != kernels_.end()) {
+    return it->second;
+  }
+  auto prog = programs_.find(program);
+  const amd::Symbol* symbol =
+      (prog != programs_.end()) ? prog->second->findSymbol(name.c_str()) : nullptr;
+  if (symbol == nullptr) {
+    LogPrintfError("Can't find kernel %s", name.c_str());
+    kernels_[key] = nullptr;
+    return nullptr;
+  }
+  amd::Kernel* kernel = new amd::Kernel(*prog->second, *symbol, name);
+  kernels_[key] = kernel;
+  return kernel;
+}
+
+// ================================================================================================
+amd::Command* Replayer::createLaunch(Reader& reader, amd::HostQueue& queue,
+                                     const amd::Command::EventWaitList& waitList) {
+  const uint32_t program = reader.get<uint32_t>();
+  const uint32_t length = reader.get<uint32_t>();
+  const uint8_t* chars = reader.bytes(length);
+  const uint32_t dims = std::min(reader.get<uint32_t>(), 3u);
+  size_t offset[3], global[3], local[3];
+  for (auto values : {offset, global, local}) {
+    for (uint32_t i = 0; i < 3; ++i) {
+      values[i] = reader.get<uint64_t>();
+    }
+  }
+  const uint32_t sharedMemBytes = reader.get<uint32_t>();
+  const uint32_t numArgs = reader.get<uint32_t>();
+  if (!reader.valid()) {
+    return nullptr;
+  }
+  amd::Kernel* kern = kernel(program, std::string(reinterpret_cast<const char*>(chars), length));
+  if ((kern == nullptr) || (numArgs != kern->signature().numParameters())) {
+    return nullptr;
+  }
+
+  for (uint32_t i = 0; i < numArgs; ++i) {
+    const uint8_t kind = reader.get<uint8_t>();
+    switch (kind) {
+      case CommandRecorder::kArgValue: {
+        const uint32_t size = reader.get<uint32_t>();
+        const uint8_t* value = reader.bytes(size);
+        if (value != nullptr) {
+          kern->parameters().set(i, size, value);
+        }
+        break;
+      }
+      case CommandRecorder::kArgMemory: {
+        const uint32_t id = reader.get<uint32_t>();
+        const uint64_t offs = reader.get<uint64_t>();
+        auto it = memories_.find(id);
+        if (it == memories_.end()) {
+          return nullptr;
+        }
+        void* ptr = reinterpret_cast<char*>(it->second) + offs;
+        kern->parameters().set(i, sizeof(ptr), &ptr, true);
+        break;
+      }
+      case CommandRecorder::kArgLocal:
+        kern->parameters().set(i, reader.get<uint32_t>(), nullptr);
+        break;
+      default:
+        // The raw pointers outside of the recorded memory can't be replayed
+        return nullptr;
+    }
+  }
+  if (!reader.valid()) {
+    return nullptr;
+  }
+
+  const bool hasLocal = std::any_of(local, local + dims, [](size_t size) { return size != 0; });
+  const amd::NDRangeContainer sizes(dims, offset, global, hasLocal ? local : nullptr);
+  amd::NDRangeKernelCommand* command =
+      new amd::NDRangeKernelCommand(queue, waitList, *kern, sizes, sharedMemBytes);
+  if ((command != nullptr) && (command->captureAndValidate() != CL_SUCCESS)) {
+    command->release();
+    return nullptr;
+  }
+  return command;
+}
+
+// ================================================================================================
+bool Replayer::replayCommand(Reader& reader) {
+  const uint64_t time = reader.get<uint64_t>();
+  const uint32_t id = reader.get<uint32_t>();
+  const uint32_t queueId = reader.get<uint32_t>();
+  const uint32_t type = reader.get<uint32_t>();
+  const uint32_t numWaits = reader.get<uint32_t>();
+  amd::Command::EventWaitList waitList;
+  for (uint32_t i = 0; i < numWaits; ++i) {
+    auto it = commands_.find(reader.get<uint32_t>());
+    if (it != commands_.end()) {
+      waitList.push_back(it->second);
+    }
+  }
+  auto queueIt = queues_.find(queueId);
+  if (!reader.valid() || (queueIt == queues_.end())) {
+    return false;
+  }
+  amd::HostQueue& queue = *queueIt->second;
+
+  // Keep the recorded submission gaps, so the GPU idle time matches the original run
+  if (timing_) {
+    const uint64_t now = amd::Os::timeNanos() - start_;
+    if (time > now) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(time - now));
+    }
+  }
+
+  amd::Command* command = nullptr;
+  size_t offset = 0;
+  switch (type) {
+    case CL_COMMAND_NDRANGE_KERNEL:
+    case CL_COMMAND_TASK:
+      command = createLaunch(reader, queue, waitList);
+      break;
+    case CL_COMMAND_READ_BUFFER: {
+      amd::Memory* mem = memory(reader.get<uint32_t>(), &offset);
+      amd::Coord3D origin = reader.coord();
+      const amd::Coord3D size = reader.coord();
+      if ((mem != nullptr) && reader.valid() && (size[0] <= scratch_.size())) {
+        origin.c[0] += offset;
+        auto read = new amd::ReadMemoryCommand(queue, CL_COMMAND_READ_BUFFER, waitList, *mem,
+                                               origin, size, scratch_.data());
+        command = read->validateMemory() ? read : (read->release(), nullptr);
+      }
+      break;
+    }
+    case CL_COMMAND_WRITE_BUFFER: {
+      amd::Memory* mem = memory(reader.get<uint32_t>(), &offset);
+      amd::Coord3D origin = reader.coord();
+      const amd::Coord3D size = reader.coord();
+      const uint64_t dataSize = reader.get<uint64_t>();
+      const uint8_t* data = reader.bytes(dataSize);
+      if ((mem != nullptr) && reader.valid() && ((dataSize != 0) || (size[0] <= scratch_.size()))) {
+        origin.c[0] += offset;
+        auto write = new amd::WriteMemoryCommand(queue, CL_COMMAND_WRITE_BUFFER, waitList, *mem,
+                                                 origin, size,
+                                                 (dataSize != 0) ? data : scratch_.data());
+        command = write->validateMemory() ? write : (write->release(), nullptr);
+      }
+      break;
+    }
+    case CL_COMMAND_COPY_BUFFER: {
+      size_t dstOffset = 0;
+      amd::Memory* src = memory(reader.get<uint32_t>(), &offset);
+      amd::Memory* dst = memory(reader.get<uint32_t>(), &dstOffset);
+      amd::Coord3D srcOrigin = reader.coord();
+      amd::Coord3D dstOrigin = reader.coord();
+      const amd::Coord3D size = reader.coord();
+      if ((src != nullptr) && (dst != nullptr) && reader.valid()) {
+        srcOrigin.c[0] += offset;
+        dstOrigin.c[0] += dstOffset;
+        auto copy = new amd::CopyMemoryCommand(queue, CL_COMMAND_COPY_BUFFER, waitList, *src, *dst,
+                                               srcOrigin, dstOrigin, size);
+        command = copy->validateMemory() ? copy : (copy->release(), nullptr);
+      }
+      break;
+    }
+    case CL_COMMAND_FILL_BUFFER: {
+      amd::Memory* mem = memory(reader.get<uint32_t>(), &offset);
+      amd::Coord3D origin = reader.coord();
+      const amd::Coord3D size = reader.coord();
+      const uint32_t patternSize = reader.get<uint32_t>();
+      const uint8_t* pattern = reader.bytes(patternSize);
+      if ((mem != nullptr) && reader.valid()) {
+        origin.c[0] += offset;
+        auto fill = new amd::FillMemoryCommand(queue, CL_COMMAND_FILL_BUFFER, waitList, *mem,
+                                               pattern, patternSize, origin, size);
+        command = fill->validateMemory() ? fill : (fill->release(), nullptr);
+      }
+      break;
+    }
+    default:
+      // The images, the rect transfers and the rest keep the ordering of the stream only
+      command = new amd::Marker(queue, false, waitList);
+      break;
+  }
+
+  if (command == nullptr) {
+    skipped_++;
+    // The skipped command still orders the stream
+    command = new amd::Marker(queue, false, waitList);
+  } else {
+    replayed_++;
+  }
+  command->enqueue();
+
+  auto it = commands_.find(id);
+  if (it != commands_.end()) {
+    it->second->release();
+  } else {
+    window_.push_back(id);
+  }
+  commands_[id] = command;
+  if (window_.size() > kCommandWindow) {
+    auto old = commands_.find(window_.front());
+    if (old != commands_.end()) {
+      old->second->release();
+      commands_.erase(old);
+    }
+    window_.pop_front();
+  }
+  return true;
+}
+
+// ================================================================================================
+bool Replayer::run(const std::vector<Record>& records, bool create) {
+  start_ = amd::Os::timeNanos();
+  for (const auto& record : records) {
+    Reader reader(record);
+    bool result = true;
+    switch (record.kind_) {
+      case CommandRecorder::kQueue:
+        result = !create || createQueue(reader);
+        break;
+      case CommandRecorder::kMemory:
+        result = !create || createMemory(reader);
+        break;
+      case CommandRecorder::kProgram:
+        result = !create || createProgram(reader);
+        break;
+      case CommandRecorder::kCommand:
+        result = replayCommand(reader);
+        break;
+      default:
+        break;
+    }
+    if (!result) {
+      LogPrintfError("Invalid record of kind %u", record.kind_);
+      return false;
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+void Replayer::finish() {
+  for (auto& it : queues_) {
+    it.second->finish();
+  }
+}
+
+// ================================================================================================
+static bool parse(const std::vector<uint8_t>& file, std::vector<Record>* records,
+                  size_t* maxTransfer) {
+  uint32_t header[2] = {};
+  if (file.size() < sizeof(header)) {
+    return false;
+  }
+  memcpy(header, file.data(), sizeof(header));
+  if ((header[0] != CommandRecorder::kMagic) || (header[1] != CommandRecorder::kVersion)) {
+    LogError("Not a command record file or unsupported version");
+    return false;
+  }
+  size_t pos = sizeof(header);
+  *maxTransfer = 0;
+  while (pos + sizeof(CommandRecorder::RecordHeader) <= file.size()) {
+    CommandRecorder::RecordHeader rec;
+    memcpy(&rec, file.data() + pos, sizeof(rec));
+    pos += sizeof(rec);
+    if (rec.size_ > (file.size() - pos)) {
+      // The process could exit in the middle of a record
+      LogWarning("The last record is truncated");
+      break;
+    }
+    records->push_back({rec.kind_, file.data() + pos, rec.size_});
+    pos += rec.size_;
+
+    // The transfers without the data use one scratch buffer of the largest size
+    if (rec.kind_ == CommandRecorder::kMemory) {
+      Reader reader(records->back());
+      reader.bytes(2 * sizeof(uint32_t) + sizeof(uint64_t));
+      *maxTransfer = std::max(*maxTransfer, static_cast<size_t>(reader.get<uint64_t>()));
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("Usage: %s <record file> [-r repeats] [-t 0|1]\n", argv[0]);
+    return 1;
+  }
+  for (int i = 2; i + 1 < argc; i += 2) {
+    const std::string option = argv[i];
+    const uint32_t value = static_cast<uint32_t>(atoi(argv[i + 1]));
+    if (option == "-r") {
+      repeats_ = std::max(value, 1u);
+    } else if (option == "-t") {
+      timing_ = (value != 0);
+    } else {
+      printf("Usage: %s <record file> [-r repeats] [-t 0|1]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::vector<Record> records;
+  size_t maxTransfer = 0;
+  if (!in.good() && !in.eof()) {
+    LogPrintfError("Can't read %s", argv[1]);
+    return 1;
+  }
+  if (!parse(file, &records, &maxTransfer)) {
+    return 1;
+  }
+
+  // The replay itself must not be recorded
+  unsetenv("AMD_CMD_RECORD");
+  if (!amd::Runtime::init()) {
+    LogError("Runtime init failed");
+    return 1;
+  }
+  std::vector<amd::Device*> devices = amd::Device::getDevices(CL_DEVICE_TYPE_GPU, false);
+  if (devices.empty()) {
+    LogError("No GPU devices");
+    return 1;
+  }
+  amd::Context::Info info = {0};
+  amd::Context* context = new amd::Context(devices, info);
+  if ((context == nullptr) || (context->create(nullptr) != CL_SUCCESS)) {
+    LogError("Context creation failed");
+    return 1;
+  }
+
+  bool result = true;
+  {
+    Replayer replayer(*context, devices);
+    replayer.allocScratch(maxTransfer);
+    printf("Device %s, %zu records, %u repeats, timing %d\n", devices[0]->info().name_,
+           records.size(), repeats_, timing_ ? 1 : 0);
+    for (uint32_t r = 0; (r < repeats_) && result; ++r) {
+      const uint64_t start = amd::Os::timeNanos();
+      result = replayer.run(records, r == 0);
+      replayer.finish();
+      const uint64_t end = amd::Os::timeNanos();
+      printf("pass %u: %.3f ms, %llu replayed, %llu skipped\n", r, (end - start) / 1e6,
+             static_cast<unsigned long long>(replayer.replayed()),
+             static_cast<unsigned long long>(replayer.skipped()));
+      fflush(stdout);
+    }
+  }
+  context->release();
+  return result ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <platform/runtime.hpp>
+#include <platform/context.hpp>
+#include <platform/commandqueue.hpp>
+#include <platform/command.hpp>
+#include <platform/program.hpp>
+#include <platform/kernel.hpp>
+#include <os/os.hpp>
+#include <utils/flags.hpp>
+#include <utils/debug.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+static uint32_t runs_ = 5;
+static std::string cacheDir_ = "/tmp/rocclr_startup_cache";
+
+//! The kernel of the first launch. The source is unique per benchmark, so the code cache
+//! has the program only after the cold run
+static const char* kSource = "__kernel void startup_first(__global int* out) { *out = 1; }\n";
+
+//! Returns the monotonic time in ns, which is the same clock in all processes
+static uint64_t monotonicNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ================================================================================================
+//! Measures the startup in the child process. The times are from the process spawn in us
+static int runChild(const char* mode, uint64_t spawn) {
+  const uint64_t entry = monotonicNanos();
+  if (!amd::Runtime::init()) {
+    LogError("Runtime init failed");
+    return 1;
+  }
+  const uint64_t init = monotonicNanos();
+
+  std::vector<amd::Device*> devices = amd::Device::getDevices(CL_DEVICE_TYPE_GPU, false);
+  if (devices.empty()) {
+    LogError("No GPU devices");
+    return 1;
+  }
+  devices.resize(1);
+  amd::Context::Info info = {0};
+  amd::Context* context = new amd::Context(devices, info);
+  if ((context == nullptr) || (context->create(nullptr) != CL_SUCCESS)) {
+    LogError("Context creation failed");
+    return 1;
+  }
+  amd::HostQueue* queue = new amd::HostQueue(*context, *devices[0], 0);
+  if ((queue == nullptr) || !queue->create()) {
+    LogError("Queue creation failed");
+    return 1;
+  }
+  const uint64_t ready = monotonicNanos();
+
+  amd::Program* program = new amd::Program(*context, kSource, amd::Program::OpenCL_C);
+  if ((program == nullptr) || (program->build(devices, "") != CL_SUCCESS) ||
+      !program->load()) {
+    LogError("Program build failed");
+    return 1;
+  }
+  const uint64_t build = monotonicNanos();
+
+  const amd::Symbol* symbol = program->findSymbol("startup_first");
+  if (symbol == nullptr) {
+    LogError("Can't find the kernel");
+    return 1;
+  }
+  amd::Kernel* kernel = new amd::Kernel(*program, *symbol, "startup_first");
+  amd::Memory* out = new (*context) amd::Buffer(*context, 0, sizeof(int));
+  if ((out == nullptr) || !out->create()) {
+    LogError("Buffer creation failed");
+    return 1;
+  }
+  const cl_mem handle = as_cl(out);
+  kernel->parameters().set(0, sizeof(handle), &handle);
+  const size_t global = 1;
+  const amd::NDRangeContainer sizes(1, nullptr, &global, &global);
+  amd::NDRangeKernelCommand* command =
+      new amd::NDRangeKernelCommand(*queue, amd::Command::EventWaitList(), *kernel, sizes);
+  if (command->captureAndValidate() != CL_SUCCESS) {
+    LogError("Kernel validation failed");
+    return 1;
+  }
+  command->enqueue();
+  command->awaitCompletion();
+  const uint64_t launch = monotonicNanos();
+
+  printf("%s,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n", mode, (entry - spawn) / 1e3,
+         (init - spawn) / 1e3, (ready - spawn) / 1e3, (build - spawn) / 1e3,
+         (launch - spawn) / 1e3, (launch - build) / 1e3);
+  // The breakdown of AMD_INIT_PROFILE follows on the exit
+  fflush(stdout);
+
+  command->release();
+  out->release();
+  kernel->release();
+  program->release();
+  queue->release();
+  context->release();
+  return 0;
+}
+
+// ================================================================================================
+//! Runs the child process and waits for it
+static bool spawnChild(const char* self, const char* mode) {
+  const std::string spawn = std::to_string(monotonicNanos());
+  const pid_t pid = fork();
+  if (pid < 0) {
+    LogError("Fork failed");
+    return false;
+  }
+  if (pid == 0) {
+    setenv("OCL_CODE_CACHE_ENABLE", "1", 1);
+    setenv("OCL_CODE_CACHE_PATH", cacheDir_.c_str(), 1);
+    // The cold run starts with the empty code cache
+    setenv("OCL_CODE_CACHE_RESET", (strcmp(mode, "cold") == 0) ? "1" : "0", 1);
+    execl(self, self, "-child", mode, spawn.c_str(), static_cast<char*>(nullptr));
+    _exit(127);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+// ================================================================================================
+int main(int argc, char** argv) {
+  if ((argc == 4) && (strcmp(argv[1], "-child") == 0)) {
+    return runChild(argv[2], strtoull(argv[3], nullptr, 10));
+  }
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string option = argv[i];
+    if (option == "-r") {
+      runs_ = std::max(static_cast<uint32_t>(atoi(argv[i + 1])), 1u);
+    } else if (option == "-c") {
+      cacheDir_ = argv[i + 1];
+    } else {
+      printf("Usage: %s [-r runs] [-c code cache dir]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  printf("mode,main_us,init_us,ready_us,build_us,first_launch_us,launch_us\n");
+  fflush(stdout);
+  bool result = spawnChild(argv[0], "cold");
+  for (uint32_t i = 1; (i < runs_) && result; ++i) {
+    result = spawnChild(argv[0], "warm");
+  }
+  return result ? 0 : 1;
+}
@@ -0,0 +1,316 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <platform/runtime.hpp>
+#include <platform/context.hpp>
+#include <platform/commandqueue.hpp>
+#include <platform/memory.hpp>
+#include <device/rocm/rocvirtual.hpp>
+#include <device/rocm/rocblit.hpp>
+#include <os/os.hpp>
+#include <utils/flags.hpp>
+#include <utils/debug.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//! The staging settings of a run: GPU_STAGING_BUFFER_SIZE (KiB), GPU_PINNED_XFER_SIZE (MiB)
+//! and GPU_PINNED_MIN_XFER_SIZE (KiB). Zero keeps the runtime default
+struct Staging {
+  uint32_t stagingSize_;
+  uint32_t pinnedXferSize_;
+  uint32_t pinnedMinXferSize_;
+};
+
+static constexpr Staging kStagings[] = {
+    {0, 0, 0}, {256, 0, 0}, {4096, 0, 0}, {0, 8, 0}, {0, 128, 0}, {0, 0, 128}, {0, 0, 16384}};
+
+//! The smallest transfer size
+static constexpr uint64_t kMinSize = 4;
+//! The amount of the data, transferred in each measurement, if the size is smaller
+static constexpr uint64_t kTargetBytes = 256 * Mi;
+//! The maximum number of the repeats in each measurement
+static constexpr uint64_t kMaxRepeats = 1000;
+//! The row size of the rect transfers
+static constexpr size_t kRectRow = 4 * Ki;
+
+static uint64_t maxSize_ = 4 * Gi;
+
+//! A host memory for the read/write transfers
+struct HostMem {
+  const char* name_;
+  void* ptr_;
+};
+
+//! A memory object for the device transfers
+struct DevMem {
+  const char* name_;
+  device::Memory* mem_;
+};
+
+// ================================================================================================
+static void printHeader() {
+  printf("engine,op,src,dst,size,staging_kb,pinned_xfer_mb,pinned_min_xfer_kb,repeats,"
+         "time_us,gbps,status\n");
+  fflush(stdout);
+}
+
+// ================================================================================================
+static void measure(roc::VirtualGPU& gpu, const char* engine, const char* op,
+                    const char* src, const char* dst, uint64_t size,
+                    const std::function<bool()>& transfer) {
+  const uint64_t repeats = std::min(std::max(kTargetBytes / size, uint64_t(1)), kMaxRepeats);
+  bool result = true;
+  uint64_t time = 0;
+  {
+    // Blit managers require an exclusive access to the queue
+    amd::ScopedLock lock(gpu.execution());
+    // Warm up the staging and pinning resources
+    result = transfer() && gpu.releaseGpuMemoryFence();
+    const uint64_t start = amd::Os::timeNanos();
+    for (uint64_t i = 0; result && (i < repeats); ++i) {
+      result = transfer();
+    }
+    result = result && gpu.releaseGpuMemoryFence();
+    time = amd::Os::timeNanos() - start;
+  }
+  const double timeUs = time / (1000.0 * repeats);
+  const double gbps = (time != 0) ? (size * repeats) / static_cast<double>(time) : 0.0;
+  printf("%s,%s,%s,%s,%lu,%zu,%zu,%zu,%lu,%.3f,%.3f,%s\n", engine, op, src, dst,
+         static_cast<unsigned long>(size), static_cast<size_t>(GPU_STAGING_BUFFER_SIZE),
+         static_cast<size_t>(GPU_PINNED_XFER_SIZE), static_cast<size_t>(GPU_PINNED_MIN_XFER_SIZE),
+         static_cast<unsigned long>(repeats), timeUs, gbps, result ? "ok" : "fail");
+  fflush(stdout);
+}
+
+// ================================================================================================
+static amd::Memory* createBuffer(amd::Context& context, uint64_t size) {
+  amd::Memory* buffer = new (context) amd::Buffer(context, 0, size);
+  if ((buffer != nullptr) && !buffer->create()) {
+    buffer->release();
+    buffer = nullptr;
+  }
+  return buffer;
+}
+
+// ================================================================================================
+static void sweepSize(amd::Context& context, roc::VirtualGPU& gpu, device::BlitManager& dma,
+                      uint64_t size) {
+  const amd::Device& device = gpu.device();
+  std::vector<amd::Memory*> buffers;
+  std::vector<HostMem> hosts;
+  std::vector<DevMem> devs;
+
+  // Host memory types
+  void* pageable = malloc(size);
+  if (pageable != nullptr) {
+    hosts.push_back({"pageable", pageable});
+  }
+  void* pinned = device.hostAlloc(size, 0);
+  if (pinned != nullptr) {
+    hosts.push_back({"pinned", pinned});
+  }
+  void* fineSvm = amd::SvmBuffer::malloc(context, CL_MEM_SVM_FINE_GRAIN_BUFFER, size, 0);
+  if (fineSvm != nullptr) {
+    hosts.push_back({"svm_fine", fineSvm});
+  }
+
+  // Device memory types
+  amd::Memory* local = createBuffer(context, size);
+  amd::Memory* local2 = createBuffer(context, size);
+  if ((local == nullptr) || (local2 == nullptr)) {
+    LogPrintfError("Can't allocate %lu bytes of device memory", static_cast<unsigned long>(size));
+  } else {
+    buffers.push_back(local);
+    buffers.push_back(local2);
+    devs.push_back({"local", local2->getDeviceMemory(device)});
+  }
+  void* coarseSvm = amd::SvmBuffer::malloc(context, 0, size, 0);
+  amd::Memory* coarse = (coarseSvm != nullptr) ? amd::MemObjMap::FindMemObj(coarseSvm) : nullptr;
+  if (coarse != nullptr) {
+    devs.push_back({"svm_coarse", coarse->getDeviceMemory(device)});
+  }
+  if (context.devices().size() > 1) {
+    amd::Memory* peer = createBuffer(context, size);
+    if (peer != nullptr) {
+      buffers.push_back(peer);
+      devs.push_back({"peer", peer->getDeviceMemory(*context.devices()[1])});
+    }
+  }
+
+  if (local != nullptr) {
+    device::Memory& devMem = *local->getDeviceMemory(device);
+    const amd::Coord3D origin(0, 0, 0);
+    const amd::Coord3D region(size, 1, 1);
+    // The rect transfers use the rows of kRectRow bytes
+    const size_t width = std::min(static_cast<size_t>(size), kRectRow);
+    const size_t rows = static_cast<size_t>(size / width);
+    const size_t rectOrigin[3] = {0, 0, 0};
+    const size_t rectRegion[3] = {width, rows, 1};
+    amd::BufferRect rect;
+    rect.create(rectOrigin, rectRegion, width, width * rows);
+    const amd::Coord3D rectSize(width, rows, 1);
+    const uint32_t pattern = 0xdeadbeef;
+
+    const std::pair<const char*, device::BlitManager*> engines[] = {
+        {"dma", &dma}, {"kernel", &gpu.blitMgr()}};
+    for (const auto& engine : engines) {
+      device::BlitManager& blit = *engine.second;
+      for (const auto& host : hosts) {
+        measure(gpu, engine.first, "read", "local", host.name_, size, [&]() {
+          return blit.readBuffer(devMem, host.ptr_, origin, region, true);
+        });
+        measure(gpu, engine.first, "write", host.name_, "local", size, [&]() {
+          return blit.writeBuffer(host.ptr_, devMem, origin, region, true);
+        });
+        measure(gpu, engine.first, "read_rect", "local", host.name_, width * rows, [&]() {
+          return blit.readBufferRect(devMem, host.ptr_, rect, rect, rectSize, true);
+        });
+        measure(gpu, engine.first, "write_rect", host.name_, "local", width * rows, [&]() {
+          return blit.writeBufferRect(host.ptr_, devMem, rect, rect, rectSize, true);
+        });
+      }
+      for (const auto& dev : devs) {
+        measure(gpu, engine.first, "copy", "local", dev.name_, size, [&]() {
+          return blit.copyBuffer(devMem, *dev.mem_, origin, origin, region, true);
+        });
+        measure(gpu, engine.first, "copy", dev.name_, "local", size, [&]() {
+          return blit.copyBuffer(*dev.mem_, devMem, origin, origin, region, true);
+        });
+        measure(gpu, engine.first, "copy_rect", "local", dev.name_, width * rows, [&]() {
+          return blit.copyBufferRect(devMem, *dev.mem_, rect, rect, rectSize, true);
+        });
+      }
+      measure(gpu, engine.first, "fill", "pattern", "local", size, [&]() {
+        return blit.fillBuffer(devMem, &pattern, sizeof(pattern), origin, region, true);
+      });
+    }
+  }
+
+  for (auto buffer : buffers) {
+    buffer->release();
+  }
+  if (coarseSvm != nullptr) {
+    amd::SvmBuffer::free(context, coarseSvm);
+  }
+  if (fineSvm != nullptr) {
+    amd::SvmBuffer::free(context, fineSvm);
+  }
+  if (pinned != nullptr) {
+    device.hostFree(pinned, size);
+  }
+  free(pageable);
+}
+
+// ================================================================================================
+static int runStaging() {
+  if (!amd::Runtime::init()) {
+    LogError("Runtime init failed");
+    return 1;
+  }
+  std::vector<amd::Device*> devices = amd::Device::getDevices(CL_DEVICE_TYPE_GPU, false);
+  if (devices.empty()) {
+    LogError("No GPU devices");
+    return 1;
+  }
+  // The second device is the peer of the copies
+  devices.resize(std::min(devices.size(), size_t(2)));
+  amd::Device& device = *devices[0];
+
+  amd::Context::Info info = {0};
+  amd::Context* context = new amd::Context(devices, info);
+  if ((context == nullptr) || (context->create(nullptr) != CL_SUCCESS)) {
+    LogError("Context creation failed");
+    return 1;
+  }
+  amd::HostQueue* queue = new amd::HostQueue(*context, device, 0);
+  if ((queue == nullptr) || !queue->create()) {
+    LogError("Queue creation failed");
+    return 1;
+  }
+  roc::VirtualGPU& gpu = *static_cast<roc::VirtualGPU*>(queue->vdev());
+
+  // The DMA manager uses the HW accelerated paths only, the kernel manager is the queue's one
+  roc::DmaBlitManager* dma = new roc::DmaBlitManager(gpu);
+  if ((dma == nullptr) || !dma->create(device)) {
+    LogError("DMA blit manager creation failed");
+    return 1;
+  }
+
+  const uint64_t maxSize = std::min(maxSize_, device.info().maxMemAllocSize_);
+  for (uint64_t size = kMinSize; size <= maxSize; size *= 4) {
+    sweepSize(*context, gpu, *dma, size);
+  }
+
+  delete dma;
+  queue->release();
+  context->release();
+  return 0;
+}
+
+// ================================================================================================
+int main(int argc, char** argv) {
+  int staging = -1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string option = argv[i];
+    if (option == "-m") {
+      maxSize_ = std::max(strtoull(argv[i + 1], nullptr, 0), 1ULL * kMinSize);
+    } else if (option == "-s") {
+      staging = atoi(argv[i + 1]);
+    } else {
+      printf("Usage: %s [-m max size] [-s staging config index]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  const int numStagings = static_cast<int>(sizeof(kStagings) / sizeof(kStagings[0]));
+  if (staging < 0) {
+    // The staging settings are read at the device init, so each config runs in own process
+    printHeader();
+    int result = 0;
+    for (int i = 0; i < numStagings; ++i) {
+      std::ostringstream cmd;
+      cmd << argv[0] << " -m " << maxSize_ << " -s " << i;
+      result |= system(cmd.str().c_str());
+    }
+    return (result != 0) ? 1 : 0;
+  }
+  if (staging >= numStagings) {
+    printf("Invalid staging config %d, the max is %d\n", staging, numStagings - 1);
+    return 1;
+  }
+
+  const Staging& config = kStagings[staging];
+  if (config.stagingSize_ != 0) {
+    setenv("GPU_STAGING_BUFFER_SIZE", std::to_string(config.stagingSize_).c_str(), 1);
+  }
+  if (config.pinnedXferSize_ != 0) {
+    setenv("GPU_PINNED_XFER_SIZE", std::to_string(config.pinnedXferSize_).c_str(), 1);
+  }
+  if (config.pinnedMinXferSize_ != 0) {
+    setenv("GPU_PINNED_MIN_XFER_SIZE", std::to_string(config.pinnedMinXferSize_).c_str(), 1);
+  }
+  return runStaging();
+}
@@ -104,13 +104,14 @@ bool DmaBlitManager::readBuffer(device::Memory& srcMemory, void* dstHost,
           pinAllocSize = amd::alignUp(tmpSize, PinnedMemoryAlignment);
           partial = 0;
         }
-        amd::Coord3D dst(partial, 0, 0);
         amd::Coord3D srcPin(origin[0] + offset, 0, 0);
         amd::Coord3D copySizePin(tmpSize, 0, 0);
         size_t partial2;
 
         // Allocate a GPU resource for pinning
         pinned = pinHostMemory(tmpHost, pinAllocSize, partial2);
+        // The pinned memory from the cache can start before the requested host memory
+        amd::Coord3D dst(partial + partial2, 0, 0);
         if (pinned != nullptr) {
           // Get device memory for this virtual device
           Memory* dstMemory = dev().getRocMemory(pinned);
@@ -132,7 +133,7 @@ bool DmaBlitManager::readBuffer(device::Memory& srcMemory, void* dstHost,
     }
 
     if (0 != srcSize) {
-      Memory& xferBuf = dev().xferRead().acquire();
+      Memory& xferBuf = dev().xferRead().acquire(gpu(), srcSize);
 
       // Read memory using a staging resource
       if (!readMemoryStaged(gpuMem(srcMemory), dstHost, xferBuf, origin[0], offset, srcSize,
@@ -161,28 +162,12 @@ bool DmaBlitManager::readBufferRect(device::Memory& srcMemory, void* dstHost,
     gpu().Barriers().WaitCurrent();
     return HostBlitManager::readBufferRect(srcMemory, dstHost, bufRect, hostRect, size, entire);
   } else {
-    Memory& xferBuf = dev().xferRead().acquire();
-    address staging = xferBuf.getDeviceMemory();
-    const_address src = gpuMem(srcMemory).getDeviceMemory();
-
-    size_t srcOffset;
-    size_t dstOffset;
-
-    for (size_t z = 0; z < size[2]; ++z) {
-      for (size_t y = 0; y < size[1]; ++y) {
-        srcOffset = bufRect.offset(0, y, z);
-        dstOffset = hostRect.offset(0, y, z);
-
-        // Copy data from device to host - line by line
-        address dst = reinterpret_cast<address>(dstHost) + dstOffset;
-        src += srcOffset;
-        bool retval = hsaCopyStaged(src, dst, size[0], staging, false);
-        if (!retval) {
-          return retval;
-        }
-      }
-    }
+    Memory& xferBuf = dev().xferRead().acquire(gpu(), size[0] * size[1] * size[2]);
+    bool retval = hsaCopyRectStaged(gpuMem(srcMemory).getDeviceMemory(), bufRect,
+                                    reinterpret_cast<address>(dstHost), hostRect, size, xferBuf,
+                                    false);
     dev().xferRead().release(gpu(), xferBuf);
+    return retval;
   }
 
   return true;
@@ -228,8 +213,17 @@ bool DmaBlitManager::writeBuffer(const void* srcHost, device::Memory& dstMemory,
       gpuMem(dstMemory).IsPersistentDirectMap()) {
     // Stall GPU before CPU access
     gpu().releaseGpuMemoryFence();
-    return HostBlitManager::writeBuffer(srcHost, dstMemory, origin, size, entire);
+    bool result = HostBlitManager::writeBuffer(srcHost, dstMemory, origin, size, entire);
+    if (gpuMem(dstMemory).IsPersistentDirectMap()) {
+      // CPU wrote the device memory over BAR
+      gpu().addHdpFlush();
+    }
+    return result;
   } else {
+    if (writeLargeBar(srcHost, dstMemory, origin, size)) {
+      return true;
+    }
+
     // HSA copy functionality with a possible async operation
     gpu().releaseGpuMemoryFence(kSkipCpuWait);
 
@@ -266,13 +260,14 @@ bool DmaBlitManager::writeBuffer(const void* srcHost, device::Memory& dstMemory,
           pinAllocSize = amd::alignUp(tmpSize, PinnedMemoryAlignment);
           partial = 0;
         }
-        amd::Coord3D src(partial, 0, 0);
         amd::Coord3D dstPin(origin[0] + offset, 0, 0);
         amd::Coord3D copySizePin(tmpSize, 0, 0);
         size_t partial2;
 
         // Allocate a GPU resource for pinning
         pinned = pinHostMemory(tmpHost, pinAllocSize, partial2);
+        // The pinned memory from the cache can start before the requested host memory
+        amd::Coord3D src(partial + partial2, 0, 0);
 
         if (pinned != nullptr) {
           // Get device memory for this virtual device
@@ -295,7 +290,7 @@ bool DmaBlitManager::writeBuffer(const void* srcHost, device::Memory& dstMemory,
     }
 
     if (dstSize != 0) {
-      Memory& xferBuf = dev().xferWrite().acquire();
+      Memory& xferBuf = dev().xferWrite().acquire(gpu(), dstSize);
 
       // Write memory using a staging resource
       if (!writeMemoryStaged(srcHost, gpuMem(dstMemory), xferBuf, origin[0], offset, dstSize,
@@ -311,6 +306,34 @@ bool DmaBlitManager::writeBuffer(const void* srcHost, device::Memory& dstMemory,
   return true;
 }
 
+bool DmaBlitManager::writeLargeBar(const void* srcHost, device::Memory& dstMemory,
+                                   const amd::Coord3D& origin, const amd::Coord3D& size) const {
+  if (!dev().info().largeBar_ || (size[0] > dev().settings().largeBarWriteSize_) ||
+      (dstMemory.owner()->getHostMem() != nullptr) ||
+      (dstMemory.owner()->getSvmPtr() == nullptr)) {
+    return false;
+  }
+
+  // The queue can still access the memory, hence wait for the previous operations
+  gpu().releaseGpuMemoryFence();
+  char* dst = reinterpret_cast<char*>(dstMemory.owner()->getSvmPtr());
+  // The large BAR memory is write combined
+  amd::Os::streamingMemcpy(dst + origin[0], srcHost, size[0]);
+
+  // HDP is flushed before the next GPU operation, which can read the memory
+  if (gpu().addHdpFlush()) {
+    // The next kernel still must drop the stale lines from L2,
+    // but the queue doesn't need a barrier and CPU wait
+    gpu().addSystemScope();
+  } else {
+    // Set hasPendingDispatch_ flag. Then releaseGpuMemoryFence() will use barrier to
+    // invalidate cache
+    gpu().hasPendingDispatch();
+    gpu().releaseGpuMemoryFence();
+  }
+  return true;
+}
+
 bool DmaBlitManager::writeBufferRect(const void* srcHost, device::Memory& dstMemory,
                                      const amd::BufferRect& hostRect,
                                      const amd::BufferRect& bufRect, const amd::Coord3D& size,
@@ -321,30 +344,20 @@ bool DmaBlitManager::writeBufferRect(const void* srcHost, device::Memory& dstMem
   // Use host copy if memory has direct access
   if (setup_.disableWriteBufferRect_ || dstMemory.isHostMemDirectAccess() ||
       gpuMem(dstMemory).IsPersistentDirectMap()) {
-    return HostBlitManager::writeBufferRect(srcHost, dstMemory, hostRect, bufRect, size, entire);
-  } else {
-    Memory& xferBuf = dev().xferWrite().acquire();
-    address staging = xferBuf.getDeviceMemory();
-    address dst = static_cast<roc::Memory&>(dstMemory).getDeviceMemory();
-
-    size_t srcOffset;
-    size_t dstOffset;
-
-    for (size_t z = 0; z < size[2]; ++z) {
-      for (size_t y = 0; y < size[1]; ++y) {
-        srcOffset = hostRect.offset(0, y, z);
-        dstOffset = bufRect.offset(0, y, z);
-
-        // Copy data from host to device - line by line
-        dst += dstOffset;
-        const_address src = reinterpret_cast<const_address>(srcHost) + srcOffset;
-        bool retval = hsaCopyStaged(src, dst, size[0], staging, true);
-        if (!retval) {
-          return retval;
-        }
-      }
+    bool result =
+        HostBlitManager::writeBufferRect(srcHost, dstMemory, hostRect, bufRect, size, entire);
+    if (gpuMem(dstMemory).IsPersistentDirectMap()) {
+      // CPU wrote the device memory over BAR
+      gpu().addHdpFlush();
     }
+    return result;
+  } else {
+    Memory& xferBuf = dev().xferWrite().acquire(gpu(), size[0] * size[1] * size[2]);
+    bool retval = hsaCopyRectStaged(static_cast<roc::Memory&>(dstMemory).getDeviceMemory(),
+                                    bufRect, reinterpret_cast<address>(const_cast<void*>(srcHost)),
+                                    hostRect, size, xferBuf, true);
     gpu().addXferWrite(xferBuf);
+    return retval;
   }
 
   return true;
@@ -384,6 +397,14 @@ bool DmaBlitManager::copyBuffer(device::Memory& srcMemory, device::Memory& dstMe
   return true;
 }
 
+// ================================================================================================
+//! Returns TRUE if the rect can be transferred with a single rect DMA,
+//! which requires the dword aligned pitches
+static bool isRectDmaCapable(const amd::BufferRect& srcRect, const amd::BufferRect& dstRect) {
+  return ((srcRect.rowPitch_ % 4) == 0) && ((srcRect.slicePitch_ % 4) == 0) &&
+         ((dstRect.rowPitch_ % 4) == 0) && ((dstRect.slicePitch_ % 4) == 0);
+}
+
 // ================================================================================================
 bool DmaBlitManager::copyBufferRect(device::Memory& srcMemory, device::Memory& dstMemory,
                                     const amd::BufferRect& srcRect, const amd::BufferRect& dstRect,
@@ -406,7 +427,7 @@ bool DmaBlitManager::copyBufferRect(device::Memory& srcMemory, device::Memory& d
     const hsa_agent_t dstAgent =
         (dstMemory.isHostMemDirectAccess()) ? dev().getCpuAgent() : dev().getBackendDevice();
 
-    bool isSubwindowRectCopy = true;
+    const bool isSubwindowRectCopy = isRectDmaCapable(srcRect, dstRect);
     hsa_amd_copy_direction_t direction = hsaHostToHost;
 
     hsa_agent_t agent = dev().getBackendDevice();
@@ -432,13 +453,8 @@ bool DmaBlitManager::copyBufferRect(device::Memory& srcMemory, device::Memory& d
                       static_cast<uint32_t>(size[2]) };
     hsa_dim3_t offset = { 0, 0 ,0 };
 
-
-    if ((srcRect.rowPitch_ % 4 != 0)    ||
-        (srcRect.slicePitch_ % 4 != 0)  ||
-        (dstRect.rowPitch_ % 4 != 0)    ||
-        (dstRect.slicePitch_ % 4 != 0)) {
-      isSubwindowRectCopy = false;
-    }
+    // SDMA can read the memory, which CPU wrote
+    gpu().flushHdp();
 
     HwQueueEngine engine = HwQueueEngine::Unknown;
     if ((srcAgent.handle == dev().getCpuAgent().handle) &&
@@ -498,11 +514,132 @@ bool DmaBlitManager::copyBufferRect(device::Memory& srcMemory, device::Memory& d
   return true;
 }
 
+// ================================================================================================
+bool DmaBlitManager::hsaCopyRectStaged(address device, const amd::BufferRect& devRect,
+                                       address host, const amd::BufferRect& hostRect,
+                                       const amd::Coord3D& size, Memory& xferBuf,
+                                       bool hostToDev) const {
+  address staging = xferBuf.getDeviceMemory();
+  // The rows are packed with the dword aligned pitch, required by the rect DMA
+  const size_t stagingPitch = amd::alignUp(size[0], sizeof(uint32_t));
+  const size_t batchRows = (dev().agent_profile() == HSA_PROFILE_FULL) ? 0 :
+                           std::min(size[1], xferBuf.size() / stagingPitch);
+  const bool rectDma = (batchRows > 1) && ((devRect.rowPitch_ % 4) == 0) &&
+                       ((devRect.slicePitch_ % 4) == 0);
+
+  for (size_t z = 0; z < size[2]; ++z) {
+    if (!rectDma) {
+      // Fall to line by line copies
+      for (size_t y = 0; y < size[1]; ++y) {
+        address devLine = device + devRect.offset(0, y, z);
+        address hostLine = host + hostRect.offset(0, y, z);
+        bool result = hostToDev ? hsaCopyStaged(hostLine, devLine, size[0], staging, true)
+                                : hsaCopyStaged(devLine, hostLine, size[0], staging, false);
+        if (!result) {
+          return false;
+        }
+      }
+      continue;
+    }
+
+    for (size_t y = 0; y < size[1]; y += batchRows) {
+      const size_t rows = std::min(batchRows, size[1] - y);
+      gpu().metrics().add(VDI_METRIC_STAGING_BYTES, rows * size[0]);
+      if (hostToDev) {
+        for (size_t r = 0; r < rows; ++r) {
+          memcpy(staging + r * stagingPitch, host + hostRect.offset(0, y + r, z), size[0]);
+        }
+      }
+
+      hsa_pitched_ptr_t devMem = {device + devRect.offset(0, y, z), devRect.rowPitch_,
+                                  devRect.slicePitch_};
+      hsa_pitched_ptr_t stageMem = {staging, stagingPitch, stagingPitch * rows};
+      hsa_dim3_t dim = {static_cast<uint32_t>(size[0]), static_cast<uint32_t>(rows), 1};
+      hsa_dim3_t offset = {0, 0, 0};
+
+      gpu().Barriers().SetActiveEngine(hostToDev ? HwQueueEngine::SdmaWrite
+                                                 : HwQueueEngine::SdmaRead);
+      gpu().flushHdp();
+      hsa_signal_t active = gpu().Barriers().ActiveSignal(kInitSignalValueOne, gpu().timestamp());
+      ClPrint(amd::LOG_DEBUG, amd::LOG_COPY,
+              "[%zx]!\t HSA Async Copy Rect staged rows=%zu, completion_signal=0x%zx",
+              std::this_thread::get_id(), rows, active.handle);
+      hsa_status_t status = hostToDev ?
+          hsa_amd_memory_async_copy_rect(&devMem, &offset, &stageMem, &offset, &dim,
+                                         dev().getBackendDevice(), hsaHostToDevice, 0, nullptr,
+                                         active) :
+          hsa_amd_memory_async_copy_rect(&stageMem, &offset, &devMem, &offset, &dim,
+                                         dev().getBackendDevice(), hsaDeviceToHost, 0, nullptr,
+                                         active);
+      if (status != HSA_STATUS_SUCCESS) {
+        gpu().Barriers().ResetCurrentSignal();
+        LogPrintfError("DMA rect copy failed with code %d", status);
+        return false;
+      }
+      // The next batch reuses the staging buffer
+      if (!WaitForSignal(active, gpu().waitPolicy())) {
+        LogError("Staged rect copy wait failed!");
+        return false;
+      }
+
+      if (!hostToDev) {
+        for (size_t r = 0; r < rows; ++r) {
+          memcpy(host + hostRect.offset(0, y + r, z), staging + r * stagingPitch, size[0]);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+// ================================================================================================
+bool DmaBlitManager::copyLinearImage(device::Memory& bufferMemory, device::Memory& imageMemory,
+                                     const amd::Coord3D& bufferOrigin,
+                                     const amd::Coord3D& imageOrigin, const amd::Coord3D& size,
+                                     size_t rowPitch, size_t slicePitch, bool toImage) const {
+  const Image& image = static_cast<const Image&>(imageMemory);
+  if (image.linearRowPitch() == 0) {
+    return false;
+  }
+  amd::Image* amdImage = static_cast<amd::Image*>(image.owner());
+  const size_t elementSize = amdImage->getImageFormat().getElementSize();
+
+  // The linear layout is a pitched buffer, so the image region is a rect in bytes
+  const size_t region[3] = {size[0] * elementSize, size[1], size[2]};
+  const size_t imageStart[3] = {imageOrigin[0] * elementSize, imageOrigin[1], imageOrigin[2]};
+  const size_t bufferStart[3] = {bufferOrigin[0], 0, 0};
+  amd::BufferRect imageRect;
+  amd::BufferRect bufferRect;
+  if (!imageRect.create(imageStart, region, image.linearRowPitch(),
+                        image.linearRowPitch() * amdImage->getHeight()) ||
+      !bufferRect.create(bufferStart, region, rowPitch, slicePitch) ||
+      !isRectDmaCapable(imageRect, bufferRect)) {
+    return false;
+  }
+
+  const amd::Coord3D rectSize(region[0], region[1], region[2]);
+  ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "Linear image DMA %s: %zux%zux%zu bytes",
+          toImage ? "write" : "read", region[0], region[1], region[2]);
+  // Avoid the kernel path of the derived blit managers
+  return toImage ? DmaBlitManager::copyBufferRect(bufferMemory, imageMemory, bufferRect,
+                                                  imageRect, rectSize, false)
+                 : DmaBlitManager::copyBufferRect(imageMemory, bufferMemory, imageRect,
+                                                  bufferRect, rectSize, false);
+}
+
 // ================================================================================================
 bool DmaBlitManager::copyImageToBuffer(device::Memory& srcMemory, device::Memory& dstMemory,
                                        const amd::Coord3D& srcOrigin, const amd::Coord3D& dstOrigin,
                                        const amd::Coord3D& size, bool entire, size_t rowPitch,
                                        size_t slicePitch) const {
+  // The linear images don't need the tiling, hence DMA transfers them asynchronously
+  if (!setup_.disableCopyImageToBuffer_ &&
+      copyLinearImage(dstMemory, srcMemory, dstOrigin, srcOrigin, size, rowPitch, slicePitch,
+                      false)) {
+    return true;
+  }
+
   // HSA copy functionality with a possible async operation, hence make sure GPU is done
   gpu().releaseGpuMemoryFence();
 
@@ -543,10 +680,18 @@ bool DmaBlitManager::copyImageToBuffer(device::Memory& srcMemory, device::Memory
   return result;
 }
 
+// ================================================================================================
 bool DmaBlitManager::copyBufferToImage(device::Memory& srcMemory, device::Memory& dstMemory,
                                        const amd::Coord3D& srcOrigin, const amd::Coord3D& dstOrigin,
                                        const amd::Coord3D& size, bool entire, size_t rowPitch,
                                        size_t slicePitch) const {
+  // The linear images don't need the tiling, hence DMA transfers them asynchronously
+  if (!setup_.disableCopyBufferToImage_ &&
+      copyLinearImage(srcMemory, dstMemory, srcOrigin, dstOrigin, size, rowPitch, slicePitch,
+                      true)) {
+    return true;
+  }
+
   // HSA copy functionality with a possible async operation, hence make sure GPU is done
   gpu().releaseGpuMemoryFence();
 
@@ -645,10 +790,27 @@ bool DmaBlitManager::hsaCopy(const Memory& srcMemory, const Memory& dstMemory,
     dstAgent = dstMemory.dev().getBackendDevice();
   }
 
-  // This workaround is needed for performance to get around the slowdown
-  // caused to SDMA engine powering down if its not active. Forcing agents
-  // to amdgpu device causes rocr to take blit path internally.
-  if (size[0] <= dev().settings().sdmaCopyThreshold_) {
+  Device::CopyEngineModel* model = dev().copyEngineModel();
+  auto direction = Device::CopyEngineModel::DirectionTotal;
+  if ((model != nullptr) && (srcAgent.handle != dstAgent.handle)) {
+    if (srcAgent.handle == dev().getCpuAgent().handle) {
+      direction = Device::CopyEngineModel::HostToDevice;
+    } else if (dstAgent.handle == dev().getCpuAgent().handle) {
+      direction = Device::CopyEngineModel::DeviceToHost;
+    } else {
+      direction = Device::CopyEngineModel::PeerToPeer;
+    }
+  }
+
+  if (direction != Device::CopyEngineModel::DirectionTotal) {
+    // The same agent on both sides causes rocr to take blit path internally
+    if (model->select(direction, size[0]) == Device::CopyEngineModel::Blit) {
+      srcAgent = dstAgent = dev().getBackendDevice();
+    }
+  } else if (size[0] <= dev().settings().sdmaCopyThreshold_) {
+    // This workaround is needed for performance to get around the slowdown
+    // caused to SDMA engine powering down if its not active. Forcing agents
+    // to amdgpu device causes rocr to take blit path internally.
     srcAgent = dstAgent = dev().getBackendDevice();
   }
 
@@ -661,7 +823,28 @@ bool DmaBlitManager::hsaCopy(const Memory& srcMemory, const Memory& dstMemory,
     engine = HwQueueEngine::SdmaRead;
   }
 
+  // SDMA waits for the kernels only on the overlapped memory
+  gpu().Barriers().BeginRanges();
+  gpu().Barriers().AddRange(reinterpret_cast<uint64_t>(src),
+                            reinterpret_cast<uint64_t>(src) + size[0], true);
+  gpu().Barriers().AddRange(reinterpret_cast<uint64_t>(dst),
+                            reinterpret_cast<uint64_t>(dst) + size[0], false);
   auto wait_events = gpu().Barriers().WaitingSignal(engine);
+
+  // Stripe the big copies, if the blit kernels of the device can reach both memories
+  const size_t stripeSize = dev().settings().copyStripeSize_;
+  if ((stripeSize != 0) && (size[0] >= stripeSize) && (srcAgent.handle != dstAgent.handle)) {
+    const bool srcLocal = (&srcMemory.dev() == &dev());
+    const bool dstLocal = (&dstMemory.dev() == &dev());
+    const Device& peer = srcLocal ? dstMemory.dev() : srcMemory.dev();
+    if ((srcLocal && dstLocal) || ((srcLocal || dstLocal) && peer.isP2pAgent(dev()))) {
+      // The wait list is a member of the tracker and changes on the next wait request
+      const std::vector<hsa_signal_t> deps = wait_events;
+      return gpu().stripedCopy(dst, dstAgent, src, srcAgent, size[0], deps);
+    }
+  }
+
+  gpu().flushHdp();
   hsa_signal_t active = gpu().Barriers().ActiveSignal(kInitSignalValueOne, gpu().timestamp());
 
   // Use SDMA to transfer the data
@@ -674,6 +857,11 @@ bool DmaBlitManager::hsaCopy(const Memory& srcMemory, const Memory& dstMemory,
       size[0], wait_events.size(), &wait_events[0], active);
   if (status == HSA_STATUS_SUCCESS) {
     gpu().addSystemScope();
+    if (direction != Device::CopyEngineModel::DirectionTotal) {
+      model->track(direction, (srcAgent.handle == dstAgent.handle) ?
+                   Device::CopyEngineModel::Blit : Device::CopyEngineModel::Sdma,
+                   size[0], gpu().Barriers().GetLastSignal());
+    }
   } else {
     gpu().Barriers().ResetCurrentSignal();
     LogPrintfError("Hsa copy from host to device failed with code %d", status);
@@ -685,6 +873,8 @@ bool DmaBlitManager::hsaCopy(const Memory& srcMemory, const Memory& dstMemory,
 // ================================================================================================
 bool DmaBlitManager::hsaCopyStaged(const_address hostSrc, address hostDst, size_t size,
                                    address staging, bool hostToDev) const {
+  amd::TimelineScope stagingScope(amd::Timeline::kStaging,
+                                  hostToDev ? "staged write" : "staged read", size);
   // Stall GPU, sicne CPU copy is possible
   gpu().releaseGpuMemoryFence();
 
@@ -697,18 +887,70 @@ bool DmaBlitManager::hsaCopyStaged(const_address hostSrc, address hostDst, size_
     }
     return (status == HSA_STATUS_SUCCESS);
   }
+  gpu().metrics().add(VDI_METRIC_STAGING_BYTES, size);
+
+  // Adapt the number of staging chunks to the transfer size. The chunks rotate, so the CPU copy
+  // of one chunk overlaps the DMA of the others. Small transfers use a single chunk
+  const size_t capacity = std::min(size, gpu().stagingSize());
+  uint numChunks = std::min(gpu().stagingChunks(), static_cast<uint>(MaxStagedChunks));
+  numChunks = std::max(1u, std::min(numChunks, static_cast<uint>(capacity / MinStagedChunkSize)));
+  const size_t chunkSize = (numChunks == 1) ? capacity :
+                           amd::alignDown(capacity / numChunks, PinnedMemoryAlignment);
+
+  // Signals of the outstanding DMA for each chunk. HwQueueTracker pool has more signals
+  // than MaxStagedChunks, hence the signals can't be reused before they are waited here
+  hsa_signal_t busy[MaxStagedChunks] = {};
+
+  // Waits for the outstanding DMA in the chunk
+  auto waitChunk = [&](uint chunk) -> bool {
+    bool result = true;
+    if (busy[chunk].handle != 0) {
+      result = WaitForSignal(busy[chunk], gpu().waitPolicy());
+      busy[chunk].handle = 0;
+    }
+    return result;
+  };
+
+  // Submits DMA for the chunk
+  auto copyChunk = [&](uint chunk, void* dst, hsa_agent_t dstAgent, const void* src,
+                       hsa_agent_t srcAgent, size_t size, HwQueueEngine engine) -> bool {
+    gpu().Barriers().SetActiveEngine(engine);
+    gpu().flushHdp();
+    hsa_signal_t active = gpu().Barriers().ActiveSignal(kInitSignalValueOne, gpu().timestamp());
+    ClPrint(amd::LOG_DEBUG, amd::LOG_COPY,
+            "[%zx]!\t HSA Async Copy completion_signal=0x%zx",
+            std::this_thread::get_id(), active.handle);
+    hsa_status_t status = hsa_amd_memory_async_copy(dst, dstAgent, src, srcAgent, size, 0,
+                                                    nullptr, active);
+    if (status != HSA_STATUS_SUCCESS) {
+      gpu().Barriers().ResetCurrentSignal();
+      LogPrintfError("Hsa copy %s failed with code %d",
+                     (hostToDev ? "from host to device" : "from device to host"), status);
+      return false;
+    }
+    busy[chunk] = active;
+    return true;
+  };
+
+  // Waits for all outstanding DMA
+  auto waitAll = [&]() -> bool {
+    bool result = true;
+    for (uint i = 0; i < numChunks; ++i) {
+      result &= waitChunk(i);
+    }
+    return result;
+  };
 
   size_t totalSize = size;
   size_t offset = 0;
+  uint chunk = 0;
 
-  address hsaBuffer = staging;
-
-  // Allocate requested size of memory
-  while (totalSize > 0) {
-    size = std::min(totalSize, dev().settings().stagedXferSize_);
+  // Copy data from Host to Device
+  if (hostToDev) {
+    while (totalSize > 0) {
+      size = std::min(totalSize, chunkSize);
+      address hsaBuffer = staging + chunk * chunkSize;
 
-    // Copy data from Host to Device
-    if (hostToDev) {
       // This workaround is needed for performance to get around the slowdown
       // caused to SDMA engine powering down if its not active. Forcing agents
       // to amdgpu device causes rocr to take blit path internally.
@@ -719,55 +961,69 @@ bool DmaBlitManager::hsaCopyStaged(const_address hostSrc, address hostDst, size_
       if (srcAgent.handle == dev().getBackendDevice().handle) {
         engine = HwQueueEngine::SdmaWrite;
       }
-      gpu().Barriers().SetActiveEngine(engine);
-      hsa_signal_t active = gpu().Barriers().ActiveSignal(kInitSignalValueOne, gpu().timestamp());
 
-      memcpy(hsaBuffer, hostSrc + offset, size);
-      ClPrint(amd::LOG_DEBUG, amd::LOG_COPY,
-              "[%zx]!\t HSA Async Copy completion_signal=0x%zx",
-              std::this_thread::get_id(), active.handle);
-      status = hsa_amd_memory_async_copy(hostDst + offset, dev().getBackendDevice(), hsaBuffer,
-                                         srcAgent, size, 0, nullptr, active);
-      if (status != HSA_STATUS_SUCCESS) {
-        gpu().Barriers().ResetCurrentSignal();
-        LogPrintfError("Hsa copy from host to device failed with code %d", status);
+      // Make sure the previous DMA from the chunk is done, before CPU overwrites it
+      if (!waitChunk(chunk)) {
+        LogError("Staging chunk wait failed!");
+        waitAll();
+        return false;
+      }
+      // The staging buffer is read only by DMA, hence bypass CPU caches
+      amd::Os::parallelMemcpy(hsaBuffer, hostSrc + offset, size, true);
+      if (!copyChunk(chunk, hostDst + offset, dev().getBackendDevice(), hsaBuffer, srcAgent,
+                     size, engine)) {
+        waitAll();
         return false;
       }
-      gpu().Barriers().WaitCurrent();
       totalSize -= size;
       offset += size;
-      continue;
+      chunk = (chunk + 1) % numChunks;
     }
+  } else {
+    // Copy data from Device to Host. Keep all chunks busy with DMA and
+    // copy the oldest one to the host memory
+    size_t submitted = 0;
+    uint submitChunk = 0;
+    while (totalSize > 0) {
+      // Submit DMA into all free chunks
+      while ((submitted < size) && (busy[submitChunk].handle == 0)) {
+        size_t copySize = std::min(size - submitted, chunkSize);
+        // This workaround is needed for performance to get around the slowdown
+        // caused to SDMA engine powering down if its not active. Forcing agents
+        // to amdgpu device causes rocr to take blit path internally.
+        const hsa_agent_t dstAgent = (copySize <= dev().settings().sdmaCopyThreshold_) ?
+                                     dev().getBackendDevice() : dev().getCpuAgent();
+
+        HwQueueEngine engine = HwQueueEngine::Unknown;
+        if (dstAgent.handle == dev().getBackendDevice().handle) {
+          engine = HwQueueEngine::SdmaRead;
+        }
+        if (!copyChunk(submitChunk, staging + submitChunk * chunkSize, dstAgent,
+                       hostSrc + submitted, dev().getBackendDevice(), copySize, engine)) {
+          waitAll();
+          return false;
+        }
+        submitted += copySize;
+        submitChunk = (submitChunk + 1) % numChunks;
+      }
 
-    // This workaround is needed for performance to get around the slowdown
-    // caused to SDMA engine powering down if its not active. Forcing agents
-    // to amdgpu device causes rocr to take blit path internally.
-    const hsa_agent_t dstAgent =
-        (size <= dev().settings().sdmaCopyThreshold_) ? dev().getBackendDevice() : dev().getCpuAgent();
-
-    HwQueueEngine engine = HwQueueEngine::Unknown;
-    if (dstAgent.handle == dev().getBackendDevice().handle) {
-      engine = HwQueueEngine::SdmaRead;
+      size_t copySize = std::min(totalSize, chunkSize);
+      if (!waitChunk(chunk)) {
+        LogError("Staging chunk wait failed!");
+        waitAll();
+        return false;
+      }
+      amd::Os::parallelMemcpy(hostDst + offset, staging + chunk * chunkSize, copySize);
+      totalSize -= copySize;
+      offset += copySize;
+      chunk = (chunk + 1) % numChunks;
     }
-    gpu().Barriers().SetActiveEngine(engine);
-    hsa_signal_t active = gpu().Barriers().ActiveSignal(kInitSignalValueOne, gpu().timestamp());
+  }
 
-    // Copy data from Device to Host
-    ClPrint(amd::LOG_DEBUG, amd::LOG_COPY,
-            "[%zx]!\t HSA Async Copy completion_signal=0x%zx",
-            std::this_thread::get_id(), active.handle);
-    status = hsa_amd_memory_async_copy(hsaBuffer, dstAgent, hostSrc + offset,
-        dev().getBackendDevice(), size, 0, nullptr, active);
-    if (status == HSA_STATUS_SUCCESS) {
-      gpu().Barriers().WaitCurrent();
-      memcpy(hostDst + offset, hsaBuffer, size);
-    } else {
-      gpu().Barriers().ResetCurrentSignal();
-      LogPrintfError("Hsa copy from device to host failed with code %d", status);
-      return false;
-    }
-    totalSize -= size;
-    offset += size;
+  // Make sure all DMA are done, since the staging buffer can be reused right after the call
+  if (!waitAll()) {
+    LogError("Staging chunk wait failed!");
+    return false;
   }
 
   gpu().addSystemScope();
@@ -775,11 +1031,26 @@ bool DmaBlitManager::hsaCopyStaged(const_address hostSrc, address hostDst, size_
   return true;
 }
 
+//! The minimum size of the wide blits, the smaller ones are dominated by the launch
+static constexpr size_t kWideBlitMinSize = 64 * Ki;
+//! The size of the vector load and store in the wide blits
+static constexpr size_t kWideBlitAlignment = 16;
+//! The number of the vectors per lane in the wide blits
+static constexpr size_t kWideBlitElements = 4;
+//! The maximum number of the workgroups in the batch copy, each workgroup copies a region
+static constexpr size_t kBatchCopyMaxGroups = 1024;
+//! The size of a segment in the constant buffer ring
+static constexpr uint32_t kConstantSegmentSize = 4 * Ki;
+//! The number of the constant buffer segments on the ring creation
+static constexpr size_t kConstantSegments = 4;
+//! The maximum number of the constant buffer segments, if the ring grows
+static constexpr size_t kMaxConstantSegments = 32;
+
 // ================================================================================================
 KernelBlitManager::KernelBlitManager(VirtualGPU& gpu, Setup setup)
     : DmaBlitManager(gpu, setup),
       program_(nullptr),
-      constantBuffer_(nullptr),
+      constantSegmentId_(0),
       constantBufferOffset_(0),
       xferBufferSize_(0),
       lockXferOps_("Transfer Ops Lock", true) {
@@ -805,8 +1076,15 @@ KernelBlitManager::~KernelBlitManager() {
     context_->release();
   }
 
-  if (nullptr != constantBuffer_) {
-    constantBuffer_->release();
+  for (auto& segment : constantSegments_) {
+    if (segment.signal_ != nullptr) {
+      segment.signal_->release();
+    }
+    segment.buffer_->release();
+  }
+
+  for (const auto& entry : views_) {
+    entry.view_->owner()->release();
   }
 }
 
@@ -858,19 +1136,68 @@ bool KernelBlitManager::createProgram(Device& device) {
     result = true;
   } while (!result);
 
-  // Create an internal constant buffer
-  constantBuffer_ = new (*context_) amd::Buffer(*context_, CL_MEM_ALLOC_HOST_PTR, 4 * Ki);
-  // Assign the constant buffer to the current virtual GPU
-  constantBuffer_->setVirtualDevice(&gpu());
-  if ((constantBuffer_ != nullptr) && !constantBuffer_->create(nullptr)) {
-    constantBuffer_->release();
-    constantBuffer_ = nullptr;
+  // Create the internal constant buffer ring
+  for (size_t i = 0; i < kConstantSegments; ++i) {
+    if (!addConstantSegment(i)) {
+      return false;
+    }
+  }
+
+  return result;
+}
+
+// ================================================================================================
+bool KernelBlitManager::addConstantSegment(size_t position) const {
+  amd::Memory* buffer =
+      new (*context_) amd::Buffer(*context_, CL_MEM_ALLOC_HOST_PTR, kConstantSegmentSize);
+  if (buffer == nullptr) {
     return false;
-  } else if (constantBuffer_ == nullptr) {
+  }
+  // Assign the constant buffer to the current virtual GPU
+  buffer->setVirtualDevice(&gpu());
+  if (!buffer->create(nullptr)) {
+    buffer->release();
     return false;
   }
+  constantSegments_.insert(constantSegments_.begin() + position, {buffer, nullptr});
+  return true;
+}
 
-  return result;
+// ================================================================================================
+uint32_t KernelBlitManager::ConstantBufferOffset(amd::Memory** buffer) const {
+  // Make sure it can fit at least 128 bytes for OCL memory fill of double16
+  constexpr uint32_t kManagedSize = 0x80;
+  if ((constantBufferOffset_ + kManagedSize) > kConstantSegmentSize) {
+    // Retire the current segment with a marker of its last use
+    constantSegments_[constantSegmentId_].signal_ = gpu().retainMarkerSignal();
+
+    size_t next = (constantSegmentId_ + 1) % constantSegments_.size();
+    ConstantSegment* segment = &constantSegments_[next];
+    if ((segment->signal_ != nullptr) && (hsa_signal_load_relaxed(segment->signal_->signal_) > 0) &&
+        (constantSegments_.size() < kMaxConstantSegments)) {
+      // The oldest segment is still in use, hence grow the ring instead of a stall
+      if (addConstantSegment(constantSegmentId_ + 1)) {
+        next = constantSegmentId_ + 1;
+        segment = &constantSegments_[next];
+        ClPrint(amd::LOG_INFO, amd::LOG_COPY, "Blit constant ring grows to %zu segments",
+                constantSegments_.size());
+      }
+    }
+    if (segment->signal_ != nullptr) {
+      // Make sure GPU is done with the oldest segment
+      if (!WaitForSignal(segment->signal_->signal_, gpu().waitPolicy())) {
+        LogError("Blit constant segment wait failed");
+      }
+      segment->signal_->release();
+      segment->signal_ = nullptr;
+    }
+    constantSegmentId_ = next;
+    constantBufferOffset_ = 0;
+  }
+  uint32_t offset = constantBufferOffset_;
+  constantBufferOffset_ += kManagedSize;
+  *buffer = constantSegments_[constantSegmentId_].buffer_;
+  return offset;
 }
 
 // The following data structures will be used for the view creations.
@@ -906,9 +1233,6 @@ bool KernelBlitManager::copyBufferToImage(device::Memory& srcMemory, device::Mem
   static const bool CopyRect = false;
   // Flush DMA for ASYNC copy
   static const bool FlushDMA = true;
-  amd::Image* dstImage = static_cast<amd::Image*>(dstMemory.owner());
-  size_t imgRowPitch = size[0] * dstImage->getImageFormat().getElementSize();
-  size_t imgSlicePitch = imgRowPitch * size[1];
 
   if (setup_.disableCopyBufferToImage_) {
     result = HostBlitManager::copyBufferToImage(srcMemory, dstMemory, srcOrigin, dstOrigin, size,
@@ -916,19 +1240,13 @@ bool KernelBlitManager::copyBufferToImage(device::Memory& srcMemory, device::Mem
     synchronize();
     return result;
   }
-  // Check if buffer is in system memory with direct access
-  else if (srcMemory.isHostMemDirectAccess() &&
-           (((rowPitch == 0) && (slicePitch == 0)) ||
-            ((rowPitch == imgRowPitch) && ((slicePitch == 0) || (slicePitch == imgSlicePitch))))) {
-    // First attempt to do this all with DMA,
-    // but there are restriciton with older hardware
-    if (dev().settings().imageDMA_) {
-      result = DmaBlitManager::copyBufferToImage(srcMemory, dstMemory, srcOrigin, dstOrigin, size,
-                                                 entire, rowPitch, slicePitch);
-      if (result) {
-        synchronize();
-        return result;
-      }
+  // The linear images are transferred with SDMA, so the shaders are used only for the tiling
+  else if (dev().settings().imageDMA_ && (static_cast<Image&>(dstMemory).linearRowPitch() != 0)) {
+    result = copyLinearImage(srcMemory, dstMemory, srcOrigin, dstOrigin, size, rowPitch,
+                             slicePitch, true);
+    if (result) {
+      synchronize();
+      return result;
     }
   }
 
@@ -974,7 +1292,6 @@ bool KernelBlitManager::copyBufferToImageKernel(device::Memory& srcMemory,
                                                 size_t rowPitch, size_t slicePitch) const {
   bool rejected = false;
   Memory* dstView = &gpuMem(dstMemory);
-  bool releaseView = false;
   bool result = false;
   amd::Image* dstImage = static_cast<amd::Image*>(dstMemory.owner());
   amd::Image* srcImage = static_cast<amd::Image*>(srcMemory.owner());
@@ -1007,7 +1324,6 @@ bool KernelBlitManager::copyBufferToImageKernel(device::Memory& srcMemory,
     dstView = createView(gpuMem(dstMemory), newFormat, CL_MEM_WRITE_ONLY);
     if (dstView != nullptr) {
       rejected = false;
-      releaseView = true;
     }
   }
 
@@ -1103,11 +1419,6 @@ bool KernelBlitManager::copyBufferToImageKernel(device::Memory& srcMemory,
   address parameters = captureArguments(kernels_[blitType]);
   result = gpu().submitKernelInternal(ndrange, *kernels_[blitType], parameters, nullptr);
   releaseArguments(parameters);
-  if (releaseView) {
-    // todo SRD programming could be changed to avoid a stall
-    gpu().releaseGpuMemoryFence();
-    dstView->owner()->release();
-  }
 
   return result;
 }
@@ -1121,9 +1432,6 @@ bool KernelBlitManager::copyImageToBuffer(device::Memory& srcMemory, device::Mem
   static const bool CopyRect = false;
   // Flush DMA for ASYNC copy
   static const bool FlushDMA = true;
-  amd::Image* srcImage = static_cast<amd::Image*>(srcMemory.owner());
-  size_t imgRowPitch = size[0] * srcImage->getImageFormat().getElementSize();
-  size_t imgSlicePitch = imgRowPitch * size[1];
 
   if (setup_.disableCopyImageToBuffer_) {
     result = DmaBlitManager::copyImageToBuffer(srcMemory, dstMemory, srcOrigin, dstOrigin, size,
@@ -1131,21 +1439,13 @@ bool KernelBlitManager::copyImageToBuffer(device::Memory& srcMemory, device::Mem
     synchronize();
     return result;
   }
-  // Check if buffer is in system memory with direct access
-  else if (dstMemory.isHostMemDirectAccess() &&
-           (((rowPitch == 0) && (slicePitch == 0)) ||
-            ((rowPitch == imgRowPitch) && ((slicePitch == 0) || (slicePitch == imgSlicePitch))))) {
-    // First attempt to do this all with DMA,
-    // but there are restriciton with older hardware
-    // If the dest buffer is external physical(SDI), copy two step as
-    // single step SDMA is causing corruption and the cause is under investigation
-    if (dev().settings().imageDMA_) {
-      result = DmaBlitManager::copyImageToBuffer(srcMemory, dstMemory, srcOrigin, dstOrigin, size,
-                                                 entire, rowPitch, slicePitch);
-      if (result) {
-        synchronize();
-        return result;
-      }
+  // The linear images are transferred with SDMA, so the shaders are used only for the tiling
+  else if (dev().settings().imageDMA_ && (static_cast<Image&>(srcMemory).linearRowPitch() != 0)) {
+    result = copyLinearImage(dstMemory, srcMemory, dstOrigin, srcOrigin, size, rowPitch,
+                             slicePitch, false);
+    if (result) {
+      synchronize();
+      return result;
     }
   }
 
@@ -1167,7 +1467,6 @@ bool KernelBlitManager::copyImageToBufferKernel(device::Memory& srcMemory,
                                                 size_t rowPitch, size_t slicePitch) const {
   bool rejected = false;
   Memory* srcView = &gpuMem(srcMemory);
-  bool releaseView = false;
   bool result = false;
   amd::Image* srcImage = static_cast<amd::Image*>(srcMemory.owner());
   amd::Image::Format newFormat(srcImage->getImageFormat());
@@ -1199,7 +1498,6 @@ bool KernelBlitManager::copyImageToBufferKernel(device::Memory& srcMemory,
     srcView = createView(gpuMem(srcMemory), newFormat, CL_MEM_READ_ONLY);
     if (srcView != nullptr) {
       rejected = false;
-      releaseView = true;
     }
   }
 
@@ -1301,11 +1599,6 @@ bool KernelBlitManager::copyImageToBufferKernel(device::Memory& srcMemory,
   address parameters = captureArguments(kernels_[blitType]);
   result = gpu().submitKernelInternal(ndrange, *kernels_[blitType], parameters, nullptr);
   releaseArguments(parameters);
-  if (releaseView) {
-    // todo SRD programming could be changed to avoid a stall
-    gpu().releaseGpuMemoryFence();
-    srcView->owner()->release();
-  }
 
   return result;
 }
@@ -1317,7 +1610,6 @@ bool KernelBlitManager::copyImage(device::Memory& srcMemory, device::Memory& dst
   bool rejected = false;
   Memory* srcView = &gpuMem(srcMemory);
   Memory* dstView = &gpuMem(dstMemory);
-  bool releaseView = false;
   bool result = false;
   amd::Image* srcImage = static_cast<amd::Image*>(srcMemory.owner());
   amd::Image* dstImage = static_cast<amd::Image*>(dstMemory.owner());
@@ -1351,9 +1643,6 @@ bool KernelBlitManager::copyImage(device::Memory& srcMemory, device::Memory& dst
       dstView = createView(gpuMem(dstMemory), newFormat, CL_MEM_WRITE_ONLY);
       if (dstView != nullptr) {
         rejected = false;
-        releaseView = true;
-      } else {
-        delete srcView;
       }
     }
   }
@@ -1432,12 +1721,6 @@ bool KernelBlitManager::copyImage(device::Memory& srcMemory, device::Memory& dst
   address parameters = captureArguments(kernels_[blitType]);
   result = gpu().submitKernelInternal(ndrange, *kernels_[blitType], parameters, nullptr);
   releaseArguments(parameters);
-  if (releaseView) {
-    // todo SRD programming could be changed to avoid a stall
-    gpu().releaseGpuMemoryFence();
-    srcView->owner()->release();
-    dstView->owner()->release();
-  }
 
   synchronize();
 
@@ -1573,9 +1856,11 @@ bool KernelBlitManager::copyBufferRect(device::Memory& srcMemory, device::Memory
   bool result = false;
   bool rejected = false;
 
-  // Fall into the ROC path for rejected transfers
+  // Fall into the ROC path for rejected transfers. The rects, which would require DMA per row,
+  // are left to the kernel, since it handles any pitch in a single dispatch
   if (setup_.disableCopyBufferRect_ ||
-      srcMemory.isHostMemDirectAccess() || dstMemory.isHostMemDirectAccess()) {
+      ((srcMemory.isHostMemDirectAccess() || dstMemory.isHostMemDirectAccess()) &&
+       (isRectDmaCapable(srcRectIn, dstRectIn) || ((sizeIn[1] == 1) && (sizeIn[2] == 1))))) {
     result = DmaBlitManager::copyBufferRect(srcMemory, dstMemory, srcRectIn, dstRectIn, sizeIn, entire);
 
     if (result) {
@@ -1727,33 +2012,40 @@ bool KernelBlitManager::readBuffer(device::Memory& srcMemory, void* dstHost,
     synchronize();
     return result;
   } else {
+    bool measure = false;
+    const uint path = selectPageablePath(false, size[0], &measure);
+    const uint64_t start = (measure) ? beginPageableSample() : 0;
     size_t pinSize = size[0];
-    // Check if a pinned transfer can be executed with a single pin
-    if ((pinSize <= dev().settings().pinnedXferSize_) && (pinSize > MinSizeForPinnedTransfer)) {
+    if (path == Device::PageableXferModel::Direct) {
+      result = copyPageable(srcMemory, dstHost, origin[0], size[0], false);
+    } else if ((pinSize <= dev().settings().pinnedXferSize_) &&
+               (pinSize > MinSizeForPinnedTransfer)) {
+      // Check if a pinned transfer can be executed with a single pin
       size_t partial;
       amd::Memory* amdMemory = pinHostMemory(dstHost, pinSize, partial);
 
       if (amdMemory == nullptr) {
         // Force SW copy
         result = DmaBlitManager::readBuffer(srcMemory, dstHost, origin, size, entire);
-        synchronize();
-        return result;
-      }
-
-      // Readjust host mem offset
-      amd::Coord3D dstOrigin(partial);
+      } else {
+        // Readjust host mem offset
+        amd::Coord3D dstOrigin(partial);
 
-      // Get device memory for this virtual device
-      Memory* dstMemory = dev().getRocMemory(amdMemory);
+        // Get device memory for this virtual device
+        Memory* dstMemory = dev().getRocMemory(amdMemory);
 
-      // Copy image to buffer
-      result = copyBuffer(srcMemory, *dstMemory, origin, dstOrigin, size, entire);
+        // Copy image to buffer
+        result = copyBuffer(srcMemory, *dstMemory, origin, dstOrigin, size, entire);
 
-      // Add pinned memory for a later release
-      gpu().addPinnedMem(amdMemory);
+        // Add pinned memory for a later release
+        gpu().addPinnedMem(amdMemory);
+      }
     } else {
       result = DmaBlitManager::readBuffer(srcMemory, dstHost, origin, size, entire);
     }
+    if (measure && result) {
+      endPageableSample(false, size[0], path, start);
+    }
   }
 
   synchronize();
@@ -1761,6 +2053,69 @@ bool KernelBlitManager::readBuffer(device::Memory& srcMemory, void* dstHost,
   return result;
 }
 
+// ================================================================================================
+uint KernelBlitManager::selectPageablePath(bool write, size_t size, bool* measure) const {
+  Device::PageableXferModel* model = dev().pageableXferModel();
+  if ((model == nullptr) || !model->fits(size)) {
+    *measure = false;
+    return Device::PageableXferModel::Staged;
+  }
+  return model->select(write, size, measure);
+}
+
+// ================================================================================================
+uint64_t KernelBlitManager::beginPageableSample() const {
+  // Exclude the earlier work of the queue from the sample
+  gpu().releaseGpuMemoryFence();
+  return amd::Os::timeNanos();
+}
+
+// ================================================================================================
+void KernelBlitManager::endPageableSample(bool write, size_t size, uint path,
+                                          uint64_t start) const {
+  gpu().releaseGpuMemoryFence();
+  dev().pageableXferModel()->update(write, size,
+                                    static_cast<Device::PageableXferModel::Path>(path),
+                                    amd::Os::timeNanos() - start);
+}
+
+// ================================================================================================
+bool KernelBlitManager::copyPageable(device::Memory& memory, void* host, size_t origin,
+                                     size_t size, bool write) const {
+  amd::Kernel* kernel = kernels_[BlitCopyBuffer];
+  // The unaligned copy works on uints and copies the remaining bytes at the end
+  const uint32_t remain = size % 4;
+  const uint64_t copySize = size / 4 + 1;
+  size_t globalWorkOffset[3] = {0, 0, 0};
+  size_t localWorkSize = 256;
+  size_t globalWorkSize = amd::alignUp(copySize, localWorkSize);
+
+  const size_t devIndex = (write) ? 1 : 0;
+  const size_t hostIndex = (write) ? 0 : 1;
+  cl_mem mem = as_cl<amd::Memory>(memory.owner());
+  setArgument(kernel, devIndex, sizeof(cl_mem), &mem);
+  // The pageable side doesn't have a memory object, hence the raw pointer replaces the null
+  // object. GPU accesses the pages through HMM and XNACK replays the faults
+  setArgument(kernel, hostIndex, sizeof(cl_mem), nullptr);
+  const amd::KernelParameterDescriptor& desc = kernel->signature().at(hostIndex);
+  *reinterpret_cast<uint64_t*>(kernel->parameters().values() + desc.offset_) =
+      reinterpret_cast<uint64_t>(host);
+  uint64_t srcOffset = (write) ? 0 : origin;
+  setArgument(kernel, 2, sizeof(srcOffset), &srcOffset);
+  uint64_t dstOffset = (write) ? origin : 0;
+  setArgument(kernel, 3, sizeof(dstOffset), &dstOffset);
+  setArgument(kernel, 4, sizeof(copySize), &copySize);
+  setArgument(kernel, 5, sizeof(remain), &remain);
+
+  // The system scope keeps the host pages coherent with the kernel
+  gpu().addSystemScope();
+  amd::NDRangeContainer ndrange(1, globalWorkOffset, &globalWorkSize, &localWorkSize);
+  address parameters = captureArguments(kernel);
+  bool result = gpu().submitKernelInternal(ndrange, *kernel, parameters, nullptr);
+  releaseArguments(parameters);
+  return result;
+}
+
 // ================================================================================================
 bool KernelBlitManager::readBufferRect(device::Memory& srcMemory, void* dstHost,
                                        const amd::BufferRect& bufRect,
@@ -1818,17 +2173,8 @@ bool KernelBlitManager::writeBuffer(const void* srcHost, device::Memory& dstMemo
   amd::ScopedLock k(lockXferOps_);
   bool result = false;
 
-  if (dev().info().largeBar_ && size[0] <= kMaxH2dMemcpySize) {
-    if ((dstMemory.owner()->getHostMem() == nullptr) && (dstMemory.owner()->getSvmPtr() != nullptr)) {
-      // CPU read ahead, hence release GPU memory
-      gpu().releaseGpuMemoryFence();
-      char* dst = reinterpret_cast<char*>(dstMemory.owner()->getSvmPtr());
-      std::memcpy(dst + origin[0], srcHost, size[0]);
-      // Set hasPendingDispatch_ flag. Then releaseGpuMemoryFence() will use barrier to invalidate cache
-      gpu().hasPendingDispatch();
-      gpu().releaseGpuMemoryFence();
-      return true;
-    }
+  if (writeLargeBar(srcHost, dstMemory, origin, size)) {
+    return true;
   }
 
   // Use host copy if memory has direct access
@@ -1837,37 +2183,48 @@ bool KernelBlitManager::writeBuffer(const void* srcHost, device::Memory& dstMemo
     // Stall GPU before CPU access
     gpu().releaseGpuMemoryFence();
     result = HostBlitManager::writeBuffer(srcHost, dstMemory, origin, size, entire);
+    if (gpuMem(dstMemory).IsPersistentDirectMap()) {
+      // CPU wrote the device memory over BAR
+      gpu().addHdpFlush();
+    }
     synchronize();
     return result;
   } else {
+    bool measure = false;
+    const uint path = selectPageablePath(true, size[0], &measure);
+    const uint64_t start = (measure) ? beginPageableSample() : 0;
     size_t pinSize = size[0];
 
-    // Check if a pinned transfer can be executed with a single pin
-    if ((pinSize <= dev().settings().pinnedXferSize_) && (pinSize > MinSizeForPinnedTransfer)) {
+    if (path == Device::PageableXferModel::Direct) {
+      result = copyPageable(dstMemory, const_cast<void*>(srcHost), origin[0], size[0], true);
+    } else if ((pinSize <= dev().settings().pinnedXferSize_) &&
+               (pinSize > MinSizeForPinnedTransfer)) {
+      // Check if a pinned transfer can be executed with a single pin
       size_t partial;
       amd::Memory* amdMemory = pinHostMemory(srcHost, pinSize, partial);
 
       if (amdMemory == nullptr) {
         // Force SW copy
         result = DmaBlitManager::writeBuffer(srcHost, dstMemory, origin, size, entire);
-        synchronize();
-        return result;
-      }
-
-      // Readjust destination offset
-      const amd::Coord3D srcOrigin(partial);
+      } else {
+        // Readjust destination offset
+        const amd::Coord3D srcOrigin(partial);
 
-      // Get device memory for this virtual device
-      Memory* srcMemory = dev().getRocMemory(amdMemory);
+        // Get device memory for this virtual device
+        Memory* srcMemory = dev().getRocMemory(amdMemory);
 
-      // Copy buffer rect
-      result = copyBuffer(*srcMemory, dstMemory, srcOrigin, origin, size, entire);
+        // Copy buffer rect
+        result = copyBuffer(*srcMemory, dstMemory, srcOrigin, origin, size, entire);
 
-      // Add pinned memory for a later release
-      gpu().addPinnedMem(amdMemory);
+        // Add pinned memory for a later release
+        gpu().addPinnedMem(amdMemory);
+      }
     } else {
       result = DmaBlitManager::writeBuffer(srcHost, dstMemory, origin, size, entire);
     }
+    if (measure && result) {
+      endPageableSample(true, size[0], path, start);
+    }
   }
 
   synchronize();
@@ -1935,6 +2292,8 @@ bool KernelBlitManager::fillBuffer(device::Memory& memory, const void* pattern,
   amd::ScopedLock k(lockXferOps_);
   bool result = false;
 
+  const uint64_t fillAddr =
+      reinterpret_cast<uint64_t>(gpuMem(memory).getDeviceMemory()) + origin[0];
   // Use host fill if memory has direct access
   if (setup_.disableFillBuffer_ || (!forceBlit && memory.isHostMemDirectAccess())) {
     // Stall GPU before CPU access
@@ -1942,6 +2301,11 @@ bool KernelBlitManager::fillBuffer(device::Memory& memory, const void* pattern,
     result = HostBlitManager::fillBuffer(memory, pattern, patternSize, origin, size, entire);
     synchronize();
     return result;
+  } else if ((kernels_[FillBufferWide] != nullptr) && (size[0] >= kWideBlitMinSize) &&
+             ((kWideBlitAlignment % patternSize) == 0) && ((fillAddr % patternSize) == 0)) {
+    result = fillBufferWide(memory, pattern, patternSize, origin[0], size[0],
+                            (kWideBlitAlignment - (fillAddr % kWideBlitAlignment)) %
+                            kWideBlitAlignment);
   } else {
     uint fillType = FillBuffer;
     size_t globalWorkOffset[3] = {0, 0, 0};
@@ -1950,42 +2314,38 @@ bool KernelBlitManager::fillBuffer(device::Memory& memory, const void* pattern,
     size_t localWorkSize = 256;
     bool dwordAligned = ((patternSize % sizeof(uint32_t)) == 0) ? true : false;
 
-    // Program kernels arguments for the fill operation
-    cl_mem mem = as_cl<amd::Memory>(memory.owner());
-    if (dwordAligned) {
-      setArgument(kernels_[fillType], 0, sizeof(cl_mem), nullptr);
-      setArgument(kernels_[fillType], 1, sizeof(cl_mem), &mem);
-    } else {
-      setArgument(kernels_[fillType], 0, sizeof(cl_mem), &mem);
-      setArgument(kernels_[fillType], 1, sizeof(cl_mem), nullptr);
-    }
-    Memory* gpuCB = dev().getRocMemory(constantBuffer_);
+    // Find a slot in the constant buffer ring to allow multiple fills in flight
+    amd::Memory* constBuffer = nullptr;
+    uint32_t constBufOffset = ConstantBufferOffset(&constBuffer);
+    Memory* gpuCB = dev().getRocMemory(constBuffer);
     if (gpuCB == nullptr) {
       return false;
     }
-    // Find offset in the current constant buffer to allow multipel fills
-    uint32_t  constBufOffset = ConstantBufferOffset();
-    auto constBuf = reinterpret_cast<address>(constantBuffer_->getHostMem()) + constBufOffset;
+    auto constBuf = reinterpret_cast<address>(constBuffer->getHostMem()) + constBufOffset;
     memcpy(constBuf, pattern, patternSize);
 
-    mem = as_cl<amd::Memory>(gpuCB->owner());
-    setArgument(kernels_[fillType], 2, sizeof(cl_mem), &mem, constBufOffset);
     uint64_t offset = origin[0];
+    uint32_t patternLength = static_cast<uint32_t>(patternSize);
     if (dwordAligned) {
-      patternSize /= sizeof(uint32_t);
+      patternLength /= sizeof(uint32_t);
       offset /= sizeof(uint32_t);
     }
-    setArgument(kernels_[fillType], 3, sizeof(uint32_t), &patternSize);
-    setArgument(kernels_[fillType], 4, sizeof(offset), &offset);
-    setArgument(kernels_[fillType], 5, sizeof(fillSize), &fillSize);
+
+    // Program kernels arguments for the fill operation
+    Memory* fillMem = &gpuMem(memory);
+    const BlitArg args[] = {
+        {nullptr, 0, dwordAligned ? nullptr : fillMem, 0},
+        {nullptr, 0, dwordAligned ? fillMem : nullptr, 0},
+        {nullptr, 0, gpuCB, constBufOffset},
+        {&patternLength, sizeof(patternLength), nullptr, 0},
+        {&offset, sizeof(offset), nullptr, 0},
+        {&fillSize, sizeof(fillSize), nullptr, 0}};
 
     // Create ND range object for the kernel's execution
     amd::NDRangeContainer ndrange(1, globalWorkOffset, &globalWorkSize, &localWorkSize);
 
     // Execute the blit
-    address parameters = captureArguments(kernels_[fillType]);
-    result = gpu().submitKernelInternal(ndrange, *kernels_[fillType], parameters, nullptr);
-    releaseArguments(parameters);
+    result = launchBlit(kernels_[fillType], ndrange, args, sizeof(args) / sizeof(args[0]));
   }
 
   synchronize();
@@ -1993,6 +2353,86 @@ bool KernelBlitManager::fillBuffer(device::Memory& memory, const void* pattern,
   return result;
 }
 
+// ================================================================================================
+bool KernelBlitManager::copyBufferWide(device::Memory& srcMemory, device::Memory& dstMemory,
+                                       uint64_t srcOrigin, uint64_t dstOrigin, uint64_t size,
+                                       uint64_t head) const {
+  amd::Kernel* kernel = kernels_[BlitCopyBufferWide];
+  size_t globalWorkOffset[3] = {0, 0, 0};
+  // Each lane copies a few 16 byte elements, the first lanes copy the head and the tail bytes
+  size_t globalWorkSize = amd::alignUp(
+      std::max(((size - head) / kWideBlitAlignment) / kWideBlitElements, kWideBlitAlignment),
+      256);
+  size_t localWorkSize = 256;
+
+  const BlitArg args[] = {
+      {nullptr, 0, &gpuMem(srcMemory), 0},
+      {nullptr, 0, &gpuMem(dstMemory), 0},
+      {&srcOrigin, sizeof(srcOrigin), nullptr, 0},
+      {&dstOrigin, sizeof(dstOrigin), nullptr, 0},
+      {&size, sizeof(size), nullptr, 0},
+      {&head, sizeof(head), nullptr, 0}};
+
+  amd::NDRangeContainer ndrange(1, globalWorkOffset, &globalWorkSize, &localWorkSize);
+  return launchBlit(kernel, ndrange, args, sizeof(args) / sizeof(args[0]));
+}
+
+// ================================================================================================
+bool KernelBlitManager::fillBufferWide(device::Memory& memory, const void* pattern,
+                                       size_t patternSize, uint64_t origin, uint64_t size,
+                                       uint64_t head) const {
+  amd::Kernel* kernel = kernels_[FillBufferWide];
+  size_t globalWorkOffset[3] = {0, 0, 0};
+  size_t globalWorkSize = amd::alignUp(
+      std::max(((size - head) / kWideBlitAlignment) / kWideBlitElements, kWideBlitAlignment),
+      256);
+  size_t localWorkSize = 256;
+
+  // Expand the pattern to 16 bytes, so each lane stores the whole vector
+  uint8_t wide[kWideBlitAlignment];
+  for (size_t i = 0; i < kWideBlitAlignment; i += patternSize) {
+    memcpy(wide + i, pattern, patternSize);
+  }
+
+  const BlitArg args[] = {
+      {nullptr, 0, &gpuMem(memory), 0},
+      {wide, sizeof(wide), nullptr, 0},
+      {&origin, sizeof(origin), nullptr, 0},
+      {&size, sizeof(size), nullptr, 0},
+      {&head, sizeof(head), nullptr, 0}};
+
+  amd::NDRangeContainer ndrange(1, globalWorkOffset, &globalWorkSize, &localWorkSize);
+  return launchBlit(kernel, ndrange, args, sizeof(args) / sizeof(args[0]));
+}
+
+// ================================================================================================
+bool KernelBlitManager::copyBufferBatch(device::Memory& srcMemory, device::Memory& dstMemory,
+                                        const uint64_t* regions, uint count) const {
+  amd::ScopedLock k(lockXferOps_);
+  amd::Kernel* kernel = kernels_[BlitCopyBufferBatch];
+  const size_t maxGroups = kBatchCopyMaxGroups;
+  size_t globalWorkOffset[3] = {0, 0, 0};
+  size_t localWorkSize = 256;
+  size_t globalWorkSize = std::min(static_cast<size_t>(count), maxGroups) * localWorkSize;
+
+  cl_mem mem = as_cl<amd::Memory>(srcMemory.owner());
+  setArgument(kernel, 0, sizeof(cl_mem), &mem);
+  mem = as_cl<amd::Memory>(dstMemory.owner());
+  setArgument(kernel, 1, sizeof(cl_mem), &mem);
+  // The descriptors don't have a memory object, hence the raw pointer replaces the null object
+  setArgument(kernel, 2, sizeof(cl_mem), nullptr);
+  const amd::KernelParameterDescriptor& desc = kernel->signature().at(2);
+  *reinterpret_cast<uint64_t*>(kernel->parameters().values() + desc.offset_) =
+      reinterpret_cast<uint64_t>(regions);
+  setArgument(kernel, 3, sizeof(count), &count);
+
+  amd::NDRangeContainer ndrange(1, globalWorkOffset, &globalWorkSize, &localWorkSize);
+  address parameters = captureArguments(kernel);
+  bool result = gpu().submitKernelInternal(ndrange, *kernel, parameters, nullptr);
+  releaseArguments(parameters);
+  return result;
+}
+
 // ================================================================================================
 bool KernelBlitManager::copyBuffer(device::Memory& srcMemory, device::Memory& dstMemory,
                                    const amd::Coord3D& srcOrigin, const amd::Coord3D& dstOrigin,
@@ -2000,8 +2440,20 @@ bool KernelBlitManager::copyBuffer(device::Memory& srcMemory, device::Memory& ds
   amd::ScopedLock k(lockXferOps_);
   bool result = false;
   bool p2p = (&gpuMem(srcMemory).dev() != &gpuMem(dstMemory).dev());
-  if (setup_.disableHwlCopyBuffer_ ||
-      (!srcMemory.isHostMemDirectAccess() && !dstMemory.isHostMemDirectAccess() && !p2p)) {
+  const bool kernelCopy = setup_.disableHwlCopyBuffer_ ||
+      (!srcMemory.isHostMemDirectAccess() && !dstMemory.isHostMemDirectAccess() && !p2p);
+  const uint64_t srcAddr =
+      reinterpret_cast<uint64_t>(gpuMem(srcMemory).getDeviceMemory()) + srcOrigin[0];
+  const uint64_t dstAddr =
+      reinterpret_cast<uint64_t>(gpuMem(dstMemory).getDeviceMemory()) + dstOrigin[0];
+  // The wide copy requires the same misalignment of both sides, so the body is aligned
+  if (kernelCopy && (kernels_[BlitCopyBufferWide] != nullptr) &&
+      (sizeIn[0] >= kWideBlitMinSize) &&
+      ((srcAddr % kWideBlitAlignment) == (dstAddr % kWideBlitAlignment))) {
+    result = copyBufferWide(srcMemory, dstMemory, srcOrigin[0], dstOrigin[0], sizeIn[0],
+                            (kWideBlitAlignment - (dstAddr % kWideBlitAlignment)) %
+                            kWideBlitAlignment);
+  } else if (kernelCopy) {
     uint blitType = BlitCopyBuffer;
     size_t dim = 1;
     size_t globalWorkOffset[3] = {0, 0, 0};
@@ -2043,36 +2495,27 @@ bool KernelBlitManager::copyBuffer(device::Memory& srcMemory, device::Memory& ds
     localWorkSize = 256;
     globalWorkSize = amd::alignUp(size[0], 256);
 
-    // Program kernels arguments for the blit operation
-    cl_mem mem = as_cl<amd::Memory>(srcMemory.owner());
-    setArgument(kernels_[blitType], 0, sizeof(cl_mem), &mem);
-    mem = as_cl<amd::Memory>(dstMemory.owner());
-    setArgument(kernels_[blitType], 1, sizeof(cl_mem), &mem);
-    // Program source origin
+    // Program source and destinaiton origins
     uint64_t srcOffset = srcOrigin[0] / CopyBuffAlignment[i];
-    setArgument(kernels_[blitType], 2, sizeof(srcOffset), &srcOffset);
-
-    // Program destinaiton origin
     uint64_t dstOffset = dstOrigin[0] / CopyBuffAlignment[i];
-    setArgument(kernels_[blitType], 3, sizeof(dstOffset), &dstOffset);
-
     uint64_t copySize = size[0];
-    setArgument(kernels_[blitType], 4, sizeof(copySize), &copySize);
+    int32_t alignment = CopyBuffAlignment[i];
 
-    if (blitType == BlitCopyBufferAligned) {
-      int32_t alignment = CopyBuffAlignment[i];
-      setArgument(kernels_[blitType], 5, sizeof(alignment), &alignment);
-    } else {
-      setArgument(kernels_[blitType], 5, sizeof(remain), &remain);
-    }
+    // Program kernels arguments for the blit operation
+    const BlitArg args[] = {
+        {nullptr, 0, &gpuMem(srcMemory), 0},
+        {nullptr, 0, &gpuMem(dstMemory), 0},
+        {&srcOffset, sizeof(srcOffset), nullptr, 0},
+        {&dstOffset, sizeof(dstOffset), nullptr, 0},
+        {&copySize, sizeof(copySize), nullptr, 0},
+        (blitType == BlitCopyBufferAligned) ? BlitArg{&alignment, sizeof(alignment), nullptr, 0}
+                                            : BlitArg{&remain, sizeof(remain), nullptr, 0}};
 
     // Create ND range object for the kernel's execution
     amd::NDRangeContainer ndrange(1, globalWorkOffset, &globalWorkSize, &localWorkSize);
 
     // Execute the blit
-    address parameters = captureArguments(kernels_[blitType]);
-    result = gpu().submitKernelInternal(ndrange, *kernels_[blitType], parameters, nullptr);
-    releaseArguments(parameters);
+    result = launchBlit(kernels_[blitType], ndrange, args, sizeof(args) / sizeof(args[0]));
   } else {
     if (amd::IS_HIP) {
       // Update the command type for ROC profiler
@@ -2126,7 +2569,6 @@ bool KernelBlitManager::fillImage(device::Memory& memory, const void* pattern,
   uint32_t iFillColor[4];
 
   bool rejected = false;
-  bool releaseView = false;
 
   // For depth, we need to create a view
   if (newFormat.image_channel_order == CL_sRGBA) {
@@ -2162,7 +2604,6 @@ bool KernelBlitManager::fillImage(device::Memory& memory, const void* pattern,
     memView = createView(gpuMem(memory), newFormat, CL_MEM_WRITE_ONLY);
     if (memView != nullptr) {
       rejected = false;
-      releaseView = true;
     }
   }
 
@@ -2253,11 +2694,6 @@ bool KernelBlitManager::fillImage(device::Memory& memory, const void* pattern,
   address parameters = captureArguments(kernels_[fillType]);
   result = gpu().submitKernelInternal(ndrange, *kernels_[fillType], parameters, nullptr);
   releaseArguments(parameters);
-  if (releaseView) {
-    // todo SRD programming could be changed to avoid a stall
-    gpu().releaseGpuMemoryFence();
-    memView->owner()->release();
-  }
 
   synchronize();
 
@@ -2283,9 +2719,22 @@ amd::Memory* DmaBlitManager::pinHostMemory(const void* hostMem, size_t pinSize,
   amdMemory = gpu().findPinnedMem(tmpHost, pinAllocSize);
 
   if (nullptr != amdMemory) {
+    // addPinnedMem() takes the ownership of the returned reference
+    amdMemory->retain();
     return amdMemory;
   }
 
+  // Check the device cache of pinned memory, which can return a larger range
+  Device::PinnedMemCache* cache = dev().pinnedMemCache();
+  if (cache != nullptr) {
+    size_t offset = 0;
+    amdMemory = cache->find(hostMem, pinSize, &offset);
+    if (nullptr != amdMemory) {
+      partial = offset;
+      return amdMemory;
+    }
+  }
+
   amdMemory = new (*context_) amd::Buffer(*context_, CL_MEM_USE_HOST_PTR, pinAllocSize);
   amdMemory->setVirtualDevice(&gpu());
   if ((amdMemory != nullptr) && !amdMemory->create(tmpHost, SysMem)) {
@@ -2301,6 +2750,9 @@ amd::Memory* DmaBlitManager::pinHostMemory(const void* hostMem, size_t pinSize,
   if (srcMemory == nullptr) {
     // Release all pinned memory and attempt pinning again
     gpu().releasePinnedMem();
+    if (cache != nullptr) {
+      cache->invalidate(nullptr, std::numeric_limits<size_t>::max());
+    }
     srcMemory = dev().getRocMemory(amdMemory);
     if (srcMemory == nullptr) {
       // Release memory
@@ -2309,12 +2761,28 @@ amd::Memory* DmaBlitManager::pinHostMemory(const void* hostMem, size_t pinSize,
     }
   }
 
+  if ((amdMemory != nullptr) && (cache != nullptr)) {
+    cache->insert(amdMemory);
+  }
+
   return amdMemory;
 }
 
 Memory* KernelBlitManager::createView(const Memory& parent, cl_image_format format,
                                       cl_mem_flags flags) const {
   assert((parent.owner()->asBuffer() == nullptr) && "View supports images only");
+  releaseOrphanViews();
+
+  // Check if the view was already created for the parent
+  for (auto it = views_.begin(); it != views_.end(); ++it) {
+    if ((it->parent_ == parent.owner()) && (it->flags_ == flags) &&
+        (it->format_.image_channel_order == format.image_channel_order) &&
+        (it->format_.image_channel_data_type == format.image_channel_data_type)) {
+      views_.splice(views_.begin(), views_, it);
+      return it->view_;
+    }
+  }
+
   amd::Image* parentImage = static_cast<amd::Image*>(parent.owner());
   amd::Image* image =
       parentImage->createView(parent.owner()->getContext(), format, &gpu(), 0, flags);
@@ -2340,9 +2808,47 @@ Memory* KernelBlitManager::createView(const Memory& parent, cl_image_format form
 
   image->replaceDeviceMemory(&dev_, devImage);
 
+  // Evict the least recently used view
+  if (views_.size() >= kMaxCachedViews) {
+    releaseView(views_.back().view_);
+  }
+  views_.push_front({parent.owner(), format, flags, devImage});
+
   return devImage;
 }
 
+// ================================================================================================
+void KernelBlitManager::releaseOrphanViews() const {
+  // A view holds a reference to the parent, hence the parent is released by the application,
+  // when all references belong to the cached views
+  std::vector<Memory*> orphans;
+  for (const auto& entry : views_) {
+    uint views = 0;
+    for (const auto& other : views_) {
+      views += (other.parent_ == entry.parent_) ? 1 : 0;
+    }
+    if (entry.parent_->referenceCount() == views) {
+      orphans.push_back(entry.view_);
+    }
+  }
+  for (auto view : orphans) {
+    releaseView(view);
+  }
+}
+
+// ================================================================================================
+void KernelBlitManager::releaseView(Memory* view) const {
+  // todo SRD programming could be changed to avoid a stall
+  gpu().releaseGpuMemoryFence();
+  for (auto it = views_.begin(); it != views_.end(); ++it) {
+    if (it->view_ == view) {
+      views_.erase(it);
+      break;
+    }
+  }
+  view->owner()->release();
+}
+
 address KernelBlitManager::captureArguments(const amd::Kernel* kernel) const {
   return kernel->parameters().values();
 }
@@ -2350,11 +2856,34 @@ address KernelBlitManager::captureArguments(const amd::Kernel* kernel) const {
 void KernelBlitManager::releaseArguments(address args) const {
 }
 
+// ================================================================================================
+bool KernelBlitManager::launchBlit(amd::Kernel* kernel, const amd::NDRangeContainer& ndrange,
+                                   const BlitArg* args, uint numArgs) const {
+  if (gpu().canSubmitBlitKernel(*kernel, ndrange)) {
+    return gpu().submitBlitKernel(*kernel, ndrange, args, numArgs);
+  }
+
+  for (uint i = 0; i < numArgs; ++i) {
+    if (args[i].value_ != nullptr) {
+      setArgument(kernel, i, args[i].size_, args[i].value_);
+    } else if (args[i].memory_ != nullptr) {
+      cl_mem mem = as_cl<amd::Memory>(args[i].memory_->owner());
+      setArgument(kernel, i, sizeof(cl_mem), &mem, static_cast<uint32_t>(args[i].offset_));
+    } else {
+      setArgument(kernel, i, sizeof(cl_mem), nullptr);
+    }
+  }
+  address parameters = captureArguments(kernel);
+  bool result = gpu().submitKernelInternal(ndrange, *kernel, parameters, nullptr);
+  releaseArguments(parameters);
+  return result;
+}
+
 // ================================================================================================
 bool KernelBlitManager::runScheduler(uint64_t vqVM, amd::Memory* schedulerParam,
                                      hsa_queue_t* schedulerQueue,
                                      hsa_signal_t& schedulerSignal,
-                                     uint threads) {
+                                     uint threads, bool wait) {
   size_t globalWorkOffset[1] = {0};
   size_t globalWorkSize[1] = {threads};
   size_t localWorkSize[1] = {1};
@@ -2364,6 +2893,12 @@ bool KernelBlitManager::runScheduler(uint64_t vqVM, amd::Memory* schedulerParam,
   device::Kernel* devKernel = const_cast<device::Kernel*>(kernels_[Scheduler]->getDeviceKernel(dev()));
   Kernel& gpuKernel = static_cast<Kernel&>(*devKernel);
 
+  // The parameters and the child queue are shared, so the previous scheduler must finish
+  if (!WaitForSignal(schedulerSignal)) {
+    LogWarning("Failed schedulerSignal wait");
+    return false;
+  }
+
   SchedulerParam* sp = reinterpret_cast<SchedulerParam*>(schedulerParam->getHostMem());
   memset(sp, 0, sizeof(SchedulerParam));
 
@@ -2413,7 +2948,7 @@ bool KernelBlitManager::runScheduler(uint64_t vqVM, amd::Memory* schedulerParam,
   }
   releaseArguments(parameters);
 
-  if (!WaitForSignal(schedulerSignal)) {
+  if (wait && !WaitForSignal(schedulerSignal)) {
     LogWarning("Failed schedulerSignal wait");
     return false;
   }
@@ -27,6 +27,7 @@
 #include "device/blit.hpp"
 #include "device/rocm/rocdefs.hpp"
 #include "device/rocm/rocsched.hpp"
+#include <list>
 
 /*! \addtogroup ROC Blit Implementation
  *  @{
@@ -38,6 +39,7 @@ namespace roc {
 class Device;
 class Kernel;
 class Memory;
+class ProfilingSignal;
 class VirtualGPU;
 
 //! DMA Blit Manager
@@ -159,8 +161,9 @@ class DmaBlitManager : public device::HostBlitManager {
 
  protected:
   static constexpr uint MaxPinnedBuffers = 4;
-  static constexpr size_t kMaxH2dMemcpySize = 8 * Ki;
   static constexpr size_t kMaxD2hMemcpySize = 64; //!< 1 cacheline
+  static constexpr uint MaxStagedChunks = 4;       //!< Max pipeline depth of a staged copy
+  static constexpr size_t MinStagedChunkSize = 64 * Ki;  //!< Min chunk size of a staged copy
 
   //! Synchronizes the blit operations if necessary
   inline void synchronize() const;
@@ -173,6 +176,14 @@ class DmaBlitManager : public device::HostBlitManager {
 
   inline Memory& gpuMem(device::Memory& mem) const;
 
+  //! Writes the buffer directly with CPU over the large BAR. Returns FALSE if the memory
+  //! isn't CPU visible or the size is over the direct write threshold
+  bool writeLargeBar(const void* srcHost,         //!< Source host memory
+                     device::Memory& dstMemory,   //!< Destination memory object
+                     const amd::Coord3D& origin,  //!< Destination origin
+                     const amd::Coord3D& size     //!< Size of the copy region
+                     ) const;
+
   //! Pins host memory for GPU access
   amd::Memory* pinHostMemory(const void* hostMem,  //!< Host memory pointer
                              size_t pinSize,       //!< Host memory size
@@ -185,6 +196,18 @@ class DmaBlitManager : public device::HostBlitManager {
                const amd::Coord3D& dstOrigin, const amd::Coord3D& size, bool enableCopyRect = false,
                bool flushDMA = true) const;
 
+  //! Transfers a region between a buffer and a linear image with the DMA rect copy.
+  //! Returns FALSE if the image is tiled or the layout isn't DMA capable
+  bool copyLinearImage(device::Memory& bufferMemory,      //!< Buffer memory object
+                       device::Memory& imageMemory,       //!< Image memory object
+                       const amd::Coord3D& bufferOrigin,  //!< Buffer origin
+                       const amd::Coord3D& imageOrigin,   //!< Image origin
+                       const amd::Coord3D& size,          //!< Size of the copy region
+                       size_t rowPitch,                   //!< Row pitch for the buffer
+                       size_t slicePitch,                 //!< Slice pitch for the buffer
+                       bool toImage                       //!< Copy from the buffer to the image
+                       ) const;
+
   const size_t MinSizeForPinnedTransfer;
   bool completeOperation_;  //!< DMA blit manager must complete operation
   amd::Context* context_;   //!< A dummy context
@@ -224,6 +247,17 @@ class DmaBlitManager : public device::HostBlitManager {
                      address staging,        //!< Staging resource
                      bool hostToDev          //!< True if data is copied from Host To Device
                      ) const;
+
+  //! Transfers a rect between the host and the device memory with the staging buffer.
+  //! The rows are packed into the staging buffer, so a batch of rows needs a single DMA
+  bool hsaCopyRectStaged(address device,                   //!< Device memory
+                         const amd::BufferRect& devRect,   //!< Rect in the device memory
+                         address host,                     //!< Host memory
+                         const amd::BufferRect& hostRect,  //!< Rect in the host memory
+                         const amd::Coord3D& size,         //!< Size of the rect in bytes
+                         Memory& xferBuf,                  //!< Staging resource
+                         bool hostToDev  //!< True if data is copied from Host To Device
+                         ) const;
 };
 
 //! Kernel Blit Manager
@@ -240,6 +274,10 @@ class KernelBlitManager : public DmaBlitManager {
     BlitCopyBufferAligned,
     FillBuffer,
     FillImage,
+    BlitCopyBufferWide,
+    FillBufferWide,
+    BlitCopyBufferBatch,
+    BlitPatchDispatch,
     Scheduler,
     GwsInit,
     BlitTotal
@@ -377,11 +415,25 @@ class KernelBlitManager : public DmaBlitManager {
                          bool entire = false          //!< Entire buffer will be updated
                          ) const;
 
+  //! Returns TRUE if the batch copy kernel is available
+  bool hasBatchCopy() const { return kernels_[BlitCopyBufferBatch] != nullptr; }
+
+  //! Returns the kernel, which publishes the dispatch packets of the indirect launches
+  amd::Kernel* patchDispatchKernel() const { return kernels_[BlitPatchDispatch]; }
+
+  //! Copies the regions between two buffers with a single dispatch
+  bool copyBufferBatch(device::Memory& srcMemory,  //!< Source memory object
+                       device::Memory& dstMemory,  //!< Destination memory object
+                       const uint64_t* regions,    //!< GPU visible (src, dst, size) triples
+                       uint count                  //!< The number of the regions
+                       ) const;
+
   bool runScheduler(uint64_t vqVM,
                     amd::Memory* schedulerParam,
                     hsa_queue_t* schedulerQueue,
                     hsa_signal_t& schedulerSignal,
-                    uint threads);
+                    uint threads,
+                    bool wait = true);
 
   //! Runs a blit kernel for GWS init
   bool RunGwsInit(uint32_t value             //!< Initial value for GWS resource
@@ -416,35 +468,78 @@ class KernelBlitManager : public DmaBlitManager {
                                size_t slicePitch = 0           //!< Slice for buffer
                                ) const;
 
+  //! Copies between a buffer and pageable host memory, which the kernel accesses directly
+  bool copyPageable(device::Memory& memory,  //!< Device memory object
+                    void* host,              //!< Pageable host memory
+                    size_t origin,           //!< The offset in the memory object
+                    size_t size,             //!< Size of the copy
+                    bool write               //!< TRUE if the copy goes from host to device
+                    ) const;
+
+  //! Returns Device::PageableXferModel::Path of the pageable transfer
+  uint selectPageablePath(bool write, size_t size, bool* measure) const;
+
+  //! Waits for the queue before a timed pageable transfer and returns the start time
+  uint64_t beginPageableSample() const;
+
+  //! Waits for the timed pageable transfer and adds the sample into the model
+  void endPageableSample(bool write, size_t size, uint path, uint64_t start) const;
+
+  //! Copies a buffer with 16 byte loads and stores per lane and the byte head and tail
+  bool copyBufferWide(device::Memory& srcMemory,  //!< Source memory object
+                      device::Memory& dstMemory,  //!< Destination memory object
+                      uint64_t srcOrigin,         //!< Source origin
+                      uint64_t dstOrigin,         //!< Destination origin
+                      uint64_t size,              //!< Size of the copy
+                      uint64_t head               //!< The bytes before 16 byte alignment
+                      ) const;
+
+  //! Fills a buffer with 16 byte stores per lane and the byte head and tail
+  bool fillBufferWide(device::Memory& memory,     //!< Memory object to fill with pattern
+                      const void* pattern,        //!< Pattern data
+                      size_t patternSize,         //!< Pattern size, must divide 16
+                      uint64_t origin,            //!< Destination origin
+                      uint64_t size,              //!< Size of the fill
+                      uint64_t head               //!< The bytes before 16 byte alignment
+                      ) const;
+
   //! Creates a program for all blit operations
   bool createProgram(Device& device  //!< Device object
                      );
 
-  //! Creates a view memory object
+  //! Returns a view memory object. The views are cached and owned by the blit manager
   Memory* createView(const Memory& parent,    //!< Parent memory object
                      cl_image_format format,  //!< The new format for a view
                      cl_mem_flags flags       //!< Memory flags
                      ) const;
 
+  //! Releases the cached views of the parents, which are referenced only by the views
+  void releaseOrphanViews() const;
+
+  //! Releases a cached view
+  void releaseView(Memory* view) const;
+
   address captureArguments(const amd::Kernel* kernel) const;
   void releaseArguments(address args) const;
 
+  //! Launches a buffer blit. The arguments go straight into the kernarg memory if possible,
+  //! otherwise they are programmed through the kernel parameters
+  bool launchBlit(amd::Kernel* kernel,                   //!< The blit kernel
+                  const amd::NDRangeContainer& ndrange,  //!< The launch dimensions
+                  const BlitArg* args,                   //!< The arguments of the kernel
+                  uint numArgs                           //!< The number of arguments
+                  ) const;
+
   inline void setArgument(amd::Kernel* kernel, size_t index,
                           size_t size, const void* value, uint32_t offset = 0) const;
 
-  uint32_t ConstantBufferOffset() const {
-    // Make sure it can fit at least 128 bytes for OCL memory fill of double16
-    constexpr uint32_t kManagedSize = 0x80;
-    // Adjust the ofset to the new location
-    constantBufferOffset_ += kManagedSize;
-    // Check if the allocation exceeds the limit
-    if ((constantBufferOffset_ + kManagedSize) > constantBuffer_->getSize()) {
-      // Stall GPU and reset the ofset
-      gpu().releaseGpuMemoryFence();
-      constantBufferOffset_ = 0;
-    }
-    return constantBufferOffset_;
-  }
+  //! Returns the offset of a free slot for the blit constants in the constant buffer ring
+  uint32_t ConstantBufferOffset(amd::Memory** buffer  //!< The constant buffer of the slot
+                                ) const;
+
+  //! Adds a new segment into the constant buffer ring
+  bool addConstantSegment(size_t position  //!< The position of the new segment in the ring
+                          ) const;
 
   //! Disable copy constructor
   KernelBlitManager(const KernelBlitManager&);
@@ -454,17 +549,35 @@ class KernelBlitManager : public DmaBlitManager {
 
   amd::Program* program_;             //!< GPU program object
   amd::Kernel* kernels_[BlitTotal];   //!< GPU kernels for blit
-  amd::Memory* constantBuffer_;       //!< An internal CB for blits
-  mutable uint32_t constantBufferOffset_; //!< Current offset in the constant buffer
+  //! Segment of the internal constant buffer ring for blits
+  struct ConstantSegment {
+    amd::Memory* buffer_;      //!< The constant buffer of the segment
+    ProfilingSignal* signal_;  //!< Tracks the last use of the retired segment
+  };
+  mutable std::vector<ConstantSegment> constantSegments_;  //!< The constant buffer ring
+  mutable size_t constantSegmentId_;      //!< Current segment in the ring
+  mutable uint32_t constantBufferOffset_; //!< Current offset in the constant buffer segment
   size_t xferBufferSize_;             //!< Transfer buffer size
   mutable amd::Monitor  lockXferOps_; //!< Lock transfer operation
+
+  //! Cached view of an image
+  struct ImageView {
+    const amd::Memory* parent_;  //!< Parent memory object of the view
+    cl_image_format format_;     //!< The format of the view
+    cl_mem_flags flags_;         //!< Memory flags of the view
+    Memory* view_;               //!< Device memory of the view
+  };
+  static constexpr size_t kMaxCachedViews = 16;  //!< Maximum number of the cached views
+  mutable std::list<ImageView> views_;  //!< Cached views in the most recently used order
 };
 
 static const char* BlitName[KernelBlitManager::BlitTotal] = {
     "__amd_rocclr_copyImage", "__amd_rocclr_copyImage1DA", "__amd_rocclr_copyImageToBuffer",
     "__amd_rocclr_copyBufferToImage", "__amd_rocclr_copyBufferRect", "__amd_rocclr_copyBufferRectAligned",
     "__amd_rocclr_copyBuffer", "__amd_rocclr_copyBufferAligned", "__amd_rocclr_fillBuffer",
-    "__amd_rocclr_fillImage", "__amd_rocclr_scheduler", "__amd_rocclr_gwsInit"
+    "__amd_rocclr_fillImage", "__amd_rocclr_copyBufferWide", "__amd_rocclr_fillBufferWide",
+    "__amd_rocclr_copyBufferBatch", "__amd_rocclr_patchDispatch", "__amd_rocclr_scheduler",
+    "__amd_rocclr_gwsInit"
 };
 
 inline void KernelBlitManager::setArgument(amd::Kernel* kernel, size_t index,
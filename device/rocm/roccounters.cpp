@@ -20,7 +20,10 @@
 
 #include "device/rocm/roccounters.hpp"
 #include "device/rocm/rocvirtual.hpp"
+#include <algorithm>
 #include <array>
+#include <cstdio>
+#include <sstream>
 
 
 hsa_status_t PerfCounterCallback(
@@ -464,9 +467,11 @@ PerfCounter::PerfCounter(const Device& device,   //!< A ROC device object
   event_.counter_id = eventIndex;
 }
 
-void PerfCounter::setProfile(PerfCounterProfile* profileRef) {
-  profileRef->perfCounters().push_back(this);
-  profileRef->addEvent(event_);
+void PerfCounter::setProfile(PerfCounterProfile* profileRef, bool addEvent) {
+  if (addEvent) {
+    profileRef->perfCounters().push_back(this);
+    profileRef->addEvent(event_);
+  }
 
   if (profileRef_ != nullptr) {
     profileRef_->release();
@@ -524,6 +529,10 @@ PerfCounter::~PerfCounter() {
 
 
 bool PerfCounterProfile::initialize() {
+  if (completionSignal_.handle != 0) {
+    // The context was created already, hence the buffers can be reused
+    return true;
+  }
 
   uint32_t  cmd_buf_size;
   uint32_t  out_buf_size;
@@ -585,7 +594,16 @@ bool PerfCounterProfile::initialize() {
   return true;
 }
 
+void PerfCounterProfile::reset() {
+  if (completionSignal_.handle != 0) {
+    hsa_signal_store_relaxed(completionSignal_, kInitSignalValueOne);
+  }
+}
+
 hsa_ext_amd_aql_pm4_packet_t* PerfCounterProfile::createStartPacket() {
+  if (startPacketReady_) {
+    return &prePacket_;
+  }
 
   profile_.events = &events_[0];
   profile_.event_count = events_.size();
@@ -596,10 +614,14 @@ hsa_ext_amd_aql_pm4_packet_t* PerfCounterProfile::createStartPacket() {
     return nullptr;
   }
 
+  startPacketReady_ = true;
   return &prePacket_;
 }
 
 hsa_ext_amd_aql_pm4_packet_t* PerfCounterProfile::createStopPacket() {
+  if (stopPacketReady_) {
+    return &postPacket_;
+  }
 
   profile_.events = &events_[0];
   profile_.event_count = events_.size();
@@ -613,9 +635,133 @@ hsa_ext_amd_aql_pm4_packet_t* PerfCounterProfile::createStopPacket() {
 
   postPacket_.completion_signal = completionSignal_;
 
+  stopPacketReady_ = true;
   return &postPacket_;
 }
 
+PerfCounterSampler::~PerfCounterSampler() {
+  collect(true);
+  for (const auto& it : totals_) {
+    std::ostringstream values;
+    for (const auto& value : it.second.values_) {
+      values << " " << value;
+    }
+    ClPrint(amd::LOG_INFO, amd::LOG_KERN, "PMC samples of %s: %llu dispatches, totals:%s",
+            it.first.c_str(), static_cast<unsigned long long>(it.second.samples_),
+            values.str().c_str());
+  }
+  if (dropped_ != 0) {
+    ClPrint(amd::LOG_INFO, amd::LOG_KERN, "PMC sampler dropped %llu samples",
+            static_cast<unsigned long long>(dropped_));
+  }
+  for (auto& slot : slots_) {
+    for (auto counter : slot.counters_) {
+      delete counter;
+    }
+    if (slot.profile_ != nullptr) {
+      slot.profile_->release();
+    }
+  }
+}
+
+bool PerfCounterSampler::create(const std::string& counters, uint numSlots) {
+  // Parse the list of the counters
+  std::vector<std::array<uint32_t, 3>> events;
+  std::istringstream list(counters);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    std::array<uint32_t, 3> event = {};
+    if (sscanf(item.c_str(), "%u:%u:%u", &event[0], &event[1], &event[2]) != 3) {
+      LogPrintfError("Invalid PMC sample counter: %s", item.c_str());
+      return false;
+    }
+    events.push_back(event);
+  }
+  if (events.empty()) {
+    return false;
+  }
+  numCounters_ = events.size();
+
+  slots_.resize(std::max(numSlots, 1u));
+  for (auto& slot : slots_) {
+    slot.profile_ = new PerfCounterProfile(gpu_.dev());
+    if ((slot.profile_ == nullptr) || !slot.profile_->Create()) {
+      LogError("Failed to create the PMC sample profile");
+      return false;
+    }
+    for (const auto& event : events) {
+      PerfCounter* counter = new PerfCounter(gpu_.dev(), event[0], event[1], event[2]);
+      // The legacy PM4 blob of GFX8 doesn't carry the completion signal of the stop packet
+      if ((counter == nullptr) || (counter->gfxVersion() == PerfCounter::ROC_UNSUPPORTED) ||
+          (counter->gfxVersion() == PerfCounter::ROC_GFX8)) {
+        LogError("Failed to create the PMC sample counter");
+        delete counter;
+        return false;
+      }
+      counter->setProfile(slot.profile_);
+      slot.counters_.push_back(counter);
+    }
+    // The packets are built once and reused for all samples of the slot
+    if (!slot.profile_->initialize() || (slot.profile_->createStartPacket() == nullptr) ||
+        (slot.profile_->createStopPacket() == nullptr)) {
+      LogError("Failed to create the PMC sample packets");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PerfCounterSampler::start() {
+  if ((dispatches_++ % period_) != 0) {
+    return false;
+  }
+  collect();
+  if (busy_ == slots_.size()) {
+    // The host didn't read the oldest sample yet, so skip the dispatch instead of a stall
+    ++dropped_;
+    return false;
+  }
+  Slot& slot = slots_[next_];
+  slot.profile_->reset();
+  return gpu_.dispatchCounterAqlPacket(slot.profile_->prePacket(),
+                                       slot.counters_[0]->gfxVersion(), false,
+                                       slot.profile_->api());
+}
+
+void PerfCounterSampler::stop(const std::string& kernelName) {
+  Slot& slot = slots_[next_];
+  slot.kernelName_ = kernelName;
+  if (!gpu_.dispatchCounterAqlPacket(slot.profile_->postPacket(),
+                                     slot.counters_[0]->gfxVersion(), false,
+                                     slot.profile_->api())) {
+    // The slot stays free, since the output won't be updated
+    return;
+  }
+  next_ = (next_ + 1) % slots_.size();
+  ++busy_;
+}
+
+void PerfCounterSampler::collect(bool wait) {
+  // The stop packets complete in the queue order, hence only the oldest slot is checked
+  while (busy_ > 0) {
+    Slot& slot = slots_[oldest_];
+    const hsa_signal_t signal = slot.profile_->completionSignal();
+    if (wait) {
+      WaitForSignal(signal, gpu_.waitPolicy());
+    } else if (hsa_signal_load_scacquire(signal) > 0) {
+      break;
+    }
+    Totals& totals = totals_[slot.kernelName_];
+    totals.values_.resize(numCounters_, 0);
+    ++totals.samples_;
+    for (size_t i = 0; i < numCounters_; ++i) {
+      totals.values_[i] += slot.counters_[i]->getInfo(CL_PERFCOUNTER_DATA);
+    }
+    oldest_ = (oldest_ + 1) % slots_.size();
+    --busy_;
+  }
+}
+
 PerfCounterProfile::~PerfCounterProfile() {
 
   if (completionSignal_.handle != 0) {
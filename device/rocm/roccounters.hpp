@@ -26,6 +26,10 @@
 #include "device/rocm/rocdevice.hpp"
 #include "hsa_ven_amd_aqlprofile.h"
 
+#include <map>
+#include <string>
+#include <vector>
+
 namespace roc {
 
 class VirtualGPU;
@@ -71,8 +75,9 @@ class PerfCounter : public device::PerfCounter {
   //! Returns the profile reference
   PerfCounterProfile*  profileRef() const { return profileRef_; }
 
-  //! Update the profile associated with the counter
-  void  setProfile(PerfCounterProfile* profileRef);
+  //! Update the profile associated with the counter. A cached profile
+  //! has the events already, hence addEvent is FALSE on the reuse
+  void  setProfile(PerfCounterProfile* profileRef, bool addEvent = true);
 
  private:
 
@@ -100,7 +105,10 @@ class PerfCounterProfile : public amd::ReferenceCountedObject {
   //! Default constructor
   PerfCounterProfile(const Device& device)
     : api_({0}),
-      roc_device_(device) {
+      roc_device_(device),
+      startPacketReady_(false),
+      stopPacketReady_(false),
+      inUse_(false) {
 
     memset(&profile_, 0, sizeof(profile_));
     profile_.agent = roc_device_.getBackendDevice();
@@ -139,15 +147,24 @@ class PerfCounterProfile : public amd::ReferenceCountedObject {
   //! Add the event of performance counter object to the profile context object
   void addEvent(hsa_ven_amd_aqlprofile_event_t event) { events_.push_back(event); };
 
-  //! Create the start packet for performance counter
+  //! Create the start packet for performance counter. The packet is built once
   hsa_ext_amd_aql_pm4_packet_t* createStartPacket();
 
-  //! Create the stop packet for performance counter
+  //! Create the stop packet for performance counter. The packet is built once
   hsa_ext_amd_aql_pm4_packet_t* createStopPacket();
 
-  //! Create the profile context object
+  //! Create the profile context object. The context is initialized once
   bool initialize();  //!< HSA profile context object
 
+  //! Prepares the initialized profile for the next start/stop pair
+  void reset();
+
+  //! Returns TRUE if the profile is between the start and stop commands
+  bool inUse() const { return inUse_; }
+
+  //! Marks the profile as used by the start command
+  void setInUse(bool inUse) { inUse_ = inUse; }
+
   //! Return the extension API table
   const hsa_ven_amd_aqlprofile_1_00_pfn_t* api() const { return &api_; }
 
@@ -160,6 +177,9 @@ class PerfCounterProfile : public amd::ReferenceCountedObject {
   //! Return the stop AQL packet
   hsa_ext_amd_aql_pm4_packet_t* postPacket() { return &postPacket_; }
 
+  //! Return the signal, which the stop packet decrements on the completion
+  hsa_signal_t completionSignal() const { return completionSignal_; }
+
  private:
 
   //! Disable copy constructor
@@ -180,6 +200,70 @@ class PerfCounterProfile : public amd::ReferenceCountedObject {
 
   hsa_signal_t completionSignal_;     //!< signal of completion
 
+  bool startPacketReady_;  //!< The start packet was built
+  bool stopPacketReady_;   //!< The stop packet was built
+  bool inUse_;             //!< The profile is between the start and stop commands
+};
+
+//! Continuous sampling of the performance counters on a queue. Every Nth dispatch is wrapped
+//! with the start and stop packets of the next slot in a ring. Each slot owns a profile with
+//! the packets, built once, and the output buffer. The host collects the completed slots
+//! on the later submissions, without a queue stall, and accumulates the counters per kernel
+class PerfCounterSampler : public amd::HeapObject {
+ public:
+  //! The accumulated counters of a kernel
+  struct Totals {
+    uint64_t samples_;              //!< The number of the sampled dispatches
+    std::vector<uint64_t> values_;  //!< The sum of each counter over the samples
+  };
+
+  PerfCounterSampler(VirtualGPU& gpu, uint period)
+    : gpu_(gpu), period_(std::max(period, 1u)), dispatches_(0), next_(0), oldest_(0),
+      busy_(0), dropped_(0), numCounters_(0) {}
+
+  //! Waits for the pending samples and reports the totals
+  ~PerfCounterSampler();
+
+  //! Creates the ring of the samples for the counters in the "block:counter:event,..." list
+  bool create(const std::string& counters, uint numSlots);
+
+  //! Dispatches the start packet, if the next dispatch must be sampled.
+  //! Returns TRUE if the caller must call stop() after the dispatch
+  bool start();
+
+  //! Dispatches the stop packet for the sampled kernel
+  void stop(const std::string& kernelName);
+
+  //! Reads the completed samples. If wait is TRUE, then waits for all pending samples
+  void collect(bool wait = false);
+
+  //! Returns the accumulated counters, keyed by the kernel name
+  const std::map<std::string, Totals>& totals() const { return totals_; }
+
+ private:
+  //! A sample in the ring
+  struct Slot {
+    PerfCounterProfile* profile_;         //!< The profile with the packets and the output
+    std::vector<PerfCounter*> counters_;  //!< The counters of the profile
+    std::string kernelName_;              //!< The sampled kernel
+  };
+
+  //! Disable copy constructor
+  PerfCounterSampler(const PerfCounterSampler&);
+
+  //! Disable operator=
+  PerfCounterSampler& operator=(const PerfCounterSampler&);
+
+  VirtualGPU& gpu_;            //!< The queue with the sampled dispatches
+  const uint period_;          //!< Sample every Nth dispatch
+  uint64_t dispatches_;        //!< The number of the dispatches on the queue
+  size_t next_;                //!< The slot for the next sample
+  size_t oldest_;              //!< The oldest pending slot
+  size_t busy_;                //!< The number of pending slots
+  uint64_t dropped_;           //!< The skipped samples, because the ring was full
+  size_t numCounters_;         //!< The number of the sampled counters
+  std::vector<Slot> slots_;    //!< The ring of the samples
+  std::map<std::string, Totals> totals_;  //!< The accumulated counters per kernel
 };
 
 }  // namespace roc
@@ -35,6 +35,16 @@ static constexpr uint kMaxAsyncQueues = 8;
 
 constexpr bool kSkipCpuWait = true;
 
+class Memory;
+
+//! An argument of the internal blit launch
+struct BlitArg {
+  const void* value_;  //!< The argument value, NULL for a buffer argument
+  size_t size_;        //!< The value size
+  Memory* memory_;     //!< The buffer of a pointer argument, NULL for a null pointer
+  uint64_t offset_;    //!< The offset in the buffer
+};
+
 enum HwQueueEngine : uint32_t {
   Compute   = 0,
   SdmaRead  = 1,
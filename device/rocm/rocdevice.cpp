@@ -22,6 +22,7 @@
 
 #include "platform/program.hpp"
 #include "platform/kernel.hpp"
+#include "platform/runtime.hpp"
 #include "os/os.hpp"
 #include "utils/debug.hpp"
 #include "utils/flags.hpp"
@@ -54,12 +55,19 @@
 #include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
 #ifdef ROCCLR_SUPPORT_NUMA_POLICY
 #include <numaif.h>
 #endif // ROCCLR_SUPPORT_NUMA_POLICY
+#if !defined(_WIN32)
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#endif
 #include <sstream>
+#include <thread>
 #include <vector>
 #endif // WITHOUT_HSA_BaCKEND
 
@@ -153,8 +161,7 @@ bool NullDevice::create(const amd::Isa &isa) {
 }
 
 Device::Device(hsa_agent_t bkendDevice)
-    : mapCacheOps_(nullptr)
-    , mapCache_(nullptr)
+    : mapCache_(nullptr)
     , _bkendDevice(bkendDevice)
     , pciDeviceId_(0)
     , gpuvm_segment_max_alloc_(0)
@@ -162,22 +169,40 @@ Device::Device(hsa_agent_t bkendDevice)
     , xferQueue_(nullptr)
     , xferRead_(nullptr)
     , xferWrite_(nullptr)
+    , pinnedMemCache_(nullptr)
+    , slabAllocator_()
+    , copyEngineModel_(nullptr)
+    , pageableXferModel_(nullptr)
+    , oversub_(nullptr)
+    , hostMemPool_(nullptr)
     , pro_device_(nullptr)
     , pro_ena_(false)
     , freeMem_(0)
+    , reclaimWatermark_(0)
     , vgpusAccess_("Virtual GPU List Ops Lock", true)
     , hsa_exclusive_gpu_access_(false)
     , queuePool_(QueuePriority::Total)
     , coopHostcallBuffer_(nullptr)
+    , hostcallBufferSize_(0)
     , queueWithCUMaskPool_(QueuePriority::Total)
+    , warmLock_("Queue warm-up lock", true)
+    , warmQueues_(QueuePriority::Total)
+    , warmTarget_(QueuePriority::Total, 0)
+    , warmTerminate_(false)
+    , cuPartitionLock_("CU partition lock")
+    , ipcLock_("IPC import cache lock")
+    , samplerLock_("Sampler cache lock")
+    , signalPoolLock_("Signal pool lock")
+    , xferPoolLock_("Transfer queue pool lock")
     , numOfVgpus_(0) {
+  hostLinkDistance_ = std::numeric_limits<int32_t>::max();
+  relayStage_ = nullptr;
   group_segment_.handle = 0;
   system_segment_.handle = 0;
   system_coarse_segment_.handle = 0;
   system_kernarg_segment_.handle = 0;
   gpuvm_segment_.handle = 0;
   gpu_fine_grained_segment_.handle = 0;
-  prefetch_signal_.handle = 0;
 }
 
 void Device::setupCpuAgent() {
@@ -195,6 +220,7 @@ void Device::setupCpuAgent() {
     }
   }
 
+  hostLinkDistance_ = numaDistance;
   cpu_agent_ = cpu_agents_[index].agent;
   system_segment_ = cpu_agents_[index].fine_grain_pool;
   system_coarse_segment_ = cpu_agents_[index].coarse_grain_pool;
@@ -209,14 +235,31 @@ Device::~Device() {
   delete pro_device_;
 #endif
 
-  // Release cached map targets
-  for (uint i = 0; mapCache_ != nullptr && i < mapCache_->size(); ++i) {
-    if ((*mapCache_)[i] != nullptr) {
-      (*mapCache_)[i]->release();
+  // Stop the queue warm-up thread and destroy the unused queues
+  if (queueWarmer_.state() >= amd::Thread::RUNNABLE) {
+    {
+      amd::ScopedLock lock(warmLock_);
+      warmTerminate_ = true;
+      warmLock_.notify();
+    }
+    while (queueWarmer_.state() < amd::Thread::FINISHED) {
+      amd::Os::yield();
+    }
+  }
+  for (auto& queues : warmQueues_) {
+    for (auto queue : queues) {
+      hsa_queue_destroy(queue);
     }
   }
+
+  // Detach the cached IPC imports
+  {
+    amd::ScopedLock lock(ipcLock_);
+    trimIpcImports(0);
+  }
+
+  // Release cached map targets
   delete mapCache_;
-  delete mapCacheOps_;
 
   if (nullptr != p2p_stage_) {
     p2p_stage_->release();
@@ -231,11 +274,23 @@ Device::~Device() {
       glb_ctx_ = nullptr;
   }
 
+  if (relayStage_ != nullptr) {
+    memFree(relayStage_, kP2PStagingSize);
+    relayStage_ = nullptr;
+  }
+
+  // Release the cached pinned memory
+  delete pinnedMemCache_;
+  pinnedMemCache_ = nullptr;
+
   // Destroy temporary buffers for read/write
   delete xferRead_;
   delete xferWrite_;
 
-  // Destroy transfer queue
+  // Destroy transfer queues
+  for (auto queue : xferPool_) {
+    delete queue;
+  }
   delete xferQueue_;
 
   delete blitProgram_;
@@ -259,12 +314,34 @@ Device::~Device() {
   if (coopHostcallBuffer_) {
     disableHostcalls(coopHostcallBuffer_);
     context().svmFree(coopHostcallBuffer_);
+    memoryUsage().remove(VDI_MEMORY_HOSTCALL, hostcallBufferSize_);
     coopHostcallBuffer_ = nullptr;
   }
 
-  if (0 != prefetch_signal_.handle) {
-    hsa_signal_destroy(prefetch_signal_);
+  delete copyEngineModel_;
+  copyEngineModel_ = nullptr;
+
+  delete oversub_;
+  oversub_ = nullptr;
+
+  delete pageableXferModel_;
+  pageableXferModel_ = nullptr;
+
+  // Release the slabs. The pointers are cleared first, so memFree() skips the sub-allocators
+  for (auto& allocator : slabAllocator_) {
+    SlabAllocator* slabs = allocator;
+    allocator = nullptr;
+    delete slabs;
+  }
+
+  for (const auto& signal : signalPool_) {
+    hsa_signal_destroy(signal);
   }
+
+  // The pointer is cleared first, so memFree() releases the remaining blocks directly
+  HostMemPool* hostMemPool = hostMemPool_;
+  hostMemPool_ = nullptr;
+  delete hostMemPool;
 }
 
 bool NullDevice::initCompiler(bool isOffline) {
@@ -360,18 +437,18 @@ hsa_status_t Device::loaderQueryHostAddress(const void* device, const void** hos
 
 Device::XferBuffers::~XferBuffers() {
   // Destroy temporary buffer for reads
-  for (const auto& buf : freeBuffers_) {
-    delete buf;
+  for (auto& bucket : buckets_) {
+    for (const auto& buf : bucket.freeBuffers_) {
+      dev().memoryUsage().remove(VDI_MEMORY_STAGING, buf->size());
+      delete buf;
+    }
+    bucket.freeBuffers_.clear();
   }
-  freeBuffers_.clear();
 }
 
-bool Device::XferBuffers::create() {
-  Memory* xferBuf = nullptr;
-  bool result = false;
-
+Memory* Device::XferBuffers::allocBuffer(size_t size) {
   // Create a buffer object
-  xferBuf = new Buffer(dev(), bufSize_);
+  Memory* xferBuf = new Buffer(dev(), size);
 
   // Try to allocate memory for the transfer buffer
   if ((nullptr == xferBuf) || !xferBuf->create()) {
@@ -379,53 +456,981 @@ bool Device::XferBuffers::create() {
     xferBuf = nullptr;
     LogError("Couldn't allocate a transfer buffer!");
   } else {
-    result = true;
-    freeBuffers_.push_back(xferBuf);
+    ++stats_.allocations_;
+    dev().memoryUsage().add(VDI_MEMORY_STAGING, size);
   }
 
-  return result;
+  return xferBuf;
 }
 
-Memory& Device::XferBuffers::acquire() {
-  Memory* xferBuf = nullptr;
-  size_t listSize;
+uint Device::XferBuffers::findBucket(size_t size) const {
+  uint bucket = 0;
+  if (size != 0) {
+    while ((bucket + 1 < kNumBuckets) && (size <= bucketSize(bucket + 1)) &&
+           (bucketSize(bucket + 1) < bucketSize(bucket))) {
+      ++bucket;
+    }
+  }
+  return bucket;
+}
 
-  // Lock the operations with the staged buffer list
-  amd::ScopedLock l(lock_);
-  listSize = freeBuffers_.size();
-
-  // If the list is empty, then attempt to allocate a staged buffer
-  if (listSize == 0) {
-    // Allocate memory
-    xferBuf = new Buffer(dev(), bufSize_);
-
-    // Allocate memory for the transfer buffer
-    if ((nullptr == xferBuf) || !xferBuf->create()) {
-      delete xferBuf;
-      xferBuf = nullptr;
-      LogError("Couldn't allocate a transfer buffer!");
-    } else {
-      ++acquiredCnt_;
+Memory& Device::XferBuffers::acquire(VirtualGPU& gpu, size_t size) {
+  Memory* xferBuf = nullptr;
+  uint bucket = findBucket(size);
+
+  // Check the local cache of the queue first, which doesn't require a lock
+  LocalCache& cache = gpu.xferCache(write_);
+  if (cache.buffers_[bucket] != nullptr) {
+    xferBuf = cache.buffers_[bucket];
+    cache.buffers_[bucket] = nullptr;
+    ++stats_.localHits_;
+    return *xferBuf;
+  }
+
+  {
+    // Lock the operations with the staged buffer list
+    amd::ScopedLock l(lock_);
+    Bucket& list = buckets_[bucket];
+    // The low priority queues leave the last pooled buffer to the other queues,
+    // so the bulk transfers don't delay the latency sensitive streams with an allocation
+    const bool reserved = (list.freeBuffers_.size() == 1) &&
+                          (gpu.priority() == amd::CommandQueue::Priority::Low);
+    if (!list.freeBuffers_.empty() && !reserved) {
+      xferBuf = list.freeBuffers_.front();
+      list.freeBuffers_.pop_front();
+      ++stats_.poolHits_;
     }
+    ++list.acquired_;
+    list.peak_ = std::max(list.peak_, list.acquired_);
+    ++acquiredCnt_;
   }
 
+  // If the list is empty, then attempt to allocate a staged buffer outside of the lock
   if (xferBuf == nullptr) {
-    xferBuf = *(freeBuffers_.begin());
-    freeBuffers_.erase(freeBuffers_.begin());
-    ++acquiredCnt_;
+    xferBuf = allocBuffer(bucketSize(bucket));
+    if (xferBuf == nullptr) {
+      amd::ScopedLock l(lock_);
+      --buckets_[bucket].acquired_;
+      --acquiredCnt_;
+    }
   }
 
   return *xferBuf;
 }
 
+void Device::XferBuffers::releaseToPool(uint bucket, Memory* buffer) {
+  Bucket& list = buckets_[bucket];
+  --list.acquired_;
+  --acquiredCnt_;
+
+  // Keep enough free buffers to cover the high-water mark of the last period
+  size_t maxFree = std::min(static_cast<size_t>(std::max(list.peak_, 1u) - list.acquired_),
+                            MaxXferBufListSize);
+  if (list.freeBuffers_.size() < maxFree) {
+    list.freeBuffers_.push_back(buffer);
+  } else {
+    dev().memoryUsage().remove(VDI_MEMORY_STAGING, buffer->size());
+    delete buffer;
+    ++stats_.trimmed_;
+  }
+
+  if (++list.releases_ >= kTrimPeriod) {
+    // Start a new period and trim the free list to the current high-water mark
+    list.releases_ = 0;
+    list.peak_ = list.acquired_;
+    size_t trimSize = std::max(list.peak_, 1u) - list.acquired_;
+    while (list.freeBuffers_.size() > trimSize) {
+      dev().memoryUsage().remove(VDI_MEMORY_STAGING, list.freeBuffers_.back()->size());
+      delete list.freeBuffers_.back();
+      list.freeBuffers_.pop_back();
+      ++stats_.trimmed_;
+    }
+  }
+}
+
 void Device::XferBuffers::release(VirtualGPU& gpu, Memory& buffer) {
   // Make sure buffer isn't busy on the current VirtualGPU, because
   // the next aquire can come from different queue
   //    buffer.wait(gpu);
+  uint bucket = findBucket(buffer.size());
+
+  // Keep the buffer in the local cache of the queue if the slot is empty
+  LocalCache& cache = gpu.xferCache(write_);
+  if (cache.buffers_[bucket] == nullptr) {
+    cache.buffers_[bucket] = &buffer;
+    return;
+  }
+
   // Lock the operations with the staged buffer list
   amd::ScopedLock l(lock_);
-  freeBuffers_.push_back(&buffer);
-  --acquiredCnt_;
+  releaseToPool(bucket, &buffer);
+}
+
+size_t Device::XferBuffers::trim() {
+  amd::ScopedLock l(lock_);
+  size_t released = 0;
+  for (auto& bucket : buckets_) {
+    for (const auto& buf : bucket.freeBuffers_) {
+      released += buf->size();
+      dev().memoryUsage().remove(VDI_MEMORY_STAGING, buf->size());
+      delete buf;
+      ++stats_.trimmed_;
+    }
+    bucket.freeBuffers_.clear();
+    // Start a new period, so the pool doesn't grow back to the old high-water mark
+    bucket.releases_ = 0;
+    bucket.peak_ = bucket.acquired_;
+  }
+  return released;
+}
+
+void Device::XferBuffers::flushCache(LocalCache& cache) {
+  amd::ScopedLock l(lock_);
+  for (uint i = 0; i < kNumBuckets; ++i) {
+    if (cache.buffers_[i] != nullptr) {
+      releaseToPool(i, cache.buffers_[i]);
+      cache.buffers_[i] = nullptr;
+    }
+  }
+}
+
+amd::Memory* Device::PinnedMemCache::find(const void* addr, size_t size, size_t* offset) {
+  address start = reinterpret_cast<address>(const_cast<void*>(addr));
+  amd::ScopedLock l(lock_);
+
+  // Find the last range, which starts before or at the requested address
+  auto it = ranges_.upper_bound(start);
+  if (it == ranges_.begin()) {
+    return nullptr;
+  }
+  --it;
+  amd::Memory* mem = it->second.mem_;
+  if ((start + size) > (it->first + mem->getSize())) {
+    return nullptr;
+  }
+
+  // Move the range to the front of LRU list
+  lru_.splice(lru_.begin(), lru_, it->second.lru_);
+  *offset = start - it->first;
+  mem->retain();
+  return mem;
+}
+
+std::map<address, Device::PinnedMemCache::Entry>::iterator Device::PinnedMemCache::erase(
+    std::map<address, Entry>::iterator it) {
+  size_ -= it->second.mem_->getSize();
+  lru_.erase(it->second.lru_);
+  it->second.mem_->release();
+  return ranges_.erase(it);
+}
+
+void Device::PinnedMemCache::insert(amd::Memory* mem) {
+  const size_t size = mem->getSize();
+  if (size > budget_) {
+    return;
+  }
+  address start = reinterpret_cast<address>(mem->getHostMem());
+
+  amd::ScopedLock l(lock_);
+  // Replace all ranges, which overlap the new one
+  invalidate(start, size);
+
+  // Evict the least recently used ranges until the new one fits into the budget
+  while ((size_ + size) > budget_) {
+    erase(ranges_.find(lru_.back()));
+  }
+
+  lru_.push_front(start);
+  ranges_[start] = {mem, lru_.begin()};
+  size_ += size;
+  mem->retain();
+}
+
+void Device::PinnedMemCache::invalidate(const void* addr, size_t size) {
+  address start = reinterpret_cast<address>(const_cast<void*>(addr));
+  address end = (size > (std::numeric_limits<uintptr_t>::max() -
+                         reinterpret_cast<uintptr_t>(start))) ?
+      reinterpret_cast<address>(std::numeric_limits<uintptr_t>::max()) : start + size;
+
+  amd::ScopedLock l(lock_);
+  auto it = ranges_.upper_bound(start);
+  // Check if the previous range reaches the start address
+  if (it != ranges_.begin()) {
+    auto prev = std::prev(it);
+    if ((prev->first + prev->second.mem_->getSize()) > start) {
+      it = prev;
+    }
+  }
+  while ((it != ranges_.end()) && (it->first < end)) {
+    it = erase(it);
+  }
+}
+
+void Device::PinnedMemCache::invalidate(const device::VirtualDevice* vdev) {
+  amd::ScopedLock l(lock_);
+  for (auto it = ranges_.begin(); it != ranges_.end();) {
+    if (it->second.mem_->getVirtualDevice() == vdev) {
+      it = erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+Device::SlabAllocator::SlabAllocator(const Device& dev, bool atomics, size_t maxSize)
+    : dev_(dev), atomics_(atomics), maxSize_(kMinBlockSize),
+      slabsLock_("Slab allocator lock", true) {
+  // The biggest block size class, which fits into the limit
+  uint numClasses = 1;
+  while ((blockSize(numClasses) <= maxSize) && (blockSize(numClasses) < kSlabSize)) {
+    ++numClasses;
+  }
+  maxSize_ = blockSize(numClasses - 1);
+  for (auto& shard : shards_) {
+    shard.partialSlabs_.resize(numClasses);
+  }
+}
+
+Device::SlabAllocator::~SlabAllocator() {
+  for (const auto& it : slabs_) {
+    dev_.memFree(it.first, kSlabSize);
+    delete it.second;
+  }
+}
+
+Device::SlabAllocator::Slab* Device::SlabAllocator::createSlab(uint sizeClass, uint shard) {
+  address base = reinterpret_cast<address>(dev_.deviceLocalAlloc(kSlabSize, atomics_, false));
+  if (base == nullptr) {
+    return nullptr;
+  }
+  Slab* slab = new Slab;
+  if (slab == nullptr) {
+    dev_.memFree(base, kSlabSize);
+    return nullptr;
+  }
+  slab->base_ = base;
+  slab->sizeClass_ = sizeClass;
+  slab->shard_ = shard;
+  // The blocks are taken from the back, so the slab is filled from the beginning
+  const uint32_t numBlocks = static_cast<uint32_t>(kSlabSize / blockSize(sizeClass));
+  slab->freeBlocks_.reserve(numBlocks);
+  for (uint32_t i = numBlocks; i > 0; --i) {
+    slab->freeBlocks_.push_back(i - 1);
+  }
+
+  // The free blocks of the slabs are the allocator cache
+  dev_.memoryUsage().add(VDI_MEMORY_RESOURCE_CACHE, kSlabSize);
+  amd::ScopedLock l(slabsLock_);
+  slabs_[base] = slab;
+  ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Slab %p created for blocks of size 0x%zx",
+          base, blockSize(sizeClass));
+  return slab;
+}
+
+void Device::SlabAllocator::destroySlab(Slab* slab) {
+  {
+    amd::ScopedLock l(slabsLock_);
+    slabs_.erase(slab->base_);
+  }
+  ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Slab %p destroyed", slab->base_);
+  dev_.memFree(slab->base_, kSlabSize);
+  dev_.memoryUsage().remove(VDI_MEMORY_RESOURCE_CACHE, kSlabSize);
+  delete slab;
+}
+
+void* Device::SlabAllocator::allocate(size_t size) {
+  uint sizeClass = 0;
+  while (blockSize(sizeClass) < size) {
+    ++sizeClass;
+  }
+  // Each thread sticks to the same shard
+  static thread_local const uint shardIdx = static_cast<uint>(
+      std::hash<std::thread::id>()(std::this_thread::get_id()) % kNumShards);
+  Shard& shard = shards_[shardIdx];
+
+  amd::ScopedLock l(shard.lock_);
+  std::vector<Slab*>& partial = shard.partialSlabs_[sizeClass];
+  if (partial.empty()) {
+    Slab* slab = createSlab(sizeClass, shardIdx);
+    if (slab == nullptr) {
+      return nullptr;
+    }
+    partial.push_back(slab);
+  }
+
+  Slab* slab = partial.back();
+  const uint32_t block = slab->freeBlocks_.back();
+  slab->freeBlocks_.pop_back();
+  if (slab->freeBlocks_.empty()) {
+    // The full slab will be back in the list on a free
+    partial.pop_back();
+  }
+  dev_.memoryUsage().remove(VDI_MEMORY_RESOURCE_CACHE, blockSize(sizeClass));
+  return slab->base_ + block * blockSize(sizeClass);
+}
+
+bool Device::SlabAllocator::free(void* ptr) {
+  void* base = nullptr;
+  size_t size = 0;
+  Slab* slab = nullptr;
+  {
+    amd::ScopedLock l(slabsLock_);
+    if (!findSlab(ptr, &base, &size)) {
+      return false;
+    }
+    slab = slabs_[reinterpret_cast<address>(base)];
+  }
+
+  // The slab can't be destroyed concurrently, because the block is still allocated
+  Shard& shard = shards_[slab->shard_];
+  amd::ScopedLock l(shard.lock_);
+  const size_t blockSz = blockSize(slab->sizeClass_);
+  const uint32_t block =
+      static_cast<uint32_t>((reinterpret_cast<address>(ptr) - slab->base_) / blockSz);
+  std::vector<Slab*>& partial = shard.partialSlabs_[slab->sizeClass_];
+  if (slab->freeBlocks_.empty()) {
+    partial.push_back(slab);
+  }
+  slab->freeBlocks_.push_back(block);
+  dev_.memoryUsage().add(VDI_MEMORY_RESOURCE_CACHE, blockSz);
+
+  // Keep one empty slab for the size class in the shard, so the allocations don't thrash
+  if ((slab->freeBlocks_.size() == (kSlabSize / blockSz)) && (partial.size() > 1)) {
+    partial.erase(std::find(partial.begin(), partial.end(), slab));
+    destroySlab(slab);
+  }
+  return true;
+}
+
+bool Device::SlabAllocator::findSlab(const void* ptr, void** base, size_t* size) const {
+  address addr = reinterpret_cast<address>(const_cast<void*>(ptr));
+  amd::ScopedLock l(slabsLock_);
+  auto it = slabs_.upper_bound(addr);
+  if (it == slabs_.begin()) {
+    return false;
+  }
+  --it;
+  if (addr >= (it->first + kSlabSize)) {
+    return false;
+  }
+  *base = it->first;
+  *size = kSlabSize;
+  return true;
+}
+
+void Device::SlabAllocator::allowPeerAccess() const {
+  std::vector<address> bases;
+  {
+    amd::ScopedLock l(slabsLock_);
+    for (const auto& it : slabs_) {
+      bases.push_back(it.first);
+    }
+  }
+  for (auto base : bases) {
+    dev_.deviceAllowAccess(base);
+  }
+}
+
+size_t Device::SlabAllocator::trim() {
+  size_t released = 0;
+  for (auto& shard : shards_) {
+    // Skip the shards of the concurrent allocations, so the shard locks can't deadlock
+    if (!shard.lock_.tryLock()) {
+      continue;
+    }
+    for (uint sizeClass = 0; sizeClass < shard.partialSlabs_.size(); ++sizeClass) {
+      std::vector<Slab*>& partial = shard.partialSlabs_[sizeClass];
+      const size_t numBlocks = kSlabSize / blockSize(sizeClass);
+      for (auto it = partial.begin(); it != partial.end();) {
+        if ((*it)->freeBlocks_.size() == numBlocks) {
+          destroySlab(*it);
+          it = partial.erase(it);
+          released += kSlabSize;
+        } else {
+          ++it;
+        }
+      }
+    }
+    shard.lock_.unlock();
+  }
+  return released;
+}
+
+Device::HostMemPool::HostMemPool(const Device& dev, size_t budget)
+    : dev_(dev), budget_(budget), freeSize_(0), lock_("Host memory pool", true) {}
+
+Device::HostMemPool::~HostMemPool() {
+  amd::ScopedLock l(lock_);
+  releaseFree();
+}
+
+size_t Device::HostMemPool::classSize(size_t size) {
+  // The class step is 1/8 of the next power of two, so the waste is at most 25%
+  const size_t minStep = kMinBlockSize;
+  const size_t step = std::max(amd::nextPowerOfTwo(size) / 8, minStep);
+  return amd::alignUp(size, step);
+}
+
+void Device::HostMemPool::releaseFree() {
+  for (auto& it : freeBlocks_) {
+    for (auto ptr : it.second) {
+      hsa_amd_memory_pool_free(ptr);
+    }
+    it.second.clear();
+  }
+  dev_.memoryUsage().remove(VDI_MEMORY_RESOURCE_CACHE, freeSize_);
+  freeSize_ = 0;
+}
+
+void* Device::HostMemPool::allocate(const hsa_amd_memory_pool_t& segment, size_t size) {
+  const Key key(segment.handle, classSize(size));
+  {
+    amd::ScopedLock l(lock_);
+    auto it = freeBlocks_.find(key);
+    if ((it != freeBlocks_.end()) && !it->second.empty()) {
+      void* ptr = it->second.back();
+      it->second.pop_back();
+      freeSize_ -= key.second;
+      dev_.memoryUsage().remove(VDI_MEMORY_RESOURCE_CACHE, key.second);
+      allocated_[ptr] = key;
+      return ptr;
+    }
+  }
+
+  void* ptr = dev_.hsaHostAlloc(segment, key.second);
+  if (ptr == nullptr) {
+    // The free blocks of the other classes can satisfy the allocation
+    amd::ScopedLock l(lock_);
+    if (freeSize_ == 0) {
+      return nullptr;
+    }
+    releaseFree();
+    ptr = dev_.hsaHostAlloc(segment, key.second);
+    if (ptr == nullptr) {
+      return nullptr;
+    }
+  }
+  amd::ScopedLock l(lock_);
+  allocated_[ptr] = key;
+  return ptr;
+}
+
+bool Device::HostMemPool::free(void* ptr) {
+  amd::ScopedLock l(lock_);
+  auto it = allocated_.find(ptr);
+  if (it == allocated_.end()) {
+    return false;
+  }
+  const Key key = it->second;
+  allocated_.erase(it);
+  if ((freeSize_ + key.second) <= budget_) {
+    freeBlocks_[key].push_back(ptr);
+    freeSize_ += key.second;
+    dev_.memoryUsage().add(VDI_MEMORY_RESOURCE_CACHE, key.second);
+  } else {
+    hsa_amd_memory_pool_free(ptr);
+  }
+  return true;
+}
+
+//! The weight of a new measurement in the moving average of the copy bandwidth
+static constexpr double kCopySampleWeight = 0.25;
+
+//! Returns the bandwidth in bytes per ns of the completed async copy, 0 if unknown
+static double asyncCopyBandwidth(hsa_signal_t signal, size_t size) {
+  hsa_amd_profiling_async_copy_time_t time = {};
+  if ((HSA_STATUS_SUCCESS != hsa_amd_profiling_get_async_copy_time(signal, &time)) ||
+      (time.end <= time.start)) {
+    return 0.0;
+  }
+  return size / ((time.end - time.start) * Timestamp::getGpuTicksToTime());
+}
+
+Device::CopyEngineModel::CopyEngineModel(const Device& dev)
+    : dev_(dev), calibrated_(false), samples_(), selects_(), lock_("Copy engine model", true) {
+  // The model measures the copies with the profiling time
+  hsa_amd_profiling_async_copy_enable(true);
+}
+
+Device::CopyEngineModel::~CopyEngineModel() {
+  print();
+  storeTuning();
+  for (const auto& pending : pending_) {
+    pending.signal_->release();
+  }
+}
+
+uint Device::CopyEngineModel::sizeClass(size_t size) {
+  uint sizeClass = 0;
+  while ((size > 1) && (sizeClass < (kSizeClasses - 1))) {
+    size >>= 1;
+    ++sizeClass;
+  }
+  return sizeClass;
+}
+
+std::string Device::CopyEngineModel::tuningKey(uint direction, uint sizeClass,
+                                               uint engine) const {
+  return "CopyEngine:" + std::to_string(direction) + ":" + std::to_string(sizeClass) + ":" +
+         std::to_string(engine) + ":" + dev_.info().name_;
+}
+
+bool Device::CopyEngineModel::loadTuning() {
+  bool loaded = false;
+  for (uint direction = 0; direction < DirectionTotal; ++direction) {
+    for (uint copyClass = 0; copyClass < kSizeClasses; ++copyClass) {
+      for (uint engine = Sdma; engine < EngineTotal; ++engine) {
+        // The profile keeps the bandwidth in MB/s
+        uint32_t value = 0;
+        if (amd::Device::appProfile()->GetTunedValue(tuningKey(direction, copyClass, engine),
+                                                     &value) && (value != 0)) {
+          update(static_cast<Direction>(direction), copyClass, static_cast<Engine>(engine),
+                 value / 1000.0);
+          loaded = true;
+        }
+      }
+    }
+  }
+  return loaded;
+}
+
+void Device::CopyEngineModel::storeTuning() const {
+  std::vector<std::pair<std::string, uint32_t>> values;
+  amd::ScopedLock l(lock_);
+  for (uint direction = 0; direction < DirectionTotal; ++direction) {
+    for (uint copyClass = 0; copyClass < kSizeClasses; ++copyClass) {
+      for (uint engine = Sdma; engine < EngineTotal; ++engine) {
+        const Sample& sample = samples_[direction][copyClass][engine];
+        if (sample.count_ != 0) {
+          values.push_back(std::make_pair(tuningKey(direction, copyClass, engine),
+                                          static_cast<uint32_t>(sample.bandwidth_ * 1000.0)));
+        }
+      }
+    }
+  }
+  if (!values.empty()) {
+    amd::Device::appProfile()->SetTunedValues(values);
+  }
+}
+
+void Device::CopyEngineModel::calibrate() {
+  calibrated_ = true;
+  // The measurements of the previous runs replace the startup benchmark
+  if (loadTuning()) {
+    print();
+    return;
+  }
+  constexpr size_t kMaxSize = 4 * Mi;
+  const size_t sizes[] = {4 * Ki, 64 * Ki, 1 * Mi, kMaxSize};
+
+  void* host = dev_.hostAlloc(kMaxSize, 0);
+  void* device = dev_.deviceLocalAlloc(kMaxSize, false, false);
+  hsa_signal_t signal = {};
+  if ((host != nullptr) && (device != nullptr) &&
+      (HSA_STATUS_SUCCESS == hsa_signal_create(kInitSignalValueOne, 0, nullptr, &signal))) {
+    const hsa_agent_t gpu = dev_.getBackendDevice();
+    const hsa_agent_t cpu = dev_.getCpuAgent();
+    for (uint direction = HostToDevice; direction <= DeviceToHost; ++direction) {
+      const bool write = (direction == HostToDevice);
+      for (auto size : sizes) {
+        for (uint engine = Sdma; engine < EngineTotal; ++engine) {
+          // The same agent on both sides forces the blit kernels
+          const hsa_agent_t srcAgent = ((engine == Blit) || !write) ? gpu : cpu;
+          const hsa_agent_t dstAgent = ((engine == Blit) || write) ? gpu : cpu;
+          // The first copy wakes up the engine, so only the second one is measured
+          for (uint i = 0; i < 2; ++i) {
+            hsa_signal_store_relaxed(signal, kInitSignalValueOne);
+            if (HSA_STATUS_SUCCESS != hsa_amd_memory_async_copy(write ? device : host, dstAgent,
+                                          write ? host : device, srcAgent, size, 0, nullptr,
+                                          signal)) {
+              break;
+            }
+            hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, kInitSignalValueOne,
+                                      std::numeric_limits<uint64_t>::max(),
+                                      HSA_WAIT_STATE_ACTIVE);
+            const double bandwidth = asyncCopyBandwidth(signal, size);
+            if ((i == 1) && (bandwidth > 0.0)) {
+              update(static_cast<Direction>(direction), sizeClass(size),
+                     static_cast<Engine>(engine), bandwidth);
+            }
+          }
+        }
+      }
+    }
+    print();
+  }
+
+  if (signal.handle != 0) {
+    hsa_signal_destroy(signal);
+  }
+  if (device != nullptr) {
+    dev_.memFree(device, kMaxSize);
+  }
+  if (host != nullptr) {
+    dev_.hostFree(host, kMaxSize);
+  }
+}
+
+void Device::CopyEngineModel::harvest() {
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    if (hsa_signal_load_relaxed(it->signal_->signal_) > 0) {
+      ++it;
+      continue;
+    }
+    const double bandwidth = asyncCopyBandwidth(it->signal_->signal_, it->size_);
+    if (bandwidth > 0.0) {
+      update(it->direction_, sizeClass(it->size_), it->engine_, bandwidth);
+    }
+    it->signal_->release();
+    it = pending_.erase(it);
+  }
+}
+
+void Device::CopyEngineModel::update(Direction direction, uint sizeClass, Engine engine,
+                                     double bandwidth) {
+  Sample& sample = samples_[direction][sizeClass][engine];
+  sample.bandwidth_ = (sample.count_ == 0) ? bandwidth :
+      (sample.bandwidth_ + kCopySampleWeight * (bandwidth - sample.bandwidth_));
+  ++sample.count_;
+}
+
+int Device::CopyEngineModel::nearestClass(Direction direction, uint sizeClass) const {
+  const int copyClass = static_cast<int>(sizeClass);
+  for (int distance = 0; distance < static_cast<int>(kSizeClasses); ++distance) {
+    for (int candidate : {copyClass - distance, copyClass + distance}) {
+      if ((candidate >= 0) && (candidate < static_cast<int>(kSizeClasses)) &&
+          (samples_[direction][candidate][Sdma].count_ != 0) &&
+          (samples_[direction][candidate][Blit].count_ != 0)) {
+        return candidate;
+      }
+    }
+  }
+  return -1;
+}
+
+Device::CopyEngineModel::Engine Device::CopyEngineModel::select(Direction direction,
+                                                                size_t size) {
+  amd::ScopedLock l(lock_);
+  if (!calibrated_) {
+    calibrate();
+  }
+  harvest();
+
+  const uint copyClass = sizeClass(size);
+  const int nearest = nearestClass(direction, copyClass);
+  Engine engine;
+  if (nearest < 0) {
+    // Without the measurements keep the static threshold
+    engine = (size <= dev_.settings().sdmaCopyThreshold_) ? Blit : Sdma;
+  } else {
+    const Sample* sample = samples_[direction][nearest];
+    engine = (sample[Blit].bandwidth_ > sample[Sdma].bandwidth_) ? Blit : Sdma;
+  }
+  // Try the other engine periodically, so the model follows the changes of the load
+  if ((++selects_[direction][copyClass] % kExploreRate) == 0) {
+    engine = (engine == Sdma) ? Blit : Sdma;
+  }
+  return engine;
+}
+
+void Device::CopyEngineModel::track(Direction direction, Engine engine, size_t size,
+                                    ProfilingSignal* signal) {
+  amd::ScopedLock l(lock_);
+  if (pending_.size() >= kMaxPending) {
+    harvest();
+    if (pending_.size() >= kMaxPending) {
+      return;
+    }
+  }
+  // HwQueueTracker allocates a new signal on the reuse, since the reference count is bigger
+  signal->retain();
+  pending_.push_back({signal, direction, engine, size});
+}
+
+double Device::CopyEngineModel::bandwidth(Direction direction, size_t size,
+                                          Engine engine) const {
+  amd::ScopedLock l(lock_);
+  const int copyClass = static_cast<int>(sizeClass(size));
+  for (int distance = 0; distance < static_cast<int>(kSizeClasses); ++distance) {
+    for (int candidate : {copyClass - distance, copyClass + distance}) {
+      if ((candidate >= 0) && (candidate < static_cast<int>(kSizeClasses)) &&
+          (samples_[direction][candidate][engine].count_ != 0)) {
+        return samples_[direction][candidate][engine].bandwidth_;
+      }
+    }
+  }
+  return 0.0;
+}
+
+void Device::CopyEngineModel::print() const {
+  static const char* kDirections[DirectionTotal] = {"H2D", "D2H", "P2P"};
+  amd::ScopedLock l(lock_);
+  for (uint direction = 0; direction < DirectionTotal; ++direction) {
+    for (uint copyClass = 0; copyClass < kSizeClasses; ++copyClass) {
+      const Sample* sample = samples_[direction][copyClass];
+      if ((sample[Sdma].count_ != 0) || (sample[Blit].count_ != 0)) {
+        ClPrint(amd::LOG_INFO, amd::LOG_COPY, "Copy engine model %s %zu bytes: "
+                "SDMA %.2f GB/s (%u), blit %.2f GB/s (%u)", kDirections[direction],
+                static_cast<size_t>(1) << copyClass, sample[Sdma].bandwidth_,
+                sample[Sdma].count_, sample[Blit].bandwidth_, sample[Blit].count_);
+      }
+    }
+  }
+}
+
+Device::PageableXferModel::PageableXferModel(size_t maxSize)
+    : maxSize_(maxSize), samples_(), selects_(), lock_("Pageable transfer model", true) {}
+
+uint Device::PageableXferModel::sizeClass(size_t size) {
+  uint sizeClass = 0;
+  while ((size > 1) && (sizeClass < (kSizeClasses - 1))) {
+    size >>= 1;
+    ++sizeClass;
+  }
+  return sizeClass;
+}
+
+Device::PageableXferModel::Path Device::PageableXferModel::select(bool write, size_t size,
+                                                                  bool* measure) {
+  amd::ScopedLock l(lock_);
+  const uint copyClass = sizeClass(size);
+  const Sample* sample = samples_[write ? 1 : 0][copyClass];
+  // Warm up both paths first
+  *measure = true;
+  for (uint path = Staged; path < PathTotal; ++path) {
+    if (sample[path].count_ < kMinSamples) {
+      return static_cast<Path>(path);
+    }
+  }
+  Path path = (sample[Direct].bandwidth_ > sample[Staged].bandwidth_) ? Direct : Staged;
+  // Try the other path periodically, so the model follows the changes of the load
+  *measure = (++selects_[write ? 1 : 0][copyClass] % kExploreRate) == 0;
+  if (*measure) {
+    path = (path == Direct) ? Staged : Direct;
+  }
+  return path;
+}
+
+void Device::PageableXferModel::update(bool write, size_t size, Path path, uint64_t time) {
+  if (time == 0) {
+    return;
+  }
+  amd::ScopedLock l(lock_);
+  const double bandwidth = static_cast<double>(size) / time;
+  Sample& sample = samples_[write ? 1 : 0][sizeClass(size)][path];
+  sample.bandwidth_ = (sample.count_ == 0) ? bandwidth :
+      (sample.bandwidth_ + kCopySampleWeight * (bandwidth - sample.bandwidth_));
+  ++sample.count_;
+  ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "Pageable %s %zu bytes: %s %.2f GB/s",
+          write ? "H2D" : "D2H", size, (path == Direct) ? "direct" : "staged", bandwidth);
+}
+
+Device::Oversubscription::Oversubscription(const Device& dev)
+    : dev_(dev), granularity_(dev.VirtualGranularity()), clock_(0), signal_(),
+      lock_("Oversubscription lock", true) {}
+
+Device::Oversubscription::~Oversubscription() {
+  // The app must free the buffers, but release the leftovers anyway
+  while (!entries_.empty()) {
+    free(entries_.begin()->first);
+  }
+  if (signal_.handle != 0) {
+    hsa_signal_destroy(signal_);
+  }
+}
+
+bool Device::Oversubscription::create() {
+  return (granularity_ != 0) &&
+         (HSA_STATUS_SUCCESS == hsa_signal_create(kInitSignalValueOne, 0, nullptr, &signal_));
+}
+
+bool Device::Oversubscription::copy(void* dst, const void* src, size_t size, bool toHost) {
+  const hsa_agent_t gpu = dev_.getBackendDevice();
+  const hsa_agent_t cpu = dev_.getCpuAgent();
+  hsa_signal_store_relaxed(signal_, kInitSignalValueOne);
+  // Different agents on both sides force the SDMA engine
+  hsa_status_t status = hsa_amd_memory_async_copy(dst, toHost ? cpu : gpu, src,
+                                                  toHost ? gpu : cpu, size, 0, nullptr, signal_);
+  if (status != HSA_STATUS_SUCCESS) {
+    LogPrintfError("Oversubscription copy failed with status: %d", status);
+    return false;
+  }
+  hsa_signal_wait_scacquire(signal_, HSA_SIGNAL_CONDITION_LT, kInitSignalValueOne,
+                            std::numeric_limits<uint64_t>::max(), HSA_WAIT_STATE_BLOCKED);
+  return true;
+}
+
+bool Device::Oversubscription::map(address base, Entry& entry) {
+  uint64_t handle = 0;
+  // Make room for the buffer, if the physical memory is exhausted
+  while (!dev_.PhysicalCreate(entry.size_, false, &handle)) {
+    if (!dev_.reclaimMemory(entry.size_)) {
+      return false;
+    }
+  }
+  if (!dev_.VirtualMap(base, entry.size_, 0, handle) ||
+      !dev_.VirtualSetAccess(base, entry.size_, false)) {
+#if defined(ROCCLR_SUPPORT_VMM)
+    hsa_amd_vmem_unmap(base, entry.size_);
+#endif
+    dev_.PhysicalRelease(handle);
+    return false;
+  }
+  entry.handle_ = handle;
+  return true;
+}
+
+void* Device::Oversubscription::allocate(size_t size) {
+  const size_t alignedSize = amd::alignUp(size, granularity_);
+  address base = reinterpret_cast<address>(dev_.VirtualReserve(nullptr, alignedSize));
+  if (base == nullptr) {
+    return nullptr;
+  }
+  amd::ScopedLock lock(lock_);
+  Entry entry = {alignedSize, 0, nullptr, nullptr, clock_};
+  if (!map(base, entry)) {
+    LogPrintfError("Oversubscription failed to allocate 0x%zx bytes", size);
+    dev_.VirtualFree(base, alignedSize);
+    dev_.memoryUsage().report(dev_.index(), size);
+    return nullptr;
+  }
+  entries_[base] = entry;
+  ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Oversubscription allocated %p, size 0x%zx",
+          base, alignedSize);
+  return base;
+}
+
+bool Device::Oversubscription::free(void* ptr) {
+  amd::ScopedLock lock(lock_);
+  auto it = entries_.find(reinterpret_cast<address>(ptr));
+  if (it == entries_.end()) {
+    return false;
+  }
+  Entry& entry = it->second;
+  if (entry.handle_ != 0) {
+#if defined(ROCCLR_SUPPORT_VMM)
+    hsa_amd_vmem_unmap(it->first, entry.size_);
+#endif
+    dev_.PhysicalRelease(entry.handle_);
+  } else {
+    dev_.hostFree(entry.host_, entry.size_);
+  }
+  dev_.VirtualFree(it->first, entry.size_);
+  entries_.erase(it);
+  return true;
+}
+
+bool Device::Oversubscription::evictEntry(address base, Entry& entry) {
+  void* host = dev_.hostAlloc(entry.size_, 0);
+  if ((host == nullptr) || !copy(host, base, entry.size_, true)) {
+    if (host != nullptr) {
+      dev_.hostFree(host, entry.size_);
+    }
+    return false;
+  }
+  // Unmap directly, since the memory object over the range must stay valid
+#if defined(ROCCLR_SUPPORT_VMM)
+  if (HSA_STATUS_SUCCESS != hsa_amd_vmem_unmap(base, entry.size_)) {
+    dev_.hostFree(host, entry.size_);
+    return false;
+  }
+#endif
+  dev_.PhysicalRelease(entry.handle_);
+  entry.handle_ = 0;
+  entry.host_ = host;
+  ClPrint(amd::LOG_INFO, amd::LOG_MEM, "Oversubscription evicted %p, size 0x%zx",
+          base, entry.size_);
+  return true;
+}
+
+bool Device::Oversubscription::restoreEntry(address base, Entry& entry) {
+  if (!map(base, entry)) {
+    return false;
+  }
+  if (!copy(base, entry.host_, entry.size_, false)) {
+    return false;
+  }
+  dev_.hostFree(entry.host_, entry.size_);
+  entry.host_ = nullptr;
+  ClPrint(amd::LOG_INFO, amd::LOG_MEM, "Oversubscription restored %p, size 0x%zx",
+          base, entry.size_);
+  return true;
+}
+
+bool Device::Oversubscription::use(VirtualGPU& gpu, const void* ptr) {
+  amd::ScopedLock lock(lock_);
+  // Find the buffer, which contains the pointer, since views use the parent's memory
+  auto it = entries_.upper_bound(reinterpret_cast<address>(const_cast<void*>(ptr)));
+  if (it == entries_.begin()) {
+    return true;
+  }
+  --it;
+  Entry& entry = it->second;
+  if (reinterpret_cast<const_address>(ptr) >= (it->first + entry.size_)) {
+    return true;
+  }
+  // Mark the use first, so the restore doesn't evict the buffer of the current command
+  entry.gpu_ = &gpu;
+  entry.lastUse_ = gpu.residencyEpoch();
+  if ((entry.handle_ == 0) && !restoreEntry(it->first, entry)) {
+    LogPrintfError("Oversubscription failed to restore %p, size 0x%zx", it->first, entry.size_);
+    return false;
+  }
+  return true;
+}
+
+bool Device::Oversubscription::evict(size_t size) {
+  amd::ScopedLock lock(lock_);
+  std::vector<std::pair<uint64_t, address>> candidates;
+  for (const auto& it : entries_) {
+    if (it.second.handle_ != 0) {
+      candidates.push_back(std::make_pair(it.second.lastUse_, it.first));
+    }
+  }
+  // The least recently used buffers go first
+  std::sort(candidates.begin(), candidates.end());
+
+  size_t released = 0;
+  for (const auto& candidate : candidates) {
+    Entry& entry = entries_[candidate.second];
+    VirtualGPU* gpu = entry.gpu_;
+    if (gpu != nullptr) {
+      // The buffers of the current command on the queue can't be evicted
+      if (entry.lastUse_ >= gpu->residencyEpoch()) {
+        continue;
+      }
+      // Skip the queues, which are busy on the other threads, so the locks can't deadlock.
+      // @note Only the last queue is tracked, hence the buffer must be synchronized
+      //       between the queues with the user events
+      if (!gpu->execution().tryLock()) {
+        continue;
+      }
+      // Make sure GPU is done with the buffer. The queue states aren't reset, since
+      // the wait can occur in the middle of a command on the same queue
+      bool idle = gpu->releaseGpuMemoryFence(true) && gpu->Barriers().WaitCurrent();
+      gpu->execution().unlock();
+      if (!idle) {
+        continue;
+      }
+    }
+    if (evictEntry(candidate.second, entry)) {
+      entry.gpu_ = nullptr;
+      released += entry.size_;
+      if (released >= size) {
+        break;
+      }
+    }
+  }
+  return released != 0;
+}
+
+void Device::Oversubscription::removeQueue(const VirtualGPU* gpu) {
+  amd::ScopedLock lock(lock_);
+  for (auto& it : entries_) {
+    if (it.second.gpu_ == gpu) {
+      it.second.gpu_ = nullptr;
+    }
+  }
 }
 
 bool Device::init() {
@@ -537,6 +1542,7 @@ bool Device::init() {
 
 extern const char* SchedulerSourceCode;
 extern const char* GwsInitSourceCode;
+extern const char* PatchDispatchSourceCode;
 
 void Device::tearDown() {
   NullDevice::tearDown();
@@ -544,6 +1550,7 @@ void Device::tearDown() {
 }
 
 bool Device::create() {
+  amd::InitPhase phase("roc::Device::create");
   char agent_name[64] = {0};
   if (HSA_STATUS_SUCCESS != hsa_agent_get_info(_bkendDevice, HSA_AGENT_INFO_NAME, agent_name)) {
     LogError("Unable to get HSA device name");
@@ -721,17 +1728,10 @@ bool Device::create() {
     return false;
   }
 
-  mapCacheOps_ = new amd::Monitor("Map Cache Lock", true);
-  if (nullptr == mapCacheOps_) {
-    return false;
-  }
-
-  mapCache_ = new std::vector<amd::Memory*>();
+  mapCache_ = new device::MapCache(GPU_MAP_CACHE_SIZE * Mi, &memoryUsage());
   if (mapCache_ == nullptr) {
     return false;
   }
-  // Use just 1 entry by default for the map cache
-  mapCache_->push_back(nullptr);
 
   if ((glb_ctx_ == nullptr) && (gpu_agents_.size() >= 1) &&
       // Allow creation for the last device in the list.
@@ -771,38 +1771,92 @@ bool Device::create() {
     }
   }
 
-  if (settings().stagedXferSize_ != 0) {
-    // Initialize staged write buffers
-    if (settings().stagedXferWrite_) {
-      xferWrite_ = new XferBuffers(*this, amd::alignUp(settings().stagedXferSize_, 4 * Ki));
-      if ((xferWrite_ == nullptr) || !xferWrite_->create()) {
-        LogError("Couldn't allocate transfer buffer objects for read");
-        return false;
-      }
+  // The staging pools allocate the buffers on the first transfer, so the devices
+  // without the staged transfers don't reserve the memory
+  if (settings().stagedXferSize_ != 0) {
+    // Initialize staged write buffers
+    if (settings().stagedXferWrite_) {
+      xferWrite_ = new XferBuffers(*this, amd::alignUp(settings().stagedXferSize_, 4 * Ki), true);
+      if (xferWrite_ == nullptr) {
+        LogError("Couldn't allocate transfer buffer objects for read");
+        return false;
+      }
+    }
+
+    // Initialize staged read buffers
+    if (settings().stagedXferRead_) {
+      xferRead_ = new XferBuffers(*this, amd::alignUp(settings().stagedXferSize_, 4 * Ki), false);
+      if (xferRead_ == nullptr) {
+        LogError("Couldn't allocate transfer buffer objects for write");
+        return false;
+      }
+    }
+  }
+
+  if (settings().copyEngineModel_) {
+    copyEngineModel_ = new CopyEngineModel(*this);
+    if (copyEngineModel_ == nullptr) {
+      LogError("Couldn't allocate the copy engine model");
+      return false;
+    }
+  }
+
+  if (settings().pinnedCacheSize_ != 0) {
+    pinnedMemCache_ = new PinnedMemCache(settings().pinnedCacheSize_);
+    if (pinnedMemCache_ == nullptr) {
+      LogError("Couldn't allocate the pinned memory cache");
+      return false;
+    }
+  }
+
+  if (settings().slabMaxSize_ >= SlabAllocator::kMinBlockSize) {
+    const hsa_amd_memory_pool_t* pools[] = {&gpuvm_segment_, &gpu_fine_grained_segment_};
+    for (uint i = 0; i < 2; ++i) {
+      if (pools[i]->handle != 0) {
+        slabAllocator_[i] = new SlabAllocator(*this, i != 0, settings().slabMaxSize_);
+        if (slabAllocator_[i] == nullptr) {
+          LogError("Couldn't allocate the slab sub-allocator");
+          return false;
+        }
+      }
+    }
+  }
+
+  if (ROC_HOST_POOL_SIZE != 0) {
+    hostMemPool_ = new HostMemPool(*this, ROC_HOST_POOL_SIZE * Mi);
+    if (hostMemPool_ == nullptr) {
+      LogError("Couldn't allocate the pinned host memory pool");
+      return false;
+    }
+  }
+
+  // The direct GPU access to pageable memory requires the page faults with XNACK
+  if ((ROC_HMM_DIRECT_XFER_SIZE != 0) && info().hmmSupported_ &&
+      info().hmmCpuMemoryAccessible_ && (isa().xnack() == amd::Isa::Feature::Enabled)) {
+    pageableXferModel_ = new PageableXferModel(ROC_HMM_DIRECT_XFER_SIZE * Ki);
+    if (pageableXferModel_ == nullptr) {
+      LogError("Couldn't allocate the pageable transfer model");
+      return false;
     }
+  }
 
-    // Initialize staged read buffers
-    if (settings().stagedXferRead_) {
-      xferRead_ = new XferBuffers(*this, amd::alignUp(settings().stagedXferSize_, 4 * Ki));
-      if ((xferRead_ == nullptr) || !xferRead_->create()) {
-        LogError("Couldn't allocate transfer buffer objects for write");
+  if (settings().oversubscribe_) {
+    if (VirtualGranularity() == 0) {
+      LogWarning("Memory oversubscription requires the virtual memory management");
+    } else {
+      oversub_ = new Oversubscription(*this);
+      if ((oversub_ == nullptr) || !oversub_->create()) {
+        LogError("Couldn't create the memory oversubscription manager");
         return false;
       }
     }
   }
 
-  // Create signal for HMM prefetch operation on device
-  if (HSA_STATUS_SUCCESS != hsa_signal_create(kInitSignalValueOne, 0, nullptr, &prefetch_signal_)) {
-    return false;
-  }
-
-  // only create arena_mem_object if CPU memory is accessible.
-  if (info_.hmmCpuMemoryAccessible_) {
-    arena_mem_obj_ = new (context()) amd::ArenaMemory(context());
-    if (!arena_mem_obj_->create(nullptr)) {
-      LogError("Arena Memory Creation failed!");
-      arena_mem_obj_->release();
-      arena_mem_obj_ = nullptr;
+  if (ROC_WARM_QUEUES != 0) {
+    // Pre-create the queues of the first streams in the background
+    warmTarget_[QueuePriority::Normal] = std::min(ROC_WARM_QUEUES, GPU_MAX_HW_QUEUES);
+    if ((queueWarmer_.state() < amd::Thread::INITIALIZED) || !queueWarmer_.start(this)) {
+      LogWarning("Couldn't start the queue warm-up thread");
     }
   }
 
@@ -857,11 +1911,13 @@ void Device::ReleaseExclusiveGpuAccess(VirtualGPU& vgpu) const {
 }
 
 bool Device::createBlitProgram() {
+  amd::InitPhase phase("createBlitProgram");
   bool result = true;
   const char* scheduler = nullptr;
 
 #if defined(USE_COMGR_LIBRARY)
-  std::string sch = SchedulerSourceCode;
+  std::string sch = PatchDispatchSourceCode;
+  sch.append(SchedulerSourceCode);
   if (settings().useLightning_) {
     if (info().cooperativeGroups_) {
       sch.append(GwsInitSourceCode);
@@ -1060,10 +2116,8 @@ bool Sampler::create(const amd::Sampler& owner) {
   hsa_ext_sampler_descriptor_t samplerDescriptor;
   fillSampleDescriptor(samplerDescriptor, owner);
 
-  hsa_status_t status = hsa_ext_sampler_create(dev_.getBackendDevice(), &samplerDescriptor, &hsa_sampler);
-
-  if (HSA_STATUS_SUCCESS != status) {
-    DevLogPrintfError("Sampler creation failed with status: %d \n", status);
+  // The descriptor is immutable, hence the samplers with the same state share it
+  if (!dev_.acquireSampler(samplerDescriptor, &hsa_sampler)) {
     return false;
   }
 
@@ -1074,7 +2128,51 @@ bool Sampler::create(const amd::Sampler& owner) {
 }
 
 Sampler::~Sampler() {
-  hsa_ext_sampler_destroy(dev_.getBackendDevice(), hsa_sampler);
+  if (hsa_sampler.handle != 0) {
+    dev_.releaseSampler(hsa_sampler);
+  }
+}
+
+// ================================================================================================
+bool Device::acquireSampler(const hsa_ext_sampler_descriptor_t& desc,
+                            hsa_ext_sampler_t* sampler) const {
+  const uint32_t key = (static_cast<uint32_t>(desc.coordinate_mode) << 16) |
+                       (static_cast<uint32_t>(desc.filter_mode) << 8) |
+                       static_cast<uint32_t>(desc.address_mode);
+  amd::ScopedLock lock(samplerLock_);
+  auto it = samplerCache_.find(key);
+  if (it != samplerCache_.end()) {
+    ++it->second.users_;
+    *sampler = it->second.sampler_;
+    return true;
+  }
+
+  hsa_status_t status = hsa_ext_sampler_create(getBackendDevice(), &desc, sampler);
+  if (HSA_STATUS_SUCCESS != status) {
+    DevLogPrintfError("Sampler creation failed with status: %d \n", status);
+    sampler->handle = 0;
+    return false;
+  }
+  samplerCache_[key] = {*sampler, 1};
+  ClPrint(amd::LOG_INFO, amd::LOG_RESOURCE, "Sampler cache created: 0x%zx, state 0x%x",
+          sampler->handle, key);
+  return true;
+}
+
+// ================================================================================================
+void Device::releaseSampler(hsa_ext_sampler_t sampler) const {
+  amd::ScopedLock lock(samplerLock_);
+  // The cache holds a few entries, one per distinct sampler state
+  for (auto it = samplerCache_.begin(); it != samplerCache_.end(); ++it) {
+    if (it->second.sampler_.handle == sampler.handle) {
+      if (--it->second.users_ == 0) {
+        hsa_ext_sampler_destroy(getBackendDevice(), sampler);
+        samplerCache_.erase(it);
+      }
+      return;
+    }
+  }
+  assert(false && "Sampler isn't in the cache!");
 }
 
 Memory* Device::getGpuMemory(amd::Memory* mem) const {
@@ -1083,6 +2181,7 @@ Memory* Device::getGpuMemory(amd::Memory* mem) const {
 
 // ================================================================================================
 bool Device::populateOCLDeviceConstants() {
+  amd::InitPhase phase("populateOCLDeviceConstants");
   info_.available_ = true;
 
   ::strncpy(info_.name_, isa().targetId(), sizeof(info_.name_) - 1);
@@ -1104,6 +2203,14 @@ bool Device::populateOCLDeviceConstants() {
       ? info_.maxComputeUnits_ / 2
       : info_.maxComputeUnits_;
 
+  uint32_t numShaderEngines = 1;
+  if (HSA_STATUS_SUCCESS !=
+      hsa_agent_get_info(_bkendDevice, (hsa_agent_info_t)HSA_AMD_AGENT_INFO_NUM_SHADER_ENGINES,
+                         &numShaderEngines)) {
+    numShaderEngines = 1;
+  }
+  info_.numberOfShaderEngines = numShaderEngines;
+
   if (HSA_STATUS_SUCCESS != hsa_agent_get_info(_bkendDevice,
                                                (hsa_agent_info_t)HSA_AMD_AGENT_INFO_CACHELINE_SIZE,
                                                &info_.globalMemCacheLineSize_)) {
@@ -1241,6 +2348,7 @@ bool Device::populateOCLDeviceConstants() {
   }
 
   freeMem_ = info_.globalMemSize_;
+  reclaimWatermark_ = static_cast<size_t>(info_.globalMemSize_ / 100 * ROC_RECLAIM_WATERMARK);
 
   // Make sure the max allocation size is not larger than the available memory size.
   info_.maxMemAllocSize_ = std::min(info_.maxMemAllocSize_, info_.globalMemSize_);
@@ -1683,73 +2791,11 @@ bool Device::unbindExternalDevice(uint flags, void* const gfxDevice[], void* gfx
 }
 
 amd::Memory* Device::findMapTarget(size_t size) const {
-  // Must be serialised for access
-  amd::ScopedLock lk(*mapCacheOps_);
-
-  amd::Memory* map = nullptr;
-  size_t minSize = 0;
-  size_t maxSize = 0;
-  uint mapId = mapCache_->size();
-  uint releaseId = mapCache_->size();
-
-  // Find if the list has a map target of appropriate size
-  for (uint i = 0; i < mapCache_->size(); i++) {
-    if ((*mapCache_)[i] != nullptr) {
-      // Requested size is smaller than the entry size
-      if (size < (*mapCache_)[i]->getSize()) {
-        if ((minSize == 0) || (minSize > (*mapCache_)[i]->getSize())) {
-          minSize = (*mapCache_)[i]->getSize();
-          mapId = i;
-        }
-      }
-      // Requeted size matches the entry size
-      else if (size == (*mapCache_)[i]->getSize()) {
-        mapId = i;
-        break;
-      } else {
-        // Find the biggest map target in the list
-        if (maxSize < (*mapCache_)[i]->getSize()) {
-          maxSize = (*mapCache_)[i]->getSize();
-          releaseId = i;
-        }
-      }
-    }
-  }
-
-  // Check if we found any map target
-  if (mapId < mapCache_->size()) {
-    map = (*mapCache_)[mapId];
-    (*mapCache_)[mapId] = nullptr;
-  }
-  // If cache is full, then release the biggest map target
-  else if (releaseId < mapCache_->size()) {
-    (*mapCache_)[releaseId]->release();
-    (*mapCache_)[releaseId] = nullptr;
-  }
-
-  return map;
+  return mapCache_->find(size);
 }
 
 bool Device::addMapTarget(amd::Memory* memory) const {
-  // Must be serialised for access
-  amd::ScopedLock lk(*mapCacheOps_);
-
-  // the svm memory shouldn't be cached
-  if (!memory->canBeCached()) {
-    return false;
-  }
-  // Find if the list has a map target of appropriate size
-  for (uint i = 0; i < mapCache_->size(); ++i) {
-    if ((*mapCache_)[i] == nullptr) {
-      (*mapCache_)[i] = memory;
-      return true;
-    }
-  }
-
-  // Add a new entry
-  mapCache_->push_back(memory);
-
-  return true;
+  return mapCache_->add(memory);
 }
 
 Memory* Device::getRocMemory(amd::Memory* mem) const {
@@ -1784,10 +2830,8 @@ device::Memory* Device::createMemory(amd::Memory& owner) const {
   }
   // Initialize if the memory is a pipe object
   if (owner.getType() == CL_MEM_OBJECT_PIPE) {
-    // Pipe initialize in order read_idx, write_idx, end_idx. Refer clk_pipe_t structure.
-    // Init with 3 DWORDS for 32bit addressing and 6 DWORDS for 64bit
-    size_t pipeInit[3] = { 0, 0, owner.asPipe()->getMaxNumPackets() };
-    xferMgr().writeBuffer(pipeInit, *memory, amd::Coord3D(0), amd::Coord3D(sizeof(pipeInit)));
+    const amd::Pipe::Header pipeInit = owner.asPipe()->initialHeader();
+    xferMgr().writeBuffer(&pipeInit, *memory, amd::Coord3D(0), amd::Coord3D(sizeof(pipeInit)));
   }
 
   // Transfer data only if OCL context has one device.
@@ -1877,17 +2921,27 @@ void* Device::hostAlloc(size_t size, size_t alignment, MemorySegment mem_seg) co
   }
 
   assert(segment.handle != 0);
+  if ((hostMemPool_ != nullptr) && hostMemPool_->fits(size)) {
+    return hostMemPool_->allocate(segment, size);
+  }
+  return hsaHostAlloc(segment, size);
+}
+
+// ================================================================================================
+void* Device::hsaHostAlloc(const hsa_amd_memory_pool_t& segment, size_t size) const {
+  void* ptr = nullptr;
   hsa_status_t stat = hsa_amd_memory_pool_allocate(segment, size, 0, &ptr);
   ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Allocate hsa host memory %p, size 0x%zx", ptr, size);
   if (stat != HSA_STATUS_SUCCESS) {
     LogPrintfError("Fail allocation host memory with err %d", stat);
+    memoryUsage().report(index(), size);
     return nullptr;
   }
 
   stat = hsa_amd_agents_allow_access(gpu_agents_.size(), &gpu_agents_[0], nullptr, ptr);
   if (stat != HSA_STATUS_SUCCESS) {
-    LogPrintfError("Fail hsa_amd_agents_alloc_access with err %d", stat);
-    hostFree(ptr, size);
+    LogPrintfError("Fail hsa_amd_agents_allow_access with err %d", stat);
+    hsa_amd_memory_pool_free(ptr);
     return nullptr;
   }
 
@@ -1896,28 +2950,16 @@ void* Device::hostAlloc(size_t size, size_t alignment, MemorySegment mem_seg) co
 
 // ================================================================================================
 void* Device::hostAgentAlloc(size_t size, const AgentInfo& agentInfo, bool atomics) const {
-  void* ptr = nullptr;
   const hsa_amd_memory_pool_t segment =
       // If runtime disables barrier, then all host allocations must have L2 disabled
       !atomics ? (agentInfo.coarse_grain_pool.handle != 0) ?
               agentInfo.coarse_grain_pool : agentInfo.fine_grain_pool
                : agentInfo.fine_grain_pool;
   assert(segment.handle != 0);
-  hsa_status_t stat = hsa_amd_memory_pool_allocate(segment, size, 0, &ptr);
-  ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Allocate hsa host memory %p, size 0x%zx", ptr, size);
-  if (stat != HSA_STATUS_SUCCESS) {
-    LogPrintfError("Fail allocation host memory with err %d", stat);
-    return nullptr;
-  }
-
-  stat = hsa_amd_agents_allow_access(gpu_agents_.size(), &gpu_agents_[0], nullptr, ptr);
-  if (stat != HSA_STATUS_SUCCESS) {
-    LogPrintfError("Fail hsa_amd_agents_allow_access with err %d", stat);
-    hostFree(ptr, size);
-    return nullptr;
+  if ((hostMemPool_ != nullptr) && hostMemPool_->fits(size)) {
+    return hostMemPool_->allocate(segment, size);
   }
-
-  return ptr;
+  return hsaHostAlloc(segment, size);
 }
 
 // ================================================================================================
@@ -1962,7 +3004,12 @@ void* Device::hostNumaAlloc(size_t size, size_t alignment, bool atomics) const {
   return ptr;
 }
 
-void Device::hostFree(void* ptr, size_t size) const { memFree(ptr, size); }
+void Device::hostFree(void* ptr, size_t size) const {
+  if (pinnedMemCache_ != nullptr) {
+    pinnedMemCache_->invalidate(ptr, std::max(size, static_cast<size_t>(1)));
+  }
+  memFree(ptr, size);
+}
 
 bool Device::enableP2P(amd::Device* ptrDev) {
   assert(ptrDev != nullptr);
@@ -1973,6 +3020,12 @@ bool Device::enableP2P(amd::Device* ptrDev) {
     enabled_p2p_devices_.push_back(peerDev);
     // Update access to all old allocations
     amd::MemObjMap::UpdateAccess(static_cast<amd::Device*>(this));
+    // The free blocks in the slabs will be allocated without the access update
+    for (const auto slabs : slabAllocator_) {
+      if (slabs != nullptr) {
+        slabs->allowPeerAccess();
+      }
+    }
   }
   return true;
 }
@@ -1990,6 +3043,13 @@ bool Device::disableP2P(amd::Device* ptrDev) {
 }
 
 bool Device::deviceAllowAccess(void* ptr) const {
+  // ROCr grants the access to the whole allocation, hence use the slab of a sub-allocation
+  for (const auto slabs : slabAllocator_) {
+    size_t size = 0;
+    if ((slabs != nullptr) && slabs->findSlab(ptr, &ptr, &size)) {
+      break;
+    }
+  }
   std::lock_guard<std::mutex> lock(lock_allow_access_);
   if (!p2pAgents().empty()) {
     hsa_status_t stat = hsa_amd_agents_allow_access(p2pAgents().size(),
@@ -2002,7 +3062,20 @@ bool Device::deviceAllowAccess(void* ptr) const {
   return true;
 }
 
-void* Device::deviceLocalAlloc(size_t size, bool atomics) const {
+void* Device::deviceLocalAlloc(size_t size, bool atomics, bool subAlloc) const {
+  // The big user buffers can be evicted, if device memory is oversubscribed
+  if (subAlloc && !atomics && (oversub_ != nullptr) && oversub_->fits(size)) {
+    return oversub_->allocate(size);
+  }
+
+  SlabAllocator* slabs = slabAllocator(atomics);
+  if (subAlloc && (slabs != nullptr) && slabs->fits(size)) {
+    void* ptr = slabs->allocate(size);
+    if (ptr != nullptr) {
+      return ptr;
+    }
+  }
+
   const hsa_amd_memory_pool_t& pool = (atomics)? gpu_fine_grained_segment_ : gpuvm_segment_;
 
   if (pool.handle == 0 || gpuvm_segment_max_alloc_ == 0) {
@@ -2013,9 +3086,14 @@ void* Device::deviceLocalAlloc(size_t size, bool atomics) const {
 
   void* ptr = nullptr;
   hsa_status_t stat = hsa_amd_memory_pool_allocate(pool, size, 0, &ptr);
+  // Trim the runtime caches and retry, so the failure means the real exhaustion
+  while ((stat != HSA_STATUS_SUCCESS) && reclaimMemory(size)) {
+    stat = hsa_amd_memory_pool_allocate(pool, size, 0, &ptr);
+  }
   ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Allocate hsa device memory %p, size 0x%zx", ptr, size);
   if (stat != HSA_STATUS_SUCCESS) {
     LogError("Fail allocation local memory");
+    memoryUsage().report(index(), size);
     return nullptr;
   }
 
@@ -2028,6 +3106,20 @@ void* Device::deviceLocalAlloc(size_t size, bool atomics) const {
 }
 
 void Device::memFree(void* ptr, size_t size) const {
+  if ((oversub_ != nullptr) && oversub_->free(ptr)) {
+    return;
+  }
+  if ((hostMemPool_ != nullptr) && hostMemPool_->free(ptr)) {
+    return;
+  }
+
+  // The small allocations can belong to the slabs. Zero size means the size is unknown
+  for (const auto slabs : slabAllocator_) {
+    if ((slabs != nullptr) && slabs->fits(size) && slabs->free(ptr)) {
+      return;
+    }
+  }
+
   hsa_status_t stat = hsa_amd_memory_pool_free(ptr);
   ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Free hsa memory %p", ptr);
   if (stat != HSA_STATUS_SUCCESS) {
@@ -2035,8 +3127,36 @@ void Device::memFree(void* ptr, size_t size) const {
   }
 }
 
+bool Device::reclaimMemory(size_t size, bool evict) const {
+  // The cheapest caches go first. The map targets and the staging buffers are allocated again
+  // on the next use only, the empty slabs save the pool allocations for the small buffers
+  // and the eviction of the user buffers requires the copies
+  size_t released = 0;
+  if (mapCache_ != nullptr) {
+    released += mapCache_->trim(size);
+  }
+  for (auto xfer : {xferWrite_, xferRead_}) {
+    if ((released < size) && (xfer != nullptr)) {
+      released += xfer->trim();
+    }
+  }
+  for (const auto slabs : slabAllocator_) {
+    if ((released < size) && (slabs != nullptr)) {
+      released += slabs->trim();
+    }
+  }
+  bool evicted = false;
+  if ((released < size) && evict && (oversub_ != nullptr)) {
+    evicted = oversub_->evict(size - released);
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_MEM, "Reclaimed 0x%zx bytes of the runtime caches for 0x%zx, "
+          "evicted: %d", released, size, evicted);
+  return (released != 0) || evicted;
+}
+
 void Device::updateFreeMemory(size_t size, bool free) {
   if (free) {
+    memoryUsage().remove(VDI_MEMORY_USER, size);
     freeMem_ += size;
   }
   else {
@@ -2048,9 +3168,18 @@ void Device::updateFreeMemory(size_t size, bool free) {
              "Free memory set to zero on device 0x%lx, requested size = 0x%x, freeMem_ = 0x%x",
              this, size, freeMem_.load());
       freeMem_ = 0;
+      memoryUsage().add(VDI_MEMORY_USER, size);
+      if (reclaimWatermark_ != 0) {
+        reclaimMemory(reclaimWatermark_, false);
+      }
       return;
     }
+    memoryUsage().add(VDI_MEMORY_USER, size);
     freeMem_ -= size;
+    if (freeMem_ < reclaimWatermark_) {
+      // Release the cached memory ahead of the allocation failures
+      reclaimMemory(reclaimWatermark_ - freeMem_, false);
+    }
   }
   ClPrint(amd::LOG_INFO, amd::LOG_MEM, "device=0x%lx, freeMem_ = 0x%x", this, freeMem_.load());
 }
@@ -2093,6 +3222,19 @@ bool Device::IpcCreate(void* dev_ptr, size_t* mem_size, void* handle, size_t* me
     return false;
   }
 
+  // IPC shares ROCr allocations, so a sub-allocated buffer is exported with the whole slab
+  for (const auto slabs : slabAllocator_) {
+    void* slabBase = nullptr;
+    size_t slabSize = 0;
+    if ((slabs != nullptr) && slabs->findSlab(orig_dev_ptr, &slabBase, &slabSize)) {
+      *mem_offset += reinterpret_cast<address>(orig_dev_ptr) -
+                     reinterpret_cast<address>(slabBase);
+      *mem_size = slabSize;
+      orig_dev_ptr = slabBase;
+      break;
+    }
+  }
+
   // Pass the pointer and memory size to retrieve the handle
   hsa_status = hsa_amd_ipc_memory_create(orig_dev_ptr, amd::alignUp(*mem_size, alloc_granularity()),
                                          reinterpret_cast<hsa_amd_ipc_memory_t*>(handle));
@@ -2110,11 +3252,30 @@ bool Device::IpcAttach(const void* handle, size_t mem_size, size_t mem_offset,
   amd::Memory* amd_mem_obj = nullptr;
   hsa_status_t hsa_status = HSA_STATUS_SUCCESS;
   void* orig_dev_ptr = nullptr;
+  const hsa_amd_ipc_memory_t* ipc_handle = reinterpret_cast<const hsa_amd_ipc_memory_t*>(handle);
+
+  //Make sure the mem_offset doesnt overflow the allocated memory
+  guarantee((mem_offset < mem_size) && "IPC mem offset greater than allocated size");
+
+  amd::ScopedLock lock(ipcLock_);
+
+  // Reuse the import of the same allocation, so ROCr attach is skipped
+  for (auto it = ipcImports_.begin(); it != ipcImports_.end(); ++it) {
+    if ((memcmp(&it->handle_, ipc_handle, sizeof(hsa_amd_ipc_memory_t)) == 0) &&
+        (it->size_ == mem_size)) {
+      it->memory_->retain();
+      it->users_++;
+      *dev_ptr = it->ptr_;
+      ipcImports_.splice(ipcImports_.begin(), ipcImports_, it);
+      ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "IPC import cache hit: %p, users %u", *dev_ptr,
+              ipcImports_.front().users_);
+      return true;
+    }
+  }
 
   // Retrieve the devPtr from the handle
-  hsa_status = hsa_amd_ipc_memory_attach(reinterpret_cast<const hsa_amd_ipc_memory_t*>(handle),
-                                         mem_size, (1 + p2p_agents_.size()), p2p_agents_list_,
-                                         &orig_dev_ptr);
+  hsa_status = hsa_amd_ipc_memory_attach(ipc_handle, mem_size, (1 + p2p_agents_.size()),
+                                         p2p_agents_list_, &orig_dev_ptr);
 
   if (hsa_status != HSA_STATUS_SUCCESS) {
     LogPrintfError("HSA failed to attach IPC memory with status: %d \n", hsa_status);
@@ -2128,26 +3289,28 @@ bool Device::IpcAttach(const void* handle, size_t mem_size, size_t mem_offset,
     amd_mem_obj = new (context()) amd::Buffer(context(), flags, mem_size, orig_dev_ptr);
     if (amd_mem_obj == nullptr) {
       LogError("failed to create a mem object!");
+      hsa_amd_ipc_memory_detach(orig_dev_ptr);
       return false;
     }
 
     if (!amd_mem_obj->create(nullptr)) {
       LogError("failed to create a svm hidden buffer!");
       amd_mem_obj->release();
+      hsa_amd_ipc_memory_detach(orig_dev_ptr);
       return false;
     }
 
     // Add the original mem_ptr to the MemObjMap with newly created amd_mem_obj
     amd::MemObjMap::AddMemObj(orig_dev_ptr, amd_mem_obj);
 
+    // The cache holds an extra reference, so the import stays attached after the last detach
+    amd_mem_obj->retain();
+    ipcImports_.push_front({*ipc_handle, mem_size, orig_dev_ptr, amd_mem_obj, 1});
   } else {
     //Memory already exists, just retain the old one.
     amd_mem_obj->retain();
   }
 
-  //Make sure the mem_offset doesnt overflow the allocated memory
-  guarantee((mem_offset < mem_size) && "IPC mem offset greater than allocated size");
-
   // Return orig_dev_ptr
   *dev_ptr = reinterpret_cast<address>(orig_dev_ptr);
 
@@ -2163,6 +3326,24 @@ bool Device::IpcDetach (void* dev_ptr) const {
     return false;
   }
 
+  amd::ScopedLock lock(ipcLock_);
+
+  for (auto it = ipcImports_.begin(); it != ipcImports_.end(); ++it) {
+    if (it->memory_ == amd_mem_obj) {
+      if (it->users_ == 0) {
+        DevLogPrintfError("IPC memory for the ptr: 0x%x is already detached \n", dev_ptr);
+        return false;
+      }
+      amd_mem_obj->release();
+      if (--it->users_ == 0) {
+        // Keep the import attached for the reuse, but move it to the most recent position
+        ipcImports_.splice(ipcImports_.begin(), ipcImports_, it);
+        trimIpcImports(ROC_IPC_CACHE_SIZE);
+      }
+      return true;
+    }
+  }
+
   // Get the original pointer from the amd::Memory object
   void* orig_dev_ptr = nullptr;
   if (amd_mem_obj->getSvmPtr() != nullptr) {
@@ -2187,6 +3368,274 @@ bool Device::IpcDetach (void* dev_ptr) const {
   return true;
 }
 
+void Device::trimIpcImports(size_t limit) const {
+  size_t unused = 0;
+  for (auto it = ipcImports_.begin(); it != ipcImports_.end();) {
+    if ((it->users_ != 0) || (++unused <= limit)) {
+      ++it;
+      continue;
+    }
+    // The least recently used imports are over the limit, hence detach them
+    amd::MemObjMap::RemoveMemObj(it->ptr_);
+    it->memory_->release();
+    hsa_status_t hsa_status = hsa_amd_ipc_memory_detach(it->ptr_);
+    if (hsa_status != HSA_STATUS_SUCCESS) {
+      LogPrintfError("HSA failed to detach memory with status: %d \n", hsa_status);
+    }
+    it = ipcImports_.erase(it);
+  }
+}
+
+// ================================================================================================
+size_t Device::VirtualGranularity() const {
+#if defined(ROCCLR_SUPPORT_VMM)
+  return (gpuvm_segment_.handle != 0) ? alloc_granularity_ : 0;
+#else
+  return 0;
+#endif
+}
+
+// ================================================================================================
+void* Device::VirtualReserve(void* addr, size_t size) const {
+#if defined(ROCCLR_SUPPORT_VMM)
+  void* ptr = nullptr;
+  hsa_status_t hsa_status = hsa_amd_vmem_address_reserve(
+      &ptr, amd::alignUp(size, alloc_granularity_), reinterpret_cast<uint64_t>(addr), 0);
+  if (hsa_status != HSA_STATUS_SUCCESS) {
+    LogPrintfError("HSA failed to reserve virtual memory with status: %d \n", hsa_status);
+    return nullptr;
+  }
+  ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Reserve virtual memory %p, size 0x%zx", ptr, size);
+  return ptr;
+#else
+  LogError("Virtual memory management isn't supported!");
+  return nullptr;
+#endif
+}
+
+// ================================================================================================
+bool Device::VirtualFree(void* addr, size_t size) const {
+#if defined(ROCCLR_SUPPORT_VMM)
+  hsa_status_t hsa_status =
+      hsa_amd_vmem_address_free(addr, amd::alignUp(size, alloc_granularity_));
+  if (hsa_status != HSA_STATUS_SUCCESS) {
+    LogPrintfError("HSA failed to free virtual memory with status: %d \n", hsa_status);
+    return false;
+  }
+  ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Free virtual memory %p", addr);
+  return true;
+#else
+  return false;
+#endif
+}
+
+// ================================================================================================
+bool Device::PhysicalCreate(size_t size, bool atomics, uint64_t* handle) const {
+#if defined(ROCCLR_SUPPORT_VMM)
+  const hsa_amd_memory_pool_t& pool = (atomics) ? gpu_fine_grained_segment_ : gpuvm_segment_;
+  if ((pool.handle == 0) || ((size % alloc_granularity_) != 0)) {
+    DevLogPrintfError("Invalid argument, pool_handle: 0x%x , size: %zu \n", pool.handle, size);
+    return false;
+  }
+  hsa_amd_vmem_alloc_handle_t vmem = {};
+  hsa_status_t hsa_status = hsa_amd_vmem_handle_create(pool, size, MEMORY_TYPE_NONE, 0, &vmem);
+  if (hsa_status != HSA_STATUS_SUCCESS) {
+    LogPrintfError("HSA failed to create physical memory with status: %d \n", hsa_status);
+    return false;
+  }
+  *handle = vmem.handle;
+  ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Create physical memory 0x%zx, size 0x%zx",
+          static_cast<size_t>(vmem.handle), size);
+  return true;
+#else
+  LogError("Virtual memory management isn't supported!");
+  return false;
+#endif
+}
+
+// ================================================================================================
+bool Device::PhysicalRelease(uint64_t handle) const {
+#if defined(ROCCLR_SUPPORT_VMM)
+  hsa_amd_vmem_alloc_handle_t vmem = {handle};
+  hsa_status_t hsa_status = hsa_amd_vmem_handle_release(vmem);
+  if (hsa_status != HSA_STATUS_SUCCESS) {
+    LogPrintfError("HSA failed to release physical memory with status: %d \n", hsa_status);
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// ================================================================================================
+bool Device::VirtualMap(void* addr, size_t size, size_t offset, uint64_t handle) const {
+#if defined(ROCCLR_SUPPORT_VMM)
+  hsa_amd_vmem_alloc_handle_t vmem = {handle};
+  hsa_status_t hsa_status = hsa_amd_vmem_map(addr, size, offset, vmem, 0);
+  if (hsa_status != HSA_STATUS_SUCCESS) {
+    LogPrintfError("HSA failed to map virtual memory with status: %d \n", hsa_status);
+    return false;
+  }
+  ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Map virtual memory %p, size 0x%zx, offset 0x%zx",
+          addr, size, offset);
+  return true;
+#else
+  return false;
+#endif
+}
+
+// ================================================================================================
+bool Device::VirtualUnmap(void* addr, size_t size) const {
+#if defined(ROCCLR_SUPPORT_VMM)
+  // The view over the range can't outlive the mapping
+  amd::Memory* view = amd::MemObjMap::FindMemObj(addr);
+  if ((view != nullptr) && (view->getSvmPtr() == addr)) {
+    amd::MemObjMap::RemoveMemObj(addr);
+    view->release();
+  }
+  hsa_status_t hsa_status = hsa_amd_vmem_unmap(addr, size);
+  if (hsa_status != HSA_STATUS_SUCCESS) {
+    LogPrintfError("HSA failed to unmap virtual memory with status: %d \n", hsa_status);
+    return false;
+  }
+  ClPrint(amd::LOG_DEBUG, amd::LOG_MEM, "Unmap virtual memory %p, size 0x%zx", addr, size);
+  return true;
+#else
+  return false;
+#endif
+}
+
+// ================================================================================================
+bool Device::VirtualSetAccess(void* addr, size_t size, bool readOnly) const {
+#if defined(ROCCLR_SUPPORT_VMM)
+  const hsa_access_permission_t permission =
+      (readOnly) ? HSA_ACCESS_PERMISSION_RO : HSA_ACCESS_PERMISSION_RW;
+  std::vector<hsa_amd_memory_access_desc_t> access;
+  access.push_back({permission, getBackendDevice()});
+  // Keep the same visibility as the regular device allocations
+  if (isP2pEnabled()) {
+    for (const auto& agent : p2pAgents()) {
+      access.push_back({permission, agent});
+    }
+  }
+  hsa_status_t hsa_status = hsa_amd_vmem_set_access(addr, size, access.data(), access.size());
+  if (hsa_status != HSA_STATUS_SUCCESS) {
+    LogPrintfError("HSA failed to set virtual memory access with status: %d \n", hsa_status);
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// ================================================================================================
+amd::Memory* Device::VirtualView(void* addr, size_t size, cl_mem_flags flags) const {
+  if (amd::MemObjMap::FindMemObj(addr) != nullptr) {
+    LogError("The range already has a memory object!");
+    return nullptr;
+  }
+  // The runtime doesn't own the physical memory, hence the view is a buffer over the given pointer
+  amd::Memory* mem = new (context()) amd::Buffer(context(), flags, size, addr);
+  if (mem == nullptr) {
+    LogError("failed to create a mem object!");
+    return nullptr;
+  }
+  if (!mem->create(nullptr)) {
+    LogError("failed to create a virtual memory view!");
+    mem->release();
+    return nullptr;
+  }
+  // The view is found by the device pointer and released on the unmap of the range
+  amd::MemObjMap::AddMemObj(addr, mem);
+  return mem;
+}
+
+// ================================================================================================
+bool Device::CreateCuPartition(uint32_t percent, std::vector<uint32_t>* mask) {
+  if ((percent == 0) || (percent > 100)) {
+    LogError("Invalid CU partition size!");
+    return false;
+  }
+  // The queue CU mask is in the physical CUs, even in WGP mode
+  uint32_t physicalCUs = 0;
+  if (HSA_STATUS_SUCCESS !=
+      hsa_agent_get_info(_bkendDevice, (hsa_agent_info_t)HSA_AMD_AGENT_INFO_COMPUTE_UNIT_COUNT,
+                         &physicalCUs)) {
+    return false;
+  }
+  const uint32_t numSE = std::max(static_cast<uint32_t>(info_.numberOfShaderEngines), 1u);
+
+  // ROCr distributes the queue CU mask bits over the shader engines round robin,
+  // hence the bit i belongs to the shader engine (i % numSE)
+  std::vector<std::vector<uint32_t>> seCUs(numSE);
+  uint32_t available = 0;
+  for (uint32_t cu = 0; cu < physicalCUs; ++cu) {
+    if (!info_.globalCUMask_.empty() && (((cu / 32) >= info_.globalCUMask_.size()) ||
+        ((info_.globalCUMask_[cu / 32] & (1u << (cu % 32))) == 0))) {
+      continue;
+    }
+    seCUs[cu % numSE].push_back(cu);
+    available++;
+  }
+  if (available == 0) {
+    return false;
+  }
+  const uint32_t requested = std::max((available * percent + 50) / 100, 1u);
+
+  amd::ScopedLock lock(cuPartitionLock_);
+  cuPartitionUsage_.resize(physicalCUs, 0);
+
+  // The least used CUs go first in each shader engine
+  for (auto& cus : seCUs) {
+    std::stable_sort(cus.begin(), cus.end(), [this](uint32_t a, uint32_t b) {
+      return cuPartitionUsage_[a] < cuPartitionUsage_[b];
+    });
+  }
+
+  // Take CUs one by one from the shader engine with the fewest selected CUs,
+  // so the partition is balanced even if the shader engines have different free CUs
+  mask->assign((physicalCUs + 31) / 32, 0);
+  std::vector<uint32_t> taken(numSE, 0);
+  for (uint32_t i = 0; i < requested; ++i) {
+    uint32_t best = numSE;
+    for (uint32_t se = 0; se < numSE; ++se) {
+      if (taken[se] == seCUs[se].size()) {
+        continue;
+      }
+      if ((best == numSE) || (taken[se] < taken[best]) ||
+          ((taken[se] == taken[best]) && (cuPartitionUsage_[seCUs[se][taken[se]]] <
+                                          cuPartitionUsage_[seCUs[best][taken[best]]]))) {
+        best = se;
+      }
+    }
+    const uint32_t cu = seCUs[best][taken[best]++];
+    (*mask)[cu / 32] |= 1u << (cu % 32);
+    cuPartitionUsage_[cu]++;
+  }
+
+  std::stringstream ss;
+  ss << std::hex;
+  for (int i = mask->size() - 1; i >= 0; i--) {
+    ss << (*mask)[i];
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_QUEUE, "CU partition %u%%: %u CUs over %u SEs, mask 0x%s",
+          percent, requested, numSE, ss.str().c_str());
+  return true;
+}
+
+// ================================================================================================
+void Device::ReleaseCuPartition(const std::vector<uint32_t>& mask) {
+  amd::ScopedLock lock(cuPartitionLock_);
+  for (uint32_t cu = 0; cu < cuPartitionUsage_.size(); ++cu) {
+    if (((cu / 32) < mask.size()) && ((mask[cu / 32] & (1u << (cu % 32))) != 0) &&
+        (cuPartitionUsage_[cu] > 0)) {
+      cuPartitionUsage_[cu]--;
+    }
+  }
+}
+
 // ================================================================================================
 void* Device::svmAlloc(amd::Context& context, size_t size, size_t alignment, cl_svm_mem_flags flags,
                        void* svmPtr) const {
@@ -2228,16 +3677,84 @@ void* Device::svmAlloc(amd::Context& context, size_t size, size_t alignment, cl_
   return svmPtr;
 }
 
+// ================================================================================================
+bool Device::ValidateSvmRange(const void* dev_ptr, size_t count) const {
+  amd::Memory* svm_mem = amd::MemObjMap::FindMemObj(dev_ptr);
+  if ((nullptr == svm_mem) || ((svm_mem->getMemFlags() & CL_MEM_ALLOC_HOST_PTR) == 0) ||
+      // Validate the range of provided memory
+      ((svm_mem->getSize() - (reinterpret_cast<const_address>(dev_ptr) -
+        reinterpret_cast<address>(svm_mem->getSvmPtr()))) < count)) {
+    LogPrintfError("SetSvmAttributes received unknown memory for update: %p!", dev_ptr);
+    return false;
+  }
+  return true;
+}
+
+// ================================================================================================
+bool Device::AddSvmAttributes(amd::MemoryAdvice advice, bool first_alloc, bool use_cpu,
+                              std::vector<hsa_amd_svm_attribute_pair_t>* attr) const {
+  switch (advice) {
+    case amd::MemoryAdvice::SetReadMostly:
+      attr->push_back({HSA_AMD_SVM_ATTRIB_READ_MOSTLY, true});
+      break;
+    case amd::MemoryAdvice::UnsetReadMostly:
+      attr->push_back({HSA_AMD_SVM_ATTRIB_READ_MOSTLY, false});
+      break;
+    case amd::MemoryAdvice::SetPreferredLocation:
+      if (use_cpu) {
+        attr->push_back({HSA_AMD_SVM_ATTRIB_PREFERRED_LOCATION, getCpuAgent().handle});
+      } else {
+        attr->push_back({HSA_AMD_SVM_ATTRIB_PREFERRED_LOCATION, getBackendDevice().handle});
+      }
+      break;
+    case amd::MemoryAdvice::UnsetPreferredLocation:
+      // @note: 0 may cause a failure on old runtimes
+      attr->push_back({HSA_AMD_SVM_ATTRIB_PREFERRED_LOCATION, 0});
+      break;
+    case amd::MemoryAdvice::SetAccessedBy: {
+      const uint64_t attrib = (first_alloc) ? HSA_AMD_SVM_ATTRIB_AGENT_ACCESSIBLE :
+                                              HSA_AMD_SVM_ATTRIB_AGENT_ACCESSIBLE_IN_PLACE;
+      if (use_cpu) {
+        attr->push_back({attrib, getCpuAgent().handle});
+      } else {
+        if (first_alloc) {
+          // Provide access to all possible devices.
+          //! @note: HMM should support automatic page table update with xnack enabled,
+          //! but currently it doesn't and runtime explicitly enables access from all devices
+          for (const auto dev : devices()) {
+            // Skip null devices
+            if (static_cast<Device*>(dev)->getBackendDevice().handle != 0) {
+              attr->push_back({attrib, static_cast<Device*>(dev)->getBackendDevice().handle});
+            }
+          }
+        } else {
+          attr->push_back({attrib, getBackendDevice().handle});
+        }
+      }
+      break;
+    }
+    case amd::MemoryAdvice::UnsetAccessedBy:
+      // @note: 0 may cause a failure on old runtimes
+      attr->push_back({HSA_AMD_SVM_ATTRIB_AGENT_ACCESSIBLE_IN_PLACE, 0});
+      break;
+    case amd::MemoryAdvice::SetCoarseGrain:
+      attr->push_back({HSA_AMD_SVM_ATTRIB_GLOBAL_FLAG, HSA_AMD_SVM_GLOBAL_FLAG_COARSE_GRAINED});
+      break;
+    case amd::MemoryAdvice::UnsetCoarseGrain:
+      attr->push_back({HSA_AMD_SVM_ATTRIB_GLOBAL_FLAG, HSA_AMD_SVM_GLOBAL_FLAG_FINE_GRAINED});
+      break;
+    default:
+      return false;
+    break;
+  }
+  return true;
+}
+
 // ================================================================================================
 bool Device::SetSvmAttributesInt(const void* dev_ptr, size_t count,
                               amd::MemoryAdvice advice, bool first_alloc, bool use_cpu) const {
   if ((settings().hmmFlags_ & Settings::Hmm::EnableSvmTracking) && !first_alloc) {
-    amd::Memory* svm_mem = amd::MemObjMap::FindMemObj(dev_ptr);
-    if ((nullptr == svm_mem) || ((svm_mem->getMemFlags() & CL_MEM_ALLOC_HOST_PTR) == 0) ||
-        // Validate the range of provided memory
-        ((svm_mem->getSize() - (reinterpret_cast<const_address>(dev_ptr) -
-          reinterpret_cast<address>(svm_mem->getSvmPtr()))) < count)) {
-      LogPrintfError("SetSvmAttributes received unknown memory for update: %p!", dev_ptr);
+    if (!ValidateSvmRange(dev_ptr, count)) {
       return false;
     }
   }
@@ -2246,60 +3763,8 @@ bool Device::SetSvmAttributesInt(const void* dev_ptr, size_t count,
     if (first_alloc) {
       attr.push_back({HSA_AMD_SVM_ATTRIB_GLOBAL_FLAG, HSA_AMD_SVM_GLOBAL_FLAG_COARSE_GRAINED});
     }
-
-    switch (advice) {
-      case amd::MemoryAdvice::SetReadMostly:
-        attr.push_back({HSA_AMD_SVM_ATTRIB_READ_MOSTLY, true});
-        break;
-      case amd::MemoryAdvice::UnsetReadMostly:
-        attr.push_back({HSA_AMD_SVM_ATTRIB_READ_MOSTLY, false});
-        break;
-      case amd::MemoryAdvice::SetPreferredLocation:
-        if (use_cpu) {
-          attr.push_back({HSA_AMD_SVM_ATTRIB_PREFERRED_LOCATION, getCpuAgent().handle});
-        } else {
-          attr.push_back({HSA_AMD_SVM_ATTRIB_PREFERRED_LOCATION, getBackendDevice().handle});
-        }
-        break;
-      case amd::MemoryAdvice::UnsetPreferredLocation:
-        // @note: 0 may cause a failure on old runtimes
-        attr.push_back({HSA_AMD_SVM_ATTRIB_PREFERRED_LOCATION, 0});
-        break;
-      case amd::MemoryAdvice::SetAccessedBy: {
-        const uint64_t attrib = (first_alloc) ? HSA_AMD_SVM_ATTRIB_AGENT_ACCESSIBLE :
-                                                HSA_AMD_SVM_ATTRIB_AGENT_ACCESSIBLE_IN_PLACE;
-        if (use_cpu) {
-          attr.push_back({attrib, getCpuAgent().handle});
-        } else {
-          if (first_alloc) {
-            // Provide access to all possible devices.
-            //! @note: HMM should support automatic page table update with xnack enabled,
-            //! but currently it doesn't and runtime explicitly enables access from all devices
-            for (const auto dev : devices()) {
-              // Skip null devices
-              if (static_cast<Device*>(dev)->getBackendDevice().handle != 0) {
-                attr.push_back({attrib, static_cast<Device*>(dev)->getBackendDevice().handle});
-              }
-            }
-          } else {
-            attr.push_back({attrib, getBackendDevice().handle});
-          }
-        }
-        break;
-      }
-      case amd::MemoryAdvice::UnsetAccessedBy:
-        // @note: 0 may cause a failure on old runtimes
-        attr.push_back({HSA_AMD_SVM_ATTRIB_AGENT_ACCESSIBLE_IN_PLACE, 0});
-        break;
-      case amd::MemoryAdvice::SetCoarseGrain:
-        attr.push_back({HSA_AMD_SVM_ATTRIB_GLOBAL_FLAG, HSA_AMD_SVM_GLOBAL_FLAG_COARSE_GRAINED});
-        break;
-      case amd::MemoryAdvice::UnsetCoarseGrain:
-        attr.push_back({HSA_AMD_SVM_ATTRIB_GLOBAL_FLAG, HSA_AMD_SVM_GLOBAL_FLAG_FINE_GRAINED});
-        break;
-      default:
-        return false;
-      break;
+    if (!AddSvmAttributes(advice, first_alloc, use_cpu, &attr)) {
+      return false;
     }
 
     hsa_status_t status = hsa_amd_svm_attributes_set(const_cast<void*>(dev_ptr), count,
@@ -2321,6 +3786,49 @@ bool Device::SetSvmAttributes(const void* dev_ptr, size_t count,
   return SetSvmAttributesInt(dev_ptr, count, advice, kFirstAlloc, use_cpu);
 }
 
+// ================================================================================================
+bool Device::SetSvmAttributes(const std::vector<amd::SvmRange>& ranges,
+                              const std::vector<amd::MemoryAdvice>& advices, bool use_cpu) const {
+  if (settings().hmmFlags_ & Settings::Hmm::EnableSvmTracking) {
+    for (const auto& range : ranges) {
+      if (!ValidateSvmRange(range.ptr_, range.size_)) {
+        return false;
+      }
+    }
+  }
+  if (!info().hmmSupported_) {
+    LogWarning("hsa_amd_svm_attributes_set() is ignored, because no HMM support");
+    return true;
+  }
+
+  // The policy is the same for all ranges, hence build the attributes once
+  constexpr bool kFirstAlloc = false;
+  std::vector<hsa_amd_svm_attribute_pair_t> attr;
+  for (const auto advice : advices) {
+    if (!AddSvmAttributes(advice, kFirstAlloc, use_cpu, &attr)) {
+      return false;
+    }
+  }
+  if (attr.empty()) {
+    return true;
+  }
+
+  std::vector<amd::SvmRange> merged(ranges);
+  amd::CoalesceSvmRanges(&merged);
+  for (const auto& range : merged) {
+    hsa_status_t status = hsa_amd_svm_attributes_set(const_cast<void*>(range.ptr_), range.size_,
+                                                    attr.data(), attr.size());
+    if (status != HSA_STATUS_SUCCESS) {
+      LogPrintfError("hsa_amd_svm_attributes_set() failed for %p, size %zu, status: %d",
+                     range.ptr_, range.size_, status);
+      return false;
+    }
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_MEM, "Applied %zu SVM advices to %zu ranges (%zu requested)",
+          advices.size(), merged.size(), ranges.size());
+  return true;
+}
+
 // ================================================================================================
 bool Device::GetSvmAttributes(void** data, size_t* data_sizes, int* attributes,
                               size_t num_attributes, const void* dev_ptr, size_t count) const {
@@ -2471,7 +3979,8 @@ bool Device::GetSvmAttributes(void** data, size_t* data_sizes, int* attributes,
 }
 
 // ================================================================================================
-bool Device::SvmAllocInit(void* memory, size_t size) const {
+bool Device::SvmAllocInit(void* memory, size_t size, ProfilingSignal** prefetch) const {
+  *prefetch = nullptr;
   amd::MemoryAdvice advice = amd::MemoryAdvice::SetAccessedBy;
   constexpr bool kFirstAlloc = true;
   if (!SetSvmAttributesInt(memory, size, advice, kFirstAlloc)) {
@@ -2483,22 +3992,25 @@ bool Device::SvmAllocInit(void* memory, size_t size) const {
   }
 
   if (info().hmmSupported_) {
-    // Initialize signal for the barrier
-    hsa_signal_store_relaxed(prefetch_signal_, kInitSignalValueOne);
+    // Each allocation has own signal, so the allocations don't serialize on the prefetch
+    std::unique_ptr<ProfilingSignal> signal(new ProfilingSignal());
+    if ((signal == nullptr) || !acquireSignal(&signal->signal_)) {
+      LogError("Prefetch signal allocation failed");
+      return false;
+    }
+    hsa_signal_store_relaxed(signal->signal_, kInitSignalValueOne);
 
     // Initiate a prefetch command which should force memory update in HMM
     hsa_status_t status = hsa_amd_svm_prefetch_async(memory, size, getBackendDevice(),
-                                                     0, nullptr, prefetch_signal_);
+                                                     0, nullptr, signal->signal_);
     if (status != HSA_STATUS_SUCCESS) {
+      hsa_signal_store_relaxed(signal->signal_, 0);
       LogError("hsa_amd_svm_prefetch_async() failed");
       return false;
     }
 
-    // Wait for the prefetch
-    if (!WaitForSignal(prefetch_signal_)) {
-      LogError("Barrier packet submission failed");
-      return false;
-    }
+    // The host doesn't wait for the prefetch, the first command on the memory waits in GPU
+    *prefetch = signal.release();
   } else {
     LogWarning("Early prefetch failed, because no HMM support");
   }
@@ -2511,6 +4023,9 @@ void Device::svmFree(void* ptr) const {
   amd::Memory* svmMem = nullptr;
   svmMem = amd::MemObjMap::FindMemObj(ptr);
   if (nullptr != svmMem) {
+    if (pinnedMemCache_ != nullptr) {
+      pinnedMemCache_->invalidate(svmMem->getSvmPtr(), svmMem->getSize());
+    }
     amd::MemObjMap::RemoveMemObj(svmMem->getSvmPtr());
     svmMem->release();
   }
@@ -2531,6 +4046,41 @@ VirtualGPU* Device::xferQueue() const {
   return xferQueue_;
 }
 
+// ================================================================================================
+VirtualGPU* Device::threadXferQueue() const {
+  const uint poolSize = std::max(ROC_XFER_QUEUES, 1u);
+  // The threads are spread over the pool, so the internal transfers of different threads
+  // don't serialize on one blit manager. The first slot is the primary queue
+  const uint index =
+      static_cast<uint>(std::hash<std::thread::id>()(std::this_thread::get_id()) % poolSize);
+  if (index == 0) {
+    return xferQueue();
+  }
+
+  amd::ScopedLock lock(xferPoolLock_);
+  if (xferPool_.empty()) {
+    xferPool_.resize(poolSize - 1, nullptr);
+  }
+  VirtualGPU*& queue = xferPool_[index - 1];
+  if (queue == nullptr) {
+    // The extra queues never run cooperative launches, hence don't need the device queue
+    amd::ScopedLock lockVgpus(vgpusAccess());
+    Device* thisDevice = const_cast<Device*>(this);
+    const std::vector<uint32_t> defaultCuMask = {};
+    queue = new VirtualGPU(*thisDevice, amd::IS_HIP, false, defaultCuMask,
+                           amd::CommandQueue::Priority::Normal);
+    if (!queue->create()) {
+      delete queue;
+      queue = nullptr;
+      // Fall back to the primary queue
+      LogWarning("Couldn't create a pooled transfer queue, using the primary queue");
+      return xferQueue();
+    }
+  }
+  queue->enableSyncBlit();
+  return queue;
+}
+
 // ================================================================================================
 bool Device::SetClockMode(const cl_set_device_clock_mode_input_amd setClockModeInput,
   cl_set_device_clock_mode_output_amd* pSetClockModeOutput) {
@@ -2546,8 +4096,8 @@ bool Device::IsHwEventReady(const amd::Event& event, bool wait) const {
     ClPrint(amd::LOG_INFO, amd::LOG_SIG, "No HW event");
     return false;
   } else if (wait) {
-    auto* vdev = event.command().queue()->vdev();
-    WaitForSignal(reinterpret_cast<ProfilingSignal*>(hw_event)->signal_, vdev->ActiveWait());
+    auto* vdev = static_cast<VirtualGPU*>(event.command().queue()->vdev());
+    WaitForSignal(reinterpret_cast<ProfilingSignal*>(hw_event)->signal_, vdev->waitPolicy());
     return true;
   }
   return (hsa_signal_load_relaxed(reinterpret_cast<ProfilingSignal*>(hw_event)->signal_) <= 0);
@@ -2568,14 +4118,33 @@ static void callbackQueue(hsa_status_t status, hsa_queue_t* queue, void* data) {
 // ================================================================================================
 hsa_queue_t* Device::getQueueFromPool(const uint qIndex) {
   if (qIndex < QueuePriority::Total && queuePool_[qIndex].size() > 0) {
-    typedef decltype(queuePool_)::value_type::const_reference PoolRef;
-    auto lowest = std::min_element(queuePool_[qIndex].begin(),
-        queuePool_[qIndex].end(), [] (PoolRef A, PoolRef B) {
-          return A.second.refCount < B.second.refCount;
-        });
+    // The refCount doesn't show how busy the queue is, hence select the queue by the load:
+    // the outstanding packets first, then the packets submitted since the last selection.
+    // The refCount breaks the ties between the idle queues
+    auto lowest = queuePool_[qIndex].end();
+    uint64_t lowestOutstanding = 0;
+    uint64_t lowestSubmitted = 0;
+    for (auto it = queuePool_[qIndex].begin(); it != queuePool_[qIndex].end(); ++it) {
+      const uint64_t write = hsa_queue_load_write_index_relaxed(it->first);
+      const uint64_t read = hsa_queue_load_read_index_relaxed(it->first);
+      const uint64_t outstanding = (write > read) ? (write - read) : 0;
+      const uint64_t submitted = write - it->second.lastWriteIndex_;
+      it->second.lastWriteIndex_ = write;
+      if ((lowest == queuePool_[qIndex].end()) || (outstanding < lowestOutstanding) ||
+          ((outstanding == lowestOutstanding) &&
+           ((submitted < lowestSubmitted) ||
+            ((submitted == lowestSubmitted) &&
+             (it->second.refCount < lowest->second.refCount))))) {
+        lowest = it;
+        lowestOutstanding = outstanding;
+        lowestSubmitted = submitted;
+      }
+    }
     ClPrint(amd::LOG_INFO, amd::LOG_QUEUE,
-        "selected queue with least refCount: %p (%d)", lowest->first,
-        lowest->second.refCount);
+        "selected queue with the lowest load: %p (refCount %d, outstanding %llu, "
+        "submitted %llu)", lowest->first, lowest->second.refCount,
+        static_cast<unsigned long long>(lowestOutstanding),
+        static_cast<unsigned long long>(lowestSubmitted));
     lowest->second.refCount++;
     return lowest->first;
   } else {
@@ -2583,6 +4152,10 @@ hsa_queue_t* Device::getQueueFromPool(const uint qIndex) {
   }
 }
 
+//! HSA priorities of the queue pools, indexed by QueuePriority
+static constexpr hsa_amd_queue_priority_t kQueuePriorities[] = {
+    HSA_AMD_QUEUE_PRIORITY_LOW, HSA_AMD_QUEUE_PRIORITY_NORMAL, HSA_AMD_QUEUE_PRIORITY_HIGH};
+
 hsa_queue_t* Device::acquireQueue(uint32_t queue_size_hint, bool coop_queue,
                                   const std::vector<uint32_t>& cuMask,
                                   amd::CommandQueue::Priority priority) {
@@ -2596,21 +4169,17 @@ hsa_queue_t* Device::acquireQueue(uint32_t queue_size_hint, bool coop_queue,
       queuePool_[QueuePriority::Normal].size(),
       queuePool_[QueuePriority::High].size(), GPU_MAX_HW_QUEUES);
 
-  hsa_amd_queue_priority_t queue_priority;
   uint qIndex;
   switch (priority) {
     case amd::CommandQueue::Priority::Low:
-      queue_priority = HSA_AMD_QUEUE_PRIORITY_LOW;
       qIndex = QueuePriority::Low;
       break;
     case amd::CommandQueue::Priority::High:
-      queue_priority = HSA_AMD_QUEUE_PRIORITY_HIGH;
       qIndex = QueuePriority::High;
       break;
     case amd::CommandQueue::Priority::Normal:
     case amd::CommandQueue::Priority::Medium:
     default:
-      queue_priority = HSA_AMD_QUEUE_PRIORITY_NORMAL;
       qIndex = QueuePriority::Normal;
       break;
   }
@@ -2623,7 +4192,49 @@ hsa_queue_t* Device::acquireQueue(uint32_t queue_size_hint, bool coop_queue,
   }
 
   // Else create a new queue. This also includes the initial state where there
-  // is no queue.
+  // is no queue. The pre-created queues of the pool have the default size only
+  hsa_queue_t* queue = nullptr;
+  if (!coop_queue && (cuMask.size() == 0) && (queue_size_hint == kDefaultQueueSize)) {
+    queue = takeWarmQueue(qIndex);
+  }
+  if (queue == nullptr) {
+    queue = createHwQueue(queue_size_hint, coop_queue, cuMask, kQueuePriorities[qIndex]);
+  }
+  if (queue == nullptr) {
+    // if a queue with the same requested priority available from the pool, returns it here
+    if (!coop_queue && (cuMask.size() == 0) && (queuePool_[qIndex].size() > 0)) {
+      return getQueueFromPool(qIndex);
+    }
+    return nullptr;
+  }
+
+  if (cuMask.size() != 0) {
+    // add queues with custom CU mask into their special pool to keep track
+    // of mapping of these queues to their associated queueInfo (i.e., hostcall buffers)
+    auto result = queueWithCUMaskPool_[qIndex].emplace(std::make_pair(queue, QueueInfo()));
+    assert(result.second && "QueueInfo already exists");
+    auto& qInfo = result.first->second;
+    qInfo.refCount = 1;
+
+    return queue;
+  }
+
+  if (coop_queue) {
+    // Skip queue recycling for cooperative queues, since it should be just one
+    // per device.
+    return queue;
+  }
+  auto result = queuePool_[qIndex].emplace(std::make_pair(queue, QueueInfo()));
+  assert(result.second && "QueueInfo already exists");
+  auto &qInfo = result.first->second;
+  qInfo.refCount = 1;
+  return queue;
+}
+
+// ================================================================================================
+hsa_queue_t* Device::createHwQueue(uint32_t queue_size_hint, bool coop_queue,
+                                   const std::vector<uint32_t>& cuMask,
+                                   hsa_amd_queue_priority_t queue_priority) const {
   uint32_t queue_max_packets = 0;
   if (HSA_STATUS_SUCCESS !=
       hsa_agent_get_info(_bkendDevice, HSA_AGENT_INFO_QUEUE_MAX_SIZE, &queue_max_packets)) {
@@ -2640,15 +4251,11 @@ hsa_queue_t* Device::acquireQueue(uint32_t queue_size_hint, bool coop_queue,
     queue_type = HSA_QUEUE_TYPE_COOPERATIVE;
   }
 
-  while (hsa_queue_create(_bkendDevice, queue_size, queue_type, callbackQueue, this,
-                          std::numeric_limits<uint>::max(), std::numeric_limits<uint>::max(),
-                          &queue) != HSA_STATUS_SUCCESS) {
+  while (hsa_queue_create(_bkendDevice, queue_size, queue_type, callbackQueue,
+                          const_cast<Device*>(this), std::numeric_limits<uint>::max(),
+                          std::numeric_limits<uint>::max(), &queue) != HSA_STATUS_SUCCESS) {
     queue_size >>= 1;
     if (queue_size < 64) {
-      // if a queue with the same requested priority available from the pool, returns it here
-      if (!coop_queue && (cuMask.size() == 0) && (queuePool_[qIndex].size() > 0)) {
-        return getQueueFromPool(qIndex);
-      }
       DevLogError("Device::acquireQueue: hsa_queue_create failed!");
       return nullptr;
     }
@@ -2712,30 +4319,63 @@ hsa_queue_t* Device::acquireQueue(uint32_t queue_size_hint, bool coop_queue,
       hsa_queue_destroy(queue);
       return nullptr;
     }
-    if (cuMask.size() != 0) {
-      // add queues with custom CU mask into their special pool to keep track
-      // of mapping of these queues to their associated queueInfo (i.e., hostcall buffers)
-      auto result = queueWithCUMaskPool_[qIndex].emplace(std::make_pair(queue, QueueInfo()));
-      assert(result.second && "QueueInfo already exists");
-      auto& qInfo = result.first->second;
-      qInfo.refCount = 1;
-
-      return queue;
-    }
   }
+  return queue;
+}
 
-  if (coop_queue) {
-    // Skip queue recycling for cooperative queues, since it should be just one
-    // per device.
-    return queue;
+// ================================================================================================
+hsa_queue_t* Device::takeWarmQueue(uint qIndex) {
+  if (queueWarmer_.state() < amd::Thread::RUNNABLE) {
+    return nullptr;
   }
-  auto result = queuePool_[qIndex].emplace(std::make_pair(queue, QueueInfo()));
-  assert(result.second && "QueueInfo already exists");
-  auto &qInfo = result.first->second;
-  qInfo.refCount = 1;
+  amd::ScopedLock lock(warmLock_);
+  hsa_queue_t* queue = nullptr;
+  if (!warmQueues_[qIndex].empty()) {
+    queue = warmQueues_[qIndex].back();
+    warmQueues_[qIndex].pop_back();
+    ClPrint(amd::LOG_INFO, amd::LOG_QUEUE, "acquired pre-created hardware queue %p", queue);
+  }
+  // The pool gets a new queue in any case. The pre-created queues are useless over the limit,
+  // since the streams share the pool queues then
+  const uint pooled = static_cast<uint>(queuePool_[qIndex].size()) + 1;
+  warmTarget_[qIndex] =
+      (pooled < GPU_MAX_HW_QUEUES) ? std::min(ROC_WARM_QUEUES, GPU_MAX_HW_QUEUES - pooled) : 0;
+  warmLock_.notify();
   return queue;
 }
 
+// ================================================================================================
+void Device::warmQueues() {
+  amd::ScopedLock lock(warmLock_);
+  while (!warmTerminate_) {
+    bool idle = true;
+    for (uint i = 0; (i < QueuePriority::Total) && !warmTerminate_; ++i) {
+      if (warmQueues_[i].size() > warmTarget_[i]) {
+        hsa_queue_destroy(warmQueues_[i].back());
+        warmQueues_[i].pop_back();
+        idle = false;
+      } else if (warmQueues_[i].size() < warmTarget_[i]) {
+        // The queue creation takes milliseconds, so the streams don't wait for the lock
+        warmLock_.unlock();
+        const std::vector<uint32_t> defaultCuMask = {};
+        hsa_queue_t* queue = createHwQueue(kDefaultQueueSize, false, defaultCuMask,
+                                           kQueuePriorities[i]);
+        warmLock_.lock();
+        if (queue == nullptr) {
+          // The device is out of queues, so the streams will create them on demand
+          warmTarget_[i] = 0;
+        } else {
+          warmQueues_[i].push_back(queue);
+        }
+        idle = false;
+      }
+    }
+    if (idle) {
+      warmLock_.wait();
+    }
+  }
+}
+
 void Device::releaseQueue(hsa_queue_t* queue, const std::vector<uint32_t>& cuMask) {
   for (auto& it : cuMask.size() == 0 ? queuePool_ : queueWithCUMaskPool_) {
     auto qIter = it.find(queue);
@@ -2755,6 +4395,7 @@ void Device::releaseQueue(hsa_queue_t* queue, const std::vector<uint32_t>& cuMas
             qInfo.hostcallBuffer_, queue);
         disableHostcalls(qInfo.hostcallBuffer_);
         context().svmFree(qInfo.hostcallBuffer_);
+        memoryUsage().remove(VDI_MEMORY_HOSTCALL, hostcallBufferSize_);
       }
 
       ClPrint(amd::LOG_INFO, amd::LOG_QUEUE,
@@ -2808,6 +4449,9 @@ void* Device::getOrCreateHostcallBuffer(hsa_queue_t* queue, bool coop_queue,
   }
   ClPrint(amd::LOG_INFO, amd::LOG_QUEUE, "Created hostcall buffer %p for hardware queue %p", buffer,
           queue);
+  // All hostcall buffers of the device have the same size
+  hostcallBufferSize_ = size;
+  memoryUsage().add(VDI_MEMORY_HOSTCALL, size);
   if (!coop_queue) {
     qIter->second.hostcallBuffer_ = buffer;
   } else {
@@ -2939,6 +4583,44 @@ bool Device::findLinkInfo(const hsa_amd_memory_pool_t& pool,
   return true;
 }
 
+// ================================================================================================
+int32_t Device::linkDistance(const Device* other) const {
+  if (other == nullptr) {
+    return hostLinkDistance_;
+  }
+  if (other == this) {
+    return 0;
+  }
+  std::vector<amd::Device::LinkAttrType> link_attrs;
+  link_attrs.push_back(std::make_pair(LinkAttribute::kLinkDistance, 0));
+  // The link query doesn't change the device state
+  if (!const_cast<Device*>(this)->findLinkInfo(*other, &link_attrs)) {
+    return std::numeric_limits<int32_t>::max();
+  }
+  return link_attrs[0].second;
+}
+
+// ================================================================================================
+void* Device::relayStage() const {
+  if (relayStage_ == nullptr) {
+    void* ptr = nullptr;
+    if (HSA_STATUS_SUCCESS !=
+        hsa_amd_memory_pool_allocate(gpuvm_segment_, kP2PStagingSize, 0, &ptr)) {
+      LogError("Fail allocation of the P2P relay memory");
+      return nullptr;
+    }
+    // Both sides of the relay access the memory, regardless of the user enabled peers
+    if (HSA_STATUS_SUCCESS != hsa_amd_agents_allow_access(1 + p2p_agents_.size(),
+                                                          p2p_agents_list_, nullptr, ptr)) {
+      LogError("Fail P2P access for the relay memory");
+      hsa_amd_memory_pool_free(ptr);
+      return nullptr;
+    }
+    relayStage_ = ptr;
+  }
+  return relayStage_;
+}
+
 // ================================================================================================
 void Device::getGlobalCUMask(std::string cuMaskStr) {
   if (cuMaskStr.length() != 0) {
@@ -2999,6 +4681,19 @@ device::Signal* Device::createSignal() const {
 
 // ================================================================================================
 amd::Memory* Device::GetArenaMemObj(const void* ptr, size_t& offset) {
+  // The arena is created with the first lookup, so the unused devices don't reserve it.
+  // Only create arena_mem_object if CPU memory is accessible.
+  std::call_once(arenaMemInit_, [this]() {
+    if (info_.hmmCpuMemoryAccessible_) {
+      arena_mem_obj_ = new (context()) amd::ArenaMemory(context());
+      if (!arena_mem_obj_->create(nullptr)) {
+        LogError("Arena Memory Creation failed!");
+        arena_mem_obj_->release();
+        arena_mem_obj_ = nullptr;
+      }
+    }
+  });
+
   // If arena_mem_obj_ is null, then HMM and Xnack is disabled. Return nullptr.
   if (arena_mem_obj_ == nullptr) {
     return nullptr;
@@ -3019,6 +4714,180 @@ void Device::ReleaseGlobalSignal(void* signal) const {
   }
 }
 
+// ================================================================================================
+bool Device::acquireSignal(hsa_signal_t* signal) const {
+  {
+    amd::ScopedLock lock(signalPoolLock_);
+    if (!signalPool_.empty()) {
+      *signal = signalPool_.back();
+      signalPool_.pop_back();
+      return true;
+    }
+  }
+  hsa_agent_t agent = getBackendDevice();
+  hsa_agent_t* agents = (settings().system_scope_signal_) ? nullptr : &agent;
+  uint32_t num_agents = (settings().system_scope_signal_) ? 0 : 1;
+  return (HSA_STATUS_SUCCESS == hsa_signal_create(0, num_agents, agents, signal));
+}
+
+// ================================================================================================
+void Device::recycleSignal(hsa_signal_t signal) const {
+  amd::ScopedLock lock(signalPoolLock_);
+  signalPool_.push_back(signal);
+}
+
+// ================================================================================================
+bool Device::importExtSemaphore(void** extSemaphore, const amd::Os::FileDesc& handle) {
+#if defined(_WIN32)
+  return false;
+#else
+  ExtSemaphore* semaphore = new ExtSemaphore(handle);
+  if ((semaphore == nullptr) || !semaphore->create(context())) {
+    delete semaphore;
+    return false;
+  }
+  *extSemaphore = semaphore;
+  return true;
+#endif
+}
+
+// ================================================================================================
+void Device::DestroyExtSemaphore(void* extSemaphore) {
+  delete reinterpret_cast<ExtSemaphore*>(extSemaphore);
+}
+
+//! The interval (in ms) of the foreign fence waits, so the helper thread can exit
+static constexpr uint32_t kExtSemaphorePollInterval = 100;
+
+// ================================================================================================
+ExtSemaphore::ExtSemaphore(amd::Os::FileDesc handle)
+    : handle_(amd::Os::FDescInit()),
+      timeline_(nullptr),
+      lock_("External semaphore lock", true),
+      requested_(0),
+      recorded_(0),
+      terminate_(false) {
+  signal_.handle = 0;
+#if !defined(_WIN32)
+  // The app can close the handle after the import
+  handle_ = dup(handle);
+#endif
+}
+
+// ================================================================================================
+ExtSemaphore::~ExtSemaphore() {
+  if (waiter_.state() >= amd::Thread::RUNNABLE) {
+    {
+      amd::ScopedLock lock(lock_);
+      terminate_ = true;
+      lock_.notify();
+    }
+    while (waiter_.state() < amd::Thread::FINISHED) {
+      amd::Os::yield();
+    }
+  }
+  if (signal_.handle != 0) {
+    hsa_signal_destroy(signal_);
+  }
+  if (timeline_ != nullptr) {
+    timeline_->release();
+  }
+  if (handle_ != amd::Os::FDescInit()) {
+    amd::Os::CloseFileHandle(handle_);
+  }
+}
+
+// ================================================================================================
+bool ExtSemaphore::create(amd::Context& context) {
+  if (handle_ == amd::Os::FDescInit()) {
+    LogError("Failed to duplicate the external semaphore handle!");
+    return false;
+  }
+  if (HSA_STATUS_SUCCESS != hsa_signal_create(0, 0, nullptr, &signal_)) {
+    signal_.handle = 0;
+    LogError("Failed to create the external semaphore signal!");
+    return false;
+  }
+  timeline_ = new (context) amd::Buffer(context, ROCCLR_MEM_HSA_SIGNAL_MEMORY, sizeof(int64_t));
+  if ((timeline_ == nullptr) || !timeline_->create(nullptr)) {
+    LogError("Failed to create the external semaphore timeline!");
+    return false;
+  }
+  // The signal memory starts from one, but the timeline values start from zero
+  hsa_signal_store_screlease(
+      static_cast<Buffer*>(timeline_->getDeviceMemory(*context.devices()[0]))->getSignal(), 0);
+  if ((waiter_.state() < amd::Thread::INITIALIZED) || !waiter_.start(this)) {
+    LogError("Failed to start the external semaphore thread!");
+    return false;
+  }
+  return true;
+}
+
+// ================================================================================================
+int64_t ExtSemaphore::requestWait() {
+  amd::ScopedLock lock(lock_);
+  ++requested_;
+  lock_.notify();
+  return requested_;
+}
+
+// ================================================================================================
+void ExtSemaphore::recordSignal(int64_t value) {
+  amd::ScopedLock lock(lock_);
+  recorded_ = std::max(recorded_, value);
+}
+
+// ================================================================================================
+bool ExtSemaphore::signalRecorded(int64_t value) {
+  amd::ScopedLock lock(lock_);
+  return value <= recorded_;
+}
+
+// ================================================================================================
+bool ExtSemaphore::waitFence(uint32_t timeoutMs) {
+#if defined(_WIN32)
+  ShouldNotReachHere();
+  return true;
+#else
+  // The sync file becomes readable, when the foreign fence is signaled
+  pollfd fd = {handle_, POLLIN, 0};
+  const int ret = poll(&fd, 1, static_cast<int>(timeoutMs));
+  if (ret == 0 || (ret < 0 && errno == EINTR)) {
+    return false;
+  }
+  if (ret < 0 || (fd.revents & (POLLERR | POLLNVAL)) != 0) {
+    // Release the queue anyway, since GPU can't recover from an endless wait
+    LogError("External semaphore wait failed!");
+  }
+  return true;
+#endif
+}
+
+// ================================================================================================
+void ExtSemaphore::loop() {
+  int64_t satisfied = 0;
+  while (true) {
+    int64_t requested;
+    {
+      amd::ScopedLock lock(lock_);
+      while (!terminate_ && (requested_ == satisfied)) {
+        lock_.wait();
+      }
+      if (terminate_) {
+        break;
+      }
+      requested = requested_;
+    }
+    if (waitFence(kExtSemaphorePollInterval)) {
+      // All outstanding waits observe the same fence state
+      satisfied = requested;
+      hsa_signal_store_screlease(signal_, satisfied);
+      ClPrint(amd::LOG_DEBUG, amd::LOG_SIG, "External semaphore %p satisfied wait %ld",
+              this, satisfied);
+    }
+  }
+}
+
 // ================================================================================================
 ProfilingSignal::~ProfilingSignal() {
   if (signal_.handle != 0) {
@@ -25,6 +25,7 @@
 #include "top.hpp"
 #include "CL/cl.h"
 #include "device/device.hpp"
+#include "device/devmapcache.hpp"
 #include "platform/command.hpp"
 #include "platform/program.hpp"
 #include "platform/perfctr.hpp"
@@ -47,8 +48,11 @@
 
 #include <atomic>
 #include <iostream>
+#include <limits>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 /*! \addtogroup HSA
  *  @{
@@ -95,10 +99,63 @@ public:
   amd::Monitor& LockSignalOps() { return lock_; }
 };
 
+//! External semaphore, imported from a graphics API. ROCr can't wait for a foreign fence,
+//! hence a helper thread mirrors the fence state into an HSA signal and the queues wait
+//! for the signal with a barrier value packet, without the host synchronization.
+//! The timeline values, signaled by the queues, are written into a signal memory object,
+//! so the waits for them stay on GPU as well
+class ExtSemaphore : public amd::HeapObject {
+ public:
+  ExtSemaphore(amd::Os::FileDesc handle);
+  ~ExtSemaphore();
+
+  //! Creates the HSA signals and starts the helper thread
+  bool create(amd::Context& context);
+
+  //! Requests a new wait for the foreign fence and returns the signal value,
+  //! which the queue has to wait for
+  int64_t requestWait();
+
+  //! Returns the HSA signal, which mirrors the foreign fence
+  hsa_signal_t signal() const { return signal_; }
+
+  //! Returns the signal memory object with the timeline value
+  amd::Memory* timeline() const { return timeline_; }
+
+  //! Records the signal of the timeline value, submitted by a queue
+  void recordSignal(int64_t value);
+
+  //! Returns TRUE if a queue already submitted the signal of the timeline value
+  bool signalRecorded(int64_t value);
+
+ private:
+  //! The helper thread, which waits for the foreign fence
+  class Waiter : public amd::Thread {
+   public:
+    Waiter() : amd::Thread("External Semaphore Thread") {}
+    virtual void run(void* data) { static_cast<ExtSemaphore*>(data)->loop(); }
+  };
+
+  //! The helper thread loop
+  void loop();
+
+  //! Waits for the foreign fence up to the timeout. Returns TRUE if the fence was signaled
+  bool waitFence(uint32_t timeoutMs);
+
+  amd::Os::FileDesc handle_;  //!< The duplicated handle of the foreign fence
+  hsa_signal_t signal_;       //!< HSA signal with the number of the satisfied waits
+  amd::Memory* timeline_;     //!< Signal memory with the timeline value of the queues
+  amd::Monitor lock_;         //!< Lock for the wait requests
+  int64_t requested_;         //!< The number of the requested waits
+  int64_t recorded_;          //!< The largest timeline value, signaled by the queues
+  bool terminate_;            //!< The helper thread has to exit
+  Waiter waiter_;             //!< The helper thread
+};
+
 class Sampler : public device::Sampler {
  public:
   //! Constructor
-  Sampler(const Device& dev) : dev_(dev) {}
+  Sampler(const Device& dev) : dev_(dev) { hsa_sampler.handle = 0; }
 
   //! Default destructor for the device memory object
   virtual ~Sampler();
@@ -286,33 +343,72 @@ struct AgentInfo {
 //! A HSA device ordinal (physical HSA device)
 class Device : public NullDevice {
  public:
-  //! Transfer buffers
+  //! Transfer buffers. The buffers are split into size buckets, so small transfers don't
+  //! consume a full size staging buffer. Each VirtualGPU keeps a local cache with one
+  //! buffer per bucket in front of the shared pool, hence the pool lock is taken only
+  //! on a local miss. The shared free lists are trimmed to the high-water mark of
+  //! the concurrently acquired buffers in the last trim period.
   class XferBuffers : public amd::HeapObject {
    public:
     static const size_t MaxXferBufListSize = 8;
+    static constexpr uint kNumBuckets = 3;      //!< The number of size buckets
+    static constexpr uint kBucketShift = 2;     //!< Each bucket is 4 times smaller
+    static constexpr uint kTrimPeriod = 256;    //!< The number of releases between the trims
+
+    //! Per VirtualGPU cache of the transfer buffers
+    struct LocalCache {
+      Memory* buffers_[kNumBuckets] = {};  //!< Cached buffer for each size bucket
+    };
+
+    //! Staging pool statistics
+    struct Stats {
+      std::atomic<size_t> allocations_;  //!< The number of allocated buffers
+      std::atomic<size_t> localHits_;    //!< Acquires, satisfied by a VirtualGPU cache
+      std::atomic<size_t> poolHits_;     //!< Acquires, satisfied by the shared pool
+      std::atomic<size_t> trimmed_;      //!< The number of destroyed buffers due to the trim
+      Stats() : allocations_(0), localHits_(0), poolHits_(0), trimmed_(0) {}
+    };
 
     //! Default constructor
-    XferBuffers(const Device& device, size_t bufSize)
-        : bufSize_(bufSize), acquiredCnt_(0), gpuDevice_(device) {}
+    XferBuffers(const Device& device, size_t bufSize, bool write)
+        : bufSize_(bufSize), acquiredCnt_(0), write_(write), gpuDevice_(device) {}
 
     //! Default destructor
     ~XferBuffers();
 
-    //! Creates the xfer buffers object
-    bool create();
-
-    //! Acquires an instance of the transfer buffers
-    Memory& acquire();
+    //! Acquires an instance of the transfer buffers for the requested transfer size.
+    //! The returned buffer can be smaller than the requested size, but not smaller than
+    //! bufSize(). Size 0 requests a full size buffer
+    Memory& acquire(VirtualGPU& gpu,   //!< Virual GPU object, which will use the buffer
+                    size_t size = 0    //!< The size of the transfer
+                    );
 
     //! Releases transfer buffer
     void release(VirtualGPU& gpu,  //!< Virual GPU object used with the buffer
                  Memory& buffer    //!< Transfer buffer for release
                  );
 
+    //! Returns the buffers from VirtualGPU cache back to the shared pool
+    void flushCache(LocalCache& cache);
+
+    //! Releases all free buffers of the shared pool. Returns the released bytes
+    size_t trim();
+
     //! Returns the buffer's size for transfer
     size_t bufSize() const { return bufSize_; }
 
+    //! Returns the staging pool statistics
+    const Stats& stats() const { return stats_; }
+
    private:
+    //! A list of free buffers for a single size
+    struct Bucket {
+      std::list<Memory*> freeBuffers_;  //!< The list of free buffers
+      uint acquired_ = 0;               //!< The number of buffers outside of the pool
+      uint peak_ = 0;                   //!< High-water mark of acquired buffers
+      uint releases_ = 0;               //!< Releases since the last trim
+    };
+
     //! Disable copy constructor
     XferBuffers(const XferBuffers&);
 
@@ -322,13 +418,366 @@ class Device : public NullDevice {
     //! Get device object
     const Device& dev() const { return gpuDevice_; }
 
+    //! Returns the size of the buffers in the bucket
+    size_t bucketSize(uint bucket) const {
+      return std::max(bufSize_ >> (kBucketShift * bucket), static_cast<size_t>(4 * Ki));
+    }
+
+    //! Finds the smallest bucket, which fits the transfer size
+    uint findBucket(size_t size) const;
+
+    //! Allocates a new transfer buffer
+    Memory* allocBuffer(size_t size);
+
+    //! Returns a buffer back to the shared pool, must be called under the lock
+    void releaseToPool(uint bucket, Memory* buffer);
+
     size_t bufSize_;                  //!< Staged buffer size
-    std::list<Memory*> freeBuffers_;  //!< The list of free buffers
-    std::atomic_uint acquiredCnt_;   //!< The total number of acquired buffers
+    Bucket buckets_[kNumBuckets];     //!< The lists of free buffers for each size
+    std::atomic_uint acquiredCnt_;    //!< The total number of acquired buffers
+    bool write_;                      //!< The pool is used for write transfers
+    Stats stats_;                     //!< Staging pool statistics
     amd::Monitor lock_;               //!< Stgaed buffer acquire/release lock
     const Device& gpuDevice_;         //!< GPU device object
   };
 
+  //! Device wide LRU cache of the pinned host memory ranges. The cached ranges are disjoint
+  //! and a lookup finds the range, which contains the requested one, so the transfers
+  //! from a sub-range reuse the pinned memory. The total size is limited by the budget.
+  //! @note The cache can't detect application frees of pageable memory,
+  //!       hence the runtime must invalidate the range before the memory is released
+  class PinnedMemCache : public amd::HeapObject {
+   public:
+    //! Default constructor
+    PinnedMemCache(size_t budget) : budget_(budget), size_(0), lock_("Pinned cache lock", true) {}
+
+    //! Default destructor
+    ~PinnedMemCache() { invalidate(nullptr, std::numeric_limits<size_t>::max()); }
+
+    //! Finds a pinned buffer, which contains [addr, addr + size). Returns a retained buffer
+    amd::Memory* find(const void* addr,  //!< Host address of the range
+                      size_t size,       //!< Size of the range
+                      size_t* offset     //!< The offset of the range in the pinned buffer
+                      );
+
+    //! Adds a pinned buffer to the cache. The overlapped ranges are replaced
+    void insert(amd::Memory* mem);
+
+    //! Removes all pinned buffers, which overlap [addr, addr + size)
+    void invalidate(const void* addr, size_t size);
+
+    //! Removes all pinned buffers, created with the virtual device
+    void invalidate(const device::VirtualDevice* vdev);
+
+   private:
+    struct Entry {
+      amd::Memory* mem_;                  //!< Pinned buffer
+      std::list<address>::iterator lru_;  //!< The position in LRU list
+    };
+
+    //! Removes an entry from the cache, must be called under the lock
+    std::map<address, Entry>::iterator erase(std::map<address, Entry>::iterator it);
+
+    std::map<address, Entry> ranges_;   //!< Pinned ranges, indexed by the host address
+    std::list<address> lru_;            //!< LRU order of the ranges, the front is the newest
+    size_t budget_;                     //!< Max size of the pinned memory in the cache
+    size_t size_;                       //!< Current size of the pinned memory in the cache
+    amd::Monitor lock_;                 //!< Cache access lock
+  };
+
+  //! Device wide slab sub-allocator of the small device buffers. A slab is a big allocation
+  //! from the memory pool, divided into the blocks of a single power of two size class.
+  //! The allocator is split into the shards with separate locks and each thread works with
+  //! the shard of its id, so the concurrent allocations rarely contend for a lock.
+  //! @note IPC and P2P access are managed by ROCr per allocation, hence they apply
+  //!       to the whole slab, which contains the buffer
+  class SlabAllocator : public amd::HeapObject {
+   public:
+    static constexpr size_t kSlabSize = 2 * Mi;   //!< The size of each slab
+    static constexpr size_t kMinBlockSize = 256;  //!< The smallest size class
+    static constexpr uint kNumShards = 8;         //!< The number of independent shards
+
+    //! Default constructor
+    SlabAllocator(const Device& dev, bool atomics, size_t maxSize);
+
+    //! Default destructor, releases all slabs to the memory pool
+    ~SlabAllocator();
+
+    //! Returns TRUE if the size can be sub-allocated
+    bool fits(size_t size) const { return size <= maxSize_; }
+
+    //! Allocates a block for the size, returns nullptr on failure
+    void* allocate(size_t size);
+
+    //! Frees the block. Returns FALSE if the pointer doesn't belong to the allocator
+    bool free(void* ptr);
+
+    //! Finds the slab, which contains the pointer. Returns FALSE if it isn't a sub-allocation
+    bool findSlab(const void* ptr, void** base, size_t* size) const;
+
+    //! Allows the access to all slabs for the peer devices
+    void allowPeerAccess() const;
+
+    //! Releases the empty slabs to the memory pool. Returns the released bytes
+    size_t trim();
+
+   private:
+    struct Slab {
+      address base_;                      //!< The base address of the slab
+      uint sizeClass_;                    //!< The index of the block size class
+      uint shard_;                        //!< The shard, which owns the slab
+      std::vector<uint32_t> freeBlocks_;  //!< The indices of the free blocks
+    };
+
+    struct Shard {
+      Shard() : lock_("Slab allocator shard lock", true) {}
+      amd::Monitor lock_;                             //!< The shard access lock
+      std::vector<std::vector<Slab*>> partialSlabs_;  //!< Slabs with free blocks per class
+    };
+
+    //! Returns the block size of the size class
+    static size_t blockSize(uint sizeClass) { return kMinBlockSize << sizeClass; }
+
+    //! Creates a new slab for the size class, must be called under the shard lock
+    Slab* createSlab(uint sizeClass, uint shard);
+
+    //! Releases an empty slab to the memory pool, must be called under the shard lock
+    void destroySlab(Slab* slab);
+
+    const Device& dev_;               //!< ROC device object
+    const bool atomics_;              //!< Fine grain memory pool
+    size_t maxSize_;                  //!< The biggest sub-allocated size
+    Shard shards_[kNumShards];        //!< The shards of the allocator
+    std::map<address, Slab*> slabs_;  //!< All slabs, indexed by the base address
+    mutable amd::Monitor slabsLock_;  //!< Lock for the slabs map
+  };
+
+  //! Pool of pinned host memory in front of the HSA memory pools. The freed allocations are
+  //! kept in the free lists per HSA memory pool, hence per NUMA node, and per size class,
+  //! so the next allocation of the class skips the kernel driver and the access setup.
+  //! The sizes are rounded up to four classes per power of two. The freed memory over
+  //! the retention budget is released right away.
+  class HostMemPool : public amd::HeapObject {
+   public:
+    static constexpr size_t kMinBlockSize = 4 * Ki;   //!< The smallest size class
+    static constexpr size_t kMaxBlockSize = 16 * Mi;  //!< The biggest pooled size
+
+    //! Default constructor
+    HostMemPool(const Device& dev, size_t budget);
+
+    //! Default destructor, releases all free blocks
+    ~HostMemPool();
+
+    //! Returns TRUE if the size can be pooled
+    bool fits(size_t size) const { return (size != 0) && (size <= kMaxBlockSize); }
+
+    //! Allocates a block from the HSA memory pool, returns nullptr on failure
+    void* allocate(const hsa_amd_memory_pool_t& segment, size_t size);
+
+    //! Frees the block. Returns FALSE if the pointer doesn't belong to the pool
+    bool free(void* ptr);
+
+   private:
+    typedef std::pair<uint64_t, size_t> Key;  //!< HSA memory pool handle and the class size
+
+    //! Returns the class size for the requested size
+    static size_t classSize(size_t size);
+
+    //! Releases all free blocks, must be called under the lock
+    void releaseFree();
+
+    const Device& dev_;                              //!< ROC device object
+    size_t budget_;                                  //!< The retention budget in bytes
+    size_t freeSize_;                                //!< The total size of the free blocks
+    std::map<Key, std::vector<void*>> freeBlocks_;   //!< The free blocks per pool and class
+    std::unordered_map<void*, Key> allocated_;       //!< The allocated blocks
+    amd::Monitor lock_;                              //!< Lock for the pool access
+  };
+
+  //! Device wide cost model of the copy engines. ROCr runs hsa_amd_memory_async_copy on SDMA
+  //! for different agents and on the blit kernels for the same agent on both sides.
+  //! The bandwidth of both engines per copy class is seeded by a short benchmark on the first
+  //! use and refined with the profiling time of the completed copies, so the model picks
+  //! the faster engine for each direction and size class.
+  class CopyEngineModel : public amd::HeapObject {
+   public:
+    enum Direction : uint { HostToDevice = 0, DeviceToHost, PeerToPeer, DirectionTotal };
+    enum Engine : uint { Sdma = 0, Blit, EngineTotal };
+
+    static constexpr uint kSizeClasses = 48;   //!< The number of log2 size classes
+    static constexpr uint kMaxPending = 32;    //!< Max number of the tracked copies
+    static constexpr uint kExploreRate = 64;   //!< Each Nth copy in a class tries the other engine
+
+    //! Default constructor
+    CopyEngineModel(const Device& dev);
+
+    //! Default destructor, releases the tracked copies
+    ~CopyEngineModel();
+
+    //! Returns the engine with the lower cost for the copy
+    Engine select(Direction direction, size_t size);
+
+    //! Tracks the submitted copy for the model refinement
+    void track(Direction direction, Engine engine, size_t size, ProfilingSignal* signal);
+
+    //! Returns the bandwidth in bytes per ns of the nearest measured size class, 0 if unknown
+    double bandwidth(Direction direction, size_t size, Engine engine) const;
+
+    //! Prints the measured bandwidth of all copy classes into the log
+    void print() const;
+
+   private:
+    struct Sample {
+      double bandwidth_;  //!< Moving average of the bandwidth in bytes per ns
+      uint count_;        //!< The number of the measurements
+    };
+
+    struct Pending {
+      ProfilingSignal* signal_;  //!< The retained completion signal of the copy
+      Direction direction_;      //!< The copy direction
+      Engine engine_;            //!< The engine of the copy
+      size_t size_;              //!< The copy size
+    };
+
+    //! Returns the log2 size class of the copy
+    static uint sizeClass(size_t size);
+
+    //! Measures both engines for a few sizes in the host transfers
+    void calibrate();
+
+    //! Returns the key of the size class in the application tuning profile
+    std::string tuningKey(uint direction, uint sizeClass, uint engine) const;
+
+    //! Loads the measurements of the previous runs. Returns FALSE if there are none
+    bool loadTuning();
+
+    //! Stores the measurements into the application tuning profile
+    void storeTuning() const;
+
+    //! Updates the model with the completed copies, must be called under the lock
+    void harvest();
+
+    //! Adds a bandwidth measurement, must be called under the lock
+    void update(Direction direction, uint sizeClass, Engine engine, double bandwidth);
+
+    //! Finds the nearest size class with the measurements for both engines, -1 if none
+    int nearestClass(Direction direction, uint sizeClass) const;
+
+    const Device& dev_;             //!< ROC device object
+    bool calibrated_;               //!< The startup benchmark was done
+    Sample samples_[DirectionTotal][kSizeClasses][EngineTotal];  //!< Measurements per class
+    uint selects_[DirectionTotal][kSizeClasses];  //!< The number of selections per class
+    std::vector<Pending> pending_;  //!< Submitted copies, which aren't measured yet
+    mutable amd::Monitor lock_;     //!< Model access lock
+  };
+
+  //! Throughput model of the transfers with pageable host memory on HMM systems. With XNACK
+  //! the GPU can access the pageable pages directly, so a blit kernel copies straight from or
+  //! into the pageable pointer without the staging or the pinning. The model times both paths
+  //! per direction and log2 size class with a few synchronous samples and picks the faster one.
+  class PageableXferModel : public amd::HeapObject {
+   public:
+    enum Path : uint { Staged = 0, Direct, PathTotal };
+
+    static constexpr uint kSizeClasses = 48;  //!< The number of log2 size classes
+    static constexpr uint kMinSamples = 2;    //!< The warm-up samples of each path
+    static constexpr uint kExploreRate = 64;  //!< Each Nth transfer in a class tries the other path
+
+    //! Default constructor, the max size of the direct transfers is in bytes
+    PageableXferModel(size_t maxSize);
+
+    //! Returns TRUE if the transfer size can use the direct path
+    bool fits(size_t size) const { return size <= maxSize_; }
+
+    //! Returns the path for the transfer. \a measure is set, if the transfer must be timed
+    Path select(bool write, size_t size, bool* measure);
+
+    //! Adds the measured time in ns of the transfer
+    void update(bool write, size_t size, Path path, uint64_t time);
+
+   private:
+    struct Sample {
+      double bandwidth_;  //!< Moving average of the bandwidth in bytes per ns
+      uint count_;        //!< The number of the measurements
+    };
+
+    //! Returns the log2 size class of the transfer
+    static uint sizeClass(size_t size);
+
+    size_t maxSize_;                                 //!< The max size of the direct transfers
+    Sample samples_[2][kSizeClasses][PathTotal];     //!< Measurements per direction and class
+    uint selects_[2][kSizeClasses];                  //!< The number of selections per class
+    amd::Monitor lock_;                              //!< Model access lock
+  };
+
+  //! Oversubscription manager of the device memory. The big coarse grain user buffers are
+  //! backed by VMM physical handles, so a cold buffer can be moved into pinned host memory
+  //! and its physical memory released, while the virtual address stays reserved.
+  //! The memory objects of the kernels and transfers mark the last use of the buffers
+  //! and the evicted buffers are restored with SDMA copies before the next command.
+  //! @note The buffers, accessed through the indirect pointers only, aren't tracked
+  class Oversubscription : public amd::HeapObject {
+   public:
+    //! Default constructor
+    Oversubscription(const Device& dev);
+
+    //! Default destructor, releases the remaining buffers
+    ~Oversubscription();
+
+    //! Creates the signal for the eviction copies
+    bool create();
+
+    //! Returns TRUE if the buffer size is managed
+    bool fits(size_t size) const { return size >= granularity_; }
+
+    //! Allocates a managed buffer and evicts the cold buffers if device memory is exhausted
+    void* allocate(size_t size);
+
+    //! Frees the managed buffer. Returns FALSE if the pointer isn't managed
+    bool free(void* ptr);
+
+    //! Returns a new epoch for the memory uses of a command
+    uint64_t newEpoch() { return ++clock_; }
+
+    //! Marks the use of the pointer by the queue and restores the buffer if it was evicted.
+    //! Returns FALSE if the buffer couldn't be restored
+    bool use(VirtualGPU& gpu, const void* ptr);
+
+    //! Evicts the least recently used buffers for the size. Returns FALSE if none was evicted
+    bool evict(size_t size);
+
+    //! Removes the queue from the last uses of the buffers
+    void removeQueue(const VirtualGPU* gpu);
+
+   private:
+    struct Entry {
+      size_t size_;       //!< The aligned size of the buffer
+      uint64_t handle_;   //!< The physical memory handle, 0 if the buffer is evicted
+      void* host_;        //!< The host copy of the evicted buffer
+      VirtualGPU* gpu_;   //!< The queue of the last use
+      uint64_t lastUse_;  //!< The epoch of the last use
+    };
+
+    //! Copies the buffer data with SDMA, must be called under the lock
+    bool copy(void* dst, const void* src, size_t size, bool toHost);
+
+    //! Creates and maps the physical memory of the buffer, must be called under the lock
+    bool map(address base, Entry& entry);
+
+    //! Moves the buffer into host memory, must be called under the lock
+    bool evictEntry(address base, Entry& entry);
+
+    //! Moves the buffer back into device memory, must be called under the lock
+    bool restoreEntry(address base, Entry& entry);
+
+    const Device& dev_;                  //!< ROC device object
+    size_t granularity_;                 //!< The granularity of the physical memory
+    std::atomic<uint64_t> clock_;        //!< The epoch clock of the memory uses
+    hsa_signal_t signal_;                //!< The completion signal of the eviction copies
+    std::map<address, Entry> entries_;   //!< All managed buffers, indexed by the base address
+    amd::Monitor lock_;                  //!< Lock for the managed buffers
+  };
+
   //! Initialise the whole HSA device subsystem (CAL init, device enumeration, etc).
   static bool init();
   static void tearDown();
@@ -372,6 +821,12 @@ class Device : public NullDevice {
                              device::Sampler** sampler   //!< device sampler object
                              ) const;
 
+  //! Returns a shared HSA sampler for the descriptor, which is created on the first use
+  bool acquireSampler(const hsa_ext_sampler_descriptor_t& desc, hsa_ext_sampler_t* sampler) const;
+
+  //! Releases the shared HSA sampler and destroys it after the last user
+  void releaseSampler(hsa_ext_sampler_t sampler) const;
+
   //! Just returns nullptr for the dummy device
   virtual device::Memory* createView(
       amd::Memory& owner,           //!< Owner memory object
@@ -410,15 +865,25 @@ class Device : public NullDevice {
 
   virtual void hostFree(void* ptr, size_t size = 0) const;
 
+  //! Allocates host memory from the HSA memory pool with the access of all GPUs
+  void* hsaHostAlloc(const hsa_amd_memory_pool_t& segment, size_t size) const;
+
   virtual bool enableP2P(amd::Device* peerDev);
   virtual bool disableP2P(amd::Device* peerDev);
 
   bool deviceAllowAccess(void* dst) const;
 
-  void* deviceLocalAlloc(size_t size, bool atomics = false) const;
+  //! Allocates device memory. The small buffers are sub-allocated from the slabs, unless
+  //! the caller requires the alignment of the memory pool allocation
+  void* deviceLocalAlloc(size_t size, bool atomics = false, bool subAlloc = true) const;
 
   void memFree(void* ptr, size_t size) const;
 
+  //! Trims the runtime caches of device memory in the cost order for the size.
+  //! The cold user buffers are evicted last, if \a evict is set.
+  //! Returns FALSE if no memory was released
+  bool reclaimMemory(size_t size, bool evict = true) const;
+
   virtual void* svmAlloc(amd::Context& context, size_t size, size_t alignment,
                          cl_svm_mem_flags flags = CL_MEM_READ_WRITE, void* svmPtr = nullptr) const;
 
@@ -426,6 +891,9 @@ class Device : public NullDevice {
 
   virtual bool SetSvmAttributes(const void* dev_ptr, size_t count,
                                 amd::MemoryAdvice advice, bool use_cpu = false) const;
+  virtual bool SetSvmAttributes(const std::vector<amd::SvmRange>& ranges,
+                                const std::vector<amd::MemoryAdvice>& advices,
+                                bool use_cpu = false) const;
   virtual bool GetSvmAttributes(void** data, size_t* data_sizes, int* attributes,
                                 size_t num_attributes, const void* dev_ptr, size_t count) const;
 
@@ -435,14 +903,24 @@ class Device : public NullDevice {
   virtual bool IsHwEventReady(const amd::Event& event, bool wait = false) const;
   virtual void ReleaseGlobalSignal(void* signal) const;
 
+  //! Returns an idle HSA signal from the device pool or creates a new one
+  bool acquireSignal(hsa_signal_t* signal) const;
+  //! Returns an idle HSA signal of a queue back into the device pool
+  void recycleSignal(hsa_signal_t signal) const;
+
+  //! Imports the external semaphore of a graphics API
+  virtual bool importExtSemaphore(void** extSemaphore, const amd::Os::FileDesc& handle);
+  //! Destroys the imported external semaphore
+  virtual void DestroyExtSemaphore(void* extSemaphore);
+
   //! Allocate host memory in terms of numa policy set by user
   void* hostNumaAlloc(size_t size, size_t alignment, bool atomics = false) const;
 
   //! Allocate host memory from agent info
   void* hostAgentAlloc(size_t size, const AgentInfo& agentInfo, bool atomics = false) const;
 
-  //! Returns transfer engine object
-  const device::BlitManager& xferMgr() const { return xferQueue()->blitMgr(); }
+  //! Returns transfer engine object of the calling thread
+  const device::BlitManager& xferMgr() const { return threadXferQueue()->blitMgr(); }
 
   const size_t alloc_granularity() const { return alloc_granularity_; }
 
@@ -460,6 +938,21 @@ class Device : public NullDevice {
   //! Returns transfer buffer object
   XferBuffers& xferRead() const { return *xferRead_; }
 
+  //! Returns the cache of pinned host memory, nullptr if the cache is disabled
+  PinnedMemCache* pinnedMemCache() const { return pinnedMemCache_; }
+
+  //! Returns the slab sub-allocator for the memory pool, nullptr if the sub-allocation is disabled
+  SlabAllocator* slabAllocator(bool atomics) const { return slabAllocator_[atomics ? 1 : 0]; }
+
+  //! Returns the cost model of the copy engines, nullptr if the automatic selection is disabled
+  CopyEngineModel* copyEngineModel() const { return copyEngineModel_; }
+
+  //! Returns the pageable transfer model, nullptr if the direct GPU access isn't available
+  PageableXferModel* pageableXferModel() const { return pageableXferModel_; }
+
+  //! Returns the oversubscription manager of device memory, nullptr if it's disabled
+  Oversubscription* oversubscription() const { return oversub_; }
+
   //! Returns a ROC memory object from AMD memory object
   roc::Memory* getRocMemory(amd::Memory* mem  //!< Pointer to AMD memory object
                             ) const;
@@ -474,6 +967,24 @@ class Device : public NullDevice {
   // P2P agents avaialble for this device
   const std::vector<hsa_agent_t>& p2pAgents() const { return p2p_agents_; }
 
+  //! Returns TRUE if the other device has the peer access to the memory of this device
+  bool isP2pAgent(const Device& other) const {
+    for (const auto& agent : p2p_agents_) {
+      if (agent.handle == other.getBackendDevice().handle) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //! Returns the link distance to the other device or to the host memory, if other is nullptr.
+  //! INT32_MAX means the link information isn't available
+  int32_t linkDistance(const Device* other) const;
+
+  //! Returns the device memory for the peer copies, relayed through this device.
+  //! The memory size is kP2PStagingSize and the caller must hold P2PStageOps() lock
+  void* relayStage() const;
+
   // User enabled peer devices
   const bool isP2pEnabled() const { return (enabled_p2p_devices_.size() > 0) ? true : false; }
 
@@ -484,6 +995,20 @@ class Device : public NullDevice {
   virtual bool IpcAttach(const void* handle, size_t mem_size, size_t mem_offset,
                          unsigned int flags, void** dev_ptr) const;
   virtual bool IpcDetach (void* dev_ptr) const;
+  using amd::Device::IpcAttach;
+
+  virtual size_t VirtualGranularity() const;
+  virtual void* VirtualReserve(void* addr, size_t size) const;
+  virtual bool VirtualFree(void* addr, size_t size) const;
+  virtual bool PhysicalCreate(size_t size, bool atomics, uint64_t* handle) const;
+  virtual bool PhysicalRelease(uint64_t handle) const;
+  virtual bool VirtualMap(void* addr, size_t size, size_t offset, uint64_t handle) const;
+  virtual bool VirtualUnmap(void* addr, size_t size) const;
+  virtual bool VirtualSetAccess(void* addr, size_t size, bool readOnly) const;
+  virtual amd::Memory* VirtualView(void* addr, size_t size, cl_mem_flags flags) const;
+
+  virtual bool CreateCuPartition(uint32_t percent, std::vector<uint32_t>* mask);
+  virtual void ReleaseCuPartition(const std::vector<uint32_t>& mask);
 
   bool AcquireExclusiveGpuAccess();
   void ReleaseExclusiveGpuAccess(VirtualGPU& vgpu) const;
@@ -496,12 +1021,19 @@ class Device : public NullDevice {
   const VirtualGPUs& vgpus() const { return vgpus_; }
   VirtualGPUs vgpus_;  //!< The list of all running virtual gpus (lock protected)
 
+  //! Returns the primary transfer queue, which also serves the exclusive device access
   VirtualGPU* xferQueue() const;
 
+  //! Returns the transfer queue of the calling thread from the pool of internal queues
+  VirtualGPU* threadXferQueue() const;
+
   hsa_amd_memory_pool_t SystemSegment() const { return system_segment_; }
 
   hsa_amd_memory_pool_t SystemCoarseSegment() const { return system_coarse_segment_; }
 
+  //! The size of the HSA queues for the streams, which the warm-up thread pre-creates
+  static constexpr uint32_t kDefaultQueueSize = 1024;
+
   //! Acquire HSA queue. This method can create a new HSA queue or
   //! share previously created
   hsa_queue_t* acquireQueue(uint32_t queue_size_hint, bool coop_queue = false,
@@ -527,8 +1059,9 @@ class Device : public NullDevice {
   roc::Memory* getGpuMemory(amd::Memory* mem  //!< Pointer to AMD memory object
                             ) const;
 
-  //! Initialize memory in AMD HMM on the current device or keeps it in the host memory
-  bool SvmAllocInit(void* memory, size_t size) const;
+  //! Initialize memory in AMD HMM on the current device or keeps it in the host memory.
+  //! The prefetch isn't waited, instead its signal is returned in the prefetch argument
+  bool SvmAllocInit(void* memory, size_t size, ProfilingSignal** prefetch) const;
 
   void getGlobalCUMask(std::string cuMaskStr);
 
@@ -542,12 +1075,18 @@ class Device : public NullDevice {
 
   bool SetSvmAttributesInt(const void* dev_ptr, size_t count, amd::MemoryAdvice advice,
                            bool first_alloc = false, bool use_cpu = false) const;
+
+  //! Adds HSA SVM attributes for the advice. Returns FALSE for an unknown advice
+  bool AddSvmAttributes(amd::MemoryAdvice advice, bool first_alloc, bool use_cpu,
+                        std::vector<hsa_amd_svm_attribute_pair_t>* attr) const;
+
+  //! Validates the range against the SW SVM tracking
+  bool ValidateSvmRange(const void* dev_ptr, size_t count) const;
   static constexpr hsa_signal_value_t InitSignalValue = 1;
 
   static hsa_ven_amd_loader_1_00_pfn_t amd_loader_ext_table;
 
-  amd::Monitor* mapCacheOps_;            //!< Lock to serialise cache for the map resources
-  std::vector<amd::Memory*>* mapCache_;  //!< Map cache info structure
+  device::MapCache* mapCache_;  //!< Map cache info structure
 
   bool populateOCLDeviceConstants();
   static bool isHsaInitialized_;
@@ -568,7 +1107,9 @@ class Device : public NullDevice {
   hsa_amd_memory_pool_t system_kernarg_segment_;
   hsa_amd_memory_pool_t gpuvm_segment_;
   hsa_amd_memory_pool_t gpu_fine_grained_segment_;
-  hsa_signal_t prefetch_signal_;    //!< Prefetch signal, used to explicitly prefetch SVM on device
+  std::once_flag arenaMemInit_;     //!< The arena memory object is created on the first use
+  int32_t hostLinkDistance_;        //!< The link distance to the closest host memory
+  mutable void* relayStage_;        //!< Device memory for the relayed peer copies
 
   size_t gpuvm_segment_max_alloc_;
   size_t alloc_granularity_;
@@ -577,9 +1118,16 @@ class Device : public NullDevice {
 
   XferBuffers* xferRead_;   //!< Transfer buffers read
   XferBuffers* xferWrite_;  //!< Transfer buffers write
+  PinnedMemCache* pinnedMemCache_;  //!< Cache of pinned host memory
+  SlabAllocator* slabAllocator_[2];  //!< Sub-allocators of coarse and fine grain memory
+  CopyEngineModel* copyEngineModel_;  //!< Cost model of the copy engines
+  PageableXferModel* pageableXferModel_;  //!< Throughput model of the pageable transfers
+  Oversubscription* oversub_;         //!< Oversubscription manager of device memory
+  HostMemPool* hostMemPool_;          //!< Pool of pinned host memory
   const IProDevice* pro_device_;  //!< AMDGPUPro device
   bool  pro_ena_;           //!< Extra functionality with AMDGPUPro device, beyond ROCr
   std::atomic<size_t> freeMem_;   //!< Total of free memory available
+  size_t reclaimWatermark_;       //!< Free memory, below which the caches are trimmed
   mutable amd::Monitor vgpusAccess_;     //!< Lock to serialise virtual gpu list access
   bool hsa_exclusive_gpu_access_;  //!< TRUE if current device was moved into exclusive GPU access mode
   static address mg_sync_;  //!< MGPU grid launch sync memory (SVM location)
@@ -587,15 +1135,17 @@ class Device : public NullDevice {
   struct QueueInfo {
     int refCount;
     void* hostcallBuffer_;
+    uint64_t lastWriteIndex_;  //!< The write index on the last pool selection
   };
 
   //! a vector for keeping Pool of HSA queues with low, normal and high priorities for recycling
   std::vector<std::map<hsa_queue_t*, QueueInfo>> queuePool_;
 
-  //! returns a hsa queue from queuePool with least refCount and updates the refCount as well
+  //! returns a hsa queue from queuePool with the lowest load and updates the refCount as well
   hsa_queue_t* getQueueFromPool(const uint qIndex);
 
   void* coopHostcallBuffer_;
+  size_t hostcallBufferSize_;  //!< The size of each hostcall buffer
   //! returns value for corresponding LinkAttrbutes in a vector given Memory pool.
   virtual bool findLinkInfo(const hsa_amd_memory_pool_t& pool,
                             std::vector<LinkAttrType>* link_attr);
@@ -603,6 +1153,63 @@ class Device : public NullDevice {
   //! Pool of HSA queues with custom CU masks
   std::vector<std::map<hsa_queue_t*, QueueInfo>> queueWithCUMaskPool_;
 
+  //! The background thread, which pre-creates HSA queues for the new streams
+  class QueueWarmer : public amd::Thread {
+   public:
+    QueueWarmer() : amd::Thread("HSA Queue Warm-up Thread") {}
+    virtual void run(void* data) { static_cast<Device*>(data)->warmQueues(); }
+  };
+
+  //! Creates a new HSA queue with the priority and the CU mask
+  hsa_queue_t* createHwQueue(uint32_t queue_size_hint, bool coop_queue,
+                             const std::vector<uint32_t>& cuMask,
+                             hsa_amd_queue_priority_t queue_priority) const;
+
+  //! Returns a pre-created queue of the priority or nullptr and updates the warm-up target
+  hsa_queue_t* takeWarmQueue(uint qIndex);
+
+  //! The warm-up thread loop, which keeps the number of pre-created queues at the target
+  void warmQueues();
+
+  amd::Monitor warmLock_;                              //!< Lock for the pre-created queues
+  std::vector<std::vector<hsa_queue_t*>> warmQueues_;  //!< Pre-created queues per priority
+  std::vector<uint> warmTarget_;                       //!< Pre-created queues to keep
+  bool warmTerminate_;                                 //!< The warm-up thread has to exit
+  QueueWarmer queueWarmer_;                            //!< The warm-up thread
+
+  amd::Monitor cuPartitionLock_;           //!< Lock for the CU partitions
+  std::vector<uint32_t> cuPartitionUsage_;  //!< The number of partitions, which use each CU
+
+  //! An imported IPC allocation, which is kept attached for the reuse
+  struct IpcImport {
+    hsa_amd_ipc_memory_t handle_;  //!< The IPC handle of the allocation
+    size_t size_;                  //!< The size of the allocation
+    void* ptr_;                    //!< The attached address
+    amd::Memory* memory_;          //!< The memory object of the import, retained by the cache
+    uint users_;                   //!< The number of the active attachments
+  };
+
+  //! Detaches the unused imports over the cache limit. Must be called under ipcLock_
+  void trimIpcImports(size_t limit) const;
+
+  mutable amd::Monitor ipcLock_;              //!< Lock for the IPC import cache
+  mutable std::list<IpcImport> ipcImports_;  //!< The IPC imports, the most recently used first
+
+  //! A HSA sampler, which is shared between the device samplers with the same state
+  struct SamplerEntry {
+    hsa_ext_sampler_t sampler_;  //!< The HSA sampler object
+    uint users_;                 //!< The number of the device samplers, which share it
+  };
+
+  mutable amd::Monitor samplerLock_;                       //!< Lock for the sampler cache
+  mutable std::map<uint32_t, SamplerEntry> samplerCache_;  //!< The samplers, keyed by the state
+
+  mutable amd::Monitor signalPoolLock_;             //!< Lock for the pool of idle signals
+  mutable std::vector<hsa_signal_t> signalPool_;  //!< Idle signals, released by the queues
+
+  mutable amd::Monitor xferPoolLock_;          //!< Lock for the pool of transfer queues
+  mutable std::vector<VirtualGPU*> xferPool_;  //!< Extra transfer queues, created on demand
+
  public:
   std::atomic<uint> numOfVgpus_;  //!< Virtual gpu unique index
 
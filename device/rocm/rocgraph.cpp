@@ -0,0 +1,243 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/rocm/rocgraph.hpp"
+#include "device/rocm/rocdevice.hpp"
+#include "device/rocm/rockernel.hpp"
+#include "device/rocm/rocvirtual.hpp"
+#include "platform/command.hpp"
+#include "platform/kernel.hpp"
+#include "os/os.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace roc {
+
+//! The minimum size of a kernel arguments segment in the graph
+static constexpr size_t kArenaSegmentSize = 64 * Ki;
+
+// ================================================================================================
+LaunchGraph::~LaunchGraph() {
+  // Make sure GPU doesn't use the recorded arguments anymore
+  waitLastReplay();
+  for (const auto& node : nodes_) {
+    const_cast<amd::Kernel*>(node.kernel_)->release();
+  }
+  for (const auto& segment : arena_) {
+    gpu_.dev().hostFree(segment.first, segment.second);
+    gpu_.dev().memoryUsage().remove(VDI_MEMORY_KERNARG, segment.second);
+  }
+}
+
+// ================================================================================================
+void* LaunchGraph::allocKernArg(size_t size, size_t alignment) {
+  if (!arena_.empty()) {
+    const auto& segment = arena_.back();
+    char* result = amd::alignUp(segment.first + arenaOffset_, alignment);
+    if ((result + size) <= (segment.first + segment.second)) {
+      arenaOffset_ = (result + size) - segment.first;
+      return result;
+    }
+  }
+  // The kernel arguments are never reused, hence just add a new segment
+  const size_t segmentSize = std::max(amd::alignUp(size + alignment, Ki), kArenaSegmentSize);
+  char* base = reinterpret_cast<char*>(gpu_.dev().hostAlloc(segmentSize, 0,
+                                       Device::MemorySegment::kKernArg));
+  if (base == nullptr) {
+    return nullptr;
+  }
+  arena_.push_back(std::make_pair(base, segmentSize));
+  gpu_.dev().memoryUsage().add(VDI_MEMORY_KERNARG, segmentSize);
+  char* result = amd::alignUp(base, alignment);
+  arenaOffset_ = (result + size) - base;
+  return result;
+}
+
+// ================================================================================================
+bool LaunchGraph::addPacket(const hsa_kernel_dispatch_packet_t& packet,
+                            uint16_t header, uint16_t rest) {
+  // Runtime doesn't track the memory dependencies on the replay,
+  // hence the recorded launches are always serialized with the barrier bit
+  packets_.push_back({packet, static_cast<uint16_t>(header | (1 << HSA_PACKET_HEADER_BARRIER)),
+                      rest});
+  return true;
+}
+
+// ================================================================================================
+bool LaunchGraph::waitLastReplay() {
+  if (lastSignal_ != nullptr) {
+    if (!WaitForSignal(lastSignal_->signal_, gpu_.waitPolicy())) {
+      LogError("Launch graph replay wait failed");
+      return false;
+    }
+    lastSignal_->release();
+    lastSignal_ = nullptr;
+  }
+  return true;
+}
+
+// ================================================================================================
+int32_t LaunchGraph::record(amd::NDRangeKernelCommand& command) {
+  if (command.cooperativeGroups() || command.cooperativeMultiDeviceGroups()) {
+    LogError("Cooperative launches can't be recorded!");
+    return -1;
+  }
+  if (command.indirectGroups() != nullptr) {
+    // The patch kernel writes the packet in the queue, so it can't be replayed from a copy
+    LogError("Indirect launches can't be recorded!");
+    return -1;
+  }
+  const amd::Kernel& kernel = command.kernel();
+  const Kernel* gpuKernel = static_cast<const Kernel*>(kernel.getDeviceKernel(gpu_.dev()));
+  if ((gpuKernel->printfInfo().size() > 0) || gpuKernel->dynamicParallelism()) {
+    // Printf output and the device enqueue scheduler require host work after each launch
+    LogError("Kernels with printf or device enqueue can't be recorded!");
+    return -1;
+  }
+
+  // Make sure VirtualGPU has an exclusive access to the resources
+  amd::ScopedLock lock(gpu_.execution());
+
+  const uint32_t firstPacket = static_cast<uint32_t>(packets_.size());
+  // The system scope request belongs to the next regular dispatch on the queue
+  const bool addSystemScope = gpu_.addSystemScope_;
+
+  // The memory objects are processed and the arguments are captured only once here
+  gpu_.capture_ = this;
+  bool result = gpu_.submitKernelInternal(command.sizes(), kernel, command.parameters(),
+                                          static_cast<void*>(as_cl(&command.event())),
+                                          command.sharedMemBytes(), &command);
+  gpu_.capture_ = nullptr;
+  gpu_.addSystemScope_ = addSystemScope;
+
+  if (!result) {
+    packets_.resize(firstPacket);
+    LogError("Launch graph record failed!");
+    return -1;
+  }
+
+  const_cast<amd::Kernel&>(kernel).retain();
+  nodes_.push_back({&kernel, firstPacket,
+                    static_cast<uint32_t>(packets_.size()) - firstPacket});
+  ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Launch graph %p recorded node %zu: %s",
+          this, nodes_.size() - 1, gpuKernel->name().c_str());
+  return static_cast<int32_t>(nodes_.size() - 1);
+}
+
+// ================================================================================================
+bool LaunchGraph::setArgument(uint32_t node, uint32_t index, const void* value, size_t size) {
+  if (node >= nodes_.size()) {
+    LogError("Invalid launch graph node!");
+    return false;
+  }
+  const Node& launch = nodes_[node];
+  const amd::KernelSignature& signature = launch.kernel_->signature();
+  if ((index >= signature.numParameters()) || (signature.at(index).size_ != size)) {
+    LogError("Invalid kernel argument for the launch graph node!");
+    return false;
+  }
+
+  amd::ScopedLock lock(gpu_.execution());
+
+  // The arguments are shared between replays, so GPU must finish the last one
+  if (!waitLastReplay()) {
+    return false;
+  }
+
+  // @note: The raw value is patched, so memory objects must be passed as device addresses
+  const size_t offset = signature.at(index).offset_;
+  for (uint32_t i = 0; i < launch.numPackets_; ++i) {
+    address argBuffer =
+        reinterpret_cast<address>(packets_[launch.firstPacket_ + i].packet_.kernarg_address);
+    memcpy(argBuffer + offset, value, size);
+  }
+  return true;
+}
+
+// ================================================================================================
+bool LaunchGraph::replay() {
+  if (packets_.empty()) {
+    return true;
+  }
+
+  // Make sure VirtualGPU has an exclusive access to the resources
+  amd::ScopedLock lock(gpu_.execution());
+
+  // Insert the dependencies on the other queues
+  gpu_.dispatchBlockingWait();
+  // The recorded arguments can point to the memory, which CPU wrote
+  gpu_.flushHdp();
+
+  hsa_queue_t* queue = gpu_.gpu_queue_;
+  const uint32_t queueMask = queue->size - 1;
+  // Copy the packets in batches, so the packet processor could free the slots
+  const uint32_t batchSize = std::max(queue->size / 2, 1u);
+  const uint32_t numPackets = static_cast<uint32_t>(packets_.size());
+
+  // Only the last packet has a completion signal, which tracks the whole replay
+  if (lastSignal_ != nullptr) {
+    lastSignal_->release();
+  }
+  hsa_signal_t completion = gpu_.Barriers().ActiveSignal();
+  lastSignal_ = gpu_.Barriers().GetLastSignal();
+  // HwQueueTracker will allocate a new signal on the reuse, since the reference count is bigger
+  lastSignal_->retain();
+
+  // The packet processor can't free the slots for the deferred packets
+  gpu_.ringDoorbell();
+
+  for (uint32_t first = 0; first < numPackets; first += batchSize) {
+    const uint32_t count = std::min(batchSize, numPackets - first);
+    const uint64_t index = hsa_queue_add_write_index_screlease(queue, count);
+    const uint64_t last = index + count - 1;
+    while ((last - hsa_queue_load_read_index_scacquire(queue)) >= queueMask) {
+      amd::Os::yield();
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+      const Packet& packet = packets_[first + i];
+      hsa_kernel_dispatch_packet_t* aql_loc =
+          &reinterpret_cast<hsa_kernel_dispatch_packet_t*>(queue->base_address)
+              [(index + i) & queueMask];
+      *aql_loc = packet.packet_;
+      if ((first + i) == (numPackets - 1)) {
+        aql_loc->completion_signal = completion;
+      }
+      // Publish the packet to the packet processor
+      __atomic_store_n(reinterpret_cast<uint32_t*>(aql_loc),
+                       packet.header_ | (packet.rest_ << 16), __ATOMIC_RELEASE);
+    }
+    hsa_signal_store_screlease(queue->doorbell_signal, last);
+  }
+
+  ClPrint(amd::LOG_DEBUG, amd::LOG_AQL, "[%zx] HWq=0x%zx, Launch graph %p replayed %u packets",
+          std::this_thread::get_id(), queue, this, numPackets);
+
+  // Mark the flag indicating if a dispatch is outstanding
+  gpu_.hasPendingDispatch_ = true;
+  // The recorded packets don't have the system release
+  gpu_.tailFenced_ = false;
+  gpu_.tailSignal_ = hsa_signal_t{};
+  return true;
+}
+
+}  // namespace roc
@@ -0,0 +1,87 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "device/device.hpp"
+
+#include <hsa.h>
+
+#include <utility>
+#include <vector>
+
+namespace roc {
+
+class VirtualGPU;
+struct ProfilingSignal;
+
+//! Recorded kernel launches on a ROC queue. The AQL packets and the kernel arguments are
+//! built once at the record time, so the replay is a copy of the packets into the AQL ring
+class LaunchGraph : public device::LaunchGraph {
+ public:
+  //! Constructor for the launch graph on the queue
+  LaunchGraph(VirtualGPU& gpu) : gpu_(gpu), lastSignal_(nullptr), arenaOffset_(0) {}
+
+  //! Destructor, waits for the last replay and frees the recorded arguments
+  ~LaunchGraph() override;
+
+  int32_t record(amd::NDRangeKernelCommand& command) override;
+
+  bool setArgument(uint32_t node, uint32_t index, const void* value, size_t size) override;
+
+  bool replay() override;
+
+  uint32_t numNodes() const override { return static_cast<uint32_t>(nodes_.size()); }
+
+ private:
+  friend class VirtualGPU;
+
+  //! A launch in the graph. Internal kernels with a big grid can be split into a few packets
+  struct Node {
+    const amd::Kernel* kernel_;  //!< The recorded kernel
+    uint32_t firstPacket_;        //!< The index of the first packet of the launch
+    uint32_t numPackets_;         //!< The number of packets of the launch
+  };
+
+  //! A prebuilt AQL packet with the header, which is published on the submission
+  struct Packet {
+    hsa_kernel_dispatch_packet_t packet_;  //!< Dispatch packet with an invalid header
+    uint16_t header_;                      //!< AQL header
+    uint16_t rest_;                        //!< Dispatch setup bits
+  };
+
+  //! Allocates persistent memory for kernel arguments in the graph arena
+  void* allocKernArg(size_t size, size_t alignment);
+
+  //! Stores the kernel dispatch packet, built by VirtualGPU in the capture mode
+  bool addPacket(const hsa_kernel_dispatch_packet_t& packet, uint16_t header, uint16_t rest);
+
+  //! Waits for the last replay, so the arguments can be updated
+  bool waitLastReplay();
+
+  VirtualGPU& gpu_;               //!< The queue for the recording and replay
+  std::vector<Node> nodes_;       //!< Recorded launches
+  std::vector<Packet> packets_;   //!< Recorded AQL packets
+  ProfilingSignal* lastSignal_;   //!< The completion signal of the last replay
+  std::vector<std::pair<char*, size_t>> arena_;  //!< Kernel arguments memory segments
+  size_t arenaOffset_;            //!< Current offset in the last segment
+};
+
+}  // namespace roc
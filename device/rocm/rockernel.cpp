@@ -43,11 +43,67 @@ Kernel::Kernel(std::string name, Program* prog)
     : device::Kernel(prog->device(), name, *prog) {
 }
 
+std::atomic<uint64_t> Kernel::launchPlanIds_(0);
+
+const Kernel::LaunchPlan& Kernel::launchPlan() const {
+  std::call_once(launchPlanInit_, [this]() {
+    // The kernel addresses can be reused, hence the caches are keyed by the id
+    launchPlan_.id_ = ++launchPlanIds_;
+    launchPlan_.plain_ = (printfInfo().size() == 0) && !dynamicParallelism();
+    launchPlan_.templated_ = !dynamicParallelism();
+    for (uint i = 0; i < 3; ++i) {
+      launchPlan_.globalOffset_[i] = -1;
+    }
+    const amd::KernelSignature& signature = this->signature();
+    for (uint32_t i = signature.numParameters(); i < signature.numParametersAll(); ++i) {
+      const auto& it = signature.at(i);
+      int32_t dim = -1;
+      switch (it.info_.oclObject_) {
+        case amd::KernelParameterDescriptor::HiddenNone:
+          continue;
+        case amd::KernelParameterDescriptor::HiddenGlobalOffsetX:
+          dim = 0;
+          break;
+        case amd::KernelParameterDescriptor::HiddenGlobalOffsetY:
+          dim = 1;
+          break;
+        case amd::KernelParameterDescriptor::HiddenGlobalOffsetZ:
+          dim = 2;
+          break;
+        case amd::KernelParameterDescriptor::HiddenPrintfBuffer:
+        case amd::KernelParameterDescriptor::HiddenHostcallBuffer:
+          // The buffers don't change between the launches on the same queue
+          launchPlan_.plain_ = false;
+          continue;
+        default:
+          // The device enqueue and multi grid arguments require the setup on each launch
+          launchPlan_.templated_ = false;
+          break;
+      }
+      if ((dim == -1) || (it.size_ != sizeof(size_t))) {
+        launchPlan_.plain_ = false;
+        launchPlan_.templated_ = false;
+      } else {
+        launchPlan_.globalOffset_[dim] = static_cast<int32_t>(it.offset_);
+      }
+    }
+  });
+  return launchPlan_;
+}
+
 #if defined(USE_COMGR_LIBRARY)
 bool LightningKernel::init() {
   return GetAttrCodePropMetadata();
 }
 
+bool LightningKernel::lazyInit() {
+  if (!init()) {
+    return false;
+  }
+  // The offline devices don't load the code object
+  return !program()->device().isOnline() || postLoad();
+}
+
 bool LightningKernel::postLoad() {
   // Set the kernel symbol name and size/alignment based on the kernel metadata
   // NOTE: kernel name is used to get the kernel code handle in V2,
@@ -67,6 +123,11 @@ bool LightningKernel::postLoad() {
     return false;
   }
 
+  // The code object load could be deferred until the first kernel use
+  if (!program()->ensureExecutable()) {
+    return false;
+  }
+
   // Get the kernel code handle
   hsa_status_t hsaStatus;
   hsa_executable_symbol_t symbol;
@@ -148,6 +209,10 @@ bool LightningKernel::postLoad() {
     return false;
   }
   assert(wavefront_size > 0);
+  // The program can be compiled for the wavefront size, different from the device mode
+  if (workGroupInfo_.wavefrontSize_ != 0) {
+    wavefront_size = workGroupInfo_.wavefrontSize_;
+  }
 
   workGroupInfo_.privateMemSize_ = workitemPrivateSegmentByteSize_;
   workGroupInfo_.localMemSize_ = workgroupGroupSegmentByteSize_;
@@ -159,6 +224,9 @@ bool LightningKernel::postLoad() {
   if (workGroupInfo_.size_ == 0) {
     return false;
   }
+  Occupancy occupied;
+  workGroupInfo_.maxOccupancyPerCu_ = occupancy(workGroupInfo_.size_, 0, {}, &occupied)
+      ? static_cast<int>(occupied.wavesPerCu_ * wavefront_size) : 0;
 
   // handle the printf metadata if any
   std::vector<std::string> printfStr;
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include "rocprogram.hpp"
 #include "top.hpp"
 #include "rocprintf.hpp"
@@ -46,6 +47,25 @@ class Kernel : public device::Kernel {
   virtual bool init() = 0;
 
   const Program* program() const { return static_cast<const Program*>(&prog_); }
+
+  //! The launch properties of the kernel, which don't change between the dispatches
+  struct LaunchPlan {
+    bool plain_;               //!< The hidden arguments are the global offsets only and the
+                               //!< kernel doesn't use printf or device enqueue
+    bool templated_;           //!< The other hidden arguments are the queue constants, so
+                               //!< they can be copied from a per queue template
+    int32_t globalOffset_[3];  //!< Offsets of the hidden global offsets, -1 if absent
+    uint64_t id_;              //!< Unique id of the kernel for the per queue caches
+  };
+
+  //! Returns the launch plan, which is resolved on the first launch of the kernel
+  const LaunchPlan& launchPlan() const;
+
+ private:
+  mutable LaunchPlan launchPlan_ = {};  //!< The launch properties of the kernel
+  mutable std::once_flag launchPlanInit_;
+
+  static std::atomic<uint64_t> launchPlanIds_;  //!< The last assigned launch plan id
 };
 
 class HSAILKernel : public roc::Kernel {
@@ -82,6 +102,10 @@ class LightningKernel : public roc::Kernel {
 
   //! Setup after code object loading
   bool postLoad();
+
+ protected:
+  //! Parses the metadata and runs the setup after loading on the first use of the kernel
+  bool lazyInit() override;
 };
 
 }  // namespace roc
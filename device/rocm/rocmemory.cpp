@@ -31,6 +31,7 @@
 #include "device/rocm/rocmemory.hpp"
 #include "device/rocm/rocdevice.hpp"
 #include "device/rocm/rocblit.hpp"
+#include "device/rocm/rocvirtual.hpp"
 #include "device/rocm/rocglinterop.hpp"
 #include "thread/monitor.hpp"
 #include "platform/memory.hpp"
@@ -50,7 +51,9 @@ Memory::Memory(const roc::Device& dev, amd::Memory& owner)
       kind_(MEMORY_KIND_NORMAL),
       amdImageDesc_(nullptr),
       persistent_host_ptr_(nullptr),
-      pinnedMemory_(nullptr) {}
+      prefetch_(nullptr),
+      pinnedMemory_(nullptr),
+      mapTargetUses_(0) {}
 
 Memory::Memory(const roc::Device& dev, size_t size)
     : device::Memory(size),
@@ -59,7 +62,9 @@ Memory::Memory(const roc::Device& dev, size_t size)
       kind_(MEMORY_KIND_NORMAL),
       amdImageDesc_(nullptr),
       persistent_host_ptr_(nullptr),
-      pinnedMemory_(nullptr) {}
+      prefetch_(nullptr),
+      pinnedMemory_(nullptr),
+      mapTargetUses_(0) {}
 
 Memory::~Memory() {
   // Destory pinned memory
@@ -73,8 +78,26 @@ Memory::~Memory() {
   }
 }
 
+void Memory::waitPrefetch() {
+  ProfilingSignal* prefetch = takePrefetch();
+  if (prefetch != nullptr) {
+    if (!WaitForSignal(prefetch->signal_)) {
+      LogError("SVM prefetch wait failed");
+    }
+    // Return the idle signal into the pool, unless a queue still holds it for a barrier
+    if (prefetch->referenceCount() == 1) {
+      dev().recycleSignal(prefetch->signal_);
+      prefetch->signal_.handle = 0;
+    }
+    prefetch->release();
+  }
+}
+
 bool Memory::allocateMapMemory(size_t allocationSize) {
-  assert(mapMemory_ == nullptr);
+  // A frequently mapped object keeps the map target between the maps
+  if (mapMemory_ != nullptr) {
+    return true;
+  }
 
   void* mapData = nullptr;
 
@@ -164,6 +187,12 @@ void Memory::decIndMapCount() {
 
   // Decrement the counter and release indirect map if it's the last op
   if (--indirectMapCount_ == 0 && mapMemory_ != nullptr) {
+    // Keep the map target of a frequently mapped object as a persistent host shadow,
+    // so the next maps don't go through the map cache and a new pinned allocation
+    if ((ROC_PERSISTENT_MAP_COUNT != 0) && (++mapTargetUses_ >= ROC_PERSISTENT_MAP_COUNT) &&
+        mapMemory_->canBeCached()) {
+      return;
+    }
     if (!dev().addMapTarget(mapMemory_)) {
       // Release the buffer object containing the map data.
       mapMemory_->release();
@@ -346,6 +375,17 @@ bool Memory::pinSystemMemory(void* hostPtr, size_t size) {
 }
 
 void Memory::syncCacheFromHost(VirtualGPU& gpu, device::Memory::SyncFlags syncFlags) {
+  // The peer memory already holds the data of the last writer, if it's the same allocation
+  if ((owner()->getLastWriter() != nullptr) && (&dev() != owner()->getLastWriter())) {
+    static const bool AllocWriter = false;
+    auto writer = static_cast<Memory*>(
+        owner()->getDeviceMemory(*owner()->getLastWriter(), AllocWriter));
+    if (sharesAllocation(writer)) {
+      version_ = owner()->getVersion();
+      return;
+    }
+  }
+
   // If the last writer was another GPU, then make a writeback
   if (!isHostMemDirectAccess() && (owner()->getLastWriter() != nullptr) &&
       (&dev() != owner()->getLastWriter())) {
@@ -415,6 +455,9 @@ void Memory::syncCacheFromHost(VirtualGPU& gpu, device::Memory::SyncFlags syncFl
       }
     }
 
+    // The version, which this memory had before the sync
+    const size_t syncVersion = version_;
+
     // Make sure we didn't have a NOP,
     // because this GPU device was the last writer
     if (&dev() != owner()->getLastWriter()) {
@@ -431,8 +474,30 @@ void Memory::syncCacheFromHost(VirtualGPU& gpu, device::Memory::SyncFlags syncFl
     static const bool Entire = true;
     amd::Coord3D origin(0, 0, 0);
 
+    // Transfer only the ranges, written after the last sync, if the buffer tracks them
+    std::vector<std::pair<size_t, size_t>> ranges;
+    if ((owner()->getType() == CL_MEM_OBJECT_BUFFER) &&
+        owner()->getWriteRanges(syncVersion, &ranges)) {
+      result = true;
+      for (const auto& range : ranges) {
+        amd::Coord3D rangeOrigin(range.first);
+        amd::Coord3D rangeSize(range.second);
+        if (flags_ & PinnedMemoryAlloced) {
+          Memory& pinned = *dev().getRocMemory(pinnedMemory_);
+          result &= gpu.blitMgr().copyBuffer(pinned, *this, rangeOrigin, rangeOrigin, rangeSize,
+                                             !Entire);
+        } else {
+          result &= gpu.blitMgr().writeBuffer(
+              reinterpret_cast<address>(owner()->getHostMem()) + range.first, *this, rangeOrigin,
+              rangeSize, !Entire);
+        }
+      }
+      ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "Partial sync to device: %zu ranges", ranges.size());
+    }
+    const bool partialSync = result;
+
     // If host memory was pinned then make a transfer
-    if (flags_ & PinnedMemoryAlloced) {
+    if (!result && (flags_ & PinnedMemoryAlloced)) {
       Memory& pinned = *dev().getRocMemory(pinnedMemory_);
       if (owner()->getType() == CL_MEM_OBJECT_BUFFER) {
         amd::Coord3D region(owner()->getSize());
@@ -458,6 +523,56 @@ void Memory::syncCacheFromHost(VirtualGPU& gpu, device::Memory::SyncFlags syncFl
 
     // Should never fail
     assert(result && "Memory synchronization failed!");
+
+    // Fan out the entire upload to the other devices over the peer links
+    if (result && !partialSync && ROC_P2P_BROADCAST) {
+      broadcastToPeers(gpu);
+    }
+  }
+}
+
+// ================================================================================================
+void Memory::broadcastToPeers(VirtualGPU& gpu) {
+  if ((owner()->getType() != CL_MEM_OBJECT_BUFFER) || (owner()->parent() != nullptr) ||
+      !owner()->subBuffers().empty() || !owner()->P2PAccess()) {
+    return;
+  }
+
+  static const bool Entire = true;
+  amd::Coord3D origin(0, 0, 0);
+  amd::Coord3D region(owner()->getSize());
+  std::vector<Memory*> pushed;
+
+  amd::ScopedLock lock(owner()->lockMemoryOps());
+  for (const auto& device : owner()->getContext().devices()) {
+    const Device& peerDev = *static_cast<const Device*>(device);
+    if (&peerDev == &dev()) {
+      continue;
+    }
+    // Only the allocated and outdated copies, which this device reaches faster
+    // than the peer reaches the host memory, receive the data
+    static const bool AllocPeer = false;
+    Memory* peer = static_cast<Memory*>(owner()->getDeviceMemory(peerDev, AllocPeer));
+    if ((peer == nullptr) || (peer->version_ == version_) || peer->isHostMemDirectAccess() ||
+        sharesAllocation(peer) ||
+        !peerDev.isP2pAgent(dev()) ||
+        (dev().linkDistance(&peerDev) >= peerDev.linkDistance(nullptr))) {
+      continue;
+    }
+    if (gpu.blitMgr().copyBuffer(*this, *peer, origin, origin, region, Entire)) {
+      pushed.push_back(peer);
+      ClPrint(amd::LOG_INFO, amd::LOG_COPY, "P2P broadcast of %zu bytes to %s", region[0],
+              peerDev.info().boardName_);
+    }
+  }
+
+  if (!pushed.empty()) {
+    // The peers don't wait for this queue, hence the copies must finish before
+    // the peer copies are marked as up to date
+    gpu.releaseGpuMemoryFence();
+    for (auto peer : pushed) {
+      peer->version_ = version_;
+    }
   }
 }
 
@@ -526,6 +641,9 @@ void Memory::syncHostFromCache(device::Memory::SyncFlags syncFlags) {
       }
     }
 
+    // The version, which the host memory had at least after the last sync with this memory
+    const size_t syncVersion = version_;
+
     // Make sure we didn't have a NOP,
     // because CPU was the last writer
     if (nullptr != owner()->getLastWriter()) {
@@ -542,8 +660,29 @@ void Memory::syncHostFromCache(device::Memory::SyncFlags syncFlags) {
     static const bool Entire = true;
     amd::Coord3D origin(0, 0, 0);
 
+    // Transfer only the ranges, written after the last sync, if the buffer tracks them
+    std::vector<std::pair<size_t, size_t>> ranges;
+    if ((owner()->getType() == CL_MEM_OBJECT_BUFFER) &&
+        owner()->getWriteRanges(syncVersion, &ranges)) {
+      result = true;
+      for (const auto& range : ranges) {
+        amd::Coord3D rangeOrigin(range.first);
+        amd::Coord3D rangeSize(range.second);
+        if (flags_ & PinnedMemoryAlloced) {
+          Memory& pinned = *dev().getRocMemory(pinnedMemory_);
+          result &= dev().xferMgr().copyBuffer(*this, pinned, rangeOrigin, rangeOrigin,
+                                               rangeSize, !Entire);
+        } else {
+          result &= dev().xferMgr().readBuffer(
+              *this, reinterpret_cast<address>(owner()->getHostMem()) + range.first, rangeOrigin,
+              rangeSize, !Entire);
+        }
+      }
+      ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "Partial sync to host: %zu ranges", ranges.size());
+    }
+
     // If backing store was pinned then make a transfer
-    if (flags_ & PinnedMemoryAlloced) {
+    if (!result && (flags_ & PinnedMemoryAlloced)) {
       Memory& pinned = *dev().getRocMemory(pinnedMemory_);
       if (owner()->getType() == CL_MEM_OBJECT_BUFFER) {
         amd::Coord3D region(owner()->getSize());
@@ -609,6 +748,37 @@ Buffer::~Buffer() {
   }
 }
 
+// ================================================================================================
+bool Buffer::createPeerAlias() {
+  if (owner()->getContext().devices().size() == 1) {
+    return false;
+  }
+
+  amd::ScopedLock lock(owner()->lockMemoryOps());
+  for (const auto& device : owner()->getContext().devices()) {
+    const Device& peerDev = *static_cast<const Device*>(device);
+    if ((&peerDev == &dev()) || !peerDev.isP2pAgent(dev())) {
+      continue;
+    }
+    static const bool AllocPeer = false;
+    const Memory* peer = static_cast<const Memory*>(owner()->getDeviceMemory(peerDev, AllocPeer));
+    // Only the device local allocation of the peer grants the access to this device
+    if ((peer == nullptr) || (peer->getDeviceMemory() == nullptr) ||
+        peer->isHostMemDirectAccess() ||
+        ((peer->getKind() != MEMORY_KIND_NORMAL) && (peer->getKind() != MEMORY_KIND_PEER))) {
+      continue;
+    }
+    deviceMemory_ = peer->getDeviceMemory();
+    kind_ = MEMORY_KIND_PEER;
+    // The data is current, if the peer memory is current
+    version_ = peer->version();
+    ClPrint(amd::LOG_INFO, amd::LOG_MEM, "Buffer %p of %zu bytes is accessed on %s over P2P",
+            owner(), size(), peerDev.info().boardName_);
+    return true;
+  }
+  return false;
+}
+
 // ================================================================================================
 void Buffer::destroy() {
   if (owner()->parent() != nullptr) {
@@ -620,6 +790,11 @@ void Buffer::destroy() {
     return;
   }
 
+  // The peer device owns the allocation
+  if (kind_ == MEMORY_KIND_PEER) {
+    return;
+  }
+
   cl_mem_flags memFlags = owner()->getMemFlags();
 
   if (owner()->getSvmPtr() != nullptr) {
@@ -633,6 +808,7 @@ void Buffer::destroy() {
         if (memFlags & CL_MEM_ALLOC_HOST_PTR) {
           if (dev().info().hmmSupported_) {
             // AMD HMM path. Destroy system memory
+            waitPrefetch();
             amd::Os::uncommitMemory(deviceMemory_, size());
             amd::Os::releaseMemory(deviceMemory_, size());
           } else {
@@ -674,6 +850,7 @@ void Buffer::destroy() {
         if (memFlags & (CL_MEM_USE_HOST_PTR | CL_MEM_ALLOC_HOST_PTR)) {
           if (dev().agent_profile() != HSA_PROFILE_FULL) {
             hsa_amd_memory_unlock(owner()->getHostMem());
+            dev().metrics().add(VDI_METRIC_UNPIN_CALLS);
           }
         }
       } else {
@@ -733,10 +910,12 @@ bool Buffer::create() {
             amd::Os::commitMemory(deviceMemory_, size(), amd::Os::MEM_PROT_RW);
             // Currently HMM requires cirtain initial calls to mark sysmem allocation as
             // GPU accessible or prefetch memory into GPU
-            if (!dev().SvmAllocInit(deviceMemory_, size())) {
+            ProfilingSignal* prefetch = nullptr;
+            if (!dev().SvmAllocInit(deviceMemory_, size(), &prefetch)) {
               ClPrint(amd::LOG_ERROR, amd::LOG_MEM, "SVM init in ROCr failed!");
               return false;
             }
+            prefetch_ = prefetch;
           } else {
             deviceMemory_ = dev().hostAlloc(size(), 1, Device::MemorySegment::kNoAtomics);
           }
@@ -771,7 +950,11 @@ bool Buffer::create() {
         }
       } else {
         assert(!isHostMemDirectAccess() && "Runtime doesn't support direct access to GPU memory!");
-        deviceMemory_ = dev().deviceLocalAlloc(size(), (memFlags & CL_MEM_SVM_ATOMICS) != 0);
+        // ROCr has no MALL control, the uncached policy maps to the fine grained memory
+        const bool uncached = (owner()->cachePolicy() == amd::Memory::kCacheUncached);
+        deviceMemory_ = dev().deviceLocalAlloc(size(),
+                                               uncached || ((memFlags & CL_MEM_SVM_ATOMICS) != 0),
+                                               !uncached);
       }
       owner()->setSvmPtr(deviceMemory_);
     } else {
@@ -835,7 +1018,16 @@ bool Buffer::create() {
 #endif
 
   if (!(memFlags & (CL_MEM_USE_HOST_PTR | CL_MEM_ALLOC_HOST_PTR))) {
-    deviceMemory_ = dev().deviceLocalAlloc(size());
+    // Access the buffer on the first touched device, if this device has a P2P path to it
+    if (ROC_P2P_FIRST_TOUCH && createPeerAlias()) {
+      return true;
+    }
+    if (owner()->cachePolicy() == amd::Memory::kCacheUncached) {
+      // The fine grained memory isn't cached in L2, the slabs are shared, hence no suballocation
+      deviceMemory_ = dev().deviceLocalAlloc(size(), true, false);
+    } else {
+      deviceMemory_ = dev().deviceLocalAlloc(size());
+    }
 
     if (deviceMemory_ == nullptr) {
       // TODO: device memory is not enabled yet.
@@ -912,6 +1104,8 @@ bool Buffer::create() {
       if (status != HSA_STATUS_SUCCESS) {
         DevLogPrintfError("Failed to lock memory to pool, failed with hsa_status: %d \n", status);
         deviceMemory_ = nullptr;
+      } else {
+        dev().metrics().add(VDI_METRIC_PIN_CALLS);
       }
     } else {
       deviceMemory_ = owner()->getHostMem();
@@ -1136,7 +1330,8 @@ bool Image::create() {
       : deviceImageInfo_.size + deviceImageInfo_.alignment;
 
   if (!(owner()->getMemFlags() & CL_MEM_ALLOC_HOST_PTR)) {
-    originalDeviceMemory_ = dev().deviceLocalAlloc(alloc_size);
+    // The image can require the alignment of the memory pool, hence skip the sub-allocation
+    originalDeviceMemory_ = dev().deviceLocalAlloc(alloc_size, false, false);
   }
 
   if (originalDeviceMemory_ == nullptr) {
@@ -1212,6 +1407,7 @@ bool Image::createView(const Memory& parent) {
       status = hsa_ext_image_create_with_layout(
         dev().getBackendDevice(), &imageDescriptor_, deviceMemory_, permission_,
         HSA_EXT_IMAGE_DATA_LAYOUT_LINEAR, rowPitch, 0, &hsaImageObject_);
+      linearRowPitch_ = rowPitch;
     }
   } else if (kind_ == MEMORY_KIND_INTEROP) {
     amdImageDesc_ = static_cast<Image*>(parent.owner()->getDeviceMemory(dev()))->amdImageDesc_;
@@ -42,7 +42,10 @@ class Memory : public device::Memory {
 
     MEMORY_KIND_PTRGIVEN,
 
-    MEMORY_KIND_ARENA
+    MEMORY_KIND_ARENA,
+
+    // The memory aliases the allocation of another device in the context over P2P
+    MEMORY_KIND_PEER
   };
 
   Memory(const roc::Device& dev, amd::Memory& owner);
@@ -79,6 +82,14 @@ class Memory : public device::Memory {
   //! Allocates host memory for synchronization with MGPU context
   void mgpuCacheWriteBack();
 
+  //! Copies the up to date memory into the outdated copies on the other devices of the context
+  void broadcastToPeers(VirtualGPU& gpu);
+
+  //! Returns TRUE if the memory of the other device uses the same allocation
+  bool sharesAllocation(const Memory* other) const {
+    return (other != nullptr) && (other->getDeviceMemory() == getDeviceMemory());
+  }
+
   // Releases indirect map surface
   void releaseIndirectMap() override { decIndMapCount(); }
 
@@ -118,6 +129,9 @@ class Memory : public device::Memory {
   //! Validates allocated memory for possible workarounds
   virtual bool ValidateMemory() { return true; }
 
+  //! Takes the pending SVM prefetch of the allocation. The caller owns the signal reference
+  ProfilingSignal* takePrefetch() { return prefetch_.exchange(nullptr); }
+
  protected:
   bool allocateMapMemory(size_t allocationSize);
 
@@ -127,6 +141,9 @@ class Memory : public device::Memory {
   // Free / deregister device memory.
   virtual void destroy() = 0;
 
+  //! Waits for the pending SVM prefetch, so the allocation can be released
+  void waitPrefetch();
+
   // Place interop object into HSA's flat address space
   bool createInteropBuffer(GLenum targetType, int miplevel);
 
@@ -148,6 +165,8 @@ class Memory : public device::Memory {
 
   void* persistent_host_ptr_;  //!< Host accessible pointer for persistent memory
 
+  std::atomic<ProfilingSignal*> prefetch_;  //!< The SVM prefetch, which no command waited yet
+
  private:
   // Disable copy constructor
   Memory(const Memory&);
@@ -156,6 +175,7 @@ class Memory : public device::Memory {
   Memory& operator=(const Memory&);
 
   amd::Memory* pinnedMemory_;  //!< Memory used as pinned system memory
+  uint mapTargetUses_;         //!< The number of the indirect maps through a map target
 };
 
 class Buffer : public roc::Memory {
@@ -186,6 +206,9 @@ class Buffer : public roc::Memory {
 
   // Free device memory.
   void destroy();
+
+  //! Uses the allocation of a peer device in the context, which this device can access
+  bool createPeerAlias();
 };
 
 class Image : public roc::Memory {
@@ -218,6 +241,9 @@ class Image : public roc::Memory {
 
   amd::Image* CopyImageBuffer() const { return copyImageBuffer_; }
 
+  //! Returns the row pitch in bytes of the linear layout or 0 for the tiled images
+  size_t linearRowPitch() const { return linearRowPitch_; }
+
  private:
   //! Disable copy constructor
   Image(const Buffer&);
@@ -240,6 +266,7 @@ class Image : public roc::Memory {
 
   void* originalDeviceMemory_;
   amd::Image* copyImageBuffer_ = nullptr;
+  size_t linearRowPitch_ = 0;  //!< Row pitch of the linear layout, so DMA can access it
 };
 }
 #endif
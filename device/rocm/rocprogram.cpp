@@ -23,6 +23,7 @@
 #include "rocprogram.hpp"
 
 #include "utils/options.hpp"
+#include "platform/runtime.hpp"
 #include "rockernel.hpp"
 
 #include "amd_hsa_kernel_code.h"
@@ -45,10 +46,14 @@ static inline const char* hsa_strerror(hsa_status_t status) {
   return "Unknown error";
 }
 
+std::atomic<uint64_t> Program::executableGeneration_(0);
+
 Program::~Program() {
   // Destroy the executable.
   if (hsaExecutable_.handle != 0) {
     hsa_executable_destroy(hsaExecutable_);
+    executableGeneration_.fetch_add(1, std::memory_order_acq_rel);
+    device().memoryUsage().remove(VDI_MEMORY_CODE, codeObjectSize_);
   }
   if (hsaCodeObjectReader_.handle != 0) {
     hsa_code_object_reader_destroy(hsaCodeObjectReader_);
@@ -56,9 +61,14 @@ Program::~Program() {
   releaseClBinary();
 }
 
-Program::Program(roc::NullDevice& device, amd::Program& owner) : device::Program(device, owner) {
+Program::Program(roc::NullDevice& device, amd::Program& owner)
+    : device::Program(device, owner),
+      deferredCodeObject_(nullptr, 0),
+      loadDeferred_(false),
+      executableLock_("Program executable lock") {
   hsaExecutable_.handle = 0;
   hsaCodeObjectReader_.handle = 0;
+  codeObjectSize_ = 0;
 }
 
 bool Program::initClBinary(char* binaryIn, size_t size) {
@@ -136,6 +146,22 @@ bool Program::createGlobalVarObj(amd::Memory** amd_mem_obj, void** device_pptr,
     return false;
   }
 
+#if defined(USE_COMGR_LIBRARY)
+  // The index rejects the missing names without the executable lookup
+  amd_comgr_symbol_type_t codeObjType;
+  if (hasCodeObjSymbols() && !findCodeObjSymbol(global_name, &codeObjType)) {
+    buildLog_ += "Error: Failed to find the Symbol by Name: ";
+    buildLog_ += global_name;
+    buildLog_ += "\n";
+    return false;
+  }
+#endif
+
+  if (!ensureExecutable()) {
+    buildLog_ += "Error: Failed to load the code object\n";
+    return false;
+  }
+
   hsa_device = rocDevice().getBackendDevice();
 
   /* Find HSA Symbol by name */
@@ -275,7 +301,10 @@ bool LightningProgram::createKernels(void* binary, size_t binSize, bool useUnifo
   for (const auto &kernelMeta : kernelMetadataMap_) {
     const std::string kernelName = kernelMeta.first;
     Kernel* aKernel = new roc::LightningKernel(kernelName, this);
-    if (!aKernel->init()) {
+    if (AMD_LAZY_KERNEL_INIT) {
+      // The kernel is indexed by the metadata map, parse the metadata on the first use
+      aKernel->deferInit();
+    } else if (!aKernel->init()) {
       return false;
     }
     aKernel->setUniformWorkGroupSize(useUniformWorkGroupSize);
@@ -285,15 +314,8 @@ bool LightningProgram::createKernels(void* binary, size_t binSize, bool useUnifo
   return true;
 }
 
-bool LightningProgram::setKernels(void* binary, size_t binSize,
-                                  amd::Os::FileDesc fdesc, size_t foffset, std::string uri) {
-#if defined(USE_COMGR_LIBRARY)
-  // Stop compilation if it is an offline device - HSA runtime does not
-  // support ISA compiled offline
-  if (!device().isOnline()) {
-    return true;
-  }
-
+// ================================================================================================
+bool Program::loadCodeObject(const void* binary, size_t binSize) {
   hsa_agent_t agent = rocDevice().getBackendDevice();
   hsa_status_t status;
 
@@ -334,10 +356,62 @@ bool LightningProgram::setKernels(void* binary, size_t binSize,
     buildLog_ += "\n";
     return false;
   }
+  executableGeneration_.fetch_add(1, std::memory_order_acq_rel);
+  codeObjectSize_ = binSize;
+  device().memoryUsage().add(VDI_MEMORY_CODE, codeObjectSize_);
+  return true;
+}
+
+// ================================================================================================
+bool Program::ensureExecutable() const {
+  if (!loadDeferred_.load(std::memory_order_acquire)) {
+    return true;
+  }
+  amd::ScopedLock lock(executableLock_);
+  // Another thread could finish the load
+  if (loadDeferred_.load(std::memory_order_relaxed)) {
+    Program* program = const_cast<Program*>(this);
+    if (!program->loadCodeObject(deferredCodeObject_.first, deferredCodeObject_.second)) {
+      LogPrintfError("Deferred code object load failed: %s", buildLog_.c_str());
+      return false;
+    }
+    ClPrint(amd::LOG_INFO, amd::LOG_CODE, "Program %p loaded the deferred code object", this);
+    program->loadDeferred_.store(false, std::memory_order_release);
+  }
+  return true;
+}
+
+bool LightningProgram::setKernels(void* binary, size_t binSize,
+                                  amd::Os::FileDesc fdesc, size_t foffset, std::string uri) {
+  amd::InitPhase phase("code object load");
+#if defined(USE_COMGR_LIBRARY)
+  // Stop compilation if it is an offline device - HSA runtime does not
+  // support ISA compiled offline
+  if (!device().isOnline()) {
+    return true;
+  }
+
+  // The code object load can be deferred, if all kernels are initialized on the first use
+  bool deferLoad = ROC_LAZY_CODE_OBJECT_LOAD;
+  for (const auto& kit : kernels()) {
+    deferLoad = deferLoad && kit.second->initDeferred();
+  }
+  if (deferLoad) {
+    deferredCodeObject_ = std::make_pair(binary, binSize);
+    loadDeferred_.store(true, std::memory_order_release);
+    ClPrint(amd::LOG_INFO, amd::LOG_CODE, "Program %p defers the code object load, %zu bytes",
+            this, binSize);
+    return true;
+  }
+
+  if (!loadCodeObject(binary, binSize)) {
+    return false;
+  }
 
   for (auto& kit : kernels()) {
     LightningKernel* kernel = static_cast<LightningKernel*>(kit.second);
-    if (!kernel->postLoad()) {
+    // The deferred kernels finish the setup on the first use
+    if (!kernel->initDeferred() && !kernel->postLoad()) {
       return false;
     }
   }
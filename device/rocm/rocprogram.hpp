@@ -22,6 +22,7 @@
 
 #ifndef WITHOUT_HSA_BACKEND
 
+#include <atomic>
 #include <string>
 #include <sstream>
 #include <fstream>
@@ -61,9 +62,17 @@ class Program : public device::Program {
     return hsaExecutable_;
   }
 
+  //! Loads the deferred code object on the first use. Returns FALSE if the load failed
+  bool ensureExecutable() const;
+
   virtual bool createGlobalVarObj(amd::Memory** amd_mem_obj, void** dptr,
                                   size_t* bytes, const char* globalName) const;
 
+  //! Returns the generation of the runtime executables, which changes on each load and unload
+  static uint64_t executableGeneration() {
+    return executableGeneration_.load(std::memory_order_acquire);
+  }
+
  protected:
   /*! \brief Compiles LLVM binary to HSAIL code (compiler backend: link+opt+codegen)
    *
@@ -80,10 +89,21 @@ class Program : public device::Program {
   Program& operator=(const Program&) = delete;
 
   virtual bool defineGlobalVar(const char* name, void* dptr);
+
+  //! Creates the HSA executable from the code object and freezes it
+  bool loadCodeObject(const void* binary, size_t binSize);
 protected:
   /* HSA executable */
   hsa_executable_t hsaExecutable_;               //!< Handle to HSA executable
   hsa_code_object_reader_t hsaCodeObjectReader_; //!< Handle to HSA code reader
+  size_t codeObjectSize_;                        //!< The size of the loaded code object
+
+  //! The code object, which loading is deferred to the first use
+  std::pair<const void*, size_t> deferredCodeObject_;
+  std::atomic<bool> loadDeferred_;               //!< The code object load is deferred
+  mutable amd::Monitor executableLock_;          //!< Lock for the deferred load
+
+  static std::atomic<uint64_t> executableGeneration_;  //!< The generation of the executables
 };
 
 class HSAILProgram : public roc::Program {
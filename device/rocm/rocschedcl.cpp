@@ -40,4 +40,32 @@ __kernel void __amd_rocclr_gwsInit(uint value) {
 }
 \n);
 
+const char* PatchDispatchSourceCode = BLIT_KERNEL(
+\n
+__kernel void __amd_rocclr_patchDispatch(ulong groups, ulong packet, uint header,
+                                         uint barrierHeader) {
+  // The indirect launch reads the workgroup counts, written by the previous kernels, and
+  // publishes the reserved AQL packet. A launch without workgroups becomes a barrier packet
+  __global const uint* counts = (__global const uint*)groups;
+  __global uint* aql = (__global uint*)packet;
+  __global const ushort* workgroup = (__global const ushort*)(aql + 1);
+  uint x = counts[0];
+  uint y = counts[1];
+  uint z = counts[2];
+  if ((x == 0) || (y == 0) || (z == 0)) {
+    // Clear everything, but the header and the completion signal
+    for (uint i = 1; i < 14; ++i) {
+      aql[i] = 0;
+    }
+    header = barrierHeader;
+  } else {
+    aql[3] = x * workgroup[0];
+    aql[4] = y * workgroup[1];
+    aql[5] = z * workgroup[2];
+  }
+  atomic_store_explicit((__global atomic_uint*)aql, header, memory_order_release,
+                        memory_scope_all_svm_devices);
+}
+\n);
+
 }  // namespace roc
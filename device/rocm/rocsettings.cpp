@@ -48,6 +48,12 @@ Settings::Settings() {
   maxWorkGroupSize3DZ_ = 4;
 
   kernargPoolSize_ = HSA_KERNARG_POOL_SIZE;
+  kernargPoolChunks_ = HSA_KERNARG_POOL_CHUNKS;
+  aqlBatchSize_ = std::max(ROC_AQL_BATCH_SIZE, 1u);
+  aqlBatchTimeout_ = static_cast<uint64_t>(ROC_AQL_BATCH_TIMEOUT) * K;
+  directKernArgs_ = ROC_DIRECT_KERNARG;
+  kernargPoolMaxSize_ = std::max(static_cast<size_t>(HSA_KERNARG_POOL_MAX_SIZE),
+                                 static_cast<size_t>(kernargPoolSize_));
 
   // Determine if user is requesting Non-Coherent mode
   // for system memory. By default system memory is
@@ -58,12 +64,14 @@ Settings::Settings() {
   nonCoherentMode = getenv("OPENCL_USE_NC_MEMORY_POLICY");
   enableNCMode_ = (nonCoherentMode) ? true : false;
 
-  // Disable image DMA by default (ROCM runtime doesn't support it)
-  imageDMA_ = false;
+  // ROCm runtime can't access the tiled images with DMA, hence the flag enables
+  // SDMA only for the linear images
+  imageDMA_ = GPU_IMAGE_DMA;
 
   stagedXferRead_ = true;
   stagedXferWrite_ = true;
   stagedXferSize_ = GPU_STAGING_BUFFER_SIZE * Ki;
+  stagedXferChunks_ = std::max(GPU_STAGING_BUFFER_CHUNKS, 1u);
 
   // Initialize transfer buffer size to 1MB by default
   xferBufSize_ = 1024 * Ki;
@@ -71,8 +79,13 @@ Settings::Settings() {
   const static size_t MaxPinnedXferSize = 32;
   pinnedXferSize_ = std::min(GPU_PINNED_XFER_SIZE, MaxPinnedXferSize) * Mi;
   pinnedMinXferSize_ = std::min(GPU_PINNED_MIN_XFER_SIZE * Ki, pinnedXferSize_);
+  pinnedCacheSize_ = GPU_PINNED_CACHE_SIZE * Mi;
+  // The slabs are divided into at least a few blocks
+  slabMaxSize_ = std::min(ROC_SLAB_MAX_SIZE * Ki, static_cast<size_t>(512 * Ki));
 
   sdmaCopyThreshold_ = GPU_FORCE_BLIT_COPY_SIZE * Ki;
+  largeBarWriteSize_ = ROC_LARGE_BAR_WRITE_SIZE * Ki;
+  copyStripeSize_ = ROC_COPY_STRIPE_SIZE * Mi;
 
   // Don't support Denormals for single precision by default
   singleFpDenorm_ = false;
@@ -92,11 +105,17 @@ Settings::Settings() {
 
   rocr_backend_ = true;
 
-  cpu_wait_for_signal_ = !AMD_DIRECT_DISPATCH;
+  // The dependencies on the other queues are resolved with GPU barriers after a short active wait
+  cpu_wait_for_signal_ = false;
   cpu_wait_for_signal_ = (!flagIsDefault(ROC_CPU_WAIT_FOR_SIGNAL)) ?
                           ROC_CPU_WAIT_FOR_SIGNAL : cpu_wait_for_signal_;
   system_scope_signal_ = ROC_SYSTEM_SCOPE_SIGNAL;
   skip_copy_sync_      = ROC_SKIP_COPY_SYNC;
+  engineRangeDeps_     = ROC_ENGINE_RANGE_DEPS;
+  async_scheduler_     = ROC_ASYNC_SCHEDULER;
+  multi_grid_sweep_    = ROC_MULTI_GRID_SWEEP;
+  copyEngineModel_     = ROC_COPY_ENGINE_MODEL;
+  oversubscribe_       = ROC_OVERSUBSCRIBE;
 }
 
 // ================================================================================================
@@ -108,6 +127,7 @@ bool Settings::create(bool fullProfile, uint32_t gfxipMajor, uint32_t gfxipMinor
     pinnedXferSize_ = 0;
     stagedXferSize_ = 0;
     xferBufSize_ = 0;
+    pinnedCacheSize_ = 0;
     apuSystem_ = true;
   } else {
     pinnedXferSize_ = std::max(pinnedXferSize_, pinnedMinXferSize_);
@@ -52,7 +52,12 @@ class Settings : public device::Settings {
       uint cpu_wait_for_signal_ : 1;    //!< Wait for HSA signal on CPU
       uint system_scope_signal_ : 1;    //!< HSA signal is visibile to the entire system
       uint skip_copy_sync_ : 1;         //!< Ignore explicit HSA signal waits for copy functionality
-      uint reserved_ : 21;
+      uint async_scheduler_ : 1;        //!< Wait for the device enqueue scheduler on GPU
+      uint multi_grid_sweep_ : 1;       //!< Ring multi-device launch doorbells together
+      uint copyEngineModel_ : 1;        //!< Select the copy engine with the cost model
+      uint engineRangeDeps_ : 1;        //!< Cross engine waits only on overlapped memory ranges
+      uint oversubscribe_ : 1;          //!< Evict the cold device buffers into host memory
+      uint reserved_ : 16;
     };
     uint value_;
   };
@@ -73,15 +78,24 @@ class Settings : public device::Settings {
   int maxWorkGroupSize3DZ_;
 
   uint kernargPoolSize_;
+  uint kernargPoolChunks_;        //!< The number of chunks in the kernel arguments pool
+  uint aqlBatchSize_;             //!< The number of AQL packets per doorbell ring
+  uint64_t aqlBatchTimeout_;      //!< Max delay (ns) of the doorbell ring for batched packets
+  size_t kernargPoolMaxSize_;     //!< Max size of the kernel arguments pool with the growth
   uint numDeviceEvents_;      //!< The number of device events
   uint numWaitEvents_;        //!< The number of wait events for device enqueue
 
   size_t xferBufSize_;        //!< Transfer buffer size for image copy optimization
   size_t stagedXferSize_;     //!< Staged buffer size
+  uint stagedXferChunks_;     //!< The number of pipelined chunks in the staged buffer
   size_t pinnedXferSize_;     //!< Pinned buffer size for transfer
   size_t pinnedMinXferSize_;  //!< Minimal buffer size for pinned transfer
+  size_t pinnedCacheSize_;    //!< The size of pinned host memory cache
+  size_t slabMaxSize_;        //!< The biggest buffer size for the slab sub-allocation
 
   size_t sdmaCopyThreshold_;  //!< Use SDMA to copy above this size
+  size_t largeBarWriteSize_;  //!< CPU writes the large BAR memory up to this size
+  size_t copyStripeSize_;     //!< Stripe the copies above this size, 0 - disabled
 
   uint32_t  hmmFlags_;        //!< HMM functionality control flags
 
@@ -0,0 +1,362 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "device/rocm/rocthreadtrace.hpp"
+#include "device/rocm/roccounters.hpp"
+#include "device/rocm/rocmemory.hpp"
+#include "device/rocm/rocvirtual.hpp"
+#include "platform/memory.hpp"
+#include "utils/flags.hpp"
+#include "os/os.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+
+namespace roc {
+
+//! The unique index of the stream files in the process
+static std::atomic<uint32_t> streamIndex(0);
+
+// ================================================================================================
+static hsa_status_t ThreadTraceCallback(hsa_ven_amd_aqlprofile_info_type_t info_type,
+                                        hsa_ven_amd_aqlprofile_info_data_t* info_data,
+                                        void* callback_data) {
+  if (info_type == HSA_VEN_AMD_AQLPROFILE_INFO_TRACE_DATA) {
+    reinterpret_cast<std::vector<hsa_ven_amd_aqlprofile_info_data_t>*>(callback_data)
+        ->push_back(*info_data);
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+// ================================================================================================
+ThreadTrace::ThreadTrace(VirtualGPU& gpu, const std::vector<amd::Memory*>& memObjs, uint numSe)
+    : gpu_(gpu),
+      numSe_(numSe),
+      memObj_(memObjs),
+      api_({0}),
+      gfxVersion_(PerfCounter::ROC_UNSUPPORTED),
+      current_(0),
+      numBuffers_(ROC_THREAD_TRACE_STREAM[0] != '\0' ? 2 : 1),
+      active_(false),
+      dispatches_(0),
+      sequence_(0),
+      stream_(nullptr) {
+  memset(buffers_, 0, sizeof(buffers_));
+}
+
+// ================================================================================================
+ThreadTrace::~ThreadTrace() {
+  // The thread trace object is always associated with a particular queue,
+  // so we have to lock just this queue
+  amd::ScopedLock lock(gpu_.execution());
+  if (gpu_.threadTrace_ == this) {
+    gpu_.threadTrace_ = nullptr;
+  }
+  if (active_) {
+    end();
+  }
+  for (auto& buffer : buffers_) {
+    if (buffer.pending_) {
+      drain(&buffer, true);
+    }
+    if (buffer.completionSignal_.handle != 0) {
+      hsa_signal_destroy(buffer.completionSignal_);
+    }
+    if (buffer.profile_.command_buffer.ptr != nullptr) {
+      gpu_.dev().hostFree(buffer.profile_.command_buffer.ptr,
+                          buffer.profile_.command_buffer.size);
+    }
+    if (buffer.profile_.output_buffer.ptr != nullptr) {
+      gpu_.dev().hostFree(buffer.profile_.output_buffer.ptr, buffer.profile_.output_buffer.size);
+    }
+  }
+  if (stream_ != nullptr) {
+    fclose(stream_);
+  }
+}
+
+// ================================================================================================
+bool ThreadTrace::create() {
+  hsa_agent_t agent = gpu_.dev().getBackendDevice();
+  bool system_support = false;
+  bool agent_support = false;
+  hsa_system_extension_supported(HSA_EXTENSION_AMD_AQLPROFILE, 1, 0, &system_support);
+  hsa_agent_extension_supported(HSA_EXTENSION_AMD_AQLPROFILE, agent, 1, 0, &agent_support);
+  if (!system_support || !agent_support ||
+      (hsa_system_get_major_extension_table(HSA_EXTENSION_AMD_AQLPROFILE,
+          hsa_ven_amd_aqlprofile_VERSION_MAJOR, sizeof(hsa_ven_amd_aqlprofile_pfn_t),
+          &api_) != HSA_STATUS_SUCCESS)) {
+    LogError("The aqlprofile extension isn't available for the thread trace");
+    return false;
+  }
+
+  // The legacy PM4 blob of GFX8 doesn't carry the completion signal of the stop packet
+  switch (gpu_.dev().isa().versionMajor()) {
+    case 9:
+      gfxVersion_ = PerfCounter::ROC_GFX9;
+      break;
+    case 10:
+      gfxVersion_ = PerfCounter::ROC_GFX10;
+      break;
+    default:
+      LogError("The thread trace isn't supported on the device");
+      return false;
+  }
+
+  if ((numSe_ == 0) || (memObj_.size() < numSe_)) {
+    LogError("The amount of buffers should be equal to the amount of Shader Engines");
+    return false;
+  }
+
+  if (numBuffers_ > 1) {
+    std::ostringstream name;
+    name << ROC_THREAD_TRACE_STREAM << '.' << ::getpid() << '.' << streamIndex++;
+    stream_ = fopen(name.str().c_str(), "wb");
+    if (stream_ == nullptr) {
+      LogPrintfError("Can't open the thread trace stream: %s", name.str().c_str());
+      return false;
+    }
+    ClPrint(amd::LOG_INFO, amd::LOG_QUEUE, "Thread trace stream: %s", name.str().c_str());
+  }
+  return true;
+}
+
+// ================================================================================================
+bool ThreadTrace::createBuffer(Buffer* buffer, size_t size) {
+  hsa_ven_amd_aqlprofile_profile_t& profile = buffer->profile_;
+  profile.agent = gpu_.dev().getBackendDevice();
+  profile.type = HSA_VEN_AMD_AQLPROFILE_EVENT_TYPE_TRACE;
+  profile.parameters = params_.data();
+  profile.parameter_count = static_cast<uint32_t>(params_.size());
+
+  // Query the command buffer size
+  profile.command_buffer = {nullptr, 0};
+  profile.output_buffer = {nullptr, 0};
+  if (api_.hsa_ven_amd_aqlprofile_start(&profile, nullptr) != HSA_STATUS_SUCCESS) {
+    return false;
+  }
+  const size_t cmdSize = profile.command_buffer.size;
+  const uint32_t alignment = amd::Os::pageSize();
+  profile.command_buffer.ptr =
+      gpu_.dev().hostAlloc(cmdSize, alignment, Device::MemorySegment::kAtomics);
+  if (profile.command_buffer.ptr == nullptr) {
+    return false;
+  }
+  profile.command_buffer.size = cmdSize;
+
+  // The output buffer is split between the shader engines by the library
+  profile.output_buffer.size = amd::alignUp(size, alignment);
+  profile.output_buffer.ptr =
+      gpu_.dev().hostAlloc(profile.output_buffer.size, alignment, Device::MemorySegment::kAtomics);
+  if (profile.output_buffer.ptr == nullptr) {
+    return false;
+  }
+
+  if (hsa_signal_create(kInitSignalValueOne, 0, nullptr, &buffer->completionSignal_) !=
+      HSA_STATUS_SUCCESS) {
+    return false;
+  }
+
+  // The packets are built once and reused for all starts of the buffer
+  if ((api_.hsa_ven_amd_aqlprofile_start(&profile, &buffer->prePacket_) != HSA_STATUS_SUCCESS) ||
+      (api_.hsa_ven_amd_aqlprofile_stop(&profile, &buffer->postPacket_) != HSA_STATUS_SUCCESS)) {
+    return false;
+  }
+  buffer->postPacket_.completion_signal = buffer->completionSignal_;
+  return true;
+}
+
+// ================================================================================================
+bool ThreadTrace::begin(const amd::ThreadTrace::ThreadTraceConfig* config) {
+  if (active_) {
+    return true;
+  }
+  if (buffers_[0].completionSignal_.handle == 0) {
+    if (config != nullptr) {
+      params_.push_back({HSA_VEN_AMD_AQLPROFILE_PARAMETER_NAME_COMPUTE_UNIT_TARGET,
+                         static_cast<uint32_t>(config->cu_)});
+      params_.push_back({HSA_VEN_AMD_AQLPROFILE_PARAMETER_NAME_VM_ID_MASK,
+                         static_cast<uint32_t>(config->vmIdMask_)});
+      params_.push_back({HSA_VEN_AMD_AQLPROFILE_PARAMETER_NAME_MASK,
+                         static_cast<uint32_t>(config->simdMask_)});
+      params_.push_back({HSA_VEN_AMD_AQLPROFILE_PARAMETER_NAME_TOKEN_MASK,
+                         static_cast<uint32_t>(config->tokenMask_)});
+      params_.push_back({HSA_VEN_AMD_AQLPROFILE_PARAMETER_NAME_TOKEN_MASK2,
+                         static_cast<uint32_t>(config->regMask_)});
+    }
+    // Each trace buffer has the capacity of all bound memory objects
+    size_t size = 0;
+    for (uint se = 0; se < numSe_; ++se) {
+      size += memObj_[se]->getSize();
+    }
+    for (uint i = 0; i < numBuffers_; ++i) {
+      if (!createBuffer(&buffers_[i], size)) {
+        LogError("Failed to create the thread trace buffer");
+        return false;
+      }
+    }
+  }
+  current_ = 0;
+  dispatches_ = 0;
+  active_ = start();
+  return active_;
+}
+
+// ================================================================================================
+bool ThreadTrace::start() {
+  Buffer& buffer = buffers_[current_];
+  hsa_signal_store_relaxed(buffer.completionSignal_, kInitSignalValueOne);
+  return gpu_.dispatchCounterAqlPacket(&buffer.prePacket_, gfxVersion_, false, &api_);
+}
+
+// ================================================================================================
+bool ThreadTrace::stop(bool blocking) {
+  Buffer& buffer = buffers_[current_];
+  if (!gpu_.dispatchCounterAqlPacket(&buffer.postPacket_, gfxVersion_, blocking, &api_)) {
+    return false;
+  }
+  buffer.pending_ = true;
+  return true;
+}
+
+// ================================================================================================
+bool ThreadTrace::end() {
+  if (!active_) {
+    return true;
+  }
+  active_ = false;
+  if (!stop(true)) {
+    LogError("Failed to stop the thread trace");
+    return false;
+  }
+  Buffer& buffer = buffers_[current_];
+  if (streaming()) {
+    // The previous buffer completed before the last one in the queue order
+    for (auto& it : buffers_) {
+      if (it.pending_) {
+        drain(&it, true);
+      }
+    }
+    fflush(stream_);
+    return true;
+  }
+  buffer.pending_ = false;
+  return copyToUserMemory(&buffer);
+}
+
+// ================================================================================================
+void ThreadTrace::dispatched() {
+  if (!active_ || !streaming()) {
+    return;
+  }
+  Buffer& other = buffers_[current_ ^ 1];
+  // Drain the stopped buffer as soon as GPU completes it, so the next switch doesn't wait
+  if (other.pending_) {
+    drain(&other, false);
+  }
+  if (++dispatches_ < ROC_THREAD_TRACE_STREAM_PERIOD) {
+    return;
+  }
+  dispatches_ = 0;
+
+  // GPU can't write the other buffer, until the host drained it
+  if (other.pending_) {
+    drain(&other, true);
+  }
+  if (!stop(false)) {
+    LogError("Failed to switch the thread trace buffer");
+    active_ = false;
+    return;
+  }
+  current_ ^= 1;
+  active_ = start();
+}
+
+// ================================================================================================
+bool ThreadTrace::drain(Buffer* buffer, bool wait) {
+  if (wait) {
+    WaitForSignal(buffer->completionSignal_, gpu_.waitPolicy());
+  } else if (hsa_signal_load_scacquire(buffer->completionSignal_) > 0) {
+    return false;
+  }
+  buffer->pending_ = false;
+  if (!streaming()) {
+    return true;
+  }
+
+  std::vector<hsa_ven_amd_aqlprofile_info_data_t> data;
+  api_.hsa_ven_amd_aqlprofile_iterate_data(&buffer->profile_, ThreadTraceCallback, &data);
+  for (const auto& it : data) {
+    ChunkHeader header = {kChunkMagic, it.sample_id, sequence_, it.trace_data.size};
+    fwrite(&header, sizeof(header), 1, stream_);
+    fwrite(it.trace_data.ptr, 1, it.trace_data.size, stream_);
+  }
+  ++sequence_;
+  if (ferror(stream_)) {
+    LogError("Failed to write the thread trace stream");
+    return false;
+  }
+  return true;
+}
+
+// ================================================================================================
+bool ThreadTrace::copyToUserMemory(Buffer* buffer) {
+  std::vector<hsa_ven_amd_aqlprofile_info_data_t> data;
+  api_.hsa_ven_amd_aqlprofile_iterate_data(&buffer->profile_, ThreadTraceCallback, &data);
+  for (const auto& it : data) {
+    if (it.sample_id >= numSe_) {
+      continue;
+    }
+    roc::Memory* gpuMem = gpu_.dev().getGpuMemory(memObj_[it.sample_id]);
+    const size_t size = std::min(static_cast<size_t>(it.trace_data.size), gpuMem->size());
+    if ((size != 0) &&
+        !gpu_.blitMgr().writeBuffer(it.trace_data.ptr, *gpuMem, amd::Coord3D(0, 0, 0),
+                                    amd::Coord3D(size, 0, 0))) {
+      LogError("Failed to copy the thread trace into the memory object");
+      return false;
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+bool ThreadTrace::info(uint infoType, uint* info, uint infoSize) const {
+  switch (infoType) {
+    case CL_THREAD_TRACE_BUFFERS_SIZE: {
+      if (infoSize < numSe_) {
+        LogError("The amount of buffers should be equal to the amount of Shader Engines");
+        return false;
+      }
+      for (uint se = 0; se < numSe_; ++se) {
+        info[se] = static_cast<uint>(memObj_[se]->getSize());
+      }
+      break;
+    }
+    default:
+      LogError("Wrong ThreadTrace::getInfo parameter");
+      return false;
+  }
+  return true;
+}
+
+}  // namespace roc
@@ -0,0 +1,133 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+#include "device/device.hpp"
+#include "device/rocm/rocdevice.hpp"
+#include "platform/threadtrace.hpp"
+#include "hsa_ven_amd_aqlprofile.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace roc {
+
+class VirtualGPU;
+
+//! ThreadTrace (SQTT) implementation with the aqlprofile extension. By default the trace
+//! is captured into one buffer and copied into the bound memory objects on the end command.
+//! In the streaming mode two trace buffers are used: every Nth dispatch the active buffer
+//! is stopped and the trace continues in the other one, while the host drains the stopped
+//! buffer into a file. Hence the trace length isn't limited by the trace memory
+class ThreadTrace : public device::ThreadTrace {
+ public:
+  //! The header of each trace chunk in the stream file, followed by the trace data
+  struct ChunkHeader {
+    uint32_t magic_;     //!< Trace chunk signature
+    uint32_t se_;        //!< The shader engine of the trace data
+    uint64_t sequence_;  //!< The index of the drained buffer
+    uint64_t size_;      //!< The size of the trace data in bytes
+  };
+
+  static constexpr uint32_t kChunkMagic = 0x54545153;  //!< "SQTT"
+
+  ThreadTrace(VirtualGPU& gpu,                           //!< The queue with the trace
+              const std::vector<amd::Memory*>& memObjs,  //!< ThreadTrace memory objects
+              uint numSe                                 //!< Number of Shader Engines
+              );
+
+  //! Waits for the pending trace buffers and closes the stream
+  virtual ~ThreadTrace();
+
+  //! Initializes the extension API and opens the stream file in the streaming mode
+  bool create();
+
+  //! Starts the trace with the configuration of the begin command. The trace buffers
+  //! and the packets are built on the first begin with the configuration
+  bool begin(const amd::ThreadTrace::ThreadTraceConfig* config);
+
+  //! Stops the trace. The captured data goes into the memory objects or the stream
+  bool end();
+
+  //! Switches the trace buffers in the streaming mode, called after each dispatch
+  void dispatched();
+
+  //! Returns the specific information about the thread trace object
+  bool info(uint infoType,  //!< The type of returned information
+            uint* info,     //!< The returned information
+            uint infoSize   //!< The size of returned information
+            ) const;
+
+  //! Set isNewBufferBinded_ to true/false if new buffer was binded/unbinded respectively
+  void setNewBufferBinded(bool isNewBufferBinded) {}
+
+  //! Returns TRUE if the trace is streamed into a file
+  bool streaming() const { return stream_ != nullptr; }
+
+ private:
+  //! A trace buffer with the packets, built once
+  struct Buffer {
+    hsa_ven_amd_aqlprofile_profile_t profile_;  //!< HSA profile context object
+    hsa_ext_amd_aql_pm4_packet_t prePacket_;    //!< AQL packet for the trace start
+    hsa_ext_amd_aql_pm4_packet_t postPacket_;   //!< AQL packet for the trace stop
+    hsa_signal_t completionSignal_;             //!< The signal of the stop packet
+    bool pending_;  //!< The stop packet was sent, but the data wasn't drained yet
+  };
+
+  //! Disable default copy constructor
+  ThreadTrace(const ThreadTrace&);
+
+  //! Disable default operator=
+  ThreadTrace& operator=(const ThreadTrace&);
+
+  //! Allocates the memory and builds the packets of the trace buffer
+  bool createBuffer(Buffer* buffer, size_t size);
+
+  //! Starts the trace in the current buffer
+  bool start();
+
+  //! Stops the trace in the current buffer
+  bool stop(bool blocking);
+
+  //! Writes the trace data of a stopped buffer into the stream. If wait is FALSE, then
+  //! returns FALSE for the buffer, which GPU didn't complete yet
+  bool drain(Buffer* buffer, bool wait);
+
+  //! Copies the trace data of a stopped buffer into the bound memory objects
+  bool copyToUserMemory(Buffer* buffer);
+
+  VirtualGPU& gpu_;                   //!< The queue with the trace
+  uint numSe_;                        //!< Number of Shader Engines
+  std::vector<amd::Memory*> memObj_;  //!< ThreadTrace memory objects
+  hsa_ven_amd_aqlprofile_1_00_pfn_t api_;  //!< The extension API table
+  uint32_t gfxVersion_;               //!< The IP version of the device for the PM4 packets
+  std::vector<hsa_ven_amd_aqlprofile_parameter_t> params_;  //!< The trace parameters
+  Buffer buffers_[2];                 //!< The trace buffers
+  uint current_;                      //!< The buffer, which GPU writes
+  uint numBuffers_;                   //!< The number of the used trace buffers
+  bool active_;                       //!< The trace is between the begin and end commands
+  uint64_t dispatches_;               //!< The dispatches in the current buffer
+  uint64_t sequence_;                 //!< The number of the drained buffers
+  FILE* stream_;                      //!< The stream file in the streaming mode
+};
+
+}  // namespace roc
@@ -21,10 +21,12 @@
 #if defined(__clang__)
 #if __has_feature(address_sanitizer)
 #include "rocurilocator.hpp"
+#include "rocprogram.hpp"
+#include <algorithm>
 #include <sstream>
 
 namespace roc {
-hsa_status_t UriLocator::createUriRangeTable() {
+hsa_status_t UriLocator::updateUriRangeTable() {
   auto execCb = [] (hsa_executable_t exec,
     void *data) -> hsa_status_t {
     int execState = 0;
@@ -32,68 +34,112 @@ hsa_status_t UriLocator::createUriRangeTable() {
     status = hsa_executable_get_info(exec, HSA_EXECUTABLE_INFO_STATE, &execState);
     if (status != HSA_STATUS_SUCCESS)
       return status;
-    if (execState != HSA_EXECUTABLE_STATE_FROZEN)
-      return status;
+    if (execState == HSA_EXECUTABLE_STATE_FROZEN)
+      static_cast<std::set<uint64_t>*>(data)->insert(exec.handle);
+    return HSA_STATUS_SUCCESS;
+  };
 
-    auto loadedCodeObjectCb = [] (hsa_executable_t exec,
-       hsa_loaded_code_object_t lcobj, void *data) -> hsa_status_t {
-       hsa_status_t result;
-       uint64_t loadBAddr = 0, loadSize = 0;
-       uint32_t uriLen = 0;
-       int64_t delta = 0;
-       uint64_t *argsCb = static_cast<uint64_t *>(data);
-       hsa_ven_amd_loader_1_03_pfn_t *fnTab =
-         reinterpret_cast<hsa_ven_amd_loader_1_03_pfn_t*> (argsCb[0]);
-       std::vector<UriRange> *rangeTab =
-         reinterpret_cast<std::vector<UriRange>*> (argsCb[1]);
-
-       if (!fnTab->hsa_ven_amd_loader_loaded_code_object_get_info)
-         return HSA_STATUS_ERROR;
-
-       result = fnTab->hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
-         HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_LOAD_BASE, (void*) &loadBAddr);
-       if (result != HSA_STATUS_SUCCESS)
-         return result;
-
-       result = fnTab->hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
-         HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_LOAD_SIZE, (void*) &loadSize);
-       if (result != HSA_STATUS_SUCCESS)
-         return result;
-
-       result = fnTab->hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
-         HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_URI_LENGTH, (void*) &uriLen);
-       if (result != HSA_STATUS_SUCCESS)
-         return result;
-
-       result = fnTab-> hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
-         HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_LOAD_DELTA, (void*) &delta);
-       if (result != HSA_STATUS_SUCCESS)
-         return result;
-
-       char *uri = new char[uriLen+1];
-       uri[uriLen] = '\0';
-       result = fnTab->hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
-         HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_URI, (void*) uri);
-       if (result != HSA_STATUS_SUCCESS)
-         return result;
-       rangeTab->push_back(UriRange{loadBAddr, loadBAddr+loadSize-1,
-          delta, std::string{uri,uriLen+1}});
-       delete[] uri;
-       return HSA_STATUS_SUCCESS;
-   };
-
-   uint64_t *args = static_cast<uint64_t *>(data);
-   hsa_ven_amd_loader_1_03_pfn_t *fnExtTab =
-     reinterpret_cast<hsa_ven_amd_loader_1_03_pfn_t*> (args[0]);
-   return fnExtTab->hsa_ven_amd_loader_executable_iterate_loaded_code_objects(exec,
-         loadedCodeObjectCb, data);
+  auto loadedCodeObjectCb = [] (hsa_executable_t exec,
+     hsa_loaded_code_object_t lcobj, void *data) -> hsa_status_t {
+     hsa_status_t result;
+     uint64_t loadBAddr = 0, loadSize = 0;
+     uint32_t uriLen = 0;
+     int64_t delta = 0;
+     uint64_t *argsCb = static_cast<uint64_t *>(data);
+     hsa_ven_amd_loader_1_03_pfn_t *fnTab =
+       reinterpret_cast<hsa_ven_amd_loader_1_03_pfn_t*> (argsCb[0]);
+     std::vector<UriRange> *rangeTab =
+       reinterpret_cast<std::vector<UriRange>*> (argsCb[1]);
+
+     if (!fnTab->hsa_ven_amd_loader_loaded_code_object_get_info)
+       return HSA_STATUS_ERROR;
+
+     result = fnTab->hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
+       HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_LOAD_BASE, (void*) &loadBAddr);
+     if (result != HSA_STATUS_SUCCESS)
+       return result;
+
+     result = fnTab->hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
+       HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_LOAD_SIZE, (void*) &loadSize);
+     if (result != HSA_STATUS_SUCCESS)
+       return result;
+
+     result = fnTab->hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
+       HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_URI_LENGTH, (void*) &uriLen);
+     if (result != HSA_STATUS_SUCCESS)
+       return result;
+
+     result = fnTab-> hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
+       HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_LOAD_DELTA, (void*) &delta);
+     if (result != HSA_STATUS_SUCCESS)
+       return result;
+
+     std::string uri(uriLen + 1, '\0');
+     result = fnTab->hsa_ven_amd_loader_loaded_code_object_get_info(lcobj,
+       HSA_VEN_AMD_LOADER_LOADED_CODE_OBJECT_INFO_URI, (void*) &uri[0]);
+     if (result != HSA_STATUS_SUCCESS)
+       return result;
+     rangeTab->push_back(UriRange{loadBAddr, loadBAddr+loadSize-1,
+        delta, std::move(uri), exec.handle});
+     return HSA_STATUS_SUCCESS;
   };
 
-  if (!fn_table_.hsa_ven_amd_loader_iterate_executables)
+  if (!fn_table_.hsa_ven_amd_loader_iterate_executables ||
+      !fn_table_.hsa_ven_amd_loader_executable_iterate_loaded_code_objects)
     return HSA_STATUS_ERROR;
 
+  // Only the handles of the loaded executables are collected on each update
+  std::set<uint64_t> current;
+  hsa_status_t status = fn_table_.hsa_ven_amd_loader_iterate_executables(execCb, &current);
+  if (status != HSA_STATUS_SUCCESS)
+    return status;
+
+  // Remove the code objects of the unloaded executables
+  auto removed = std::remove_if(rangeTab_.begin(), rangeTab_.end(),
+    [&current](const UriRange& range) { return current.count(range.exec_) == 0; });
+  bool changed = (removed != rangeTab_.end());
+  rangeTab_.erase(removed, rangeTab_.end());
+
+  // Add the code objects of the new executables
   uint64_t callbackArgs[2] = {(uint64_t)& fn_table_, (uint64_t) &rangeTab_};
-  return fn_table_.hsa_ven_amd_loader_iterate_executables(execCb, (void*) callbackArgs);
+  for (auto exec : current) {
+    if (executables_.count(exec) != 0)
+      continue;
+    status = fn_table_.hsa_ven_amd_loader_executable_iterate_loaded_code_objects(
+        hsa_executable_t{exec}, loadedCodeObjectCb, (void*) callbackArgs);
+    if (status != HSA_STATUS_SUCCESS)
+      return status;
+    changed = true;
+  }
+  executables_.swap(current);
+
+  if (changed) {
+    std::sort(rangeTab_.begin(), rangeTab_.end(),
+      [](const UriRange& a, const UriRange& b) { return a.startAddr_ < b.startAddr_; });
+    // The indices of the recent hits are invalid after the update
+    std::fill_n(hitCache_, kHitCacheSize, SIZE_MAX);
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+const UriLocator::UriRange* UriLocator::findRange(uint64_t device_pc) {
+  // The reports usually come in bursts from the same code object
+  for (auto idx : hitCache_) {
+    if (idx < rangeTab_.size() && rangeTab_[idx].startAddr_ <= device_pc &&
+        device_pc <= rangeTab_[idx].endAddr_)
+      return &rangeTab_[idx];
+  }
+  // The code objects don't overlap, hence only the last range before the address can match
+  auto it = std::upper_bound(rangeTab_.begin(), rangeTab_.end(), device_pc,
+    [](uint64_t pc, const UriRange& range) { return pc < range.startAddr_; });
+  if (it == rangeTab_.begin())
+    return nullptr;
+  --it;
+  if (device_pc > it->endAddr_)
+    return nullptr;
+  hitCache_[hitNext_] = it - rangeTab_.begin();
+  hitNext_ = (hitNext_ + 1) % kHitCacheSize;
+  return &(*it);
 }
 
 // Encoding of uniform-resource-identifier(URI) is detailed in
@@ -164,17 +210,35 @@ UriLocator::UriInfo UriLocator::lookUpUri(uint64_t device_pc) {
         sizeof(fn_table_), &fn_table_);
     if (result != HSA_STATUS_SUCCESS)
       return errorstate;
-    result = createUriRangeTable();
-    if (result != HSA_STATUS_SUCCESS) {
+    init_ = true;
+    generation_ = Program::executableGeneration() - 1;
+  }
+
+  // The runtime loaded or unloaded an executable since the last update
+  const uint64_t generation = Program::executableGeneration();
+  bool updated = false;
+  if (generation != generation_) {
+    if (updateUriRangeTable() != HSA_STATUS_SUCCESS) {
       rangeTab_.clear();
+      executables_.clear();
       return errorstate;
     }
-    init_ = true;
+    generation_ = generation;
+    updated = true;
   }
 
-  for(auto& seg : rangeTab_)
-    if (seg.startAddr_ <= device_pc && device_pc <= seg.endAddr_)
-     return UriInfo{seg.Uri_.c_str(), seg.elfDelta_};
+  const UriRange* range = findRange(device_pc);
+  if (range == nullptr && !updated) {
+    // The code object could be loaded outside of the runtime
+    if (updateUriRangeTable() != HSA_STATUS_SUCCESS) {
+      rangeTab_.clear();
+      executables_.clear();
+      return errorstate;
+    }
+    range = findRange(device_pc);
+  }
+  if (range != nullptr)
+    return UriInfo{range->Uri_.c_str(), range->elfDelta_};
 
   return errorstate;
 }
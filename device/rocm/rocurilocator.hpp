@@ -24,20 +24,34 @@
 #include "device/devurilocator.hpp"
 #include "hsa_ven_amd_loader.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <set>
 #include <vector>
 namespace roc {
 class UriLocator : public device::UriLocator {
+  static constexpr size_t kHitCacheSize = 4;  //!< The number of the cached recent hits
+
   bool init_ = false;
   struct UriRange {
     uint64_t startAddr_, endAddr_;
     int64_t elfDelta_;
     std::string  Uri_;
+    uint64_t exec_;   //!< The executable of the code object
   };
-  std::vector<UriRange> rangeTab_;
+  std::vector<UriRange> rangeTab_;    //!< The code objects, sorted by the start address
+  std::set<uint64_t> executables_;    //!< The executables in the table
+  uint64_t generation_ = 0;           //!< The runtime executable generation of the table
+  size_t hitCache_[kHitCacheSize];    //!< The table indices of the recent hits
+  size_t hitNext_ = 0;                //!< The next entry in the hit cache
   hsa_ven_amd_loader_1_03_pfn_t fn_table_;
 
-  hsa_status_t createUriRangeTable();
+  //! Adds the code objects of the new executables and removes the unloaded ones
+  hsa_status_t updateUriRangeTable();
+  //! Finds the code object of the address in the table
+  const UriRange* findRange(uint64_t device_pc);
   public:
+   UriLocator() { std::fill_n(hitCache_, kHitCacheSize, SIZE_MAX); }
    virtual ~UriLocator() {}
    virtual UriInfo lookUpUri(uint64_t device_pc) override;
    virtual std::pair<uint64_t, uint64_t> decodeUriAndGetFd(UriInfo& uri_path,
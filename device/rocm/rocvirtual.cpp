@@ -19,12 +19,15 @@
  THE SOFTWARE. */
 
 #include "device/devhostcall.hpp"
+#include "device/devtuning.hpp"
 #include "device/rocm/rocdevice.hpp"
 #include "device/rocm/rocvirtual.hpp"
 #include "device/rocm/rockernel.hpp"
 #include "device/rocm/rocmemory.hpp"
 #include "device/rocm/rocblit.hpp"
 #include "device/rocm/roccounters.hpp"
+#include "device/rocm/rocgraph.hpp"
+#include "device/rocm/rocthreadtrace.hpp"
 #include "platform/kernel.hpp"
 #include "platform/context.hpp"
 #include "platform/command.hpp"
@@ -33,9 +36,15 @@
 #include "platform/sampler.hpp"
 #include "utils/debug.hpp"
 #include "os/os.hpp"
+#include "thread/thread.hpp"
 #include "amd_hsa_kernel_code.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
@@ -81,6 +90,11 @@ static constexpr uint16_t kNopPacketHeader =
     (HSA_FENCE_SCOPE_NONE << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE) |
     (HSA_FENCE_SCOPE_NONE << HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE);
 
+static constexpr uint16_t kBarrierPacketNoFenceHeader =
+    (HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE) | (1 << HSA_PACKET_HEADER_BARRIER) |
+    (HSA_FENCE_SCOPE_NONE << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE) |
+    (HSA_FENCE_SCOPE_NONE << HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE);
+
 static constexpr uint16_t kBarrierPacketAcquireHeader =
     (HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE) | (1 << HSA_PACKET_HEADER_BARRIER) |
     (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE) |
@@ -102,12 +116,148 @@ static constexpr hsa_barrier_and_packet_t kBarrierAcquirePacket = {
 static constexpr hsa_barrier_and_packet_t kBarrierReleasePacket = {
     kBarrierPacketReleaseHeader, 0, 0, {{0}}, 0, {0}};
 
+//! The maximum number of the cached perf counter profiles on a queue
+static constexpr size_t kMaxCounterProfiles = 16;
+
+//! The number of the waves per CU, ROCr reserves the scratch for
+static constexpr uint64_t kScratchWavesPerCu = 32;
+
+//! The limit of the hidden arguments templates on a queue
+static constexpr size_t kMaxHiddenArgs = 256;
+
+//! The number of the dispatches in the hang snapshot
+static constexpr size_t kHangHistorySize = 16;
+//! The interval of the progress checks in the hang detection (10ms)
+static constexpr uint64_t kHangCheckInterval = 10 * 1000 * K;
+
 double Timestamp::ticksToTime_ = 0;
+Timestamp::Calibration Timestamp::calibrations_[2] = {};
+std::atomic<uint32_t> Timestamp::calibrationId_(0);
+std::atomic<uint64_t> Timestamp::nextCalibration_(0);
+amd::Monitor Timestamp::calibrationLock_("Timestamp calibration lock");
+
+//! The number of the clock sample pairs per calibration. The pair with the shortest
+//! host interval has the smallest error
+static constexpr uint kCalibrationSamples = 4;
+//! The measured slope can't differ from the nominal frequency more than by 0.1%
+static constexpr double kMaxClockDrift = 1e-3;
+
+amd::Monitor VirtualGPU::multiGridLock_("Multi-device launch lock");
+
+//! Runs the host operations of all queues in the submission order on a helper thread.
+//! The thread is never destroyed, since the operations can be in flight at the exit
+class HostOpThread : public amd::Thread {
+ public:
+  //! Returns the thread or nullptr if it couldn't start
+  static HostOpThread* get() {
+    static HostOpThread* thread = create();
+    return thread;
+  }
+
+  //! Queues the operation for the execution
+  void submit(std::function<void()>&& op) {
+    amd::ScopedLock lock(lock_);
+    ops_.push_back(std::move(op));
+    lock_.notify();
+  }
+
+ private:
+  HostOpThread() : amd::Thread("Host Op Thread", CQ_THREAD_STACK_SIZE), lock_("Host op lock") {}
+
+  static HostOpThread* create() {
+    HostOpThread* thread = new HostOpThread();
+    if ((thread == nullptr) || (thread->state() < amd::Thread::INITIALIZED) ||
+        !thread->start()) {
+      LogWarning("Host operation thread creation failed");
+      delete thread;
+      return nullptr;
+    }
+    return thread;
+  }
+
+  //! The host operation thread entry point
+  void run(void* data) {
+    while (true) {
+      std::function<void()> op;
+      {
+        amd::ScopedLock lock(lock_);
+        while (ops_.empty()) {
+          lock_.wait();
+        }
+        op = std::move(ops_.front());
+        ops_.pop_front();
+      }
+      op();
+    }
+  }
+
+  amd::Monitor lock_;                      //!< Lock for the operations
+  std::deque<std::function<void()>> ops_;  //!< The operations in the submission order
+};
+std::map<uint64_t, std::vector<VirtualGPU*>> VirtualGPU::multiGridQueues_;
 
 static unsigned extractAqlBits(unsigned v, unsigned pos, unsigned width) {
   return (v >> pos) & ((1 << width) - 1);
 };
 
+// ================================================================================================
+uint64_t Timestamp::ticksToHostTime(uint64_t ticks) {
+  const Calibration& point = calibrations_[calibrationId_.load(std::memory_order_acquire)];
+  if (point.host_ == 0) {
+    return ticks * ticksToTime_;
+  }
+  const int64_t delta = static_cast<int64_t>(ticks - point.ticks_);
+  return point.host_ + static_cast<int64_t>(delta * point.slope_);
+}
+
+// ================================================================================================
+void Timestamp::calibrate() {
+  amd::ScopedLock lock(calibrationLock_);
+  const uint64_t now = amd::Os::timeNanos();
+  const uint64_t period = static_cast<uint64_t>(ROC_TIMESTAMP_CALIBRATION) * 1000 * K;
+  const uint32_t id = calibrationId_.load(std::memory_order_relaxed);
+  const Calibration& last = calibrations_[id];
+  if ((last.host_ != 0) && (now < nextCalibration_.load(std::memory_order_relaxed))) {
+    // Another thread just updated the calibration
+    return;
+  }
+
+  uint64_t ticks = 0;
+  uint64_t host = 0;
+  uint64_t bestInterval = std::numeric_limits<uint64_t>::max();
+  for (uint i = 0; i < kCalibrationSamples; ++i) {
+    uint64_t sample = 0;
+    const uint64_t before = amd::Os::timeNanos();
+    if (HSA_STATUS_SUCCESS != hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP, &sample)) {
+      LogError("Failed to sample the system timestamp for the calibration");
+      nextCalibration_.store(now + period, std::memory_order_relaxed);
+      return;
+    }
+    const uint64_t after = amd::Os::timeNanos();
+    if ((after - before) < bestInterval) {
+      bestInterval = after - before;
+      ticks = sample;
+      host = before + bestInterval / 2;
+    }
+  }
+
+  Calibration& next = calibrations_[id ^ 1];
+  next.ticks_ = ticks;
+  next.host_ = host;
+  next.slope_ = (last.host_ != 0) ? last.slope_ : ticksToTime_;
+  if ((last.host_ != 0) && (ticks > last.ticks_) && (host > last.host_)) {
+    const double slope = static_cast<double>(host - last.host_) / (ticks - last.ticks_);
+    // Ignore the measurement, if the thread was preempted between the samples
+    if (std::abs(slope - ticksToTime_) <= (ticksToTime_ * kMaxClockDrift)) {
+      next.slope_ = slope;
+    }
+  }
+  calibrationId_.store(id ^ 1, std::memory_order_release);
+  nextCalibration_.store(now + period, std::memory_order_relaxed);
+  ClPrint(amd::LOG_INFO, amd::LOG_INIT, "Timestamp calibration: ticks=%lu, host=%lu, "
+          "drift=%.3f ppm", ticks, host, (next.slope_ / ticksToTime_ - 1.0) * 1e6);
+}
+
 // ================================================================================================
 void Timestamp::checkGpuTime() {
   amd::ScopedLock s(lock_);
@@ -145,8 +295,24 @@ void Timestamp::checkGpuTime() {
     }
     signals_.clear();
     if (end != 0) {
-      start_ = start * ticksToTime_;
-      end_ = end * ticksToTime_;
+      if ((ROC_TIMESTAMP_CALIBRATION != 0) &&
+          (amd::Os::timeNanos() >= nextCalibration_.load(std::memory_order_relaxed))) {
+        calibrate();
+      }
+      start_ = ticksToHostTime(start);
+      end_ = ticksToHostTime(end);
+      // The GPU time of the kernels is sampled only on the profiled launches
+      if (AMD_KERNEL_STATS && (command().type() == CL_COMMAND_NDRANGE_KERNEL)) {
+        const amd::Kernel& kernel = static_cast<amd::NDRangeKernelCommand&>(command()).kernel();
+        kernel.getDeviceKernel(gpu()->dev())->addGpuTime(end_ - start_);
+      }
+      if (amd::Timeline::enabled()) {
+        const char* name = (command().type() == CL_COMMAND_NDRANGE_KERNEL)
+            ? amd::Timeline::intern(
+                  static_cast<amd::NDRangeKernelCommand&>(command()).kernel().name())
+            : getOclCommandKindString(command().type());
+        amd::Timeline::gpu(name, gpu(), start_, end_, reinterpret_cast<uint64_t>(&command()));
+      }
     }
   }
 }
@@ -208,185 +374,148 @@ bool HsaAmdSignalHandler(hsa_signal_value_t value, void* arg) {
   return false;
 }
 
-// ================================================================================================
-bool VirtualGPU::MemoryDependency::create(size_t numMemObj) {
-  if (numMemObj > 0) {
-    // Allocate the array of memory objects for dependency tracking
-    memObjectsInQueue_ = new MemoryState[numMemObj];
-    if (nullptr == memObjectsInQueue_) {
-      return false;
-    }
-    memset(memObjectsInQueue_, 0, sizeof(MemoryState) * numMemObj);
-    maxMemObjectsInQueue_ = numMemObj;
-  }
-
-  return true;
-}
-
 // ================================================================================================
 void VirtualGPU::MemoryDependency::validate(VirtualGPU& gpu, const Memory* memory, bool readOnly) {
-  bool flushL1Cache = false;
-
-  if (maxMemObjectsInQueue_ == 0) {
-    // Sync AQL packets
-    gpu.setAqlHeader(gpu.dispatchPacketHeader_);
-    return;
-  }
-
   uint64_t curStart = reinterpret_cast<uint64_t>(memory->getDeviceMemory());
   uint64_t curEnd = curStart + memory->size();
-
-  // Loop through all memory objects in the queue and find dependency
-  // @note don't include objects from the current kernel
-  for (size_t j = 0; j < endMemObjectsInQueue_; ++j) {
-    // Check if the queue already contains this mem object and
-    // GPU operations aren't readonly
-    uint64_t busyStart = memObjectsInQueue_[j].start_;
-    uint64_t busyEnd = memObjectsInQueue_[j].end_;
-
-    // Check if the start inside the busy region
-    if ((((curStart >= busyStart) && (curStart < busyEnd)) ||
-         // Check if the end inside the busy region
-         ((curEnd > busyStart) && (curEnd <= busyEnd)) ||
-         // Check if the start/end cover the busy region
-         ((curStart <= busyStart) && (curEnd >= busyEnd))) &&
-        // If the buys region was written or the current one is for write
-        (!memObjectsInQueue_[j].readOnly_ || !readOnly)) {
-      flushL1Cache = true;
-      break;
+  // The kernel ranges limit the waits on SDMA
+  gpu.Barriers().AddRange(curStart, curEnd, readOnly);
+
+  // The first command on a new SVM allocation waits in GPU for the prefetch of the allocation
+  ProfilingSignal* prefetch = const_cast<Memory*>(memory)->takePrefetch();
+  if (prefetch != nullptr) {
+    if (hsa_signal_load_relaxed(prefetch->signal_) > 0) {
+      gpu.Barriers().AddExternalSignal(prefetch);
+      // Keep the signal until the queue is idle, since the barrier can wait for it any time later
+      gpu.queueDependencies_.push_back(prefetch);
+    } else {
+      prefetch->release();
     }
   }
 
-  // Did we reach the limit?
-  if (maxMemObjectsInQueue_ <= numMemObjectsInQueue_) {
-    flushL1Cache = true;
+  if (!enabled()) {
+    // Sync AQL packets
+    gpu.setAqlHeader(gpu.dispatchPacketHeader_);
+    return;
   }
 
-  if (flushL1Cache) {
+  if (device::MemoryDependency::validate(curStart, curEnd, readOnly)) {
     // Sync AQL packets
     gpu.setAqlHeader(gpu.dispatchPacketHeader_);
-
-    // Clear memory dependency state
-    const static bool All = true;
-    clear(!All);
+    gpu.metrics().add(VDI_METRIC_DEPENDENCY_BARRIERS);
+    ++gpu.dependencyBarriers_;
   }
-
-  // Insert current memory object into the queue always,
-  // since runtime calls flush before kernel execution and it has to keep
-  // current kernel in tracking
-  memObjectsInQueue_[numMemObjectsInQueue_].start_ = curStart;
-  memObjectsInQueue_[numMemObjectsInQueue_].end_ = curEnd;
-  memObjectsInQueue_[numMemObjectsInQueue_].readOnly_ = readOnly;
-  numMemObjectsInQueue_++;
 }
 
 // ================================================================================================
-void VirtualGPU::MemoryDependency::clear(bool all) {
-  if (numMemObjectsInQueue_ > 0) {
-    size_t i, j;
-    if (all) {
-      endMemObjectsInQueue_ = numMemObjectsInQueue_;
-    }
+VirtualGPU::HwQueueTracker::~HwQueueTracker() {
+  for (auto& pending : pending_) {
+    ClearPending(&pending);
+  }
+  for (auto& signal: signal_list_) {
+    RecycleSignal(signal);
+  }
+}
 
-    // If the current launch didn't start from the beginning, then move the data
-    if (0 != endMemObjectsInQueue_) {
-      // Preserve all objects from the current kernel
-      for (i = 0, j = endMemObjectsInQueue_; j < numMemObjectsInQueue_; i++, j++) {
-        memObjectsInQueue_[i].start_ = memObjectsInQueue_[j].start_;
-        memObjectsInQueue_[i].end_ = memObjectsInQueue_[j].end_;
-        memObjectsInQueue_[i].readOnly_ = memObjectsInQueue_[j].readOnly_;
-      }
-    } else if (numMemObjectsInQueue_ >= maxMemObjectsInQueue_) {
-      // note: The array growth shouldn't occur under the normal conditions,
-      // but in a case when SVM path sends the amount of SVM ptrs over
-      // the max size of kernel arguments
-      MemoryState* ptr  = new MemoryState[maxMemObjectsInQueue_ << 1];
-      if (nullptr == ptr) {
-        numMemObjectsInQueue_ = 0;
-        return;
-      }
-      maxMemObjectsInQueue_ <<= 1;
-      memcpy(ptr, memObjectsInQueue_, sizeof(MemoryState) * numMemObjectsInQueue_);
-      delete[] memObjectsInQueue_;
-      memObjectsInQueue_= ptr;
+// ================================================================================================
+bool VirtualGPU::HwQueueTracker::Create() {
+  signal_list_.reserve(kSignalListSize);
+  for (uint i = 0; i < kSignalListSize; ++i) {
+    ProfilingSignal* signal = CreateSignal();
+    if (signal == nullptr) {
+      return false;
     }
-
-    numMemObjectsInQueue_ -= endMemObjectsInQueue_;
-    endMemObjectsInQueue_ = 0;
+    signal_list_.push_back(signal);
   }
+  return true;
 }
 
 // ================================================================================================
-VirtualGPU::HwQueueTracker::~HwQueueTracker() {
-  for (auto& signal: signal_list_) {
-    signal->release();
+ProfilingSignal* VirtualGPU::HwQueueTracker::CreateSignal() {
+  std::unique_ptr<ProfilingSignal> signal(new ProfilingSignal());
+  if ((signal == nullptr) || !gpu_.dev().acquireSignal(&signal->signal_)) {
+    return nullptr;
   }
+  return signal.release();
 }
 
 // ================================================================================================
-bool VirtualGPU::HwQueueTracker::Create() {
-  constexpr size_t kSignalListSize = 32;
-  signal_list_.resize(kSignalListSize);
-
-  hsa_agent_t agent = gpu_.gpu_device();
-  const Settings& settings = gpu_.dev().settings();
-  hsa_agent_t* agents = (settings.system_scope_signal_) ? nullptr : &agent;
-  uint32_t num_agents = (settings.system_scope_signal_) ? 0 : 1;
+void VirtualGPU::HwQueueTracker::RecycleSignal(ProfilingSignal* signal) {
+  // Only an idle signal without the references of the markers or the other queues
+  // can be shared with the other queues
+  if ((signal->referenceCount() == 1) && (hsa_signal_load_relaxed(signal->signal_) <= 0)) {
+    gpu_.dev().recycleSignal(signal->signal_);
+    signal->signal_.handle = 0;
+  }
+  signal->release();
+}
 
-  for (uint i = 0; i < kSignalListSize; ++i) {
-    std::unique_ptr<ProfilingSignal> signal(new ProfilingSignal());
-    if ((signal == nullptr) ||
-        (HSA_STATUS_SUCCESS != hsa_signal_create(0, num_agents, agents, &signal->signal_))) {
-      return false;
+// ================================================================================================
+void VirtualGPU::HwQueueTracker::Trim() {
+  size_t i = 0;
+  while ((signal_list_.size() > kSignalListSize) && (i < signal_list_.size())) {
+    ProfilingSignal* signal = signal_list_[i];
+    // Keep the last submitted signal, since the next operations can wait for it
+    if ((i != current_id_) && (signal->referenceCount() == 1) &&
+        (hsa_signal_load_relaxed(signal->signal_) <= 0)) {
+      // Process the pending timestamp, before the signal leaves the queue
+      CpuWaitForSignal(signal);
+      RecycleSignal(signal);
+      signal_list_.erase(signal_list_.begin() + i);
+      if (i < current_id_) {
+        --current_id_;
+      }
+    } else {
+      ++i;
     }
-    signal_list_[i] = signal.release();
   }
-  return true;
 }
 
 // ================================================================================================
 hsa_signal_t VirtualGPU::HwQueueTracker::ActiveSignal(
     hsa_signal_value_t init_val, Timestamp* ts, uint32_t queue_size) {
-  // If queue size grows, then add more signals to avoid more frequent stalls
-  if (queue_size > signal_list_.size()) {
-    std::unique_ptr<ProfilingSignal> signal(new ProfilingSignal());
+  // A signal per AQL slot is the most the queue can use at once
+  const size_t queueSlots = gpu_.gpu_queue_->size;
+  const size_t limit = (queueSlots > kSignalListSize) ? queueSlots : kSignalListSize;
+  const size_t next = (current_id_ + 1) % signal_list_.size();
+  // The reuse of the oldest signals would wait on CPU, if GPU didn't complete them yet
+  const bool busy = IsBusy(next) || IsBusy((next + 1) % signal_list_.size());
+
+  bool grown = false;
+  if ((busy || (queue_size > signal_list_.size())) && (signal_list_.size() < limit)) {
+    ProfilingSignal* signal = CreateSignal();
     if (signal != nullptr) {
-      hsa_agent_t agent = gpu_.gpu_device();
-      const Settings& settings = gpu_.dev().settings();
-      hsa_agent_t* agents = (settings.system_scope_signal_) ? nullptr : &agent;
-      uint32_t num_agents = (settings.system_scope_signal_) ? 0 : 1;
-
-      if (HSA_STATUS_SUCCESS == hsa_signal_create(0, num_agents, agents, &signal->signal_)) {
-        signal_list_.push_back(signal.release());
-      }
+      // The new signal follows the last submitted one, so the oldest signal stays the next.
+      // A new signal doesn't have GPU waiters, hence it doesn't need the waits below
+      signal_list_.insert(signal_list_.begin() + current_id_ + 1, signal);
+      ++current_id_;
+      gpu_.metrics().add(VDI_METRIC_SIGNAL_POOL_GROWS);
+      grown = true;
     }
   }
-  // Find valid index
-  ++current_id_ %= signal_list_.size();
 
-  // Make sure the previous operation on the current signal is done
-  WaitCurrent();
+  if (!grown) {
+    if (busy) {
+      gpu_.metrics().add(VDI_METRIC_SIGNAL_WRAP_WAITS);
+    }
+    // Find valid index
+    ++current_id_ %= signal_list_.size();
+
+    // Make sure the previous operation on the current signal is done
+    CpuWaitForSignal(signal_list_[current_id_]);
 
-  // Have to wait the next signal in the queue to avoid a race condition between
-  // a GPU waiter(which may be not triggered yet) and CPU signal reset below
-  WaitNext();
+    // Have to wait the next signal in the queue to avoid a race condition between
+    // a GPU waiter(which may be not triggered yet) and CPU signal reset below
+    WaitNext();
+  }
 
   if (signal_list_[current_id_]->referenceCount() > 1) {
     // The signal was assigned to the global marker's event, hence runtime can't reuse it
     // and needs a new signal
-    std::unique_ptr<ProfilingSignal> signal(new ProfilingSignal());
+    ProfilingSignal* signal = CreateSignal();
     if (signal != nullptr) {
-      hsa_agent_t agent = gpu_.gpu_device();
-      const Settings& settings = gpu_.dev().settings();
-      hsa_agent_t* agents = (settings.system_scope_signal_) ? nullptr : &agent;
-      uint32_t num_agents = (settings.system_scope_signal_) ? 0 : 1;
-
-      if (HSA_STATUS_SUCCESS == hsa_signal_create(0, num_agents, agents, &signal->signal_)) {
-        signal_list_[current_id_]->release();
-        signal_list_[current_id_] = signal.release();
-      } else {
-        assert(!"ProfilingSignal reallocaiton failed! Marker has a conflict with signal reuse!");
-      }
+      signal_list_[current_id_]->release();
+      signal_list_[current_id_] = signal;
     } else {
       assert(!"ProfilingSignal reallocaiton failed! Marker has a conflict with signal reuse!");
     }
@@ -441,8 +570,17 @@ std::vector<hsa_signal_t>& VirtualGPU::HwQueueTracker::WaitingSignal(HwQueueEngi
   // Reset all current waiting signals
   waiting_signals_.clear();
 
-  // Does runtime switch the active engine?
-  if (engine != engine_) {
+  // The collected ranges belong to the current operation only
+  const bool ranges = op_collecting_ && !op_unknown_;
+  op_collecting_ = false;
+
+  const bool trackRanges = gpu_.dev().settings().engineRangeDeps_;
+  const bool rangeWait = trackRanges && external_signals_.empty() &&
+      (engine < HwQueueEngine::Unknown) && (engine_ < HwQueueEngine::Unknown);
+  if (rangeWait) {
+    explicit_wait = RangeWait(engine, ranges);
+  } else if (engine != engine_) {
+    // Does runtime switch the active engine?
     // Yes, return the signal from the previous operation for a wait
     engine_ = engine;
     explicit_wait = true;
@@ -459,6 +597,18 @@ std::vector<hsa_signal_t>& VirtualGPU::HwQueueTracker::WaitingSignal(HwQueueEngi
       }
     }
   }
+  if (trackRanges && !rangeWait && explicit_wait) {
+    // The last signal doesn't cover the operations, which skipped the cross engine waits
+    for (auto& pending : pending_) {
+      if (pending.signal_ != nullptr) {
+        AddWait(pending.signal_);
+      }
+      ClearPending(&pending);
+    }
+    if (engine < HwQueueEngine::Unknown) {
+      AddPending(engine, ranges);
+    }
+  }
   // Check if a wait is required
   if (explicit_wait) {
     bool skip_internal_signal = false;
@@ -477,20 +627,7 @@ std::vector<hsa_signal_t>& VirtualGPU::HwQueueTracker::WaitingSignal(HwQueueEngi
 
     // Validate all signals for the wait and skip already completed
     for (uint32_t i = 0; i < external_signals_.size(); ++i) {
-      // Early signal status check
-      if (hsa_signal_load_relaxed(external_signals_[i]->signal_) > 0) {
-        const Settings& settings = gpu_.dev().settings();
-        // Actively wait on CPU to avoid extra overheads of signal tracking on GPU
-        if (!WaitForSignal<true>(external_signals_[i]->signal_)) {
-          if (settings.cpu_wait_for_signal_) {
-            // Wait on CPU for completion if requested
-            CpuWaitForSignal(external_signals_[i]);
-          } else {
-            // Add HSA signal for tracking on GPU
-            waiting_signals_.push_back(external_signals_[i]->signal_);
-          }
-        }
-      }
+      AddWait(external_signals_[i]);
     }
     external_signals_.clear();
   }
@@ -498,6 +635,119 @@ std::vector<hsa_signal_t>& VirtualGPU::HwQueueTracker::WaitingSignal(HwQueueEngi
   return waiting_signals_;
 }
 
+// ================================================================================================
+void VirtualGPU::HwQueueTracker::AddWait(ProfilingSignal* signal) {
+  // Early signal status check
+  if (hsa_signal_load_relaxed(signal->signal_) > 0) {
+    const Settings& settings = gpu_.dev().settings();
+    // Actively wait on CPU to avoid extra overheads of signal tracking on GPU
+    if (!WaitForSignal<true>(signal->signal_, false, gpu_.activeWaitTimeout())) {
+      if (settings.cpu_wait_for_signal_) {
+        // Wait on CPU for completion if requested
+        CpuWaitForSignal(signal);
+      } else {
+        // Add HSA signal for tracking on GPU
+        waiting_signals_.push_back(signal->signal_);
+      }
+    }
+  }
+}
+
+// ================================================================================================
+bool VirtualGPU::HwQueueTracker::RangeWait(HwQueueEngine engine, bool ranges) {
+  bool explicit_wait = false;
+  if (engine != engine_) {
+    // The last operation on the queue completes the pending work of the previous engine
+    EngineRanges& previous = pending_[engine_];
+    ProfilingSignal* signal = signal_list_[current_id_];
+    signal->retain();
+    if (previous.signal_ != nullptr) {
+      previous.signal_->release();
+    }
+    previous.signal_ = signal;
+    engine_ = engine;
+  } else if (!gpu_.dev().settings().skip_copy_sync_ && (engine != HwQueueEngine::Compute)) {
+    // The same SDMA engine isn't predictable in ROCr, hence wait for the last operation
+    explicit_wait = true;
+  }
+
+  // Wait for the other engines only if the memory overlaps
+  for (uint32_t i = 0; i < HwQueueEngine::Unknown; ++i) {
+    EngineRanges& pending = pending_[i];
+    if ((i == engine) || (pending.signal_ == nullptr)) {
+      continue;
+    }
+    if (hsa_signal_load_relaxed(pending.signal_->signal_) <= 0) {
+      // The engine is idle and doesn't have the operations after the last signal
+      ClearPending(&pending);
+    } else if (!ranges || HasHazard(pending)) {
+      AddWait(pending.signal_);
+      ClearPending(&pending);
+    } else {
+      ClPrint(amd::LOG_DEBUG, amd::LOG_SIG, "Skip the wait on engine %u for engine %u",
+              i, engine);
+    }
+  }
+
+  AddPending(engine, ranges);
+  return explicit_wait;
+}
+
+// ================================================================================================
+bool VirtualGPU::HwQueueTracker::HasHazard(const EngineRanges& pending) const {
+  if (pending.unknown_) {
+    return true;
+  }
+  for (const auto& range : op_ranges_) {
+    // Read after write, write after read and write after write are the hazards
+    if (pending.write_.overlaps(range.start_, range.end_) ||
+        (!range.readOnly_ && pending.read_.overlaps(range.start_, range.end_))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ================================================================================================
+void VirtualGPU::HwQueueTracker::AddPending(HwQueueEngine engine, bool ranges) {
+  EngineRanges& pending = pending_[engine];
+  if (!ranges) {
+    pending.unknown_ = true;
+    return;
+  }
+  for (const auto& range : op_ranges_) {
+    if (range.readOnly_) {
+      pending.read_.insert(range.start_, range.end_);
+    } else {
+      pending.write_.insert(range.start_, range.end_);
+    }
+  }
+}
+
+// ================================================================================================
+void VirtualGPU::HwQueueTracker::ClearPending(EngineRanges* pending) {
+  if (pending->signal_ != nullptr) {
+    pending->signal_->release();
+    pending->signal_ = nullptr;
+  }
+  pending->read_.clear();
+  pending->write_.clear();
+  pending->unknown_ = false;
+}
+
+// ================================================================================================
+bool VirtualGPU::HwQueueTracker::WaitCurrent() {
+  // The last signal doesn't cover the operations, which skipped the cross engine waits
+  for (auto& pending : pending_) {
+    if (pending.signal_ != nullptr) {
+      CpuWaitForSignal(pending.signal_);
+    }
+    ClearPending(&pending);
+  }
+  ProfilingSignal* signal = signal_list_[current_id_];
+  return CpuWaitForSignal(signal);
+}
+
 // ================================================================================================
 bool VirtualGPU::HwQueueTracker::CpuWaitForSignal(ProfilingSignal* signal) {
   // Wait for the current signal
@@ -511,7 +761,9 @@ bool VirtualGPU::HwQueueTracker::CpuWaitForSignal(ProfilingSignal* signal) {
     amd::ScopedLock lock(signal->LockSignalOps());
     ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "[%zx]!\t Host wait on completion_signal=0x%zx",
             std::this_thread::get_id(), signal->signal_.handle);
-    if (!WaitForSignal(signal->signal_, gpu_.ActiveWait())) {
+    const bool result = (ROC_HANG_TIMEOUT != 0) ? gpu_.waitWithHangCheck(signal->signal_) :
+                                                  WaitForSignal(signal->signal_, gpu_.waitPolicy());
+    if (!result) {
       LogPrintfError("Failed signal [0x%lx] wait", signal->signal_);
       return false;
     }
@@ -520,6 +772,92 @@ bool VirtualGPU::HwQueueTracker::CpuWaitForSignal(ProfilingSignal* signal) {
   return true;
 }
 
+// ================================================================================================
+bool VirtualGPU::waitWithHangCheck(hsa_signal_t signal) {
+  // @note: The wait policy of the queue is replaced with the interrupt wait in the slices,
+  // so the host can check the progress of the AQL ring between the slices
+  const uint64_t budget = static_cast<uint64_t>(ROC_HANG_TIMEOUT) * 1000 * K;
+  uint64_t readIndex = hsa_queue_load_read_index_relaxed(gpu_queue_);
+  uint64_t lastProgress = amd::Os::timeNanos();
+  bool reported = false;
+  while (hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, kInitSignalValueOne,
+                                   kHangCheckInterval, HSA_WAIT_STATE_BLOCKED) > 0) {
+    const uint64_t now = amd::Os::timeNanos();
+    const uint64_t index = hsa_queue_load_read_index_relaxed(gpu_queue_);
+    if (index != readIndex) {
+      // The packet processor moves forward, so the queue is busy, but not hung
+      readIndex = index;
+      lastProgress = now;
+    } else if (!reported && ((now - lastProgress) > budget)) {
+      reported = true;
+      dumpHangState(signal);
+      if (ROC_HANG_ABORT) {
+        // Abort only the hung queue, the other queues in the process continue
+        LogPrintfError("Aborting the hung queue 0x%zx", gpu_queue_);
+        hsa_queue_inactivate(gpu_queue_);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+void VirtualGPU::recordDispatch(const std::string& kernelName, const void* args, size_t argSize) {
+  amd::ScopedLock lock(historyLock_);
+  if (dispatchHistory_.empty()) {
+    dispatchHistory_.resize(kHangHistorySize);
+  }
+  DispatchRecord& record = dispatchHistory_[historyNext_];
+  historyNext_ = (historyNext_ + 1) % dispatchHistory_.size();
+  record.kernelName_ = kernelName;
+  // The packet was reserved at the last write index
+  record.packetIndex_ = hsa_queue_load_write_index_relaxed(gpu_queue_) - 1;
+  record.time_ = amd::Os::timeNanos();
+  record.argSize_ = std::min(argSize, sizeof(record.args_));
+  if (args != nullptr) {
+    memcpy(record.args_, args, record.argSize_);
+  } else {
+    record.argSize_ = 0;
+  }
+}
+
+// ================================================================================================
+void VirtualGPU::dumpHangState(hsa_signal_t signal) {
+  const uint64_t now = amd::Os::timeNanos();
+  fprintf(amd::outFile, "GPU hang: queue 0x%zx didn't progress for %u ms, signal 0x%zx = %ld\n",
+          reinterpret_cast<size_t>(gpu_queue_), ROC_HANG_TIMEOUT,
+          static_cast<size_t>(signal.handle),
+          static_cast<long>(hsa_signal_load_relaxed(signal)));
+  fprintf(amd::outFile, "  AQL ring: size=%u, read index=%lu, write index=%lu\n",
+          gpu_queue_->size,
+          static_cast<unsigned long>(hsa_queue_load_read_index_relaxed(gpu_queue_)),
+          static_cast<unsigned long>(hsa_queue_load_write_index_relaxed(gpu_queue_)));
+  {
+    amd::ScopedLock lock(historyLock_);
+    // Print the records from the oldest one
+    for (size_t i = 0; i < dispatchHistory_.size(); ++i) {
+      const DispatchRecord& record =
+          dispatchHistory_[(historyNext_ + i) % dispatchHistory_.size()];
+      if (record.kernelName_.empty()) {
+        continue;
+      }
+      std::string args;
+      char byte[4];
+      for (size_t b = 0; b < record.argSize_; ++b) {
+        snprintf(byte, sizeof(byte), "%02x", record.args_[b]);
+        args += byte;
+      }
+      fprintf(amd::outFile, "  packet %lu, %lu us ago: %s, args: %s\n",
+              static_cast<unsigned long>(record.packetIndex_),
+              static_cast<unsigned long>((now - record.time_) / K), record.kernelName_.c_str(),
+              args.c_str());
+    }
+  }
+  fprintf(amd::outFile, "  Memory dependency: %s\n", memoryDependency().state().c_str());
+  fflush(amd::outFile);
+}
+
 // ================================================================================================
 void VirtualGPU::HwQueueTracker::ResetCurrentSignal() {
   // Reset the signal and return
@@ -528,22 +866,61 @@ void VirtualGPU::HwQueueTracker::ResetCurrentSignal() {
   current_id_ = (current_id_ == 0) ? (signal_list_.size() - 1) : (current_id_ - 1);
 }
 
+// ================================================================================================
+void VirtualGPU::beginResidency() {
+  if (dev().oversubscription() != nullptr) {
+    residencyEpoch_ = dev().oversubscription()->newEpoch();
+  }
+}
+
+// ================================================================================================
+bool VirtualGPU::makeResident(const device::Memory* memory) {
+  if ((dev().oversubscription() == nullptr) || (memory == nullptr)) {
+    return true;
+  }
+  return dev().oversubscription()->use(*this,
+      reinterpret_cast<const void*>(memory->virtualAddress()));
+}
+
 // ================================================================================================
 bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address params,
-  size_t& ldsAddress, bool cooperativeGroups, bool& imageBufferWrtBack,
+  address argBuffer, size_t& ldsAddress, bool cooperativeGroups, bool& imageBufferWrtBack,
   std::vector<device::Memory*>& wrtBackImageBuffer) {
   Kernel& hsaKernel = const_cast<Kernel&>(static_cast<const Kernel&>(*(kernel.getDeviceKernel(dev()))));
   const amd::KernelSignature& signature = kernel.signature();
   const amd::KernelParameters& kernelParams = kernel.parameters();
 
-  if (!cooperativeGroups && memoryDependency().maxMemObjectsInQueue() != 0) {
-    // AQL packets
-    setAqlHeader(dispatchPacketHeaderNoSync_);
+  if (!cooperativeGroups && memoryDependency().enabled()) {
+    // AQL packets. The GPU only serialization keeps the barrier bit on each dispatch
+    setAqlHeader(serializeCommand_ ? dispatchPacketHeader_ : dispatchPacketHeaderNoSync_);
   }
 
   amd::Memory* const* memories =
     reinterpret_cast<amd::Memory* const*>(params + kernelParams.memoryObjOffset());
 
+  if (dev().oversubscription() != nullptr) {
+    // Restore the evicted buffers first, since the restore can wait for the queue
+    beginResidency();
+    for (uint i = 0; i < signature.numMemories(); ++i) {
+      if ((memories[i] != nullptr) && !makeResident(dev().getGpuMemory(memories[i]))) {
+        return false;
+      }
+    }
+    void* const* svmPtrs =
+        reinterpret_cast<void* const*>(params + kernelParams.getExecInfoOffset());
+    for (size_t i = 0; i < kernelParams.getNumberOfSvmPtr(); ++i) {
+      amd::Memory* svmMem = amd::MemObjMap::FindMemObj(svmPtrs[i]);
+      if ((svmMem != nullptr) && !makeResident(dev().getGpuMemory(svmMem))) {
+        return false;
+      }
+    }
+  }
+
+  // On the direct serialization the arguments are patched straight in the kernarg memory
+  // and the captured parameters hold the objects only
+  address args = (argBuffer != nullptr) ? argBuffer : const_cast<address>(params);
+  const_address values = (argBuffer != nullptr) ? kernelParams.values() : params;
+
   // HIP shouldn't use cache coherency layer at any time
   if (!amd::IS_HIP) {
     // Process cache coherency first, since the extra transfers may affect
@@ -563,6 +940,8 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
 
   // Mark the tracker with a new kernel, so it can avoid checks of the aliased objects
   memoryDependency().newKernel();
+  Barriers().BeginRanges();
+  hostCoherentArgs_ = false;
 
   bool deviceSupportFGS = 0 != dev().isFineGrainedSystem(true);
   bool supportFineGrainedSystem = deviceSupportFGS;
@@ -594,7 +973,11 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
     if (nullptr == memory) {
       if (!supportFineGrainedSystem) {
         return false;
-      } else if (sync) {
+      }
+      // The system allocations are always host coherent
+      hostCoherentArgs_ = true;
+      Barriers().AddUnknownRange();
+      if (sync) {
         // Sync AQL packets
         setAqlHeader(dispatchPacketHeader_);
         // Clear memory dependency state
@@ -607,6 +990,8 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
       if (nullptr != rocMemory) {
         // Synchronize data with other memory instances if necessary
         rocMemory->syncCacheFromHost(*this);
+        hostCoherentArgs_ |= rocMemory->isHostMemDirectAccess() ||
+                             rocMemory->IsPersistentDirectMap();
 
         const static bool IsReadOnly = false;
         // Validate SVM passed in the non argument list
@@ -630,17 +1015,17 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
         ldsAddress = amd::alignUp(ldsAddress, desc.info_.arrayIndex_);
         if (desc.size_ == 8) {
           // Save the original LDS size
-          uint64_t ldsSize = *reinterpret_cast<const uint64_t*>(params + desc.offset_);
+          uint64_t ldsSize = *reinterpret_cast<const uint64_t*>(args + desc.offset_);
           // Patch the LDS address in the original arguments with an LDS address(offset)
-          WriteAqlArgAt(const_cast<address>(params), &ldsAddress, desc.size_, desc.offset_);
+          WriteAqlArgAt(args, &ldsAddress, desc.size_, desc.offset_);
           // Add the original size
           ldsAddress += ldsSize;
         } else {
           // Save the original LDS size
-          uint32_t ldsSize = *reinterpret_cast<const uint32_t*>(params + desc.offset_);
+          uint32_t ldsSize = *reinterpret_cast<const uint32_t*>(args + desc.offset_);
           // Patch the LDS address in the original arguments with an LDS address(offset)
           uint32_t ldsAddr = ldsAddress;
-          WriteAqlArgAt(const_cast<address>(params), &ldsAddr, desc.size_, desc.offset_);
+          WriteAqlArgAt(args, &ldsAddr, desc.size_, desc.offset_);
           // Add the original size
           ldsAddress += ldsSize;
         }
@@ -651,6 +1036,8 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
         if (mem == nullptr) {
           //! This condition is for SVM fine-grain
           if (dev().isFineGrainedSystem(true)) {
+            hostCoherentArgs_ = true;
+            Barriers().AddUnknownRange();
             // Sync AQL packets
             setAqlHeader(dispatchPacketHeader_);
             // Clear memory dependency state
@@ -660,8 +1047,18 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
         }
         else {
           gpuMem = static_cast<Memory*>(mem->getDeviceMemory(dev()));
+          // The host can access the memory without the runtime transfers
+          hostCoherentArgs_ |= gpuMem->isHostMemDirectAccess() || gpuMem->IsPersistentDirectMap();
+
+          if ((argBuffer != nullptr) && !desc.info_.rawPointer_) {
+            // Write GPU VA address to the arguments. A buffer view keeps the offset
+            // from the parent in the argument, otherwise it's 0
+            const uint64_t va = static_cast<uint64_t>(gpuMem->virtualAddress()) +
+                *reinterpret_cast<const uint64_t*>(values + desc.offset_);
+            WriteAqlArgAt(args, &va, sizeof(va), desc.offset_);
+          }
 
-          const void* globalAddress = *reinterpret_cast<const void* const*>(params + desc.offset_);
+          const void* globalAddress = *reinterpret_cast<const void* const*>(args + desc.offset_);
           ClPrint(amd::LOG_INFO, amd::LOG_KERN,
             "!\targ%d: %s %s = ptr:%p obj:[%p-%p] threadId : %zx",
             index, desc.typeName_.c_str(), desc.name_.c_str(),
@@ -691,7 +1088,7 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
 
             const uint64_t image_srd = image->getHsaImageObject().handle;
             assert(amd::isMultipleOf(image_srd, sizeof(image_srd)));
-            WriteAqlArgAt(const_cast<address>(params), &image_srd, sizeof(image_srd), desc.offset_);
+            WriteAqlArgAt(args, &image_srd, sizeof(image_srd), desc.offset_);
 
               // Check if synchronization has to be performed
             if (image->CopyImageBuffer() != nullptr) {
@@ -708,7 +1105,7 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
               setAqlHeader(dispatchPacketHeader_);
               // Use backing store SRD as the replacment
               const uint64_t srd = devCpImg->getHsaImageObject().handle;
-              WriteAqlArgAt(const_cast<address>(params), &srd, sizeof(srd), desc.offset_);
+              WriteAqlArgAt(args, &srd, sizeof(srd), desc.offset_);
 
               // If it's not a read only resource, then runtime has to write back
               if (!desc.info_.readOnly_) {
@@ -729,11 +1126,11 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
          return false;
       }
       uint64_t vqVA = getVQVirtualAddress();
-      WriteAqlArgAt(const_cast<address>(params), &vqVA, sizeof(vqVA), desc.offset_);
+      WriteAqlArgAt(args, &vqVA, sizeof(vqVA), desc.offset_);
     }
     else if (desc.type_ == T_VOID) {
       if (desc.info_.oclObject_ == amd::KernelParameterDescriptor::ReferenceObject) {
-        const_address srcArgPtr = params + desc.offset_;
+        const_address srcArgPtr = values + desc.offset_;
         void* mem = allocKernArg(desc.size_, 128);
         if (mem == nullptr) {
           LogError("Out of memory");
@@ -741,7 +1138,7 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
         }
         memcpy(mem, srcArgPtr, desc.size_);
         const auto it = hsaKernel.patch().find(desc.offset_);
-        WriteAqlArgAt(const_cast<address>(params), &mem, sizeof(void*), it->second);
+        WriteAqlArgAt(args, &mem, sizeof(void*), it->second);
       }
     }
     else if (desc.type_ == T_SAMPLER) {
@@ -752,10 +1149,14 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
       device::Sampler* devSampler = sampler->getDeviceSampler(dev());
 
       uint64_t sampler_srd = devSampler->hwSrd();
-      WriteAqlArgAt(const_cast<address>(params), &sampler_srd, sizeof(sampler_srd), desc.offset_);
+      WriteAqlArgAt(args, &sampler_srd, sizeof(sampler_srd), desc.offset_);
     }
   }
 
+  if (hsaKernel.program()->hasGlobalStores() || hsaKernel.dynamicParallelism()) {
+    // The global stores and the device enqueue access the memory outside of the arguments
+    Barriers().AddUnknownRange();
+  }
   if (hsaKernel.program()->hasGlobalStores()) {
     // Sync AQL packets
     setAqlHeader(dispatchPacketHeader_);
@@ -779,6 +1180,9 @@ bool VirtualGPU::dispatchGenericAqlPacket(
   const uint32_t queueSize = gpu_queue_->size;
   const uint32_t queueMask = queueSize - 1;
 
+  // The packet can read the memory, which CPU wrote
+  flushHdp();
+
   // Check for queue full and wait if needed.
   uint64_t index = hsa_queue_add_write_index_screlease(gpu_queue_, size);
   uint64_t read = hsa_queue_load_read_index_relaxed(gpu_queue_);
@@ -791,6 +1195,10 @@ bool VirtualGPU::dispatchGenericAqlPacket(
   }
 
   // Make sure the slot is free for usage
+  if ((index - read) >= queueMask) {
+    // The packet processor can't free the slots for the packets, which weren't sent yet
+    ringDoorbell();
+  }
   while ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask) {
     amd::Os::yield();
   }
@@ -803,6 +1211,13 @@ bool VirtualGPU::dispatchGenericAqlPacket(
     blocking = true;
   }
 
+  // The doorbell ring can be deferred only for the packets without a completion signal,
+  // since nobody can wait for them. The signaled packet will send all previous packets
+  const Settings& settings = dev().settings();
+  const bool deferDoorbell = !blocking && !holdDoorbell_ &&
+                             (packet->completion_signal.handle == 0) &&
+                             (settings.aqlBatchSize_ > 1);
+
   // Insert packet(s)
   // NOTE: need multiple packets to dispatch the performance counter
   //       packet blob of the legacy devices (gfx8)
@@ -812,6 +1227,12 @@ bool VirtualGPU::dispatchGenericAqlPacket(
     if (header != 0) {
       packet_store_release(reinterpret_cast<uint32_t*>(aql_loc), header, rest);
     }
+    tailFenced_ = (packet->completion_signal.handle != 0) &&
+        (extractAqlBits(header, HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE,
+                        HSA_PACKET_HEADER_WIDTH_RELEASE_FENCE_SCOPE) == HSA_FENCE_SCOPE_SYSTEM);
+    tailSignal_ = (tailFenced_ && (extractAqlBits(header, HSA_PACKET_HEADER_BARRIER,
+                                                  HSA_PACKET_HEADER_WIDTH_BARRIER) == 1)) ?
+        packet->completion_signal : hsa_signal_t{};
     ClPrint(amd::LOG_DEBUG, amd::LOG_AQL,
             "[%zx] HWq=0x%zx, Dispatch Header = "
             "0x%x (type=%d, barrier=%d, acquire=%d, release=%d), "
@@ -839,7 +1260,21 @@ bool VirtualGPU::dispatchGenericAqlPacket(
   }
 
   //hsa_queue_store_write_index_release(gpu_queue_, index);
-  hsa_signal_store_screlease(gpu_queue_->doorbell_signal, index - 1);
+  if (deferDoorbell) {
+    const uint64_t time = amd::Os::timeNanos();
+    if (deferredPackets_ == 0) {
+      deferredStart_ = time;
+    }
+    deferredPackets_ += size;
+    deferredDoorbell_ = index - 1;
+    // Send the batch if it reached the size limit or the first packet waits too long
+    if ((deferredPackets_ >= settings.aqlBatchSize_) ||
+        ((time - deferredStart_) >= settings.aqlBatchTimeout_)) {
+      ringDoorbell();
+    }
+  } else {
+    storeDoorbell(index - 1, size);
+  }
 
   // Wait on signal ?
   if (blocking) {
@@ -870,6 +1305,11 @@ void VirtualGPU::dispatchBlockingWait() {
 // ================================================================================================
 bool VirtualGPU::dispatchAqlPacket(
   hsa_kernel_dispatch_packet_t* packet, uint16_t header, uint16_t rest, bool blocking) {
+  if (capture_ != nullptr) {
+    // The launch is recorded into the graph and will be sent to HW on the replay
+    return capture_->addPacket(*packet, header, rest);
+  }
+  metrics().add(VDI_METRIC_DISPATCHES);
   dispatchBlockingWait();
 
   return dispatchGenericAqlPacket(packet, header, rest, blocking);
@@ -911,7 +1351,8 @@ bool VirtualGPU::dispatchCounterAqlPacket(hsa_ext_amd_aql_pm4_packet_t* packet,
 }
 
 // ================================================================================================
-void VirtualGPU::dispatchBarrierPacket(uint16_t packetHeader, bool skipSignal) {
+void VirtualGPU::dispatchBarrierPacket(uint16_t packetHeader, bool skipSignal,
+                                       hsa_signal_t completion) {
   const uint32_t queueSize = gpu_queue_->size;
   const uint32_t queueMask = queueSize - 1;
 
@@ -931,7 +1372,7 @@ void VirtualGPU::dispatchBarrierPacket(uint16_t packetHeader, bool skipSignal) {
 
   uint64_t index = hsa_queue_add_write_index_screlease(gpu_queue_, 1);
   uint64_t read = hsa_queue_load_read_index_relaxed(gpu_queue_);
-  barrier_packet_.completion_signal.handle = 0;
+  barrier_packet_.completion_signal = completion;
 
   if (!skipSignal) {
     // Pool size must grow to the size of pending AQL packets
@@ -942,13 +1383,22 @@ void VirtualGPU::dispatchBarrierPacket(uint16_t packetHeader, bool skipSignal) {
       Barriers().ActiveSignal(kInitSignalValueOne, timestamp_, pool_size);
   }
 
+  if ((index - read) >= queueMask) {
+    ringDoorbell();
+  }
   while ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask);
   hsa_barrier_and_packet_t* aql_loc =
     &(reinterpret_cast<hsa_barrier_and_packet_t*>(gpu_queue_->base_address))[index & queueMask];
   *aql_loc = barrier_packet_;
   __atomic_store_n(reinterpret_cast<uint32_t*>(aql_loc), packetHeader, __ATOMIC_RELEASE);
-
-  hsa_signal_store_screlease(gpu_queue_->doorbell_signal, index);
+  tailFenced_ = !skipSignal &&
+      (extractAqlBits(packetHeader, HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE,
+                      HSA_PACKET_HEADER_WIDTH_RELEASE_FENCE_SCOPE) == HSA_FENCE_SCOPE_SYSTEM);
+  tailSignal_ = (tailFenced_ && (extractAqlBits(packetHeader, HSA_PACKET_HEADER_BARRIER,
+                                                HSA_PACKET_HEADER_WIDTH_BARRIER) == 1)) ?
+      barrier_packet_.completion_signal : hsa_signal_t{};
+
+  storeDoorbell(index, 1);
   ClPrint(amd::LOG_DEBUG, amd::LOG_AQL,
           "[%zx] HWq=0x%zx, BarrierAND Header = 0x%x (type=%d, barrier=%d, acquire=%d,"
           " release=%d), "
@@ -981,16 +1431,62 @@ void VirtualGPU::ResetQueueStates() {
   // Release all memory dependencies
   memoryDependency().clear();
 
+  // The barriers on the signals of the other queues are done
+  for (auto signal : queueDependencies_) {
+    signal->release();
+  }
+  queueDependencies_.clear();
+
   // Release the pool, since runtime just completed a barrier
   // @note: Runtime can reset kernel arg pool only if the barrier with L2 invalidation was issued
   resetKernArgPool();
+
+  // The idle queue returns the signals over the initial pool into the device pool
+  Barriers().Trim();
+}
+
+// ================================================================================================
+bool VirtualGPU::addHdpFlush() {
+  if (dev().info().hdpMemFlushCntl == nullptr) {
+    return false;
+  }
+  hdpFlushPending_ = true;
+  return true;
+}
+
+// ================================================================================================
+void VirtualGPU::submitHdpFlush() {
+  // Drain the write combining buffers before the HDP flush
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  volatile uint32_t* hdpFlush = dev().info().hdpMemFlushCntl;
+  *hdpFlush = 1u;
+  // The read back makes sure the flush is done, before GPU can access the memory
+  (void)*hdpFlush;
+  hdpFlushPending_ = false;
+  ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "[%zx] HWq=0x%zx, HDP flush for the CPU writes",
+          std::this_thread::get_id(), gpu_queue_);
 }
 
 // ================================================================================================
 bool VirtualGPU::releaseGpuMemoryFence(bool skip_cpu_wait) {
+  // Send the deferred packets, even if the barrier below isn't required
+  ringDoorbell();
+
   if (hasPendingDispatch_) {
-    // Dispatch barrier packet into the queue
-    dispatchBarrierPacket(kBarrierPacketHeader);
+    // The last packet already flushes the caches and signals the completion, so the CPU can
+    // wait for it directly, unless the other queues must be joined
+    if (tailFenced_ && !Barriers().HasExternalSignals()) {
+      ClPrint(amd::LOG_DEBUG, amd::LOG_AQL, "[%zx] HWq=0x%zx, Barrier elided on the fenced tail",
+              std::this_thread::get_id(), gpu_queue_);
+    } else {
+      if (skip_cpu_wait) {
+        // The barrier only releases the memory for the next operation, hence it doesn't
+        // need the waits on the other engines
+        Barriers().BeginRanges();
+      }
+      // Dispatch barrier packet into the queue
+      dispatchBarrierPacket(kBarrierPacketHeader);
+    }
     hasPendingDispatch_ = false;
   }
 
@@ -1021,9 +1517,15 @@ VirtualGPU::VirtualGPU(Device& device, bool profiling, bool cooperative,
       barriers_(*this),
       cuMask_(cuMask),
       priority_(priority),
-      copy_command_type_(0)
+      waitPolicy_(static_cast<WaitPolicy::Mode>(
+                      (priority == amd::CommandQueue::Priority::High) ? ROC_WAIT_POLICY_HIGH :
+                      (priority == amd::CommandQueue::Priority::Low) ? ROC_WAIT_POLICY_LOW :
+                      ROC_WAIT_POLICY_NORMAL), device),
+      copy_command_type_(0),
+      tuningGeneration_(std::numeric_limits<uint64_t>::max())
 {
   index_ = device.numOfVgpus_++;
+  updateTuning();
   gpu_device_ = device.getBackendDevice();
   printfdbg_ = nullptr;
 
@@ -1033,10 +1535,26 @@ VirtualGPU::VirtualGPU(Device& device, bool profiling, bool cooperative,
   profiling_ = profiling;
   cooperative_ = cooperative;
 
-  kernarg_pool_base_ = nullptr;
   kernarg_pool_size_ = 0;
+  kernarg_pool_chunk_id_ = 0;
   kernarg_pool_cur_offset_ = 0;
 
+  deferredDoorbell_ = 0;
+  deferredPackets_ = 0;
+  deferredStart_ = 0;
+  capture_ = nullptr;
+  counterSampler_ = nullptr;
+  threadTrace_ = nullptr;
+  tailSignal_ = hsa_signal_t{};
+  completionDoorbell_ = hsa_signal_t{};
+  completionTarget_ = std::numeric_limits<hsa_signal_value_t>::max() / 2;
+  completionIndex_ = 0;
+  residencyEpoch_ = 0;
+  gwsInitValue_ = std::numeric_limits<uint32_t>::max();
+  scratchReserved_ = 0;
+  dependencyBarriers_ = 0;
+  historyNext_ = 0;
+
   if (device.settings().fenceScopeAgent_) {
     dispatchPacketHeaderNoSync_ =
       (HSA_PACKET_TYPE_KERNEL_DISPATCH << HSA_PACKET_HEADER_TYPE) |
@@ -1069,6 +1587,13 @@ VirtualGPU::VirtualGPU(Device& device, bool profiling, bool cooperative,
 
 // ================================================================================================
 VirtualGPU::~VirtualGPU() {
+  // Wait for the pending samples, before the queue is released
+  delete counterSampler_;
+  for (const auto& it : counterProfiles_) {
+    it.second->release();
+  }
+  counterProfiles_.clear();
+
   delete blitMgr_;
 
   if (tracking_created_) {
@@ -1076,10 +1601,31 @@ VirtualGPU::~VirtualGPU() {
     releaseGpuMemoryFence();
   }
 
+  if (dev().oversubscription() != nullptr) {
+    dev().oversubscription()->removeQueue(this);
+  }
+
   destroyPool();
+  // ROCr keeps the scratch of the queue, hence the reservation is released with the queue
+  roc_device_.memoryUsage().remove(VDI_MEMORY_SCRATCH, scratchReserved_);
 
   releasePinnedMem();
 
+  // The pinned memory, created with this queue, can't be shared anymore
+  if (dev().pinnedMemCache() != nullptr) {
+    dev().pinnedMemCache()->invalidate(this);
+  }
+
+  // Return the cached staging buffers back to the device pools.
+  // @note a non-empty cache means the corresponding pool exists
+  for (auto write : {false, true}) {
+    Device::XferBuffers::LocalCache& cache = xferCache(write);
+    if (std::any_of(std::begin(cache.buffers_), std::end(cache.buffers_),
+                    [](Memory* buf) { return buf != nullptr; })) {
+      (write ? dev().xferWrite() : dev().xferRead()).flushCache(cache);
+    }
+  }
+
   if (timestamp_ != nullptr) {
     timestamp_->release();
     timestamp_ = nullptr;
@@ -1094,6 +1640,13 @@ VirtualGPU::~VirtualGPU() {
     hsa_signal_destroy(schedulerSignal_);
   }
 
+  if (0 != completionDoorbell_.handle) {
+    // The last sync barrier can still be in flight
+    hsa_signal_wait_scacquire(completionDoorbell_, HSA_SIGNAL_CONDITION_LT, completionTarget_ + 1,
+                              kUnlimitedWait, HSA_WAIT_STATE_BLOCKED);
+    hsa_signal_destroy(completionDoorbell_);
+  }
+
   if (nullptr != schedulerQueue_) {
     hsa_queue_destroy(schedulerQueue_);
   }
@@ -1118,15 +1671,22 @@ VirtualGPU::~VirtualGPU() {
   if (gpu_queue_) {
     roc_device_.releaseQueue(gpu_queue_, cuMask_);
   }
+
+  if (!cuPartition_.empty()) {
+    roc_device_.ReleaseCuPartition(cuPartition_);
+  }
 }
 
 bool VirtualGPU::create() {
   // Pick a reasonable queue size
-  uint32_t queue_size = 1024;
+  uint32_t queue_size = Device::kDefaultQueueSize;
   gpu_queue_ = roc_device_.acquireQueue(queue_size, cooperative_, cuMask_, priority_);
   if (!gpu_queue_) return false;
 
-  if (!initPool(dev().settings().kernargPoolSize_)) {
+  // The pools are allocated once, hence the overrides apply to the new queues only
+  const size_t kernargPoolSize = device::Tuning::value(device::Tuning::KernargPoolSize,
+      dev().index(), index(), dev().settings().kernargPoolSize_);
+  if (!initPool(kernargPoolSize)) {
     LogError("Couldn't allocate arguments/signals for the queue");
     return false;
   }
@@ -1142,6 +1702,14 @@ bool VirtualGPU::create() {
   memset(&barrier_packet_, 0, sizeof(barrier_packet_));
   barrier_packet_.header = kInvalidAql;
 
+  // The stream sync falls back to the marker without the doorbell
+  if (ROC_COMPLETION_DOORBELL &&
+      (HSA_STATUS_SUCCESS != hsa_signal_create(completionTarget_, 0, nullptr,
+                                               &completionDoorbell_))) {
+    LogWarning("Completion doorbell creation failed");
+    completionDoorbell_ = hsa_signal_t{};
+  }
+
   // Create a object of PrintfDbg
   printfdbg_ = new PrintfDbg(roc_device_);
   if (nullptr == printfdbg_) {
@@ -1154,9 +1722,15 @@ bool VirtualGPU::create() {
     uint64_t frequency;
     hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &frequency);
     Timestamp::setGpuTicksToTime(1e9 / double(frequency));
+    if (ROC_TIMESTAMP_CALIBRATION != 0) {
+      // The first point aligns the system ticks with the host clock
+      Timestamp::calibrate();
+    }
   }
 
-  if (!memoryDependency().create(GPU_NUM_MEM_DEPENDENCY)) {
+  const size_t numMemDependency = device::Tuning::value(device::Tuning::NumMemDependency,
+      dev().index(), index(), GPU_NUM_MEM_DEPENDENCY);
+  if (!memoryDependency().create(numMemDependency)) {
     LogError("Could not create the array of memory objects!");
     return false;
   }
@@ -1167,59 +1741,222 @@ bool VirtualGPU::create() {
     LogError("Could not create signal for copy queue!");
     return false;
   }
+
+  if (ROC_PMC_SAMPLE_COUNTERS[0] != '\0') {
+    counterSampler_ = new PerfCounterSampler(*this, ROC_PMC_SAMPLE_PERIOD);
+    if ((counterSampler_ == nullptr) ||
+        !counterSampler_->create(ROC_PMC_SAMPLE_COUNTERS, ROC_PMC_SAMPLE_SLOTS)) {
+      // The sampling is a diagnostic, so the queue works without it
+      LogWarning("Perf counter sampling is disabled on the queue");
+      delete counterSampler_;
+      counterSampler_ = nullptr;
+    }
+  }
   return true;
 }
 
 // ================================================================================================
 bool VirtualGPU::initPool(size_t kernarg_pool_size) {
-  kernarg_pool_size_ = kernarg_pool_size;
-  kernarg_pool_base_ = reinterpret_cast<char*>(roc_device_.hostAlloc(kernarg_pool_size_, 0,
-                                               Device::MemorySegment::kKernArg));
-  if (kernarg_pool_base_ == nullptr) {
-    return false;
+  return addKernArgSegment(kernarg_pool_size, 0);
+}
+
+// ================================================================================================
+void VirtualGPU::destroyPool() {
+  for (auto& chunk : kernarg_pool_chunks_) {
+    if (chunk.signal_ != nullptr) {
+      chunk.signal_->release();
+    }
+  }
+  kernarg_pool_chunks_.clear();
+  for (const auto& segment : kernarg_pool_segments_) {
+    roc_device_.hostFree(segment.first, segment.second);
+    roc_device_.memoryUsage().remove(VDI_MEMORY_KERNARG, segment.second);
+  }
+  kernarg_pool_segments_.clear();
+  kernarg_pool_size_ = 0;
+}
+
+// ================================================================================================
+bool VirtualGPU::addKernArgSegment(size_t size, size_t position) {
+  char* base = reinterpret_cast<char*>(roc_device_.hostAlloc(size, 0,
+                                       Device::MemorySegment::kKernArg));
+  if (base == nullptr) {
+    return false;
   }
+  kernarg_pool_segments_.push_back(std::make_pair(base, size));
+  kernarg_pool_size_ += size;
+  roc_device_.memoryUsage().add(VDI_MEMORY_KERNARG, size);
+
+  // Split the segment into chunks, so runtime could wait for the oldest chunk only
+  const size_t numChunks = std::max(dev().settings().kernargPoolChunks_, 1u);
+  const size_t chunkSize = amd::alignDown(size / numChunks, sizeof(uint64_t));
+  std::vector<KernArgChunk> chunks;
+  for (size_t i = 0; i < numChunks; ++i) {
+    // The last chunk takes the reminder of the segment
+    size_t curSize = (i == (numChunks - 1)) ? (size - chunkSize * i) : chunkSize;
+    chunks.push_back({base + chunkSize * i, curSize, nullptr});
+  }
+  // Insert the new chunks into the ring at the requested position, so they are used next
+  kernarg_pool_chunks_.insert(kernarg_pool_chunks_.begin() + position,
+                              chunks.begin(), chunks.end());
   return true;
 }
 
 // ================================================================================================
-void VirtualGPU::destroyPool() {
-  if (kernarg_pool_base_ != nullptr) {
-    roc_device_.hostFree(kernarg_pool_base_, kernarg_pool_size_);
+void VirtualGPU::resetKernArgPool() {
+  // @note: The queue is idle, hence all chunks are free
+  for (auto& chunk : kernarg_pool_chunks_) {
+    if (chunk.signal_ != nullptr) {
+      chunk.signal_->release();
+      chunk.signal_ = nullptr;
+    }
+  }
+  kernarg_pool_chunk_id_ = 0;
+  kernarg_pool_cur_offset_ = 0;
+}
+
+// ================================================================================================
+ProfilingSignal* VirtualGPU::retainMarkerSignal() {
+  // The barrier doesn't need any cache operations, since it tracks the execution only
+  dispatchBarrierPacket(kBarrierPacketNoFenceHeader);
+  ProfilingSignal* signal = Barriers().GetLastSignal();
+  // HwQueueTracker will allocate a new signal in the list on the reuse,
+  // since the reference count is bigger than 1
+  signal->retain();
+  return signal;
+}
+
+// ================================================================================================
+bool VirtualGPU::nextKernArgChunk(size_t size) {
+  // Mark the last usage of the current chunk
+  ProfilingSignal* signal = retainMarkerSignal();
+  KernArgChunk& retired = kernarg_pool_chunks_[kernarg_pool_chunk_id_];
+  assert((retired.signal_ == nullptr) && "Active chunk must not have a pending signal!");
+  retired.signal_ = signal;
+
+  size_t next = (kernarg_pool_chunk_id_ + 1) % kernarg_pool_chunks_.size();
+  KernArgChunk* chunk = &kernarg_pool_chunks_[next];
+  if ((chunk->signal_ != nullptr) && (hsa_signal_load_relaxed(chunk->signal_->signal_) > 0)) {
+    // The oldest chunk is still in use. Grow the pool if it's allowed, instead of a stall
+    const Settings& settings = dev().settings();
+    if ((kernarg_pool_size_ + settings.kernargPoolSize_) <= settings.kernargPoolMaxSize_) {
+      if (addKernArgSegment(settings.kernargPoolSize_, next)) {
+        kernarg_pool_stats_.growths_++;
+        ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Kernarg pool grows to %zu bytes",
+                kernarg_pool_size_);
+        chunk = &kernarg_pool_chunks_[next];
+      }
+    }
+  }
+
+  if (next == 0) {
+    kernarg_pool_stats_.wraps_++;
+  }
+
+  if (chunk->signal_ != nullptr) {
+    if (hsa_signal_load_relaxed(chunk->signal_->signal_) > 0) {
+      kernarg_pool_stats_.stalls_++;
+      ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Kernarg pool stall on chunk %zu", next);
+    }
+    // Make sure GPU is done with the oldest chunk
+    if (!WaitForSignal(chunk->signal_->signal_, waitPolicy_)) {
+      LogError("Kernel arguments chunk wait failed");
+      return false;
+    }
+    chunk->signal_->release();
+    chunk->signal_ = nullptr;
   }
+
+  kernarg_pool_chunk_id_ = next;
+  kernarg_pool_cur_offset_ = 0;
+
+  if (size > chunk->size_) {
+    LogError("Kernel arguments size exceeds the pool chunk size!");
+    return false;
+  }
+  return true;
 }
 
 // ================================================================================================
 void* VirtualGPU::allocKernArg(size_t size, size_t alignment) {
+  if (capture_ != nullptr) {
+    // The recorded arguments must persist across the replays
+    return capture_->allocKernArg(size, alignment);
+  }
+  metrics().add(VDI_METRIC_KERNARG_BYTES, size);
   char* result = nullptr;
   do {
-    result = amd::alignUp(kernarg_pool_base_ + kernarg_pool_cur_offset_, alignment);
-    const size_t pool_new_usage = (result + size) - kernarg_pool_base_;
-    if (pool_new_usage <= kernarg_pool_size_) {
-      kernarg_pool_cur_offset_ = pool_new_usage;
+    const KernArgChunk& chunk = kernarg_pool_chunks_[kernarg_pool_chunk_id_];
+    result = amd::alignUp(chunk.base_ + kernarg_pool_cur_offset_, alignment);
+    const size_t chunk_new_usage = (result + size) - chunk.base_;
+    if (chunk_new_usage <= chunk.size_) {
+      kernarg_pool_cur_offset_ = chunk_new_usage;
       return result;
     } else {
-      //! We run out of the arguments space!
-      //! That means the app didn't call clFlush/clFinish for very long time.
-      //! We can issue a barrier to avoid expensive extra memory allocations.
-
-      // Dispatch barrier packet into the queue and wait till it finishes.
-      dispatchBarrierPacket(kBarrierPacketHeader);
-      if (!Barriers().WaitCurrent()) {
-        LogError("Kernel arguments reset failed");
+      //! We run out of the arguments space in the current chunk!
+      //! Retire the chunk and wait for the oldest one only, instead of the entire queue.
+      if (!nextKernArgChunk(size + alignment)) {
+        return nullptr;
       }
-      resetKernArgPool();
     }
   } while (true);
 
   return result;
 }
 
+// ================================================================================================
+//! Releases the GPU wait on the host signal, when the event it tracks is complete
+static void CL_CALLBACK HostEventComplete(cl_event event, int32_t status, void* data) {
+  ProfilingSignal* signal = reinterpret_cast<ProfilingSignal*>(data);
+  hsa_signal_store_screlease(signal->signal_, 0);
+  signal->release();
+}
+
+// ================================================================================================
+//! Drops the reference of the waiting command, since the barrier passed the host signal
+static void CL_CALLBACK HostEventRelease(cl_event event, int32_t status, void* data) {
+  reinterpret_cast<ProfilingSignal*>(data)->release();
+}
+
+// ================================================================================================
+bool VirtualGPU::addHostEventSignal(amd::Command& command, amd::Event& event) {
+  // The signal is released from the host on the event completion, so GPU can wait for
+  // the events without HSA signals (user events, the other queues) in a barrier packet
+  ProfilingSignal* signal = new ProfilingSignal();
+  if (HSA_STATUS_SUCCESS != hsa_signal_create(kInitSignalValueOne, 0, nullptr, &signal->signal_)) {
+    signal->signal_.handle = 0;
+    signal->release();
+    return false;
+  }
+  // The waiting command keeps the signal, until its barrier is done
+  signal->retain();
+  if (!command.setCallback(CL_COMPLETE, HostEventRelease, signal)) {
+    signal->release();
+    hsa_signal_store_relaxed(signal->signal_, 0);
+    signal->release();
+    return false;
+  }
+  Barriers().AddExternalSignal(signal);
+  if (!event.setCallback(CL_COMPLETE, HostEventComplete, signal)) {
+    // Can't happen, since the command callback was allocated already
+    hsa_signal_store_screlease(signal->signal_, 0);
+    signal->release();
+    return false;
+  }
+  ClPrint(amd::LOG_DEBUG, amd::LOG_SIG, "Host signal(0x%lx) for event(%p) wait in GPU",
+          signal->signal_.handle, &event);
+  return true;
+}
+
 // ================================================================================================
 /* profilingBegin, when profiling is enabled, creates a timestamp to save in
 * virtualgpu's timestamp_, and calls start() to get the current host
 * timestamp.
 */
 void VirtualGPU::profilingBegin(amd::Command& command, bool drmProfiling) {
+  // GPU only serialization keeps the barrier bit on the dispatches, but skips the CPU waits
+  serializeCommand_ = (command.getWaitBits() & 0x4) != 0;
+
   if (command.profilingInfo().enabled_) {
     if (timestamp_ != nullptr) {
       LogWarning("Trying to create a second timestamp in VirtualGPU. \
@@ -1238,8 +1975,12 @@ void VirtualGPU::profilingBegin(amd::Command& command, bool drmProfiling) {
       if (hw_event != nullptr) {
         Barriers().AddExternalSignal(reinterpret_cast<ProfilingSignal*>(hw_event));
       } else if (static_cast<amd::Command*>(*it)->queue() != command.queue() &&
-                 ((*it)->status() != CL_COMPLETE)) {
-        LogPrintfError("Waiting event(%p) doesn't have a HSA signal!\n", *it);
+                 ((*it)->status() > CL_COMPLETE)) {
+        // Only CPU can track the event, so GPU waits for a host signal
+        if (!addHostEventSignal(command, **it)) {
+          LogPrintfError("Waiting event(%p) doesn't have a HSA signal!\n", *it);
+          (*it)->awaitCompletion();
+        }
       } else {
         // Assume serialization on the same queue...
       }
@@ -1265,8 +2006,6 @@ void VirtualGPU::profilingEnd(amd::Command& command) {
 
 // ================================================================================================
 void VirtualGPU::updateCommandsState(amd::Command* list) const {
-  Timestamp* ts = nullptr;
-
   amd::Command* current = list;
   amd::Command* next = nullptr;
 
@@ -1285,12 +2024,12 @@ void VirtualGPU::updateCommandsState(amd::Command* list) const {
     // This block gets the first valid timestamp from the first command
     // that has one. This timestamp is used below to mark any command that
     // came before it to start and end with this first valid start time.
-    current = list;
     while (current != nullptr) {
       if (current->data() != nullptr) {
-        ts = reinterpret_cast<Timestamp*>(current->data());
-        startTimeStamp = ts->getStart();
-        endTimeStamp = ts->getStart();
+        // The signals are resolved here once and the timestamp keeps the values,
+        // hence the main loop below doesn't query the signals again
+        reinterpret_cast<Timestamp*>(current->data())->getTime(&startTimeStamp, &endTimeStamp);
+        endTimeStamp = startTimeStamp;
         break;
       }
       current = current->getNext();
@@ -1314,9 +2053,8 @@ void VirtualGPU::updateCommandsState(amd::Command* list) const {
       if (current->data() != nullptr) {
         // Since this is a valid command to get a timestamp, we use the
         // timestamp provided by the runtime (saved in the data())
-        ts = reinterpret_cast<Timestamp*>(current->data());
-        startTimeStamp = ts->getStart();
-        endTimeStamp = ts->getEnd();
+        Timestamp* ts = reinterpret_cast<Timestamp*>(current->data());
+        ts->getTime(&startTimeStamp, &endTimeStamp);
         ts->release();
         current->setData(nullptr);
       } else {
@@ -1353,6 +2091,12 @@ void VirtualGPU::submitReadMemory(amd::ReadMemoryCommand& cmd) {
   device::Memory* hostMemory = dev().findMemoryFromVA(cmd.destination(), &offset);
 
   Memory* devMem = dev().getRocMemory(&cmd.source());
+  beginResidency();
+  if (!makeResident(devMem) || !makeResident(hostMemory)) {
+    cmd.setStatus(CL_OUT_OF_RESOURCES);
+    profilingEnd(cmd);
+    return;
+  }
   // Synchronize data with other memory instances if necessary
   devMem->syncCacheFromHost(*this);
 
@@ -1456,6 +2200,12 @@ void VirtualGPU::submitWriteMemory(amd::WriteMemoryCommand& cmd) {
   device::Memory* hostMemory = dev().findMemoryFromVA(cmd.source(), &offset);
 
   Memory* devMem = dev().getRocMemory(&cmd.destination());
+  beginResidency();
+  if (!makeResident(devMem) || !makeResident(hostMemory)) {
+    cmd.setStatus(CL_OUT_OF_RESOURCES);
+    profilingEnd(cmd);
+    return;
+  }
 
   // Synchronize memory from host if necessary
   device::Memory::SyncFlags syncFlags;
@@ -1470,6 +2220,9 @@ void VirtualGPU::submitWriteMemory(amd::WriteMemoryCommand& cmd) {
   cl_command_type type = cmd.type();
   bool result = false;
   bool imageBuffer = false;
+  // The written byte range for the coherency tracking, zero if it's unknown
+  size_t writeOffset = 0;
+  size_t writeSize = 0;
 
   // Force buffer write for IMAGE1D_BUFFER
   if ((type == CL_COMMAND_WRITE_IMAGE) &&
@@ -1494,6 +2247,8 @@ void VirtualGPU::submitWriteMemory(amd::WriteMemoryCommand& cmd) {
       } else {
         result = blitMgr().writeBuffer(src, *devMem, origin, size, cmd.isEntireMemory());
       }
+      writeOffset = origin[0];
+      writeSize = size[0];
       break;
     }
     case CL_COMMAND_WRITE_BUFFER_RECT: {
@@ -1533,7 +2288,7 @@ void VirtualGPU::submitWriteMemory(amd::WriteMemoryCommand& cmd) {
     LogError("submitWriteMemory failed!");
     cmd.setStatus(CL_OUT_OF_RESOURCES);
   } else {
-    cmd.destination().signalWrite(&dev());
+    cmd.destination().signalWrite(&dev(), writeOffset, writeSize);
   }
 
   profilingEnd(cmd);
@@ -1568,26 +2323,43 @@ void VirtualGPU::submitSvmPrefetchAsync(amd::SvmPrefetchAsyncCommand& cmd) {
   profilingBegin(cmd);
 
   if (dev().info().hmmSupported_) {
-    // Initialize signal for the barrier
+    const std::vector<amd::SvmRange>& ranges = cmd.ranges();
+    // Initialize signal for the barrier. Each prefetch decrements the signal on completion,
+    // hence a single signal tracks all ranges
     auto wait_events = Barriers().WaitingSignal(HwQueueEngine::Unknown);
-    hsa_signal_t active = Barriers().ActiveSignal(kInitSignalValueOne, timestamp_);
+    hsa_signal_t active = Barriers().ActiveSignal(ranges.size(), timestamp_);
 
     // Find the requested agent for the transfer
     hsa_agent_t agent = (cmd.cpu_access() ||
         (dev().settings().hmmFlags_ & Settings::Hmm::EnableSystemMemory)) ?
         dev().getCpuAgent() : gpu_device();
 
-    // Initiate a prefetch command
-    hsa_status_t status = hsa_amd_svm_prefetch_async(
-        const_cast<void*>(cmd.dev_ptr()), cmd.count(), agent,
-        wait_events.size(), &wait_events[0], active);
+    // Initiate the prefetch commands
+    size_t issued = 0;
+    hsa_status_t status = HSA_STATUS_SUCCESS;
+    for (; issued < ranges.size(); ++issued) {
+      status = hsa_amd_svm_prefetch_async(
+          const_cast<void*>(ranges[issued].ptr_), ranges[issued].size_, agent,
+          wait_events.size(), &wait_events[0], active);
+      if (status != HSA_STATUS_SUCCESS) {
+        break;
+      }
+    }
 
-    // Wait for the prefetch. Should skip wait, but may require extra tracking for kernel execution
-    if ((status != HSA_STATUS_SUCCESS) || !Barriers().WaitCurrent()) {
-      Barriers().ResetCurrentSignal();
+    if (status != HSA_STATUS_SUCCESS) {
+      if (issued == 0) {
+        Barriers().ResetCurrentSignal();
+      } else {
+        // Release the signal for the ranges, which weren't issued
+        hsa_signal_subtract_screlease(active, ranges.size() - issued);
+      }
       LogError("hsa_amd_svm_prefetch_async failed");
       cmd.setStatus(CL_INVALID_OPERATION);
     }
+    // The prefetch isn't waited on CPU. The next operations on the queue wait for the signal,
+    // since the prefetch runs on an unknown engine
+    ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "SVM prefetch of %zu ranges into %s", issued,
+            (agent.handle == gpu_device().handle) ? "GPU" : "CPU");
 
     // Add system scope, since the prefetch scope is unclear
     addSystemScope();
@@ -1604,6 +2376,10 @@ bool VirtualGPU::copyMemory(cl_command_type type, amd::Memory& srcMem, amd::Memo
                             const amd::BufferRect& srcRect, const amd::BufferRect& dstRect) {
   Memory* srcDevMem = dev().getRocMemory(&srcMem);
   Memory* dstDevMem = dev().getRocMemory(&dstMem);
+  beginResidency();
+  if (!makeResident(srcDevMem) || !makeResident(dstDevMem)) {
+    return false;
+  }
 
   // Synchronize source and destination memory
   device::Memory::SyncFlags syncFlags;
@@ -1614,6 +2390,9 @@ bool VirtualGPU::copyMemory(cl_command_type type, amd::Memory& srcMem, amd::Memo
   bool result = false;
   bool srcImageBuffer = false;
   bool dstImageBuffer = false;
+  // The written byte range for the coherency tracking, zero if it's unknown
+  size_t writeOffset = 0;
+  size_t writeSize = 0;
 
   // Force buffer copy for IMAGE1D_BUFFER
   if (srcMem.getType() == CL_MEM_OBJECT_IMAGE1D_BUFFER) {
@@ -1646,6 +2425,8 @@ bool VirtualGPU::copyMemory(cl_command_type type, amd::Memory& srcMem, amd::Memo
       }
 
       result = blitMgr().copyBuffer(*srcDevMem, *dstDevMem, realSrcOrigin, realDstOrigin, realSize, entire);
+      writeOffset = realDstOrigin[0];
+      writeSize = realSize[0];
       break;
     }
     case CL_COMMAND_COPY_BUFFER_RECT: {
@@ -1675,7 +2456,7 @@ bool VirtualGPU::copyMemory(cl_command_type type, amd::Memory& srcMem, amd::Memo
   }
 
   // Mark this as the most-recently written cache of the destination
-  dstMem.signalWrite(&dev());
+  dstMem.signalWrite(&dev(), writeOffset, writeSize);
   return true;
 }
 
@@ -1702,6 +2483,64 @@ void VirtualGPU::submitCopyMemory(amd::CopyMemoryCommand& cmd) {
   profilingEnd(cmd);
 }
 
+//! The maximum number of the regions in one dispatch of the batch copy
+static constexpr size_t kBatchCopyRegions = 2048;
+
+// ================================================================================================
+void VirtualGPU::submitBatchCopyMemory(amd::BatchCopyMemoryCommand& cmd) {
+  // Make sure VirtualGPU has an exclusive access to the resources
+  amd::ScopedLock lock(execution());
+
+  profilingBegin(cmd);
+
+  Memory* srcDevMem = dev().getRocMemory(&cmd.source());
+  Memory* dstDevMem = dev().getRocMemory(&cmd.destination());
+  beginResidency();
+  bool result = makeResident(srcDevMem) && makeResident(dstDevMem);
+  if (result) {
+    dstDevMem->syncCacheFromHost(*this);
+    srcDevMem->syncCacheFromHost(*this);
+
+    KernelBlitManager& blit = static_cast<KernelBlitManager&>(blitMgr());
+    // The peer copies go through DMA, region by region
+    const bool batch = blit.hasBatchCopy() && (&srcDevMem->dev() == &dstDevMem->dev());
+    const auto& regions = cmd.regions();
+    const size_t maxRegions = kBatchCopyRegions;
+    for (size_t first = 0; result && (first < regions.size()); first += maxRegions) {
+      const size_t count = std::min(regions.size() - first, maxRegions);
+      // The descriptors live in the kernel arguments pool, which GPU reads directly
+      uint64_t* table = batch ? reinterpret_cast<uint64_t*>(
+          allocKernArg(3 * sizeof(uint64_t) * count, sizeof(uint64_t))) : nullptr;
+      if (table != nullptr) {
+        for (size_t i = 0; i < count; ++i) {
+          const auto& region = regions[first + i];
+          table[3 * i] = region.srcOffset_;
+          table[3 * i + 1] = region.dstOffset_;
+          table[3 * i + 2] = region.size_;
+        }
+        result = blit.copyBufferBatch(*srcDevMem, *dstDevMem, table, static_cast<uint>(count));
+      } else {
+        for (size_t i = first; result && (i < first + count); ++i) {
+          result = blit.copyBuffer(*srcDevMem, *dstDevMem, amd::Coord3D(regions[i].srcOffset_),
+                                   amd::Coord3D(regions[i].dstOffset_),
+                                   amd::Coord3D(regions[i].size_));
+        }
+      }
+    }
+    ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "Batch copy of %zu regions, %s", regions.size(),
+            batch ? "kernel" : "per region");
+  }
+
+  if (!result) {
+    LogError("submitBatchCopyMemory failed!");
+    cmd.setStatus(CL_INVALID_OPERATION);
+  } else {
+    // Mark this as the most-recently written cache of the destination
+    cmd.destination().signalWrite(&dev());
+  }
+  profilingEnd(cmd);
+}
+
 // ================================================================================================
 void VirtualGPU::submitSvmCopyMemory(amd::SvmCopyMemoryCommand& cmd) {
   // Make sure VirtualGPU has an exclusive access to the resources
@@ -1746,7 +2585,12 @@ void VirtualGPU::submitSvmCopyMemory(amd::SvmCopyMemoryCommand& cmd) {
 
       // If these are from different contexts, then one of them could be in the device memory
       // This is fine, since spec doesn't allow for copies with pointers from different contexts
-      amd::Os::fastMemcpy(cmd.dst(), cmd.src(), cmd.srcSize());
+      void* dst = cmd.dst();
+      const void* src = cmd.src();
+      const size_t copySize = cmd.srcSize();
+      if (!submitHostOp(copySize, [=]() { amd::Os::parallelMemcpy(dst, src, copySize); })) {
+        amd::Os::parallelMemcpy(dst, src, copySize);
+      }
       result = true;
     } else if (nullptr == srcMem && nullptr != dstMem) {  // src not in svm space
       Memory* memory = dev().getRocMemory(dstMem);
@@ -1779,11 +2623,184 @@ void VirtualGPU::submitSvmCopyMemory(amd::SvmCopyMemoryCommand& cmd) {
     // Stall GPU for CPU access to memory
     releaseGpuMemoryFence();
     // direct memcpy for FGS enabled system
-    amd::SvmBuffer::memFill(cmd.dst(), cmd.src(), cmd.srcSize(), 1);
+    void* dst = cmd.dst();
+    const void* src = cmd.src();
+    const size_t copySize = cmd.srcSize();
+    if (!submitHostOp(copySize, [=]() { amd::Os::parallelMemcpy(dst, src, copySize); })) {
+      amd::Os::parallelMemcpy(dst, src, copySize);
+    }
   }
   profilingEnd(cmd);
 }
 
+// ================================================================================================
+bool VirtualGPU::asyncCopy(address dst, hsa_agent_t dstAgent, const_address src,
+                           hsa_agent_t srcAgent, size_t size,
+                           const std::vector<hsa_signal_t>& deps, ProfilingSignal** done) {
+  // The dependencies are explicit, so the next operation on the queue must wait for the copy
+  Barriers().SetActiveEngine(HwQueueEngine::Unknown);
+  flushHdp();
+  hsa_signal_t active = Barriers().ActiveSignal(kInitSignalValueOne, timestamp_);
+
+  ClPrint(amd::LOG_DEBUG, amd::LOG_COPY,
+          "[%zx]!\t HSA Async Copy size=%zu, wait_events=%zu, completion_signal=0x%zx",
+          std::this_thread::get_id(), size, deps.size(), active.handle);
+
+  hsa_status_t status = hsa_amd_memory_async_copy(dst, dstAgent, src, srcAgent, size,
+      deps.size(), (deps.size() != 0) ? &deps[0] : nullptr, active);
+  if (status != HSA_STATUS_SUCCESS) {
+    Barriers().ResetCurrentSignal();
+    LogPrintfError("HSA async copy failed with code %d", status);
+    return false;
+  }
+  addSystemScope();
+  *done = Barriers().GetLastSignal();
+  return true;
+}
+
+// ================================================================================================
+bool VirtualGPU::submitHostOp(size_t size, std::function<void()>&& op) {
+  // The small operations are cheaper inline and the profiling requires the GPU timestamps
+  if (!ROC_ASYNC_HOST_SVM || (size < AMD_PARALLEL_COPY_SIZE * Ki) || (timestamp_ != nullptr)) {
+    return false;
+  }
+  HostOpThread* thread = HostOpThread::get();
+  if (thread == nullptr) {
+    return false;
+  }
+  // The host thread is another engine for the tracker, the same way as SDMA. Hence the next
+  // dispatch waits for the signal and a CPU wait on the queue covers the operation
+  Barriers().SetActiveEngine(HwQueueEngine::Unknown);
+  hsa_signal_t active = Barriers().ActiveSignal(kInitSignalValueOne, nullptr);
+  ClPrint(amd::LOG_DEBUG, amd::LOG_COPY,
+          "[%zx]!\t Host operation size=%zu, completion_signal=0x%zx",
+          std::this_thread::get_id(), size, active.handle);
+  thread->submit([op, active]() {
+    op();
+    hsa_signal_store_screlease(active, 0);
+  });
+  return true;
+}
+
+// ================================================================================================
+bool VirtualGPU::stripedCopy(address dst, hsa_agent_t dstAgent, const_address src,
+                             hsa_agent_t srcAgent, size_t size,
+                             const std::vector<hsa_signal_t>& deps) {
+  // ROCr picks the engine by the agents. Different agents send the first stripe to SDMA
+  // and the same agent on both sides sends the second stripe to the blit kernels
+  const size_t sdmaSize = std::min(amd::alignUp(size / 2, 4 * Ki), size);
+  ProfilingSignal* sdmaDone = nullptr;
+  ProfilingSignal* blitDone = nullptr;
+  bool result = asyncCopy(dst, dstAgent, src, srcAgent, sdmaSize, deps, &sdmaDone);
+  if (result && (sdmaSize < size)) {
+    result = asyncCopy(dst + sdmaSize, dev().getBackendDevice(), src + sdmaSize,
+                       dev().getBackendDevice(), size - sdmaSize, deps, &blitDone);
+  }
+  if ((sdmaDone != nullptr) && (blitDone != nullptr)) {
+    // Join the stripes, so the last signal on the queue tracks the whole copy
+    Barriers().AddExternalSignal(sdmaDone);
+    dispatchBarrierPacket(kBarrierPacketHeader);
+  }
+  ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "Striped copy of %zu bytes, SDMA stripe %zu bytes",
+          size, sdmaSize);
+  return result;
+}
+
+// ================================================================================================
+VirtualGPU::P2PRoute VirtualGPU::selectP2PRoute(const Device& srcDev, const Device& dstDev,
+                                                bool direct, const Device** relay) const {
+  constexpr int64_t kNoLink = std::numeric_limits<int32_t>::max();
+  int64_t directDistance = direct ? srcDev.linkDistance(&dstDev) : kNoLink;
+  // The direct copy without the link information keeps the original behavior
+  if (direct && (directDistance == kNoLink)) {
+    return P2PRoute::Direct;
+  }
+
+  // Find an intermediate device with the peer access to both sides and the shortest path
+  int64_t relayDistance = kNoLink;
+  for (auto device : dev().GlbCtx().devices()) {
+    const Device* candidate = static_cast<const Device*>(device);
+    if ((candidate == &srcDev) || (candidate == &dstDev) ||
+        !candidate->isP2pAgent(srcDev) || !srcDev.isP2pAgent(*candidate) ||
+        !candidate->isP2pAgent(dstDev) || !dstDev.isP2pAgent(*candidate)) {
+      continue;
+    }
+    const int64_t srcDistance = srcDev.linkDistance(candidate);
+    const int64_t dstDistance = candidate->linkDistance(&dstDev);
+    if ((srcDistance == kNoLink) || (dstDistance == kNoLink)) {
+      continue;
+    }
+    if ((srcDistance + dstDistance) < relayDistance) {
+      relayDistance = srcDistance + dstDistance;
+      *relay = candidate;
+    }
+  }
+
+  // The direct path wins the ties, since the relay and the host bounce move the data twice
+  if (direct) {
+    return (relayDistance < directDistance) ? P2PRoute::Relay : P2PRoute::Direct;
+  }
+  const int64_t hostDistance = srcDev.linkDistance(nullptr) + dstDev.linkDistance(nullptr);
+  return (relayDistance < hostDistance) ? P2PRoute::Relay : P2PRoute::HostStaged;
+}
+
+// ================================================================================================
+bool VirtualGPU::copyP2PStaged(const_address src, hsa_agent_t srcAgent, address dst,
+                               hsa_agent_t dstAgent, address stageIn, hsa_agent_t stageInAgent,
+                               const_address stageOut, hsa_agent_t stageOutAgent, size_t size) {
+  // Each half of the staging buffer holds a chunk, so both steps of the copy run at once
+  const size_t chunkSize = Device::kP2PStagingSize / 2;
+  ProfilingSignal* readDone[2] = {};
+  ProfilingSignal* writeDone[2] = {};
+  ProfilingSignal* lastRead = nullptr;
+  ProfilingSignal* lastWrite = nullptr;
+  std::vector<hsa_signal_t> deps;
+
+  bool result = true;
+  for (size_t offset = 0, chunk = 0; offset < size; offset += chunkSize, ++chunk) {
+    const size_t half = chunk % 2;
+    const size_t stageOffset = half * chunkSize;
+    const size_t copySize = std::min(chunkSize, size - offset);
+
+    // The first step waits until the second step releases the half
+    deps.clear();
+    if (lastRead != nullptr) {
+      deps.push_back(lastRead->signal_);
+    }
+    if (writeDone[half] != nullptr) {
+      deps.push_back(writeDone[half]->signal_);
+    }
+    if (!asyncCopy(stageIn + stageOffset, stageInAgent, src + offset, srcAgent, copySize,
+                      deps, &readDone[half])) {
+      result = false;
+      break;
+    }
+    lastRead = readDone[half];
+
+    // The second step waits for the chunk in the staging buffer
+    deps.clear();
+    deps.push_back(lastRead->signal_);
+    if (lastWrite != nullptr) {
+      deps.push_back(lastWrite->signal_);
+    }
+    if (!asyncCopy(dst + offset, dstAgent, stageOut + stageOffset, stageOutAgent, copySize,
+                      deps, &writeDone[half])) {
+      result = false;
+      break;
+    }
+    lastWrite = writeDone[half];
+  }
+
+  // The staging memory is shared between all queues, hence the copy must finish under the lock
+  for (auto signal : {lastRead, lastWrite}) {
+    if ((signal != nullptr) && !WaitForSignal(signal->signal_, waitPolicy_)) {
+      LogError("P2P staged copy wait failed");
+      result = false;
+    }
+  }
+  return result;
+}
+
 void VirtualGPU::submitCopyMemoryP2P(amd::CopyMemoryP2PCommand& cmd) {
   // Make sure VirtualGPU has an exclusive access to the resources
   amd::ScopedLock lock(execution());
@@ -1823,39 +2840,62 @@ void VirtualGPU::submitCopyMemoryP2P(amd::CopyMemoryP2PCommand& cmd) {
       amd::Coord3D srcOrigin(cmd.srcOrigin()[0]);
       amd::Coord3D dstOrigin(cmd.dstOrigin()[0]);
 
-      if (p2pAllowed) {
+      const Device& srcDev = srcDevMem->dev();
+      const Device& dstDev = dstDevMem->dev();
+      const Device* relay = nullptr;
+      P2PRoute route = selectP2PRoute(srcDev, dstDev, p2pAllowed, &relay);
+
+      if (route == P2PRoute::Direct) {
+        const size_t stripeSize = dev().settings().copyStripeSize_;
+        // Stripe only the copies, which both engines can reach over the peer link
+        if ((stripeSize != 0) && (size[0] >= stripeSize) &&
+            ((&srcDev == &dev()) || (&dstDev == &dev())) &&
+            srcDev.isP2pAgent(dstDev) && dstDev.isP2pAgent(srcDev)) {
+          // Both stripes wait for the previous operations on the queue
+          releaseGpuMemoryFence(kSkipCpuWait);
+          const std::vector<hsa_signal_t> deps = Barriers().WaitingSignal(HwQueueEngine::Unknown);
+          result = stripedCopy(
+              reinterpret_cast<address>(dstDevMem->getDeviceMemory()) + dstOrigin[0],
+              dstDev.getBackendDevice(),
+              reinterpret_cast<const_address>(srcDevMem->getDeviceMemory()) + srcOrigin[0],
+              srcDev.getBackendDevice(), size[0], deps);
+        } else {
           result = blitMgr().copyBuffer(*srcDevMem, *dstDevMem, srcOrigin, dstOrigin,
                                         size, cmd.isEntireMemory());
-      }
-      else {
-          // Sync the current queue, since P2P staging uses the device queues for transfer
-          releaseGpuMemoryFence();
+        }
+      } else {
+        // Sync the current queue, since P2P staging has no dependencies on the queue
+        releaseGpuMemoryFence();
 
-          amd::ScopedLock lock(dev().P2PStageOps());
+        amd::ScopedLock lock(dev().P2PStageOps());
+        address relayStage = nullptr;
+        if (route == P2PRoute::Relay) {
+          relayStage = reinterpret_cast<address>(relay->relayStage());
+          if (relayStage == nullptr) {
+            route = P2PRoute::HostStaged;
+          }
+        }
+        const_address src = reinterpret_cast<const_address>(srcDevMem->getDeviceMemory()) +
+                            srcOrigin[0];
+        address dst = reinterpret_cast<address>(dstDevMem->getDeviceMemory()) + dstOrigin[0];
+
+        if (route == P2PRoute::Relay) {
+          ClPrint(amd::LOG_INFO, amd::LOG_COPY, "P2P copy of %zu bytes relays through %s",
+                  size[0], relay->info().boardName_);
+          result = copyP2PStaged(src, srcDev.getBackendDevice(), dst, dstDev.getBackendDevice(),
+                                 relayStage, relay->getBackendDevice(), relayStage,
+                                 relay->getBackendDevice(), size[0]);
+        } else {
           Memory* dstStgMem = static_cast<Memory*>(
               dev().P2PStage()->getDeviceMemory(*cmd.source().getContext().devices()[0]));
           Memory* srcStgMem = static_cast<Memory*>(
               dev().P2PStage()->getDeviceMemory(*cmd.destination().getContext().devices()[0]));
-
-          size_t copy_size = Device::kP2PStagingSize;
-          size_t left_size = size[0];
-          result = true;
-          do {
-            if (left_size <= copy_size) {
-              copy_size = left_size;
-            }
-            left_size -= copy_size;
-            amd::Coord3D stageOffset(0);
-            amd::Coord3D cpSize(copy_size);
-
-            // Perform 2 step transfer with staging buffer
-            result &= srcDevMem->dev().xferMgr().copyBuffer(
-              *srcDevMem, *dstStgMem, srcOrigin, stageOffset, cpSize);
-            srcOrigin.c[0] += copy_size;
-            result &= dstDevMem->dev().xferMgr().copyBuffer(
-              *srcStgMem, *dstDevMem, stageOffset, dstOrigin, cpSize);
-            dstOrigin.c[0] += copy_size;
-          } while (left_size > 0);
+          result = copyP2PStaged(src, srcDev.getBackendDevice(), dst, dstDev.getBackendDevice(),
+                                 reinterpret_cast<address>(dstStgMem->getDeviceMemory()),
+                                 srcDev.getCpuAgent(),
+                                 reinterpret_cast<const_address>(srcStgMem->getDeviceMemory()),
+                                 dstDev.getCpuAgent(), size[0]);
+        }
       }
       break;
     }
@@ -1966,6 +3006,12 @@ void VirtualGPU::submitMapMemory(amd::MapMemoryCommand& cmd) {
 
   roc::Memory* devMemory =
       reinterpret_cast<roc::Memory*>(cmd.memory().getDeviceMemory(dev(), false));
+  beginResidency();
+  if (!makeResident(devMemory)) {
+    cmd.setStatus(CL_OUT_OF_RESOURCES);
+    profilingEnd(cmd);
+    return;
+  }
 
   cl_command_type type = cmd.type();
   bool imageBuffer = false;
@@ -2068,6 +3114,12 @@ void VirtualGPU::submitUnmapMemory(amd::UnmapMemoryCommand& cmd) {
   }
 
   profilingBegin(cmd);
+  beginResidency();
+  if (!makeResident(devMemory)) {
+    cmd.setStatus(CL_OUT_OF_RESOURCES);
+    profilingEnd(cmd);
+    return;
+  }
 
   // Force buffer write for IMAGE1D_BUFFER
   bool imageBuffer = (cmd.memory().getType() == CL_MEM_OBJECT_IMAGE1D_BUFFER);
@@ -2076,8 +3128,8 @@ void VirtualGPU::submitUnmapMemory(amd::UnmapMemoryCommand& cmd) {
   if ((devMemory->owner()->getHostMem() != nullptr) &&
       (devMemory->owner()->getSvmPtr() == nullptr)) {
     if (mapInfo->isUnmapWrite()) {
-      // Target is the backing store, so sync
-      devMemory->owner()->signalWrite(nullptr);
+      // Target is the backing store, so sync the mapped range
+      devMemory->owner()->signalWrite(nullptr, mapInfo->origin_[0], mapInfo->region_[0]);
       devMemory->syncCacheFromHost(*this);
     }
     if (devMemory->isHostMemDirectAccess()) {
@@ -2137,7 +3189,7 @@ void VirtualGPU::submitUnmapMemory(amd::UnmapMemoryCommand& cmd) {
       }
     }
 
-    cmd.memory().signalWrite(&dev());
+    cmd.memory().signalWrite(&dev(), mapInfo->origin_[0], mapInfo->region_[0]);
   }
 
   devMemory->clearUnmapInfo(cmd.mapPtr());
@@ -2152,6 +3204,10 @@ bool VirtualGPU::fillMemory(cl_command_type type, amd::Memory* amdMemory, const
   amd::ScopedLock lock(execution());
 
   Memory* memory = dev().getRocMemory(amdMemory);
+  beginResidency();
+  if (!makeResident(memory)) {
+    return false;
+  }
 
   bool entire = amdMemory->isEntirelyCovered(origin, size);
   // Synchronize memory from host if necessary
@@ -2162,6 +3218,9 @@ bool VirtualGPU::fillMemory(cl_command_type type, amd::Memory* amdMemory, const
   bool result = false;
   bool imageBuffer = false;
   float fillValue[4];
+  // The written byte range for the coherency tracking, zero if it's unknown
+  size_t writeOffset = 0;
+  size_t writeSize = 0;
 
   // Force fill buffer for IMAGE1D_BUFFER
   if ((type == CL_COMMAND_FILL_IMAGE) && (amdMemory->getType() == CL_MEM_OBJECT_IMAGE1D_BUFFER)) {
@@ -2186,6 +3245,8 @@ bool VirtualGPU::fillMemory(cl_command_type type, amd::Memory* amdMemory, const
         patternSize = elemSize;
       }
       result = blitMgr().fillBuffer(*memory, pattern, patternSize, realOrigin, realSize, entire);
+      writeOffset = realOrigin[0];
+      writeSize = realSize[0];
       break;
     }
     case CL_COMMAND_FILL_IMAGE: {
@@ -2201,7 +3262,7 @@ bool VirtualGPU::fillMemory(cl_command_type type, amd::Memory* amdMemory, const
     LogError("submitFillMemory failed!");
   }
 
-  amdMemory->signalWrite(&dev());
+  amdMemory->signalWrite(&dev(), writeOffset, writeSize);
   return true;
 }
 
@@ -2219,35 +3280,77 @@ void VirtualGPU::submitFillMemory(amd::FillMemoryCommand& cmd) {
 }
 
 void VirtualGPU::dispatchBarrierValuePacket(const hsa_amd_barrier_value_packet_t* packet,
-                                            hsa_amd_vendor_packet_header_t header) {
-  assert(packet->completion_signal.handle != 0);
+                                            hsa_amd_vendor_packet_header_t header,
+                                            uint32_t count) {
   const uint32_t queueSize = gpu_queue_->size;
   const uint32_t queueMask = queueSize - 1;
 
-  uint64_t index = hsa_queue_add_write_index_screlease(gpu_queue_, 1);
-  while ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask) {
+  flushHdp();
+
+  // Reserve the slots for all packets, so the doorbell is rung once
+  uint64_t index = hsa_queue_add_write_index_screlease(gpu_queue_, count);
+  const uint64_t last = index + count - 1;
+  if ((last - hsa_queue_load_read_index_relaxed(gpu_queue_)) >= queueMask) {
+    ringDoorbell();
+  }
+  while ((last - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask) {
     amd::Os::yield();
   }
-  hsa_amd_barrier_value_packet_t* aql_loc = &(reinterpret_cast<hsa_amd_barrier_value_packet_t*>(
-      gpu_queue_->base_address))[index & queueMask];
-  *aql_loc = *packet;
   unsigned int* headerPtr = reinterpret_cast<unsigned int*>(&header);
-  __atomic_store_n(reinterpret_cast<uint32_t*>(aql_loc), *headerPtr, __ATOMIC_RELEASE);
+  for (uint32_t i = 0; i < count; ++i) {
+    hsa_amd_barrier_value_packet_t* aql_loc =
+        &(reinterpret_cast<hsa_amd_barrier_value_packet_t*>(
+            gpu_queue_->base_address))[(index + i) & queueMask];
+    *aql_loc = packet[i];
+    __atomic_store_n(reinterpret_cast<uint32_t*>(aql_loc), *headerPtr, __ATOMIC_RELEASE);
+    ClPrint(amd::LOG_DEBUG, amd::LOG_AQL,
+            "[%zx] HWq=0x%zx, BarrierValue Header = 0x%x AmdFormat = 0x%x ",
+            "(type=%d, barrier=%d, acquire=%d, release=%d), "
+            "completion_signal=0x%zx value = 0x%llx mask = 0x%llx cond: %d (GTE: %d EQ: %d NE: %d)",
+            std::this_thread::get_id(), gpu_queue_, header.header, header.AmdFormat,
+            extractAqlBits(header.header, HSA_PACKET_HEADER_TYPE, HSA_PACKET_HEADER_WIDTH_TYPE),
+            extractAqlBits(header.header, HSA_PACKET_HEADER_BARRIER,
+                           HSA_PACKET_HEADER_WIDTH_BARRIER),
+            extractAqlBits(header.header, HSA_PACKET_HEADER_SCACQUIRE_FENCE_SCOPE,
+                           HSA_PACKET_HEADER_WIDTH_SCACQUIRE_FENCE_SCOPE),
+            extractAqlBits(header.header, HSA_PACKET_HEADER_SCRELEASE_FENCE_SCOPE,
+                           HSA_PACKET_HEADER_WIDTH_SCRELEASE_FENCE_SCOPE),
+            packet[i].completion_signal, packet[i].value, packet[i].mask, packet[i].cond,
+            HSA_SIGNAL_CONDITION_GTE, HSA_SIGNAL_CONDITION_EQ, HSA_SIGNAL_CONDITION_NE);
+  }
 
-  hsa_signal_store_screlease(gpu_queue_->doorbell_signal, index);
-  ClPrint(amd::LOG_DEBUG, amd::LOG_AQL,
-          "[%zx] HWq=0x%zx, BarrierValue Header = 0x%x AmdFormat = 0x%x ",
-          "(type=%d, barrier=%d, acquire=%d, release=%d), "
-          "completion_signal=0x%zx value = 0x%llx mask = 0x%llx cond: %d (GTE: %d EQ: %d NE: %d)",
-          std::this_thread::get_id(), gpu_queue_, header.header, header.AmdFormat,
-          extractAqlBits(header.header, HSA_PACKET_HEADER_TYPE, HSA_PACKET_HEADER_WIDTH_TYPE),
-          extractAqlBits(header.header, HSA_PACKET_HEADER_BARRIER, HSA_PACKET_HEADER_WIDTH_BARRIER),
-          extractAqlBits(header.header, HSA_PACKET_HEADER_SCACQUIRE_FENCE_SCOPE,
-                         HSA_PACKET_HEADER_WIDTH_SCACQUIRE_FENCE_SCOPE),
-          extractAqlBits(header.header, HSA_PACKET_HEADER_SCRELEASE_FENCE_SCOPE,
-                         HSA_PACKET_HEADER_WIDTH_SCRELEASE_FENCE_SCOPE),
-          packet->completion_signal, packet->value, packet->mask, packet->cond,
-          HSA_SIGNAL_CONDITION_GTE, HSA_SIGNAL_CONDITION_EQ, HSA_SIGNAL_CONDITION_NE);
+  storeDoorbell(last, count);
+}
+
+void VirtualGPU::setStreamWaitCondition(hsa_amd_barrier_value_packet_t* packet, int64_t value,
+                                        uint64_t mask, unsigned int flags) {
+  // mask is always applied on value at signal before performing
+  // the comparision defiend by 'condition'
+  switch (flags) {
+    case ROCCLR_STREAM_WAIT_VALUE_GTE:
+      packet->value = value;
+      packet->mask = mask;
+      packet->cond = HSA_SIGNAL_CONDITION_GTE;
+      break;
+    case ROCCLR_STREAM_WAIT_VALUE_EQ:
+      packet->value = value;
+      packet->mask = mask;
+      packet->cond = HSA_SIGNAL_CONDITION_EQ;
+      break;
+    case ROCCLR_STREAM_WAIT_VALUE_AND:
+      packet->value = 0;
+      packet->mask = (value & mask);
+      packet->cond = HSA_SIGNAL_CONDITION_NE;
+      break;
+    case ROCCLR_STREAM_WAIT_VALUE_NOR:
+      packet->value = ~value & mask;
+      packet->mask = ~value & mask;
+      packet->cond = HSA_SIGNAL_CONDITION_NE;
+      break;
+    default:
+      ShouldNotReachHere();
+      break;
+  }
 }
 
 void VirtualGPU::submitStreamOperation(amd::StreamOperationCommand& cmd) {
@@ -2268,41 +3371,13 @@ void VirtualGPU::submitStreamOperation(amd::StreamOperationCommand& cmd) {
   if (type == ROCCLR_COMMAND_STREAM_WAIT_VALUE) {
     hsa_amd_barrier_value_packet_t aqlPacket;
     hsa_amd_vendor_packet_header_t header;
-    hsa_signal_t signal;
     Buffer* buff = static_cast<Buffer*>(memory);
 
     header.header = kBarrierVendorPacketHeader;
     header.AmdFormat = HSA_AMD_PACKET_TYPE_BARRIER_VALUE;
     aqlPacket.signal = buff->getSignal();
     aqlPacket.completion_signal = Barriers().ActiveSignal();
-
-    // mask is always applied on value at signal before performing
-    // the comparision defiend by 'condition'
-    switch (flags) {
-      case ROCCLR_STREAM_WAIT_VALUE_GTE:
-        aqlPacket.value = value;
-        aqlPacket.mask = mask;
-        aqlPacket.cond = HSA_SIGNAL_CONDITION_GTE;
-        break;
-      case ROCCLR_STREAM_WAIT_VALUE_EQ:
-        aqlPacket.value = value;
-        aqlPacket.mask = mask;
-        aqlPacket.cond = HSA_SIGNAL_CONDITION_EQ;
-        break;
-      case ROCCLR_STREAM_WAIT_VALUE_AND:
-        aqlPacket.value = 0;
-        aqlPacket.mask = (value & mask);
-        aqlPacket.cond = HSA_SIGNAL_CONDITION_NE;
-        break;
-      case ROCCLR_STREAM_WAIT_VALUE_NOR:
-        aqlPacket.value = ~value & mask;
-        aqlPacket.mask = ~value & mask;
-        aqlPacket.cond = HSA_SIGNAL_CONDITION_NE;
-        break;
-      default:
-        ShouldNotReachHere();
-        break;
-    }
+    setStreamWaitCondition(&aqlPacket, value, mask, flags);
     dispatchBarrierValuePacket(&aqlPacket, header);
   } else if (type == ROCCLR_COMMAND_STREAM_WRITE_VALUE) {
     amd::Coord3D origin(offset);
@@ -2325,6 +3400,84 @@ void VirtualGPU::submitStreamOperation(amd::StreamOperationCommand& cmd) {
   profilingEnd(cmd);
 }
 
+void VirtualGPU::submitBatchStreamOperation(amd::BatchStreamOperationCommand& cmd) {
+  // Make sure VirtualGPU has an exclusive access to the resources
+  amd::ScopedLock lock(execution());
+  profilingBegin(cmd);
+
+  const auto& ops = cmd.operations();
+  hsa_amd_vendor_packet_header_t header;
+  header.header = kBarrierVendorPacketHeader;
+  header.AmdFormat = HSA_AMD_PACKET_TYPE_BARRIER_VALUE;
+  std::vector<hsa_amd_barrier_value_packet_t> waits;
+  waits.reserve(ops.size());
+
+  for (size_t i = 0; i < ops.size();) {
+    if (ops[i].type_ == ROCCLR_COMMAND_STREAM_WAIT_VALUE) {
+      hsa_amd_barrier_value_packet_t aqlPacket = {};
+      aqlPacket.signal = static_cast<Buffer*>(dev().getRocMemory(ops[i].memory_))->getSignal();
+      setStreamWaitCondition(&aqlPacket, ops[i].value_, ops[i].mask_, ops[i].flags_);
+      hsa_amd_barrier_value_packet_t* prev = waits.empty() ? nullptr : &waits.back();
+      if ((prev != nullptr) && (prev->signal.handle == aqlPacket.signal.handle) &&
+          (prev->cond == aqlPacket.cond) && (prev->mask == aqlPacket.mask)) {
+        if (prev->value == aqlPacket.value) {
+          // The same wait back to back is satisfied by the first one
+          ++i;
+          continue;
+        } else if (aqlPacket.cond == HSA_SIGNAL_CONDITION_GTE) {
+          // The waits are serialized, so the largest GTE value covers both
+          prev->value = std::max(prev->value, aqlPacket.value);
+          ++i;
+          continue;
+        }
+      }
+      waits.push_back(aqlPacket);
+      ++i;
+      continue;
+    }
+
+    // Flush the waits before the writes. The packets are serialized with the barrier bit
+    if (!waits.empty()) {
+      dispatchBarrierValuePacket(waits.data(), header, static_cast<uint32_t>(waits.size()));
+      waits.clear();
+    }
+
+    // Ensure memory ordering preceding the writes, a single barrier covers the whole run
+    dispatchBarrierPacket(kBarrierPacketReleaseHeader);
+    for (; (i < ops.size()) && (ops[i].type_ == ROCCLR_COMMAND_STREAM_WRITE_VALUE);) {
+      // Merge the contiguous writes of the same value and size into a single fill
+      size_t last = i;
+      while (((last + 1) < ops.size()) &&
+             (ops[last + 1].type_ == ROCCLR_COMMAND_STREAM_WRITE_VALUE) &&
+             (ops[last + 1].memory_ == ops[i].memory_) &&
+             (ops[last + 1].sizeBytes_ == ops[i].sizeBytes_) &&
+             (ops[last + 1].value_ == ops[i].value_) &&
+             (ops[last + 1].offset_ == ops[last].offset_ + ops[last].sizeBytes_)) {
+        ++last;
+      }
+      const uint64_t value = ops[i].value_;
+      amd::Coord3D origin(ops[i].offset_);
+      amd::Coord3D size(ops[i].sizeBytes_ * (last - i + 1));
+      bool entire = ops[i].memory_->isEntirelyCovered(origin, size);
+      Memory* memory = dev().getRocMemory(ops[i].memory_);
+      if (!blitMgr().fillBuffer(*memory, &value, ops[i].sizeBytes_, origin, size, entire,
+                                true)) {
+        LogError("submitBatchStreamOperation: Write failed!");
+      }
+      ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "Writting value: 0x%lx, %zu times", value,
+              last - i + 1);
+      i = last + 1;
+    }
+  }
+
+  // The last wait packet carries the completion signal of the batch
+  if (!waits.empty()) {
+    waits.back().completion_signal = Barriers().ActiveSignal();
+    dispatchBarrierValuePacket(waits.data(), header, static_cast<uint32_t>(waits.size()));
+  }
+  profilingEnd(cmd);
+}
+
 void VirtualGPU::submitSvmFillMemory(amd::SvmFillMemoryCommand& cmd) {
   // Make sure VirtualGPU has an exclusive access to the resources
   amd::ScopedLock lock(execution());
@@ -2362,7 +3515,15 @@ void VirtualGPU::submitSvmFillMemory(amd::SvmFillMemoryCommand& cmd) {
     // Stall GPU for CPU access to memory
     releaseGpuMemoryFence();
     // for FGS capable device, fill CPU memory directly
-    amd::SvmBuffer::memFill(cmd.dst(), cmd.pattern(), cmd.patternSize(), cmd.times());
+    void* dst = cmd.dst();
+    const size_t times = cmd.times();
+    // The operation owns a copy of the pattern, so the helper thread doesn't access the command
+    std::vector<char> pattern(cmd.pattern(), cmd.pattern() + cmd.patternSize());
+    if (!submitHostOp(pattern.size() * times, [=]() {
+          amd::SvmBuffer::memFill(dst, pattern.data(), pattern.size(), times);
+        })) {
+      amd::SvmBuffer::memFill(dst, pattern.data(), pattern.size(), times);
+    }
   }
 
   profilingEnd(cmd);
@@ -2475,7 +3636,10 @@ bool VirtualGPU::createVirtualQueue(uint deviceQueueSize)
   uint MinDeviceQueueSize = 16 * 1024;
   deviceQueueSize = std::max(deviceQueueSize, MinDeviceQueueSize);
 
-  maskGroups_ = deviceQueueSize / (512 * Ki);
+  // Each scheduler thread processes DeviceQueueMaskSize slots per mask group.
+  // Pick the groups, so the scheduler launches about one thread per CU
+  maskGroups_ = deviceQueueSize /
+      (sizeof(AmdAqlWrap) * DeviceQueueMaskSize * dev().info().maxComputeUnits_);
   maskGroups_ = (maskGroups_ == 0) ? 1 : maskGroups_;
 
   // Align the queue size for the multiple dispatch scheduler.
@@ -2588,34 +3752,347 @@ bool VirtualGPU::createVirtualQueue(uint deviceQueueSize)
   return true;
 }
 
-bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const amd::Kernel& kernel,
-  const_address parameters, void* eventHandle, uint32_t sharedMemBytes, amd::NDRangeKernelCommand* vcmd) {
-  device::Kernel* devKernel = const_cast<device::Kernel*>(kernel.getDeviceKernel(dev()));
-  Kernel& gpuKernel = static_cast<Kernel&>(*devKernel);
-  size_t ldsUsage = gpuKernel.WorkgroupGroupSegmentByteSize();
-  bool imageBufferWrtBack = false; // Image buffer write back is required
-  std::vector<device::Memory*> wrtBackImageBuffer; // Array of images for write back
+// ================================================================================================
+const VirtualGPU::HiddenArgs* VirtualGPU::findHiddenArgs(const Kernel& kernel, bool coopGroups,
+                                                         bool printfEnabled) {
+  const Kernel::LaunchPlan& plan = kernel.launchPlan();
+  if (!plan.templated_) {
+    return nullptr;
+  }
+  address printfBuffer = printfEnabled ? printfDbg()->dbgBuffer() : nullptr;
+  auto it = hiddenArgs_.find(plan.id_);
+  if (it != hiddenArgs_.end()) {
+    // The printf buffer can be reallocated on an overflow
+    if ((it->second.coopGroups_ == coopGroups) && (it->second.printfBuffer_ == printfBuffer)) {
+      return &it->second;
+    }
+    hiddenArgs_.erase(it);
+  } else if (hiddenArgs_.size() >= kMaxHiddenArgs) {
+    // The templates of the released kernels are never used again
+    hiddenArgs_.clear();
+  }
 
-  // Check memory dependency and SVM objects
-  bool coopGroups = (vcmd != nullptr) ? vcmd->cooperativeGroups() : false;
-  if (!processMemObjects(kernel, parameters, ldsUsage, coopGroups,
-                         imageBufferWrtBack, wrtBackImageBuffer)) {
-    LogError("Wrong memory objects!");
-    return false;
+  const amd::KernelSignature& signature = kernel.signature();
+  size_t first = std::numeric_limits<size_t>::max();
+  size_t last = 0;
+  for (uint32_t i = signature.numParameters(); i < signature.numParametersAll(); ++i) {
+    const auto& desc = signature.at(i);
+    if ((desc.info_.oclObject_ == amd::KernelParameterDescriptor::HiddenPrintfBuffer) ||
+        (desc.info_.oclObject_ == amd::KernelParameterDescriptor::HiddenHostcallBuffer)) {
+      first = std::min(first, desc.offset_);
+      last = std::max(last, desc.offset_ + desc.size_);
+    }
   }
 
-  // Init PrintfDbg object if printf is enabled.
-  bool printfEnabled = (gpuKernel.printfInfo().size() > 0) ? true : false;
-  if (!printfDbg()->init(printfEnabled)) {
-    LogError("\nPrintfDbg object initialization failed!");
+  HiddenArgs args = {};
+  args.offset_ = (last != 0) ? first : 0;
+  args.block_.resize(last - args.offset_, 0);
+  args.printfBuffer_ = printfBuffer;
+  args.coopGroups_ = coopGroups;
+  for (uint32_t i = signature.numParameters(); i < signature.numParametersAll(); ++i) {
+    const auto& desc = signature.at(i);
+    if (desc.info_.oclObject_ == amd::KernelParameterDescriptor::HiddenPrintfBuffer) {
+      if (printfBuffer != nullptr) {
+        assert(desc.size_ == sizeof(printfBuffer) && "check the sizes");
+        WriteAqlArgAt(args.block_.data(), &printfBuffer, desc.size_,
+                      desc.offset_ - args.offset_);
+      }
+    } else if ((desc.info_.oclObject_ == amd::KernelParameterDescriptor::HiddenHostcallBuffer) &&
+               amd::IS_HIP) {
+      auto buffer = roc_device_.getOrCreateHostcallBuffer(gpu_queue_, coopGroups, cuMask_);
+      if (!buffer) {
+        // The generic setup reports the error
+        return nullptr;
+      }
+      assert(desc.size_ == sizeof(buffer) && "check the sizes");
+      WriteAqlArgAt(args.block_.data(), &buffer, desc.size_, desc.offset_ - args.offset_);
+      args.hostcall_ = true;
+    }
+  }
+  return &(hiddenArgs_[plan.id_] = std::move(args));
+}
+
+// ================================================================================================
+bool VirtualGPU::dispatchKernelPacket(Kernel& gpuKernel, const amd::NDRangeContainer& sizes,
+                                      const size_t* globalSize,
+                                      const amd::LaunchDescriptor* launch, address argBuffer,
+                                      size_t ldsUsage, uint32_t sharedMemBytes,
+                                      amd::NDRangeKernelCommand* vcmd) {
+  // Check for group memory overflow
+  //! @todo Check should be in HSA - here we should have at most an assert
+  assert(roc_device_.info().localMemSizePerCU_ > 0);
+  if (ldsUsage > roc_device_.info().localMemSizePerCU_) {
+    LogError("No local memory available\n");
     return false;
   }
 
-  const amd::KernelSignature& signature = kernel.signature();
-  const amd::KernelParameters& kernelParams = kernel.parameters();
+  // Initialize the dispatch Packet
+  hsa_kernel_dispatch_packet_t dispatchPacket;
+  memset(&dispatchPacket, 0, sizeof(dispatchPacket));
+
+  dispatchPacket.header = kInvalidAql;
+  dispatchPacket.kernel_object = gpuKernel.KernelCodeHandle();
+
+  // dispatchPacket.header = aqlHeader_;
+  // dispatchPacket.setup |= sizes.dimensions() << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS;
+  if (launch != nullptr) {
+    dispatchPacket.grid_size_x = launch->gridSize_[0];
+    dispatchPacket.grid_size_y = launch->gridSize_[1];
+    dispatchPacket.grid_size_z = launch->gridSize_[2];
+    dispatchPacket.workgroup_size_x = launch->workgroupSize_[0];
+    dispatchPacket.workgroup_size_y = launch->workgroupSize_[1];
+    dispatchPacket.workgroup_size_z = launch->workgroupSize_[2];
+  } else {
+    dispatchPacket.grid_size_x = sizes.dimensions() > 0 ? globalSize[0] : 1;
+    dispatchPacket.grid_size_y = sizes.dimensions() > 1 ? globalSize[1] : 1;
+    dispatchPacket.grid_size_z = sizes.dimensions() > 2 ? globalSize[2] : 1;
 
-  size_t newOffset[3] = {0, 0, 0};
-  size_t newGlobalSize[3] = {0, 0, 0};
+    amd::NDRange local(sizes.local());
+    gpuKernel.FindLocalWorkSize(sizes.dimensions(), sizes.global(), local);
+    dispatchPacket.workgroup_size_x = sizes.dimensions() > 0 ? local[0] : 1;
+    dispatchPacket.workgroup_size_y = sizes.dimensions() > 1 ? local[1] : 1;
+    dispatchPacket.workgroup_size_z = sizes.dimensions() > 2 ? local[2] : 1;
+  }
+
+  dispatchPacket.kernarg_address = argBuffer;
+  dispatchPacket.group_segment_size = ldsUsage + sharedMemBytes;
+  dispatchPacket.private_segment_size = gpuKernel.workGroupInfo()->privateMemSize_;
+  if (dispatchPacket.private_segment_size != 0) {
+    // ROCr grows the queue scratch for all waves on the device, so report the same size
+    const uint64_t scratch = static_cast<uint64_t>(dispatchPacket.private_segment_size) *
+        dev().info().wavefrontWidth_ * dev().info().maxComputeUnits_ * kScratchWavesPerCu;
+    if (scratch > scratchReserved_) {
+      metrics().add(VDI_METRIC_SCRATCH_BYTES, scratch - scratchReserved_);
+      roc_device_.memoryUsage().add(VDI_MEMORY_SCRATCH, scratch - scratchReserved_);
+      scratchReserved_ = scratch;
+    }
+  }
+
+  // Pass the header accordingly
+  auto aqlHeaderWithOrder = aqlHeader_;
+  if (vcmd != nullptr && vcmd->getAnyOrderLaunchFlag()) {
+    constexpr uint32_t kAqlHeaderMask = ~(1 << HSA_PACKET_HEADER_BARRIER);
+    aqlHeaderWithOrder &= kAqlHeaderMask;
+  }
+
+  // The system acquire invalidates L2, so it's skipped for the kernels, which don't touch
+  // the host coherent memory. The printf and device enqueue buffers are accessed by the host
+  bool systemScope = addSystemScope_ || ((vcmd != nullptr) && vcmd->fenceScopeSystem());
+  if (!systemScope && !dev().settings().fenceScopeAgent_) {
+    const bool agentScope = (vcmd != nullptr) && vcmd->fenceScopeAgent();
+    const bool inferred = ROC_INFER_FENCE_SCOPE && !hostCoherentArgs_ &&
+        (gpuKernel.printfInfo().size() == 0) && !gpuKernel.dynamicParallelism();
+    if (agentScope || inferred) {
+      constexpr uint32_t kAcquireScopeMask =
+          ((1 << HSA_PACKET_HEADER_WIDTH_ACQUIRE_FENCE_SCOPE) - 1)
+          << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE;
+      aqlHeaderWithOrder &= ~kAcquireScopeMask;
+      aqlHeaderWithOrder |= (HSA_FENCE_SCOPE_AGENT << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE);
+    } else {
+      systemScope = true;
+    }
+  }
+  if (systemScope) {
+    aqlHeaderWithOrder &= ~(HSA_FENCE_SCOPE_AGENT << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE);
+    aqlHeaderWithOrder |= (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE);
+  }
+  addSystemScope_ = false;
+
+  const uint16_t setup = (sizes.dimensions() << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS);
+  if ((vcmd != nullptr) && (vcmd->indirectGroups() != nullptr)) {
+    if (capture_ != nullptr) {
+      LogError("Indirect launches can't be recorded!");
+      return false;
+    }
+    return dispatchIndirectPacket(&dispatchPacket, aqlHeaderWithOrder, setup, *vcmd);
+  }
+
+  // The profiling queues and the graph capture don't support the sampling,
+  // since the packets get the timestamp signals or are recorded for a replay
+  const bool sampled = (counterSampler_ != nullptr) && (capture_ == nullptr) &&
+                       (timestamp_ == nullptr) && counterSampler_->start();
+
+  // Dispatch the packet
+  const bool dispatched = dispatchAqlPacket(&dispatchPacket, aqlHeaderWithOrder, setup,
+                                            GPU_FLUSH_ON_EXECUTION);
+  if (sampled) {
+    // Close the sample even on a failure, since the start packet was already sent
+    counterSampler_->stop(gpuKernel.name());
+  }
+  if (!dispatched) {
+    return false;
+  }
+  // The stop packet of the trace buffer can't get the timestamp signal
+  if ((threadTrace_ != nullptr) && (capture_ == nullptr) && (timestamp_ == nullptr)) {
+    threadTrace_->dispatched();
+  }
+  if ((ROC_HANG_TIMEOUT != 0) && (capture_ == nullptr)) {
+    recordDispatch(gpuKernel.name(), argBuffer, gpuKernel.KernargSegmentByteSize());
+  }
+  return true;
+}
+
+// ================================================================================================
+bool VirtualGPU::dispatchIndirectPacket(hsa_kernel_dispatch_packet_t* packet, uint16_t header,
+                                        uint16_t rest, const amd::NDRangeKernelCommand& vcmd) {
+  amd::Kernel* patch = static_cast<KernelBlitManager&>(blitMgr()).patchDispatchKernel();
+  Memory* counts = dev().getGpuMemory(vcmd.indirectGroups());
+  if ((patch == nullptr) || (counts == nullptr)) {
+    LogError("Indirect launch isn't available!");
+    return false;
+  }
+  if (!makeResident(counts)) {
+    return false;
+  }
+  Kernel& patchKernel = static_cast<Kernel&>(*patch->getDeviceKernel(dev()));
+  address argBuffer = reinterpret_cast<address>(
+      allocKernArg(patchKernel.KernargSegmentByteSize(), patchKernel.KernargSegmentAlignment()));
+  if (argBuffer == nullptr) {
+    LogError("Out of memory");
+    return false;
+  }
+  memset(argBuffer, 0, patchKernel.KernargSegmentByteSize());
+
+  metrics().add(VDI_METRIC_DISPATCHES);
+  dispatchBlockingWait();
+  // The packets can read the memory, which CPU wrote
+  flushHdp();
+
+  // The patch kernel and the target packet must be adjacent, so both slots are reserved
+  // at once. The queue can be shared with the other VirtualGPUs
+  constexpr uint32_t kNumSlots = 2;
+  const uint32_t queueMask = gpu_queue_->size - 1;
+  const uint64_t index = hsa_queue_add_write_index_screlease(gpu_queue_, kNumSlots);
+  const uint64_t read = hsa_queue_load_read_index_relaxed(gpu_queue_);
+  if ((index + 1 - read) >= queueMask) {
+    // The packet processor can't free the slots for the packets, which weren't sent yet
+    ringDoorbell();
+  }
+  while ((index + 1 - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask) {
+    amd::Os::yield();
+  }
+
+  if (timestamp_ != nullptr) {
+    // Pool size must grow to the size of pending AQL packets
+    const uint32_t pool_size = index + 1 - read;
+    packet->completion_signal = Barriers().ActiveSignal(kInitSignalValueOne, timestamp_, pool_size);
+  }
+
+  // GPU publishes the target packet, so the slot keeps the invalid header until then
+  hsa_kernel_dispatch_packet_t* base =
+      reinterpret_cast<hsa_kernel_dispatch_packet_t*>(gpu_queue_->base_address);
+  hsa_kernel_dispatch_packet_t* target = &base[(index + 1) & queueMask];
+  packet->header = kInvalidAql;
+  *target = *packet;
+
+  // A launch without workgroups still must signal the completion and keep the order
+  constexpr uint16_t kTypeMask = ((1 << HSA_PACKET_HEADER_WIDTH_TYPE) - 1)
+                                 << HSA_PACKET_HEADER_TYPE;
+  const uint32_t barrierHeader =
+      (header & ~kTypeMask) | (HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE);
+  const uint64_t groupsVA = static_cast<uint64_t>(counts->virtualAddress()) +
+                            vcmd.indirectOffset();
+  const uint64_t targetVA = reinterpret_cast<uint64_t>(target);
+  const uint32_t targetHeader = header | (rest << 16);
+  const amd::KernelSignature& signature = patch->signature();
+  WriteAqlArgAt(argBuffer, &groupsVA, sizeof(groupsVA), signature.at(0).offset_);
+  WriteAqlArgAt(argBuffer, &targetVA, sizeof(targetVA), signature.at(1).offset_);
+  WriteAqlArgAt(argBuffer, &targetHeader, sizeof(targetHeader), signature.at(2).offset_);
+  WriteAqlArgAt(argBuffer, &barrierHeader, sizeof(barrierHeader), signature.at(3).offset_);
+
+  // The patch kernel waits for the previous kernels, which write the workgroup counts
+  hsa_kernel_dispatch_packet_t* aql_loc = &base[index & queueMask];
+  hsa_kernel_dispatch_packet_t patchPacket = {};
+  patchPacket.header = kInvalidAql;
+  patchPacket.grid_size_x = patchPacket.grid_size_y = patchPacket.grid_size_z = 1;
+  patchPacket.workgroup_size_x = patchPacket.workgroup_size_y = patchPacket.workgroup_size_z = 1;
+  patchPacket.kernel_object = patchKernel.KernelCodeHandle();
+  patchPacket.kernarg_address = argBuffer;
+  patchPacket.group_segment_size = patchKernel.WorkgroupGroupSegmentByteSize();
+  patchPacket.private_segment_size = patchKernel.workGroupInfo()->privateMemSize_;
+  *aql_loc = patchPacket;
+  packet_store_release(reinterpret_cast<uint32_t*>(aql_loc), dispatchPacketHeader_,
+                       (1 << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS));
+
+  ClPrint(amd::LOG_DEBUG, amd::LOG_AQL,
+          "[%zx] HWq=0x%zx, Indirect dispatch: groups=0x%zx, header=0x%x, "
+          "workgroup=[%u, %u, %u], completion_signal=0x%zx", std::this_thread::get_id(),
+          gpu_queue_, groupsVA, header, packet->workgroup_size_x, packet->workgroup_size_y,
+          packet->workgroup_size_z, packet->completion_signal.handle);
+
+  storeDoorbell(index + 1, kNumSlots);
+
+  // The release scope of the target packet is unknown until GPU publishes it
+  tailFenced_ = false;
+  tailSignal_ = hsa_signal_t{};
+  return true;
+}
+
+bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const amd::Kernel& kernel,
+  const_address parameters, void* eventHandle, uint32_t sharedMemBytes, amd::NDRangeKernelCommand* vcmd) {
+  const uint64_t enqueueStart = AMD_KERNEL_STATS ? amd::Os::timeNanos() : 0;
+  device::Kernel* devKernel = const_cast<device::Kernel*>(kernel.getDeviceKernel(dev()));
+  if ((vcmd != nullptr) && (capture_ == nullptr)) {
+    // The variant has the same arguments layout, so only the code object is replaced.
+    // The graph replay can patch the arguments, hence the recorded launches aren't specialized
+    const_address values = vcmd->directArgs() ? kernel.parameters().values() : parameters;
+    device::Kernel* variant = devKernel->specialize(kernel, values);
+    if (variant != nullptr) {
+      devKernel = variant;
+    }
+  }
+  Kernel& gpuKernel = static_cast<Kernel&>(*devKernel);
+  size_t ldsUsage = gpuKernel.WorkgroupGroupSegmentByteSize();
+  bool imageBufferWrtBack = false; // Image buffer write back is required
+  std::vector<device::Memory*> wrtBackImageBuffer; // Array of images for write back
+
+  const amd::KernelSignature& signature = kernel.signature();
+  const amd::KernelParameters& kernelParams = kernel.parameters();
+
+  // Internal kernels can split the launch and reuse the captured arguments for each submission
+  const bool directArgs = (vcmd != nullptr) && vcmd->directArgs() && !gpuKernel.isInternalKernel();
+  // The parameters layout can be bigger than the kernarg segment, hence patches must fit
+  const size_t directArgsSize =
+      std::max<size_t>(gpuKernel.KernargSegmentByteSize(), signature.paramsSize());
+  address argBuffer = nullptr;
+  if (directArgs) {
+    // Serialize the argument values straight into the kernarg memory. The objects and
+    // the hidden arguments are patched in place, so there is no intermediate copy
+    argBuffer = reinterpret_cast<address>(allocKernArg(directArgsSize,
+                                                       gpuKernel.KernargSegmentAlignment()));
+    if (argBuffer == nullptr) {
+      LogError("Out of memory");
+      return false;
+    }
+    memcpy(argBuffer, kernelParams.values(), signature.paramsSize());
+  }
+  const size_t kernargChunk = kernarg_pool_chunk_id_;
+
+  // The plain kernels skip the printf, device enqueue and the generic hidden arguments setup
+  const Kernel::LaunchPlan& plan = gpuKernel.launchPlan();
+
+  // Check memory dependency and SVM objects
+  bool coopGroups = (vcmd != nullptr) ? vcmd->cooperativeGroups() : false;
+  const uint32_t dependencyBarriers = dependencyBarriers_;
+  if (!processMemObjects(kernel, parameters, argBuffer, ldsUsage, coopGroups,
+                         imageBufferWrtBack, wrtBackImageBuffer)) {
+    LogError("Wrong memory objects!");
+    return false;
+  }
+
+  // Init PrintfDbg object if printf is enabled.
+  bool printfEnabled = (gpuKernel.printfInfo().size() > 0) ? true : false;
+  if (!plan.plain_ && !printfDbg()->init(printfEnabled)) {
+    LogError("\nPrintfDbg object initialization failed!");
+    return false;
+  }
+  // The queue constant hidden arguments are copied from the template
+  const HiddenArgs* hidden = plan.plain_ ? nullptr : findHiddenArgs(gpuKernel, coopGroups,
+                                                                    printfEnabled);
+  const bool fastHidden = plan.plain_ || (hidden != nullptr);
+
+  size_t newOffset[3] = {0, 0, 0};
+  size_t newGlobalSize[3] = {0, 0, 0};
 
   int dim = -1;
   int iteration = 1;
@@ -2637,6 +4114,10 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
     }
   }
 
+  // The launch descriptor was resolved at the capture, unless the launch is split
+  const amd::LaunchDescriptor* launch =
+      ((vcmd != nullptr) && (dim == -1) && vcmd->launch().valid()) ? &vcmd->launch() : nullptr;
+
   amd::Memory* const* memories =
       reinterpret_cast<amd::Memory* const*>(parameters + kernelParams.memoryObjOffset());
 
@@ -2653,20 +4134,41 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
 
     // Find all parameters for the current kernel
 
-    // Allocate buffer to hold kernel arguments
-    address argBuffer = (address)allocKernArg(gpuKernel.KernargSegmentByteSize(),
-                                              gpuKernel.KernargSegmentAlignment());
+    if (!directArgs) {
+      // Allocate buffer to hold kernel arguments
+      argBuffer = (address)allocKernArg(gpuKernel.KernargSegmentByteSize(),
+                                        gpuKernel.KernargSegmentAlignment());
 
-    if (argBuffer == nullptr) {
-      LogError("Out of memory");
-      return false;
+      if (argBuffer == nullptr) {
+        LogError("Out of memory");
+        return false;
+      }
     }
+    // The hidden arguments go straight into the kernarg memory on the direct serialization
+    address hiddenArgs = directArgs ? argBuffer : const_cast<address>(parameters);
 
     ClPrint(amd::LOG_INFO, amd::LOG_KERN, "[%zx]!\tShaderName : %s",
             std::this_thread::get_id(), gpuKernel.name().c_str());
 
-    // Check if runtime has to setup hidden arguments
-    for (uint32_t i = signature.numParameters(); i < signature.numParametersAll(); ++i) {
+    if (hidden != nullptr) {
+      memcpy(hiddenArgs + hidden->offset_, hidden->block_.data(), hidden->block_.size());
+      if (hidden->hostcall_) {
+        hostCoherentArgs_ = true;
+      }
+    }
+    if (fastHidden) {
+      // The Y and Z offsets are written only for the dimensions of the launch
+      for (uint i = 0; i < 3; ++i) {
+        if ((plan.globalOffset_[i] >= 0) && ((i == 0) || (i < sizes.dimensions()))) {
+          WriteAqlArgAt(hiddenArgs, &newOffset[i], sizeof(size_t), plan.globalOffset_[i]);
+        }
+      }
+    }
+
+    // Check if runtime has to setup hidden arguments. The plain and templated kernels are done
+    const uint32_t firstHidden =
+        fastHidden ? signature.numParametersAll() : signature.numParameters();
+    for (uint32_t i = firstHidden; i < signature.numParametersAll(); ++i) {
       const auto it = signature.at(i);
       size_t offset;
       switch (it.info_.oclObject_) {
@@ -2675,14 +4177,14 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
         case amd::KernelParameterDescriptor::HiddenGlobalOffsetX: {
           offset = newOffset[0];
           assert(it.size_ == sizeof(offset) && "check the sizes");
-          WriteAqlArgAt(const_cast<address>(parameters), &offset, it.size_, it.offset_);
+          WriteAqlArgAt(hiddenArgs, &offset, it.size_, it.offset_);
           break;
         }
         case amd::KernelParameterDescriptor::HiddenGlobalOffsetY: {
           if (sizes.dimensions() >= 2) {
             offset = newOffset[1];
             assert(it.size_ == sizeof(offset) && "check the sizes");
-            WriteAqlArgAt(const_cast<address>(parameters), &offset, it.size_, it.offset_);
+            WriteAqlArgAt(hiddenArgs, &offset, it.size_, it.offset_);
           }
           break;
         }
@@ -2690,7 +4192,7 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
           if (sizes.dimensions() >= 3) {
             offset = newOffset[2];
             assert(it.size_ == sizeof(offset) && "check the sizes");
-            WriteAqlArgAt(const_cast<address>(parameters), &offset, it.size_, it.offset_);
+            WriteAqlArgAt(hiddenArgs, &offset, it.size_, it.offset_);
           }
           break;
         }
@@ -2700,12 +4202,13 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
             // and printf buffer was allocated
             (bufferPtr != nullptr)) {
             assert(it.size_ == sizeof(bufferPtr) && "check the sizes");
-            WriteAqlArgAt(const_cast<address>(parameters), &bufferPtr, it.size_, it.offset_);
+            WriteAqlArgAt(hiddenArgs, &bufferPtr, it.size_, it.offset_);
           }
           break;
         }
         case amd::KernelParameterDescriptor::HiddenHostcallBuffer: {
           if (amd::IS_HIP) {
+            hostCoherentArgs_ = true;
             auto buffer = roc_device_.getOrCreateHostcallBuffer(gpu_queue_, coopGroups, cuMask_);
             if (!buffer) {
               ClPrint(amd::LOG_ERROR, amd::LOG_KERN,
@@ -2713,7 +4216,7 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
               return false;
             }
             assert(it.size_ == sizeof(buffer) && "check the sizes");
-            WriteAqlArgAt(const_cast<address>(parameters), &buffer, it.size_, it.offset_);
+            WriteAqlArgAt(hiddenArgs, &buffer, it.size_, it.offset_);
           }
           break;
         }
@@ -2726,7 +4229,7 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
             }
             vqVA = getVQVirtualAddress();
           }
-          WriteAqlArgAt(const_cast<address>(parameters), &vqVA, it.size_, it.offset_);
+          WriteAqlArgAt(hiddenArgs, &vqVA, it.size_, it.offset_);
           break;
         }
         case amd::KernelParameterDescriptor::HiddenCompletionAction: {
@@ -2739,7 +4242,7 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
 
             spVA = reinterpret_cast<uint64_t>(schedulerMem->getDeviceMemory()) + sizeof(SchedulerParam);
           }
-          WriteAqlArgAt(const_cast<address>(parameters), &spVA, it.size_, it.offset_);
+          WriteAqlArgAt(hiddenArgs, &spVA, it.size_, it.offset_);
           break;
         }
         case amd::KernelParameterDescriptor::HiddenMultiGridSync: {
@@ -2760,68 +4263,34 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
             // Update GPU address for grid sync info. Use the offset adjustment for the right location
             gridSync = reinterpret_cast<uint64_t>(syncInfo);
           }
-          WriteAqlArgAt(const_cast<address>(parameters), &gridSync, it.size_, it.offset_);
+          WriteAqlArgAt(hiddenArgs, &gridSync, it.size_, it.offset_);
           break;
         }
       }
     }
 
-    // Load all kernel arguments
-    WriteAqlArgAt(argBuffer, parameters, gpuKernel.KernargSegmentByteSize(), 0);
+    if (!directArgs) {
+      // Load all kernel arguments
+      WriteAqlArgAt(argBuffer, parameters, gpuKernel.KernargSegmentByteSize(), 0);
+    } else if ((capture_ == nullptr) && (kernargChunk != kernarg_pool_chunk_id_)) {
+      // A nested submission retired the kernarg chunk before the kernel dispatch. Move the
+      // arguments into the active chunk, so the chunk retirement tracks the current kernel
+      address newBuffer = reinterpret_cast<address>(allocKernArg(directArgsSize,
+                                                    gpuKernel.KernargSegmentAlignment()));
+      if (newBuffer == nullptr) {
+        LogError("Out of memory");
+        return false;
+      }
+      memcpy(newBuffer, argBuffer, directArgsSize);
+      argBuffer = newBuffer;
+    }
     // Note: In a case of structs the size won't match,
     // since HSAIL compiler expects a reference...
     assert(gpuKernel.KernargSegmentByteSize() <= signature.paramsSize() &&
       "A mismatch of sizes of arguments between compiler and runtime!");
 
-    // Check for group memory overflow
-    //! @todo Check should be in HSA - here we should have at most an assert
-    assert(roc_device_.info().localMemSizePerCU_ > 0);
-    if (ldsUsage > roc_device_.info().localMemSizePerCU_) {
-      LogError("No local memory available\n");
-      return false;
-    }
-
-    // Initialize the dispatch Packet
-    hsa_kernel_dispatch_packet_t dispatchPacket;
-    memset(&dispatchPacket, 0, sizeof(dispatchPacket));
-
-    dispatchPacket.header = kInvalidAql;
-    dispatchPacket.kernel_object = gpuKernel.KernelCodeHandle();
-
-   // dispatchPacket.header = aqlHeader_;
-    // dispatchPacket.setup |= sizes.dimensions() << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS;
-    dispatchPacket.grid_size_x = sizes.dimensions() > 0 ? newGlobalSize[0] : 1;
-    dispatchPacket.grid_size_y = sizes.dimensions() > 1 ? newGlobalSize[1] : 1;
-    dispatchPacket.grid_size_z = sizes.dimensions() > 2 ? newGlobalSize[2] : 1;
-
-    amd::NDRange local(sizes.local());
-    devKernel->FindLocalWorkSize(sizes.dimensions(), sizes.global(), local);
-    dispatchPacket.workgroup_size_x = sizes.dimensions() > 0 ? local[0] : 1;
-    dispatchPacket.workgroup_size_y = sizes.dimensions() > 1 ? local[1] : 1;
-    dispatchPacket.workgroup_size_z = sizes.dimensions() > 2 ? local[2] : 1;
-
-    dispatchPacket.kernarg_address = argBuffer;
-    dispatchPacket.group_segment_size = ldsUsage + sharedMemBytes;
-    dispatchPacket.private_segment_size = devKernel->workGroupInfo()->privateMemSize_;
-
-    // Pass the header accordingly
-    auto aqlHeaderWithOrder = aqlHeader_;
-    if (vcmd != nullptr && vcmd->getAnyOrderLaunchFlag()) {
-      constexpr uint32_t kAqlHeaderMask = ~(1 << HSA_PACKET_HEADER_BARRIER);
-      aqlHeaderWithOrder &= kAqlHeaderMask;
-    }
-
-    if (addSystemScope_) {
-      aqlHeaderWithOrder &= ~(HSA_FENCE_SCOPE_AGENT << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE);
-      aqlHeaderWithOrder |= (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE);
-      addSystemScope_ = false;
-    }
-
-    // Dispatch the packet
-    if (!dispatchAqlPacket(
-            &dispatchPacket, aqlHeaderWithOrder,
-            (sizes.dimensions() << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS),
-            GPU_FLUSH_ON_EXECUTION)) {
+    if (!dispatchKernelPacket(gpuKernel, sizes, newGlobalSize, launch, argBuffer, ldsUsage,
+                              sharedMemBytes, vcmd)) {
       return false;
     }
   }
@@ -2831,15 +4300,30 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
   hasPendingDispatch_ = true;
 
   // Output printf buffer
-  if (!printfDbg()->output(*this, printfEnabled, gpuKernel.printfInfo())) {
+  if (!plan.plain_ && !printfDbg()->output(*this, printfEnabled, gpuKernel.printfInfo())) {
     LogError("\nCould not print data from the printf buffer!");
     return false;
   }
 
-  if (gpuKernel.dynamicParallelism()) {
+  if (!plan.plain_ && gpuKernel.dynamicParallelism()) {
     dispatchBarrierPacket(kBarrierPacketHeader, true);
-    static_cast<KernelBlitManager&>(blitMgr()).runScheduler(
-        getVQVirtualAddress(), schedulerParam_, schedulerQueue_, schedulerSignal_, schedulerThreads_);
+    const bool asyncScheduler = dev().settings().async_scheduler_;
+    if (static_cast<KernelBlitManager&>(blitMgr()).runScheduler(
+            getVQVirtualAddress(), schedulerParam_, schedulerQueue_, schedulerSignal_,
+            schedulerThreads_, !asyncScheduler) && asyncScheduler) {
+      // The scheduler relaunches itself on the child queue until all child kernels are done.
+      // Make the next commands wait for it on GPU, so the host can keep submitting
+      hsa_amd_barrier_value_packet_t aqlPacket = {};
+      hsa_amd_vendor_packet_header_t header = {};
+      header.header = kBarrierVendorPacketHeader;
+      header.AmdFormat = HSA_AMD_PACKET_TYPE_BARRIER_VALUE;
+      aqlPacket.signal = schedulerSignal_;
+      aqlPacket.value = 0;
+      aqlPacket.mask = ~static_cast<hsa_signal_value_t>(0);
+      aqlPacket.cond = HSA_SIGNAL_CONDITION_EQ;
+      aqlPacket.completion_signal = Barriers().ActiveSignal();
+      dispatchBarrierValuePacket(&aqlPacket, header);
+    }
   }
 
   // Check if image buffer write back is required
@@ -2858,6 +4342,123 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes, const
                                                 image->getRowPitch(), image->getSlicePitch());
     }
   }
+
+  if (AMD_KERNEL_STATS) {
+    gpuKernel.addLaunch(amd::Os::timeNanos() - enqueueStart,
+                        static_cast<uint64_t>(gpuKernel.KernargSegmentByteSize()) * iteration,
+                        dependencyBarriers != dependencyBarriers_);
+  }
+  return true;
+}
+
+// ================================================================================================
+bool VirtualGPU::canSubmitBlitKernel(const amd::Kernel& kernel,
+                                     const amd::NDRangeContainer& sizes) {
+  if (!ROC_DIRECT_BLIT || (capture_ != nullptr)) {
+    return false;
+  }
+  const Kernel& gpuKernel = static_cast<const Kernel&>(*kernel.getDeviceKernel(dev()));
+  // The split launches and the hidden arguments other than the offsets need the generic path
+  if (!gpuKernel.launchPlan().plain_ ||
+      (gpuKernel.KernargSegmentByteSize() > kernel.signature().paramsSize())) {
+    return false;
+  }
+  for (uint i = 0; i < sizes.dimensions(); ++i) {
+    if (sizes.global()[i] > static_cast<size_t>(0xffffffff)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+bool VirtualGPU::submitBlitKernel(const amd::Kernel& kernel, const amd::NDRangeContainer& sizes,
+                                  const BlitArg* args, uint numArgs) {
+  Kernel& gpuKernel =
+      static_cast<Kernel&>(*const_cast<device::Kernel*>(kernel.getDeviceKernel(dev())));
+  const amd::KernelSignature& signature = kernel.signature();
+  const Kernel::LaunchPlan& plan = gpuKernel.launchPlan();
+  assert((numArgs == signature.numParameters()) && "The blit must set all arguments");
+
+  if (memoryDependency().enabled()) {
+    // AQL packets. The GPU only serialization keeps the barrier bit on each dispatch
+    setAqlHeader(serializeCommand_ ? dispatchPacketHeader_ : dispatchPacketHeaderNoSync_);
+  }
+  if (dev().oversubscription() != nullptr) {
+    // Restore the evicted buffers first, since the restore can wait for the queue
+    beginResidency();
+    for (uint i = 0; i < numArgs; ++i) {
+      if ((args[i].memory_ != nullptr) && !makeResident(args[i].memory_)) {
+        return false;
+      }
+    }
+  }
+
+  address argBuffer = reinterpret_cast<address>(
+      allocKernArg(gpuKernel.KernargSegmentByteSize(), gpuKernel.KernargSegmentAlignment()));
+  if (argBuffer == nullptr) {
+    LogError("Out of memory");
+    return false;
+  }
+  // The unused hidden arguments of the plain kernels are zeros
+  memset(argBuffer, 0, gpuKernel.KernargSegmentByteSize());
+
+  memoryDependency().newKernel();
+  Barriers().BeginRanges();
+  hostCoherentArgs_ = false;
+  for (uint i = 0; i < numArgs; ++i) {
+    const amd::KernelParameterDescriptor& desc = signature.at(i);
+    if (args[i].value_ != nullptr) {
+      WriteAqlArgAt(argBuffer, args[i].value_, std::min(args[i].size_, desc.size_),
+                    desc.offset_);
+      continue;
+    }
+    Memory* gpuMem = args[i].memory_;
+    if (gpuMem == nullptr) {
+      continue;
+    }
+    if (!amd::IS_HIP && (gpuMem->owner()->getVirtualDevice() == nullptr)) {
+      // Synchronize data with other memory instances if necessary
+      gpuMem->syncCacheFromHost(*this);
+    }
+    hostCoherentArgs_ |= gpuMem->isHostMemDirectAccess() || gpuMem->IsPersistentDirectMap();
+    const uint64_t va = static_cast<uint64_t>(gpuMem->virtualAddress()) + args[i].offset_;
+    WriteAqlArgAt(argBuffer, &va, sizeof(va), desc.offset_);
+
+    // Validate memory for a dependency in the queue
+    memoryDependency().validate(*this, gpuMem, (desc.info_.readOnly_ == 1));
+    const bool readOnly =
+#if defined(USE_COMGR_LIBRARY)
+        desc.typeQualifier_ == CL_KERNEL_ARG_TYPE_CONST ||
+#endif  // defined(USE_COMGR_LIBRARY)
+        (gpuMem->owner()->getMemFlags() & CL_MEM_READ_ONLY) != 0;
+    if (!readOnly) {
+      gpuMem->owner()->signalWrite(&dev());
+    }
+    const static bool All = true;
+    memoryDependency().clear(!All);
+  }
+
+  // The plain kernels can still read the launch offsets
+  for (uint i = 0; i < 3; ++i) {
+    if ((plan.globalOffset_[i] >= 0) && ((i == 0) || (i < sizes.dimensions()))) {
+      const size_t offset = sizes.offset()[i];
+      WriteAqlArgAt(argBuffer, &offset, sizeof(offset), plan.globalOffset_[i]);
+    }
+  }
+
+  ClPrint(amd::LOG_INFO, amd::LOG_KERN, "[%zx]!\tShaderName : %s (direct blit)",
+          std::this_thread::get_id(), gpuKernel.name().c_str());
+  size_t globalSize[3] = {0, 0, 0};
+  for (uint i = 0; i < sizes.dimensions(); ++i) {
+    globalSize[i] = sizes.global()[i];
+  }
+  if (!dispatchKernelPacket(gpuKernel, sizes, globalSize, nullptr, argBuffer,
+                            gpuKernel.WorkgroupGroupSegmentByteSize(), 0, nullptr)) {
+    return false;
+  }
+  // Mark the flag indicating if a dispatch is outstanding
+  hasPendingDispatch_ = true;
   return true;
 }
 
@@ -2884,43 +4485,71 @@ void VirtualGPU::submitKernel(amd::NDRangeKernelCommand& vcmd) {
       return;
     }
 
-    // Lock the queue, using the blit manager lock
-    amd::ScopedLock lock(queue->blitMgr().lockXfer());
-
-    queue->profilingBegin(vcmd);
-
-    // Add a dependency into the device queue on the current queue
-    queue->Barriers().AddExternalSignal(Barriers().GetLastSignal());
+    // The grids of a multi-device launch are published together, so the devices start
+    // without the launch skew
+    const bool multiGridSweep = vcmd.cooperativeMultiDeviceGroups() &&
+                                (vcmd.numGrids() > 1) && dev().settings().multi_grid_sweep_;
+    {
+      // Lock the queue, using the blit manager lock
+      amd::ScopedLock lock(queue->blitMgr().lockXfer());
+
+      queue->profilingBegin(vcmd);
+
+      // Add a dependency into the device queue on the current queue
+      queue->Barriers().AddExternalSignal(Barriers().GetLastSignal());
+
+      if (vcmd.cooperativeGroups()) {
+        // Initialize GWS if it's cooperative groups launch
+        uint32_t workgroups = 1;
+        for (uint i = 0; i < vcmd.sizes().dimensions(); i++) {
+          if (vcmd.sizes().local()[i] != 0) {
+            workgroups *= (vcmd.sizes().global()[i] / vcmd.sizes().local()[i]);
+          }
+        }
 
-    if (vcmd.cooperativeGroups()) {
-      // Initialize GWS if it's cooperative groups launch
-      uint32_t workgroups = 1;
-      for (uint i = 0; i < vcmd.sizes().dimensions(); i++) {
-        if (vcmd.sizes().local()[i] != 0) {
-          workgroups *= (vcmd.sizes().global()[i] / vcmd.sizes().local()[i]);
+        // GWS barrier returns to the initial value, when all workgroups pass it.
+        // Hence the initialization is required only for a different number of workgroups
+        if (queue->gwsInitValue_ != (workgroups - 1)) {
+          if (static_cast<KernelBlitManager&>(queue->blitMgr()).RunGwsInit(workgroups - 1)) {
+            queue->gwsInitValue_ = workgroups - 1;
+          } else {
+            queue->gwsInitValue_ = std::numeric_limits<uint32_t>::max();
+          }
         }
       }
 
-      static_cast<KernelBlitManager&>(queue->blitMgr()).RunGwsInit(workgroups - 1);
-    }
+      // Sync AQL packets
+      queue->setAqlHeader(dispatchPacketHeader_);
 
-    // Sync AQL packets
-    queue->setAqlHeader(dispatchPacketHeader_);
+      // Make sure the previous work on the coop queue doesn't wait for the sweep
+      queue->ringDoorbell();
+      queue->holdDoorbell_ = multiGridSweep;
 
-    // Submit kernel to HW
-    if (!queue->submitKernelInternal(vcmd.sizes(), vcmd.kernel(), vcmd.parameters(),
-      static_cast<void*>(as_cl(&vcmd.event())), vcmd.sharedMemBytes(), &vcmd)) {
-      LogError("AQL dispatch failed!");
-      vcmd.setStatus(CL_INVALID_OPERATION);
-    }
-    // Wait for the execution on the device queue. Keep the current queue in-order
-    queue->releaseGpuMemoryFence(kSkipCpuWait);
+      // Submit kernel to HW
+      if (!queue->submitKernelInternal(vcmd.sizes(), vcmd.kernel(), vcmd.parameters(),
+        static_cast<void*>(as_cl(&vcmd.event())), vcmd.sharedMemBytes(), &vcmd)) {
+        LogError("AQL dispatch failed!");
+        vcmd.setStatus(CL_INVALID_OPERATION);
+      }
+      // Wait for the execution on the device queue. Keep the current queue in-order.
+      // @note: releaseGpuMemoryFence() can't be used, since it rings the held doorbell
+      if (queue->hasPendingDispatch_) {
+        queue->dispatchBarrierPacket(kBarrierPacketHeader);
+        queue->hasPendingDispatch_ = false;
+      }
+      queue->holdDoorbell_ = false;
 
-    // Add a dependency into the current queue on the coop queue
-    Barriers().AddExternalSignal(queue->Barriers().GetLastSignal());
-    hasPendingDispatch_ = true;
+      // Add a dependency into the current queue on the coop queue
+      Barriers().AddExternalSignal(queue->Barriers().GetLastSignal());
+      hasPendingDispatch_ = true;
 
-    queue->profilingEnd(vcmd);
+      queue->profilingEnd(vcmd);
+    }
+
+    if (multiGridSweep) {
+      // The coop queue is unlocked, so the lock order is always the launch lock first
+      queue->publishMultiGrid(vcmd);
+    }
   } else {
     // Make sure VirtualGPU has an exclusive access to the resources
     amd::ScopedLock lock(execution());
@@ -2938,6 +4567,124 @@ void VirtualGPU::submitKernel(amd::NDRangeKernelCommand& vcmd) {
   }
 }
 
+// ================================================================================================
+void VirtualGPU::publishMultiGrid(const amd::NDRangeKernelCommand& vcmd) {
+  amd::ScopedLock lock(multiGridLock_);
+  std::vector<VirtualGPU*>& queues = multiGridQueues_[vcmd.firstDevice()];
+  queues.push_back(this);
+  if (queues.size() < vcmd.numGrids()) {
+    // @note: Any other submission on the coop queue rings the held doorbell earlier,
+    // which only loses the skew reduction. The multi-grid sync requires all grids anyway
+    return;
+  }
+
+  // All queues are armed, hence lock them first and ring the doorbells in a tight loop
+  for (auto queue : queues) {
+    queue->blitMgr().lockXfer()->lock();
+  }
+  for (auto queue : queues) {
+    queue->ringDoorbell();
+  }
+  for (auto queue : queues) {
+    queue->blitMgr().lockXfer()->unlock();
+  }
+  ClPrint(amd::LOG_DEBUG, amd::LOG_AQL, "[%zx] Multi-device launch published %zu grids",
+          std::this_thread::get_id(), queues.size());
+  multiGridQueues_.erase(vcmd.firstDevice());
+}
+
+// ================================================================================================
+device::LaunchGraph* VirtualGPU::createLaunchGraph() {
+  return new LaunchGraph(*this);
+}
+
+// ================================================================================================
+bool VirtualGPU::setCuPartition(uint32_t percent) {
+  // The pooled queues are shared between VirtualGPUs, hence only a queue with
+  // a custom CU mask is exclusive and can change the mask
+  if (cuMask_.empty() || cooperative_) {
+    LogError("CU partition requires a queue with a custom CU mask!");
+    return false;
+  }
+  std::vector<uint32_t> mask;
+  if (!roc_device_.CreateCuPartition(percent, &mask)) {
+    return false;
+  }
+
+  amd::ScopedLock lock(execution());
+  // The new mask is applied to the next dispatches on the queue
+  if (HSA_STATUS_SUCCESS !=
+      hsa_amd_queue_cu_set_mask(gpu_queue_, mask.size() * 32, mask.data())) {
+    LogError("Failed to set the CU partition mask!");
+    roc_device_.ReleaseCuPartition(mask);
+    return false;
+  }
+  if (!cuPartition_.empty()) {
+    roc_device_.ReleaseCuPartition(cuPartition_);
+  }
+  cuPartition_ = mask;
+  return true;
+}
+
+// ================================================================================================
+bool VirtualGPU::waitForCommand(amd::Command& command) {
+  // The failed commands must be reported to the waiting command on CPU
+  if ((command.queue() == nullptr) || !command.IsDispatched() || (command.status() < 0)) {
+    return false;
+  }
+  // The out of order queues submit the commands into several virtual devices
+  VirtualGPU* producer = static_cast<VirtualGPU*>((command.GetVirtualDevice() != nullptr) ?
+      command.GetVirtualDevice() : command.queue()->vdev());
+  if ((producer == nullptr) || (producer == this) ||
+      !command.queue()->device().settings().rocr_backend_) {
+    return false;
+  }
+  // The signals of a device can be waited in another device with the system scope only
+  if ((&producer->dev() != &dev()) && !dev().settings().system_scope_signal_) {
+    return false;
+  }
+
+  ProfilingSignal* signal = nullptr;
+  {
+    amd::ScopedLock lock(producer->execution());
+    // Mark all submitted work on the producer queue and make the results visible to the system
+    producer->dispatchBarrierPacket(kBarrierPacketReleaseHeader);
+    producer->hasPendingDispatch_ = false;
+    signal = producer->Barriers().GetLastSignal();
+    // HwQueueTracker will allocate a new signal on the reuse, since the reference count is bigger
+    signal->retain();
+  }
+
+  amd::ScopedLock lock(execution());
+  Barriers().AddExternalSignal(signal);
+  // Keep the signal until this queue is idle, since the barrier can wait for it any time later
+  queueDependencies_.push_back(signal);
+  ClPrint(amd::LOG_DEBUG, amd::LOG_SIG, "Queue %p waits in GPU for command %p, signal(0x%lx)",
+          this, &command, signal->signal_.handle);
+  return true;
+}
+
+// ================================================================================================
+void VirtualGPU::prepareCommand(amd::Command& command) {
+  // The device memory is allocated on the first use, which takes much longer than the packet
+  // setup. The allocation is thread safe, so it runs before the submission locks the queue
+  std::vector<amd::Memory*> objects;
+  if ((command.type() == CL_COMMAND_NDRANGE_KERNEL) || (command.type() == CL_COMMAND_TASK)) {
+    const auto& vcmd = static_cast<const amd::NDRangeKernelCommand&>(command);
+    const amd::Kernel& kernel = vcmd.kernel();
+    amd::Memory* const* memories = reinterpret_cast<amd::Memory* const*>(
+        vcmd.parameters() + kernel.parameters().memoryObjOffset());
+    objects.assign(memories, memories + kernel.signature().numMemories());
+  } else if (!command.memoryObjects(&objects)) {
+    return;
+  }
+  for (auto mem : objects) {
+    if (mem != nullptr) {
+      mem->getDeviceMemory(dev());
+    }
+  }
+}
+
 // ================================================================================================
 void VirtualGPU::submitNativeFn(amd::NativeFnCommand& cmd) {
   // std::cout<<__FUNCTION__<<" not implemented"<<"*********"<<std::endl;
@@ -2955,9 +4702,10 @@ void VirtualGPU::submitMarker(amd::Marker& vcmd) {
     } else {
       profilingBegin(vcmd);
       if (timestamp_ != nullptr) {
-        // Submit a barrier with a cache flushes.
-        dispatchBarrierPacket(kBarrierPacketHeader, false);
-
+        if (!aliasTailSignal(vcmd)) {
+          // Submit a barrier with a cache flushes.
+          dispatchBarrierPacket(kBarrierPacketHeader, false);
+        }
         hasPendingDispatch_ = false;
       }
       profilingEnd(vcmd);
@@ -2966,12 +4714,88 @@ void VirtualGPU::submitMarker(amd::Marker& vcmd) {
   }
 }
 
+// ================================================================================================
+bool VirtualGPU::waitCompletion() {
+  if (completionDoorbell_.handle == 0) {
+    return false;
+  }
+  hsa_signal_value_t target = 0;
+  {
+    // Make sure VirtualGPU has an exclusive access to the resources
+    amd::ScopedLock lock(execution());
+    // The last sync barrier covers the queue, if nothing was submitted after it
+    const bool idle = (hsa_queue_load_write_index_relaxed(gpu_queue_) == completionIndex_) &&
+        !Barriers().HasExternalSignals() &&
+        (hsa_signal_load_relaxed(Barriers().GetLastSignal()->signal_) <= 0);
+    if (!idle) {
+      // The tracked barrier joins the other engines and makes the results visible to the system
+      dispatchBarrierPacket(kBarrierPacketHeader);
+      hasPendingDispatch_ = false;
+      // ROCr decrements the doorbell, when all previous packets in the queue are done
+      constexpr bool kSkipSignal = true;
+      dispatchBarrierPacket(kBarrierPacketNoFenceHeader, kSkipSignal, completionDoorbell_);
+      --completionTarget_;
+      ringDoorbell();
+      completionIndex_ = hsa_queue_load_write_index_relaxed(gpu_queue_);
+    }
+    target = completionTarget_;
+  }
+
+  // The doorbell value only decreases, hence the threads wait for own targets in parallel
+  // and without the execution lock
+  const hsa_wait_state_t state = waitPolicy().activeWait() ? HSA_WAIT_STATE_ACTIVE
+                                                           : HSA_WAIT_STATE_BLOCKED;
+  while (hsa_signal_wait_scacquire(completionDoorbell_, HSA_SIGNAL_CONDITION_LT, target + 1,
+                                   kUnlimitedWait, state) > target) {
+  }
+  ClPrint(amd::LOG_DEBUG, amd::LOG_SIG, "Queue %p completion doorbell reached %ld", this, target);
+  return true;
+}
+
+// ================================================================================================
+bool VirtualGPU::aliasTailSignal(amd::Marker& vcmd) {
+  // The marker can complete with the tail packet only if that packet waits for all previous
+  // packets with the barrier bit and makes the results visible with the system release.
+  // The marker timestamps must be its own, if the app reads them
+  if (!ROC_MARKER_ELISION || (tailSignal_.handle == 0) || !vcmd.eventWaitList().empty() ||
+      Barriers().HasExternalSignals() || vcmd.profilingInfo().marker_ts_ ||
+      vcmd.queue()->properties().test(CL_QUEUE_PROFILING_ENABLE) ||
+      (vcmd.GetBatchHead() == nullptr) || (vcmd.Callback() != nullptr)) {
+    // @note: API callback blocks the queue with the signal value, which isn't possible
+    // after the packet was already submitted
+    return false;
+  }
+
+  ProfilingSignal* signal = Barriers().GetLastSignal();
+  if ((signal->signal_.handle != tailSignal_.handle) ||
+      (signal->engine_ != HwQueueEngine::Compute)) {
+    return false;
+  }
+
+  // The signal keeps the timestamp of the tail packet, hence the marker only tracks it
+  timestamp_->AddProfilingSignal(signal);
+  hsa_status_t result = hsa_amd_signal_async_handler(signal->signal_,
+      HSA_SIGNAL_CONDITION_LT, kInitSignalValueOne, &HsaAmdSignalHandler, timestamp_);
+  if (HSA_STATUS_SUCCESS != result) {
+    LogError("hsa_amd_signal_async_handler() failed to set the handler!");
+  } else {
+    ClPrint(amd::LOG_INFO, amd::LOG_SIG, "Marker aliases signal: handle(0x%lx), timestamp(%p)",
+            signal->signal_.handle, timestamp_);
+  }
+  // The reference of HW event prevents the signal reuse, until the marker is destroyed
+  signal->retain();
+  vcmd.SetHwEvent(signal);
+  return true;
+}
+
 // ================================================================================================
 void VirtualGPU::submitAcquireExtObjects(amd::AcquireExtObjectsCommand& vcmd) {
   // Make sure VirtualGPU has an exclusive access to the resources
   amd::ScopedLock lock(execution());
 
   profilingBegin(vcmd);
+  // The interop resources stay mapped for the memory object lifetime, hence only
+  // the caches have to be invalidated for the graphics API writes
   addSystemScope();
   profilingEnd(vcmd);
 }
@@ -2981,11 +4805,64 @@ void VirtualGPU::submitReleaseExtObjects(amd::ReleaseExtObjectsCommand& vcmd) {
   // Make sure VirtualGPU has an exclusive access to the resources
   amd::ScopedLock lock(execution());
   profilingBegin(vcmd);
+  if (hasPendingDispatch_) {
+    // Make the GPU writes visible to the graphics API without the host wait
+    dispatchBarrierPacket(kBarrierPacketReleaseHeader);
+  }
   profilingEnd(vcmd);
 }
 
+// ================================================================================================
+void VirtualGPU::submitExternalSemaphoreCmd(amd::ExternalSemaphoreCmd& cmd) {
+  // Make sure VirtualGPU has an exclusive access to the resources
+  amd::ScopedLock lock(execution());
+  profilingBegin(cmd);
+
+  ExtSemaphore* semaphore = reinterpret_cast<ExtSemaphore*>(const_cast<void*>(cmd.sem_ptr()));
+  Buffer* timeline = static_cast<Buffer*>(dev().getRocMemory(semaphore->timeline()));
+  const int64_t value = cmd.fence();
+  if (cmd.semaphoreCmd() == amd::ExternalSemaphoreCmd::COMMAND_WAIT_EXTSEMAPHORE) {
+    hsa_amd_barrier_value_packet_t aqlPacket = {};
+    hsa_amd_vendor_packet_header_t header;
+    header.header = kBarrierVendorPacketHeader;
+    header.AmdFormat = HSA_AMD_PACKET_TYPE_BARRIER_VALUE;
+    if ((value > 0) && semaphore->signalRecorded(value)) {
+      // A queue in the process signals the timeline value, hence wait for the signal memory
+      aqlPacket.signal = timeline->getSignal();
+      aqlPacket.value = value;
+    } else {
+      // The queue waits for the mirrored foreign fence, so the host thread doesn't block
+      aqlPacket.signal = semaphore->signal();
+      aqlPacket.value = semaphore->requestWait();
+    }
+    aqlPacket.mask = std::numeric_limits<uint64_t>::max();
+    aqlPacket.cond = HSA_SIGNAL_CONDITION_GTE;
+    aqlPacket.completion_signal = Barriers().ActiveSignal();
+    dispatchBarrierValuePacket(&aqlPacket, header);
+    // The graphics API wrote the resources, so the next dispatch invalidates the caches
+    addSystemScope();
+  } else {
+    // Ensure memory ordering preceding the signal
+    dispatchBarrierPacket(kBarrierPacketReleaseHeader);
+
+    // The timeline value is written by GPU, so the waiting queues don't need the host.
+    // ROCr can't signal a foreign fence, hence the graphics API relies on the implicit
+    // synchronization of the shared resources
+    amd::Coord3D origin(0);
+    amd::Coord3D size(sizeof(value));
+    if (!blitMgr().fillBuffer(*timeline, &value, sizeof(value), origin, size, true, true)) {
+      LogError("submitExternalSemaphoreCmd: Signal failed!");
+    }
+    semaphore->recordSignal(value);
+  }
+  profilingEnd(cmd);
+}
+
 // ================================================================================================
 void VirtualGPU::flush(amd::Command* list, bool wait) {
+  // The flush is the boundary, where the tuned values can change without the transfers
+  // and the waits in flight
+  updateTuning();
   // If barrier is requested, then wait for everything, otherwise
   // a per disaptch wait will occur later in updateCommandsState()
   releaseGpuMemoryFence();
@@ -2995,6 +4872,27 @@ void VirtualGPU::flush(amd::Command* list, bool wait) {
   releasePinnedMem();
 }
 
+// ================================================================================================
+void VirtualGPU::updateTuning() {
+  using device::Tuning;
+  const uint64_t generation = Tuning::generation();
+  if (generation == tuningGeneration_) {
+    return;
+  }
+  tuningGeneration_ = generation;
+  const Settings& settings = dev().settings();
+  const uint32_t devIndex = dev().index();
+  // The staging buffers were allocated at the startup, hence the size can't grow
+  const uint64_t stagingKb = Tuning::value(Tuning::StagingBufferSize, devIndex, index(), 0);
+  stagingSize_ = (stagingKb == 0) ? settings.stagedXferSize_
+                                  : std::min(settings.stagedXferSize_,
+                                             static_cast<size_t>(stagingKb * Ki));
+  stagingChunks_ = static_cast<uint>(Tuning::value(Tuning::StagingBufferChunks, devIndex,
+                                                   index(), settings.stagedXferChunks_));
+  activeWaitTimeout_ = static_cast<uint32_t>(Tuning::value(Tuning::ActiveWaitTimeout, devIndex,
+                                                           index(), ROC_ACTIVE_WAIT_TIMEOUT));
+}
+
 // ================================================================================================
 void VirtualGPU::addXferWrite(Memory& memory) {
   //! @note: ROCr backend doesn't have per resource busy tracking, hence runtime has to wait
@@ -3031,6 +4929,9 @@ void VirtualGPU::addPinnedMem(amd::Memory* mem) {
 
       // Delay destruction
       pinnedMems_.push_back(mem);
+    } else {
+      // The memory is already tracked, release the extra reference
+      mem->release();
     }
   } else {
     mem->release();
@@ -3061,55 +4962,135 @@ void VirtualGPU::submitTransferBufferFromFile(amd::TransferBufferFileCommand& cm
   // Make sure VirtualGPU has an exclusive access to the resources
   amd::ScopedLock lock(execution());
 
+  profilingBegin(cmd);
+
+  constexpr uint kNumStaging = amd::TransferBufferFileCommand::NumStagingBuffers;
   size_t copySize = cmd.size()[0];
   size_t fileOffset = cmd.fileOffset();
   Memory* mem = dev().getRocMemory(&cmd.memory());
-  uint idx = 0;
 
   assert((cmd.type() == CL_COMMAND_READ_SSG_FILE_AMD) ||
          (cmd.type() == CL_COMMAND_WRITE_SSG_FILE_AMD));
   const bool writeBuffer(cmd.type() == CL_COMMAND_READ_SSG_FILE_AMD);
 
+  // The staging buffers with a direct CPU access are mapped once and rotated, so the file
+  // access of one block overlaps with DMA of the other. Otherwise each map stalls the queue
+  Memory* staging[kNumStaging];
+  void* stagingPtr[kNumStaging] = {};
+  ProfilingSignal* stagingSignal[kNumStaging] = {};
+  bool overlap = true;
+  for (uint i = 0; i < kNumStaging; ++i) {
+    staging[i] = dev().getRocMemory(&cmd.staging(i));
+    overlap &= staging[i]->isHostMemDirectAccess() || staging[i]->IsPersistentDirectMap();
+  }
+  if (overlap) {
+    for (uint i = 0; i < kNumStaging; ++i) {
+      stagingPtr[i] = staging[i]->cpuMap(*this);
+    }
+  }
+
+  // Marks the last DMA of the staging buffer with a barrier signal
+  auto track = [this](ProfilingSignal** signal) {
+    dispatchBarrierPacket(kBarrierPacketNoFenceHeader);
+    *signal = Barriers().GetLastSignal();
+    // HwQueueTracker will allocate a new signal on the reuse, since the reference count is bigger
+    (*signal)->retain();
+  };
+  // Waits for the last DMA of the staging buffer, instead of the whole queue
+  auto wait = [this](ProfilingSignal** signal) {
+    bool result = true;
+    if (*signal != nullptr) {
+      result = WaitForSignal((*signal)->signal_, waitPolicy_);
+      (*signal)->release();
+      *signal = nullptr;
+    }
+    return result;
+  };
+
+  bool result = true;
   if (writeBuffer) {
     size_t dstOffset = cmd.origin()[0];
-    while (copySize > 0) {
-      Memory* staging = dev().getRocMemory(&cmd.staging(idx));
+    for (uint idx = 0; result && (copySize > 0); idx = (idx + 1) % kNumStaging) {
       size_t dstSize = amd::TransferBufferFileCommand::StagingBufferSize;
       dstSize = std::min(dstSize, copySize);
-      void* dstBuffer = staging->cpuMap(*this);
-      if (!cmd.file()->transferBlock(writeBuffer, dstBuffer, staging->size(), fileOffset, 0,
-                                     dstSize)) {
-        cmd.setStatus(CL_INVALID_OPERATION);
-        return;
+      // Make sure DMA doesn't read the staging buffer anymore
+      if (!wait(&stagingSignal[idx])) {
+        result = false;
+        break;
+      }
+      void* dstBuffer = overlap ? stagingPtr[idx] : staging[idx]->cpuMap(*this);
+      result = cmd.file()->transferBlock(writeBuffer, dstBuffer, staging[idx]->size(),
+                                         fileOffset, 0, dstSize);
+      if (!overlap) {
+        staging[idx]->cpuUnmap(*this);
+      }
+      if (result) {
+        result = blitMgr().copyBuffer(*staging[idx], *mem, 0, dstOffset, dstSize, false);
+        if (overlap) {
+          track(&stagingSignal[idx]);
+        }
       }
-      staging->cpuUnmap(*this);
-
-      bool result = blitMgr().copyBuffer(*staging, *mem, 0, dstOffset, dstSize, false);
       fileOffset += dstSize;
       dstOffset += dstSize;
       copySize -= dstSize;
     }
   } else {
     size_t srcOffset = cmd.origin()[0];
-    while (copySize > 0) {
-      Memory* staging = dev().getRocMemory(&cmd.staging(idx));
+    uint next = 0;
+    size_t nextOffset = srcOffset;
+    size_t nextSize = copySize;
+    // Queues DMA of the next block, so it runs while the current block is written to the file
+    auto prefetch = [&]() {
+      if ((nextSize > 0) && result) {
+        size_t size = amd::TransferBufferFileCommand::StagingBufferSize;
+        size = std::min(size, nextSize);
+        result = blitMgr().copyBuffer(*mem, *staging[next], nextOffset, 0, size, false);
+        if (overlap) {
+          track(&stagingSignal[next]);
+        }
+        next = (next + 1) % kNumStaging;
+        nextOffset += size;
+        nextSize -= size;
+      }
+    };
+    for (uint i = 0; overlap && (i < kNumStaging - 1); ++i) {
+      prefetch();
+    }
+    for (uint idx = 0; result && (copySize > 0); idx = (idx + 1) % kNumStaging) {
       size_t srcSize = amd::TransferBufferFileCommand::StagingBufferSize;
       srcSize = std::min(srcSize, copySize);
-      bool result = blitMgr().copyBuffer(*mem, *staging, srcOffset, 0, srcSize, false);
-
-      void* srcBuffer = staging->cpuMap(*this);
-      if (!cmd.file()->transferBlock(writeBuffer, srcBuffer, staging->size(), fileOffset, 0,
-                                     srcSize)) {
-        cmd.setStatus(CL_INVALID_OPERATION);
-        return;
+      prefetch();
+      // Make sure DMA finished the staging buffer update
+      if (!wait(&stagingSignal[idx])) {
+        result = false;
+        break;
+      }
+      void* srcBuffer = overlap ? stagingPtr[idx] : staging[idx]->cpuMap(*this);
+      result = cmd.file()->transferBlock(writeBuffer, srcBuffer, staging[idx]->size(),
+                                         fileOffset, 0, srcSize);
+      if (!overlap) {
+        staging[idx]->cpuUnmap(*this);
       }
-      staging->cpuUnmap(*this);
-
       fileOffset += srcSize;
       srcOffset += srcSize;
       copySize -= srcSize;
     }
   }
+
+  for (uint i = 0; i < kNumStaging; ++i) {
+    // The last blocks are tracked with the command, so just drop the references
+    if (stagingSignal[i] != nullptr) {
+      stagingSignal[i]->release();
+    }
+    if (overlap) {
+      staging[i]->cpuUnmap(*this);
+    }
+  }
+  if (!result) {
+    cmd.setStatus(CL_INVALID_OPERATION);
+  }
+
+  profilingEnd(cmd);
 }
 
 void VirtualGPU::submitPerfCounter(amd::PerfCounterCommand& vcmd) {
@@ -3119,12 +5100,36 @@ void VirtualGPU::submitPerfCounter(amd::PerfCounterCommand& vcmd) {
   const amd::PerfCounterCommand::PerfCounterList counters = vcmd.getCounters();
 
   if (vcmd.getState() == amd::PerfCounterCommand::Begin) {
-    // Create a profile for the profiling AQL packet
-    PerfCounterProfile* profileRef =  new PerfCounterProfile(roc_device_);
-    if (profileRef == nullptr || !profileRef->Create()) {
-      LogError("Failed to create performance counter profile");
-      vcmd.setStatus(CL_INVALID_OPERATION);
-      return;
+    // The tools sample the same counter set repeatedly, hence the profiles are cached
+    std::vector<uint32_t> key;
+    for (uint i = 0; i < vcmd.getNumCounters(); ++i) {
+      amd::PerfCounter::Properties prop =
+          static_cast<amd::PerfCounter*>(counters[i])->properties();
+      key.push_back(static_cast<uint32_t>(prop[CL_PERFCOUNTER_GPU_BLOCK_INDEX]));
+      key.push_back(static_cast<uint32_t>(prop[CL_PERFCOUNTER_GPU_COUNTER_INDEX]));
+      key.push_back(static_cast<uint32_t>(prop[CL_PERFCOUNTER_GPU_EVENT_INDEX]));
+    }
+
+    PerfCounterProfile* profileRef = nullptr;
+    bool reuse = false;
+    auto it = counterProfiles_.find(key);
+    if ((it != counterProfiles_.end()) && !it->second->inUse()) {
+      profileRef = it->second;
+      profileRef->retain();
+      reuse = true;
+    } else {
+      // Create a profile for the profiling AQL packet
+      profileRef = new PerfCounterProfile(roc_device_);
+      if (profileRef == nullptr || !profileRef->Create()) {
+        LogError("Failed to create performance counter profile");
+        vcmd.setStatus(CL_INVALID_OPERATION);
+        return;
+      }
+      // A nested start with the same counter set gets an uncached profile
+      if ((it == counterProfiles_.end()) && (counterProfiles_.size() < kMaxCounterProfiles)) {
+        profileRef->retain();
+        counterProfiles_[key] = profileRef;
+      }
     }
 
     // Make sure all performance counter objects to use the same profile
@@ -3150,13 +5155,19 @@ void VirtualGPU::submitPerfCounter(amd::PerfCounterCommand& vcmd) {
         counter = rocCounter;
       }
 
-      counter->setProfile(profileRef);
+      // The cached profile has the events, so only the new counter objects are attached
+      if (counter->profileRef() != profileRef) {
+        counter->setProfile(profileRef, !reuse);
+      }
     }
 
     if (!profileRef->initialize()) {
       LogError("Failed to initialize performance counter");
       vcmd.setStatus(CL_INVALID_OPERATION);
     }
+    // The blocking stop waits for the completion signal, so it must be armed again
+    profileRef->reset();
+    profileRef->setInUse(true);
 
     // create the AQL packet for start profiling
     if (profileRef->createStartPacket() == nullptr) {
@@ -3182,6 +5193,7 @@ void VirtualGPU::submitPerfCounter(amd::PerfCounterCommand& vcmd) {
     }
     dispatchCounterAqlPacket(profileRef->postPacket(), counter->gfxVersion(), true,
                              profileRef->api());
+    profileRef->setInUse(false);
   } else {
     LogError("Unsupported performance counter state");
     vcmd.setStatus(CL_INVALID_OPERATION);
@@ -3189,4 +5201,60 @@ void VirtualGPU::submitPerfCounter(amd::PerfCounterCommand& vcmd) {
 
 }
 
+// ================================================================================================
+void VirtualGPU::submitThreadTraceMemObjects(amd::ThreadTraceMemObjectsCommand& cmd) {
+  // Make sure VirtualGPU has an exclusive access to the resources
+  amd::ScopedLock lock(execution());
+
+  profilingBegin(cmd);
+
+  amd::ThreadTrace* amdThreadTrace = &cmd.getThreadTrace();
+  if (amdThreadTrace->getDeviceThreadTrace() == nullptr) {
+    ThreadTrace* rocThreadTrace = new ThreadTrace(*this, cmd.getMemList(),
+                                                  amdThreadTrace->deviceSeNumThreadTrace());
+    if ((rocThreadTrace == nullptr) || !rocThreadTrace->create()) {
+      LogError("Failed to create the thread trace");
+      delete rocThreadTrace;
+      cmd.setStatus(CL_INVALID_OPERATION);
+    } else {
+      amdThreadTrace->setDeviceThreadTrace(rocThreadTrace);
+    }
+  }
+
+  profilingEnd(cmd);
+}
+
+// ================================================================================================
+void VirtualGPU::submitThreadTrace(amd::ThreadTraceCommand& cmd) {
+  // Make sure VirtualGPU has an exclusive access to the resources
+  amd::ScopedLock lock(execution());
+
+  profilingBegin(cmd);
+
+  // The device thread trace is created by ThreadTraceMemObjectsCommand
+  ThreadTrace* threadTrace =
+      static_cast<ThreadTrace*>(cmd.getThreadTrace().getDeviceThreadTrace());
+  if (threadTrace == nullptr) {
+    LogError("The thread trace doesn't have the memory objects");
+    cmd.setStatus(CL_INVALID_OPERATION);
+  } else if (cmd.getState() == amd::ThreadTraceCommand::Begin) {
+    if (!threadTrace->begin(
+            static_cast<amd::ThreadTrace::ThreadTraceConfig*>(cmd.threadTraceConfig()))) {
+      cmd.setStatus(CL_INVALID_OPERATION);
+    } else if (threadTrace->streaming()) {
+      threadTrace_ = threadTrace;
+    }
+  } else if (cmd.getState() == amd::ThreadTraceCommand::End) {
+    if (threadTrace_ == threadTrace) {
+      threadTrace_ = nullptr;
+    }
+    if (!threadTrace->end()) {
+      cmd.setStatus(CL_INVALID_OPERATION);
+    }
+  }
+  // There's no Pause and Resume in the aqlprofile interface
+
+  profilingEnd(cmd);
+}
+
 }  // End of roc namespace
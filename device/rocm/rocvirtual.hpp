@@ -24,18 +24,26 @@
 #include "rocdefs.hpp"
 #include "rocdevice.hpp"
 #include "utils/util.hpp"
+#include "utils/timeline.hpp"
 #include "hsa.h"
 #include "hsa_ext_image.h"
 #include "hsa_ext_amd.h"
 #include "rocprintf.hpp"
 #include "hsa_ven_amd_aqlprofile.h"
 #include "rocsched.hpp"
+#include "device/devmemdependency.hpp"
+
+#include <unordered_map>
 
 namespace roc {
 class Device;
 class Memory;
 struct ProfilingSignal;
 class Timestamp;
+class LaunchGraph;
+class PerfCounterProfile;
+class PerfCounterSampler;
+class ThreadTrace;
 
 // Initial HSA signal value
 constexpr static hsa_signal_value_t kInitSignalValueOne = 1;
@@ -45,13 +53,16 @@ constexpr static uint64_t kTimeout100us = 100 * K;
 constexpr static uint64_t kUnlimitedWait = std::numeric_limits<uint64_t>::max();
 
 template <bool active_wait_timeout = false>
-inline bool WaitForSignal(hsa_signal_t signal, bool active_wait = false) {
+inline bool WaitForSignal(hsa_signal_t signal, bool active_wait = false,
+                          uint32_t active_wait_timeout_us = ROC_ACTIVE_WAIT_TIMEOUT) {
   if (hsa_signal_load_relaxed(signal) > 0) {
+    const uint64_t start = AMD_METRICS ? amd::Os::timeNanos() : 0;
+    amd::TimelineScope waitScope(amd::Timeline::kWait, "signal wait", signal.handle);
     uint64_t timeout = kTimeout100us;
     if (active_wait) {
       timeout = kUnlimitedWait;
     } else if (active_wait_timeout) {
-      timeout = ROC_ACTIVE_WAIT_TIMEOUT * K;
+      timeout = active_wait_timeout_us * K;
       if (timeout == 0) {
         return false;
       }
@@ -75,17 +86,123 @@ inline bool WaitForSignal(hsa_signal_t signal, bool active_wait = false) {
         return false;
       }
     }
+    if (AMD_METRICS) {
+      device::MetricsRegistry::process().addWait(amd::Os::timeNanos() - start);
+    }
   }
 
   return true;
 }
 
+// Spin time limits of the hybrid wait
+constexpr static uint64_t kMinSpinWait = 2 * K;
+constexpr static uint64_t kMaxSpinWait = 1000 * K;
+
+//! Host wait strategy for the signals of a queue
+class WaitPolicy {
+ public:
+  enum Mode : uint32_t {
+    Default = 0,    //!< Active wait with ROC_ACTIVE_WAIT, otherwise a short spin and interrupt
+    Spin = 1,       //!< Busy wait until the completion
+    SpinYield = 2,  //!< Busy wait, which yields the CPU between the polls
+    Hybrid = 3      //!< Spin with an adaptive budget, then interrupt wait
+  };
+
+  WaitPolicy(Mode mode, const amd::Device& device)
+    : mode_(mode), device_(device), avgWait_(0), spinBudget_(kTimeout100us) {}
+
+  Mode mode() const { return mode_; }
+  void setMode(Mode mode) { mode_ = mode; }
+
+  //! Returns TRUE if the device forces the active wait
+  bool activeWait() const { return device_.ActiveWait(); }
+
+  //! Returns the spin time (ns) of the hybrid wait
+  uint64_t spinBudget() const { return spinBudget_.load(std::memory_order_relaxed); }
+
+  //! Adapts the spin time to the recent wait time (ns) of the completions
+  void update(uint64_t waitTime) {
+    // Exponential moving average with the weight 1/8 for the last sample
+    uint64_t avg = avgWait_.load(std::memory_order_relaxed);
+    avg = (avg == 0) ? waitTime : (avg * 7 + waitTime) / 8;
+    avgWait_.store(avg, std::memory_order_relaxed);
+    // Spin long enough to catch the typical completion. The long waits go to the interrupt
+    // right away, because the spin would only burn CPU
+    const uint64_t budget = (avg > kMaxSpinWait) ? kMinSpinWait :
+                            std::min(std::max(2 * avg, kMinSpinWait), kMaxSpinWait);
+    spinBudget_.store(budget, std::memory_order_relaxed);
+  }
+
+ private:
+  Mode mode_;                         //!< Current wait strategy
+  const amd::Device& device_;         //!< The device with the active wait setting
+  std::atomic<uint64_t> avgWait_;     //!< Average wait time (ns) of the completions
+  std::atomic<uint64_t> spinBudget_;  //!< The spin time (ns) of the hybrid wait
+};
+
+//! Waits for the signal with the strategy of the queue
+inline bool WaitForSignal(hsa_signal_t signal, WaitPolicy& policy) {
+  if (hsa_signal_load_relaxed(signal) <= 0) {
+    return true;
+  }
+  switch (policy.mode()) {
+    case WaitPolicy::Spin:
+      return WaitForSignal(signal, true);
+    case WaitPolicy::SpinYield: {
+      const uint64_t start = AMD_METRICS ? amd::Os::timeNanos() : 0;
+      while (hsa_signal_load_scacquire(signal) > 0) {
+        amd::Os::yield();
+      }
+      if (AMD_METRICS) {
+        device::MetricsRegistry::process().addWait(amd::Os::timeNanos() - start);
+      }
+      return true;
+    }
+    case WaitPolicy::Hybrid: {
+      const uint64_t start = amd::Os::timeNanos();
+      if (hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, kInitSignalValueOne,
+                                    policy.spinBudget(), HSA_WAIT_STATE_ACTIVE) != 0) {
+        ClPrint(amd::LOG_INFO, amd::LOG_SIG, "Host blocked wait for Signal = (0x%lx)",
+                signal.handle);
+        if (hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, kInitSignalValueOne,
+                                      kUnlimitedWait, HSA_WAIT_STATE_BLOCKED) != 0) {
+          return false;
+        }
+      }
+      const uint64_t waitTime = amd::Os::timeNanos() - start;
+      policy.update(waitTime);
+      if (AMD_METRICS) {
+        device::MetricsRegistry::process().addWait(waitTime);
+      }
+      return true;
+    }
+    default:
+      return WaitForSignal(signal, policy.activeWait());
+  }
+}
+
 // Timestamp for keeping track of some profiling information for various commands
 // including EnqueueNDRangeKernel and clEnqueueCopyBuffer.
 class Timestamp : public amd::ReferenceCountedObject {
  private:
   static double ticksToTime_;
 
+  //! Linear mapping of the system ticks into the host time, which follows the clock drift
+  struct Calibration {
+    uint64_t ticks_;  //!< System ticks of the calibration point
+    uint64_t host_;   //!< Host time of the calibration point in ns
+    double slope_;    //!< Host ns per system tick, measured since the previous point
+  };
+
+  //! The readers use the published mapping, while the next one is updated in the other slot
+  static Calibration calibrations_[2];
+  static std::atomic<uint32_t> calibrationId_;    //!< The published calibration slot
+  static std::atomic<uint64_t> nextCalibration_;  //!< Host time of the next calibration
+  static amd::Monitor calibrationLock_;           //!< Serializes the calibration updates
+
+  //! Converts the system ticks into the host time with the drift correction
+  static uint64_t ticksToHostTime(uint64_t ticks);
+
   uint64_t    start_;
   uint64_t    end_;
   VirtualGPU* gpu_;               //!< Virtual GPU, associated with this timestamp
@@ -120,6 +237,13 @@ class Timestamp : public amd::ReferenceCountedObject {
     return end_;
   }
 
+  //! Resolves the GPU execution time once and returns both start and end values
+  void getTime(uint64_t* start, uint64_t* end) {
+    checkGpuTime();
+    *start = start_;
+    *end = end_;
+  }
+
   void AddProfilingSignal(ProfilingSignal* signal) { signals_.push_back(signal); }
 
   const std::vector<ProfilingSignal*>& Signals() const { return signals_; }
@@ -145,6 +269,9 @@ class Timestamp : public amd::ReferenceCountedObject {
   static void setGpuTicksToTime(double ticksToTime) { ticksToTime_ = ticksToTime; }
   static double getGpuTicksToTime() { return ticksToTime_; }
 
+  //! Samples the system and the host clocks and updates the drift correction
+  static void calibrate();
+
   //! Returns amd::command assigned to this timestamp
   amd::Command& command() const { return command_; }
 
@@ -168,40 +295,10 @@ class Timestamp : public amd::ReferenceCountedObject {
 
 class VirtualGPU : public device::VirtualDevice {
  public:
-  class MemoryDependency : public amd::EmbeddedObject {
+  class MemoryDependency : public device::MemoryDependency {
    public:
-    //! Default constructor
-    MemoryDependency()
-        : memObjectsInQueue_(nullptr), numMemObjectsInQueue_(0), maxMemObjectsInQueue_(0) {}
-
-    ~MemoryDependency() { delete[] memObjectsInQueue_; }
-
-    //! Creates memory dependecy structure
-    bool create(size_t numMemObj);
-
-    //! Notify the tracker about new kernel
-    void newKernel() { endMemObjectsInQueue_ = numMemObjectsInQueue_; }
-
     //! Validates memory object on dependency
     void validate(VirtualGPU& gpu, const Memory* memory, bool readOnly);
-
-    //! Clear memory dependency
-    void clear(bool all = true);
-
-    //! Max number of mem objects in the queue
-    size_t maxMemObjectsInQueue() const { return maxMemObjectsInQueue_; }
-
-   private:
-    struct MemoryState {
-      uint64_t start_;  //! Busy memory start address
-      uint64_t end_;    //! Busy memory end address
-      bool readOnly_;   //! Current GPU state in the queue
-    };
-
-    MemoryState* memObjectsInQueue_;  //!< Memory object state in the queue
-    size_t endMemObjectsInQueue_;     //!< End of mem objects in the queue
-    size_t numMemObjectsInQueue_;     //!< Number of mem objects in the queue
-    size_t maxMemObjectsInQueue_;     //!< Maximum number of mem objects in the queue
   };
 
   class HwQueueTracker : public amd::EmbeddedObject {
@@ -218,18 +315,39 @@ class VirtualGPU : public device::VirtualDevice {
                               Timestamp* ts = nullptr, uint32_t queue_size = 0);
 
     //! Wait for the curent active signal. Can idle the queue
-    bool WaitCurrent() {
-      ProfilingSignal* signal = signal_list_[current_id_];
-      return CpuWaitForSignal(signal);
+    bool WaitCurrent();
+
+    //! Update current active engine. The memory of the operations without
+    //! the waiting signal request is unknown for the cross engine tracking
+    void SetActiveEngine(HwQueueEngine engine = HwQueueEngine::Compute) {
+      engine_ = engine;
+      if (engine < HwQueueEngine::Unknown) {
+        pending_[engine].unknown_ = true;
+      }
     }
-
-    //! Update current active engine
-    void SetActiveEngine(HwQueueEngine engine = HwQueueEngine::Compute) { engine_ = engine; }
     HwQueueEngine GetActiveEngine() const { return engine_; }
 
     //! Returns the last submitted signal for a wait
     std::vector<hsa_signal_t>& WaitingSignal(HwQueueEngine engine = HwQueueEngine::Compute);
 
+    //! Starts the collection of the memory ranges, accessed by the next operation.
+    //! The operations without the collected ranges wait for all engines
+    void BeginRanges() {
+      op_ranges_.clear();
+      op_collecting_ = gpu_.dev().settings().engineRangeDeps_;
+      op_unknown_ = false;
+    }
+
+    //! Adds the memory range, accessed by the next operation
+    void AddRange(uint64_t start, uint64_t end, bool readOnly) {
+      if (op_collecting_) {
+        op_ranges_.push_back({start, end, readOnly});
+      }
+    }
+
+    //! The next operation can access the memory outside of the collected ranges
+    void AddUnknownRange() { op_unknown_ = true; }
+
     //! Resets current signal back to the previous one. It's necessary in a case of ROCr failure.
     void ResetCurrentSignal();
 
@@ -242,7 +360,27 @@ class VirtualGPU : public device::VirtualDevice {
     //! Get the last active signal on the queue
     ProfilingSignal* GetLastSignal() const { return signal_list_[current_id_]; }
 
+    //! Returns the idle signals over the initial pool size back into the device pool
+    void Trim();
+
+    //! Returns TRUE if the signals of the other queues still have to be joined
+    bool HasExternalSignals() const { return !external_signals_.empty(); }
+
   private:
+    //! The initial size of the pool. The pool grows on demand up to the AQL queue size
+    static constexpr size_t kSignalListSize = 32;
+
+    //! Creates a new signal with HSA signal from the device pool
+    ProfilingSignal* CreateSignal();
+
+    //! Releases the signal and returns the idle HSA signal into the device pool
+    void RecycleSignal(ProfilingSignal* signal);
+
+    //! Returns TRUE if GPU didn't complete the operation on the signal in the slot
+    bool IsBusy(size_t slot) const {
+      return hsa_signal_load_relaxed(signal_list_[slot]->signal_) > 0;
+    }
+
     //! Wait for the next active signal
     void WaitNext() {
       size_t next = (current_id_ + 1) % signal_list_.size();
@@ -253,6 +391,37 @@ class VirtualGPU : public device::VirtualDevice {
     //! Wait for the provided signal
     bool CpuWaitForSignal(ProfilingSignal* signal);
 
+    //! Adds the signal into the waiting list, unless it's already completed
+    void AddWait(ProfilingSignal* signal);
+
+    //! The memory of the operations on one engine, which the other engines didn't wait for
+    struct EngineRanges {
+      device::MemoryDependency::RangeSet read_;   //!< Read-only ranges
+      device::MemoryDependency::RangeSet write_;  //!< Written ranges
+      bool unknown_ = false;              //!< The operations accessed the unknown memory
+      ProfilingSignal* signal_ = nullptr; //!< The last operation before the engine switch
+    };
+
+    //! The memory range of the next operation
+    struct OpRange {
+      uint64_t start_;  //!< Start address of the range
+      uint64_t end_;    //!< End address of the range
+      bool readOnly_;   //!< The operation only reads the range
+    };
+
+    //! Resolves the waits of the operation with the collected ranges on the engine switch.
+    //! Returns TRUE if the operation has to wait for the last signal on the queue
+    bool RangeWait(HwQueueEngine engine, bool ranges);
+
+    //! Returns TRUE if the collected ranges conflict with the pending ranges of the engine
+    bool HasHazard(const EngineRanges& pending) const;
+
+    //! Tracks the memory of the operation on the engine
+    void AddPending(HwQueueEngine engine, bool ranges);
+
+    //! Removes the pending ranges of the engine
+    void ClearPending(EngineRanges* pending);
+
     HwQueueEngine engine_ = HwQueueEngine::Unknown; //!< Engine used in the current operations
     std::vector<ProfilingSignal*> signal_list_;     //!< The pool of all signals for processing
     size_t current_id_ = 0;       //!< Last submitted signal
@@ -260,6 +429,10 @@ class VirtualGPU : public device::VirtualDevice {
     const VirtualGPU& gpu_;       //!< VirtualGPU, associated with this tracker
     std::vector<ProfilingSignal*> external_signals_;  //!< External signals for a wait in this queue
     std::vector<hsa_signal_t> waiting_signals_;   //!< Current waiting signals in this queue
+    EngineRanges pending_[HwQueueEngine::Unknown];  //!< Pending memory of each engine
+    std::vector<OpRange> op_ranges_;  //!< The memory ranges of the next operation
+    bool op_collecting_ = false;      //!< The ranges of the next operation are collected
+    bool op_unknown_ = false;         //!< The next operation can access the unknown memory
   };
 
   VirtualGPU(Device& device, bool profiling = false, bool cooperative = false,
@@ -273,11 +446,15 @@ class VirtualGPU : public device::VirtualDevice {
   void profilingBegin(amd::Command& command, bool drmProfiling = false);
   void profilingEnd(amd::Command& command);
 
+  //! Adds a GPU wait for the event without HSA signal, which is signaled from the host
+  bool addHostEventSignal(amd::Command& command, amd::Event& event);
+
   void updateCommandsState(amd::Command* list) const;
 
   void submitReadMemory(amd::ReadMemoryCommand& cmd);
   void submitWriteMemory(amd::WriteMemoryCommand& cmd);
   void submitCopyMemory(amd::CopyMemoryCommand& cmd);
+  void submitBatchCopyMemory(amd::BatchCopyMemoryCommand& cmd);
   void submitCopyMemoryP2P(amd::CopyMemoryP2PCommand& cmd);
   void submitMapMemory(amd::MapMemoryCommand& cmd);
   void submitUnmapMemory(amd::UnmapMemoryCommand& cmd);
@@ -289,6 +466,15 @@ class VirtualGPU : public device::VirtualDevice {
                             uint32_t sharedMemBytes = 0, //!< Shared memory size
                             amd::NDRangeKernelCommand* vcmd = nullptr //!< Original launch command
                             );
+  //! Returns TRUE if the internal blit can skip the kernel parameters
+  bool canSubmitBlitKernel(const amd::Kernel& kernel, const amd::NDRangeContainer& sizes);
+  //! Launches an internal blit without the kernel parameters. The arguments are written
+  //! straight into the kernarg memory and the buffers are tracked for the dependencies
+  bool submitBlitKernel(const amd::Kernel& kernel,           //!< Blit kernel for execution
+                        const amd::NDRangeContainer& sizes,  //!< Workload sizes
+                        const BlitArg* args,                 //!< The explicit arguments
+                        uint numArgs                         //!< The number of the arguments
+                        );
   void submitNativeFn(amd::NativeFnCommand& cmd);
   void submitMarker(amd::Marker& cmd);
 
@@ -299,6 +485,7 @@ class VirtualGPU : public device::VirtualDevice {
   void flush(amd::Command* list = nullptr, bool wait = false);
   void submitFillMemory(amd::FillMemoryCommand& cmd);
   void submitStreamOperation(amd::StreamOperationCommand& cmd);
+  void submitBatchStreamOperation(amd::BatchStreamOperationCommand& cmd);
   void submitMigrateMemObjects(amd::MigrateMemObjectsCommand& cmd);
 
   void submitSvmFreeMemory(amd::SvmFreeMemoryCommand& cmd);
@@ -318,10 +505,10 @@ class VirtualGPU : public device::VirtualDevice {
 
   virtual void submitTransferBufferFromFile(amd::TransferBufferFileCommand& cmd);
 
-  void submitThreadTraceMemObjects(amd::ThreadTraceMemObjectsCommand& cmd) {}
-  void submitThreadTrace(amd::ThreadTraceCommand& vcmd) {}
+  void submitThreadTraceMemObjects(amd::ThreadTraceMemObjectsCommand& cmd);
+  void submitThreadTrace(amd::ThreadTraceCommand& vcmd);
 
-  virtual void submitExternalSemaphoreCmd(amd::ExternalSemaphoreCmd& cmd){}
+  virtual void submitExternalSemaphoreCmd(amd::ExternalSemaphoreCmd& cmd);
   /**
    * @brief Waits on an outstanding kernel without regard to how
    * it was dispatched - with or without a signal
@@ -342,6 +529,7 @@ class VirtualGPU : public device::VirtualDevice {
   //! Detects memory dependency for HSAIL kernels and uses appropriate AQL header
   bool processMemObjects(const amd::Kernel& kernel,  //!< AMD kernel object for execution
                          const_address params,       //!< Pointer to the param's store
+                         address argBuffer,          //!< Kernarg memory for direct arguments
                          size_t& ldsAddress,         //!< LDS usage
                          bool cooperativeGroups,     //!< Dispatch with cooperative groups
                          bool& imageBufferWrtBack,   //!< Image buffer write back is required
@@ -351,6 +539,33 @@ class VirtualGPU : public device::VirtualDevice {
   //! Adds a stage write buffer into a list
   void addXferWrite(Memory& memory);
 
+  //! The hidden arguments of a kernel, which are constant on the queue
+  struct HiddenArgs {
+    std::vector<uint8_t> block_;  //!< The values of the hidden arguments
+    size_t offset_;               //!< The offset of the block in the kernel arguments
+    address printfBuffer_;        //!< The printf buffer, used for the block
+    bool coopGroups_;             //!< The block was built for the cooperative groups
+    bool hostcall_;               //!< The block has the hostcall buffer
+  };
+
+  //! Returns the hidden arguments template of the kernel or nullptr if the kernel
+  //! requires the setup on each launch
+  const HiddenArgs* findHiddenArgs(const Kernel& kernel, bool coopGroups, bool printfEnabled);
+
+  //! Builds the dispatch packet of the kernel with the prepared arguments and sends it
+  bool dispatchKernelPacket(Kernel& gpuKernel, const amd::NDRangeContainer& sizes,
+                            const size_t* globalSize, const amd::LaunchDescriptor* launch,
+                            address argBuffer, size_t ldsUsage, uint32_t sharedMemBytes,
+                            amd::NDRangeKernelCommand* vcmd);
+
+  //! Reserves the slots for the indirect launch and sends the patch kernel, which writes
+  //! the workgroup counts into the reserved packet and publishes it
+  bool dispatchIndirectPacket(hsa_kernel_dispatch_packet_t* packet, uint16_t header,
+                              uint16_t rest, const amd::NDRangeKernelCommand& vcmd);
+
+  //! Returns the local cache of the staging buffers for read or write transfers
+  Device::XferBuffers::LocalCache& xferCache(bool write) { return xferCache_[write ? 1 : 0]; }
+
   //! Releases stage write buffers
   void releaseXferWrite();
 
@@ -367,20 +582,107 @@ class VirtualGPU : public device::VirtualDevice {
 
   void hasPendingDispatch() { hasPendingDispatch_ = true; }
   void addSystemScope() { addSystemScope_ = true; }
+
+  //! Starts a new command for the last use tracking of the oversubscribed memory
+  void beginResidency();
+
+  //! Restores the evicted memory before the access and marks the last use by the queue.
+  //! Returns FALSE if the memory couldn't be restored
+  bool makeResident(const device::Memory* memory);
+
+  //! Returns the epoch of the current command for the oversubscribed memory
+  uint64_t residencyEpoch() const { return residencyEpoch_; }
+
+  //! Defers the HDP flush of the CPU writes into the device memory until the next GPU
+  //! operation, so a few writes share one flush. Returns FALSE if the flush isn't available
+  bool addHdpFlush();
+
+  //! Flushes HDP before the GPU operation, if CPU wrote the device memory
+  void flushHdp() {
+    if (hdpFlushPending_) {
+      submitHdpFlush();
+    }
+  }
   void SetCopyCommandType(cl_command_type type) { copy_command_type_ = type; }
 
   HwQueueTracker& Barriers() { return barriers_; }
 
+  //! Returns the priority of the queue
+  amd::CommandQueue::Priority priority() const { return priority_; }
+
+  //! Returns the host wait strategy of the queue
+  WaitPolicy& waitPolicy() { return waitPolicy_; }
+
+  //! Returns the staging size of the transfers, tuned at the flush boundary
+  size_t stagingSize() const { return stagingSize_; }
+
+  //! Returns the number of the pipelined staging chunks, tuned at the flush boundary
+  uint stagingChunks() const { return stagingChunks_; }
+
+  //! Returns the active wait timeout in us before the GPU wait, tuned at the flush boundary
+  uint32_t activeWaitTimeout() const { return activeWaitTimeout_; }
+
+  //! Waits for the signal and reports a hang, if the queue didn't progress within
+  //! ROC_HANG_TIMEOUT. Returns FALSE if the wait failed or the hung queue was aborted
+  bool waitWithHangCheck(hsa_signal_t signal);
+
+  //! Prints the AQL ring indices, the last dispatches and the memory dependency state
+  void dumpHangState(hsa_signal_t signal);
+
+  //! Dispatches a marker without cache operations, which tracks all previous work on the queue.
+  //! Returns the marker signal with an extra reference for the caller
+  ProfilingSignal* retainMarkerSignal();
+
+  //! Submits an asynchronous copy, which waits for the signals, and returns its signal
+  bool asyncCopy(address dst, hsa_agent_t dstAgent, const_address src, hsa_agent_t srcAgent,
+                 size_t size, const std::vector<hsa_signal_t>& deps, ProfilingSignal** done);
+
+  //! Stripes the copy between the SDMA engine and the blit kernels of the device. The stripes
+  //! are joined on the queue, so the command completion tracks the whole copy
+  bool stripedCopy(address dst, hsa_agent_t dstAgent, const_address src, hsa_agent_t srcAgent,
+                   size_t size, const std::vector<hsa_signal_t>& deps);
+
+  //! Runs the host copy or fill of the size on the helper thread. The operation is tracked
+  //! as a separate engine, so the next operations of the queue wait for it. Returns FALSE if
+  //! the caller must run the operation synchronously
+  bool submitHostOp(size_t size, std::function<void()>&& op);
+
   Timestamp* timestamp() const { return timestamp_; }
 
   void profilerAttach(bool enable = false) { profilerAttached_ = enable; }
 
+  //! Creates a graph for the recording of kernel launches on the queue
+  device::LaunchGraph* createLaunchGraph() override;
+
+  bool setCuPartition(uint32_t percent) override;
+
+  bool waitForCommand(amd::Command& command) override;
+
+  //! Waits for the queue on the completion doorbell, which ROCr decrements after
+  //! all previous packets
+  bool waitCompletion() override;
+
+  void prepareCommand(amd::Command& command) override;
+
   bool isProfilerAttached() const { return profilerAttached_; }
+
+  //! Kernel arguments pool statistics
+  struct KernArgPoolStats {
+    uint64_t wraps_ = 0;    //!< The number of times the allocation wrapped to the first chunk
+    uint64_t stalls_ = 0;   //!< The number of CPU waits for a busy chunk
+    uint64_t growths_ = 0;  //!< The number of extra pool segments allocations
+  };
+
+  //! Returns kernel arguments pool statistics
+  const KernArgPoolStats& kernArgPoolStats() const { return kernarg_pool_stats_; }
   // } roc OpenCL integration
  private:
   //! Dispatches a barrier with blocking HSA signals
   void dispatchBlockingWait();
 
+  //! Writes the HDP flush register for the pending CPU writes
+  void submitHdpFlush();
+
   bool dispatchAqlPacket(hsa_kernel_dispatch_packet_t* packet, uint16_t header,
                          uint16_t rest, bool blocking = true);
   bool dispatchAqlPacket(hsa_barrier_and_packet_t* packet, uint16_t header,
@@ -388,11 +690,48 @@ class VirtualGPU : public device::VirtualDevice {
   template <typename AqlPacket> bool dispatchGenericAqlPacket(AqlPacket* packet, uint16_t header,
                                                               uint16_t rest, bool blocking,
                                                               size_t size = 1);
-  void dispatchBarrierPacket(uint16_t packetHeader, bool skipSignal = false);
+  //! Dispatches a barrier packet. The packet without the tracked signal can still complete
+  //! an external signal
+  void dispatchBarrierPacket(uint16_t packetHeader, bool skipSignal = false,
+                             hsa_signal_t completion = hsa_signal_t{});
+  //! Completes the marker with the signal of the tail packet instead of a barrier packet.
+  //! Returns FALSE if the marker requires a barrier
+  bool aliasTailSignal(amd::Marker& vcmd);
+  //! Rings the doorbell for the deferred AQL packets
+  void ringDoorbell() {
+    if (deferredPackets_ != 0) {
+      hsa_signal_store_screlease(gpu_queue_->doorbell_signal, deferredDoorbell_);
+      deferredPackets_ = 0;
+      if (amd::Timeline::enabled()) {
+        amd::Timeline::instant(amd::Timeline::kDoorbell, "doorbell", deferredDoorbell_);
+      }
+    }
+  }
+  //! Sends the packets up to the index to the doorbell, unless the doorbell is held
+  void storeDoorbell(uint64_t index, uint32_t count) {
+    if (holdDoorbell_) {
+      deferredDoorbell_ = index;
+      deferredPackets_ += count;
+    } else {
+      hsa_signal_store_screlease(gpu_queue_->doorbell_signal, index);
+      deferredPackets_ = 0;
+      if (amd::Timeline::enabled()) {
+        amd::Timeline::instant(amd::Timeline::kDoorbell, "doorbell", index);
+      }
+    }
+  }
+  //! Publishes the held packets of a multi-device launch. The doorbells of all queues
+  //! in the launch are rung together, when the last grid arrives
+  void publishMultiGrid(const amd::NDRangeKernelCommand& vcmd);
   bool dispatchCounterAqlPacket(hsa_ext_amd_aql_pm4_packet_t* packet, const uint32_t gfxVersion,
                                 bool blocking, const hsa_ven_amd_aqlprofile_1_00_pfn_t* extApi);
+  //! Dispatches the barrier value packets. Only the last packet of a command
+  //! requires a completion signal
   void dispatchBarrierValuePacket(const hsa_amd_barrier_value_packet_t* packet,
-                                  hsa_amd_vendor_packet_header_t header);
+                                  hsa_amd_vendor_packet_header_t header, uint32_t count = 1);
+  //! Encodes a stream wait condition into the barrier value packet
+  static void setStreamWaitCondition(hsa_amd_barrier_value_packet_t* packet, int64_t value,
+                                     uint64_t mask, unsigned int flags);
   void initializeDispatchPacket(hsa_kernel_dispatch_packet_t* packet,
                                 amd::NDRangeContainer& sizes);
 
@@ -400,7 +739,13 @@ class VirtualGPU : public device::VirtualDevice {
   void destroyPool();
 
   void* allocKernArg(size_t size, size_t alignment);
-  void resetKernArgPool() { kernarg_pool_cur_offset_ = 0; }
+  void resetKernArgPool();
+
+  //! Allocates a new segment for the kernel arguments pool and splits it into chunks
+  bool addKernArgSegment(size_t size, size_t position);
+
+  //! Retires the current kernel arguments chunk and switches to the next one
+  bool nextKernArgChunk(size_t size);
 
   uint64_t getVQVirtualAddress();
 
@@ -430,6 +775,26 @@ class VirtualGPU : public device::VirtualDevice {
                   const amd::BufferRect& dstRect   //!< region of destination for copy
                   );
 
+  //! The routes of the copies between devices
+  enum class P2PRoute : uint32_t {
+    Direct,     //!< Direct xGMI or PCIe copy between the devices
+    Relay,      //!< Staged copy through the memory of an intermediate device
+    HostStaged  //!< Staged copy through the host memory
+  };
+
+  //! Selects the shortest route of the copy between devices by the link distances
+  P2PRoute selectP2PRoute(const Device& srcDev,  //!< the device of the source memory
+                          const Device& dstDev,  //!< the device of the destination memory
+                          bool direct,           //!< the direct copy is allowed
+                          const Device** relay   //!< the intermediate device for the relay
+                          ) const;
+
+  //! Pipelined copy through the double-buffered staging memory. The stage in address
+  //! is written by the first step and the stage out address is read by the second step
+  bool copyP2PStaged(const_address src, hsa_agent_t srcAgent, address dst, hsa_agent_t dstAgent,
+                     address stageIn, hsa_agent_t stageInAgent, const_address stageOut,
+                     hsa_agent_t stageOutAgent, size_t size);
+
   //! Updates AQL header for the upcomming dispatch
   void setAqlHeader(uint16_t header) { aqlHeader_ = header; }
 
@@ -437,6 +802,8 @@ class VirtualGPU : public device::VirtualDevice {
   void ResetQueueStates();
 
   std::vector<Memory*> xferWriteBuffers_;  //!< Stage write buffers
+  Device::XferBuffers::LocalCache xferCache_[2];  //!< Local caches of read/write staging buffers
+  std::vector<ProfilingSignal*> queueDependencies_;  //!< Signals of the other queues for a wait
   std::vector<amd::Memory*> pinnedMems_;   //!< Pinned memory list
 
   //! Queue state flags
@@ -448,6 +815,11 @@ class VirtualGPU : public device::VirtualDevice {
       uint32_t addSystemScope_     : 1; //!< Insert a system scope to the next aql
       uint32_t tracking_created_   : 1; //!< Enabled if tracking object was properly initialized
       uint32_t profilerAttached_   : 1; //!< Indicates if profiler is attached
+      uint32_t holdDoorbell_       : 1; //!< Doorbell rings are held for a multi-device launch
+      uint32_t hostCoherentArgs_   : 1; //!< The current dispatch accesses host coherent memory
+      uint32_t tailFenced_         : 1; //!< The queue tail has a signal and a system release
+      uint32_t serializeCommand_   : 1; //!< The command waits for all previous packets on GPU
+      uint32_t hdpFlushPending_    : 1; //!< CPU wrote the device memory without HDP flush
     };
     uint32_t  state_;
   };
@@ -456,6 +828,11 @@ class VirtualGPU : public device::VirtualDevice {
   hsa_agent_t gpu_device_;  //!< Physical device
   hsa_queue_t* gpu_queue_;  //!< Queue associated with a gpu
   hsa_barrier_and_packet_t barrier_packet_;
+  hsa_signal_t tailSignal_; //!< The tail packet signal, if the packet has barrier and system release
+  hsa_signal_t completionDoorbell_;       //!< Interrupt signal of the stream sync barriers
+  hsa_signal_value_t completionTarget_;   //!< The doorbell value after the last sync barrier
+  uint64_t completionIndex_;              //!< The queue write index after the last sync barrier
+  std::atomic<uint64_t> residencyEpoch_;  //!< The epoch of the current command's memory uses
 
   uint32_t dispatch_id_;  //!< This variable must be updated atomically.
   Device& roc_device_;    //!< roc device object
@@ -474,11 +851,58 @@ class VirtualGPU : public device::VirtualDevice {
 
   HwQueueTracker  barriers_;      //!< Tracks active barriers in ROCr
 
-  char* kernarg_pool_base_;
-  size_t kernarg_pool_size_;
-  uint kernarg_pool_cur_offset_;
+  //! A chunk of the kernel arguments pool. The pool is used as a ring of chunks
+  struct KernArgChunk {
+    char* base_;               //!< Base address of the chunk
+    size_t size_;              //!< Size of the chunk in bytes
+    ProfilingSignal* signal_;  //!< The barrier signal, which marks the last usage of the chunk
+  };
+
+  std::vector<std::pair<char*, size_t>> kernarg_pool_segments_;  //!< Allocated pool segments
+  std::vector<KernArgChunk> kernarg_pool_chunks_;  //!< The ring of chunks in the pool
+  size_t kernarg_pool_size_;        //!< Total size of all pool segments
+  size_t kernarg_pool_chunk_id_;    //!< The active chunk for allocations
+  size_t kernarg_pool_cur_offset_;  //!< Current offset in the active chunk
+  KernArgPoolStats kernarg_pool_stats_;  //!< Kernel arguments pool statistics
+
+  uint64_t deferredDoorbell_;   //!< The last AQL packet index, which wasn't sent to the doorbell
+  uint32_t deferredPackets_;    //!< The number of AQL packets, waiting for the doorbell ring
+  uint64_t deferredStart_;      //!< The time of the first deferred AQL packet
+
+  LaunchGraph* capture_;        //!< The graph, which records the kernel launches
+  PerfCounterSampler* counterSampler_;  //!< The continuous sampling of the perf counters
+  ThreadTrace* threadTrace_;    //!< The active thread trace, which switches the buffers
+  //! The profiles of the perf counter commands, keyed by the counter set
+  std::map<std::vector<uint32_t>, PerfCounterProfile*> counterProfiles_;
+  uint32_t gwsInitValue_;       //!< The last GWS initial value on the cooperative queue
+  uint64_t scratchReserved_;    //!< The largest scratch, the queue's kernels requested
+  uint32_t dependencyBarriers_; //!< The number of the barriers from the memory dependency
+  //! The hidden arguments templates, keyed by the launch plan id of the kernel
+  std::unordered_map<uint64_t, HiddenArgs> hiddenArgs_;
+
+  //! A recent dispatch for the hang snapshot
+  struct DispatchRecord {
+    std::string kernelName_;   //!< The kernel name
+    uint64_t packetIndex_;     //!< The AQL packet index in the ring
+    uint64_t time_;            //!< The host time of the dispatch in ns
+    size_t argSize_;           //!< The size of the copied arguments
+    uint8_t args_[64];         //!< The first bytes of the kernel arguments
+  };
+  //! Records the dispatch in the history, when the hang detection is enabled
+  void recordDispatch(const std::string& kernelName, const void* args, size_t argSize);
+
+  amd::Monitor historyLock_;                    //!< Lock for the dispatch history
+  std::vector<DispatchRecord> dispatchHistory_; //!< The ring of the last dispatches
+  size_t historyNext_;                          //!< The next record in the ring
+
+  static amd::Monitor multiGridLock_;  //!< Lock for the multi-device launches
+  //! The queues with the held doorbells for each multi-device launch, keyed by the first device
+  static std::map<uint64_t, std::vector<VirtualGPU*>> multiGridQueues_;
 
   friend class Timestamp;
+  friend class LaunchGraph;
+  friend class PerfCounterSampler;
+  friend class ThreadTrace;
 
   //  PM4 packet for gfx8 performance counter
   enum {
@@ -491,11 +915,21 @@ class VirtualGPU : public device::VirtualDevice {
 
   //!< bit-vector representing the CU mask. Each active bit represents using one CU
   const std::vector<uint32_t> cuMask_;
+  std::vector<uint32_t> cuPartition_;    //!< The active CU partition of the queue
   amd::CommandQueue::Priority priority_; //!< The priority for the hsa queue
+  WaitPolicy waitPolicy_;                //!< Host wait strategy, selected by the priority
 
   cl_command_type copy_command_type_;   //!< Type of the copy command, used for ROC profiler
                                         //!< OCL doesn't distinguish diffrent copy types,
                                         //!< but ROC profiler expects D2H or H2D detection
+
+  //! Applies the tunable flag overrides, which changed since the last update
+  void updateTuning();
+
+  uint64_t tuningGeneration_;   //!< The generation of the applied overrides
+  size_t stagingSize_;          //!< The tuned staging size of the transfers
+  uint stagingChunks_;          //!< The tuned number of the staging chunks
+  uint32_t activeWaitTimeout_;  //!< The tuned active wait timeout in us
 };
 
 template <typename T>
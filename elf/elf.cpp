@@ -20,8 +20,10 @@
 
 #include "elf.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <cassert>
+#include <fstream>
 #include <string>
 
 #if defined(__linux__)
@@ -174,13 +176,16 @@ Elf::Elf (
     const char*   rawElfBytes,
     uint64_t      rawElfSize,
     const char*   elfFileName,
-    ElfCmd        elfcmd
+    ElfCmd        elfcmd,
+    bool          referenceImage
     )
 : _fname (elfFileName ? elfFileName : ""),
   _eclass (eclass),
   _rawElfBytes (rawElfBytes),
   _rawElfSize (rawElfSize),
   _elfCmd (elfcmd),
+  _referenceImage (referenceImage),
+  _symbolIndexValid (false),
   _elfMemory(),
   _shstrtab_ndx (SHN_UNDEF),
   _strtab_ndx (SHN_UNDEF),
@@ -215,6 +220,9 @@ bool Elf::Clear()
   ElfTrace(amd::LOG_INFO);
 
   _elfio.clean();
+  _sectionIndex.clear();
+  _symbolIndex.clear();
+  _symbolIndexValid = false;
   elfMemoryRelease();
 
   // Re-initialize the object
@@ -223,6 +231,87 @@ bool Elf::Clear()
   return isSuccessful();
 }
 
+namespace {
+//! Read only stream buffer over the caller memory, so ELFIO parses the image without a copy
+class MemoryStreamBuf : public std::streambuf {
+ public:
+  MemoryStreamBuf(const char* data, size_t size) {
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+  }
+
+ protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which = std::ios_base::in) override {
+    char* pos = (dir == std::ios_base::beg) ? eback() :
+                (dir == std::ios_base::cur) ? gptr() : egptr();
+    pos += off;
+    if ((pos < eback()) || (pos > egptr())) {
+      return pos_type(off_type(-1));
+    }
+    setg(eback(), pos, egptr());
+    return pos_type(pos - eback());
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
+//! Write only stream buffer, so ELFIO writes the sections straight into the image memory.
+//! Without the memory it only tracks the image end, hence the layout pass doesn't copy data
+class ImageStreamBuf : public std::streambuf {
+ public:
+  ImageStreamBuf(char* image, size_t size) : image_(image), size_(size), pos_(0), end_(0) {}
+
+  //! Returns the image size, written so far
+  size_t end() const { return end_; }
+
+ protected:
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    if (image_ != nullptr) {
+      if ((pos_ > size_) || (static_cast<size_t>(n) > (size_ - pos_))) {
+        return 0;
+      }
+      ::memcpy(image_ + pos_, s, n);
+    }
+    pos_ += n;
+    end_ = std::max(end_, pos_);
+    return n;
+  }
+
+  int_type overflow(int_type ch) override {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+      return traits_type::not_eof(ch);
+    }
+    const char c = traits_type::to_char_type(ch);
+    return (xsputn(&c, 1) == 1) ? ch : traits_type::eof();
+  }
+
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which = std::ios_base::out) override {
+    const off_type base = (dir == std::ios_base::beg) ? 0 :
+                          (dir == std::ios_base::cur) ? off_type(pos_) : off_type(end_);
+    return seekpos(pos_type(base + off), which);
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::out) override {
+    if (((which & std::ios_base::out) == 0) || (off_type(pos) < 0)) {
+      return pos_type(off_type(-1));
+    }
+    // ELFIO seeks over the alignment gaps, which stay zero
+    pos_ = static_cast<size_t>(off_type(pos));
+    return pos;
+  }
+
+ private:
+  char* image_;  //!< The image memory or nullptr for the layout pass
+  size_t size_;  //!< The image memory size
+  size_t pos_;   //!< The current write position
+  size_t end_;   //!< The end of the written data
+};
+}  // namespace
+
 /*
  Initialize Elf object
  */
@@ -241,8 +330,9 @@ bool Elf::Init()
         return false;
       }
       {
-        std::istringstream is { std::string(_rawElfBytes, _rawElfSize) };
-        if (!_elfio.load(is)) {
+        MemoryStreamBuf buf(_rawElfBytes, _rawElfSize);
+        std::istream is(&buf);
+        if (!_elfio.load(is, _referenceImage ? _rawElfBytes : nullptr)) {
           LogElfError("failed in _elfio.load(%p, %lu)", _rawElfBytes, _rawElfSize);
           return false;
         }
@@ -276,8 +366,14 @@ bool Elf::InitElf ()
       return false;
     }
 
+    // Build the section name index, the first section wins on duplicate names as in ELFIO
+    _sectionIndex.reserve(_elfio.sections.size());
+    for (auto* sec : _elfio.sections) {
+      _sectionIndex.emplace(sec->get_name(), sec);
+    }
+
     // Set up _strtab_ndx
-    section* strtab_sec = _elfio.sections[ElfSecDesc[STRTAB].name];
+    section* strtab_sec = findSection(ElfSecDesc[STRTAB].name);
     if (strtab_sec == nullptr) {
       logElfError("failed: null sections(STRTAB)");
       return false;
@@ -285,7 +381,7 @@ bool Elf::InitElf ()
 
     _strtab_ndx = strtab_sec->get_index();
 
-    section* symtab_sec = _elfio.sections[ElfSecDesc[SYMTAB].name];
+    section* symtab_sec = findSection(ElfSecDesc[SYMTAB].name);
 
     if (symtab_sec != nullptr) {
       _symtab_ndx = symtab_sec->get_index();
@@ -489,12 +585,22 @@ bool Elf::setFlags(uint32_t  flag) {
   return true;
 }
 
+section* Elf::findSection(const char* name) const
+{
+  if (_sectionIndex.empty()) {
+    // The index isn't available for writing, since the sections can be added
+    return _elfio.sections[name];
+  }
+  auto it = _sectionIndex.find(name);
+  return (it != _sectionIndex.end()) ? it->second : nullptr;
+}
+
 bool Elf::getSection(Elf::ElfSections id, char** dst, size_t* sz) const
 {
   assert((ElfSecDesc[id].id == id) &&
       "ElfSecDesc[] should be in the same order as enum ElfSections");
 
-  section* sec = _elfio.sections[ElfSecDesc[id].name];
+  section* sec = findSection(ElfSecDesc[id].name);
   if (sec == nullptr) {
     LogElfError("failed: null sections(%s)", ElfSecDesc[id].name);
     return false;
@@ -788,9 +894,38 @@ bool Elf::getSymbol(
   unsigned char other = 0;
   Elf_Half sec_ndx = SHN_UNDEF;
 
-  // Search by symbolName, sectionName
-  bool ret = symbol_reader.get_symbol(symbolName, ElfSecDesc[id].name, value, size0,
-                    bind, type, sec_ndx, other);
+  bool ret = false;
+  if (_elfCmd == ELF_C_READ) {
+    // Build the symbol index on the first lookup, the key is "sectionName\0symbolName"
+    if (!_symbolIndexValid) {
+      const Elf_Xword num = symbol_reader.get_symbols_num();
+      _symbolIndex.reserve(num);
+      for (Elf_Xword i = 1; i < num; ++i) {
+        std::string name;
+        if (symbol_reader.get_symbol(i, name, value, size0, bind, type, sec_ndx, other) &&
+            (sec_ndx < _elfio.sections.size())) {
+          std::string key(_elfio.sections[sec_ndx]->get_name());
+          key.push_back('\0');
+          key.append(name);
+          // Keep the first match, as the sequential search does
+          _symbolIndex.emplace(std::move(key), i);
+        }
+      }
+      _symbolIndexValid = true;
+    }
+    std::string key(ElfSecDesc[id].name);
+    key.push_back('\0');
+    key.append(symbolName);
+    auto it = _symbolIndex.find(key);
+    if (it != _symbolIndex.end()) {
+      std::string name;
+      ret = symbol_reader.get_symbol(it->second, name, value, size0, bind, type, sec_ndx, other);
+    }
+  } else {
+    // Search by symbolName, sectionName
+    ret = symbol_reader.get_symbol(symbolName, ElfSecDesc[id].name, value, size0,
+                      bind, type, sec_ndx, other);
+  }
 
   if (ret) {
     *buffer = const_cast<char*>(_elfio.sections[sec_ndx]->get_data() + value);
@@ -849,7 +984,7 @@ bool Elf::getNote(
   }
 
   // Get section
-  section* sec = _elfio.sections[ElfSecDesc[NOTES].name];
+  section* sec = findSection(ElfSecDesc[NOTES].name);
   if (sec == nullptr) {
     logElfError("failed: null sections(NOTES)");
     return false;
@@ -915,35 +1050,52 @@ std::string Elf::generateUUIDV4() {
 
 bool Elf::dumpImage(char** buff, size_t* len)
 {
-  bool ret = false;
-  std::string dumpFile = _fname;
-  if (_fname.empty()) {
-    dumpFile = generateUUIDV4();
-    dumpFile += ".bin";
-    LogElfInfo("Generated temporary dump file: %s", dumpFile.c_str());
+  if (buff == nullptr || len == nullptr) {
+    if (!_fname.empty() && !_elfio.save(_fname)) {
+      LogElfError("failed in _elfio.save(%s)", _fname.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // The layout pass only measures the image, then the sections are written straight
+  // into the final memory without a temporary file or an intermediate stream
+  ImageStreamBuf layoutBuf(nullptr, 0);
+  std::ostream layout(&layoutBuf);
+  if (!_elfio.save(layout) || !layout.good()) {
+    logElfError("failed in the ELF layout");
+    return false;
   }
 
-  if (!_elfio.save(dumpFile)) {
-    LogElfError("failed in _elfio.save(%s)", dumpFile.c_str());
+  const size_t size = layoutBuf.end();
+  char* image = new (std::nothrow) char[size]();
+  if (image == nullptr) {
+    LogElfError("failed to allocate %zu bytes for the ELF image", size);
+    return false;
+  }
+  ImageStreamBuf imageBuf(image, size);
+  std::ostream stream(&imageBuf);
+  if (!_elfio.save(stream) || !stream.good() || (imageBuf.end() != size)) {
+    logElfError("failed in _elfio.save() to memory");
+    delete[] image;
     return false;
   }
 
-  if (buff != nullptr && len != nullptr) {
-    std::ifstream is;
-    is.open(dumpFile, std::ifstream::in | std::ifstream::binary); // open input file
-    if (!is.good()) {
-      LogElfError("failed in is.open(%s)", dumpFile.c_str());
+  // The file is written from the image, so it isn't read back
+  if (!_fname.empty()) {
+    std::ofstream os(_fname, std::ios::out | std::ios::binary);
+    os.write(image, size);
+    if (!os.good()) {
+      LogElfError("failed to write %s", _fname.c_str());
+      delete[] image;
       return false;
     }
-    ret = dumpImage(is, buff, len);
-    is.close();  // close file
   }
 
-  if (_fname.empty()) {
-    std::remove(dumpFile.c_str());
-  }
-  LogElfInfo("%s: buff=%p, len=%zu\n", ret ? "Succeed" : "failed", *buff, *len);
-  return ret;
+  *buff = image;
+  *len = size;
+  LogElfInfo("Succeed: buff=%p, len=%zu\n", *buff, *len);
+  return true;
 }
 
 bool Elf::dumpImage(std::istream &is, char **buff, size_t *len) {
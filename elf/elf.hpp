@@ -22,6 +22,7 @@
 #define ELF_HPP_
 
 #include <map>
+#include <unordered_map>
 
 #include "top.hpp"
 #if !defined(WITH_LIGHTNING_COMPILER)
@@ -198,6 +199,14 @@ private:
     // Read, write, or read and write for this Elf object
     const ElfCmd  _elfCmd;
 
+    // The sections reference _rawElfBytes without copies (reading only)
+    const bool    _referenceImage;
+
+    // Name indices of the loaded sections and symbols (reading only)
+    std::unordered_map<std::string, section*> _sectionIndex;
+    mutable std::unordered_map<std::string, Elf_Xword> _symbolIndex;
+    mutable bool  _symbolIndexValid;
+
     // Memory management
     typedef std::map<void*, size_t> EMemory;
     EMemory  _elfMemory;
@@ -231,6 +240,9 @@ public:
         'eclass' is ELF's bitness and it must be the same as the eclass of ELF to
         be loaded (for example, rawElfBytes).
 
+        If 'referenceImage' is true for reading, then the sections reference rawElfBytes
+        without copies, and rawElfBytes must outlive this Elf object.
+
 
         Return values of all public APIs with bool return type
            true  : on success;
@@ -241,14 +253,15 @@ public:
         const char*   rawElfBytes,  // raw ELF bytes to be loaded
         uint64_t      rawElfSize,   // size of the ELF raw bytes
         const char*   elfFileName,  // File to save this ELF.
-        ElfCmd        elfcmd        // ELF_C_READ/ELF_C_WRITE
+        ElfCmd        elfcmd,       // ELF_C_READ/ELF_C_WRITE
+        bool          referenceImage = false  // Don't copy rawElfBytes for reading
         );
 
     ~Elf ();
 
     /*
-     * dumpImage() will finalize the ELF and write it into the file/stream. It then reads
-     * it into the memory; and returns it via <buff, len>.
+     * dumpImage() will finalize the ELF and write the sections straight into the memory,
+     * which is returned via <buff, len>. The file, if given, is written from that memory.
      * The memory pointed by buff is new'ed in Elf and should be deleted by caller
      * if dumpImage() succeeds.
      */
@@ -364,6 +377,9 @@ private:
      */
     bool InitElf ();
 
+    /* Return the section by name, using the name index for reading */
+    section* findSection(const char* name) const;
+
     /* Setup a section header */
     bool setupShdr (
         ElfSections id,
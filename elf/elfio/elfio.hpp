@@ -111,7 +111,9 @@ class elfio
     }
 
 //------------------------------------------------------------------------------
-    bool load( std::istream &stream )
+    //! If the image isn't null, then the stream reads the image and the loaded sections
+    //! reference it without copies. The image must outlive this object
+    bool load( std::istream &stream, const char* image = 0 )
     {
         clean();
 
@@ -142,8 +144,8 @@ class elfio
             return false;
         }
 
-        load_sections( stream );
-        bool is_still_good = load_segments( stream );
+        load_sections( stream, image );
+        bool is_still_good = load_segments( stream, image );
         return is_still_good;
     }
 
@@ -398,7 +400,7 @@ class elfio
     }
 
 //------------------------------------------------------------------------------
-    Elf_Half load_sections( std::istream& stream )
+    Elf_Half load_sections( std::istream& stream, const char* image )
     {
         Elf_Half  entry_size = header->get_section_entry_size();
         Elf_Half  num        = header->get_sections_num();
@@ -406,7 +408,7 @@ class elfio
 
         for ( Elf_Half i = 0; i < num; ++i ) {
             section* sec = create_section();
-            sec->load( stream, (std::streamoff)offset + i * entry_size );
+            sec->load( stream, (std::streamoff)offset + i * entry_size, image );
             sec->set_index( i );
             // To mark that the section is not permitted to reassign address
             // during layout calculation
@@ -442,7 +444,7 @@ class elfio
     }
 
 //------------------------------------------------------------------------------
-    bool load_segments( std::istream& stream )
+    bool load_segments( std::istream& stream, const char* image )
     {
         Elf_Half  entry_size = header->get_segment_entry_size();
         Elf_Half  num        = header->get_segments_num();
@@ -462,7 +464,7 @@ class elfio
                 return false;
             }
 
-            seg->load( stream, (std::streamoff)offset + i * entry_size );
+            seg->load( stream, (std::streamoff)offset + i * entry_size, image );
             seg->set_index( i );
 
             // Add sections to the segments (similar to readelfs algorithm)
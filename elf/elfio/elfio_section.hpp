@@ -62,7 +62,8 @@ protected:
     ELFIO_SET_ACCESS_DECL( Elf_Half,  index  );
     
     virtual void load( std::istream&  stream,
-                       std::streampos header_offset ) = 0;
+                       std::streampos header_offset,
+                       const char*    image = 0 ) = 0;
     virtual void save( std::ostream&  stream,
                        std::streampos header_offset,
                        std::streampos data_offset )   = 0;
@@ -79,6 +80,7 @@ class section_impl : public section
     {
         std::fill_n( reinterpret_cast<char*>( &header ), sizeof( header ), '\0' );
         is_address_set = false;
+        is_external    = false;
         data           = 0;
         data_size      = 0;
     }
@@ -86,7 +88,7 @@ class section_impl : public section
 //------------------------------------------------------------------------------
     ~section_impl()
     {
-        delete [] data;
+        release_data();
     }
 
 //------------------------------------------------------------------------------
@@ -151,7 +153,7 @@ class section_impl : public section
     set_data( const char* raw_data, Elf_Word size )
     {
         if ( get_type() != SHT_NOBITS ) {
-            delete [] data;
+            release_data();
             try {
                 data = new char[size];
             } catch (const std::bad_alloc&) {
@@ -180,7 +182,8 @@ class section_impl : public section
     append_data( const char* raw_data, Elf_Word size )
     {
         if ( get_type() != SHT_NOBITS ) {
-            if ( get_size() + size < data_size ) {
+            // The external image is read only, so the data is copied on the first append
+            if ( !is_external && get_size() + size < data_size ) {
                 std::copy( raw_data, raw_data + size, data + get_size() );
             }
             else {
@@ -195,7 +198,7 @@ class section_impl : public section
                 if ( 0 != new_data ) {
                     std::copy( data, data + get_size(), new_data );
                     std::copy( raw_data, raw_data + size, new_data + get_size() );
-                    delete [] data;
+                    release_data();
                     data = new_data;
                 }
             }
@@ -215,6 +218,17 @@ class section_impl : public section
 //------------------------------------------------------------------------------
     ELFIO_GET_SET_ACCESS( Elf64_Off, offset, header.sh_offset );
 
+//------------------------------------------------------------------------------
+    void
+    release_data()
+    {
+        if ( !is_external ) {
+            delete [] data;
+        }
+        data        = 0;
+        is_external = false;
+    }
+
 //------------------------------------------------------------------------------
     void
     set_index( Elf_Half value )
@@ -225,7 +239,8 @@ class section_impl : public section
 //------------------------------------------------------------------------------
     void
     load( std::istream&  stream,
-          std::streampos header_offset )
+          std::streampos header_offset,
+          const char*    image )
     {
         std::fill_n( reinterpret_cast<char*>( &header ), sizeof( header ), '\0' );
 
@@ -237,7 +252,17 @@ class section_impl : public section
 
 
         Elf_Xword size = get_size();
-        if ( 0 == data && SHT_NULL != get_type() && SHT_NOBITS != get_type() && size < get_stream_size()) {
+        Elf64_Off offset = (*convertor)( header.sh_offset );
+        // Reference the data in the external image, except the string tables,
+        // which must be terminated for the string accessors
+        if ( 0 != image && 0 == data && SHT_NULL != get_type() && SHT_NOBITS != get_type() &&
+             SHT_STRTAB != get_type() && 0 != size && offset <= get_stream_size() &&
+             size <= get_stream_size() - offset ) {
+            data        = const_cast<char*>( image + offset );
+            data_size   = size;
+            is_external = true;
+        }
+        else if ( 0 == data && SHT_NULL != get_type() && SHT_NOBITS != get_type() && size < get_stream_size()) {
             try {
                 data = new char[size + 1];
             } catch (const std::bad_alloc&) {
@@ -313,6 +338,7 @@ class section_impl : public section
     Elf_Word                   data_size;
     const endianess_convertor* convertor;
     bool                       is_address_set;
+    bool                       is_external;    //!< The data references an external image
     size_t                     stream_size;
 };
 
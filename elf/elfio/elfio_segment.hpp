@@ -58,7 +58,8 @@ class segment
     ELFIO_SET_ACCESS_DECL( Elf_Half,  index  );
     
     virtual const std::vector<Elf_Half>& get_sections() const               = 0;
-    virtual void load( std::istream& stream, std::streampos header_offset ) = 0;
+    virtual void load( std::istream& stream, std::streampos header_offset,
+                       const char* image = 0 )                              = 0;
     virtual void save( std::ostream& stream, std::streampos header_offset,
                                              std::streampos data_offset )   = 0;
 };
@@ -74,13 +75,16 @@ class segment_impl : public segment
         stream_size( 0 ), index( 0 ), data( 0 ), convertor( convertor_ )
     {
         is_offset_set = false;
+        is_external   = false;
         std::fill_n( reinterpret_cast<char*>( &ph ), sizeof( ph ), '\0' );
     }
 
 //------------------------------------------------------------------------------
     virtual ~segment_impl()
     {
-        delete [] data;
+        if ( !is_external ) {
+            delete [] data;
+        }
     }
 
 //------------------------------------------------------------------------------
@@ -190,7 +194,8 @@ class segment_impl : public segment
 //------------------------------------------------------------------------------
     void
     load( std::istream&  stream,
-          std::streampos header_offset )
+          std::streampos header_offset,
+          const char*    image )
     {
 
     stream.seekg ( 0, stream.end );
@@ -204,9 +209,16 @@ class segment_impl : public segment
             stream.seekg( (*convertor)( ph.p_offset ) );
             Elf_Xword size = get_file_size();
 
+            Elf64_Off offset = (*convertor)( ph.p_offset );
+
             if ( size > get_stream_size() ) {
                 data = 0;
             }
+            else if ( 0 != image && offset <= get_stream_size() - size ) {
+                // Reference the data in the external image
+                data        = const_cast<char*>( image + offset );
+                is_external = true;
+            }
             else {
                 try {
                     data = new char[size + 1];
@@ -241,6 +253,7 @@ class segment_impl : public segment
     std::vector<Elf_Half> sections;
     endianess_convertor*  convertor;
     bool                  is_offset_set;
+    bool                  is_external;    //!< The data references an external image
 };
 
 } // namespace ELFIO
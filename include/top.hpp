@@ -172,10 +172,22 @@ class HeapObject {
 class ReferenceCountedObject {
   std::atomic<uint> referenceCount_;
 
+  friend class DeferredRelease;
+
+  //! Terminates and deletes the object after the last release
+  void destroy() {
+    if (terminate()) {
+      delete this;
+    }
+  }
+
  protected:
   virtual ~ReferenceCountedObject() {}
   virtual bool terminate() { return true; }
 
+  //! Returns TRUE if the object can be destroyed asynchronously on the last release
+  virtual bool deferrable() const { return false; }
+
  public:
   ReferenceCountedObject() : referenceCount_(1) {}
 
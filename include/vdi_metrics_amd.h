@@ -0,0 +1,105 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#ifndef _VDI_METRICS_AMD_H
+#define _VDI_METRICS_AMD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define VDI_METRICS_VERSION_1_0 100
+
+/* Queries all devices or all queues of the device */
+#define VDI_METRICS_ALL 0xffffffffu
+
+/* The number of log2 buckets of the wait time histogram, in ns */
+#define VDI_METRICS_HISTOGRAM_BUCKETS 32
+
+/* Runtime event counters. New counters are added at the end */
+typedef enum {
+  VDI_METRIC_DISPATCHES = 0,          /* Kernel dispatches */
+  VDI_METRIC_KERNARG_BYTES = 1,       /* Bytes of the kernel arguments */
+  VDI_METRIC_DEPENDENCY_BARRIERS = 2, /* Barriers, inserted by the memory dependency tracker */
+  VDI_METRIC_STAGING_BYTES = 3,       /* Bytes, transferred through the staging buffers */
+  VDI_METRIC_PIN_CALLS = 4,           /* Pinned host memory allocations */
+  VDI_METRIC_UNPIN_CALLS = 5,         /* Pinned host memory releases */
+  VDI_METRIC_QUEUE_WAKEUPS = 6,       /* Wake-ups of the parked queue threads */
+  VDI_METRIC_SIGNAL_WAITS = 7,        /* CPU waits for the incomplete signals */
+  VDI_METRIC_SIGNAL_WAIT_NS = 8,      /* Total time of the signal waits in ns */
+  VDI_METRIC_SCRATCH_BYTES = 9,       /* Scratch memory, reserved for the kernels */
+  VDI_METRIC_SIGNAL_WRAP_WAITS = 10,  /* CPU waits for a busy signal on the pool wrap */
+  VDI_METRIC_SIGNAL_POOL_GROWS = 11,  /* Signals, added to the queue pools on demand */
+  VDI_METRIC_NUMBER
+} vdi_metric_t;
+
+/* A snapshot of the metrics */
+typedef struct {
+  uint32_t version;                                     /* VDI_METRICS_VERSION_1_0 */
+  uint32_t num_counters;                                /* VDI_METRIC_NUMBER */
+  uint64_t counters[VDI_METRIC_NUMBER];                 /* Counter values */
+  uint64_t wait_histogram[VDI_METRICS_HISTOGRAM_BUCKETS]; /* Signal waits, bucket i counts
+                                                           the waits in [2^i, 2^(i+1)) ns */
+} vdi_metrics_t;
+
+#define VDI_MEMORY_USAGE_VERSION_1_0 100
+
+/* Memory categories of the usage accounting. New categories are added at the end */
+typedef enum {
+  VDI_MEMORY_USER = 0,            /* Buffers and images, allocated by the application */
+  VDI_MEMORY_STAGING = 1,         /* Staging buffers of the transfers */
+  VDI_MEMORY_MAP_CACHE = 2,       /* Idle map targets in the map cache */
+  VDI_MEMORY_KERNARG = 3,         /* Kernel arguments pools */
+  VDI_MEMORY_SCRATCH = 4,         /* Scratch memory, reserved for the kernels */
+  VDI_MEMORY_PRINTF = 5,          /* Printf buffers */
+  VDI_MEMORY_HOSTCALL = 6,        /* Hostcall buffers */
+  VDI_MEMORY_CODE = 7,            /* Loaded code objects */
+  VDI_MEMORY_RESOURCE_CACHE = 8,  /* Free memory, kept by the runtime allocator caches */
+  VDI_MEMORY_NUMBER
+} vdi_memory_type_t;
+
+/* A snapshot of the memory usage in bytes */
+typedef struct {
+  uint32_t version;                        /* VDI_MEMORY_USAGE_VERSION_1_0 */
+  uint32_t num_types;                      /* VDI_MEMORY_NUMBER */
+  uint64_t current[VDI_MEMORY_NUMBER];     /* The allocated bytes */
+  uint64_t peak[VDI_MEMORY_NUMBER];        /* The peak of the allocated bytes */
+  uint64_t allocations[VDI_MEMORY_NUMBER]; /* The number of the allocations */
+} vdi_memory_usage_t;
+
+/* Returns the metrics of the queue on the device. VDI_METRICS_ALL queue returns the device
+   total with the destroyed queues and VDI_METRICS_ALL device returns the process total.
+   Returns 0 on success */
+extern int32_t vdiMetricsQuery(uint32_t device, uint32_t queue, vdi_metrics_t* metrics);
+
+/* Sets all metrics of the process to zero */
+extern void vdiMetricsReset(void);
+
+/* Returns the memory usage of the device. VDI_METRICS_ALL device returns the sum of all
+   devices, which also sums the peaks. Returns 0 on success */
+extern int32_t vdiMemoryUsageQuery(uint32_t device, vdi_memory_usage_t* usage);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _VDI_METRICS_AMD_H */
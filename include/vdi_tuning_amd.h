@@ -0,0 +1,57 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#ifndef _VDI_TUNING_AMD_H
+#define _VDI_TUNING_AMD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Selects all devices or all queues of the device */
+#define VDI_TUNING_ALL 0xffffffffu
+
+/* Overrides a tunable flag for the queue on the device. VDI_TUNING_ALL queue sets the value for
+   all queues of the device and VDI_TUNING_ALL device sets the process value. The most specific
+   override wins. The tunable flags and the moment the new value takes effect:
+     GPU_STAGING_BUFFER_SIZE    - the next flush, up to the staging buffer size at the startup
+     GPU_STAGING_BUFFER_CHUNKS  - the next flush
+     ROC_ACTIVE_WAIT_TIMEOUT    - the next flush
+     HSA_KERNARG_POOL_SIZE      - the next queue creation
+     GPU_NUM_MEM_DEPENDENCY     - the next queue creation
+   Returns 0 on success, -1 if the flag isn't tunable or the value is invalid */
+extern int32_t vdiTuningSet(uint32_t device, uint32_t queue, const char* name,
+                            const char* value);
+
+/* Returns the effective value of the tunable flag for the queue on the device: the override
+   or the environment value. Returns 0 on success */
+extern int32_t vdiTuningGet(uint32_t device, uint32_t queue, const char* name, uint64_t* value);
+
+/* Removes the overrides of the queue on the device. VDI_TUNING_ALL also removes the overrides
+   of the nested scopes */
+extern void vdiTuningReset(uint32_t device, uint32_t queue);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _VDI_TUNING_AMD_H */
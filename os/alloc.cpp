@@ -21,8 +21,12 @@
 #include "os/alloc.hpp"
 #include "os/os.hpp"
 #include "utils/util.hpp"
+#include "utils/flags.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <mutex>
 
 namespace amd {
 
@@ -77,6 +81,175 @@ void GuardedMemory::deallocate(void* ptr) {
   Os::releaseMemory(static_cast<address>(ptr) - offset, size);
 }
 
+namespace {
+
+struct SlabCache;
+
+//! The header of each slab block, followed by the user's data
+struct alignas(16) SlabBlock {
+  SlabCache* owner_;  //!< The cache of the allocating thread, nullptr if the block isn't cached
+  uint32_t class_;    //!< Size class of the block
+  SlabBlock* next_;   //!< Next block in a free list
+
+  void* data() { return this + 1; }
+  static SlabBlock* fromData(void* ptr) { return reinterpret_cast<SlabBlock*>(ptr) - 1; }
+};
+
+//! Per thread cache of the free blocks. The caches are never destroyed, since the blocks
+//! can outlive their threads. A cache of the finished thread is adopted by a new thread.
+struct SlabCache {
+  SlabBlock* free_[SlabMemory::kNumClasses] = {};  //!< Free lists, owner access only
+  uint count_[SlabMemory::kNumClasses] = {};       //!< The number of blocks in the free lists
+  std::atomic<SlabBlock*> remote_{nullptr};         //!< Blocks, freed by other threads
+  SlabCache* nextOrphan_ = nullptr;                 //!< Next cache without an owner thread
+
+  //! Moves the remote frees into the local free lists
+  void drainRemote() {
+    SlabBlock* block = remote_.exchange(nullptr, std::memory_order_acquire);
+    while (block != nullptr) {
+      SlabBlock* next = block->next_;
+      push(block);
+      block = next;
+    }
+  }
+
+  //! Returns a block into the local free list or to the system if the cache is full
+  void push(SlabBlock* block) {
+    if (count_[block->class_] < SlabMemory::kMaxCachedBlocks) {
+      block->next_ = free_[block->class_];
+      free_[block->class_] = block;
+      ++count_[block->class_];
+    } else {
+      free(block);
+    }
+  }
+};
+
+std::mutex orphanLock_;                 //!< Lock for the list of orphaned caches
+SlabCache* orphanCaches_ = nullptr;     //!< Caches of the finished threads
+
+//! Binds a slab cache to the current thread and orphans it on the thread exit
+struct SlabCacheHolder {
+  SlabCache* cache_ = nullptr;
+  bool finished_ = false;
+
+  SlabCache* get() {
+    if ((cache_ == nullptr) && !finished_) {
+      {
+        std::lock_guard<std::mutex> lock(orphanLock_);
+        if (orphanCaches_ != nullptr) {
+          cache_ = orphanCaches_;
+          orphanCaches_ = cache_->nextOrphan_;
+        }
+      }
+      if (cache_ == nullptr) {
+        cache_ = new (std::nothrow) SlabCache();
+      }
+    }
+    return cache_;
+  }
+
+  ~SlabCacheHolder() {
+    finished_ = true;
+    if (cache_ != nullptr) {
+      std::lock_guard<std::mutex> lock(orphanLock_);
+      cache_->nextOrphan_ = orphanCaches_;
+      orphanCaches_ = cache_;
+      cache_ = nullptr;
+    }
+  }
+};
+
+thread_local SlabCacheHolder slabCache_;
+
+}  // namespace
+
+void* SlabMemory::allocate(size_t size) {
+  const size_t sizeClass = (size + kGranularity - 1) / kGranularity;
+  SlabCache* cache = nullptr;
+  if (AMD_SLAB_CACHE && (sizeClass < kNumClasses)) {
+    cache = slabCache_.get();
+  }
+
+  if (cache == nullptr) {
+    // No caching for big objects
+    SlabBlock* block = reinterpret_cast<SlabBlock*>(malloc(sizeof(SlabBlock) + size));
+    if (block == nullptr) {
+      return nullptr;
+    }
+    block->owner_ = nullptr;
+    block->class_ = kNumClasses;
+    return block->data();
+  }
+
+  if (cache->free_[sizeClass] == nullptr) {
+    // Check if other threads returned blocks
+    cache->drainRemote();
+  }
+
+  SlabBlock* block = cache->free_[sizeClass];
+  if (block != nullptr) {
+    cache->free_[sizeClass] = block->next_;
+    --cache->count_[sizeClass];
+  } else {
+    block = reinterpret_cast<SlabBlock*>(malloc(sizeof(SlabBlock) + sizeClass * kGranularity));
+    if (block == nullptr) {
+      return nullptr;
+    }
+    block->owner_ = cache;
+    block->class_ = sizeClass;
+  }
+  return block->data();
+}
+
+void SlabMemory::deallocate(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  SlabBlock* block = SlabBlock::fromData(ptr);
+  SlabCache* owner = block->owner_;
+  if (owner == nullptr) {
+    free(block);
+  } else if (owner == slabCache_.cache_) {
+    owner->push(block);
+  } else {
+    // Lock-free return of the block to the owner's cache
+    SlabBlock* head = owner->remote_.load(std::memory_order_relaxed);
+    do {
+      block->next_ = head;
+    } while (!owner->remote_.compare_exchange_weak(head, block, std::memory_order_release,
+                                                   std::memory_order_relaxed));
+  }
+}
+
+void* MonotonicMemory::allocate(size_t size, size_t alignment) {
+  char* ptr = (current_ != nullptr) ? amd::alignUp(current_, alignment) : nullptr;
+  if ((ptr == nullptr) || ((ptr + size) > end_)) {
+    // A big request gets an own chunk, the default chunks stay in a slab size class
+    const size_t chunkSize = std::max(kChunkSize, sizeof(Chunk) + size + alignment);
+    Chunk* chunk = reinterpret_cast<Chunk*>(SlabMemory::allocate(chunkSize));
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    chunk->next_ = chunks_;
+    chunks_ = chunk;
+    end_ = reinterpret_cast<char*>(chunk) + chunkSize;
+    ptr = amd::alignUp(reinterpret_cast<char*>(chunk + 1), alignment);
+  }
+  current_ = ptr + size;
+  return ptr;
+}
+
+void MonotonicMemory::release() {
+  while (chunks_ != nullptr) {
+    Chunk* next = chunks_->next_;
+    SlabMemory::deallocate(chunks_);
+    chunks_ = next;
+  }
+  current_ = nullptr;
+  end_ = nullptr;
+}
+
 void* HeapObject::operator new(size_t size) { return malloc(size); }
 
 void HeapObject::operator delete(void* obj) { free(obj); }
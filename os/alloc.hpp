@@ -39,6 +39,57 @@ class GuardedMemory : public AllStatic {
   static void deallocate(void* ptr);
 };
 
+/*! \brief Size-class slab allocator for small frequently recycled objects.
+ *
+ *  Every thread keeps a cache of freed blocks for each size class, so the steady state
+ *  doesn't call malloc/free. A block freed on another thread is returned to the owner's
+ *  cache through a lock-free list and reused on the owner's next cache miss.
+ */
+class SlabMemory : public AllStatic {
+ public:
+  static constexpr size_t kGranularity = 64;   //!< Size class granularity in bytes
+  static constexpr size_t kNumClasses = 32;    //!< The number of size classes
+  static constexpr uint kMaxCachedBlocks = 64; //!< Max free blocks in a class per thread
+
+  static void* allocate(size_t size);
+
+  static void deallocate(void* ptr);
+};
+
+/*! \brief Monotonic allocator for the transient metadata with a common lifetime.
+ *
+ *  The allocations bump a pointer in the chunks from SlabMemory and can't be freed
+ *  one by one. release() returns all chunks at once, e.g. when a command completes.
+ *  The allocator isn't thread safe.
+ */
+class MonotonicMemory {
+ public:
+  //! The default chunk size. It's a slab size class, so the chunks are recycled
+  static constexpr size_t kChunkSize = 1024;
+
+  MonotonicMemory() : chunks_(nullptr), current_(nullptr), end_(nullptr) {}
+  ~MonotonicMemory() { release(); }
+
+  //! Allocates the memory, which lives until release()
+  void* allocate(size_t size, size_t alignment);
+
+  //! Frees all allocations
+  void release();
+
+ private:
+  //! The header of each chunk, followed by the allocations
+  struct Chunk {
+    Chunk* next_;  //!< The previously allocated chunk
+  };
+
+  MonotonicMemory(const MonotonicMemory&) = delete;
+  MonotonicMemory& operator=(const MonotonicMemory&) = delete;
+
+  Chunk* chunks_;    //!< The list of the chunks, the current chunk first
+  char* current_;    //!< The first free byte in the current chunk
+  char* end_;        //!< The end of the current chunk
+};
+
 }  // namespace amd
 
 #endif /*ALLOC_HPP_*/
@@ -20,9 +20,17 @@
 
 #include "os/os.hpp"
 #include "thread/thread.hpp"
+#include "utils/flags.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
 
 #if defined(_WIN32) || defined(__CYGWIN__)
 #include <windows.h>
@@ -33,6 +41,7 @@
 
 #if defined(ATI_ARCH_X86)
 #include <xmmintrin.h>  // for _mm_pause
+#include <immintrin.h>  // for the streaming stores
 #endif                  // ATI_ARCH_X86
 
 namespace amd {
@@ -172,4 +181,210 @@ void Os::setThreadAffinity(const void* handle, unsigned int cpu) {
   setThreadAffinity(handle, mask);
 }
 
+#if defined(ATI_ARCH_X86)
+#if defined(__GNUC__)
+#define OS_TARGET(isa) __attribute__((target(isa)))
+#else  // !__GNUC__
+#define OS_TARGET(isa)
+#endif  // !__GNUC__
+
+//! Copies with the non-temporal stores of the vector type. The destination is aligned
+//! to the vector size and the head and tail are copied with memcpy()
+#define OS_STREAMING_COPY(Vector, loadu, stream)                                            \
+  const size_t kVectorSize = sizeof(Vector);                                              \
+  char* dst = reinterpret_cast<char*>(dest);                                              \
+  const char* s = reinterpret_cast<const char*>(src);                                     \
+  size_t head = (kVectorSize - (reinterpret_cast<uintptr_t>(dst) & (kVectorSize - 1))) &  \
+                (kVectorSize - 1);                                                        \
+  head = std::min(head, n);                                                               \
+  memcpy(dst, s, head);                                                                   \
+  dst += head;                                                                            \
+  s += head;                                                                              \
+  n -= head;                                                                              \
+  for (; n >= 4 * kVectorSize; n -= 4 * kVectorSize) {                                    \
+    const Vector v0 = loadu(reinterpret_cast<const Vector*>(s));                          \
+    const Vector v1 = loadu(reinterpret_cast<const Vector*>(s + kVectorSize));            \
+    const Vector v2 = loadu(reinterpret_cast<const Vector*>(s + 2 * kVectorSize));        \
+    const Vector v3 = loadu(reinterpret_cast<const Vector*>(s + 3 * kVectorSize));        \
+    stream(reinterpret_cast<Vector*>(dst), v0);                                           \
+    stream(reinterpret_cast<Vector*>(dst + kVectorSize), v1);                             \
+    stream(reinterpret_cast<Vector*>(dst + 2 * kVectorSize), v2);                         \
+    stream(reinterpret_cast<Vector*>(dst + 3 * kVectorSize), v3);                         \
+    dst += 4 * kVectorSize;                                                               \
+    s += 4 * kVectorSize;                                                                 \
+  }                                                                                       \
+  for (; n >= kVectorSize; n -= kVectorSize) {                                            \
+    stream(reinterpret_cast<Vector*>(dst), loadu(reinterpret_cast<const Vector*>(s)));    \
+    dst += kVectorSize;                                                                   \
+    s += kVectorSize;                                                                     \
+  }                                                                                       \
+  memcpy(dst, s, n);                                                                      \
+  /* The streaming stores are weakly ordered */                                           \
+  _mm_sfence();
+
+static void streamingCopySse2(void* dest, const void* src, size_t n) {
+  OS_STREAMING_COPY(__m128i, _mm_loadu_si128, _mm_stream_si128)
+}
+
+OS_TARGET("avx2") static void streamingCopyAvx2(void* dest, const void* src, size_t n) {
+  OS_STREAMING_COPY(__m256i, _mm256_loadu_si256, _mm256_stream_si256)
+}
+
+OS_TARGET("avx512f") static void streamingCopyAvx512(void* dest, const void* src, size_t n) {
+  OS_STREAMING_COPY(__m512i, _mm512_loadu_si512, _mm512_stream_si512)
+}
+
+#undef OS_STREAMING_COPY
+#undef OS_TARGET
+
+typedef void (*StreamingCopy)(void* dest, const void* src, size_t n);
+
+//! Selects the widest streaming copy, supported by the CPU and OS
+static StreamingCopy selectStreamingCopy() {
+  int regs[4];
+  Os::cpuid(regs, 0);
+  const int maxLeaf = regs[0];
+  Os::cpuid(regs, 1);
+  // OSXSAVE and AVX
+  const bool avx = ((regs[2] & (1 << 27)) != 0) && ((regs[2] & (1 << 28)) != 0);
+  if (!avx || (maxLeaf < 7)) {
+    return streamingCopySse2;
+  }
+  const uint64_t xcr0 = Os::xgetbv(0);
+  Os::cpuid(regs, 7);
+  // AVX-512F with the opmask, upper ZMM and ZMM16-31 states enabled by OS
+  if (((regs[1] & (1 << 16)) != 0) && ((xcr0 & 0xe6) == 0xe6)) {
+    return streamingCopyAvx512;
+  }
+  // AVX2 with the XMM and YMM states enabled by OS
+  if (((regs[1] & (1 << 5)) != 0) && ((xcr0 & 0x6) == 0x6)) {
+    return streamingCopyAvx2;
+  }
+  return streamingCopySse2;
+}
+
+static const StreamingCopy streamingCopy = selectStreamingCopy();
+#endif  // ATI_ARCH_X86
+
+void* Os::streamingMemcpy(void* dest, const void* src, size_t n) {
+#if defined(ATI_ARCH_X86)
+  // Small copies don't fill a write combining buffer
+  if (n >= 256) {
+    streamingCopy(dest, src, n);
+    return dest;
+  }
+#endif  // ATI_ARCH_X86
+  return memcpy(dest, src, n);
+}
+
+namespace {
+//! The host threads for the parallel operations. The threads are never destroyed,
+//! since the operations can run in the static destructors
+class HostThreads {
+ public:
+  //! Returns the pool of the threads or nullptr if the parallel operations are disabled
+  static HostThreads* get() {
+    if (AMD_PARALLEL_COPY_THREADS <= 1) {
+      return nullptr;
+    }
+    static HostThreads* threads = new HostThreads(AMD_PARALLEL_COPY_THREADS - 1);
+    return threads;
+  }
+
+  //! Splits the range between the threads, the caller runs the first part.
+  //! Returns false if the threads are busy with another operation
+  bool run(size_t count, const std::function<void(size_t, size_t)>& body) {
+    std::unique_lock<std::mutex> runLock(runLock_, std::try_to_lock);
+    if (!runLock.owns_lock()) {
+      return false;
+    }
+    const size_t numParts = threads_.size() + 1;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      body_ = &body;
+      count_ = count;
+      numParts_ = numParts;
+      pending_ = threads_.size();
+      ++generation_;
+    }
+    start_.notify_all();
+
+    body(0, count / numParts);
+
+    std::unique_lock<std::mutex> lock(lock_);
+    done_.wait(lock, [this]() { return pending_ == 0; });
+    body_ = nullptr;
+    return true;
+  }
+
+ private:
+  explicit HostThreads(uint numThreads) {
+    for (uint i = 0; i < numThreads; ++i) {
+      threads_.emplace_back(&HostThreads::loop, this, i + 1);
+      threads_.back().detach();
+    }
+  }
+
+  void loop(size_t part) {
+    uint64_t generation = 0;
+    for (;;) {
+      std::unique_lock<std::mutex> lock(lock_);
+      start_.wait(lock, [&]() { return generation_ != generation; });
+      generation = generation_;
+      const std::function<void(size_t, size_t)>& body = *body_;
+      const size_t begin = count_ * part / numParts_;
+      const size_t end = count_ * (part + 1) / numParts_;
+      lock.unlock();
+
+      if (begin < end) {
+        body(begin, end);
+      }
+
+      lock.lock();
+      if (--pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  std::mutex runLock_;                //!< Serializes the parallel operations
+  std::mutex lock_;                   //!< Protects the operation parameters
+  std::condition_variable start_;     //!< Wakes the threads for a new operation
+  std::condition_variable done_;      //!< Wakes the caller when all parts are done
+  std::vector<std::thread> threads_;  //!< The host threads
+  const std::function<void(size_t, size_t)>* body_ = nullptr;  //!< The current operation
+  size_t count_ = 0;                  //!< The range size of the current operation
+  size_t numParts_ = 1;               //!< The number of parts of the range
+  size_t pending_ = 0;                //!< The number of the unfinished parts
+  uint64_t generation_ = 0;           //!< The operation counter
+};
+}  // namespace
+
+void Os::parallelFor(size_t count, const std::function<void(size_t, size_t)>& body) {
+  HostThreads* threads = (count > 1) ? HostThreads::get() : nullptr;
+  if ((threads == nullptr) || !threads->run(count, body)) {
+    body(0, count);
+  }
+}
+
+void* Os::parallelMemcpy(void* dest, const void* src, size_t n, bool streaming) {
+  if ((n >= AMD_PARALLEL_COPY_SIZE * Ki) && (HostThreads::get() != nullptr)) {
+    // Split at the page boundaries, so the parts don't share cache lines
+    constexpr size_t kPageSize = 4 * Ki;
+    char* dst = reinterpret_cast<char*>(dest);
+    const char* s = reinterpret_cast<const char*>(src);
+    parallelFor(amd::alignUp(n, kPageSize) / kPageSize, [=](size_t begin, size_t end) {
+      const size_t offset = begin * kPageSize;
+      const size_t size = std::min(end * kPageSize, n) - offset;
+      if (streaming) {
+        streamingMemcpy(dst + offset, s + offset, size);
+      } else {
+        memcpy(dst + offset, s + offset, size);
+      }
+    });
+    return dest;
+  }
+  return streaming ? streamingMemcpy(dest, src, n) : fastMemcpy(dest, src, n);
+}
+
 }  // namespace amd
@@ -24,6 +24,7 @@
 #include "top.hpp"
 #include "utils/util.hpp"
 
+#include <functional>
 #include <vector>
 #include <string>
 
@@ -181,8 +182,15 @@ class Os : AllStatic {
   static void setThreadAffinity(const void* handle, const ThreadAffinityMask& mask);
   //! Set the currently running thread's name.
   static void setCurrentThreadName(const char* name);
+  //! Set the currently running thread's scheduling priority relative to the default,
+  //! from -2 (lowest) to 2 (highest). Returns false if the OS denied the change
+  static bool setCurrentThreadPriority(int level);
   //! Set current threads affinity to that of main thread
   static bool setThreadAffinityToMainThread();
+  //! Returns the NUMA node of the PCI device or -1 if the node is unknown
+  static int getPciNumaNode(uint32_t domain, uint32_t bus, uint32_t device, uint32_t function);
+  //! Gets the cpu mask of the NUMA node. Returns false if the node is unknown
+  static bool getNumaNodeCpus(int node, ThreadAffinityMask* mask);
 
   //! Check if the thread is alive
   static bool isThreadAlive(const Thread& osThread);
@@ -193,6 +201,14 @@ class Os : AllStatic {
   static void yield();
   //! Execute a pause instruction (for spin loops).
   static void spinPause();
+  //! Park the thread while the word at the address has the value. It may return spuriously
+  static void waitOnAddress(const volatile int32_t* address, int32_t value);
+  //! Park the thread while the word has the value, but not longer than the timeout in ms
+  static void waitOnAddress(const volatile int32_t* address, int32_t value, uint millis);
+  //! Wake all threads, parked on the address
+  static void wakeOnAddress(const volatile int32_t* address);
+  //! Wake one thread, parked on the address
+  static void wakeOneOnAddress(const volatile int32_t* address);
 
   // Memory routines:
   //
@@ -221,6 +237,14 @@ class Os : AllStatic {
 
   //! Platform-specific optimized memcpy()
   static void* fastMemcpy(void* dest, const void* src, size_t n);
+  //! memcpy() with the non-temporal stores for the write combined and staging destinations,
+  //! which CPU doesn't read back
+  static void* streamingMemcpy(void* dest, const void* src, size_t n);
+  //! Splits big copies between the host threads with AMD_PARALLEL_COPY_THREADS
+  static void* parallelMemcpy(void* dest, const void* src, size_t n, bool streaming = false);
+  //! Runs body(begin, end) over the parts of [0, count) on the host threads. The range
+  //! runs on the calling thread, if the threads are disabled or busy
+  static void parallelFor(size_t count, const std::function<void(size_t, size_t)>& body);
 
   // File/Path helper routines:
   //
@@ -272,6 +296,25 @@ class Os : AllStatic {
   //! Deletes file
   static int unlink(const std::string& path);
 
+  //! Renames file. An existing destination file is atomically replaced
+  static bool renameFile(const std::string& from, const std::string& to);
+
+  //! Updates the modification time of the file to the current time
+  static bool touchFile(const std::string& path);
+
+  //! Regular file attributes, returned by the directory enumeration
+  struct FileInfo {
+    std::string name_;  //!< File name without the path
+    size_t size_;       //!< File size in bytes
+    uint64_t time_;     //!< Last modification time in seconds since the epoch
+  };
+
+  //! Enumerates the regular files in the directory
+  static bool listFiles(const std::string& path, std::vector<FileInfo>* files);
+
+  //! Returns the attributes of the regular file
+  static bool fileInfo(const std::string& path, FileInfo* info);
+
   // Library routines:
   //
   typedef bool (*SymbolCallback)(std::string, const void*, void*);
@@ -29,10 +29,13 @@
 #include <stdarg.h>
 
 #include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/wait.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #include <sys/sysinfo.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -41,6 +44,7 @@
 #include <signal.h>
 
 #include <sys/prctl.h>
+#include <linux/futex.h>
 
 #include <link.h>
 #include <time.h>
@@ -60,6 +64,10 @@
 #include <algorithm>
 #include <mutex>
 
+#if defined(ATI_ARCH_X86)
+#include <x86intrin.h>
+#endif  // ATI_ARCH_X86
+
 
 namespace amd {
 
@@ -306,6 +314,13 @@ void Os::currentStackInfo(address* base, size_t* size) {
 
 void Os::setCurrentThreadName(const char* name) { ::prctl(PR_SET_NAME, name); }
 
+bool Os::setCurrentThreadPriority(int level) {
+  // Linux applies the nice value to the thread id. A raise requires CAP_SYS_NICE
+  static constexpr int kNicePerLevel = 5;
+  const int nice = -std::max(-2, std::min(level, 2)) * kNicePerLevel;
+  return ::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), nice) == 0;
+}
+
 
 void* Thread::entry(Thread* thread) {
   sigset_t set;
@@ -408,14 +423,163 @@ bool Os::setThreadAffinityToMainThread() {
   return true;
 }
 
+int Os::getPciNumaNode(uint32_t domain, uint32_t bus, uint32_t device, uint32_t function) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "/sys/bus/pci/devices/%04x:%02x:%02x.%x/numa_node", domain, bus,
+           device, function);
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return -1;
+  }
+  int node = -1;
+  if (fscanf(file, "%d", &node) != 1) {
+    node = -1;
+  }
+  fclose(file);
+  return node;
+}
+
+bool Os::getNumaNodeCpus(int node, ThreadAffinityMask* mask) {
+  if (node < 0) {
+    return false;
+  }
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return false;
+  }
+  // The list has the ranges of cpus, i.e. "0-15,32-47"
+  mask->init();
+  uint first = 0;
+  while (fscanf(file, "%u", &first) == 1) {
+    uint last = first;
+    int delimiter = fgetc(file);
+    if (delimiter == '-') {
+      if (fscanf(file, "%u", &last) != 1) {
+        break;
+      }
+      delimiter = fgetc(file);
+    }
+    for (uint cpu = first; (cpu <= last) && (cpu < CPU_SETSIZE); ++cpu) {
+      mask->set(cpu);
+    }
+    if (delimiter != ',') {
+      break;
+    }
+  }
+  fclose(file);
+  return !mask->isEmpty();
+}
+
 void Os::yield() { ::sched_yield(); }
 
-uint64_t Os::timeNanos() {
+void Os::waitOnAddress(const volatile int32_t* address, int32_t value) {
+  ::syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0);
+}
+
+void Os::waitOnAddress(const volatile int32_t* address, int32_t value, uint millis) {
+  struct timespec timeout;
+  timeout.tv_sec = millis / 1000;
+  timeout.tv_nsec = static_cast<long>(millis % 1000) * 1000000;
+  ::syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, &timeout, nullptr, 0);
+}
+
+void Os::wakeOnAddress(const volatile int32_t* address) {
+  ::syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void Os::wakeOneOnAddress(const volatile int32_t* address) {
+  ::syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+static uint64_t monotonicNanos() {
   struct timespec tp;
   ::clock_gettime(CLOCK_MONOTONIC, &tp);
   return (uint64_t)tp.tv_sec * (1000ULL * 1000ULL * 1000ULL) + (uint64_t)tp.tv_nsec;
 }
 
+#if defined(ATI_ARCH_X86)
+namespace {
+//! The clock on the invariant TSC. The TSC rate is measured against CLOCK_MONOTONIC
+//! over the first interval of the process, so both clocks report the same time domain.
+//! The process uses clock_gettime() until the calibration is done
+class TscClock {
+ public:
+  //! Returns TRUE if the TSC rate is known
+  bool ready() const { return state_.load(std::memory_order_acquire) == kReady; }
+
+  //! Converts the TSC value into the time in ns
+  uint64_t nanos(uint64_t tsc) const {
+    return nsBase_ + static_cast<int64_t>(static_cast<int64_t>(tsc - tscBase_) * nsPerTick_);
+  }
+
+  //! Advances the calibration with the current monotonic time
+  void calibrate(uint64_t now) {
+    uint32_t state = state_.load(std::memory_order_acquire);
+    if (state == kUnknown) {
+      if (state_.compare_exchange_strong(state, kBusy)) {
+        tscBase_ = __rdtsc();
+        nsBase_ = now;
+        state_.store((AMD_TSC_CLOCK && invariant()) ? kCalibrating : kDisabled,
+                     std::memory_order_release);
+      }
+    } else if ((state == kCalibrating) && ((now - nsBase_) >= kCalibrationNanos)) {
+      if (state_.compare_exchange_strong(state, kBusy)) {
+        const uint64_t tsc = __rdtsc();
+        const uint64_t ns = monotonicNanos();
+        if (tsc <= tscBase_) {
+          state_.store(kDisabled, std::memory_order_release);
+          return;
+        }
+        nsPerTick_ = static_cast<double>(ns - nsBase_) / (tsc - tscBase_);
+        tscBase_ = tsc;
+        nsBase_ = ns;
+        state_.store(kReady, std::memory_order_release);
+      }
+    }
+  }
+
+ private:
+  enum State : uint32_t { kUnknown, kBusy, kCalibrating, kReady, kDisabled };
+
+  //! The interval of the TSC rate measurement (50ms)
+  static constexpr uint64_t kCalibrationNanos = 50 * 1000 * 1000;
+
+  //! Returns TRUE if TSC runs at the constant rate in all power states
+  static bool invariant() {
+    int regs[4];
+    Os::cpuid(regs, 0x80000000);
+    if (static_cast<uint32_t>(regs[0]) < 0x80000007) {
+      return false;
+    }
+    Os::cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+  }
+
+  std::atomic<uint32_t> state_{kUnknown};  //!< The calibration state
+  uint64_t tscBase_ = 0;                    //!< TSC value of the base point
+  uint64_t nsBase_ = 0;                     //!< Monotonic time of the base point
+  double nsPerTick_ = 0;                    //!< The measured TSC period in ns
+};
+
+TscClock tscClock;
+}  // namespace
+#endif  // ATI_ARCH_X86
+
+uint64_t Os::timeNanos() {
+#if defined(ATI_ARCH_X86)
+  if (tscClock.ready()) {
+    return tscClock.nanos(__rdtsc());
+  }
+  const uint64_t now = monotonicNanos();
+  tscClock.calibrate(now);
+  return now;
+#else   // !ATI_ARCH_X86
+  return monotonicNanos();
+#endif  // !ATI_ARCH_X86
+}
+
 uint64_t Os::timerResolutionNanos() {
   static uint64_t resolution = 0;
   if (resolution == 0) {
@@ -633,6 +797,42 @@ std::string Os::getTempFileName() {
 
 int Os::unlink(const std::string& path) { return ::unlink(path.c_str()); }
 
+bool Os::renameFile(const std::string& from, const std::string& to) {
+  return ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool Os::touchFile(const std::string& path) {
+  return ::utimensat(AT_FDCWD, path.c_str(), nullptr, 0) == 0;
+}
+
+bool Os::listFiles(const std::string& path, std::vector<FileInfo>* files) {
+  DIR* dir = ::opendir(path.c_str());
+  if (dir == nullptr) {
+    return false;
+  }
+  while (struct dirent* entry = ::readdir(dir)) {
+    struct stat st;
+    const std::string name = entry->d_name;
+    if ((::fstatat(::dirfd(dir), name.c_str(), &st, 0) == 0) && S_ISREG(st.st_mode)) {
+      files->push_back({name, static_cast<size_t>(st.st_size),
+                        static_cast<uint64_t>(st.st_mtime)});
+    }
+  }
+  ::closedir(dir);
+  return true;
+}
+
+bool Os::fileInfo(const std::string& path, FileInfo* info) {
+  struct stat st;
+  if ((::stat(path.c_str(), &st) != 0) || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+  const size_t separator = path.find_last_of('/');
+  *info = {(separator == std::string::npos) ? path : path.substr(separator + 1),
+           static_cast<size_t>(st.st_size), static_cast<uint64_t>(st.st_mtime)};
+  return true;
+}
+
 #if defined(ATI_ARCH_X86)
 void Os::cpuid(int regs[4], int info) {
 #ifdef _LP64
@@ -641,14 +841,14 @@ void Os::cpuid(int regs[4], int info) {
       "cpuid;"
       "xchgq %%rbx, %%rsi;"
       : "=a"(regs[0]), "=S"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
-      : "a"(info));
+      : "a"(info), "2"(0));
 #else
   __asm__ __volatile__(
       "movl %%ebx, %%esi;"
       "cpuid;"
       "xchgl %%ebx, %%esi;"
       : "=a"(regs[0]), "=S"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
-      : "a"(info));
+      : "a"(info), "2"(0));
 #endif
 }
 
@@ -776,20 +976,23 @@ bool Os::MemoryMapFileDesc(FileDesc fdesc, size_t fsize, size_t foffset, const v
     return false;
   }
 
-  // If the offset is not aligned then align it
-  // and recalculate the new size
-  if (foffset > 0) {
-    size_t old_foffset = foffset;
-    foffset = alignUp(foffset, pageSize());
-    fsize += (foffset - old_foffset);
+  // mmap requires a page aligned offset, hence map from the page start
+  // and return the pointer to the requested offset
+  size_t delta = foffset - alignDown(foffset, pageSize());
+  void* ptr = mmap(NULL, fsize + delta, PROT_READ, MAP_SHARED, fdesc, foffset - delta);
+  if (ptr == MAP_FAILED) {
+    return false;
   }
 
-  *mmap_ptr = mmap(NULL, fsize, PROT_READ, MAP_SHARED, fdesc, foffset);
+  *mmap_ptr = reinterpret_cast<const char*>(ptr) + delta;
   return true;
 }
 
 bool Os::MemoryUnmapFile(const void* mmap_ptr, size_t mmap_size) {
-  if (munmap(const_cast<void*>(mmap_ptr), mmap_size) != 0) {
+  // The mapping can start at an unaligned file offset
+  size_t delta = reinterpret_cast<uintptr_t>(mmap_ptr) & (pageSize() - 1);
+  if (munmap(const_cast<char*>(reinterpret_cast<const char*>(mmap_ptr)) - delta,
+             mmap_size + delta) != 0) {
     return false;
   }
 
@@ -817,7 +1020,8 @@ bool Os::MemoryMapFile(const char* fname, const void** mmap_ptr, size_t* mmap_si
 
   close(fd);
 
-  if (*mmap_ptr == nullptr) {
+  if ((*mmap_ptr == nullptr) || (*mmap_ptr == MAP_FAILED)) {
+    *mmap_ptr = nullptr;
     return false;
   }
 
@@ -29,6 +29,9 @@
 #include <time.h>
 #include <intrin.h>
 
+// WaitOnAddress and WakeByAddressAll
+#pragma comment(lib, "Synchronization.lib")
+
 #include <atomic>
 #include <vector>
 #include <string>
@@ -250,6 +253,11 @@ static void SetThreadName(DWORD threadId, const char* name) {
 
 void Os::setCurrentThreadName(const char* name) { SetThreadName(GetCurrentThreadId(), name); }
 
+bool Os::setCurrentThreadPriority(int level) {
+  // THREAD_PRIORITY_LOWEST (-2) .. THREAD_PRIORITY_HIGHEST (2) match the levels
+  return ::SetThreadPriority(::GetCurrentThread(), std::max(-2, std::min(level, 2))) != 0;
+}
+
 static LONG WINAPI divExceptionFilter(struct _EXCEPTION_POINTERS* ep) {
   DWORD code = ep->ExceptionRecord->ExceptionCode;
 
@@ -344,8 +352,40 @@ void Os::setThreadAffinity(const void* handle, const Os::ThreadAffinityMask& mas
 bool Os::setThreadAffinityToMainThread() {
   return true;
 }
+
+int Os::getPciNumaNode(uint32_t domain, uint32_t bus, uint32_t device, uint32_t function) {
+  // The PCI device topology isn't available without the driver
+  return -1;
+}
+
+bool Os::getNumaNodeCpus(int node, ThreadAffinityMask* mask) {
+  GROUP_AFFINITY affinity = {};
+  if ((node < 0) || (pfnGetNumaNodeProcessorMaskEx == NULL) ||
+      !pfnGetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity)) {
+    return false;
+  }
+  mask->init();
+  mask->set(affinity.Group, affinity.Mask);
+  return !mask->isEmpty();
+}
 void Os::yield() { ::SwitchToThread(); }
 
+void Os::waitOnAddress(const volatile int32_t* address, int32_t value) {
+  ::WaitOnAddress(const_cast<volatile int32_t*>(address), &value, sizeof(value), INFINITE);
+}
+
+void Os::waitOnAddress(const volatile int32_t* address, int32_t value, uint millis) {
+  ::WaitOnAddress(const_cast<volatile int32_t*>(address), &value, sizeof(value), millis);
+}
+
+void Os::wakeOnAddress(const volatile int32_t* address) {
+  ::WakeByAddressAll(const_cast<int32_t*>(address));
+}
+
+void Os::wakeOneOnAddress(const volatile int32_t* address) {
+  ::WakeByAddressSingle(const_cast<int32_t*>(address));
+}
+
 uint64_t Os::timeNanos() {
   LARGE_INTEGER current;
   QueryPerformanceCounter(&current);
@@ -503,6 +543,64 @@ std::string Os::getTempFileName() {
 
 int Os::unlink(const std::string& path) { return ::_unlink(path.c_str()); }
 
+bool Os::renameFile(const std::string& from, const std::string& to) {
+  return MoveFileEx(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool Os::touchFile(const std::string& path) {
+  HANDLE file = CreateFile(path.c_str(), FILE_WRITE_ATTRIBUTES,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  FILETIME time;
+  GetSystemTimeAsFileTime(&time);
+  bool result = SetFileTime(file, NULL, NULL, &time) != 0;
+  CloseHandle(file);
+  return result;
+}
+
+bool Os::listFiles(const std::string& path, std::vector<FileInfo>* files) {
+  WIN32_FIND_DATA data;
+  HANDLE find = FindFirstFile((path + "\\*").c_str(), &data);
+  if (find == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  do {
+    if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+      ULARGE_INTEGER size, time;
+      size.LowPart = data.nFileSizeLow;
+      size.HighPart = data.nFileSizeHigh;
+      time.LowPart = data.ftLastWriteTime.dwLowDateTime;
+      time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+      // FILETIME is in 100ns intervals since 1601, convert it to the Unix time
+      files->push_back({data.cFileName, static_cast<size_t>(size.QuadPart),
+                        time.QuadPart / 10000000ULL - 11644473600ULL});
+    }
+  } while (FindNextFile(find, &data));
+  FindClose(find);
+  return true;
+}
+
+bool Os::fileInfo(const std::string& path, FileInfo* info) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data) ||
+      ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)) {
+    return false;
+  }
+  ULARGE_INTEGER size, time;
+  size.LowPart = data.nFileSizeLow;
+  size.HighPart = data.nFileSizeHigh;
+  time.LowPart = data.ftLastWriteTime.dwLowDateTime;
+  time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+  const size_t separator = path.find_last_of("\\/");
+  // FILETIME is in 100ns intervals since 1601, convert it to the Unix time
+  *info = {(separator == std::string::npos) ? path : path.substr(separator + 1),
+           static_cast<size_t>(size.QuadPart), time.QuadPart / 10000000ULL - 11644473600ULL};
+  return true;
+}
+
 void Os::cpuid(int regs[4], int info) { return __cpuid(regs, info); }
 
 uint64_t Os::xgetbv(uint32_t ecx) { return (uint64_t)_xgetbv(ecx); }
@@ -863,18 +961,30 @@ bool Os::MemoryMapFileDesc(FileDesc fdesc, size_t fsize, size_t foffset, const v
   HANDLE map_handle = INVALID_HANDLE_VALUE;
 
   map_handle = CreateFileMappingA(fdesc, NULL, PAGE_READONLY, 0, 0, NULL);
-  if (map_handle == INVALID_HANDLE_VALUE) {
-    CloseHandle(map_handle);
+  if (map_handle == NULL) {
     return false;
   }
 
-  *mmap_ptr = MapViewOfFile(map_handle, FILE_MAP_READ, 0,0,0);
+  // The view offset must be aligned to the allocation granularity, hence map from
+  // the aligned offset and return the pointer to the requested offset
+  size_t delta = foffset - alignDown(foffset, allocationGranularity_);
+  uint64_t offset = foffset - delta;
+  void* ptr = MapViewOfFile(map_handle, FILE_MAP_READ, static_cast<DWORD>(offset >> 32),
+                            static_cast<DWORD>(offset), (fsize != 0) ? (fsize + delta) : 0);
+  // The view keeps the mapping object alive
+  CloseHandle(map_handle);
+  if (ptr == nullptr) {
+    return false;
+  }
 
+  *mmap_ptr = reinterpret_cast<const char*>(ptr) + delta;
   return true;
 }
 
 bool Os::MemoryUnmapFile(const void* mmap_ptr, size_t mmap_size) {
-  if(!UnmapViewOfFile(mmap_ptr)) {
+  // The view can start at an unaligned file offset
+  size_t delta = reinterpret_cast<uintptr_t>(mmap_ptr) & (allocationGranularity_ - 1);
+  if (!UnmapViewOfFile(reinterpret_cast<const char*>(mmap_ptr) - delta)) {
     return false;
   }
 
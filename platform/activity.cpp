@@ -19,9 +19,149 @@
  THE SOFTWARE. */
 
 #include "platform/activity.hpp"
+#include "os/os.hpp"
+#include "thread/thread.hpp"
+#include "utils/debug.hpp"
+#include "utils/flags.hpp"
 
 ACTIVITY_PROF_INSTANCES();
 
+#if USE_PROF_API
+namespace activity_prof {
+
+//! The thread, which delivers the buffered records to the tracer
+class DrainThread : public amd::Thread {
+ public:
+  DrainThread() : amd::Thread("Activity Buffer Drain", CQ_THREAD_STACK_SIZE) {}
+
+  //! The drain thread entry point
+  void run(void* data) { ActivityBuffer::drainLoop(); }
+};
+
+// ================================================================================================
+ActivityBuffer::Ring::Ring() : writeIndex_(0), readIndex_(0) {
+  for (uint32_t i = 0; i < kRingSize; ++i) {
+    slots_[i].sequence_.store(i, std::memory_order_relaxed);
+  }
+}
+
+// ================================================================================================
+bool ActivityBuffer::Ring::push(const activity_record_t& record) {
+  uint64_t index = writeIndex_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = slots_[index % kRingSize];
+    const int64_t diff = static_cast<int64_t>(slot.sequence_.load(std::memory_order_acquire)) -
+                         static_cast<int64_t>(index);
+    if (diff == 0) {
+      // The slot is free, so try to claim it
+      if (writeIndex_.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+        slot.record_ = record;
+        // Publish the record to the reader
+        slot.sequence_.store(index + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // The reader didn't free the slot from the previous lap yet
+      return false;
+    } else {
+      // Another writer claimed the slot
+      index = writeIndex_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// ================================================================================================
+bool ActivityBuffer::Ring::pop(activity_record_t* record) {
+  Slot& slot = slots_[readIndex_ % kRingSize];
+  if (slot.sequence_.load(std::memory_order_acquire) != (readIndex_ + 1)) {
+    return false;
+  }
+  *record = slot.record_;
+  // Free the slot for the writers on the next lap
+  slot.sequence_.store(readIndex_ + kRingSize, std::memory_order_release);
+  ++readIndex_;
+  return true;
+}
+
+// ================================================================================================
+ActivityBuffer::Ring* ActivityBuffer::ring(uint64_t queueId) {
+  std::atomic<Ring*>& entry = rings_[queueId % kNumRings];
+  Ring* ring = entry.load(std::memory_order_acquire);
+  if (ring == nullptr) {
+    Ring* created = new Ring();
+    if (entry.compare_exchange_strong(ring, created, std::memory_order_acq_rel)) {
+      ring = created;
+    } else {
+      delete created;
+    }
+  }
+  return ring;
+}
+
+// ================================================================================================
+void ActivityBuffer::write(const activity_record_t& record) {
+  startDrain();
+  Ring* queueRing = ring(record.queue_id);
+  while (!queueRing->push(record)) {
+    // The delivery falls behind, hence drain the rings from the writer
+    flush();
+  }
+}
+
+// ================================================================================================
+void ActivityBuffer::flush() {
+  amd::ScopedLock lock(drainLock_);
+  // The batch is used under the drain lock only
+  static activity_record_t batch[kBatchSize];
+  buffer_callback_fun_t callback = CallbacksTable::get_buffer_callback();
+  uint32_t count = 0;
+  auto deliver = [&]() {
+    // The records are dropped if the tracer was detached
+    if (callback != nullptr) {
+      callback(batch, count, CallbacksTable::get_arg());
+    }
+    count = 0;
+  };
+
+  for (auto& entry : rings_) {
+    Ring* queueRing = entry.load(std::memory_order_acquire);
+    if (queueRing == nullptr) {
+      continue;
+    }
+    while (queueRing->pop(&batch[count])) {
+      if (++count == kBatchSize) {
+        deliver();
+      }
+    }
+  }
+  if (count > 0) {
+    deliver();
+  }
+}
+
+// ================================================================================================
+void ActivityBuffer::startDrain() {
+  std::call_once(drainStarted_, []() {
+    DrainThread* thread = new DrainThread();
+    if ((thread == nullptr) || (thread->state() < amd::Thread::INITIALIZED) ||
+        !thread->start()) {
+      LogWarning("Activity drain thread creation failed, the records are delivered on overflow");
+      delete thread;
+    }
+  });
+}
+
+// ================================================================================================
+void ActivityBuffer::drainLoop() {
+  while (true) {
+    amd::Os::sleep(HIP_ACTIVITY_FLUSH_INTERVAL);
+    flush();
+  }
+}
+
+}  // namespace activity_prof
+#endif
+
 #define CASE_STRING(X, C)  case X: case_string = #C ;break;
 
 const char* getOclCommandKindString(uint32_t op) {
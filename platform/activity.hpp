@@ -37,6 +37,9 @@ enum OpId { OP_ID_DISPATCH = 0, OP_ID_COPY = 1, OP_ID_BARRIER = 2, OP_ID_NUMBER
 #define ACTIVITY_PROF_INSTANCES()                                                                  \
   namespace activity_prof {                                                                        \
   CallbacksTable::table_t CallbacksTable::table_{};                                                \
+  std::atomic<ActivityBuffer::Ring*> ActivityBuffer::rings_[ActivityBuffer::kNumRings]{};          \
+  amd::Monitor ActivityBuffer::drainLock_("Activity buffer drain lock");                          \
+  std::once_flag ActivityBuffer::drainStarted_;                                                    \
   std::atomic<record_id_t> ActivityProf::globe_record_id_(0);                                      \
   }  // activity_prof
 
@@ -47,14 +50,67 @@ typedef uint32_t command_id_t;
 
 typedef activity_id_callback_t id_callback_fun_t;
 typedef activity_async_callback_t callback_fun_t;
+typedef activity_buffer_callback_t buffer_callback_fun_t;
 typedef void* callback_arg_t;
 
+// Buffered delivery of the activity records. The records are written into lock-free rings,
+// selected by the queue ID, and a background thread delivers them to the tracer in batches
+class ActivityBuffer {
+ public:
+  static constexpr uint32_t kNumRings = 64;     //!< The number of rings
+  static constexpr uint32_t kRingSize = 1024;   //!< The number of records in a ring
+  static constexpr uint32_t kBatchSize = 256;   //!< Max number of records in one delivery
+
+  //! Writes the record into the ring of the queue. Doesn't invoke the tracer
+  static void write(const activity_record_t& record);
+
+  //! Delivers all buffered records to the tracer
+  static void flush();
+
+ private:
+  //! A record slot in the ring. The sequence number tells the writers and the reader
+  //! if the slot is free or holds a record
+  struct Slot {
+    std::atomic<uint64_t> sequence_;
+    activity_record_t record_;
+  };
+
+  //! Bounded multi-producer ring of the records
+  struct Ring {
+    Ring();
+    //! Returns false if the ring is full
+    bool push(const activity_record_t& record);
+    //! Returns false if the ring is empty. Must be called under the drain lock
+    bool pop(activity_record_t* record);
+
+    alignas(64) std::atomic<uint64_t> writeIndex_;  //!< The next slot for a writer
+    alignas(64) uint64_t readIndex_;                //!< The next slot for the reader
+    Slot slots_[kRingSize];
+  };
+
+  //! Returns the ring for the queue, creates it on the first use
+  static Ring* ring(uint64_t queueId);
+
+  //! Starts the delivery thread on the first use
+  static void startDrain();
+
+  //! Delivers the records on the interval
+  static void drainLoop();
+
+  friend class DrainThread;
+
+  static std::atomic<Ring*> rings_[kNumRings];  //!< The rings, indexed by the queue ID
+  static amd::Monitor drainLock_;               //!< Serializes the deliveries
+  static std::once_flag drainStarted_;          //!< The delivery thread is started once
+};
+
 // Activity callbacks table
 class CallbacksTable {
  public:
   struct table_t {
     id_callback_fun_t id_callback;
     callback_fun_t op_callback;
+    buffer_callback_fun_t buffer_callback;
     callback_arg_t arg;
     std::atomic<bool> enabled[OP_ID_NUMBER];
   };
@@ -62,8 +118,24 @@ class CallbacksTable {
   // Initialize record id callback and activity callback
   static void init(const id_callback_fun_t& id_callback, const callback_fun_t& op_callback,
                    const callback_arg_t& arg) {
+    // Deliver the records, buffered with the previous tracer
+    ActivityBuffer::flush();
     table_.id_callback = id_callback;
     table_.op_callback = op_callback;
+    table_.buffer_callback = nullptr;
+    table_.arg = arg;
+  }
+
+  // Initialize record id callback and buffered activity callback. The records are delivered
+  // in batches from a background thread. Record id callback is optional, since the records
+  // carry the correlation id
+  static void initBuffered(const id_callback_fun_t& id_callback,
+                           const buffer_callback_fun_t& buffer_callback,
+                           const callback_arg_t& arg) {
+    ActivityBuffer::flush();
+    table_.id_callback = id_callback;
+    table_.op_callback = nullptr;
+    table_.buffer_callback = buffer_callback;
     table_.arg = arg;
   }
 
@@ -83,6 +155,7 @@ class CallbacksTable {
 
   static id_callback_fun_t get_id_callback() { return table_.id_callback; }
   static callback_fun_t get_op_callback() { return table_.op_callback; }
+  static buffer_callback_fun_t get_buffer_callback() { return table_.buffer_callback; }
   static callback_arg_t get_arg() { return table_.arg; }
 
  private:
@@ -107,7 +180,10 @@ class ActivityProf {
       queue_id_ = queue_id;
       device_id_ = device_id;
       record_id_ = globe_record_id_.fetch_add(1, std::memory_order_relaxed);
-      (CallbacksTable::get_id_callback())(record_id_);
+      id_callback_fun_t id_callback = CallbacksTable::get_id_callback();
+      if (id_callback != nullptr) {
+        id_callback(record_id_);
+      }
     }
   }
 
@@ -141,7 +217,11 @@ class ActivityProf {
         },
         bytes                          // copied data size, for memcpy
     };
-    (CallbacksTable::get_op_callback())(op_id, &record, CallbacksTable::get_arg());
+    if (CallbacksTable::get_buffer_callback() != nullptr) {
+      ActivityBuffer::write(record);
+    } else {
+      (CallbacksTable::get_op_callback())(op_id, &record, CallbacksTable::get_arg());
+    }
   }
 
   command_id_t command_id_; //!< Command ID, executed on the queue
@@ -171,6 +251,8 @@ struct CallbacksTable {
   static void init(const id_callback_fun_t& id_callback, const callback_fun_t& op_callback,
                    const callback_arg_t& arg) {}
   static bool SetEnabled(const op_id_t& op_id, const bool& enable) { return false; }
+  static void initBuffered(const id_callback_fun_t& id_callback,
+                           const callback_fun_t& buffer_callback, const callback_arg_t& arg) {}
 };
 
 class ActivityProf {
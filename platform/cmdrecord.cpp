@@ -0,0 +1,353 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "platform/cmdrecord.hpp"
+#include "platform/command.hpp"
+#include "platform/commandqueue.hpp"
+#include "platform/kernel.hpp"
+#include "platform/memory.hpp"
+#include "platform/program.hpp"
+#include "device/device.hpp"
+#include "device/devprogram.hpp"
+#include "os/os.hpp"
+#include "thread/monitor.hpp"
+#include "utils/debug.hpp"
+#include "utils/flags.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace amd {
+
+bool CommandRecorder::enabled_ = false;
+
+namespace {
+
+//! Serializes the payload of a record
+class Writer {
+ public:
+  template <typename T> void put(const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    data_.insert(data_.end(), bytes, bytes + sizeof(T));
+  }
+  void put(const void* data, size_t size) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    data_.insert(data_.end(), bytes, bytes + size);
+  }
+  void putCoord(const Coord3D& coord) {
+    for (uint i = 0; i < 3; ++i) {
+      put(static_cast<uint64_t>(coord[i]));
+    }
+  }
+
+  const std::vector<uint8_t>& data() const { return data_; }
+
+ private:
+  std::vector<uint8_t> data_;  //!< The payload
+};
+
+//! The recording state. The lock is recursive, since the object IDs are resolved
+//! while the command record is built
+Monitor recordLock("Command recorder lock", true);
+FILE* recordFile = nullptr;
+uint64_t startTime = 0;
+uint32_t lastId = 0;
+std::unordered_map<const HostQueue*, uint32_t> queues;
+std::unordered_map<const Memory*, uint32_t> memories;
+std::unordered_map<const Program*, uint32_t> programs;
+std::unordered_map<const Event*, uint32_t> commands;
+
+//! The limit of the tracked commands. Only the commands in the wait lists are looked up and
+//! the new commands overwrite the reused addresses, hence the map is just reset over the limit
+constexpr size_t kMaxTrackedCommands = 64 * Ki;
+
+//! Closes the file on the process exit, since the runtime doesn't tear down
+struct RecordCloser {
+  ~RecordCloser() {
+    ScopedLock lock(recordLock);
+    if (recordFile != nullptr) {
+      fclose(recordFile);
+      recordFile = nullptr;
+    }
+  }
+} recordCloser;
+
+// ================================================================================================
+void writeRecord(CommandRecorder::RecordKind kind, const Writer& payload) {
+  const CommandRecorder::RecordHeader header = {kind, 0,
+                                                static_cast<uint32_t>(payload.data().size())};
+  fwrite(&header, sizeof(header), 1, recordFile);
+  fwrite(payload.data().data(), 1, payload.data().size(), recordFile);
+}
+
+// ================================================================================================
+void CL_CALLBACK memoryDestroyed(cl_mem memobj, void* data) {
+  ScopedLock lock(recordLock);
+  memories.erase(as_amd(memobj));
+}
+
+
+// ================================================================================================
+uint32_t queueId(const HostQueue& queue) {
+  auto it = queues.find(&queue);
+  if (it != queues.end()) {
+    return it->second;
+  }
+  const uint32_t id = ++lastId;
+  queues[&queue] = id;
+  Writer writer;
+  writer.put(id);
+  writer.put(static_cast<uint32_t>(queue.device().index()));
+  writer.put(static_cast<uint64_t>(queue.properties().value_));
+  writeRecord(CommandRecorder::kQueue, writer);
+  return id;
+}
+
+// ================================================================================================
+uint32_t memoryId(Memory& memory) {
+  auto it = memories.find(&memory);
+  if (it != memories.end()) {
+    return it->second;
+  }
+  const uint32_t parent = (memory.parent() != nullptr) ? memoryId(*memory.parent()) : 0;
+  const uint32_t id = ++lastId;
+  memories[&memory] = id;
+  // The address of a destroyed object can be reused, so the ID must go with the object
+  memory.setDestructorCallback(memoryDestroyed, nullptr);
+
+  Writer writer;
+  writer.put(id);
+  writer.put(parent);
+  writer.put(static_cast<uint64_t>(memory.getOrigin()));
+  writer.put(static_cast<uint64_t>(memory.getSize()));
+  writer.put(static_cast<uint64_t>(memory.getMemFlags()));
+  writer.put(static_cast<uint32_t>(memory.getType()));
+  writer.put(static_cast<uint32_t>(memory.getSvmPtr() != nullptr));
+  writeRecord(CommandRecorder::kMemory, writer);
+  return id;
+}
+
+// ================================================================================================
+uint32_t programId(Program& program, const Device& device) {
+  auto it = programs.find(&program);
+  if (it != programs.end()) {
+    return it->second;
+  }
+  const uint32_t id = ++lastId;
+  // Programs don't have the destructor callbacks, hence the recorded ones stay alive
+  program.retain();
+  programs[&program] = id;
+
+  const device::Program* devProgram = program.getDeviceProgram(device);
+  const device::Program::binary_t binary =
+      (devProgram != nullptr) ? devProgram->binary() : device::Program::binary_t(nullptr, 0);
+  Writer writer;
+  writer.put(id);
+  writer.put(static_cast<uint32_t>(0));
+  writer.put(static_cast<uint64_t>(binary.second));
+  if (binary.first != nullptr) {
+    writer.put(binary.first, binary.second);
+  }
+  writeRecord(CommandRecorder::kProgram, writer);
+  return id;
+}
+
+// ================================================================================================
+void putKernel(Writer& writer, const NDRangeKernelCommand& command, const Device& device) {
+  const Kernel& kernel = command.kernel();
+  const KernelSignature& signature = kernel.signature();
+  writer.put(programId(kernel.program(), device));
+  writer.put(static_cast<uint32_t>(kernel.name().size()));
+  writer.put(kernel.name().data(), kernel.name().size());
+
+  const NDRangeContainer& sizes = command.sizes();
+  writer.put(static_cast<uint32_t>(sizes.dimensions()));
+  for (uint i = 0; i < 3; ++i) {
+    writer.put(static_cast<uint64_t>((i < sizes.dimensions()) ? sizes.offset()[i] : 0));
+  }
+  for (uint i = 0; i < 3; ++i) {
+    writer.put(static_cast<uint64_t>((i < sizes.dimensions()) ? sizes.global()[i] : 1));
+  }
+  for (uint i = 0; i < 3; ++i) {
+    writer.put(static_cast<uint64_t>((i < sizes.dimensions()) ? sizes.local()[i] : 0));
+  }
+  writer.put(command.sharedMemBytes());
+
+  // The direct arguments are serialized from the kernel on the submission, which follows
+  const_address values = command.directArgs() ? kernel.parameters().values() :
+                                                command.parameters();
+  Memory* const* memories = reinterpret_cast<Memory* const*>(
+      command.parameters() + kernel.parameters().memoryObjOffset());
+  writer.put(signature.numParameters());
+  for (uint32_t i = 0; i < signature.numParameters(); ++i) {
+    const KernelParameterDescriptor& desc = signature.at(i);
+    const_address value = values + desc.offset_;
+    if (desc.addressQualifier_ == CL_KERNEL_ARG_ADDRESS_LOCAL) {
+      writer.put(CommandRecorder::kArgLocal);
+      writer.put(static_cast<uint32_t>((desc.size_ == sizeof(uint32_t)) ?
+          *reinterpret_cast<const uint32_t*>(value) : *reinterpret_cast<const uint64_t*>(value)));
+    } else if (desc.type_ == T_POINTER) {
+      Memory* memory = memories[desc.info_.arrayIndex_];
+      void* pointer = nullptr;
+      if (desc.info_.rawPointer_) {
+        pointer = *reinterpret_cast<void* const*>(value);
+        if (memory == nullptr) {
+          memory = MemObjMap::FindMemObj(pointer);
+        }
+      }
+      if (memory != nullptr) {
+        const address base = reinterpret_cast<address>(memory->getSvmPtr());
+        const uint64_t offset = ((pointer != nullptr) && (base != nullptr)) ?
+            reinterpret_cast<address>(pointer) - base : 0;
+        writer.put(CommandRecorder::kArgMemory);
+        writer.put(memoryId(*memory));
+        writer.put(offset);
+      } else {
+        writer.put(CommandRecorder::kArgPointer);
+        writer.put(reinterpret_cast<uint64_t>(pointer));
+      }
+    } else {
+      // Samplers and device queues can't be replayed, so they go as the raw values
+      writer.put(CommandRecorder::kArgValue);
+      writer.put(static_cast<uint32_t>(desc.size_));
+      writer.put(value, desc.size_);
+    }
+  }
+}
+
+}  // namespace
+
+// ================================================================================================
+bool CommandRecorder::init(const char* path) {
+  ScopedLock lock(recordLock);
+  if (enabled_) {
+    return true;
+  }
+  recordFile = fopen(path, "wb");
+  if (recordFile == nullptr) {
+    LogPrintfError("Can't open the command record file: %s", path);
+    return false;
+  }
+  const uint32_t header[] = {kMagic, kVersion};
+  fwrite(header, sizeof(header), 1, recordFile);
+  startTime = Os::timeNanos();
+  enabled_ = true;
+  return true;
+}
+
+// ================================================================================================
+void CommandRecorder::record(const Command& command) {
+  HostQueue* queue = command.queue();
+  if (queue == nullptr) {
+    return;
+  }
+  ScopedLock lock(recordLock);
+  if (recordFile == nullptr) {
+    return;
+  }
+
+  // The objects go ahead of the command, so the replay creates them first
+  Writer payload;
+  switch (command.type()) {
+    case CL_COMMAND_NDRANGE_KERNEL:
+    case CL_COMMAND_TASK:
+      putKernel(payload, static_cast<const NDRangeKernelCommand&>(command), queue->device());
+      break;
+    case CL_COMMAND_READ_BUFFER:
+    case CL_COMMAND_READ_BUFFER_RECT: {
+      const auto& read = static_cast<const ReadMemoryCommand&>(command);
+      payload.put(memoryId(read.source()));
+      payload.putCoord(read.origin());
+      payload.putCoord(read.size());
+      break;
+    }
+    case CL_COMMAND_WRITE_BUFFER:
+    case CL_COMMAND_WRITE_BUFFER_RECT: {
+      const auto& write = static_cast<const WriteMemoryCommand&>(command);
+      payload.put(memoryId(write.destination()));
+      payload.putCoord(write.origin());
+      payload.putCoord(write.size());
+      // The rect writes have the host pitches, so only the linear data is recorded
+      const bool data = AMD_CMD_RECORD_DATA && (command.type() == CL_COMMAND_WRITE_BUFFER);
+      const uint64_t size = data ? write.size()[0] : 0;
+      payload.put(size);
+      if (size != 0) {
+        payload.put(write.source(), size);
+      }
+      break;
+    }
+    case CL_COMMAND_COPY_BUFFER:
+    case CL_COMMAND_COPY_BUFFER_RECT: {
+      const auto& copy = static_cast<const CopyMemoryCommand&>(command);
+      payload.put(memoryId(copy.source()));
+      payload.put(memoryId(copy.destination()));
+      payload.putCoord(copy.srcOrigin());
+      payload.putCoord(copy.dstOrigin());
+      payload.putCoord(copy.size());
+      break;
+    }
+    case CL_COMMAND_FILL_BUFFER: {
+      const auto& fill = static_cast<const FillMemoryCommand&>(command);
+      payload.put(memoryId(fill.memory()));
+      payload.putCoord(fill.origin());
+      payload.putCoord(fill.size());
+      payload.put(static_cast<uint32_t>(fill.patternSize()));
+      payload.put(fill.pattern(), fill.patternSize());
+      break;
+    }
+    default:
+      // The rest of the commands replay as the ordering points only
+      break;
+  }
+
+  const uint32_t queue_id = queueId(*queue);
+  std::vector<uint32_t> waits;
+  for (const auto event : command.eventWaitList()) {
+    // The events, which weren't recorded (i.e. user events), don't order the replay
+    auto it = commands.find(event);
+    if (it != commands.end()) {
+      waits.push_back(it->second);
+    }
+  }
+  // The completion callbacks would change the status processing, so the commands are tracked
+  // by the address only. The waited commands are alive, since the wait list retains them
+  if (commands.size() >= kMaxTrackedCommands) {
+    commands.clear();
+  }
+  const uint32_t id = ++lastId;
+  commands[&command] = id;
+
+  Writer writer;
+  writer.put(Os::timeNanos() - startTime);
+  writer.put(id);
+  writer.put(queue_id);
+  writer.put(static_cast<uint32_t>(command.type()));
+  writer.put(static_cast<uint32_t>(waits.size()));
+  if (!waits.empty()) {
+    writer.put(waits.data(), waits.size() * sizeof(uint32_t));
+  }
+  writer.put(payload.data().data(), payload.data().size());
+  writeRecord(kCommand, writer);
+}
+
+}  // namespace amd
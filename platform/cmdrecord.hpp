@@ -0,0 +1,86 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+
+#include <cstdint>
+
+namespace amd {
+
+class Command;
+
+//! Records the submitted commands into a compact binary file for the offline replay
+//! (see device/rocm/bench/replay.cpp). The file is the header and the records, each record
+//! is RecordHeader and the payload. The objects are recorded once, on the first reference:
+//! the queues, the memory objects with the sizes and the programs with the code objects.
+//! The commands reference them by IDs, the launches have the kernel name and the arguments,
+//! the host data of the writes is recorded only with AMD_CMD_RECORD_DATA.
+//! All values are little endian, the coordinates and the sizes are 64 bit.
+class CommandRecorder : public AllStatic {
+ public:
+  static constexpr uint32_t kMagic = 0x43455243;  //!< "CREC"
+  static constexpr uint32_t kVersion = 1;
+
+  //! The record kinds
+  enum RecordKind : uint16_t {
+    //! uint32 queue, uint32 device index, uint64 queue properties
+    kQueue = 1,
+    //! uint32 memory, uint32 parent memory or 0, uint64 origin in the parent, uint64 size,
+    //! uint64 memory flags, uint32 object type, uint32 the memory is bound to a SVM pointer
+    kMemory = 2,
+    //! uint32 program, uint32 reserved, uint64 size, the code object
+    kProgram = 3,
+    //! uint64 time in ns from the first record, uint32 command, uint32 queue,
+    //! uint32 command type, uint32 wait count, uint32 waited commands,
+    //! the payload of the command type (see CommandRecorder::record)
+    kCommand = 4
+  };
+
+  //! The kinds of the kernel arguments in the launch record
+  enum ArgKind : uint8_t {
+    kArgValue = 0,    //!< uint32 size and the value bytes
+    kArgMemory = 1,   //!< uint32 memory, uint64 offset
+    kArgLocal = 2,    //!< uint32 size of the dynamic local memory
+    kArgPointer = 3   //!< uint64 raw pointer, which isn't a known memory object
+  };
+
+  //! The header of each record
+  struct RecordHeader {
+    uint16_t kind_;      //!< RecordKind
+    uint16_t reserved_;  //!< Reserved
+    uint32_t size_;      //!< The payload size in bytes
+  };
+
+  //! Returns TRUE if the commands are recorded
+  static bool enabled() { return enabled_; }
+
+  //! Starts the recording into the file
+  static bool init(const char* path);
+
+  //! Records the command on the submission
+  static void record(const Command& command);
+
+ private:
+  static bool enabled_;  //!< The commands are recorded
+};
+
+}  // namespace amd
@@ -34,18 +34,126 @@
 #include "thread/monitor.hpp"
 #include "platform/memory.hpp"
 #include "platform/agent.hpp"
+#include "platform/cmdrecord.hpp"
 #include "os/alloc.hpp"
+#include "utils/timeline.hpp"
 
 #include <atomic>
 #include <cstring>
 #include <algorithm>
+#include <deque>
+#include <unordered_map>
 
 namespace amd {
 
+//! Runs the HIP callbacks off the completion threads. The events of a queue are kept in
+//! a strand, which runs on one worker at a time, hence the callbacks of a stream keep the
+//! order. The strands of different queues run in parallel on the pool of the workers
+class CallbackExecutor : public AllStatic {
+ public:
+  //! Schedules the callbacks and the status update of the event.
+  //! Returns FALSE if the caller must process the callbacks inline
+  static bool submit(Event* event, int32_t status, uint64_t timeStamp);
+
+ private:
+  //! A pending status update of an event
+  struct Task {
+    Event* event_;        //!< The event with the callbacks
+    int32_t status_;      //!< The new status
+    uint64_t timeStamp_;  //!< The time of the status change
+  };
+
+  //! The pending tasks of a queue
+  struct Strand {
+    std::deque<Task> tasks_;  //!< The tasks in the submission order
+  };
+
+  class Worker : public Thread {
+   public:
+    Worker() : Thread("Callback Executor Thread", CQ_THREAD_STACK_SIZE) {}
+
+    //! The worker thread entry point
+    void run(void* data) { CallbackExecutor::run(); }
+  };
+
+  //! The worker loop, which runs the ready strands
+  static void run();
+
+  //! The state is never destroyed, since the workers can run on the process exit
+  struct State {
+    State() : lock_("Callback executor lock") {}
+    Monitor lock_;                                   //!< Lock for the strands
+    std::unordered_map<const void*, Strand> strands_;  //!< The strands with the tasks
+    std::deque<const void*> ready_;                  //!< The strands, waiting for a worker
+    uint numWorkers_ = 0;                            //!< The number of the launched workers
+  };
+  static State* state_;
+};
+
+CallbackExecutor::State* CallbackExecutor::state_ = new CallbackExecutor::State();
+
+// ================================================================================================
+bool CallbackExecutor::submit(Event* event, int32_t status, uint64_t timeStamp) {
+  const void* key = event->command().queue();
+  if ((AMD_CALLBACK_THREADS == 0) || (key == nullptr)) {
+    return false;
+  }
+  ScopedLock lock(state_->lock_);
+  if (state_->numWorkers_ < AMD_CALLBACK_THREADS) {
+    Worker* worker = new Worker();
+    if ((worker == nullptr) || (worker->state() < Thread::INITIALIZED)) {
+      delete worker;
+      if (state_->numWorkers_ == 0) {
+        return false;
+      }
+    } else {
+      ++state_->numWorkers_;
+      worker->start(nullptr);
+    }
+  }
+  Strand& strand = state_->strands_[key];
+  strand.tasks_.push_back({event, status, timeStamp});
+  // The strand is in the ready list or runs on a worker, if it has more tasks
+  if (strand.tasks_.size() == 1) {
+    state_->ready_.push_back(key);
+    state_->lock_.notify();
+  }
+  return true;
+}
+
+// ================================================================================================
+void CallbackExecutor::run() {
+  ScopedLock lock(state_->lock_);
+  while (true) {
+    while (state_->ready_.empty()) {
+      state_->lock_.wait();
+    }
+    const void* key = state_->ready_.front();
+    state_->ready_.pop_front();
+    auto it = state_->strands_.find(key);
+    const Task task = it->second.tasks_.front();
+
+    // Only one worker runs the strand, so the front task stays in the queue until it's done
+    state_->lock_.unlock();
+    task.event_->executeCallbacks(task.status_, task.timeStamp_);
+    state_->lock_.lock();
+
+    it = state_->strands_.find(key);
+    it->second.tasks_.pop_front();
+    if (it->second.tasks_.empty()) {
+      state_->strands_.erase(it);
+    } else {
+      // The other queues get the workers first
+      state_->ready_.push_back(key);
+    }
+  }
+}
+
 // ================================================================================================
 Event::Event(HostQueue& queue)
     : callbacks_(NULL),
       status_(CL_INT_MAX),
+      waiters_(0),
       hw_event_(nullptr),
       notify_event_(nullptr),
       device_(&queue.device()),
@@ -55,7 +163,7 @@ Event::Event(HostQueue& queue)
 }
 
 // ================================================================================================
-Event::Event() : callbacks_(NULL), status_(CL_SUBMITTED),
+Event::Event() : callbacks_(NULL), status_(CL_SUBMITTED), waiters_(0),
     hw_event_(nullptr), notify_event_(nullptr), device_(nullptr) { notified_.clear(); }
 
 // ================================================================================================
@@ -127,6 +235,11 @@ bool Event::setStatus(int32_t status, uint64_t timeStamp) {
     // to finish the callback before HIP stream can continue. Hence runtime has to process
     // the callback first and then update the status.
     if (callbacks_ != (CallBackEntry*)0) {
+      // A slow callback doesn't hold the completion thread, since the executor runs
+      // the callback and the status update later in the queue order
+      if ((status <= CL_COMPLETE) && CallbackExecutor::submit(this, status, timeStamp)) {
+        return true;
+      }
       processCallbacks(status);
     }
     if (!status_.compare_exchange_strong(currentStatus, status, std::memory_order_relaxed)) {
@@ -143,6 +256,27 @@ bool Event::setStatus(int32_t status, uint64_t timeStamp) {
     }
   }
 
+  if (Timeline::enabled() && (status == CL_COMPLETE)) {
+    Timeline::instant(Timeline::kComplete, getOclCommandKindString(command().type()),
+                      reinterpret_cast<uint64_t>(this));
+  }
+  return completeStatus(status, timeStamp);
+}
+
+// ================================================================================================
+void Event::executeCallbacks(int32_t status, uint64_t timeStamp) {
+  processCallbacks(status);
+  int32_t currentStatus = this->status();
+  if ((currentStatus <= CL_COMPLETE) || (currentStatus <= status) ||
+      !status_.compare_exchange_strong(currentStatus, status, std::memory_order_relaxed)) {
+    // Somebody else beat us to it, let them deal with the release/signal.
+    return;
+  }
+  completeStatus(status, timeStamp);
+}
+
+// ================================================================================================
+bool Event::completeStatus(int32_t status, uint64_t timeStamp) {
   if (Agent::shouldPostEventEvents() && command().type() != 0) {
     Agent::postEventStatusChanged(as_cl(this), status, timeStamp + Os::offsetToEpochNanos());
   }
@@ -155,6 +289,11 @@ bool Event::setStatus(int32_t status, uint64_t timeStamp) {
     }
 
     activity_.ReportEventTimestamps(command());
+    // Advance the queue timeline, so the timeline waiters observe the completion
+    HostQueue* queue = command().queue();
+    if ((queue != nullptr) && (command().timelineValue() != 0)) {
+      queue->completeTimeline(command().timelineValue());
+    }
     // Broadcast all the waiters.
     if (referenceCount() > 1) {
       signal();
@@ -243,18 +382,29 @@ bool Event::awaitCompletion() {
 
     ClPrint(LOG_DEBUG, LOG_WAIT, "waiting for event %p to complete, current status %d",
       this, status());
+    TimelineScope waitScope(Timeline::kWait, "event wait", reinterpret_cast<uint64_t>(this));
     auto* queue = command().queue();
     if ((queue != nullptr) && queue->vdev()->ActiveWait()) {
       while (status() > CL_COMPLETE) {
         amd::Os::yield();
       }
     } else {
-      ScopedLock lock(lock_);
+      // Wait for GPU on the HSA signal directly, if the command has it
+      const Event* hwEvent = (NotifyEvent() != nullptr) ? NotifyEvent() : this;
+      if ((queue != nullptr) && (hwEvent->HwEvent() != nullptr)) {
+        static constexpr bool kWaitCompletion = true;
+        queue->device().IsHwEventReady(*this, kWaitCompletion);
+      }
 
+      // The waiters park on the status word without the lock, so thousands of them
+      // don't contend. The registration is visible to signal() before the status check
+      waiters_.fetch_add(1, std::memory_order_seq_cst);
       // Wait until the status becomes CL_COMPLETE or negative.
-      while (status() > CL_COMPLETE) {
-        lock_.wait();
+      int32_t current = CL_INT_MAX;
+      while ((current = status()) > CL_COMPLETE) {
+        Os::waitOnAddress(reinterpret_cast<volatile int32_t*>(&status_), current);
       }
+      waiters_.fetch_sub(1, std::memory_order_relaxed);
     }
     ClPrint(LOG_DEBUG, LOG_WAIT, "event %p wait completed", this);
   }
@@ -309,11 +459,17 @@ Command::Command(HostQueue& queue, cl_command_type type,
       type_(type),
       data_(nullptr),
       waitingEvent_(waitingEvent),
+      dispatched_(false),
+      timelineValue_(0),
       eventWaitList_(eventWaitList),
       commandWaitBits_(commandWaitBits) {
   // Retain the commands from the event wait list.
   std::for_each(eventWaitList.begin(), eventWaitList.end(), std::mem_fun(&Command::retain));
   if (type != 0) activity_.Initialize(type, queue.vdev()->index(), queue.device().index());
+  // The completion log reports the timestamps of the profiled commands
+  if ((commandWaitBits & 0x8) != 0) {
+    EnableProfiling();
+  }
 }
 
 // ================================================================================================
@@ -322,11 +478,55 @@ void Command::releaseResources() {
 
   // Release the commands from the event wait list.
   std::for_each(events.begin(), events.end(), std::mem_fun(&Command::release));
+
+  for (const auto& it : timelineWaitList_) {
+    it.first->release();
+  }
+  timelineWaitList_.clear();
+
+  // The captured state of the derived commands is released already
+  arena_.release();
+}
+
+// ================================================================================================
+bool Command::addTimelineWait(HostQueue& queue, uint64_t value) {
+  if (value > queue.timelineValue()) {
+    LogError("The timeline value wasn't enqueued!");
+    return false;
+  }
+  // The commands on the same queue are executed in order
+  if ((&queue == queue_) || queue.isTimelineReached(value)) {
+    return true;
+  }
+  queue.retain();
+  timelineWaitList_.push_back(std::make_pair(&queue, value));
+  return true;
+}
+
+// ================================================================================================
+bool Command::isTimelineWaitListReached() const {
+  for (const auto& it : timelineWaitList_) {
+    if (!it.first->isTimelineReached(it.second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+bool Command::awaitTimelineWaitList() const {
+  bool result = true;
+  for (const auto& it : timelineWaitList_) {
+    result &= it.first->waitTimeline(it.second);
+  }
+  return result;
 }
 
 // ================================================================================================
 void Command::enqueue() {
   assert(queue_ != NULL && "Cannot be enqueued");
+  TimelineScope enqueueScope(Timeline::kEnqueue, getOclCommandKindString(type_),
+                             reinterpret_cast<uint64_t>(this));
 
   if (Agent::shouldPostEventEvents() && type_ != 0) {
     Agent::postEventCreate(as_cl(static_cast<Event*>(this)), type_);
@@ -334,19 +534,33 @@ void Command::enqueue() {
 
   ClPrint(LOG_DEBUG, LOG_CMD, "command is enqueued: %p", this);
 
+  if (CommandRecorder::enabled()) {
+    CommandRecorder::record(*this);
+  }
+
   // Direct dispatch logic below will submit the command immediately, but the command status
   // update will occur later after flush() with a wait
   if (AMD_DIRECT_DISPATCH) {
     setStatus(CL_QUEUED);
 
+    // The timeline points on the other queues don't have a HW event, hence wait on CPU
+    if (!isTimelineWaitListReached() && !awaitTimelineWaitList()) {
+      LogError("The timeline wait failed!");
+    }
+
     // Notify all commands about the waiter. Barrier will be sent in order to obtain
     // HSA signal for a wait on the current queue
     std::for_each(eventWaitList().begin(), eventWaitList().end(),
         std::bind2nd(std::mem_fun(&Command::notifyCmdQueue), !kCpuWait));
 
+    // The device specific preparation doesn't need the queue, so other threads can submit
+    queue_->vdev()->prepareCommand(*this);
+
     // The batch update must be lock protected to avoid a race condition
     // when multiple threads submit/flush/update the batch at the same time
     ScopedLock sl(queue_->vdev()->execution());
+    TimelineScope submitScope(Timeline::kSubmit, getOclCommandKindString(type_),
+                              reinterpret_cast<uint64_t>(this));
     queue_->FormSubmissionBatch(this);
     if ((type() == CL_COMMAND_MARKER || type() == 0)) {
       // The current HSA signal tracking logic requires profiling enabled for the markers
@@ -386,17 +600,25 @@ NDRangeKernelCommand::NDRangeKernelCommand(HostQueue& queue, const EventWaitList
     Command(queue, CL_COMMAND_NDRANGE_KERNEL, eventWaitList, AMD_SERIALIZE_KERNEL),
     kernel_(kernel),
     sizes_(sizes),
+    launch_(),
     sharedMemBytes_(sharedMemBytes),
     extraParam_(extraParam),
     gridId_(gridId),
     numGrids_(numGrids),
     prevGridSum_(prevGridSum),
     allGridSum_(allGridSum),
-    firstDevice_(firstDevice) {
+    firstDevice_(firstDevice),
+    directArgs_(false),
+    arenaParameters_(false),
+    indirectGroups_(nullptr),
+    indirectOffset_(0) {
   auto& device = queue.device();
   auto devKernel = const_cast<device::Kernel*>(kernel.getDeviceKernel(device));
-  profilingInfo_.setCallback(devKernel->getProfilingCallback(
-    queue.vdev()), devKernel->getWavesPerSH(queue.vdev()));
+  uint waves = 0;
+  amd::ProfilingCallback* callback = devKernel->getProfilingCallback(queue.vdev(), sizes, &waves);
+  // The workgroup size measurements have the priority over the wave limiter samples
+  amd::ProfilingCallback* tuning = devKernel->tuneWorkGroupSize(sizes_.global(), sizes_.local());
+  profilingInfo_.setCallback((tuning != nullptr) ? tuning : callback, waves);
   if (forceProfiling) {
     profilingInfo_.enabled_ = true;
     profilingInfo_.clear();
@@ -405,9 +627,48 @@ NDRangeKernelCommand::NDRangeKernelCommand(HostQueue& queue, const EventWaitList
   kernel_.retain();
 }
 
+bool NDRangeKernelCommand::memoryObjects(std::vector<Memory*>* objects) const {
+  const KernelParameters& params = kernel_.parameters();
+  // The SVM pointers in the exec info can reach any memory
+  if (params.getNumberOfSvmPtr() != 0) {
+    return false;
+  }
+  Memory* const* memories =
+      reinterpret_cast<Memory* const*>(parameters_ + params.memoryObjOffset());
+  for (uint32_t i = 0; i < kernel_.signature().numMemories(); ++i) {
+    if (memories[i] == nullptr) {
+      // The raw pointers aren't visible for the tracking
+      return false;
+    }
+    objects->push_back(memories[i]);
+  }
+  if (indirectGroups_ != nullptr) {
+    objects->push_back(indirectGroups_);
+  }
+  return true;
+}
+
+bool NDRangeKernelCommand::setIndirectGroups(Memory* counts, size_t offset) {
+  // Only the ROCr backend lets GPU publish the dispatch packet
+  if (!queue()->device().settings().rocr_backend_ || cooperativeGroups() ||
+      cooperativeMultiDeviceGroups() || ((offset + 3 * sizeof(uint32_t)) > counts->getSize())) {
+    return false;
+  }
+  counts->retain();
+  if (indirectGroups_ != nullptr) {
+    indirectGroups_->release();
+  }
+  indirectGroups_ = counts;
+  indirectOffset_ = offset;
+  return true;
+}
+
 void NDRangeKernelCommand::releaseResources() {
-  kernel_.parameters().release(parameters_, queue()->device());
+  kernel_.parameters().release(parameters_, queue()->device(), arenaParameters_);
   DEBUG_ONLY(parameters_ = NULL);
+  if (indirectGroups_ != nullptr) {
+    indirectGroups_->release();
+  }
   kernel_.release();
   Command::releaseResources();
 }
@@ -627,8 +888,21 @@ int32_t NDRangeKernelCommand::captureAndValidate() {
   }
 
   int32_t error;
-  uint64_t lclMemSize = kernel().getDeviceKernel(device)->workGroupInfo()->localMemSize_;
-  parameters_ = kernel().parameters().capture(device, sharedMemBytes_ + lclMemSize, &error);
+  const device::Kernel* devKernel = kernel().getDeviceKernel(device);
+  uint64_t lclMemSize = devKernel->workGroupInfo()->localMemSize_;
+  // Resolve the launch sizes once, so the device doesn't translate them on the submission
+  if (sizes_.dimensions() > 0) {
+    NDRange local(sizes_.local());
+    devKernel->FindLocalWorkSize(sizes_.dimensions(), sizes_.global(), local);
+    launch_.init(sizes_, local);
+  }
+  // Direct dispatch submits the command right after the capture, hence the device can
+  // serialize the argument values without an intermediate copy
+  directArgs_ = AMD_DIRECT_DISPATCH && device.settings().directKernArgs_;
+  MonotonicMemory* transient = arena();
+  arenaParameters_ = (transient != nullptr);
+  parameters_ = kernel().parameters().capture(device, sharedMemBytes_ + lclMemSize, &error,
+                                              directArgs_, transient);
   return error;
 }
 
@@ -814,11 +1088,17 @@ bool CopyMemoryP2PCommand::validateMemory() {
 
 // ================================================================================================
 bool SvmPrefetchAsyncCommand::validateMemory() {
-  amd::Memory* svmMem = amd::MemObjMap::FindMemObj(dev_ptr());
-  if (nullptr == svmMem) {
-    LogPrintfError("SvmPrefetchAsync received unknown memory for prefetch: %p!", dev_ptr());
+  if (ranges_.empty()) {
+    LogError("SvmPrefetchAsync received no memory for prefetch!");
     return false;
   }
+  for (const auto& range : ranges_) {
+    amd::Memory* svmMem = amd::MemObjMap::FindMemObj(range.ptr_);
+    if (nullptr == svmMem) {
+      LogPrintfError("SvmPrefetchAsync received unknown memory for prefetch: %p!", range.ptr_);
+      return false;
+    }
+  }
   return true;
 }
 
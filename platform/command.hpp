@@ -38,6 +38,8 @@
 #include "platform/kernel.hpp"
 #include "device/device.hpp"
 #include "utils/concurrent.hpp"
+#include "utils/smallvector.hpp"
+#include "os/alloc.hpp"
 #include "platform/memory.hpp"
 #include "platform/perfctr.hpp"
 #include "platform/threadtrace.hpp"
@@ -49,6 +51,7 @@
 #include <algorithm>
 #include <atomic>
 #include <functional>
+#include <utility>
 #include <vector>
 
 namespace amd {
@@ -85,14 +88,15 @@ class Event : public RuntimeObject {
   };
 
  public:
-  typedef std::vector<Event*> EventWaitList;
+  //! The typical commands have a few dependencies, which fit into the inline storage
+  typedef SmallVector<Event*, 4> EventWaitList;
 
  private:
-  Monitor lock_;
   Monitor notify_lock_;   //!< Lock used for notification with direct dispatch only
 
   std::atomic<CallBackEntry*> callbacks_;  //!< linked list of callback entries.
   std::atomic<int32_t> status_;            //!< current execution status.
+  std::atomic<uint32_t> waiters_;          //!< The threads, parked on the status word
   std::atomic_flag notified_;              //!< Command queue was notified
   void*  hw_event_;                        //!< HW event ID associated with SW event
   Event* notify_event_;                    //!< Notify event, which should contain HW signal
@@ -124,11 +128,12 @@ class Event : public RuntimeObject {
       end_ = 0ULL;
     }
     void setCallback(ProfilingCallback* callback, uint32_t waves) {
+      // The wave limiter profiles only the sampled dispatches, but the waves apply to all
+      waves_ = waves;
       if (callback == NULL) {
         return;
       }
       enabled_ = true;
-      waves_ = waves;
       clear();
       callback_ = callback;
     }
@@ -156,6 +161,14 @@ class Event : public RuntimeObject {
   //! Process the callbacks for the given \a status change.
   void processCallbacks(int32_t status) const;
 
+  //! Finishes the status update after the status was changed
+  bool completeStatus(int32_t status, uint64_t timeStamp);
+
+  //! Runs the callbacks and updates the status on the callback executor
+  void executeCallbacks(int32_t status, uint64_t timeStamp);
+
+  friend class CallbackExecutor;
+
   //! Enable profiling for this command
   void EnableProfiling() {
     profilingInfo_.enabled_ = true;
@@ -195,8 +208,11 @@ class Event : public RuntimeObject {
 
   //! Signal all threads waiting on this event.
   void signal() {
-    ScopedLock lock(lock_);
-    lock_.notifyAll();
+    // Pairs with the waiter registration before the status check in awaitCompletion()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) != 0) {
+      Os::wakeOnAddress(reinterpret_cast<volatile int32_t*>(&status_));
+    }
   }
 
   /*! \brief Suspend the current thread until the status of the Command
@@ -240,6 +256,15 @@ class Command : public Event {
   cl_command_type     type_;      //!< This command's OpenCL type.
   void* data_;
   const Event* waitingEvent_;     //!< Waiting event associated with the marker
+  std::atomic<bool> dispatched_;  //!< The command was submitted to the device queue
+  uint64_t timelineValue_;        //!< The timeline value of the command on the queue
+  device::VirtualDevice* virtualDevice_ = nullptr;  //!< The virtual device of the submission
+
+  //! The timeline points on the other queues, which must be reached before the submission
+  std::vector<std::pair<HostQueue*, uint64_t>> timelineWaitList_;
+
+  //! The transient metadata of the command, freed at once with the command resources
+  MonotonicMemory arena_;
 
  protected:
   bool cpu_wait_ = false;         //!< If true, then the command was issued for CPU/GPU sync
@@ -263,6 +288,8 @@ class Command : public Event {
         type_(type),
         data_(nullptr),
         waitingEvent_(nullptr),
+        dispatched_(false),
+        timelineValue_(0),
         eventWaitList_(nullWaitList),
         commandWaitBits_(0) {}
 
@@ -276,7 +303,14 @@ class Command : public Event {
     return true;
   }
 
+  //! The commands release the captured parameters and the memory objects on destruction
+  virtual bool deferrable() const { return true; }
+
  public:
+  //! Commands are recycled through the per thread slab caches
+  void* operator new(size_t size) { return SlabMemory::allocate(size); }
+  void operator delete(void* ptr) { SlabMemory::deallocate(ptr); }
+
   //! Return the queue this command is enqueued into.
   HostQueue* queue() const { return queue_; }
 
@@ -300,6 +334,10 @@ class Command : public Event {
   //! Return this command's OpenCL type.
   cl_command_type type() const { return type_; }
 
+  //! Returns the allocator of the transient metadata, which lives until releaseResources().
+  //! Only the thread, which currently owns the command, can use it
+  MonotonicMemory* arena() { return AMD_COMMAND_ARENA ? &arena_ : nullptr; }
+
   //! Return the opaque, device specific data for this command.
   void* data() const { return data_; }
 
@@ -341,6 +379,40 @@ class Command : public Event {
 
   //! Check if this command(should be a marker) requires CPU wait
   bool CpuWaitRequested() const { return cpu_wait_; }
+
+  //! Marks the command as submitted to the device queue, so the other queues can wait in GPU
+  void SetDispatched() { dispatched_.store(true, std::memory_order_release); }
+
+  //! Returns true if the command was submitted to the device queue
+  bool IsDispatched() const { return dispatched_.load(std::memory_order_acquire); }
+
+  //! Saves the virtual device, which executes the command. An out of order queue
+  //! can submit the commands into several virtual devices
+  void SetVirtualDevice(device::VirtualDevice* device) { virtualDevice_ = device; }
+
+  //! Returns the virtual device of the submission or NULL if it's the queue virtual device
+  device::VirtualDevice* GetVirtualDevice() const { return virtualDevice_; }
+
+  //! Appends the memory objects, accessed by the command.
+  //! Returns FALSE if the command can access the memory outside of the objects
+  virtual bool memoryObjects(std::vector<Memory*>* objects) const { return false; }
+
+  //! Returns the timeline value of the command on the queue or 0 if it wasn't enqueued.
+  //! HostQueue::waitTimeline() with the value is equivalent to the wait for this command
+  uint64_t timelineValue() const { return timelineValue_; }
+
+  //! Assigns the timeline value in the enqueue order
+  void setTimelineValue(uint64_t value) { timelineValue_ = value; }
+
+  //! Makes the command wait for the timeline value on the queue, in addition to the events.
+  //! Returns FALSE if the value wasn't enqueued yet
+  bool addTimelineWait(HostQueue& queue, uint64_t value);
+
+  //! Returns TRUE if all timeline points of the command are reached
+  bool isTimelineWaitListReached() const;
+
+  //! Waits for all timeline points of the command
+  bool awaitTimelineWaitList() const;
 };
 
 class UserEvent : public Command {
@@ -493,6 +565,11 @@ class ReadMemoryCommand : public OneMemoryArgCommand {
   //! Return the host memory to write to
   void* destination() const { return hostPtr_; }
 
+  virtual bool memoryObjects(std::vector<Memory*>* objects) const {
+    objects->push_back(memory_);
+    return true;
+  }
+
   //! Return the origin of the region to read
   const Coord3D& origin() const { return origin_; }
   //! Return the size of the region to read
@@ -568,6 +645,11 @@ class WriteMemoryCommand : public OneMemoryArgCommand {
   //! Return the memory object to write to.
   Memory& destination() const { return *memory_; }
 
+  virtual bool memoryObjects(std::vector<Memory*>* objects) const {
+    objects->push_back(memory_);
+    return true;
+  }
+
   //! Return the region origin
   const Coord3D& origin() const { return origin_; }
   //! Return the region size
@@ -627,6 +709,11 @@ class FillMemoryCommand : public OneMemoryArgCommand {
   //! Return the memory object to write to.
   Memory& memory() const { return *memory_; }
 
+  virtual bool memoryObjects(std::vector<Memory*>* objects) const {
+    objects->push_back(memory_);
+    return true;
+  }
+
   //! Return the region origin
   const Coord3D& origin() const { return origin_; }
   //! Return the region size
@@ -688,6 +775,119 @@ class StreamOperationCommand : public OneMemoryArgCommand {
   const size_t sizeBytes() const { return sizeBytes_; }
 };
 
+/*! \brief A batch of the stream wait and write value operations
+ *
+ *  \details The operations execute in the order of the batch. The backend
+ *            encodes them into the minimal number of packets with a single
+ *            completion signal.
+ */
+class BatchStreamOperationCommand : public Command {
+ public:
+  //! A single wait or write value operation, see StreamOperationCommand
+  struct Operation {
+    cl_command_type type_;  //!< ROCCLR_COMMAND_STREAM_WAIT_VALUE or WRITE_VALUE
+    Memory* memory_;        //!< The signal memory for a wait or the memory for a write
+    uint64_t value_;        //!< Value to Wait on or to Write
+    uint64_t mask_;         //!< Mask to be applied on signal value for Wait operation
+    unsigned int flags_;    //!< Flags defining the Wait condition
+    size_t offset_;         //!< Offset into memory for Write
+    size_t sizeBytes_;      //!< Size in bytes to Write
+  };
+
+ private:
+  std::vector<Operation> operations_;  //!< The operations in the batch
+
+ public:
+  BatchStreamOperationCommand(HostQueue& queue, const EventWaitList& eventWaitList,
+                              const std::vector<Operation>& operations)
+      : Command(queue, ROCCLR_COMMAND_STREAM_BATCH_MEMOP, eventWaitList, AMD_SERIALIZE_COPY),
+        operations_(operations) {
+    for (const auto& op : operations_) {
+      // Sanity check
+      assert((op.type_ == ROCCLR_COMMAND_STREAM_WRITE_VALUE ||
+              (op.type_ == ROCCLR_COMMAND_STREAM_WAIT_VALUE &&
+               op.memory_->getMemFlags() & ROCCLR_MEM_HSA_SIGNAL_MEMORY)) &&
+             "Invalid Stream Operation");
+      op.memory_->retain();
+    }
+  }
+
+  virtual void releaseResources() {
+    for (const auto& op : operations_) {
+      op.memory_->release();
+    }
+    Command::releaseResources();
+  }
+
+  virtual void submit(device::VirtualDevice& device) {
+    device.submitBatchStreamOperation(*this);
+  }
+
+  //! Returns the operations of the batch
+  const std::vector<Operation>& operations() const { return operations_; }
+};
+
+/*! \brief      Uploads or generates all mip levels of an image
+ *
+ *  \details    The upload copies the levels from a buffer, where they are packed
+ *              one after another without padding, starting from the base level.
+ *              The generation fills the levels from the base level with a box filter.
+ *              The backends perform each operation with a single blit, instead of
+ *              a view creation and a copy per level.
+ */
+class MipChainCommand : public Command {
+ public:
+  enum Operation { Upload, Generate };
+
+ private:
+  Image* image_;         //!< The mipmapped image
+  Buffer* buffer_;       //!< The source buffer for the upload
+  size_t offset_;        //!< The offset of the base level in the buffer
+  Operation operation_;  //!< The upload or the generation
+
+ public:
+  //! Creates a command for the upload of all levels from the buffer
+  MipChainCommand(HostQueue& queue, const EventWaitList& eventWaitList, Image& image,
+                  Buffer& buffer, size_t offset)
+      : Command(queue, ROCCLR_COMMAND_MIP_CHAIN, eventWaitList, AMD_SERIALIZE_COPY),
+        image_(&image),
+        buffer_(&buffer),
+        offset_(offset),
+        operation_(Upload) {
+    image_->retain();
+    buffer_->retain();
+  }
+
+  //! Creates a command for the generation of all levels from the base level
+  MipChainCommand(HostQueue& queue, const EventWaitList& eventWaitList, Image& image)
+      : Command(queue, ROCCLR_COMMAND_MIP_CHAIN, eventWaitList, AMD_SERIALIZE_COPY),
+        image_(&image),
+        buffer_(nullptr),
+        offset_(0),
+        operation_(Generate) {
+    image_->retain();
+  }
+
+  virtual void releaseResources() {
+    image_->release();
+    if (buffer_ != nullptr) {
+      buffer_->release();
+    }
+    Command::releaseResources();
+  }
+
+  virtual void submit(device::VirtualDevice& device) { device.submitMipChain(*this); }
+
+  //! Returns the mipmapped image
+  Image& image() const { return *image_; }
+  //! Returns the source buffer of the upload
+  Buffer* buffer() const { return buffer_; }
+  //! Returns the offset of the base level in the buffer
+  size_t offset() const { return offset_; }
+  //! Returns the operation type
+  Operation operation() const { return operation_; }
+};
+
 /*! \brief      A generic copy memory command
  *
  *  \details    Used for both buffers and images. Backends are expected
@@ -737,6 +937,12 @@ class CopyMemoryCommand : public TwoMemoryArgsCommand {
   //! Return the memory object to write to.
   Memory& destination() const { return *memory2_; }
 
+  virtual bool memoryObjects(std::vector<Memory*>* objects) const {
+    objects->push_back(memory1_);
+    objects->push_back(memory2_);
+    return true;
+  }
+
   //! Return the source origin
   const Coord3D& srcOrigin() const { return srcOrigin_; }
   //! Return the offset in bytes in the destination.
@@ -753,6 +959,56 @@ class CopyMemoryCommand : public TwoMemoryArgsCommand {
   bool isEntireMemory() const;
 };
 
+/*! \brief      A batch of the copies between two buffers
+ *
+ *  \details    Each region moves a byte range from the source to the destination.
+ *              The regions can't overlap in the destination and the source and
+ *              destination can be the same buffer, if the regions don't overlap at all.
+ *              The backend executes the batch with minimal dispatches and a single
+ *              completion, instead of a command per region.
+ */
+class BatchCopyMemoryCommand : public TwoMemoryArgsCommand {
+ public:
+  //! A single copy of the batch
+  struct Region {
+    size_t srcOffset_;  //!< The offset in the source buffer
+    size_t dstOffset_;  //!< The offset in the destination buffer
+    size_t size_;       //!< The size of the copy in bytes
+  };
+
+ private:
+  std::vector<Region> regions_;  //!< The copies in the batch
+
+ public:
+  BatchCopyMemoryCommand(HostQueue& queue, const EventWaitList& eventWaitList,
+                         Memory& srcMemory, Memory& dstMemory, const std::vector<Region>& regions)
+      : TwoMemoryArgsCommand(queue, ROCCLR_COMMAND_COPY_BATCH, eventWaitList, srcMemory,
+                             dstMemory),
+        regions_(regions) {
+    // Sanity checks
+    for (const auto& region : regions_) {
+      assert((region.size_ > 0) && (region.srcOffset_ + region.size_ <= srcMemory.getSize()) &&
+             (region.dstOffset_ + region.size_ <= dstMemory.getSize()) && "invalid");
+    }
+  }
+
+  virtual void submit(device::VirtualDevice& device) { device.submitBatchCopyMemory(*this); }
+
+  //! Return the memory object to read from
+  Memory& source() const { return *memory1_; }
+  //! Return the memory object to write to
+  Memory& destination() const { return *memory2_; }
+
+  virtual bool memoryObjects(std::vector<Memory*>* objects) const {
+    objects->push_back(memory1_);
+    objects->push_back(memory2_);
+    return true;
+  }
+
+  //! Returns the copies of the batch
+  const std::vector<Region>& regions() const { return regions_; }
+};
+
 /*! \brief  A generic map memory command. Makes a memory object accessible to the host.
  *
  * @todo:dgladdin   Need to think more about how the pitch parameters operate in
@@ -877,6 +1133,7 @@ class NDRangeKernelCommand : public Command {
  private:
   Kernel& kernel_;
   NDRangeContainer sizes_;
+  LaunchDescriptor launch_;  //!< The launch sizes, resolved at the capture
   address parameters_;      //!< Pointer to the kernel argumets
   // The below fields are specific to the HIP functionality
   uint32_t sharedMemBytes_; //!< Size of reserved shared memory
@@ -886,12 +1143,18 @@ class NDRangeKernelCommand : public Command {
   uint64_t prevGridSum_;    //!< A sum of previous grids to the current launch
   uint64_t allGridSum_;     //!< A sum of all grids in multi GPU launch
   uint32_t firstDevice_;    //!< Device index of the first device in the grid
+  bool directArgs_;         //!< Argument values are serialized into kernarg memory on submit
+  bool arenaParameters_;    //!< The parameters were captured into the command arena
+  Memory* indirectGroups_;  //!< The workgroup counts of the indirect launch, written by GPU
+  size_t indirectOffset_;   //!< The offset of the workgroup counts in the buffer
 
  public:
   enum {
     CooperativeGroups = 0x01,
     CooperativeMultiDeviceGroups = 0x02,
     AnyOrderLaunch = 0x04,
+    FenceScopeSystem = 0x08,  //!< The launch requires the system scope fences
+    FenceScopeAgent = 0x10,   //!< The launch doesn't access the host coherent memory
   };
 
   //! Construct an ExecuteKernel command
@@ -912,13 +1175,34 @@ class NDRangeKernelCommand : public Command {
   //! Return the parameters given to this kernel.
   const_address parameters() const { return parameters_; }
 
+  virtual bool memoryObjects(std::vector<Memory*>* objects) const;
+
+  //! Returns TRUE if the captured parameters hold the objects only and the argument values
+  //! must be serialized from the kernel straight into kernarg memory on the submission
+  bool directArgs() const { return directArgs_; }
+
   //! Return the kernel NDRange.
   const NDRangeContainer& sizes() const { return sizes_; }
 
+  //! Makes the launch indirect. GPU reads 3 uint workgroup counts from the buffer right before
+  //! the dispatch, so earlier kernels can size the launch without a host round trip.
+  //! The workgroup sizes come from the NDRange. Returns FALSE if the device can't support it
+  bool setIndirectGroups(Memory* counts, size_t offset);
+
+  //! Returns the buffer with the workgroup counts of the indirect launch or nullptr
+  Memory* indirectGroups() const { return indirectGroups_; }
+
+  //! Returns the offset of the workgroup counts in the buffer
+  size_t indirectOffset() const { return indirectOffset_; }
+
+  //! Return the launch descriptor. It's valid only if the sizes didn't change after the capture
+  const LaunchDescriptor& launch() const { return launch_; }
+
   //! updates kernel NDRange.
   void setSizes(const size_t* globalWorkOffset, const size_t* globalWorkSize,
                 const size_t* localWorkSize) {
     sizes_.update(3, globalWorkOffset, globalWorkSize, localWorkSize);
+    launch_.invalidate();
   }
 
   //! Return the shared memory size
@@ -938,6 +1222,12 @@ class NDRangeKernelCommand : public Command {
   //! Returns extra Param, set when using anyorder launch
   bool getAnyOrderLaunchFlag() const { return (extraParam_ & AnyOrderLaunch) ? true : false; }
 
+  //! Returns TRUE if the app requested the system scope fences for the launch
+  bool fenceScopeSystem() const { return (extraParam_ & FenceScopeSystem) ? true : false; }
+
+  //! Returns TRUE if the app allowed the agent scope fences for the launch
+  bool fenceScopeAgent() const { return (extraParam_ & FenceScopeAgent) ? true : false; }
+
   //! Return the current grid ID for multidevice launch
   uint32_t gridId() const { return gridId_; }
 
@@ -954,7 +1244,10 @@ class NDRangeKernelCommand : public Command {
   uint64_t firstDevice() const { return firstDevice_; }
 
   //! Set the local work size.
-  void setLocalWorkSize(const NDRange& local) { sizes_.local() = local; }
+  void setLocalWorkSize(const NDRange& local) {
+    sizes_.local() = local;
+    launch_.invalidate();
+  }
 
   int32_t captureAndValidate();
 };
@@ -1509,24 +1802,32 @@ class CopyMemoryP2PCommand : public CopyMemoryCommand {
 
 /*! \brief      Prefetch command for SVM memory
  *
- *  \details    Prefetches SVM memory into the current device or CPU
+ *  \details    Prefetches SVM memory into the current device or CPU. The command can
+ *              carry a batch of ranges, which are coalesced into the minimal set of prefetches
  */
 class SvmPrefetchAsyncCommand : public Command {
-  const void* dev_ptr_;   //!< Device pointer to memory for prefetch
-  size_t count_;          //!< the size for prefetch
+  std::vector<SvmRange> ranges_;  //!< The coalesced ranges for prefetch
   bool   cpu_access_;     //!< Prefetch data into CPU location
 
  public:
   SvmPrefetchAsyncCommand(HostQueue& queue, const EventWaitList& eventWaitList,
                           const void* dev_ptr, size_t count, bool cpu_access)
-      : Command(queue, 1, eventWaitList), dev_ptr_(dev_ptr), count_(count), cpu_access_(cpu_access) {}
+      : Command(queue, 1, eventWaitList), ranges_(1, {dev_ptr, count}),
+        cpu_access_(cpu_access) {}
+
+  SvmPrefetchAsyncCommand(HostQueue& queue, const EventWaitList& eventWaitList,
+                          const std::vector<SvmRange>& ranges, bool cpu_access)
+      : Command(queue, 1, eventWaitList), ranges_(ranges), cpu_access_(cpu_access) {
+    CoalesceSvmRanges(&ranges_);
+  }
 
   virtual void submit(device::VirtualDevice& device) { device.submitSvmPrefetchAsync(*this); }
 
   bool validateMemory();
 
-  const void* dev_ptr() const { return dev_ptr_; }
-  size_t count() const { return count_; }
+  const void* dev_ptr() const { return ranges_[0].ptr_; }
+  size_t count() const { return ranges_[0].size_; }
+  const std::vector<SvmRange>& ranges() const { return ranges_; }
   size_t cpu_access() const { return cpu_access_; }
 };
 
@@ -24,6 +24,12 @@
 // Dummy command types for Stream Wait and Write commands.
 #define ROCCLR_COMMAND_STREAM_WAIT_VALUE 0x4501
 #define ROCCLR_COMMAND_STREAM_WRITE_VALUE 0x4502
+// Dummy command type for a batch of Stream Wait and Write operations.
+#define ROCCLR_COMMAND_STREAM_BATCH_MEMOP 0x4503
+// Dummy command type for the upload or generation of a whole mip chain.
+#define ROCCLR_COMMAND_MIP_CHAIN 0x4504
+// Dummy command type for a batch of buffer copies with a single dispatch.
+#define ROCCLR_COMMAND_COPY_BATCH 0x4505
 
 // Stream Wait Value Conidtions
 #define ROCCLR_STREAM_WAIT_VALUE_GTE 0x0
@@ -22,6 +22,12 @@
 #include "thread/monitor.hpp"
 #include "device/device.hpp"
 #include "platform/context.hpp"
+#include "utils/timeline.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
 
 /*!
  * \file commandQueue.cpp
@@ -37,14 +43,40 @@ HostQueue::HostQueue(Context& context, Device& device, cl_command_queue_properti
                      uint queueRTCUs, Priority priority, const std::vector<uint32_t>& cuMask)
     : CommandQueue(context, device, properties, device.info().queueProperties_, queueRTCUs,
                    priority, cuMask),
+      deferred_(nullptr),
+      threadParked_(false),
       lastEnqueueCommand_(nullptr),
+      timeline_(nullptr),
+      timelineValue_(0),
+      timelineCompleted_(0),
+      timelineFlushed_(0),
+      timelineLock_("HostQueue::timelineLock"),
+      pooled_(AMD_QUEUE_THREAD_POOL && !AMD_DIRECT_DISPATCH),
+      scheduled_(false),
+      poolActive_(0),
+      poolHead_(nullptr),
+      poolTail_(nullptr),
+      lazyThread_(AMD_QUEUE_LAZY_THREAD && !AMD_DIRECT_DISPATCH && !AMD_QUEUE_THREAD_POOL),
+      threadStarted_(false),
       head_(nullptr),
       tail_(nullptr) {
-  if (AMD_DIRECT_DISPATCH) {
-    // Initialize the queue
+  timeline_ = device.createSignal();
+  if ((timeline_ != nullptr) &&
+      !timeline_->Init(device, 0, device::Signal::WaitState::Blocked)) {
+    // The timeline waits poll the completed value without the signal
+    delete timeline_;
+    timeline_ = nullptr;
+  }
+  if (AMD_DIRECT_DISPATCH || pooled_) {
+    // Initialize the queue. The pool workers don't own the virtual devices of the queues
+    thread_.Init(this);
+  } else if (lazyThread_) {
+    // The virtual device is created upfront, so the queue creation still reports a failure
     thread_.Init(this);
   } else {
     if (thread_.state() >= Thread::INITIALIZED) {
+      // Keep the submission close to the device
+      device.setNumaAffinity(thread_);
       ScopedLock sl(queueLock_);
       thread_.start(this);
       queueLock_.wait();
@@ -52,15 +84,27 @@ HostQueue::HostQueue(Context& context, Device& device, cl_command_queue_properti
   }
 }
 
+HostQueue::~HostQueue() { delete timeline_; }
+
 bool HostQueue::terminate() {
-  if (AMD_DIRECT_DISPATCH) {
-    Command* marker = new Marker(*this, true);
+  if (AMD_DIRECT_DISPATCH || pooled_) {
+    // The pool workers flush the batch on the invisible marker only
+    Command* marker = new Marker(*this, !pooled_);
     if (marker != nullptr) {
       marker->enqueue();
       marker->awaitCompletion();
       marker->release();
     }
     thread_.acceptingCommands_ = false;
+    // Make sure a pool worker doesn't access the queue anymore
+    while (pooled_ && (scheduled_.load(std::memory_order_acquire) ||
+                       (poolActive_.load(std::memory_order_acquire) != 0))) {
+      Os::yield();
+    }
+    thread_.Release();
+  } else if (lazyThread_ && !threadStarted_.load(std::memory_order_acquire)) {
+    // The queue never received a command, hence only the virtual device has to be released
+    thread_.acceptingCommands_ = false;
     thread_.Release();
   } else {
     if (Os::isThreadAlive(thread_)) {
@@ -105,27 +149,34 @@ bool HostQueue::terminate() {
 
 void HostQueue::finish() {
   Command* command = nullptr;
+  bool done = false;
   if (IS_HIP) {
     command = getLastQueuedCommand(true);
     // Check if the queue has nothing to process and return
     if (AMD_DIRECT_DISPATCH &&  command == nullptr) {
       return;
     }
+    // The submitted work is waited on the completion doorbell of the queue without a marker,
+    // unless the host processes the last command, e.g. a marker with a callback
+    done = AMD_DIRECT_DISPATCH && (command->type() != CL_COMMAND_MARKER) &&
+        (command->status() < CL_QUEUED) && vdev()->waitCompletion();
   }
-  if (nullptr == command) {
-    // Send a finish to make sure we finished all commands
-    command = new Marker(*this, false);
-    if (command == NULL) {
-      return;
+  if (!done) {
+    if (nullptr == command) {
+      // Send a finish to make sure we finished all commands
+      command = new Marker(*this, false);
+      if (command == NULL) {
+        return;
+      }
+      ClPrint(LOG_DEBUG, LOG_CMD, "marker is queued");
+      command->enqueue();
+    }
+    // Check HW status of the ROCcrl event. Note: not all ROCclr modes support HW status
+    static constexpr bool kWaitCompletion = true;
+    if (!device().IsHwEventReady(command->event(), kWaitCompletion)) {
+      ClPrint(LOG_DEBUG, LOG_CMD, "HW Event not ready, awaiting completion instead");
+      command->awaitCompletion();
     }
-    ClPrint(LOG_DEBUG, LOG_CMD, "marker is queued");
-    command->enqueue();
-  }
-  // Check HW status of the ROCcrl event. Note: not all ROCclr modes support HW status
-  static constexpr bool kWaitCompletion = true;
-  if (!device().IsHwEventReady(command->event(), kWaitCompletion)) {
-    ClPrint(LOG_DEBUG, LOG_CMD, "HW Event not ready, awaiting completion instead");
-    command->awaitCompletion();
   }
   command->release();
   if (IS_HIP) {
@@ -140,72 +191,461 @@ void HostQueue::finish() {
 }
 
 void HostQueue::loop(device::VirtualDevice* virtualDevice) {
+  if (AMD_QUEUE_THREAD_PRIORITY && (priority() != Priority::Normal)) {
+    // Under CPU oversubscription the scheduler prefers the high priority streams
+    const int level = static_cast<int>(priority()) - static_cast<int>(Priority::Normal);
+    if (!Os::setCurrentThreadPriority(level)) {
+      ClPrint(LOG_INFO, LOG_QUEUE, "Queue %p couldn't change the thread priority to %d",
+              this, level);
+    }
+  }
   // Notify the caller that the queue is ready to accept commands.
   {
     ScopedLock sl(queueLock_);
     thread_.acceptingCommands_ = true;
     queueLock_.notify();
   }
+  createLanes(virtualDevice);
   // Create a command batch with all the commands present in the queue.
   Command* head = NULL;
   Command* tail = NULL;
   while (true) {
     // Get one command from the queue
-    Command* command = queue_.dequeue();
+    Command* command = pop();
+    // Spin on the empty queue before going to sleep, since the producers
+    // don't need a notification while the thread isn't parked
+    for (uint i = 0; (command == NULL) && (i < CQ_THREAD_SPIN_COUNT); ++i) {
+      Os::spinPause();
+      command = pop();
+    }
     if (command == NULL) {
       ScopedLock sl(queueLock_);
-      while ((command = queue_.dequeue()) == NULL) {
+      threadParked_.store(true, std::memory_order_relaxed);
+      // Make sure the state update is visible before the queue check
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while ((command = pop()) == NULL) {
         if (!thread_.acceptingCommands_) {
+          threadParked_.store(false, std::memory_order_relaxed);
+          releaseLanes();
           return;
         }
         queueLock_.wait();
+        virtualDevice->metrics().add(VDI_METRIC_QUEUE_WAKEUPS);
+      }
+      threadParked_.store(false, std::memory_order_relaxed);
+    }
+
+    if (lanes_.empty()) {
+      processCommand(command, virtualDevice, head, tail);
+    } else {
+      processLanes(command);
+    }
+  }  // while (true) {
+}
+
+//! The maximum size of the merged run of the buffer writes or fills
+static constexpr size_t kMaxCoalescedSize = 64 * Ki;
+
+//! The buffer write, which owns the packed host data of the merged writes
+class CoalescedWriteCommand : public WriteMemoryCommand {
+ public:
+  //! @note: The move of the vector keeps the storage, so the source pointer stays valid
+  CoalescedWriteCommand(HostQueue& queue, Memory& memory, size_t origin, std::vector<char>&& data)
+      : WriteMemoryCommand(queue, CL_COMMAND_WRITE_BUFFER, EventWaitList(), memory, origin,
+                           data.size(), data.data()),
+        data_(std::move(data)) {}
+
+ private:
+  std::vector<char> data_;  //!< The packed host data
+};
+
+//! Returns TRUE if the command is a small buffer write or fill without the dependencies
+static bool isCoalescable(Command& command) {
+  Memory* memory = nullptr;
+  size_t size = 0;
+  if (command.type() == CL_COMMAND_WRITE_BUFFER) {
+    WriteMemoryCommand& write = static_cast<WriteMemoryCommand&>(command);
+    memory = &write.destination();
+    size = write.size()[0];
+  } else if (command.type() == CL_COMMAND_FILL_BUFFER) {
+    FillMemoryCommand& fill = static_cast<FillMemoryCommand&>(command);
+    memory = &fill.memory();
+    size = fill.size()[0];
+  } else {
+    return false;
+  }
+  // The merged command has a single timestamp and no dependencies
+  return (memory->asBuffer() != nullptr) && (size <= CQ_COALESCE_SIZE) &&
+      command.eventWaitList().empty() && (command.getWaitBits() == 0) &&
+      !command.profilingInfo().enabled_ && command.isTimelineWaitListReached();
+}
+
+Command* HostQueue::coalesce(Command* command, Command*& head, Command*& tail,
+                             std::vector<Command*>* run) {
+  // The lanes of the out of order queue select the virtual device per command
+  if ((CQ_COALESCE_SIZE == 0) || !lanes_.empty() || !isCoalescable(*command)) {
+    return nullptr;
+  }
+  const bool fill = (command->type() == CL_COMMAND_FILL_BUFFER);
+  Memory* memory = fill ? &static_cast<FillMemoryCommand*>(command)->memory() :
+                          &static_cast<WriteMemoryCommand*>(command)->destination();
+  auto range = [fill](Command* cmd) {
+    return fill ? std::make_pair(static_cast<FillMemoryCommand*>(cmd)->origin()[0],
+                                 static_cast<FillMemoryCommand*>(cmd)->size()[0]) :
+                  std::make_pair(static_cast<WriteMemoryCommand*>(cmd)->origin()[0],
+                                 static_cast<WriteMemoryCommand*>(cmd)->size()[0]);
+  };
+  const size_t origin = range(command).first;
+  size_t end = origin + range(command).second;
+
+  // Only the commands, which are in the queue already, are merged, so the run doesn't wait
+  run->push_back(command);
+  for (Command* next = pop(); next != nullptr; next = pop()) {
+    bool adjacent = false;
+    if ((next->type() == command->type()) && isCoalescable(*next)) {
+      const auto nextRange = range(next);
+      if (fill) {
+        const FillMemoryCommand* prev = static_cast<FillMemoryCommand*>(command);
+        const FillMemoryCommand* cur = static_cast<FillMemoryCommand*>(next);
+        // The pattern must continue without a shift in the next fill
+        adjacent = (&cur->memory() == memory) && (cur->patternSize() == prev->patternSize()) &&
+            (((end - origin) % prev->patternSize()) == 0) &&
+            (memcmp(cur->pattern(), prev->pattern(), prev->patternSize()) == 0);
+      } else {
+        adjacent = (&static_cast<WriteMemoryCommand*>(next)->destination() == memory);
       }
+      adjacent &= (nextRange.first == end) &&
+          ((end + nextRange.second - origin) <= kMaxCoalescedSize);
     }
+    if (!adjacent) {
+      // The next command is processed after the run
+      deferred_ = next;
+      break;
+    }
+    end += range(next).second;
+    run->push_back(next);
+  }
+  if (run->size() == 1) {
+    run->clear();
+    return nullptr;
+  }
+
+  Command* merged = nullptr;
+  if (fill) {
+    const FillMemoryCommand* cmd = static_cast<FillMemoryCommand*>(command);
+    merged = new FillMemoryCommand(*this, CL_COMMAND_FILL_BUFFER, Command::EventWaitList(),
+                                   *memory, cmd->pattern(), cmd->patternSize(), origin,
+                                   end - origin);
+  } else {
+    std::vector<char> data(end - origin);
+    for (Command* cmd : *run) {
+      const WriteMemoryCommand* write = static_cast<WriteMemoryCommand*>(cmd);
+      memcpy(&data[write->origin()[0] - origin], write->source(), write->size()[0]);
+    }
+    merged = new CoalescedWriteCommand(*this, *memory, origin, std::move(data));
+  }
+
+  // The merged commands complete with the batch, as if they were submitted
+  for (Command* cmd : *run) {
+    cmd->retain();
+    if (nullptr == head) {
+      head = tail = cmd;
+    } else {
+      tail->setNext(cmd);
+      tail = cmd;
+    }
+    cmd->setStatus(CL_SUBMITTED);
+  }
+  // The reference of the merged command is released on the completion, as for the queued ones
+  merged->setStatus(CL_QUEUED);
+  ClPrint(LOG_DEBUG, LOG_CMD, "%zu commands (%s) are merged into %p, %zu bytes", run->size(),
+          getOclCommandKindString(command->type()), merged, end - origin);
+  return merged;
+}
 
-    command->retain();
+void HostQueue::processCommand(Command* command, device::VirtualDevice* virtualDevice,
+                               Command*& head, Command*& tail) {
+  // A run of small adjacent transfers is submitted as one command
+  std::vector<Command*> run;
+  Command* merged = coalesce(command, head, tail, &run);
+  if (merged != nullptr) {
+    command = merged;
+  }
+  command->retain();
+
+  // The timeline points on the other queues are resolved with a wait on the timeline signal
+  bool dependencyFailed = false;
+  if (!command->isTimelineWaitListReached()) {
+    flushBatch(virtualDevice, head, tail);
+    if (pooled_) {
+      HostQueuePool::beginBlocking();
+    }
+    dependencyFailed |= !command->awaitTimelineWaitList();
+    if (pooled_) {
+      HostQueuePool::endBlocking();
+    }
+  }
 
-    // Process the command's event wait list.
-    const Command::EventWaitList& events = command->eventWaitList();
-    bool dependencyFailed = false;
+  // Process the command's event wait list.
+  const Command::EventWaitList& events = command->eventWaitList();
 
-    for (const auto& it : events) {
-      // Only wait if the command is enqueued into another queue.
-      if (it->command().queue() != this) {
+  for (const auto& it : events) {
+    // Only wait if the command is enqueued into another queue or another lane of the queue
+    if ((it->command().queue() != this) ||
+        (it->command().GetVirtualDevice() != virtualDevice)) {
+      // The dispatched commands are tracked with a barrier in GPU, without a queue stall
+      if ((it->command().status() != CL_COMPLETE) &&
+          !virtualDevice->waitForCommand(it->command())) {
         // Runtime has to flush the current batch only if the dependent wait is blocking
-        if (it->command().status() != CL_COMPLETE) {
-          virtualDevice->flush(head, true);
-          tail = head = NULL;
-          dependencyFailed |= !it->awaitCompletion();
+        flushBatch(virtualDevice, head, tail);
+        if (pooled_) {
+          HostQueuePool::beginBlocking();
+        }
+        dependencyFailed |= !it->awaitCompletion();
+        if (pooled_) {
+          HostQueuePool::endBlocking();
         }
       }
     }
+  }
 
-    // Insert the command to the linked list.
-    if (NULL == head) {  // if the list is empty
-      head = tail = command;
-    } else {
-      tail->setNext(command);
-      tail = command;
+  // Insert the command to the linked list.
+  if (NULL == head) {  // if the list is empty
+    head = tail = command;
+  } else {
+    tail->setNext(command);
+    tail = command;
+  }
+
+  if (dependencyFailed) {
+    command->setStatus(CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST);
+    return;
+  }
+
+  ClPrint(LOG_DEBUG, LOG_CMD, "command (%s) is submitted: %p", getOclCommandKindString(command->type()), command);
+
+  command->setStatus(CL_SUBMITTED);
+
+  // Submit to the device queue.
+  command->SetVirtualDevice(virtualDevice);
+  {
+    TimelineScope submitScope(Timeline::kSubmit, getOclCommandKindString(command->type()),
+                              reinterpret_cast<uint64_t>(command));
+    command->submit(*virtualDevice);
+  }
+  command->SetDispatched();
+  // The other queues can wait for the merged commands only after the submission
+  for (Command* cmd : run) {
+    cmd->SetVirtualDevice(virtualDevice);
+    cmd->SetDispatched();
+  }
+
+  // if this is a user invisible marker command, then flush
+  if (0 == command->type()) {
+    virtualDevice->flush(head);
+    tail = head = NULL;
+  }
+}
+
+void HostQueue::flushBatch(device::VirtualDevice* virtualDevice, Command*& head,
+                           Command*& tail) {
+  virtualDevice->flush(head, true);
+  tail = head = NULL;
+  // The blocking wait can depend on the commands in the other lanes of the out of order queue
+  flushLanes();
+}
+
+void HostQueue::createLanes(device::VirtualDevice* virtualDevice) {
+  if ((AMD_QUEUE_OOO_LANES == 0) ||
+      !properties().test(CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)) {
+    return;
+  }
+  lanes_.push_back({virtualDevice, nullptr, nullptr, 0, false, {}});
+  for (uint i = 0; i < AMD_QUEUE_OOO_LANES; ++i) {
+    device::VirtualDevice* vdev = device().createVirtualDevice(this);
+    if (vdev == nullptr) {
+      // The queue runs on the lanes, which were created
+      LogWarning("Out of order queue failed to create a lane");
+      break;
     }
+    lanes_.push_back({vdev, nullptr, nullptr, 0, false, {}});
+  }
+  if (lanes_.size() == 1) {
+    lanes_.clear();
+    return;
+  }
+  ClPrint(LOG_INFO, LOG_QUEUE, "Queue %p runs out of order on %zu lanes", this, lanes_.size());
+}
 
-    if (dependencyFailed) {
-      command->setStatus(CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST);
+void HostQueue::releaseLanes() {
+  // The first lane is the virtual device of the queue thread
+  for (size_t i = 1; i < lanes_.size(); ++i) {
+    delete lanes_[i].vdev_;
+  }
+  lanes_.clear();
+}
+
+void HostQueue::flushLanes() {
+  for (auto& lane : lanes_) {
+    if (lane.head_ != nullptr) {
+      lane.vdev_->flush(lane.head_, true);
+    }
+    lane.head_ = lane.tail_ = nullptr;
+    lane.count_ = 0;
+    lane.busyAll_ = false;
+    lane.busy_.clear();
+  }
+}
+
+HostQueue::Lane& HostQueue::selectLane(Command& command, bool known) {
+  // The lanes with the flushed batches are idle
+  auto conflicts = [&](const Lane& lane) {
+    if (lane.head_ == nullptr) {
+      return false;
+    }
+    if (!known || lane.busyAll_) {
+      return true;
+    }
+    for (const Memory* memory : laneMemory_) {
+      if (std::find(lane.busy_.begin(), lane.busy_.end(), memory) != lane.busy_.end()) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // The lane of a pending dependency in the queue resolves it with the in order execution
+  Lane* target = nullptr;
+  for (const auto& event : command.eventWaitList()) {
+    const Command& producer = event->command();
+    if ((producer.queue() != this) || (producer.status() == CL_COMPLETE)) {
       continue;
     }
+    for (auto& lane : lanes_) {
+      if ((lane.head_ != nullptr) && (lane.vdev_ == producer.GetVirtualDevice())) {
+        target = &lane;
+        break;
+      }
+    }
+    if (target != nullptr) {
+      break;
+    }
+  }
+  // Otherwise follow the conflicting commands or take the least loaded lane
+  if (target == nullptr) {
+    for (auto& lane : lanes_) {
+      if (conflicts(lane)) {
+        target = &lane;
+        break;
+      }
+    }
+  }
+  if (target == nullptr) {
+    target = &lanes_[0];
+    for (auto& lane : lanes_) {
+      if (lane.count_ < target->count_) {
+        target = &lane;
+      }
+    }
+  }
 
-    ClPrint(LOG_DEBUG, LOG_CMD, "command (%s) is submitted: %p", getOclCommandKindString(command->type()), command);
+  // Join the other lanes with the conflicting commands with the barriers in GPU
+  for (auto& lane : lanes_) {
+    if ((&lane != target) && conflicts(lane) &&
+        !target->vdev_->waitForCommand(*lane.tail_)) {
+      // The GPU wait isn't available, hence wait for all lanes on CPU
+      flushLanes();
+      return lanes_[0];
+    }
+  }
+  ClPrint(LOG_DEBUG, LOG_CMD, "command (%s) %p runs in lane %zu",
+          getOclCommandKindString(command.type()), &command, target - &lanes_[0]);
+  return *target;
+}
 
-    command->setStatus(CL_SUBMITTED);
+void HostQueue::processLanes(Command* command) {
+  laneMemory_.clear();
+  const bool known = command->memoryObjects(&laneMemory_);
+  // The views of a buffer depend on each other through the parent
+  for (auto& memory : laneMemory_) {
+    while (memory->parent() != nullptr) {
+      memory = memory->parent();
+    }
+  }
 
-    // Submit to the device queue.
-    command->submit(*virtualDevice);
+  // The invisible markers report the completion of all previous commands in the queue
+  const bool invisible = (command->type() == 0);
+  if (invisible) {
+    flushLanes();
+  }
+  Lane& lane = invisible ? lanes_[0] : selectLane(*command, known);
+  processCommand(command, lane.vdev_, lane.head_, lane.tail_);
+  if (invisible) {
+    return;
+  }
+
+  // Track the memory of the batch for the next commands
+  ++lane.count_;
+  if (!known) {
+    lane.busyAll_ = true;
+    return;
+  }
+  for (const Memory* memory : laneMemory_) {
+    if (std::find(lane.busy_.begin(), lane.busy_.end(), memory) == lane.busy_.end()) {
+      lane.busy_.push_back(memory);
+    }
+  }
+}
 
-    // if this is a user invisible marker command, then flush
-    if (0 == command->type()) {
-      virtualDevice->flush(head);
-      tail = head = NULL;
+void HostQueue::schedule() {
+  // The first producer, which finds the queue idle, adds it to the ready list.
+  // The worker has the opposite order: clear the state and then check the queue
+  if (!scheduled_.load(std::memory_order_relaxed) &&
+      !scheduled_.exchange(true, std::memory_order_acq_rel)) {
+    HostQueuePool::schedule(this);
+  }
+}
+
+//! The number of the commands, processed in one run of a pool worker on the queue
+static constexpr uint kPooledBatchSize = 64;
+
+void HostQueue::runPooled() {
+  poolActive_.fetch_add(1, std::memory_order_acq_rel);
+  device::VirtualDevice* virtualDevice = thread_.vdev();
+  // Limit the commands in one run, so the other ready queues don't starve
+  for (uint i = 0; i < kPooledBatchSize; ++i) {
+    Command* command = pop();
+    if (command == nullptr) {
+      break;
     }
-  }  // while (true) {
+    processCommand(command, virtualDevice, poolHead_, poolTail_);
+  }
+  if (!empty()) {
+    // The queue stays scheduled and moves to the end of the ready list
+    HostQueuePool::schedule(this);
+  } else {
+    scheduled_.store(false, std::memory_order_seq_cst);
+    // A producer may have seen the scheduled state before the store, hence check again
+    if (!empty() && !scheduled_.exchange(true, std::memory_order_acq_rel)) {
+      HostQueuePool::schedule(this);
+    }
+  }
+  // The last access to the queue, which can be destroyed after the update
+  poolActive_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void HostQueue::startThread() {
+  if (threadStarted_.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  // The commands wait in the queue, hence the thread doesn't need the startup handshake
+  if (!thread_.spawnOsThread()) {
+    LogError("Failed to create the command queue thread!");
+    return;
+  }
+  // Keep the submission close to the device
+  device().setNumaAffinity(thread_);
+  thread_.start(this);
 }
 
 void HostQueue::append(Command& command) {
@@ -216,7 +656,16 @@ void HostQueue::append(Command& command) {
   }
   command.retain();
   command.setStatus(CL_QUEUED);
-  queue_.enqueue(&command);
+  {
+    // The queue thread completes the commands in the queue order,
+    // hence the timeline values must follow the same order
+    ScopedLock l(timelineLock_);
+    command.setTimelineValue(timelineValue_.fetch_add(1, std::memory_order_acq_rel) + 1);
+    push(&command);
+  }
+  if (lazyThread_ && !threadStarted_.load(std::memory_order_relaxed)) {
+    startThread();
+  }
   if (!IS_HIP) {
     return;
   }
@@ -241,7 +690,7 @@ void HostQueue::append(Command& command) {
 
 bool HostQueue::isEmpty() {
   // Get a snapshot of queue size
-  return queue_.empty();
+  return empty();
 }
 
 Command* HostQueue::getLastQueuedCommand(bool retain) {
@@ -268,6 +717,166 @@ Command* HostQueue::getLastQueuedCommand(bool retain) {
   }
 }
 
+bool HostQueue::waitTimeline(uint64_t value) {
+  if (isTimelineReached(value)) {
+    return true;
+  }
+
+  // The command status is updated on the batch completion, hence make sure a marker
+  // drains the queue up to the requested value. The marker is shared by the later waits
+  if (timelineFlushed_.load(std::memory_order_acquire) < value) {
+    Command* marker = new Marker(*this, false);
+    if (marker == nullptr) {
+      return false;
+    }
+    marker->enqueue();
+    uint64_t flushed = timelineFlushed_.load(std::memory_order_relaxed);
+    while ((flushed < marker->timelineValue()) &&
+           !timelineFlushed_.compare_exchange_weak(flushed, marker->timelineValue(),
+                                                   std::memory_order_acq_rel)) {
+    }
+    marker->release();
+  }
+
+  ClPrint(LOG_DEBUG, LOG_WAIT, "waiting for queue %p timeline value %llu", this,
+          static_cast<unsigned long long>(value));
+  while (!isTimelineReached(value)) {
+    if (timeline_ != nullptr) {
+      timeline_->Wait(value, device::Signal::Condition::Gte,
+                      std::numeric_limits<uint64_t>::max());
+    } else {
+      Os::yield();
+    }
+  }
+  return true;
+}
+
+void HostQueue::completeTimeline(uint64_t value) {
+  uint64_t completed = timelineCompleted_.load(std::memory_order_relaxed);
+  while (completed < value) {
+    if (timelineCompleted_.compare_exchange_weak(completed, value, std::memory_order_acq_rel)) {
+      if (timeline_ != nullptr) {
+        // A concurrent completion could advance the value between the exchange and the store,
+        // hence republish until the signal holds the latest value
+        do {
+          completed = value;
+          timeline_->Reset(completed);
+          value = timelineCompleted_.load(std::memory_order_acquire);
+        } while (value != completed);
+      }
+      break;
+    }
+  }
+}
+
+ConcurrentLinkedQueue<HostQueue*>* HostQueuePool::ready_ = nullptr;
+Monitor* HostQueuePool::lock_ = nullptr;
+std::vector<HostQueuePool::Worker*>* HostQueuePool::workers_ = nullptr;
+uint HostQueuePool::target_ = 0;
+uint HostQueuePool::running_ = 0;
+uint HostQueuePool::idle_ = 0;
+uint HostQueuePool::blocked_ = 0;
+
+class HostQueuePool::Worker : public amd::Thread {
+ public:
+  Worker() : amd::Thread("Host Queue Worker", CQ_THREAD_STACK_SIZE) {}
+
+  //! The pool worker entry point
+  void run(void* data) { HostQueuePool::work(); }
+};
+
+void HostQueuePool::init() {
+  ready_ = new ConcurrentLinkedQueue<HostQueue*>();
+  lock_ = new Monitor("Host queue pool lock");
+  workers_ = new std::vector<Worker*>();
+  target_ = AMD_QUEUE_THREAD_POOL_SIZE;
+  if (target_ == 0) {
+    // Two workers per device keep the submission and a blocking wait overlapped
+    const uint numDevices = static_cast<uint>(Device::numDevices(CL_DEVICE_TYPE_GPU, false));
+    target_ = std::min(std::max(2 * numDevices, 2u), static_cast<uint>(Os::processorCount()));
+  }
+  target_ = std::max(target_, 1u);
+  ClPrint(LOG_INFO, LOG_INIT, "Host queue pool with %u workers", target_);
+}
+
+bool HostQueuePool::addWorker() {
+  // Destroy the extra workers, which exited after the blocking waits
+  workers_->erase(std::remove_if(workers_->begin(), workers_->end(), [](Worker* worker) {
+                    if (worker->state() >= Thread::FINISHED) {
+                      delete worker;
+                      return true;
+                    }
+                    return false;
+                  }), workers_->end());
+
+  Worker* worker = new Worker();
+  if ((worker == nullptr) || (worker->state() < Thread::INITIALIZED)) {
+    LogWarning("Host queue pool worker creation failed");
+    delete worker;
+    return false;
+  }
+  // The worker takes the lock in the loop, hence count it before the start
+  ++running_;
+  if (!worker->start()) {
+    --running_;
+    LogWarning("Host queue pool worker start failed");
+    delete worker;
+    return false;
+  }
+  workers_->push_back(worker);
+  return true;
+}
+
+void HostQueuePool::schedule(HostQueue* queue) {
+  static std::once_flag initialized;
+  std::call_once(initialized, init);
+
+  ready_->enqueue(queue);
+  ScopedLock lock(*lock_);
+  if (idle_ > 0) {
+    lock_->notify();
+  } else if ((running_ - blocked_) < target_) {
+    // The workers are started on demand, up to the target
+    addWorker();
+  }
+}
+
+void HostQueuePool::beginBlocking() {
+  ScopedLock lock(*lock_);
+  ++blocked_;
+  // Keep the target number of the workers, which can run the ready queues.
+  // The blocked chains can't be longer than the number of the queues
+  if ((idle_ == 0) && ((running_ - blocked_) < target_) &&
+      (running_ < GPU_MAX_COMMAND_QUEUES)) {
+    addWorker();
+  }
+}
+
+void HostQueuePool::endBlocking() {
+  ScopedLock lock(*lock_);
+  --blocked_;
+}
+
+void HostQueuePool::work() {
+  while (true) {
+    HostQueue* queue = ready_->dequeue();
+    if (queue == nullptr) {
+      ScopedLock lock(*lock_);
+      while ((queue = ready_->dequeue()) == nullptr) {
+        // The extra workers, started for the blocked ones, exit when they are idle
+        if ((running_ - blocked_) > target_) {
+          --running_;
+          return;
+        }
+        ++idle_;
+        lock_->wait();
+        --idle_;
+      }
+    }
+    queue->runPooled();
+  }
+}
+
 DeviceQueue::~DeviceQueue() {
   delete virtualDevice_;
   ScopedLock lock(context().lock());
@@ -160,20 +160,25 @@ class HostQueue : public CommandQueue {
 
     //! Create a new thread
     Thread()
-        : amd::Thread("Command Queue Thread", CQ_THREAD_STACK_SIZE, !AMD_DIRECT_DISPATCH),
+        : amd::Thread("Command Queue Thread", CQ_THREAD_STACK_SIZE,
+                      !(AMD_DIRECT_DISPATCH || AMD_QUEUE_THREAD_POOL || AMD_QUEUE_LAZY_THREAD)),
           acceptingCommands_(false),
           virtualDevice_(NULL) {}
 
     //! The command queue thread entry point.
     void run(void* data) {
       HostQueue* queue = static_cast<HostQueue*>(data);
-      virtualDevice_ = queue->device().createVirtualDevice(queue);
+      if (virtualDevice_ == NULL) {
+        virtualDevice_ = queue->device().createVirtualDevice(queue);
+      }
       if (virtualDevice_ != NULL) {
         queue->loop(virtualDevice_);
         Release();
       } else {
         acceptingCommands_ = false;
-        queue->flush();
+        // Wake up the creator of the queue
+        ScopedLock sl(queue->queueLock_);
+        queue->queueLock_.notify();
       }
     }
 
@@ -195,13 +200,122 @@ class HostQueue : public CommandQueue {
   } thread_;  //!< The command queue thread instance.
 
  private:
-  ConcurrentLinkedQueue<Command*> queue_;  //!< The queue.
+  static constexpr uint32_t RingSize = 1024;  //!< The number of the commands in the ring
+
+  //! The queue. append() serializes the producers, hence the ring is single producer
+  ConcurrentRingQueue<Command*, RingSize> queue_;
+  //! The commands, enqueued on the full ring. The ring isn't used until the overflow
+  //! is drained, so the commands keep the queue order. The producer doesn't block on
+  //! the full ring, since the queue thread can wait for a host event of the producer
+  ConcurrentLinkedQueue<Command*> overflow_;
+  //! The command, which the queue thread popped ahead of the processing
+  Command* deferred_;
+
+  //! Pushes the command into the queue
+  void push(Command* command) {
+    if (!overflow_.empty() || !queue_.tryEnqueue(command)) {
+      overflow_.enqueue(command);
+    }
+  }
+
+  //! Pops the oldest command from the queue. Returns NULL if the queue is empty
+  Command* pop() {
+    if (deferred_ != NULL) {
+      Command* command = deferred_;
+      deferred_ = NULL;
+      return command;
+    }
+    Command* command = queue_.dequeue();
+    return (command != NULL) ? command : overflow_.dequeue();
+  }
+
+  //! Returns TRUE if the queue is empty
+  bool empty() { return (deferred_ == NULL) && queue_.empty() && overflow_.empty(); }
+
+  //! True if the command queue thread sleeps on queueLock_ and requires a wake up.
+  //! Producers check the state after the push, so the lock and the notification
+  //! are skipped while the queue thread is active or spins on the empty queue
+  std::atomic_bool threadParked_;
 
   Command* lastEnqueueCommand_;  //!< The last submitted command
 
+  //! The queue timeline. Each enqueued command takes the next value of the counter and
+  //! the completed commands advance the device signal, so a wait for a point on the queue
+  //! doesn't require an event object
+  device::Signal* timeline_;                 //!< The signal with the completed value
+  std::atomic<uint64_t> timelineValue_;      //!< The value of the last enqueued command
+  std::atomic<uint64_t> timelineCompleted_;  //!< The value of the last completed command
+  std::atomic<uint64_t> timelineFlushed_;    //!< The value of the last drain marker
+  Monitor timelineLock_;                     //!< Keeps the timeline order of the appended commands
+
+  //! The queue is serviced by the shared workers of HostQueuePool instead of the own thread
+  const bool pooled_;
+  //! True if the queue is in the ready list of the pool or a worker processes it.
+  //! Only one worker can process the queue, hence the commands keep the queue order
+  std::atomic_bool scheduled_;
+  std::atomic<uint> poolActive_;  //!< The number of the pool workers, which access the queue
+  Command* poolHead_;             //!< Head of the pending batch in the pooled mode
+  Command* poolTail_;             //!< Tail of the pending batch in the pooled mode
+
+  //! The queue thread starts on the first enqueue instead of the queue creation
+  const bool lazyThread_;
+  std::atomic_bool threadStarted_;  //!< The queue thread was started
+
+  std::vector<Lane> lanes_;          //!< Lanes of the out of order queue, the first is vdev()
+  std::vector<Memory*> laneMemory_;  //!< The memory objects of the processed command
+
   //! Await commands and execute them as they become ready.
   void loop(device::VirtualDevice* virtualDevice);
 
+  //! Waits for the dependencies of the command and submits it to the device
+  void processCommand(Command* command, device::VirtualDevice* virtualDevice, Command*& head,
+                      Command*& tail);
+
+  //! Merges the run of small adjacent buffer writes or fills, which are in the queue already,
+  //! into one command. The merged commands are added into the batch without the submission.
+  //! Returns NULL if the command can't be merged
+  Command* coalesce(Command* command, Command*& head, Command*& tail, std::vector<Command*>* run);
+
+  //! Flushes the batch before a blocking wait, which can depend on any lane
+  void flushBatch(device::VirtualDevice* virtualDevice, Command*& head, Command*& tail);
+
+  //! The lane of an out of order queue. Each lane is a virtual device with own HW queue,
+  //! so the independent commands in different lanes run concurrently
+  struct Lane {
+    device::VirtualDevice* vdev_;      //!< The virtual device of the lane
+    Command* head_;                    //!< Head of the lane batch
+    Command* tail_;                    //!< Tail of the lane batch
+    uint count_;                       //!< The number of the commands in the batch
+    bool busyAll_;                     //!< The batch can access any memory
+    std::vector<const Memory*> busy_;  //!< The memory objects, accessed by the batch
+  };
+
+  //! Creates the extra lanes for the out of order queue
+  void createLanes(device::VirtualDevice* virtualDevice);
+
+  //! Destroys the extra lanes
+  void releaseLanes();
+
+  //! Finds the lane for the command and joins the lanes with the conflicting commands
+  Lane& selectLane(Command& command, bool known);
+
+  //! Flushes the batches of all lanes and waits for the completion
+  void flushLanes();
+
+  //! Submits the command into a lane of the out of order queue
+  void processLanes(Command* command);
+
+  //! Adds the queue to the ready list of the pool, unless it's scheduled already
+  void schedule();
+
+  //! Processes the queued commands on a pool worker
+  void runPooled();
+
+  //! Starts the queue thread on the first enqueue
+  void startThread();
+
+  friend class HostQueuePool;
+
  protected:
   virtual bool terminate();
 
@@ -215,6 +329,9 @@ class HostQueue : public CommandQueue {
             uint queueRTCUs = 0, Priority priority = Priority::Normal,
             const std::vector<uint32_t>& cuMask = {});
 
+  //! Destroys the timeline signal
+  virtual ~HostQueue();
+
   //! Returns TRUE if this command queue can accept commands.
   virtual bool create() { return thread_.acceptingCommands_; }
 
@@ -226,8 +343,15 @@ class HostQueue : public CommandQueue {
 
   //! Signal to start processing the commands in the queue.
   void flush() {
-    ScopedLock sl(queueLock_);
-    queueLock_.notify();
+    // Make sure the push into the queue is visible before the state check.
+    // The queue thread has the opposite order: update the state and then check the queue
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (pooled_) {
+      schedule();
+    } else if (threadParked_.load(std::memory_order_relaxed)) {
+      ScopedLock sl(queueLock_);
+      queueLock_.notify();
+    }
   }
 
   //! Finish all queued commands
@@ -257,6 +381,7 @@ class HostQueue : public CommandQueue {
       tail_->setNext(command);
       tail_ = command;
     }
+    command->setTimelineValue(timelineValue_.fetch_add(1, std::memory_order_acq_rel) + 1);
     command->setStatus(CL_SUBMITTED);
     command->retain();
     // @note: runtime needs double retain in order to maintain the batch,
@@ -278,12 +403,62 @@ class HostQueue : public CommandQueue {
   //! Reset the command batch list
   void ResetSubmissionBatch() { head_ = nullptr; }
 
+  //! Returns the timeline value of the last enqueued command
+  uint64_t timelineValue() const { return timelineValue_.load(std::memory_order_acquire); }
+
+  //! Returns TRUE if all commands up to the timeline value are complete
+  bool isTimelineReached(uint64_t value) const {
+    return timelineCompleted_.load(std::memory_order_acquire) >= value;
+  }
+
+  //! Waits until all commands up to the timeline value are complete
+  bool waitTimeline(uint64_t value);
+
+  //! Advances the completed timeline value, called on the command completion
+  void completeTimeline(uint64_t value);
+
 private:
   Command* head_;   //!< Head of the batch list
   Command* tail_;   //!< Tail of the batch list
 };
 
 
+//! The shared worker threads for the host queues, enabled with AMD_QUEUE_THREAD_POOL.
+//! The queues with the new commands are added into a ready list and any idle worker takes
+//! the next one. A worker, which blocks on a dependency, is compensated with an extra worker,
+//! so the queues it depends on still make progress
+class HostQueuePool : public AllStatic {
+ public:
+  //! Adds the queue with the new commands to the ready list
+  static void schedule(HostQueue* queue);
+
+  //! Marks the start of a blocking wait on the current pool worker
+  static void beginBlocking();
+
+  //! Marks the end of a blocking wait on the current pool worker
+  static void endBlocking();
+
+ private:
+  class Worker;
+
+  //! The worker loop, which processes the ready queues
+  static void work();
+
+  //! Initializes the pool on the first use
+  static void init();
+
+  //! Starts a new worker. The caller must hold the pool lock
+  static bool addWorker();
+
+  static ConcurrentLinkedQueue<HostQueue*>* ready_;  //!< The queues with the new commands
+  static Monitor* lock_;                             //!< Lock for the idle workers
+  static std::vector<Worker*>* workers_;             //!< All started workers
+  static uint target_;   //!< The number of the workers, which must be able to run
+  static uint running_;  //!< The number of the started workers
+  static uint idle_;     //!< The number of the workers, which wait for the ready queues
+  static uint blocked_;  //!< The number of the workers, blocked on a dependency
+};
+
 class DeviceQueue : public CommandQueue {
  public:
   DeviceQueue(Context& context,                        //!< Context object
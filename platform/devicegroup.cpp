@@ -0,0 +1,452 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "platform/devicegroup.hpp"
+#include "platform/kernel.hpp"
+#include "platform/memory.hpp"
+#include "device/device.hpp"
+#include "os/os.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace amd {
+
+// ================================================================================================
+DeviceGroup* DeviceGroup::create(Context& context) {
+  DeviceGroup* group = new DeviceGroup(context);
+  if ((group == nullptr) || !group->init()) {
+    delete group;
+    return nullptr;
+  }
+  return group;
+}
+
+// ================================================================================================
+DeviceGroup::~DeviceGroup() {
+  if (scheduler_ != nullptr) {
+    // The callbacks of the submitted commands reference the group
+    finish();
+    {
+      ScopedLock lock(lock_);
+      stop_ = true;
+      lock_.notifyAll();
+    }
+    while (scheduler_->state() < Thread::FINISHED) {
+      Os::yield();
+    }
+    delete scheduler_;
+  }
+  for (const auto& member : members_) {
+    member.queue_->release();
+  }
+  context_.release();
+}
+
+// ================================================================================================
+bool DeviceGroup::init() {
+  for (Device* device : context_.devices()) {
+    if (device->type() != CL_DEVICE_TYPE_GPU) {
+      continue;
+    }
+    HostQueue* queue = new HostQueue(context_, *device, 0);
+    if ((queue == nullptr) || !queue->create()) {
+      LogError("Device group queue creation failed");
+      if (queue != nullptr) {
+        queue->release();
+      }
+      return false;
+    }
+    members_.push_back({queue, 0, {}, {}});
+  }
+  if (members_.empty()) {
+    LogError("Device group requires GPU devices");
+    return false;
+  }
+
+  // The link distances select the member, which needs the least data movement
+  for (auto& member : members_) {
+    Device& device = member.queue_->device();
+    for (const auto& other : members_) {
+      int32_t distance = 0;
+      if (&other.queue_->device() != &device) {
+        distance = kNoLinkDistance;
+        std::vector<Device::LinkAttrType> linkAttrs;
+        linkAttrs.push_back(std::make_pair(Device::kLinkDistance, 0));
+        // The legacy devices don't report the links
+        if (!IS_LEGACY && device.findLinkInfo(other.queue_->device(), &linkAttrs)) {
+          distance = linkAttrs[0].second;
+        }
+      }
+      member.distance_.push_back(distance);
+    }
+  }
+
+  scheduler_ = new Scheduler(*this);
+  if ((scheduler_ == nullptr) || (scheduler_->state() < Thread::INITIALIZED) ||
+      !scheduler_->start()) {
+    LogError("Device group scheduler creation failed");
+    delete scheduler_;
+    scheduler_ = nullptr;
+    return false;
+  }
+  ClPrint(LOG_INFO, LOG_INIT, "Device group %p with %zu devices", this, members_.size());
+  return true;
+}
+
+// ================================================================================================
+bool DeviceGroup::splittable(const Kernel& kernel, std::vector<Memory*>* memories) const {
+  const KernelSignature& signature = kernel.signature();
+  const KernelParameters& params = kernel.parameters();
+  // HIP kernels don't apply the global offset to the work-item IDs and the SVM pointers
+  // in the exec info can reach any memory
+  bool result = !IS_HIP && (members_.size() > 1) && (params.getNumberOfSvmPtr() == 0);
+
+  Memory* const* objects =
+      reinterpret_cast<Memory* const*>(params.values() + params.memoryObjOffset());
+  for (size_t i = 0; i < signature.numParameters(); ++i) {
+    const KernelParameterDescriptor& desc = signature.at(i);
+    if ((desc.info_.oclObject_ != KernelParameterDescriptor::MemoryObject) &&
+        (desc.info_.oclObject_ != KernelParameterDescriptor::ImageObject)) {
+      continue;
+    }
+    Memory* memory = objects[desc.info_.arrayIndex_];
+    if (memory == nullptr) {
+      // A raw pointer without an allocation is the system memory, coherent between the devices
+      continue;
+    }
+    memories->push_back(memory);
+    const bool readOnly = desc.info_.readOnly_ || ((memory->getMemFlags() & CL_MEM_READ_ONLY) != 0);
+    const bool coherent = (desc.info_.oclObject_ == KernelParameterDescriptor::MemoryObject) &&
+                          ((memory->getMemFlags() & CL_MEM_SVM_FINE_GRAIN_BUFFER) != 0);
+    if (!readOnly && !coherent) {
+      // The chunks would write the separate copies of the memory on the members
+      result = false;
+    }
+  }
+  return result;
+}
+
+// ================================================================================================
+size_t DeviceGroup::owner(Memory* memory) const {
+  const Device* writer = memory->getLastWriter();
+  for (size_t i = 0; i < members_.size(); ++i) {
+    if (&members_[i].queue_->device() == writer) {
+      return i;
+    }
+  }
+  return members_.size();
+}
+
+// ================================================================================================
+size_t DeviceGroup::place(const std::vector<Memory*>& memories) const {
+  size_t best = 0;
+  int64_t bestCost = std::numeric_limits<int64_t>::max();
+  for (size_t i = 0; i < members_.size(); ++i) {
+    // The busy member costs as much as a longer link, so the independent work spreads out
+    int64_t cost = static_cast<int64_t>(members_[i].inFlight_) * kLoadDistance;
+    for (Memory* memory : memories) {
+      const size_t writer = owner(memory);
+      if (writer < members_.size()) {
+        cost += members_[i].distance_[writer];
+      }
+    }
+    if (cost < bestCost) {
+      bestCost = cost;
+      best = i;
+    }
+  }
+  return best;
+}
+
+// ================================================================================================
+DeviceGroup::Task* DeviceGroup::addTask(size_t member, const Chunk& chunk) {
+  ++members_[member].inFlight_;
+  ++outstanding_;
+  return new Task{this, member, chunk, CL_SUCCESS};
+}
+
+// ================================================================================================
+bool DeviceGroup::takeChunk(size_t member, Chunk* chunk) {
+  size_t source = member;
+  if (members_[member].chunks_.empty()) {
+    // Steal from the member with the most chunks left, the nearest one on a tie
+    source = members_.size();
+    for (size_t i = 0; i < members_.size(); ++i) {
+      const size_t count = members_[i].chunks_.size();
+      if ((count > 0) &&
+          ((source == members_.size()) || (count > members_[source].chunks_.size()) ||
+           ((count == members_[source].chunks_.size()) &&
+            (members_[member].distance_[i] < members_[member].distance_[source])))) {
+        source = i;
+      }
+    }
+    if (source == members_.size()) {
+      return false;
+    }
+    // The tail is the farthest work from the current position of the victim
+    *chunk = members_[source].chunks_.back();
+    members_[source].chunks_.pop_back();
+    ClPrint(LOG_DEBUG, LOG_CMD, "Device group %p: member %zu steals a chunk of member %zu",
+            this, member, source);
+    return true;
+  }
+  *chunk = members_[source].chunks_.front();
+  members_[source].chunks_.pop_front();
+  return true;
+}
+
+// ================================================================================================
+void DeviceGroup::refill(std::vector<Task*>* tasks) {
+  for (size_t i = 0; i < members_.size(); ++i) {
+    Chunk chunk;
+    while ((members_[i].inFlight_ < kInFlightPerDevice) && takeChunk(i, &chunk)) {
+      tasks->push_back(addTask(i, chunk));
+    }
+  }
+}
+
+// ================================================================================================
+bool DeviceGroup::submit(Task* task, Command* command) {
+  if (!command->setCallback(CL_COMPLETE, taskDone, task)) {
+    command->release();
+    taskDone(nullptr, CL_OUT_OF_HOST_MEMORY, task);
+    return false;
+  }
+  command->enqueue();
+  command->release();
+  return true;
+}
+
+// ================================================================================================
+void DeviceGroup::submitChunk(Task* task) {
+  const Launch& launch = *task->chunk_.launch_;
+  NDRangeContainer sizes(launch.sizes_);
+  sizes.offset()[0] += task->chunk_.begin_;
+  sizes.global()[0] = task->chunk_.end_ - task->chunk_.begin_;
+
+  NDRangeKernelCommand* command =
+      new NDRangeKernelCommand(*members_[task->member_].queue_, launch.waitList_,
+                               *launch.kernel_, sizes, launch.sharedMemBytes_);
+  if ((command == nullptr) || (command->captureAndValidate() != CL_SUCCESS)) {
+    LogError("Device group chunk submission failed");
+    if (command != nullptr) {
+      command->release();
+    }
+    taskDone(nullptr, CL_OUT_OF_RESOURCES, task);
+    return;
+  }
+  submit(task, command);
+}
+
+// ================================================================================================
+Event* DeviceGroup::enqueueNDRange(Kernel& kernel, const NDRangeContainer& sizes,
+                                   const Command::EventWaitList& waitList,
+                                   uint32_t sharedMemBytes) {
+  std::vector<Memory*> memories;
+  const size_t total = sizes.global()[0];
+  size_t step = 0;
+  if (splittable(kernel, &memories)) {
+    const size_t alignment = (sizes.local()[0] != 0) ? sizes.local()[0] : kChunkAlignment;
+    step = alignUp(std::max<size_t>(total / (members_.size() * kChunksPerDevice), 1), alignment);
+  }
+
+  if ((step == 0) || (step >= total)) {
+    // The launch runs whole on the member close to its memory
+    Task* task = nullptr;
+    {
+      ScopedLock lock(lock_);
+      task = addTask(place(memories), Chunk{nullptr, 0, 0});
+    }
+    NDRangeKernelCommand* command = new NDRangeKernelCommand(
+        *members_[task->member_].queue_, waitList, kernel, sizes, sharedMemBytes);
+    if ((command == nullptr) || (command->captureAndValidate() != CL_SUCCESS)) {
+      if (command != nullptr) {
+        command->release();
+      }
+      taskDone(nullptr, CL_OUT_OF_RESOURCES, task);
+      return nullptr;
+    }
+    // The caller gets a reference to the command
+    command->retain();
+    if (!submit(task, command)) {
+      command->release();
+      return nullptr;
+    }
+    return command;
+  }
+
+  // The snapshot keeps the arguments for the chunks, submitted after the application changed them
+  Kernel* snapshot = new Kernel(kernel);
+  UserEvent* event = new UserEvent(context_);
+  if ((snapshot == nullptr) || (event == nullptr)) {
+    if (snapshot != nullptr) {
+      snapshot->release();
+    }
+    if (event != nullptr) {
+      event->release();
+    }
+    return nullptr;
+  }
+  for (auto waitEvent : waitList) {
+    waitEvent->retain();
+  }
+  const uint32_t count = static_cast<uint32_t>((total + step - 1) / step);
+  Launch* launch =
+      new Launch{snapshot, sizes, sharedMemBytes, waitList, event, count, CL_SUCCESS};
+  // The caller gets a reference to the event
+  event->retain();
+
+  std::vector<Task*> tasks;
+  {
+    ScopedLock lock(lock_);
+    ++outstanding_;
+    // The contiguous ranges keep the neighbour work-groups on the same member
+    uint32_t chunk = 0;
+    for (size_t i = 0; i < members_.size(); ++i) {
+      const uint32_t last = static_cast<uint32_t>(count * (i + 1) / members_.size());
+      for (; chunk < last; ++chunk) {
+        members_[i].chunks_.push_back(
+            {launch, chunk * step, std::min((chunk + 1) * step, total)});
+      }
+    }
+    refill(&tasks);
+  }
+  ClPrint(LOG_INFO, LOG_CMD, "Device group %p: %s split into %u chunks of %zu work-items",
+          this, kernel.name().c_str(), count, step);
+  for (Task* task : tasks) {
+    submitChunk(task);
+  }
+  return event;
+}
+
+// ================================================================================================
+Event* DeviceGroup::enqueueCopy(Buffer& src, Buffer& dst, size_t srcOffset, size_t dstOffset,
+                                size_t size, const Command::EventWaitList& waitList) {
+  Task* task = nullptr;
+  {
+    ScopedLock lock(lock_);
+    // The copy runs on the member with the shortest links to both buffers
+    task = addTask(place({&src, &dst}), Chunk{nullptr, 0, 0});
+  }
+  CopyMemoryCommand* command = new CopyMemoryCommand(
+      *members_[task->member_].queue_, CL_COMMAND_COPY_BUFFER, waitList, src, dst,
+      Coord3D(srcOffset), Coord3D(dstOffset), Coord3D(size));
+  if ((command == nullptr) || !command->validateMemory()) {
+    if (command != nullptr) {
+      command->release();
+    }
+    taskDone(nullptr, CL_MEM_OBJECT_ALLOCATION_FAILURE, task);
+    return nullptr;
+  }
+  command->retain();
+  if (!submit(task, command)) {
+    command->release();
+    return nullptr;
+  }
+  return command;
+}
+
+// ================================================================================================
+void DeviceGroup::finish() {
+  ScopedLock lock(lock_);
+  while (outstanding_ > 0) {
+    lock_.wait();
+  }
+}
+
+// ================================================================================================
+void CL_CALLBACK DeviceGroup::taskDone(cl_event event, int32_t status, void* data) {
+  Task* task = reinterpret_cast<Task*>(data);
+  DeviceGroup& group = *task->group_;
+  // The callback runs on the queue thread, hence the scheduler submits the next chunks
+  ScopedLock lock(group.lock_);
+  task->status_ = status;
+  group.completions_.push_back(task);
+  group.lock_.notifyAll();
+}
+
+// ================================================================================================
+DeviceGroup::Launch* DeviceGroup::retire(Task* task) {
+  --members_[task->member_].inFlight_;
+  --outstanding_;
+  Launch* launch = task->chunk_.launch_;
+  if (launch != nullptr) {
+    if (task->status_ < 0) {
+      launch->status_ = task->status_;
+    }
+    if (--launch->remaining_ > 0) {
+      launch = nullptr;
+    }
+  }
+  delete task;
+  return launch;
+}
+
+// ================================================================================================
+void DeviceGroup::completeLaunch(Launch* launch) {
+  launch->event_->setStatus((launch->status_ < 0) ? launch->status_ : CL_COMPLETE);
+  launch->event_->release();
+  launch->kernel_->release();
+  for (auto event : launch->waitList_) {
+    event->release();
+  }
+  delete launch;
+}
+
+// ================================================================================================
+void DeviceGroup::schedule() {
+  std::vector<Task*> tasks;
+  std::vector<Launch*> launches;
+  while (true) {
+    {
+      ScopedLock lock(lock_);
+      // The launches of the last pass are complete, so finish() can return
+      outstanding_ -= static_cast<uint32_t>(launches.size());
+      lock_.notifyAll();
+      tasks.clear();
+      launches.clear();
+      while (completions_.empty() && !stop_) {
+        lock_.wait();
+      }
+      if (completions_.empty()) {
+        break;
+      }
+      while (!completions_.empty()) {
+        Launch* launch = retire(completions_.front());
+        completions_.pop_front();
+        if (launch != nullptr) {
+          launches.push_back(launch);
+        }
+      }
+      // The members with the free slots take the next chunks
+      refill(&tasks);
+    }
+    // The commands are submitted without the lock, since the completion callbacks take it
+    for (Task* task : tasks) {
+      submitChunk(task);
+    }
+    for (Launch* launch : launches) {
+      completeLaunch(launch);
+    }
+  }
+}
+
+}  // namespace amd
@@ -0,0 +1,180 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include "top.hpp"
+#include "platform/command.hpp"
+#include "platform/commandqueue.hpp"
+#include "platform/context.hpp"
+#include "thread/monitor.hpp"
+
+#include <deque>
+#include <vector>
+
+namespace amd {
+
+//! A logical device over the GPU devices of a context. The group has a queue on each member
+//! and distributes the launches and the copies between them. An OpenCL launch is split into
+//! chunks along the first dimension with the global offset. The chunks are dealt to the members
+//! in contiguous ranges and a member, which runs out of chunks, steals from the tail of
+//! the busiest member. The member gets the next chunk on the completion of its previous chunk.
+//! A launch, which writes the device memory, runs whole on one member, selected by the placement
+//! of the memory (the last writer) and the P2P link distances, so the data moves the least.
+//! @note: The group doesn't track the dependencies between its launches, the caller orders them
+//! with the returned events, the same way as between the queues of a context. A chunk reports
+//! its own size in get_global_size(), so the split kernels must index with get_global_id() only.
+class DeviceGroup : public HeapObject {
+ public:
+  static constexpr uint32_t kChunksPerDevice = 4;    //!< The chunks of a launch per member
+  static constexpr uint32_t kInFlightPerDevice = 2;  //!< The submitted chunks per member
+
+  //! Creates the group over the GPU devices of the context. Returns nullptr on a failure
+  static DeviceGroup* create(Context& context);
+
+  ~DeviceGroup();
+
+  //! Returns the number of the member devices
+  size_t size() const { return members_.size(); }
+
+  //! Returns the queue of the member
+  HostQueue& queue(size_t member) const { return *members_[member].queue_; }
+
+  //! Enqueues the launch of the kernel with the current arguments. Returns the event of
+  //! the launch, which the caller must release, or nullptr on a failure
+  Event* enqueueNDRange(Kernel& kernel, const NDRangeContainer& sizes,
+                        const Command::EventWaitList& waitList, uint32_t sharedMemBytes = 0);
+
+  //! Enqueues the buffer copy on the member close to the data. Returns the event of the copy,
+  //! which the caller must release, or nullptr on a failure
+  Event* enqueueCopy(Buffer& src, Buffer& dst, size_t srcOffset, size_t dstOffset, size_t size,
+                     const Command::EventWaitList& waitList);
+
+  //! Waits for all commands of the group
+  void finish();
+
+ private:
+  //! The launch split into the chunks
+  struct Launch {
+    Kernel* kernel_;                     //!< The snapshot of the kernel arguments
+    NDRangeContainer sizes_;             //!< The sizes of the whole launch
+    uint32_t sharedMemBytes_;            //!< The dynamic shared memory
+    Command::EventWaitList waitList_;    //!< The dependencies of the launch
+    UserEvent* event_;                   //!< The event of the whole launch
+    uint32_t remaining_;                 //!< The chunks, which didn't complete
+    int32_t status_;                     //!< The status of the launch
+  };
+
+  //! A range of the work-items in the first dimension
+  struct Chunk {
+    Launch* launch_;  //!< The launch of the chunk
+    size_t begin_;    //!< The first work-item of the chunk
+    size_t end_;      //!< The end of the chunk
+  };
+
+  //! A submitted command of the group
+  struct Task {
+    DeviceGroup* group_;  //!< The group of the command
+    size_t member_;       //!< The member, which runs the command
+    Chunk chunk_;         //!< The chunk of the launch or an empty chunk for the other commands
+    int32_t status_;      //!< The completion status
+  };
+
+  //! The member device
+  struct Member {
+    HostQueue* queue_;               //!< The queue of the member
+    uint32_t inFlight_;              //!< The submitted commands, which didn't complete
+    std::deque<Chunk> chunks_;       //!< The chunks, which wait for the submission
+    std::vector<int32_t> distance_;  //!< The link distances to the other members
+  };
+
+  //! The scheduler thread, which submits the next chunks on the completions
+  class Scheduler : public Thread {
+   public:
+    Scheduler(DeviceGroup& group)
+        : Thread("Device Group Scheduler", CQ_THREAD_STACK_SIZE), group_(group) {}
+
+    //! The scheduler entry point
+    void run(void* data) { group_.schedule(); }
+
+   private:
+    DeviceGroup& group_;
+  };
+
+  static constexpr int32_t kNoLinkDistance = 1000;  //!< The distance without the link info
+  static constexpr int32_t kLoadDistance = 20;      //!< The distance of a command in flight
+  static constexpr size_t kChunkAlignment = 256;    //!< The chunk alignment without local size
+
+  DeviceGroup(Context& context)
+      : context_(context), lock_("Device group lock"), scheduler_(nullptr), stop_(false),
+        outstanding_(0) {
+    context_.retain();
+  }
+
+  //! Creates the member queues and the distance matrix
+  bool init();
+
+  //! Returns TRUE if the chunks of the kernel can run on the different devices
+  bool splittable(const Kernel& kernel, std::vector<Memory*>* memories) const;
+
+  //! Returns the member for the command, which accesses the memory objects
+  size_t place(const std::vector<Memory*>& memories) const;
+
+  //! Returns the member the memory lives on or the member count for the host memory
+  size_t owner(Memory* memory) const;
+
+  //! Creates the task for the member. Must be called under the lock
+  Task* addTask(size_t member, const Chunk& chunk);
+
+  //! Takes the next chunk for the member, stealing it from the busiest member if needed.
+  //! Returns FALSE if no chunks are left. Must be called under the lock
+  bool takeChunk(size_t member, Chunk* chunk);
+
+  //! Submits the chunks, taken for the members with an empty slot. Must be called under the lock
+  void refill(std::vector<Task*>* tasks);
+
+  //! Submits the command of the task and tracks its completion. Returns FALSE on a failure
+  bool submit(Task* task, Command* command);
+
+  //! Submits the chunk of the task
+  void submitChunk(Task* task);
+
+  //! Retires the completed task. Returns the launch if it's finished. Must be called under the lock
+  Launch* retire(Task* task);
+
+  //! Completes the launch and releases its resources
+  static void completeLaunch(Launch* launch);
+
+  //! The completion callback of the submitted commands
+  static void CL_CALLBACK taskDone(cl_event event, int32_t status, void* data);
+
+  //! The scheduler loop
+  void schedule();
+
+  Context& context_;               //!< The context of the group
+  std::vector<Member> members_;    //!< The member devices
+  Monitor lock_;                   //!< The lock for the scheduling state
+  std::deque<Task*> completions_;  //!< The completed tasks, which wait for the scheduler
+  Scheduler* scheduler_;           //!< The scheduler thread
+  bool stop_;                      //!< The scheduler must exit
+  uint32_t outstanding_;           //!< The tasks and the launches, which didn't complete
+};
+
+}  // namespace amd
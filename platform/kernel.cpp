@@ -25,8 +25,42 @@
 #include "platform/commandqueue.hpp"
 #include "platform/sampler.hpp"
 
+#include <algorithm>
+
 namespace amd {
 
+//! The number of the cached pointer lookups per thread
+static constexpr size_t kPointerCacheSize = 16;
+
+//! Per-thread cache of the resolved SVM pointers of the kernel arguments.
+//! The applications pass the same pointers on each launch, so the steady state doesn't
+//! search the global map. The entries are valid for the generation of MemObjMap only
+struct PointerCache {
+  struct Entry {
+    const void* ptr_;     //!< The pointer of the argument
+    Memory* memory_;      //!< The memory object of the pointer
+    uint64_t generation_; //!< The map generation of the lookup
+  };
+  Entry entries_[kPointerCacheSize];
+
+  Memory* find(const void* ptr) {
+    const uint64_t generation = MemObjMap::generation();
+    Entry& entry = entries_[(reinterpret_cast<uintptr_t>(ptr) >> 4) % kPointerCacheSize];
+    if ((entry.ptr_ == ptr) && (entry.generation_ == generation) && (ptr != nullptr)) {
+      return entry.memory_;
+    }
+    Memory* memory = MemObjMap::FindMemObj(ptr);
+    // The raw pointers without an allocation aren't cached, since a new allocation
+    // doesn't change the generation
+    if (memory != nullptr) {
+      entry = {ptr, memory, generation};
+    }
+    return memory;
+  }
+};
+
+static thread_local PointerCache pointerCache = {};
+
 Kernel::Kernel(Program& program, const Symbol& symbol, const std::string& name)
     : program_(program), symbol_(symbol), name_(name) {
   parameters_ = new (signature()) KernelParameters(const_cast<KernelSignature&>(signature()));
@@ -100,8 +134,8 @@ void KernelParameters::set(size_t index, size_t size, const void* value, bool sv
     if (svmBound) {
       desc.info_.rawPointer_ = true;
       LP64_SWITCH(uint32_value, uint64_value) = *(LP64_SWITCH(uint32_t*, uint64_t*))value;
-      memoryObjects_[desc.info_.arrayIndex_] = amd::MemObjMap::FindMemObj(
-        *reinterpret_cast<const void* const*>(value));
+      memoryObjects_[desc.info_.arrayIndex_] =
+          pointerCache.find(*reinterpret_cast<const void* const*>(value));
     } else if ((value == NULL) || (static_cast<const cl_mem*>(value) == NULL)) {
       desc.info_.rawPointer_ = false;
       memoryObjects_[desc.info_.arrayIndex_] = nullptr;
@@ -154,17 +188,91 @@ void KernelParameters::set(size_t index, size_t size, const void* value, bool sv
   desc.info_.defined_ = true;
 }
 
-address KernelParameters::capture(const Device& device, uint64_t lclMemSize, int32_t* error) {
+bool KernelParameters::setAll(const void* const* args, bool svmBound) {
+  if (!signature_.bulkSupported()) {
+    return false;
+  }
+  std::vector<KernelParameterDescriptor>& params = signature_.params();
+  for (uint32_t index : signature_.valueParams()) {
+    KernelParameterDescriptor& desc = params[index];
+    ::memcpy(values_ + desc.offset_, args[index], desc.size_);
+    desc.info_.defined_ = true;
+  }
+  for (uint32_t index : signature_.pointerParams()) {
+    KernelParameterDescriptor& desc = params[index];
+    if (svmBound) {
+      const void* ptr = *reinterpret_cast<const void* const*>(args[index]);
+      ::memcpy(values_ + desc.offset_, args[index], desc.size_);
+      desc.info_.rawPointer_ = true;
+      desc.info_.defined_ = true;
+      memoryObjects_[desc.info_.arrayIndex_] = pointerCache.find(ptr);
+    } else {
+      set(index, desc.size_, args[index]);
+    }
+  }
+  for (uint32_t index : signature_.objectParams()) {
+    set(index, params[index].size_, args[index]);
+  }
+  return true;
+}
+
+bool KernelParameters::setPacked(const void* buffer, size_t size) {
+  if (!signature_.bulkSupported() || !signature_.objectParams().empty() ||
+      (size < signature_.explicitSize())) {
+    return false;
+  }
+  ::memcpy(values_, buffer, signature_.explicitSize());
+  std::vector<KernelParameterDescriptor>& params = signature_.params();
+  for (uint32_t index : signature_.valueParams()) {
+    params[index].info_.defined_ = true;
+  }
+  // The packed buffers pass the device addresses, hence the pointers are SVM bound
+  for (uint32_t index : signature_.pointerParams()) {
+    KernelParameterDescriptor& desc = params[index];
+    desc.info_.rawPointer_ = true;
+    desc.info_.defined_ = true;
+    memoryObjects_[desc.info_.arrayIndex_] =
+        pointerCache.find(*reinterpret_cast<const void* const*>(values_ + desc.offset_));
+  }
+  return true;
+}
+
+bool KernelParameters::setView(size_t index, Memory* parent, size_t offset) {
+  KernelParameterDescriptor& desc = signature_.params()[index];
+  if ((desc.type_ != T_POINTER) || (desc.addressQualifier_ == CL_KERNEL_ARG_ADDRESS_LOCAL) ||
+      (desc.size_ != sizeof(uint64_t)) || (parent == nullptr) || (parent->asBuffer() == nullptr) ||
+      (offset >= parent->getSize())) {
+    LogError("Invalid buffer view for the kernel argument!");
+    return false;
+  }
+
+  desc.info_.rawPointer_ = false;
+  memoryObjects_[desc.info_.arrayIndex_] = parent;
+  // The argument keeps the offset, which is added to the parent address on the capture
+  *reinterpret_cast<uint64_t*>(values_ + desc.offset_) = offset;
+  desc.info_.defined_ = true;
+  return true;
+}
+
+address KernelParameters::capture(const Device& device, uint64_t lclMemSize, int32_t* error,
+                                  bool objectsOnly, MonotonicMemory* arena) {
   *error = CL_SUCCESS;
   //! Information about which arguments are SVM pointers is stored after
   // the actual parameters, but only if the device has any SVM capability
   const size_t execInfoSize = getNumberOfSvmPtr() * sizeof(void*);
 
-  address mem = reinterpret_cast<address>(AlignedMemory::allocate(
-    totalSize_ + execInfoSize, PARAMETERS_MIN_ALIGNMENT));
+  address mem = reinterpret_cast<address>((arena != nullptr) ?
+    arena->allocate(totalSize_ + execInfoSize, PARAMETERS_MIN_ALIGNMENT) :
+    AlignedMemory::allocate(totalSize_ + execInfoSize, PARAMETERS_MIN_ALIGNMENT));
 
   if (mem != nullptr) {
-    ::memcpy(mem, values_, totalSize_);
+    if (objectsOnly) {
+      // The values will be serialized into the kernarg memory, keep the objects only
+      ::memcpy(mem + memoryObjOffset_, values_ + memoryObjOffset_,
+               totalSize_ - memoryObjOffset_);
+    } else {
+      ::memcpy(mem, values_, totalSize_);
+    }
 
     for (size_t i = 0; i < signature_.numParameters(); ++i) {
       const KernelParameterDescriptor& desc = signature_.at(i);
@@ -179,8 +287,9 @@ address KernelParameters::capture(const Device& device, uint64_t lclMemSize, int
             break;
           }
           // Write GPU VA addreess to the arguments
-          if (!desc.info_.rawPointer_) {
-            *reinterpret_cast<uintptr_t*>(mem + desc.offset_) = static_cast<uintptr_t>
+          if (!desc.info_.rawPointer_ && !objectsOnly) {
+            // A buffer view keeps the offset in the argument, otherwise it's 0
+            *reinterpret_cast<uintptr_t*>(mem + desc.offset_) += static_cast<uintptr_t>
               (devMem->virtualAddress());
           }
         } else if (desc.info_.rawPointer_) {
@@ -191,16 +300,20 @@ address KernelParameters::capture(const Device& device, uint64_t lclMemSize, int
         Sampler* samplerArg = samplerObjects_[desc.info_.arrayIndex_];
         if (samplerArg != nullptr) {
           samplerArg->retain();
-          // todo: It's uint64_t type
-          *reinterpret_cast<uintptr_t*>(mem + desc.offset_) = static_cast<uintptr_t>(
-            samplerArg->getDeviceSampler(device)->hwSrd());
+          if (!objectsOnly) {
+            // todo: It's uint64_t type
+            *reinterpret_cast<uintptr_t*>(mem + desc.offset_) = static_cast<uintptr_t>(
+              samplerArg->getDeviceSampler(device)->hwSrd());
+          }
         }
       } else if (desc.type_ == T_QUEUE) {
         DeviceQueue* queue = queueObjects_[desc.info_.arrayIndex_];
         if (queue != nullptr) {
           queue->retain();
-          // todo: It's uint64_t type
-          *reinterpret_cast<uintptr_t*>(mem + desc.offset_) = 0;
+          if (!objectsOnly) {
+            // todo: It's uint64_t type
+            *reinterpret_cast<uintptr_t*>(mem + desc.offset_) = 0;
+          }
         }
       } else if (desc.addressQualifier_ == CL_KERNEL_ARG_ADDRESS_LOCAL) {
         if (desc.size_ == 8) {
@@ -228,7 +341,9 @@ address KernelParameters::capture(const Device& device, uint64_t lclMemSize, int
 
   // Check if capture was successful 
   if (CL_SUCCESS != *error) {
-    AlignedMemory::deallocate(mem);
+    if (arena == nullptr) {
+      AlignedMemory::deallocate(mem);
+    }
     mem = nullptr;
   }
   return mem;
@@ -246,7 +361,7 @@ bool KernelParameters::boundToSvmPointer(const Device& device, const_address cap
   return svmBound[index];
 }
 
-void KernelParameters::release(address mem, const amd::Device& device) const {
+void KernelParameters::release(address mem, const amd::Device& device, bool fromArena) const {
   if (mem == nullptr) {
     // nothing to do!
     return;
@@ -278,7 +393,9 @@ void KernelParameters::release(address mem, const amd::Device& device) const {
     }
   }
 
-  AlignedMemory::deallocate(mem);
+  if (!fromArena) {
+    AlignedMemory::deallocate(mem);
+  }
 }
 
 KernelSignature::KernelSignature(const std::vector<KernelParameterDescriptor>& params,
@@ -292,7 +409,9 @@ KernelSignature::KernelSignature(const std::vector<KernelParameterDescriptor>& p
   , numMemories_(0)
   , numSamplers_(0)
   , numQueues_(0)
-  , version_(version) {
+  , version_(version)
+  , explicitSize_(0)
+  , bulkSupported_(true) {
   size_t maxOffset = 0;
   size_t last = 0;
   // Find the last entry
@@ -319,6 +438,20 @@ KernelSignature::KernelSignature(const std::vector<KernelParameterDescriptor>& p
       params_[i].info_.arrayIndex_ = numQueues_   ;
       ++numQueues_;
     }
+
+    // Build the plan of the bulk setters for the explicit arguments
+    if (i < numParameters) {
+      if (desc.addressQualifier_ == CL_KERNEL_ARG_ADDRESS_LOCAL) {
+        bulkSupported_ = false;
+      } else if (desc.type_ == T_POINTER) {
+        pointerParams_.push_back(static_cast<uint32_t>(i));
+      } else if ((desc.type_ == T_SAMPLER) || (desc.type_ == T_QUEUE)) {
+        objectParams_.push_back(static_cast<uint32_t>(i));
+      } else {
+        valueParams_.push_back(static_cast<uint32_t>(i));
+      }
+      explicitSize_ = std::max(explicitSize_, static_cast<uint32_t>(desc.offset_ + desc.size_));
+    }
   }
 
   if (params.size() > 0) {
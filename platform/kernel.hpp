@@ -61,6 +61,12 @@ class KernelSignature : public HeapObject {
   uint32_t  numQueues_;     //!< The number of queue objects used in the kernel
   uint32_t  version_;       //!< The ABI version
 
+  std::vector<uint32_t> valueParams_;    //!< The plain values for the bulk setters
+  std::vector<uint32_t> pointerParams_;  //!< The global memory pointers for the bulk setters
+  std::vector<uint32_t> objectParams_;   //!< The samplers and queues for the bulk setters
+  uint32_t  explicitSize_;  //!< The size of the explicit arguments in the packed layout
+  bool      bulkSupported_; //!< The kernel doesn't have the local memory arguments
+
  public:
   enum {
     ABIVersion_0 = 0,   //! ABI constructed based on the OCL semantics
@@ -71,7 +77,7 @@ class KernelSignature : public HeapObject {
   //! Default constructor
   KernelSignature():
     numParameters_(0), paramsSize_(0), numMemories_(0), numSamplers_(0),
-    numQueues_(0), version_(ABIVersion_0) {}
+    numQueues_(0), version_(ABIVersion_0), explicitSize_(0), bulkSupported_(true) {}
 
   //! Construct a new signature.
   KernelSignature(const std::vector<KernelParameterDescriptor>& params,
@@ -113,6 +119,21 @@ class KernelSignature : public HeapObject {
 
   const std::vector<KernelParameterDescriptor>& parameters() const
     { return params_; }
+
+  //! Returns the indices of the plain value arguments
+  const std::vector<uint32_t>& valueParams() const { return valueParams_; }
+
+  //! Returns the indices of the global memory pointer arguments
+  const std::vector<uint32_t>& pointerParams() const { return pointerParams_; }
+
+  //! Returns the indices of the sampler and queue arguments
+  const std::vector<uint32_t>& objectParams() const { return objectParams_; }
+
+  //! Returns the size of the explicit arguments, laid out at the descriptor offsets
+  uint32_t explicitSize() const { return explicitSize_; }
+
+  //! Returns TRUE if the bulk setters can define all arguments
+  bool bulkSupported() const { return bulkSupported_; }
 };
 
 // @todo: look into a copy-on-write model instead of copy-on-read.
@@ -200,6 +221,21 @@ class KernelParameters : protected HeapObject {
   // \a svmBound indicates that \a value is a SVM pointer.
   void set(size_t index, size_t size, const void* value, bool svmBound = false);
 
+  //! Set the buffer parameter at the given \a index to a view of \a parent at \a offset.
+  //! The view doesn't have own memory objects, so the device address is resolved
+  //! from the parent allocation on the submission
+  bool setView(size_t index, Memory* parent, size_t offset);
+
+  //! Set all explicit parameters from the array of the value pointers, one per argument.
+  //! The plain values are copied without the per-argument dispatch.
+  //! Returns FALSE if the kernel has the local memory arguments
+  bool setAll(const void* const* args, bool svmBound = false);
+
+  //! Set all explicit parameters from the packed buffer, which has the arguments at
+  //! the descriptor offsets. The values are copied at once and the SVM pointers are
+  //! resolved after. Returns FALSE if the buffer doesn't match the arguments
+  bool setPacked(const void* buffer, size_t size);
+
   //! Return true if the parameter at the given \a index is defined.
   bool test(size_t index) const { return signature_.at(index).info_.defined_; }
 
@@ -210,9 +246,13 @@ class KernelParameters : protected HeapObject {
   size_t localMemSize(size_t minDataTypeAlignment) const;
 
   //! Capture the state of the parameters and return the stack base pointer.
-  address capture(const Device& device, uint64_t lclMemSize, int32_t* error);
-  //! Release the captured state of the parameters.
-  void release(address parameters, const amd::Device& device) const;
+  //! The argument values aren't copied if \a objectsOnly is TRUE. The memory comes
+  //! from \a arena, if it's provided, and the arena owner frees it
+  address capture(const Device& device, uint64_t lclMemSize, int32_t* error,
+                  bool objectsOnly = false, MonotonicMemory* arena = nullptr);
+  //! Release the captured state of the parameters. The memory of the arena capture
+  //! isn't freed, if \a fromArena is TRUE
+  void release(address parameters, const amd::Device& device, bool fromArena = false) const;
 
   //! Allocate memory for this instance as well as the required storage for
   //  the values_, defined_, and rawPointer_ arrays.
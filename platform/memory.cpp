@@ -26,6 +26,7 @@
 #include "platform/memory.hpp"
 #include "device/device.hpp"
 
+#include <algorithm>
 #include <atomic>
 
 namespace amd {
@@ -118,6 +119,8 @@ Memory::Memory(Memory& parent, Flags flags, size_t origin, size_t size, Type typ
       lockMemoryOps_("Memory Ops Lock", true) {
   svmPtrCommited_ = parent.isSvmPtrCommited();
   canBeCached_ = true;
+  // Views share the allocation of the parent
+  cachePolicy_ = parent.cachePolicy_;
   parent_->retain();
   parent_->isParent_ = true;
 
@@ -241,10 +244,7 @@ bool Memory::allocHostMemory(void* initFrom, bool allocHostMem, bool forceCopy)
 
   if (allocHostMem && type_ == CL_MEM_OBJECT_PIPE) {
     // Initialize the pipe for a CPU device
-    clk_pipe_t* pipe = reinterpret_cast<clk_pipe_t*>(getHostMem());
-    pipe->read_idx = 0;
-    pipe->write_idx = 0;
-    pipe->end_idx = asPipe()->getMaxNumPackets();
+    *reinterpret_cast<Pipe::Header*>(getHostMem()) = asPipe()->initialHeader();
   }
 
   if ((flags_ & (CL_MEM_USE_HOST_PTR | CL_MEM_COPY_HOST_PTR)) && (NULL == lastWriter_)) {
@@ -312,6 +312,16 @@ bool Memory::create(void* initFrom, bool sysMemAlloc, bool skipAlloc, bool force
   return true;
 }
 
+bool Memory::setCachePolicy(CachePolicy policy) {
+  // The policy selects the device allocation, so it can't change after the allocation
+  if ((numDevices_ != 0) || (parent_ != nullptr)) {
+    LogWarning("Cache policy can't change for the allocated memory or views");
+    return false;
+  }
+  cachePolicy_ = policy;
+  return true;
+}
+
 bool Memory::addDeviceMemory(const Device* dev) {
   bool result = false;
   AllocState create = AllocCreate;
@@ -461,12 +471,76 @@ void Memory::signalWrite(const Device* writer) {
   // section needed)
   ++version_;
   lastWriter_ = writer;
+  // The write range is unknown, so the next syncs must transfer the entire object
+  if (!writeRanges_.empty()) {
+    ScopedLock lock(lockMemoryOps_);
+    writeRanges_.clear();
+  }
   // Update all subbuffers for this object
   for (auto buf : subBuffers_) {
     buf->signalWrite(writer);
   }
 }
 
+//! The maximum number of the tracked write ranges
+static constexpr size_t kMaxWriteRanges = 16;
+
+void Memory::signalWrite(const Device* writer, size_t offset, size_t size) {
+  // Only the standalone buffers track the ranges, since the versions of the views are separate
+  if ((size == 0) || (type_ != CL_MEM_OBJECT_BUFFER) || (parent_ != nullptr) ||
+      !subBuffers_.empty()) {
+    signalWrite(writer);
+    return;
+  }
+  ScopedLock lock(lockMemoryOps_);
+  ++version_;
+  lastWriter_ = writer;
+  if (writeRanges_.size() == kMaxWriteRanges) {
+    // The syncs from the versions before the oldest range become entire
+    writeRanges_.erase(writeRanges_.begin());
+  }
+  writeRanges_.push_back({version_, offset, size});
+}
+
+bool Memory::getWriteRanges(size_t version, std::vector<std::pair<size_t, size_t>>* ranges) {
+  if ((parent_ != nullptr) || !subBuffers_.empty()) {
+    return false;
+  }
+  ScopedLock lock(lockMemoryOps_);
+  // Each version after the requested one must have a tracked range
+  if (writeRanges_.empty() || (writeRanges_.back().version_ != version_) ||
+      (writeRanges_.front().version_ > (version + 1))) {
+    return false;
+  }
+  ranges->clear();
+  for (const auto& range : writeRanges_) {
+    if (range.version_ > version) {
+      ranges->push_back(std::make_pair(range.offset_, range.size_));
+    }
+  }
+
+  // Coalesce the overlapped and adjacent ranges, so the sync has the minimal number of copies
+  std::sort(ranges->begin(), ranges->end());
+  size_t last = 0;
+  size_t total = (*ranges)[0].second;
+  for (size_t i = 1; i < ranges->size(); ++i) {
+    auto& merged = (*ranges)[last];
+    const auto& range = (*ranges)[i];
+    const size_t end = merged.first + merged.second;
+    if (range.first <= end) {
+      const size_t rangeEnd = std::max(end, range.first + range.second);
+      total += rangeEnd - end;
+      merged.second = rangeEnd - merged.first;
+    } else {
+      (*ranges)[++last] = range;
+      total += range.second;
+    }
+  }
+  ranges->resize(last + 1);
+  // A single entire copy is faster than the ranges over a half of the object
+  return (total <= (size_ / 2));
+}
+
 void Memory::cacheWriteBack() {
   if (NULL != lastWriter_) {
     device::Memory* dmem = getDeviceMemory(*lastWriter_);
@@ -1508,10 +1582,34 @@ void SvmBuffer::free(const Context& context, void* ptr) {
 }
 
 void SvmBuffer::memFill(void* dst, const void* src, size_t srcSize, size_t times) {
+  if (times == 1) {
+    Os::parallelMemcpy(dst, src, srcSize);
+    return;
+  }
   address dstAddress = reinterpret_cast<address>(dst);
   const_address srcAddress = reinterpret_cast<const_address>(src);
-  for (size_t i = 0; i < times; i++) {
-    ::memcpy(dstAddress + i * srcSize, srcAddress, srcSize);
+  // The pattern is replicated with the doubling copies up to the block, which stays in the cache,
+  // and then the block is copied. It runs at the memcpy bandwidth even for the small patterns
+  constexpr size_t kFillBlockSize = 64 * Ki;
+  const size_t blockSize = std::max<size_t>(kFillBlockSize / srcSize, 1) * srcSize;
+  auto fill = [=](size_t begin, size_t end) {
+    address start = dstAddress + begin * srcSize;
+    const size_t size = (end - begin) * srcSize;
+    if (size == 0) {
+      return;
+    }
+    ::memcpy(start, srcAddress, srcSize);
+    for (size_t done = srcSize; done < size;) {
+      const size_t chunk = std::min(std::min(done, blockSize), size - done);
+      ::memcpy(start + done, start, chunk);
+      done += chunk;
+    }
+  };
+  if ((srcSize * times) >= (AMD_PARALLEL_COPY_SIZE * Ki)) {
+    // The parts start at the pattern boundaries, so each part fills its own range
+    Os::parallelFor(times, fill);
+  } else {
+    fill(0, times);
   }
 }
 
@@ -136,6 +136,14 @@ class Memory : public amd::RuntimeObject {
   };
 
  public:
+  //! Cache residency policy of the device allocations
+  enum CachePolicy {
+    kCacheDefault = 0,    //!< The device and the memory type decide the policy
+    kCacheStreaming = 1,  //!< The data is used once, don't allocate in MALL
+    kCacheResident = 2,   //!< Hot data, always allocate in MALL
+    kCacheUncached = 3    //!< Bypass GPU L2 and MALL
+  };
+
   enum MemoryType {
     kSvmMemoryPtr = 0x1,
     kArenaMemoryPtr = 0x2
@@ -180,6 +188,7 @@ class Memory : public amd::RuntimeObject {
       uint32_t svmPtrCommited_ : 1;    //!< svm host address committed flag
       uint32_t canBeCached_ : 1;       //!< flag to if the object can be cached
       uint32_t p2pAccess_ : 1;         //!< Memory object allows P2P access
+      uint32_t cachePolicy_ : 2;       //!< Cache residency policy of the allocations
     };
     uint32_t flagsEx_;
   };
@@ -191,8 +200,16 @@ class Memory : public amd::RuntimeObject {
   //! Disable default copy operator
   Memory(const Memory&);
 
+  //! The byte range of a buffer write, tracked for the partial coherency syncs
+  struct WriteRange {
+    size_t version_;  //!< The object version after the write
+    size_t offset_;   //!< The offset of the written range
+    size_t size_;     //!< The size of the written range
+  };
+
   Monitor lockMemoryOps_;          //!< Lock to serialize memory operations
   std::list<Memory*> subBuffers_;  //!< List of all subbuffers for this memory object
+  std::vector<WriteRange> writeRanges_;  //!< The recent writes, ordered by the version
   device::Memory* svmBase_;        //!< svmBase allocation for MGPU case
 
  protected:
@@ -214,6 +231,10 @@ class Memory : public amd::RuntimeObject {
   //! Memory object destructor
   virtual ~Memory();
 
+  //! The views write back the parent cache and the interop objects are tied to the API objects,
+  //! hence only the other memory objects are destroyed asynchronously
+  virtual bool deferrable() const { return (parent_ == NULL) && !isInterop(); }
+
   //! Copies initialization data to the backing store
   virtual void copyToBackingStore(void* initFrom  //!< Pointer to the initialization memory
   );
@@ -316,6 +337,12 @@ class Memory : public amd::RuntimeObject {
 
   //! Signal that a write has occurred to a cached version
   void signalWrite(const Device* writer);
+  //! Signal that a write of the byte range has occurred to a cached version.
+  //! The zero size means an unknown range
+  void signalWrite(const Device* writer, size_t offset, size_t size);
+  //! Returns the coalesced byte ranges, written after the version. Returns FALSE if a write
+  //! wasn't tracked or the ranges cover most of the object, so the sync must be entire
+  bool getWriteRanges(size_t version, std::vector<std::pair<size_t, size_t>>* ranges);
   //! Force an asynchronous writeback from the most-recent dirty cache to host
   void cacheWriteBack(void);
 
@@ -333,6 +360,10 @@ class Memory : public amd::RuntimeObject {
   device::VirtualDevice* getVirtualDevice() const { return vDev_; }
   bool forceSysMemAlloc() const { return forceSysMemAlloc_; }
 
+  //! Sets the cache residency policy. Returns FALSE if the memory was allocated already
+  bool setCachePolicy(CachePolicy policy);
+  CachePolicy cachePolicy() const { return static_cast<CachePolicy>(cachePolicy_); }
+
   void incMapCount() { ++mapCount_; }
   void decMapCount() { --mapCount_; }
   uint mapCount() const { return mapCount_; }
@@ -425,6 +456,17 @@ class Pipe : public Buffer {
 
   //! return max number of pipe packets
   size_t getMaxNumPackets() const { return maxPackets_; }
+
+  //! The control block at the start of the pipe storage. The layout matches clk_pipe_t,
+  //! which the device library pipe builtins use, and the packets follow in the next cache line
+  struct Header {
+    size_t readIdx_;   //!< The read index of the ring
+    size_t writeIdx_;  //!< The write index of the ring
+    size_t endIdx_;    //!< The ring capacity in packets
+  };
+
+  //! Returns the header of an empty pipe, which the devices write on the memory creation
+  Header initialHeader() const { return {0, 0, maxPackets_}; }
 };
 
 //! Images are a specialization of memory
@@ -160,6 +160,25 @@ class NDRangeContainer : public HeapObject {
   NDRange& local() { return local_; }
 };
 
+//! The launch sizes in the layout of the AQL dispatch packet fields. The descriptor is
+//! resolved once at the enqueue, so the device just copies it into the packet.
+//! The global offsets stay in NDRangeContainer, since they go into the 64 bit hidden arguments
+struct LaunchDescriptor {
+  uint32_t gridSize_[3];       //!< The grid size in work-items
+  uint16_t workgroupSize_[3];  //!< The workgroup size in work-items
+  uint16_t dimensions_;        //!< Number of dimensions, 0 if the descriptor isn't valid
+
+  //! Builds the descriptor from the sizes and the resolved workgroup size.
+  //! Returns FALSE if the sizes don't fit the packet fields
+  inline bool init(const NDRangeContainer& sizes, const NDRange& local);
+
+  //! Returns TRUE if the descriptor holds the resolved sizes
+  bool valid() const { return dimensions_ != 0; }
+
+  //! Invalidates the descriptor after the sizes were changed
+  void invalidate() { dimensions_ = 0; }
+};
+
 
 /*! @}\
  *  @}
@@ -181,6 +200,26 @@ inline size_t NDRange::product() const {
   return result;
 }
 
+inline bool LaunchDescriptor::init(const NDRangeContainer& sizes, const NDRange& local) {
+  invalidate();
+  for (uint i = 0; i < 3; ++i) {
+    gridSize_[i] = 1;
+    workgroupSize_[i] = 1;
+  }
+  if ((sizes.dimensions() == 0) || (sizes.dimensions() > 3)) {
+    return false;
+  }
+  for (uint i = 0; i < sizes.dimensions(); ++i) {
+    if ((sizes.global()[i] > 0xffffffff) || (local[i] > 0xffff)) {
+      return false;
+    }
+    gridSize_[i] = static_cast<uint32_t>(sizes.global()[i]);
+    workgroupSize_[i] = static_cast<uint16_t>(local[i]);
+  }
+  dimensions_ = static_cast<uint16_t>(sizes.dimensions());
+  return true;
+}
+
 // This function is in this header file for performance improvements:
 inline NDRange& NDRange::operator=(const NDRange& space) {
   assert(dimensions_ == space.dimensions_ && "dimensions mismatch");
@@ -20,20 +20,27 @@
 
 #include "top.hpp"
 #include "device/appprofile.hpp"
+#include "device/devbundle.hpp"
 #include "platform/program.hpp"
 #include "platform/context.hpp"
 #include "utils/options.hpp"
+#include "thread/semaphore.hpp"
+#include "thread/thread.hpp"
 #if defined(WITH_COMPILER_LIB)
 #include "utils/libUtils.h"
 #include "utils/bif_section_labels.hpp"
 #include "hsailctx.hpp"
 #endif
 
+#include <algorithm>
 #include <cstdlib>  // for malloc
 #include <cstring>  // for strcmp
+#include <deque>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <utility>
 
 namespace amd {
@@ -85,6 +92,10 @@ Program::~Program() {
     }
   }
 
+  for (const auto& it : mappedImages_) {
+    Os::MemoryUnmapFile(it.first, it.second);
+  }
+
   delete symbolTable_;
   //! @todo Make sure we have destroyed all CPU specific objects
 }
@@ -103,6 +114,39 @@ int32_t Program::addDeviceProgram(Device& device, const void* image, size_t leng
                                   bool make_copy, amd::option::Options* options,
                                   const amd::Program* same_prog, amd::Os::FileDesc fdesc,
                                   size_t foffset, std::string uri) {
+  // Without the image the code object is referenced straight from the file mapping,
+  // so neither the runtime nor the app keep a copy of it
+  if ((image == NULL) && (length != 0) && (fdesc != amd::Os::FDescInit())) {
+    if (!amd::Os::MemoryMapFileDesc(fdesc, length, foffset, &image)) {
+      LogError("Cannot map the code object file");
+      return CL_INVALID_BINARY;
+    }
+    mappedImages_.push_back(std::make_pair(image, length));
+    make_copy = false;
+  }
+
+  // The bundle keeps the code objects of all targets, so only the code object of the device
+  // is taken and the rest of the bundle is never copied or decompressed
+  std::unique_ptr<const uint8_t[]> extracted;
+  if ((image != NULL) && device::CodeObjectBundle::isBundle(image, length)) {
+    const uint8_t* codeObject = nullptr;
+    size_t codeObjectSize = 0;
+    bool allocated = false;
+    if (!device::CodeObjectBundle::extract(image, length, device.isa(), &codeObject,
+                                           &codeObjectSize, &allocated)) {
+      return CL_INVALID_BINARY;
+    }
+    if (allocated) {
+      extracted.reset(codeObject);
+    }
+    image = codeObject;
+    length = codeObjectSize;
+    // The file location describes the bundle and not the code object
+    fdesc = amd::Os::FDescInit();
+    foffset = 0;
+    uri.clear();
+  }
+
   if (image != NULL &&  !amd::Elf::isElfMagic((const char*)image)) {
     if (device.settings().useLightning_) {
       return CL_INVALID_BINARY;
@@ -173,7 +217,11 @@ int32_t Program::addDeviceProgram(Device& device, const void* image, size_t leng
     const uint8_t* memory = std::get<0>(binary(rootDev));
     // clone 'binary' (it is owned by the host thread).
     if (memory == NULL) {
-      if (make_copy) {
+      if (extracted != nullptr) {
+        // The decompressed code object is owned by the program already
+        memory = extracted.release();
+        make_copy = true;
+      } else if (make_copy) {
         auto *image_copy = new (std::nothrow) uint8_t[length];
         if (image_copy == NULL) {
           delete program;
@@ -220,11 +268,87 @@ device::Program* Program::getDeviceProgram(const Device& device) const {
 
 Monitor Program::buildLock_("OCL build program", true);
 
+//! The compile threads for the asynchronous builds. The threads live until the process exit
+class BuildPool : public HeapObject {
+ public:
+  //! Returns the pool or NULL if the compile threads couldn't start
+  static BuildPool* instance() {
+    static BuildPool* pool = create();
+    return pool;
+  }
+
+  //! Queues the work for the compile threads
+  void submit(std::function<void()>&& work) {
+    ScopedLock sl(lock_);
+    queue_.push_back(std::move(work));
+    lock_.notify();
+  }
+
+ private:
+  class Worker : public Thread {
+   public:
+    Worker(BuildPool& pool)
+        : Thread("Program Build Thread", 8 * Mi /* the compiler requires a deep stack */),
+          pool_(pool) {}
+
+    //! Executes the queued work forever
+    void run(void* data) {
+      while (true) {
+        std::function<void()> work;
+        {
+          ScopedLock sl(pool_.lock_);
+          while (pool_.queue_.empty()) {
+            pool_.lock_.wait();
+          }
+          work = std::move(pool_.queue_.front());
+          pool_.queue_.pop_front();
+        }
+        work();
+      }
+    }
+
+   private:
+    BuildPool& pool_;
+  };
+
+  BuildPool() : lock_("Build pool lock") {}
+
+  static BuildPool* create() {
+    uint numThreads = AMD_BUILD_THREADS;
+    if (numThreads == 0) {
+      numThreads = std::min(std::max(Os::processorCount(), 1), 4);
+    }
+    BuildPool* pool = new BuildPool();
+    for (uint i = 0; i < numThreads; ++i) {
+      Worker* worker = new Worker(*pool);
+      if ((worker->state() < Thread::INITIALIZED) || !worker->start()) {
+        delete worker;
+        break;
+      }
+      pool->workers_.push_back(worker);
+    }
+    if (pool->workers_.empty()) {
+      LogWarning("Cannot start the compile threads, the builds are synchronous");
+      delete pool;
+      return NULL;
+    }
+    return pool;
+  }
+
+  Monitor lock_;                             //!< Lock for the work queue
+  std::deque<std::function<void()>> queue_;  //!< The queued builds
+  std::vector<Worker*> workers_;             //!< The compile threads
+};
+
 int32_t Program::compile(const std::vector<Device*>& devices, size_t numHeaders,
                         const std::vector<const Program*>& headerPrograms,
                         const char** headerIncludeNames, const char* options,
                         void(CL_CALLBACK* notifyFptr)(cl_program, void*), void* data,
                         bool optionChangable) {
+  ScopedLock pl(programLock_);
+  while (pendingBuilds_ > 0) {
+    programLock_.wait();
+  }
   ScopedLock sl(buildLock_);
 
   int32_t retval = CL_SUCCESS;
@@ -306,6 +430,10 @@ int32_t Program::link(const std::vector<Device*>& devices, size_t numInputs,
                      const std::vector<Program*>& inputPrograms, const char* options,
                      void(CL_CALLBACK* notifyFptr)(cl_program, void*), void* data,
                      bool optionChangable) {
+  ScopedLock pl(programLock_);
+  while (pendingBuilds_ > 0) {
+    programLock_.wait();
+  }
   ScopedLock sl(buildLock_);
   int32_t retval = CL_SUCCESS;
 
@@ -485,7 +613,104 @@ void Program::StubProgramSource(const std::string& app_name) {
 int32_t Program::build(const std::vector<Device*>& devices, const char* options,
                       void(CL_CALLBACK* notifyFptr)(cl_program, void*), void* data,
                       bool optionChangable, bool newDevProg) {
-  ScopedLock sl(buildLock_);
+  // The build with a callback can finish asynchronously
+  if ((notifyFptr != NULL) && AMD_ASYNC_BUILD && optionChangable && newDevProg &&
+      submitBuild(devices, options,
+                  [this, notifyFptr, data](int32_t) { notifyFptr(as_cl(this), data); })) {
+    return CL_SUCCESS;
+  }
+
+  int32_t retval;
+  {
+    ScopedLock sl(programLock_);
+    while (pendingBuilds_ > 0) {
+      programLock_.wait();
+    }
+    retval = buildLocked(devices, options, optionChangable, newDevProg);
+  }
+
+  if (notifyFptr != NULL) {
+    notifyFptr(as_cl(this), data);
+  }
+
+  return retval;
+}
+
+bool Program::submitBuild(const std::vector<Device*>& devices, const char* options,
+                          const std::function<void(int32_t)>& completion) {
+  BuildPool* pool = BuildPool::instance();
+  if (pool == NULL) {
+    return false;
+  }
+
+  {
+    ScopedLock sl(programLock_);
+    ++pendingBuilds_;
+  }
+  // The program must stay alive until the build finishes
+  retain();
+  const bool hasOptions = (options != NULL);
+  const std::string buildOptions(hasOptions ? options : "");
+  pool->submit([this, devices, hasOptions, buildOptions, completion]() {
+    int32_t result;
+    {
+      ScopedLock sl(programLock_);
+      result = buildLocked(devices, hasOptions ? buildOptions.c_str() : NULL, true, true);
+      --pendingBuilds_;
+      programLock_.notifyAll();
+    }
+    // The callback can use the program, so it runs outside of the lock
+    completion(result);
+    release();
+  });
+  return true;
+}
+
+void Program::waitForBuild() {
+  ScopedLock sl(programLock_);
+  while (pendingBuilds_ > 0) {
+    programLock_.wait();
+  }
+}
+
+int32_t Program::buildPrograms(const std::vector<Program*>& programs,
+                               const std::vector<Device*>& devices, const char* options) {
+  std::vector<int32_t> results(programs.size(), CL_SUCCESS);
+  Semaphore done;
+  size_t submitted = 0;
+  for (size_t i = 0; i < programs.size(); ++i) {
+    int32_t* result = &results[i];
+    if (programs[i]->submitBuild(devices, options, [result, &done](int32_t status) {
+          *result = status;
+          done.post();
+        })) {
+      ++submitted;
+    } else {
+      results[i] = programs[i]->build(devices, options);
+    }
+  }
+  for (size_t i = 0; i < submitted; ++i) {
+    done.wait();
+  }
+
+  for (const auto& it : results) {
+    if (it != CL_SUCCESS) {
+      return it;
+    }
+  }
+  return CL_SUCCESS;
+}
+
+int32_t Program::buildLocked(const std::vector<Device*>& devices, const char* options,
+                             bool optionChangable, bool newDevProg) {
+  InitPhase buildPhase("build", Timeline::kCompile);
+  // LC builds of the different programs can run concurrently, the compiler library
+  // of the HSAIL path isn't thread safe
+  bool concurrent = AMD_PARALLEL_BUILD;
+  for (const auto& it : devices) {
+    concurrent = concurrent && it->settings().useLightning_;
+  }
+  ScopedLock sl(concurrent ? NULL : &buildLock_);
   int32_t retval = CL_SUCCESS;
 
   if (symbolTable_ == NULL) {
@@ -519,9 +744,17 @@ int32_t Program::build(const std::vector<Device*>& devices, const char* options,
     remove_g_option(cppstr);
   }
 
-  // Build the program programs associated with the given devices.
+  std::vector<std::unique_ptr<option::Options>> parsedOptionsList;
+  std::vector<BuildTask> tasks;
+  // The device programs with identical targets, which have the same code objects
+  std::map<std::string, std::vector<size_t>> targets;
+  std::vector<std::string> targetOrder;
+  tasks.reserve(devices.size());
+
+  // Prepare the program programs associated with the given devices.
   for (const auto& it : devices) {
-    option::Options parsedOptions;
+    parsedOptionsList.emplace_back(new option::Options);
+    option::Options& parsedOptions = *parsedOptionsList.back();
     constexpr bool LinkOptsOnly = false;
     if ((language_ != HIP) && !ParseAllOptions(cppstr, parsedOptions, optionChangable, LinkOptsOnly,
                          it->settings().useLightning_)) {
@@ -563,15 +796,87 @@ int32_t Program::build(const std::vector<Device*>& devices, const char* options,
     if (devProgram->buildStatus() != CL_BUILD_NONE) {
       continue;
     }
-    int32_t result = devProgram->build(sourceCode_, options, &parsedOptions, precompiledHeaders_);
+    // LC code objects depend only on the target and the compile modes. HSAIL builds are
+    // never shared, since the compiler library isn't thread safe
+    std::stringstream target;
+    if (it->settings().useLightning_) {
+      target << it->isa().targetId() << ":" << it->settings().lcWavefrontSize64_ << ":"
+             << it->settings().enableWgpMode_;
+    } else {
+      target << "hsail:" << it;
+    }
+    auto& group = targets[target.str()];
+    if (group.empty()) {
+      targetOrder.push_back(target.str());
+    }
+    group.push_back(tasks.size());
+    tasks.push_back({devProgram, &parsedOptions, CL_SUCCESS});
+  }
+
+  // Build the unique targets, the first one on the current thread and the rest on the workers
+  class BuildThread : public Thread {
+   public:
+    BuildThread(Program& program, std::vector<BuildTask*>&& tasks, const char* options,
+                Semaphore& done)
+        : Thread("Program Build Thread", 8 * Mi /* the compiler requires a deep stack */),
+          program_(program),
+          tasks_(std::move(tasks)), options_(options), done_(done) {}
+
+    //! The build thread entry point
+    void run(void* data) {
+      program_.buildTarget(tasks_, options_);
+      done_.post();
+    }
+
+   private:
+    Program& program_;
+    std::vector<BuildTask*> tasks_;
+    const char* options_;
+    Semaphore& done_;
+  };
+
+  bool parallel = AMD_PARALLEL_BUILD && (targetOrder.size() > 1);
+  for (const auto& it : tasks) {
+    parallel = parallel && it.program_->isLC();
+  }
+
+  std::vector<std::unique_ptr<BuildThread>> threads;
+  Semaphore done;
+  for (size_t i = 0; i < targetOrder.size(); ++i) {
+    std::vector<BuildTask*> group;
+    for (auto idx : targets[targetOrder[i]]) {
+      group.push_back(&tasks[idx]);
+    }
+    if (parallel && (i > 0)) {
+      std::unique_ptr<BuildThread> thread(new BuildThread(*this, std::vector<BuildTask*>(group),
+                                                          options, done));
+      if ((thread->state() >= Thread::INITIALIZED) && thread->start()) {
+        threads.push_back(std::move(thread));
+        continue;
+      }
+      // Fall back to the current thread if the worker couldn't start
+    }
+    buildTarget(group, options);
+  }
 
+  // Wait for the workers
+  for (size_t i = 0; i < threads.size(); ++i) {
+    done.wait();
+  }
+  for (const auto& it : threads) {
+    while (it->state() < Thread::FINISHED) {
+      Os::yield();
+    }
+  }
+
+  for (const auto& it : tasks) {
     // Check if the previous device failed a build
-    if ((result != CL_SUCCESS) && (retval != CL_SUCCESS)) {
+    if ((it.result_ != CL_SUCCESS) && (retval != CL_SUCCESS)) {
       retval = CL_INVALID_OPERATION;
     }
     // Update the returned value with a build error
-    else if (result != CL_SUCCESS) {
-      retval = result;
+    else if (it.result_ != CL_SUCCESS) {
+      retval = it.result_;
     }
   }
 
@@ -594,14 +899,39 @@ int32_t Program::build(const std::vector<Device*>& devices, const char* options,
     }
   }
 
-  if (notifyFptr != NULL) {
-    notifyFptr(as_cl(this), data);
-  }
-
   return retval;
 }
 
+void Program::buildTarget(const std::vector<BuildTask*>& tasks, const char* options) {
+  device::Program* first = tasks[0]->program_;
+  tasks[0]->result_ = first->build(sourceCode_, options, tasks[0]->options_, precompiledHeaders_);
+
+  device::Program::binary_t executable = first->binary();
+  const bool share = (tasks[0]->result_ == CL_SUCCESS) && first->isLC() &&
+      (first->type() == device::Program::TYPE_EXECUTABLE) && (executable.first != nullptr);
+
+  for (size_t i = 1; i < tasks.size(); ++i) {
+    device::Program* program = tasks[i]->program_;
+    // The shared executable is owned by the first device program,
+    // which has the same lifetime in this program
+    if (share && program->setBinary(reinterpret_cast<const char*>(executable.first),
+                                    executable.second, first)) {
+      ClPrint(LOG_INFO, LOG_CODE, "Program %p shares the executable of the device program %p",
+              program, first);
+      tasks[i]->result_ = program->build(std::string(), options, tasks[i]->options_,
+                                         precompiledHeaders_);
+    } else {
+      tasks[i]->result_ = program->build(sourceCode_, options, tasks[i]->options_,
+                                         precompiledHeaders_);
+    }
+  }
+}
+
 bool Program::load(const std::vector<Device*>& devices) {
+  ScopedLock pl(programLock_);
+  while (pendingBuilds_ > 0) {
+    programLock_.wait();
+  }
   ScopedLock sl(buildLock_);
 
   for (const auto& it : devicePrograms_) {
@@ -699,7 +1029,15 @@ bool Program::ParseAllOptions(const std::string& options, option::Options& parse
   return amd::option::parseAllOptions(allOpts, parsedOptions, linkOptsOnly, isLC);
 }
 
+Monitor Symbol::lock_("Symbol signature lock");
+
 bool Symbol::setDeviceKernel(const Device& device, const device::Kernel* func) {
+  if (func->initDeferred() || deferred_.load(std::memory_order_relaxed)) {
+    // The signature is selected on the first use, when all metadata is parsed
+    deviceKernels_[&device] = func;
+    deferred_.store(true, std::memory_order_release);
+    return true;
+  }
   if (deviceKernels_.size() == 0 ||
       // Always pick the most recent version in MGPU case
       (func->signature().version() > signature_.version())) {
@@ -709,10 +1047,30 @@ bool Symbol::setDeviceKernel(const Device& device, const device::Kernel* func) {
   return true;
 }
 
+void Symbol::selectSignature() {
+  ScopedLock sl(lock_);
+  if (!deferred_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  bool first = true;
+  for (const auto& it : deviceKernels_) {
+    if (!it.second->ensureInit()) {
+      continue;
+    }
+    if (first ||
+        // Always pick the most recent version in MGPU case
+        (it.second->signature().version() > signature_.version())) {
+      signature_ = it.second->signature();
+      first = false;
+    }
+  }
+  deferred_.store(false, std::memory_order_release);
+}
+
 const device::Kernel* Symbol::getDeviceKernel(const Device& device) const {
   auto it = deviceKernels_.find(&device);
   if (it != deviceKernels_.cend()) {
-    return it->second;
+    return it->second->ensureInit() ? it->second : nullptr;
   }
   return nullptr;
 }
@@ -33,6 +33,8 @@
 #include "platform/object.hpp"
 #include "platform/kernel.hpp"
 
+#include <atomic>
+#include <functional>
 #include <set>
 #include <string>
 #include <vector>
@@ -57,10 +59,17 @@ class Symbol : public HeapObject {
  private:
   devicekernels_t deviceKernels_;    //! All device kernels objects.
   KernelSignature signature_;        //! Kernel signature.
+  //! Some device kernels defer the metadata parsing, so the signature isn't ready
+  mutable std::atomic<bool> deferred_;
+
+  static Monitor lock_;              //! Lock for the deferred signature selection
+
+  //! Selects the most recent signature of the device kernels
+  void selectSignature();
 
  public:
   //! Default constructor
-  Symbol() {}
+  Symbol() : deferred_(false) {}
 
   //! Set the entry point and check or set the signature.
   bool setDeviceKernel(const Device& device,        //!< Device object.
@@ -72,7 +81,12 @@ class Symbol : public HeapObject {
                                         ) const;
 
   //! Return this Symbol's signature.
-  const KernelSignature& signature() const { return signature_; }
+  const KernelSignature& signature() const {
+    if (deferred_.load(std::memory_order_acquire)) {
+      const_cast<Symbol*>(this)->selectSignature();
+    }
+    return signature_;
+  }
 };
 
 class Context;
@@ -101,6 +115,26 @@ class Program : public RuntimeObject {
   //! Replaces the compiled program with the new version from HD
   void StubProgramSource(const std::string& app_name);
 
+  //! The device program with the parsed options for the build
+  struct BuildTask {
+    device::Program* program_;  //!< The device program for the build
+    option::Options* options_;  //!< The parsed build options for the device
+    int32_t result_;            //!< The build result
+  };
+
+  //! Builds the device programs for one target. Only the first program is compiled,
+  //! the others reuse its executable
+  void buildTarget(const std::vector<BuildTask*>& tasks, const char* options);
+
+  //! Builds the program for the given devices. The program lock must be owned
+  int32_t buildLocked(const std::vector<Device*>& devices, const char* options,
+                      bool optionChangable, bool newDevProg);
+
+  //! Queues the build on the compile threads. The completion is called after the build
+  //! with the result. Returns FALSE if the compile threads are unavailable
+  bool submitBuild(const std::vector<Device*>& devices, const char* options,
+                   const std::function<void(int32_t)>& completion);
+
   //! The context this program is part of.
   SharedReference<Context> context_;
 
@@ -110,6 +144,8 @@ class Program : public RuntimeObject {
   std::string sourceCode_;   //!< Strings that make up the source code
   Language language_;        //!< Input source language
   devicebinary_t binary_;    //!< The binary image, provided by the app
+  //! The code object images, mapped straight from the app files
+  std::vector<std::pair<const void*, size_t>> mappedImages_;
   symbols_t* symbolTable_;   //!< The program's kernels symbol table
   std::string kernelNames_;  //!< The program kernel names
 
@@ -119,6 +155,9 @@ class Program : public RuntimeObject {
 
   std::string programLog_;  //!< Log for parsing options, etc.
 
+  Monitor programLock_;     //!< Serializes the builds and the waits of this program
+  uint32_t pendingBuilds_;  //!< The builds, queued on the compile threads
+
  protected:
   //! Destroy this program.
   ~Program();
@@ -137,7 +176,9 @@ class Program : public RuntimeObject {
         sourceCode_(sourceCode),
         language_(language),
         symbolTable_(NULL),
-        programLog_() {
+        programLog_(),
+        programLock_("Program lock"),
+        pendingBuilds_(0) {
     for (auto i = 0; i != numHeaders; ++i) {
       headers_.emplace_back(headers[i]);
       headerNames_.emplace_back(headerNames[i]);
@@ -147,7 +188,9 @@ class Program : public RuntimeObject {
   //! Construct a new program associated with a context.
   Program(Context& context, Language language = Binary)
       : context_(context), language_(language),
-        symbolTable_(NULL) {}
+        symbolTable_(NULL),
+        programLock_("Program lock"),
+        pendingBuilds_(0) {}
 
   //! Returns context, associated with the current program.
   const Context& context() const { return context_(); }
@@ -216,11 +259,21 @@ class Program : public RuntimeObject {
               void(CL_CALLBACK* notifyFptr)(cl_program, void*) = NULL, void* data = NULL,
               bool optionChangable = true);
 
-  //! Build the program for the given devices.
+  //! Build the program for the given devices. With a callback the build can run
+  //! asynchronously on the compile threads, see waitForBuild()
   int32_t build(const std::vector<Device*>& devices, const char* options = NULL,
                void(CL_CALLBACK* notifyFptr)(cl_program, void*) = NULL, void* data = NULL,
                bool optionChangable = true, bool newDevProg = true);
 
+  //! Builds the programs in parallel on the compile threads and waits for all of them.
+  //! Returns the first build error
+  static int32_t buildPrograms(const std::vector<Program*>& programs,
+                               const std::vector<Device*>& devices,
+                               const char* options = NULL);
+
+  //! Waits for the asynchronous builds of this program
+  void waitForBuild();
+
   //! Load the program. If devices is not specified, then load program for all devices.
   bool load(const std::vector<Device*>& devices = {});
 
@@ -26,6 +26,7 @@
 #include "utils/options.hpp"
 #include "platform/context.hpp"
 #include "platform/agent.hpp"
+#include "platform/cmdrecord.hpp"
 
 #include "amdocl/cl_gl_amd.hpp"
 
@@ -39,9 +40,12 @@
 #include <intrin.h>
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <mutex>
 
 namespace amd {
 
@@ -71,13 +75,26 @@ bool Runtime::init() {
     return true;
   }
 
-  if (!Flag::init() || !option::init() || !Device::init()
-      // Agent initializes last
-      || !Agent::init()) {
+  InitPhase initPhase("Runtime::init");
+  bool result = Flag::init() && option::init();
+  if (result) {
+    InitPhase phase("Device::init");
+    result = Device::init();
+  }
+  if (result) {
+    // Agent initializes last
+    InitPhase phase("Agent::init");
+    result = Agent::init();
+  }
+  if (!result) {
     ClPrint(LOG_ERROR, LOG_INIT, "Runtime initilization failed");
     return false;
   }
 
+  if (!flagIsDefault(AMD_CMD_RECORD)) {
+    CommandRecorder::init(AMD_CMD_RECORD);
+  }
+
   initialized_ = true;
   ClTrace(LOG_DEBUG, LOG_INIT);
   return true;
@@ -89,6 +106,16 @@ void Runtime::tearDown() {
   }
   ClTrace(LOG_DEBUG, LOG_INIT);
 
+  if (AMD_MONITOR_STATS) {
+    Monitor::dumpStats();
+  }
+  if (AMD_KERNEL_STATS) {
+    device::Kernel::dumpStats();
+  }
+
+  // The queued objects can reference the devices
+  DeferredRelease::flush();
+
   Agent::tearDown();
   Device::tearDown();
   option::teardown();
@@ -105,6 +132,82 @@ public:
   ~RuntimeTearDown() { /*Runtime::tearDown();*/ }
 } runtime_tear_down;
 
+namespace {
+
+std::mutex phasesLock;                       //!< Lock for the finished phases
+std::vector<InitProfile::Phase>* phases = nullptr;
+thread_local uint32_t phaseDepth = 0;        //!< The nesting level of the current thread
+
+//! Prints the phases on the process exit, since the runtime doesn't tear down
+struct InitProfilePrinter {
+  ~InitProfilePrinter() {
+    if (AMD_INIT_PROFILE) {
+      InitProfile::dump();
+    }
+  }
+} initProfilePrinter;
+
+}  // namespace
+
+InitPhase::InitPhase(const char* name, Timeline::Category category)
+    : name_(name), depth_(phaseDepth++), start_(Os::timeNanos()), category_(category) {}
+
+InitPhase::~InitPhase() {
+  phaseDepth--;
+  const uint64_t end = Os::timeNanos();
+  InitProfile::add(name_, depth_, start_, end);
+  // The timeline is enabled in the middle of Runtime::init, so the check is at the end
+  if (Timeline::enabled()) {
+    Timeline::complete(category_, name_, start_, end);
+  }
+}
+
+void InitProfile::add(const char* name, uint32_t depth, uint64_t start, uint64_t end) {
+  std::lock_guard<std::mutex> lock(phasesLock);
+  if (phases == nullptr) {
+    phases = new std::vector<Phase>();
+    phases->reserve(kMaxPhases);
+  }
+  if (phases->size() < kMaxPhases) {
+    phases->push_back({name, depth, start, end - start});
+  }
+}
+
+std::vector<InitProfile::Phase> InitProfile::phases() {
+  std::vector<Phase> result;
+  {
+    std::lock_guard<std::mutex> lock(phasesLock);
+    if (amd::phases != nullptr) {
+      result = *amd::phases;
+    }
+  }
+  // The nested phases finish first, so restore the start order
+  std::stable_sort(result.begin(), result.end(), [](const Phase& a, const Phase& b) {
+    return (a.start_ < b.start_) || ((a.start_ == b.start_) && (a.depth_ < b.depth_));
+  });
+  return result;
+}
+
+void InitProfile::reset() {
+  std::lock_guard<std::mutex> lock(phasesLock);
+  if (phases != nullptr) {
+    phases->clear();
+  }
+}
+
+void InitProfile::dump() {
+  const std::vector<Phase> list = phases();
+  if (list.empty()) {
+    return;
+  }
+  const uint64_t origin = list.front().start_;
+  fprintf(stderr, "Init profile: start (us), time (us), phase\n");
+  for (const auto& phase : list) {
+    fprintf(stderr, "%10.1f %10.1f  %*s%s\n", (phase.start_ - origin) / 1e3,
+            phase.duration_ / 1e3, static_cast<int>(2 * phase.depth_), "", phase.name_);
+  }
+}
+
 uint ReferenceCountedObject::retain() {
   return referenceCount_.fetch_add(1, std::memory_order_relaxed) + 1;
 }
@@ -112,13 +215,88 @@ uint ReferenceCountedObject::retain() {
 uint ReferenceCountedObject::release() {
   uint newCount = referenceCount_.fetch_sub(1, std::memory_order_relaxed) - 1;
   if (newCount == 0) {
-    if (terminate()) {
-      delete this;
+    if (AMD_DEFERRED_RELEASE && deferrable() && DeferredRelease::defer(this)) {
+      return newCount;
     }
+    destroy();
   }
   return newCount;
 }
 
+ConcurrentLinkedQueue<ReferenceCountedObject*>* DeferredRelease::queue_ = nullptr;
+std::atomic<int64_t> DeferredRelease::pending_(0);
+Monitor* DeferredRelease::lock_ = nullptr;
+bool DeferredRelease::active_ = false;
+
+class DeferredReleaseThread : public Thread {
+ public:
+  DeferredReleaseThread() : Thread("Deferred Release", CQ_THREAD_STACK_SIZE) {}
+
+  //! The deferred release thread entry point
+  void run(void* data) { DeferredRelease::drainLoop(); }
+};
+
+void DeferredRelease::start() {
+  queue_ = new ConcurrentLinkedQueue<ReferenceCountedObject*>();
+  lock_ = new Monitor("Deferred release lock");
+  DeferredReleaseThread* thread = new DeferredReleaseThread();
+  if ((thread == nullptr) || (thread->state() < Thread::INITIALIZED) || !thread->start()) {
+    LogWarning("Deferred release thread creation failed");
+    delete thread;
+    return;
+  }
+  active_ = true;
+}
+
+bool DeferredRelease::defer(ReferenceCountedObject* obj) {
+  static std::once_flag initialized;
+  std::call_once(initialized, start);
+  if (!active_) {
+    return false;
+  }
+  queue_->enqueue(obj);
+  // Only the first object after the drain wakes up the thread
+  if (pending_.fetch_add(1) == 0) {
+    ScopedLock lock(lock_);
+    lock_->notify();
+  }
+  return true;
+}
+
+void DeferredRelease::drain() {
+  int64_t count = 0;
+  ReferenceCountedObject* obj;
+  // The destructors can queue more objects, which are destroyed in the same batch
+  while ((obj = queue_->dequeue()) != nullptr) {
+    obj->destroy();
+    ++count;
+  }
+  // The counter can go negative, if a producer didn't increment it yet for a drained object
+  pending_.fetch_sub(count);
+}
+
+void DeferredRelease::drainLoop() {
+  while (true) {
+    {
+      ScopedLock lock(lock_);
+      while (pending_.load() <= 0) {
+        lock_->wait();
+      }
+    }
+    // Let the batch grow, so the thread wakes up once per interval under a high release rate
+    if (AMD_DEFERRED_RELEASE_INTERVAL != 0) {
+      Os::sleep(AMD_DEFERRED_RELEASE_INTERVAL);
+    }
+    drain();
+  }
+}
+
+void DeferredRelease::flush() {
+  if (active_) {
+    drain();
+  }
+}
+
 #ifdef _WIN32
 #ifdef DEBUG
 static int reportHook(int reportType, char* message, int* returnValue) {
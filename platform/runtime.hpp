@@ -23,6 +23,12 @@
 
 #include "top.hpp"
 #include "thread/thread.hpp"
+#include "thread/monitor.hpp"
+#include "utils/concurrent.hpp"
+#include "utils/timeline.hpp"
+
+#include <atomic>
+#include <vector>
 
 namespace amd {
 
@@ -47,6 +53,85 @@ class Runtime : AllStatic {
   static bool singleThreaded() { return !initialized(); }
 };
 
+/*! \brief The time breakdown of the runtime startup and the program builds.
+ *
+ *  The phases of the runtime, device and program initialization are always recorded,
+ *  since the flags aren't known at the start. The phases nest, i.e. the device init includes
+ *  the device constants. AMD_INIT_PROFILE prints the breakdown on the process exit.
+ */
+class InitProfile : AllStatic {
+ public:
+  static constexpr size_t kMaxPhases = 1024;  //!< The phases after the limit are dropped
+
+  //! A finished phase
+  struct Phase {
+    const char* name_;   //!< The static name of the phase
+    uint32_t depth_;     //!< The nesting level on the thread
+    uint64_t start_;     //!< Os::timeNanos() of the start
+    uint64_t duration_;  //!< The phase time in ns
+  };
+
+  //! Returns a copy of the finished phases in the start order
+  static std::vector<Phase> phases();
+
+  //! Prints the breakdown of the phases
+  static void dump();
+
+  //! Drops the finished phases, so the next ones aren't limited by kMaxPhases
+  static void reset();
+
+ private:
+  friend class InitPhase;
+
+  //! Adds the finished phase
+  static void add(const char* name, uint32_t depth, uint64_t start, uint64_t end);
+};
+
+//! Records the scope as an initialization phase. The timeline gets the phase in the category
+class InitPhase {
+ public:
+  explicit InitPhase(const char* name, Timeline::Category category = Timeline::kInit);
+  ~InitPhase();
+
+ private:
+  const char* name_;
+  uint32_t depth_;
+  uint64_t start_;
+  Timeline::Category category_;
+};
+
+/*! \brief Deferred destruction of the reference counted objects.
+ *
+ *  The last release of a deferrable object only queues it with AMD_DEFERRED_RELEASE.
+ *  A background thread terminates and deletes the queued objects in batches, so the thread,
+ *  which dropped the last reference (often the HostQueue thread), doesn't run the destructors.
+ */
+class DeferredRelease : AllStatic {
+ public:
+  //! Queues the object for the destruction. Returns FALSE, if it must be destroyed inline
+  static bool defer(ReferenceCountedObject* obj);
+
+  //! Destroys all queued objects on the calling thread
+  static void flush();
+
+ private:
+  friend class DeferredReleaseThread;
+
+  //! Creates the queue and the background thread on the first use
+  static void start();
+
+  //! Destroys the queued objects
+  static void drain();
+
+  //! The background thread loop
+  static void drainLoop();
+
+  static ConcurrentLinkedQueue<ReferenceCountedObject*>* queue_;  //!< The queued objects
+  static std::atomic<int64_t> pending_;  //!< The number of the queued objects
+  static Monitor* lock_;                 //!< Lock for the background thread wakeup
+  static bool active_;                   //!< The background thread is running
+};
+
 #if 0
 class HostThread : public Thread
 {
@@ -22,16 +22,46 @@
 #include "thread/semaphore.hpp"
 #include "thread/thread.hpp"
 #include "utils/util.hpp"
+#include "utils/debug.hpp"
+#include "utils/timeline.hpp"
+#include "os/os.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace amd {
 
+//! The registry of the monitors with the statistics. Monitors are used for the static
+//! objects, so the registry is never destroyed
+static std::mutex statsLock;
+static std::set<Monitor*>* statsRegistry = nullptr;
+
+//! Adds the wait for the contended monitor into the timeline. The short spins are skipped
+static void traceLockWait(const Monitor& monitor, uint64_t startTime) {
+  constexpr uint64_t kMinLockWait = 1000;
+  const uint64_t endTime = Os::timeNanos();
+  if ((endTime - startTime) >= kMinLockWait) {
+    Timeline::complete(Timeline::kLock, Timeline::intern(monitor.name()), startTime, endTime,
+                       reinterpret_cast<uint64_t>(&monitor));
+  }
+}
+
 Monitor::Monitor(const char* name, bool recursive)
-    : contendersList_(0), onDeck_(0), waitersList_(NULL), owner_(NULL), recursive_(recursive) {
+    : contendersList_(0),
+      onDeck_(0),
+      waitersList_(NULL),
+      owner_(NULL),
+      recursive_(recursive),
+      // The initial estimate gives the same spin limit as the fixed loop
+      spinIters_((kMaxReadSpinIter - 10) / 2),
+      stats_() {
   if (name == NULL) {
     const char* unknownName = "@unknown@";
     assert(sizeof(unknownName) < sizeof(name_) && "just checking");
@@ -42,36 +72,79 @@ Monitor::Monitor(const char* name, bool recursive)
   name_[sizeof(name_) - 1] = '\0';
 }
 
+Monitor::~Monitor() {
+  if (stats_.registered_) {
+    std::lock_guard<std::mutex> lock(statsLock);
+    statsRegistry->erase(this);
+  }
+}
+
+void Monitor::countAcquisition() {
+  // The lock is owned, hence only the owner can register the monitor
+  if (unlikely(!stats_.registered_)) {
+    std::lock_guard<std::mutex> lock(statsLock);
+    if (statsRegistry == nullptr) {
+      statsRegistry = new std::set<Monitor*>();
+    }
+    statsRegistry->insert(this);
+    stats_.registered_ = true;
+  }
+  stats_.acquisitions_.fetch_add(1, std::memory_order_relaxed);
+}
+
 bool Monitor::trySpinLock() {
   if (tryLock()) {
     return true;
   }
 
-  for (int s = kMaxSpinIter; s > 0; --s) {
-    // First, be SMT friendly
-    if (s >= (kMaxSpinIter - kMaxReadSpinIter)) {
-      Os::spinPause();
-    }
-    // and then SMP friendly
-    else {
-      Thread::yield();
+  // Spin up to twice the recent average, which follows the lock hold time.
+  // That's the same heuristic as the adaptive mutexes in glibc
+  const int32_t spinIters = spinIters_.load(std::memory_order_relaxed);
+  const int32_t maxSpinIter =
+      std::min(static_cast<int32_t>(kMaxAdaptiveSpinIter), spinIters * 2 + 10);
+  bool acquired = false;
+  int32_t s = 0;
+  // First, be SMT friendly
+  for (; s < maxSpinIter; ++s) {
+    Os::spinPause();
+    if (!isLocked() && tryLock()) {
+      acquired = true;
+      break;
     }
+  }
+  spinIters_.store(spinIters + (s - spinIters) / 8, std::memory_order_relaxed);
+
+  // and then SMP friendly
+  for (int y = kMaxSpinIter - kMaxReadSpinIter; !acquired && (y > 0); --y) {
+    Thread::yield();
     if (!isLocked()) {
       return tryLock();
     }
   }
 
-  // We could not acquire the lock in the spin loop.
-  return false;
+  // Return false if we could not acquire the lock in the spin loop.
+  return acquired;
 }
 
 void Monitor::finishLock() {
   Thread* thread = Thread::current();
   assert(thread != NULL && "cannot lock() from (null)");
 
+  const bool collectStats = AMD_MONITOR_STATS;
+  const bool traceWait = Timeline::enabled();
+  const uint64_t startTime = (collectStats || traceWait) ? Os::timeNanos() : 0;
   if (trySpinLock()) {
-    return;  // We succeeded, we are done.
+    // We succeeded, we are done.
+    if (collectStats) {
+      stats_.contentions_.fetch_add(1, std::memory_order_relaxed);
+      stats_.spinTime_.fetch_add(Os::timeNanos() - startTime, std::memory_order_relaxed);
+    }
+    if (traceWait) {
+      traceLockWait(*this, startTime);
+    }
+    return;
   }
+  const uint64_t parkTime = collectStats ? Os::timeNanos() : 0;
 
   /* The lock is contended. Push the thread's semaphore onto
    * the contention list.
@@ -153,6 +226,17 @@ void Monitor::finishLock() {
 
   assert(newHead.next() == NULL && "Should not be linked");
   onDeck_ = 0;
+
+  if (collectStats) {
+    const uint64_t endTime = Os::timeNanos();
+    stats_.contentions_.fetch_add(1, std::memory_order_relaxed);
+    stats_.parks_.fetch_add(1, std::memory_order_relaxed);
+    stats_.spinTime_.fetch_add(parkTime - startTime, std::memory_order_relaxed);
+    stats_.parkTime_.fetch_add(endTime - parkTime, std::memory_order_relaxed);
+  }
+  if (traceWait) {
+    traceLockWait(*this, startTime);
+  }
 }
 
 void Monitor::finishUnlock() {
@@ -316,4 +400,47 @@ void Monitor::notifyAll() {
   }
 }
 
+void Monitor::dumpStats() {
+  struct Entry {
+    std::string name_;
+    uint64_t acquisitions_;
+    uint64_t contentions_;
+    uint64_t parks_;
+    uint64_t spinTime_;
+    uint64_t parkTime_;
+    int32_t spinIters_;
+  };
+  std::vector<Entry> entries;
+  {
+    // The log can take monitors, hence the statistics are copied before the output
+    std::lock_guard<std::mutex> lock(statsLock);
+    if (statsRegistry == nullptr) {
+      return;
+    }
+    for (const auto monitor : *statsRegistry) {
+      const Stats& stats = monitor->stats_;
+      entries.push_back({monitor->name(), stats.acquisitions_.load(std::memory_order_relaxed),
+                         stats.contentions_.load(std::memory_order_relaxed),
+                         stats.parks_.load(std::memory_order_relaxed),
+                         stats.spinTime_.load(std::memory_order_relaxed),
+                         stats.parkTime_.load(std::memory_order_relaxed),
+                         monitor->spinIters_.load(std::memory_order_relaxed)});
+    }
+  }
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+    return a.contentions_ > b.contentions_;
+  });
+
+  ClPrint(LOG_INFO, LOG_LOCK, "Lock statistics: name, acquisitions, contentions, parks, "
+          "spin time (us), park time (us), spin iterations");
+  for (const auto& entry : entries) {
+    ClPrint(LOG_INFO, LOG_LOCK, "%s: %llu, %llu, %llu, %llu, %llu, %d", entry.name_.c_str(),
+            static_cast<unsigned long long>(entry.acquisitions_),
+            static_cast<unsigned long long>(entry.contentions_),
+            static_cast<unsigned long long>(entry.parks_),
+            static_cast<unsigned long long>(entry.spinTime_ / 1000),
+            static_cast<unsigned long long>(entry.parkTime_ / 1000), entry.spinIters_);
+  }
+}
+
 }  // namespace amd
@@ -24,6 +24,7 @@
 #include "top.hpp"
 #include "thread/semaphore.hpp"
 #include "thread/thread.hpp"
+#include "utils/flags.hpp"
 
 #include <atomic>
 #include <tuple>
@@ -77,6 +78,7 @@ class Monitor : public HeapObject {
 
   static constexpr int kMaxSpinIter = 55;      //!< Total number of spin iterations.
   static constexpr int kMaxReadSpinIter = 50;  //!< Read iterations before yielding
+  static constexpr int kMaxAdaptiveSpinIter = 200;  //!< The limit of the adaptive spinning
 
   /*! Linked list of semaphores the contending threads are waiting on
    *  and main lock.
@@ -97,11 +99,26 @@ class Monitor : public HeapObject {
   //! True if this is a recursive mutex, false otherwise.
   const bool recursive_;
 
+  //! The average number of read iterations, which acquired the lock in the spin loop.
+  std::atomic<int32_t> spinIters_;
+
+  //! The lock statistics, collected with AMD_MONITOR_STATS
+  struct Stats {
+    std::atomic<uint64_t> acquisitions_;  //!< Number of the lock acquisitions
+    std::atomic<uint64_t> contentions_;   //!< Number of the contended acquisitions
+    std::atomic<uint64_t> parks_;         //!< Number of the contended threads put to sleep
+    std::atomic<uint64_t> spinTime_;      //!< Time in the spin loop before the acquisition (ns)
+    std::atomic<uint64_t> parkTime_;      //!< Time on the contention list (ns)
+    bool registered_;                     //!< The monitor is in the statistics registry
+  } stats_;
+
  private:
   //! Finish locking the mutex (contented case).
   void finishLock();
   //! Finish unlocking the mutex (contented case).
   void finishUnlock();
+  //! Count the acquisition of the owned lock
+  void countAcquisition();
 
  protected:
   //! Try to spin-acquire the lock, return true if successful.
@@ -121,7 +138,7 @@ class Monitor : public HeapObject {
 
  public:
   explicit Monitor(const char* name = NULL, bool recursive = false);
-  ~Monitor() {}
+  ~Monitor();
 
   //! Try to acquire the lock, return true if successful.
   inline bool tryLock();
@@ -153,6 +170,9 @@ class Monitor : public HeapObject {
 
   //! Return this lock's name.
   const char* name() const { return name_; }
+
+  //! Log the statistics of all monitors, sorted by the contention
+  static void dumpStats();
 };
 
 class ScopedLock : StackObject {
@@ -185,6 +205,9 @@ inline bool Monitor::tryLock() {
     if (recursive_ && thread == owner_) {
       // Recursive lock: increment the lock count and return.
       ++lockCount_;
+      if (unlikely(AMD_MONITOR_STATS)) {
+        countAcquisition();
+      }
       return true;
     }
     return false;  // Already locked!
@@ -197,6 +220,9 @@ inline bool Monitor::tryLock() {
 
   setOwner(thread);  // cannot move above the CAS.
   lockCount_ = 1;
+  if (unlikely(AMD_MONITOR_STATS)) {
+    countAcquisition();
+  }
 
   return true;
 }
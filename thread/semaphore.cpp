@@ -20,14 +20,11 @@
 
 #include "thread/semaphore.hpp"
 #include "thread/thread.hpp"
+#include "os/os.hpp"
 
 #if defined(_WIN32) || defined(__CYGWIN__)
 #include <windows.h>
-#else  // !_WIN32
-#include <semaphore.h>
-#include <errno.h>
-#include <time.h>
-#endif  // !_WIN32
+#endif  // _WIN32
 
 namespace amd {
 
@@ -36,9 +33,7 @@ Semaphore::Semaphore() : state_(0) {
   handle_ = static_cast<void*>(CreateSemaphore(NULL, 0, LONG_MAX, NULL));
   assert(handle_ != NULL && "CreateSemaphore failed");
 #else   // !_WIN32
-  if (sem_init(&sem_, 0, 0) != 0) {
-    fatal("sem_init() failed");
-  }
+  wakeups_.store(0, std::memory_order_relaxed);
 #endif  // !_WIN32
 }
 
@@ -47,12 +42,21 @@ Semaphore::~Semaphore() {
   if (!CloseHandle(static_cast<HANDLE>(handle_))) {
     fatal("CloseHandle() failed");
   }
-#else   // !_WIN32
-  if (sem_destroy(&sem_) != 0) {
-    fatal("sem_destroy() failed");
+#endif  // _WIN32
+}
+
+#ifndef _WIN32
+bool Semaphore::takeWakeup() {
+  int32_t wakeups = wakeups_.load(std::memory_order_acquire);
+  while (wakeups > 0) {
+    if (wakeups_.compare_exchange_weak(wakeups, wakeups - 1, std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+      return true;
+    }
   }
-#endif  // !WIN32
+  return false;
 }
+#endif  // !_WIN32
 
 void Semaphore::post() {
   int state = state_.load(std::memory_order_relaxed);
@@ -76,9 +80,8 @@ void Semaphore::post() {
 #ifdef _WIN32
     ReleaseSemaphore(static_cast<HANDLE>(handle_), 1, NULL);
 #else   // !_WIN32
-    if (0 != sem_post(&sem_)) {
-      fatal("sem_post() failed");
-    }
+    wakeups_.fetch_add(1, std::memory_order_release);
+    Os::wakeOneOnAddress(reinterpret_cast<volatile int32_t*>(&wakeups_));
 #endif  // !_WIN32
   }
 }
@@ -93,10 +96,9 @@ void Semaphore::wait() {
     fatal("WaitForSingleObject failed");
   }
 #else   // !_WIN32
-  while (0 != sem_wait(&sem_)) {
-    if (EINTR != errno) {
-      fatal("sem_wait() failed");
-    }
+  // The futex returns immediately, if a wake-up was posted after the check
+  while (!takeWakeup()) {
+    Os::waitOnAddress(reinterpret_cast<volatile int32_t*>(&wakeups_), 0);
   }
 #endif  // !_WIN32
 }
@@ -112,27 +114,15 @@ void Semaphore::timedWait(int millis) {
     fatal("WaitForSingleObject failed");
   }
 #else   // !_WIN32
-  struct timespec ts;
-
-  if (clock_gettime(CLOCK_REALTIME, &ts) == -1) {
-    fatal("clock_gettime() failed");
-  }
-
-  ts.tv_sec += millis / 1000;
-  ts.tv_nsec += ((long)millis % 1000) * 1000000;
-
-  if (ts.tv_nsec >= 1000000000) {
-    ts.tv_sec += 1;
-    ts.tv_nsec -= 1000000000;
-  }
-
-  int status;
-  while ((status = sem_timedwait(&sem_, &ts)) != 0) {
-    if (ETIMEDOUT == errno) {
+  const uint64_t deadline = Os::timeNanos() + static_cast<uint64_t>(millis) * 1000000;
+  while (!takeWakeup()) {
+    const uint64_t now = Os::timeNanos();
+    if (now >= deadline) {
       break;
-    } else if (EINTR != errno) {
-      fatal("sem_wait() failed");
     }
+    // Round the remaining time up, so the wait doesn't spin on the last millisecond
+    Os::waitOnAddress(reinterpret_cast<volatile int32_t*>(&wakeups_), 0,
+                      static_cast<uint>((deadline - now + 999999) / 1000000));
   }
 #endif  // !_WIN32
 }
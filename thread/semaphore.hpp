@@ -25,9 +25,6 @@
 #include "utils/util.hpp"
 
 #include <atomic>
-#if defined(__linux__)
-#include <semaphore.h>
-#endif /*linux*/
 
 
 namespace amd {
@@ -49,7 +46,11 @@ class alignas(64) Semaphore : public HeapObject {
 #ifdef _WIN32
   void* handle_;  //!< The semaphore object's handle.
 #else  // !_WIN32
-  sem_t sem_;  //!< The semaphore object's identifier.
+  //! The wake-ups for the parked threads. The threads park on the word with futex
+  std::atomic<int32_t> wakeups_;
+
+  //! Consumes a pending wake-up. Returns FALSE if there are no wake-ups
+  bool takeWakeup();
 #endif /*!_WIN32*/
 
 public:
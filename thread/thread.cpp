@@ -53,12 +53,17 @@ Thread::Thread(const std::string& name, size_t stackSize, bool spawn)
 
   if (!spawn) return;
 
+  spawnOsThread();
+}
+
+bool Thread::spawnOsThread() {
   if ((handle_ = Os::createOsThread(this))) {
     // Now we need to wait for Thread::main to report back.
     while (state() != Thread::INITIALIZED) {
       created_->wait();
     }
   }
+  return state() == Thread::INITIALIZED;
 }
 
 Thread::~Thread() {
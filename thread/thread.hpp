@@ -126,6 +126,10 @@ class Thread : public HeapObject {
   //! Get the system thread handle.
   const void* handle() const { return handle_; }
 
+  //! Creates the OS thread for the object, constructed without it. Returns TRUE
+  //! if the thread is ready to start
+  bool spawnOsThread();
+
   //! Start the thread execution
   bool start(void* data = NULL);
 
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Decodes the binary trace, written with AMD_LOG_BINARY, into the AMD_LOG_LEVEL text.
+
+The file layout (little endian, see utils/bintrace.hpp):
+  header:  u32 magic, u32 version, u32 record size, u32 number of sites, u32 number of rings
+  site:    u32 id, i32 level, i32 line, u32 file length, u32 format length, file, format
+  ring:    u32 ring index, u32 number of records, records
+  record:  u32 site, u8 number of args, u8 flags, u16 payload size, u64 time in ns, payload
+  arg:     u8 type, 8 bytes value or u8 length and characters for the strings
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = 0x43525442
+VERSION = 1
+
+ARG_SIGNED, ARG_UNSIGNED, ARG_DOUBLE, ARG_POINTER, ARG_STRING = range(1, 6)
+DYNAMIC_FORMAT, TRUNCATED = 0x1, 0x2
+
+CONVERSION = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcspn%])')
+LENGTH_BITS = {'hh': 8, 'h': 16, None: 32, 'l': 64, 'll': 64, 'j': 64, 'z': 64, 't': 64, 'L': 64}
+
+
+class Reader:
+  def __init__(self, data):
+    self.data = data
+    self.offset = 0
+
+  def read(self, fmt):
+    values = struct.unpack_from('<' + fmt, self.data, self.offset)
+    self.offset += struct.calcsize('<' + fmt)
+    return values
+
+  def bytes(self, size):
+    value = self.data[self.offset:self.offset + size]
+    self.offset += size
+    return value
+
+
+def parse_args(payload, count):
+  args = []
+  offset = 0
+  for _ in range(count):
+    kind = payload[offset]
+    offset += 1
+    if kind == ARG_STRING:
+      length = payload[offset]
+      args.append(payload[offset + 1:offset + 1 + length].decode('utf-8', 'replace'))
+      offset += 1 + length
+    elif kind == ARG_DOUBLE:
+      args.append(struct.unpack_from('<d', payload, offset)[0])
+      offset += 8
+    elif kind == ARG_SIGNED:
+      args.append(struct.unpack_from('<q', payload, offset)[0])
+      offset += 8
+    else:
+      args.append(struct.unpack_from('<Q', payload, offset)[0])
+      offset += 8
+  return args
+
+
+def to_int(value, bits, signed):
+  if isinstance(value, float):
+    value = int(value)
+  elif isinstance(value, str):
+    return 0
+  value &= (1 << bits) - 1
+  if signed and (value >> (bits - 1)):
+    value -= 1 << bits
+  return value
+
+
+def format_record(fmt, args):
+  """Applies the C format to the raw arguments."""
+  args = list(args)
+
+  def next_arg():
+    return args.pop(0) if args else None
+
+  def convert(match):
+    flags, width, precision, length, conv = match.groups()
+    if conv == '%':
+      return '%'
+    if width == '*':
+      width = str(to_int(next_arg() or 0, 32, True))
+    if precision == '*':
+      precision = str(to_int(next_arg() or 0, 32, True))
+    spec = '%' + flags + (width or '') + ('.' + precision if precision is not None else '')
+    value = next_arg()
+    if value is None:
+      return '<?>'
+    if conv == 'n':
+      return ''
+    if conv == 's':
+      return (spec + 's') % (value if isinstance(value, str) else '0x%x' % value)
+    if conv == 'c':
+      return (spec + 'c') % chr(to_int(value, 8, False))
+    if conv == 'p':
+      return (spec + 's') % ('0x%x' % to_int(value, 64, False))
+    if conv in 'di':
+      return (spec + 'd') % to_int(value, LENGTH_BITS[length], True)
+    if conv in 'ouxX':
+      return (spec + ('d' if conv == 'u' else conv)) % to_int(value, LENGTH_BITS[length], False)
+    if not isinstance(value, float):
+      value = float(to_int(value, 64, True))
+    if conv in 'aA':
+      return value.hex()
+    return (spec + conv) % value
+
+  return CONVERSION.sub(convert, fmt)
+
+
+def decode(data, output, location):
+  reader = Reader(data)
+  magic, version, record_size, num_sites, num_rings = reader.read('5I')
+  if magic != MAGIC or version != VERSION:
+    raise ValueError('Not a binary trace file of version %d' % VERSION)
+
+  sites = {}
+  for _ in range(num_sites):
+    site, level, line, file_length, format_length = reader.read('IiiII')
+    name = reader.bytes(file_length).decode('utf-8', 'replace')
+    fmt = reader.bytes(format_length).decode('utf-8', 'replace')
+    sites[site] = (level, name, line, fmt)
+
+  records = []
+  for _ in range(num_rings):
+    ring, count = reader.read('II')
+    for _ in range(count):
+      record = reader.bytes(record_size)
+      site, num_args, flags, size, time = struct.unpack_from('<IBBHQ', record)
+      records.append((time, ring, site, flags, parse_args(record[16:16 + size], num_args)))
+
+  # The rings are per thread, so merge them in the time order
+  records.sort(key=lambda record: (record[0], record[1]))
+  for time, ring, site, flags, args in records:
+    level, name, line, fmt = sites.get(site, (0, '?', 0, '<unknown site %d>' % site))
+    if flags & DYNAMIC_FORMAT:
+      fmt, args = args[0], args[1:]
+    message = format_record(fmt, args)
+    if flags & TRUNCATED:
+      message += ' <truncated>'
+    if not location:
+      name, line = '', 0
+    output.write(':%d:%-25s:%-4d: %010d us: [%d] %s\n' %
+                 (level, name, line, time // 1000, ring, message))
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+  parser.add_argument('trace', help='binary trace file')
+  parser.add_argument('-o', '--output', help='output text file, default is stdout')
+  parser.add_argument('--no-location', action='store_true', help='skip the file and line')
+  args = parser.parse_args()
+
+  with open(args.trace, 'rb') as trace:
+    data = trace.read()
+  output = open(args.output, 'w') if args.output else sys.stdout
+  try:
+    decode(data, output, not args.no_location)
+  finally:
+    if output is not sys.stdout:
+      output.close()
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,227 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "utils/bintrace.hpp"
+#include "os/os.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace amd {
+
+bool TraceBuffer::enabled_ = false;
+
+static_assert(sizeof(TraceBuffer::Record) == TraceBuffer::kRecordSize, "Invalid record size");
+
+namespace {
+
+//! The registered site. The registry owns the texts, since the sites are static objects,
+//! which can be destroyed before the final flush
+struct SiteEntry {
+  uint32_t id_;
+  int level_;
+  int line_;
+  std::string file_;
+  std::string format_;
+};
+
+//! The records ring of a thread. The rings are never freed, since the records of
+//! the finished threads must survive until the flush
+struct Ring {
+  uint32_t index_;  //!< The ring index in the trace file
+  uint64_t count_;  //!< The number of the published records
+  TraceBuffer::Record records_[TraceBuffer::kRingSize];
+};
+
+std::mutex traceLock;            //!< Lock for the registry and the file
+std::deque<SiteEntry> sites;     //!< The registered sites with the stable addresses
+std::vector<Ring*> rings;        //!< All thread rings
+std::string tracePath;           //!< The trace file
+thread_local Ring* threadRing = nullptr;
+
+//! Writes the trace file on the process exit, since the runtime doesn't tear down
+struct TraceFlusher {
+  ~TraceFlusher() { TraceBuffer::flush(); }
+} traceFlusher;
+
+}  // namespace
+
+// ================================================================================================
+TraceSite::TraceSite(int level, const char* file, int line, const char* format)
+    : strings_(stringMask(format)) {
+  std::lock_guard<std::mutex> lock(traceLock);
+  id_ = static_cast<uint32_t>(sites.size());
+  sites.push_back({id_, level, line, file, format});
+  text_ = sites.back().format_.c_str();
+  length_ = sites.back().format_.size();
+}
+
+// ================================================================================================
+uint32_t TraceSite::stringMask(const char* format) {
+  uint32_t mask = 0;
+  uint32_t index = 0;
+  for (const char* c = format; *c != '\0'; ++c) {
+    if (*c != '%') {
+      continue;
+    }
+    if (*++c == '%') {
+      continue;
+    }
+    // Skip the flags, the width, the precision and the length modifiers
+    for (; (*c != '\0') && (strchr("-+ #0123456789.*hljztL", *c) != nullptr); ++c) {
+      if (*c == '*') {
+        // The width or the precision comes from an argument
+        ++index;
+      }
+    }
+    if (*c == '\0') {
+      break;
+    }
+    if ((*c == 's') && (index < 32)) {
+      mask |= 1u << index;
+    }
+    ++index;
+  }
+  return mask;
+}
+
+// ================================================================================================
+void TraceBuffer::Packer::putRaw(ArgType type, uint64_t value) {
+  if ((record_->size_ + 1 + sizeof(value)) > sizeof(record_->data_)) {
+    record_->flags_ |= kTruncated;
+    return;
+  }
+  uint8_t* data = record_->data_ + record_->size_;
+  data[0] = type;
+  memcpy(data + 1, &value, sizeof(value));
+  record_->size_ += 1 + sizeof(value);
+  record_->numArgs_++;
+  index_++;
+}
+
+// ================================================================================================
+void TraceBuffer::Packer::putString(const char* str) {
+  if (str == nullptr) {
+    str = "(null)";
+  }
+  size_t space = sizeof(record_->data_) - record_->size_;
+  if (space < 2) {
+    record_->flags_ |= kTruncated;
+    return;
+  }
+  // Copy as much as fits in the record, the decoder shows the truncated strings
+  size_t length = strnlen(str, std::min<size_t>(space - 2, UINT8_MAX));
+  if (str[length] != '\0') {
+    record_->flags_ |= kTruncated;
+  }
+  uint8_t* data = record_->data_ + record_->size_;
+  data[0] = kArgString;
+  data[1] = static_cast<uint8_t>(length);
+  memcpy(data + 2, str, length);
+  record_->size_ += static_cast<uint16_t>(2 + length);
+  record_->numArgs_++;
+  index_++;
+}
+
+// ================================================================================================
+bool TraceBuffer::init(const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    fprintf(stderr, "Can't open the binary trace file: %s\n", path);
+    return false;
+  }
+  fclose(file);
+  std::lock_guard<std::mutex> lock(traceLock);
+  tracePath = path;
+  enabled_ = true;
+  return true;
+}
+
+// ================================================================================================
+TraceBuffer::Record* TraceBuffer::begin(const TraceSite& site, const char* format) {
+  Ring* ring = threadRing;
+  if (ring == nullptr) {
+    ring = new Ring;
+    ring->count_ = 0;
+    std::lock_guard<std::mutex> lock(traceLock);
+    ring->index_ = static_cast<uint32_t>(rings.size());
+    rings.push_back(ring);
+    threadRing = ring;
+  }
+  Record* record = &ring->records_[ring->count_ % kRingSize];
+  record->site_ = site.id();
+  record->numArgs_ = 0;
+  // The format of a static site can change, if ClPrint gets a runtime string
+  record->flags_ = site.matches(format) ? 0 : kDynamicFormat;
+  record->size_ = 0;
+  record->time_ = Os::timeNanos();
+  return record;
+}
+
+// ================================================================================================
+void TraceBuffer::end() {
+  threadRing->count_++;
+}
+
+// ================================================================================================
+void TraceBuffer::flush() {
+  std::lock_guard<std::mutex> lock(traceLock);
+  if (!enabled_) {
+    return;
+  }
+  FILE* file = fopen(tracePath.c_str(), "wb");
+  if (file == nullptr) {
+    return;
+  }
+
+  const uint32_t header[] = {kMagic, kVersion, static_cast<uint32_t>(kRecordSize),
+                             static_cast<uint32_t>(sites.size()),
+                             static_cast<uint32_t>(rings.size())};
+  fwrite(header, sizeof(header), 1, file);
+
+  for (const auto& site : sites) {
+    const uint32_t entry[] = {site.id_, static_cast<uint32_t>(site.level_),
+                              static_cast<uint32_t>(site.line_),
+                              static_cast<uint32_t>(site.file_.size()),
+                              static_cast<uint32_t>(site.format_.size())};
+    fwrite(entry, sizeof(entry), 1, file);
+    fwrite(site.file_.data(), 1, site.file_.size(), file);
+    fwrite(site.format_.data(), 1, site.format_.size(), file);
+  }
+
+  // @note: The threads can still write records, hence the oldest records in the dump
+  // may be overwritten. The decoder orders all records by the timestamps
+  for (const auto ring : rings) {
+    const uint64_t count = ring->count_;
+    const uint64_t first = (count > kRingSize) ? (count - kRingSize) : 0;
+    const uint32_t entry[] = {ring->index_, static_cast<uint32_t>(count - first)};
+    fwrite(entry, sizeof(entry), 1, file);
+    for (uint64_t i = first; i < count; ++i) {
+      fwrite(&ring->records_[i % kRingSize], sizeof(Record), 1, file);
+    }
+  }
+  fclose(file);
+}
+
+}  // namespace amd
@@ -0,0 +1,183 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#ifndef BINTRACE_HPP_
+#define BINTRACE_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+//! \addtogroup Utils
+//  @{
+
+namespace amd { /*@{*/
+
+//! The call site of the log records in the binary trace.
+//! ClPrint creates one static site per call location, so the records carry only the site ID
+//! and the raw arguments. The format text is written once into the trace file.
+class TraceSite {
+ public:
+  TraceSite(int level, const char* file, int line, const char* format);
+
+  //! Returns the ID of the site in the trace file
+  uint32_t id() const { return id_; }
+
+  //! Returns TRUE if the format matches the registered text of the site
+  bool matches(const char* format) const {
+    return (strncmp(format, text_, length_) == 0) && (format[length_] == '\0');
+  }
+
+  //! Returns the bit mask of the arguments, converted with %s in the format
+  uint32_t strings() const { return strings_; }
+
+  //! Parses the format and returns the bit mask of the %s arguments
+  static uint32_t stringMask(const char* format);
+
+ private:
+  const char* text_;  //!< The format text, owned by the trace registry
+  size_t length_;     //!< The length of the format text
+  uint32_t id_;       //!< The site ID
+  uint32_t strings_;  //!< The bit mask of the %s arguments
+};
+
+//! Binary structured trace of the log records.
+//! Each thread writes fixed size records into its own ring buffer without any locks or
+//! formatting. The rings keep the last kRingSize records per thread and are written into
+//! the trace file with the site table on flush. The file is decoded offline
+//! with tools/rocclr_trace_decode.py (see the script for the layout).
+class TraceBuffer {
+ public:
+  static constexpr uint32_t kMagic = 0x43525442;  //!< "BTRC"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr size_t kRecordSize = 128;      //!< The size of a record in bytes
+  static constexpr size_t kRingSize = 4096;       //!< The number of records per thread
+
+  //! The argument types in the record payload
+  enum ArgType : uint8_t {
+    kArgSigned = 1,    //!< 8 bytes signed integer
+    kArgUnsigned = 2,  //!< 8 bytes unsigned integer or raw trivial object
+    kArgDouble = 3,    //!< 8 bytes IEEE double
+    kArgPointer = 4,   //!< 8 bytes address
+    kArgString = 5     //!< 1 byte length and the characters without the terminator
+  };
+
+  //! The record flags
+  enum RecordFlags : uint8_t {
+    kDynamicFormat = 0x1,  //!< The first argument is the format, which didn't match the site
+    kTruncated = 0x2       //!< The payload was too small for all arguments
+  };
+
+  //! A fixed size record in the ring
+  struct Record {
+    uint32_t site_;     //!< The site ID
+    uint8_t numArgs_;   //!< The number of the arguments in the payload
+    uint8_t flags_;     //!< RecordFlags
+    uint16_t size_;     //!< The payload size in bytes
+    uint64_t time_;     //!< Os::timeNanos() of the record
+    uint8_t data_[kRecordSize - 16];  //!< The packed arguments
+  };
+
+  //! Packs the arguments of a record
+  class Packer {
+   public:
+    Packer(Record* record, uint32_t strings) : record_(record), strings_(strings), index_(0) {}
+
+    void put(const char* str) {
+      if ((index_ < 32) && ((strings_ >> index_) & 1)) {
+        putString(str);
+      } else {
+        putRaw(kArgPointer, reinterpret_cast<uintptr_t>(str));
+      }
+    }
+    void put(char* str) { put(const_cast<const char*>(str)); }
+    template <typename T> void put(T* ptr) { putRaw(kArgPointer, reinterpret_cast<uintptr_t>(ptr)); }
+    void put(std::nullptr_t) { putRaw(kArgPointer, 0); }
+    void put(double value) {
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      putRaw(kArgDouble, bits);
+    }
+    void put(float value) { put(static_cast<double>(value)); }
+    void put(long double value) { put(static_cast<double>(value)); }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type put(
+        T value) {
+      putRaw(std::is_signed<T>::value ? kArgSigned : kArgUnsigned, static_cast<uint64_t>(value));
+    }
+
+    //! Trivial objects, passed through the varargs (i.e. std::thread::id), are stored raw
+    template <typename T>
+    typename std::enable_if<std::is_class<T>::value>::type put(const T& value) {
+      static_assert(std::is_trivially_copyable<T>::value, "Only trivial objects can be traced");
+      uint64_t bits = 0;
+      memcpy(&bits, &value, (sizeof(T) < sizeof(bits)) ? sizeof(T) : sizeof(bits));
+      putRaw(kArgUnsigned, bits);
+    }
+
+    void putString(const char* str);
+
+   private:
+    void putRaw(ArgType type, uint64_t value);
+
+    Record* record_;    //!< The current record
+    uint32_t strings_;  //!< The bit mask of the %s arguments
+    uint32_t index_;    //!< The index of the next argument
+  };
+
+  //! Returns TRUE if the log records go into the binary trace
+  static bool enabled() { return enabled_; }
+
+  //! Enables the binary trace into the file
+  static bool init(const char* path);
+
+  //! Writes the site table and all rings into the trace file
+  static void flush();
+
+  //! Adds a record for the site into the ring of the current thread
+  template <typename... Args>
+  static void record(const TraceSite& site, const char* format, Args... args) {
+    Record* record = begin(site, format);
+    Packer packer(record,
+        (record->flags_ & kDynamicFormat) ? (TraceSite::stringMask(format) << 1) | 1
+                                          : site.strings());
+    if (record->flags_ & kDynamicFormat) {
+      packer.put(format);
+    }
+    int expand[] = {0, (packer.put(args), 0)...};
+    (void)expand;
+    end();
+  }
+
+ private:
+  //! Starts a new record in the ring of the current thread
+  static Record* begin(const TraceSite& site, const char* format);
+
+  //! Publishes the current record in the ring of the current thread
+  static void end();
+
+  static bool enabled_;  //!< The binary trace is enabled
+};
+
+/*@}*/} // namespace amd
+
+#endif /*BINTRACE_HPP_*/
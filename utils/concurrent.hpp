@@ -23,9 +23,13 @@
 
 #include "top.hpp"
 #include "os/alloc.hpp"
+#include "os/os.hpp"
+#include "thread/monitor.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <new>
+#include <vector>
 
 //! \addtogroup Utils
 
@@ -63,8 +67,10 @@ template <typename T, int N> struct TaggedPointerHelper {
  * "Simple, Fast, and Practical Non-Blocking and Blocking Concurrent Queue
  * Algorithms by Maged M. Michael and Michael L. Scott.".
  *
- * FIXME_lmoriche: Implement the new/delete operators for SimplyLinkedNode
- * using thread-local allocation buffers.
+ * The nodes are recycled through the thread local caches and a shared lock-free
+ * free list, so the steady state traffic doesn't allocate. The node memory is never
+ * returned to the OS, hence the stale reads of a recycled node are safe and
+ * the tags of the node links detect the reuse.
  */
 template <typename T, int N = 5> class ConcurrentLinkedQueue : public HeapObject {
   //! A simply-linked node
@@ -72,8 +78,9 @@ template <typename T, int N = 5> class ConcurrentLinkedQueue : public HeapObject
     typedef details::TaggedPointerHelper<Node, N> TaggedPointerHelper;
     typedef TaggedPointerHelper* Ptr;
 
-    T value_;                //!< The value stored in that node.
-    std::atomic<Ptr> next_;  //!< Pointer to the next node
+    T value_;                     //!< The value stored in that node.
+    std::atomic<Ptr> next_;       //!< Pointer to the next node
+    std::atomic<Node*> nextFree_; //!< Pointer to the next node in the free list
 
     //! Create a Node::Ptr
     static inline Ptr ptr(Node* ptr, size_t counter = 0) {
@@ -86,13 +93,96 @@ template <typename T, int N = 5> class ConcurrentLinkedQueue : public HeapObject
   std::atomic<typename Node::Ptr> tail_;  //! Pointer to the most recent element.
 
  private:
+  //! A thread local cache of the free nodes
+  struct NodeCache {
+    static constexpr uint32_t Size = 64;  //!< The maximum number of the cached nodes
+    Node* nodes_[Size];                   //!< The cached nodes
+    uint32_t count_ = 0;                  //!< The number of the cached nodes
+
+    //! Returns the cached nodes of the exiting thread to the shared free list
+    ~NodeCache() {
+      if (count_ != 0) {
+        pushFree(nodes_, count_);
+      }
+    }
+  };
+
+  //! \brief Return the thread local node cache.
+  static inline NodeCache& nodeCache() {
+    static thread_local NodeCache cache;
+    return cache;
+  }
+
+  //! \brief Return the head of the shared free list.
+  static inline std::atomic<typename Node::Ptr>& freeList() {
+    static std::atomic<typename Node::Ptr> head(Node::ptr(nullptr));
+    return head;
+  }
+
+  //! \brief Push a batch of the nodes into the shared free list.
+  static inline void pushFree(Node** nodes, uint32_t count) {
+    for (uint32_t i = 0; i + 1 < count; ++i) {
+      nodes[i]->nextFree_.store(nodes[i + 1], std::memory_order_relaxed);
+    }
+    std::atomic<typename Node::Ptr>& head = freeList();
+    typename Node::Ptr top = head.load(std::memory_order_relaxed);
+    do {
+      nodes[count - 1]->nextFree_.store(top->ptr(), std::memory_order_relaxed);
+    } while (!head.compare_exchange_weak(top, Node::ptr(nodes[0], top->tag() + 1),
+                                         std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  //! \brief Pop a node from the shared free list. Returns NULL if the list is empty.
+  static inline Node* popFree() {
+    std::atomic<typename Node::Ptr>& head = freeList();
+    typename Node::Ptr top = head.load(std::memory_order_acquire);
+    while (top->ptr() != NULL) {
+      // The node can be popped by another thread, but its memory stays valid
+      Node* next = top->ptr()->nextFree_.load(std::memory_order_relaxed);
+      if (head.compare_exchange_weak(top, Node::ptr(next, top->tag() + 1),
+                                     std::memory_order_acquire, std::memory_order_acquire)) {
+        return top->ptr();
+      }
+    }
+    return NULL;
+  }
+
   //! \brief Allocate a free node.
   static inline Node* allocNode() {
-    return new (AlignedMemory::allocate(sizeof(Node), 1 << N)) Node();
+    NodeCache& cache = nodeCache();
+    if (cache.count_ == 0) {
+      // Refill the half of the cache from the shared free list
+      while (cache.count_ < NodeCache::Size / 2) {
+        Node* node = popFree();
+        if (node == NULL) {
+          break;
+        }
+        cache.nodes_[cache.count_++] = node;
+      }
+      if (cache.count_ == 0) {
+        return new (AlignedMemory::allocate(sizeof(Node), 1 << N)) Node();
+      }
+    }
+    return cache.nodes_[--cache.count_];
   }
 
   //! \brief Return a node to the free list.
-  static inline void reclaimNode(Node* node) { AlignedMemory::deallocate(node); }
+  static inline void reclaimNode(Node* node) {
+    NodeCache& cache = nodeCache();
+    if (cache.count_ == NodeCache::Size) {
+      // Move the upper half of the cache to the shared free list
+      pushFree(&cache.nodes_[NodeCache::Size / 2], NodeCache::Size / 2);
+      cache.count_ = NodeCache::Size / 2;
+    }
+    cache.nodes_[cache.count_++] = node;
+  }
+
+  //! \brief Clear the next link of a node. The tag is advanced, so a stale CAS
+  //! on the link of a recycled node fails.
+  static inline void clearNext(Node* node) {
+    typename Node::Ptr next = node->next_.load(std::memory_order_relaxed);
+    node->next_.store(Node::ptr(NULL, next->tag() + 1), std::memory_order_relaxed);
+  }
 
  public:
   //! \brief Initialize a new concurrent linked queue.
@@ -116,7 +206,7 @@ template <typename T, int N = 5> class ConcurrentLinkedQueue : public HeapObject
 template <typename T, int N> inline ConcurrentLinkedQueue<T, N>::ConcurrentLinkedQueue() {
   // Create the first "dummy" node.
   Node* dummy = allocNode();
-  dummy->next_ = NULL;
+  clearNext(dummy);
   DEBUG_ONLY(dummy->value_ = NULL);
 
   // Head and tail should now point to it (empty list).
@@ -141,7 +231,7 @@ template <typename T, int N> inline ConcurrentLinkedQueue<T, N>::~ConcurrentLink
 template <typename T, int N> inline void ConcurrentLinkedQueue<T, N>::enqueue(T elem) {
   Node* node = allocNode();
   node->value_ = elem;
-  node->next_ = NULL;
+  clearNext(node);
 
   for (;;) {
     typename Node::Ptr tail = tail_.load(std::memory_order_acquire);
@@ -204,6 +294,268 @@ template <typename T, int N> inline bool ConcurrentLinkedQueue<T, N>::empty() {
   }
 }
 
+/*! \brief A bounded ring buffer queue with a single consumer.
+ *
+ * The slots carry the sequence numbers, so a slot is published to the consumer
+ * and returned to the producers without a shared counter of the elements. The SPSC
+ * variant advances the tail with a plain store, the MPSC variant claims the slots
+ * with a CAS. The producer and consumer indices are in separate cache lines.
+ * The consumer can change between threads, if the handoff is synchronized.
+ */
+template <typename T, uint32_t Capacity, bool MultiProducer = false>
+class ConcurrentRingQueue : public HeapObject {
+  static_assert((Capacity & (Capacity - 1)) == 0, "The capacity must be a power of 2");
+
+  //! A slot of the ring
+  struct Slot {
+    std::atomic<uint64_t> sequence_;  //!< The index of the element, the slot expects
+    T value_;                         //!< The stored element
+  };
+
+ public:
+  ConcurrentRingQueue() : tail_(0), head_(0) {
+    for (uint32_t i = 0; i < Capacity; ++i) {
+      slots_[i].sequence_.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  //! \brief Enqueue an element. Returns FALSE if the queue is full.
+  inline bool tryEnqueue(T elem) {
+    uint64_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos & (Capacity - 1)];
+      const uint64_t sequence = slot.sequence_.load(std::memory_order_acquire);
+      if (sequence == pos) {
+        if (!MultiProducer) {
+          tail_.store(pos + 1, std::memory_order_relaxed);
+        } else if (!tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          continue;
+        }
+        slot.value_ = elem;
+        // Publish the element to the consumer
+        slot.sequence_.store(pos + 1, std::memory_order_release);
+        return true;
+      } else if (sequence < pos) {
+        // The consumer didn't free the slot from the previous lap
+        return false;
+      }
+      // Another producer claimed the slot, hence reload the tail
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+  }
+
+  //! \brief Enqueue an element. Blocks while the queue is full.
+  inline void enqueue(T elem) {
+    for (uint i = 0; !tryEnqueue(elem); ++i) {
+      if (i < SpinCount) {
+        Os::spinPause();
+      } else {
+        Os::yield();
+      }
+    }
+  }
+
+  //! \brief Dequeue an element. Returns NULL if the queue is empty.
+  inline T dequeue() {
+    const uint64_t pos = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[pos & (Capacity - 1)];
+    if (slot.sequence_.load(std::memory_order_acquire) != (pos + 1)) {
+      return NULL;
+    }
+    T value = slot.value_;
+    head_.store(pos + 1, std::memory_order_relaxed);
+    // Return the slot to the producers for the next lap
+    slot.sequence_.store(pos + Capacity, std::memory_order_release);
+    return value;
+  }
+
+  //! \brief Check if queue is empty
+  inline bool empty() const {
+    const uint64_t pos = head_.load(std::memory_order_relaxed);
+    return slots_[pos & (Capacity - 1)].sequence_.load(std::memory_order_acquire) != (pos + 1);
+  }
+
+ private:
+  static constexpr uint SpinCount = 64;  //!< The number of spins before a yield on the full queue
+
+  alignas(64) std::atomic<uint64_t> tail_;  //!< The next slot for a producer
+  alignas(64) std::atomic<uint64_t> head_;  //!< The next slot for the consumer
+  alignas(64) Slot slots_[Capacity];        //!< The ring
+};
+
+/*! \brief A concurrent index of the address ranges with wait-free lookups.
+ *
+ * The index is an immutable sorted array. The updates are serialized, build a new array
+ * and publish it. The readers only register in a reader counter and search the current
+ * array, hence they never block. The old array is destroyed after all readers, which could
+ * see it, are done. The updates are expected to be much less frequent than the lookups.
+ */
+template <typename T> class ConcurrentRangeIndex : public HeapObject {
+ public:
+  //! An address range in the sorted index
+  struct Range {
+    uintptr_t start_;  //!< Start address of the range
+    uintptr_t end_;    //!< End address of the range
+    T* value_;         //!< Object of the range
+  };
+
+  ConcurrentRangeIndex(const char* name) : lock_(name, true), index_(nullptr), epoch_(0) {
+    for (auto& parity : readers_) {
+      for (auto& reader : parity) {
+        reader.count_.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  ~ConcurrentRangeIndex() { delete index_.load(); }
+
+  //! Returns the number of the ranges
+  size_t size() const {
+    ReaderCount* slot;
+    const Index* index = acquire(&slot);
+    size_t size = (index != nullptr) ? index->size() : 0;
+    release(slot);
+    return size;
+  }
+
+  //! Adds a range. Fails if the range with the same start exists or
+  //! if the start is inside of any range for the exclusive ranges
+  bool insert(uintptr_t start, uintptr_t end, T* value, bool exclusive = false) {
+    ScopedLock lock(lock_);
+    const Index* current = index_.load(std::memory_order_relaxed);
+    Index* index = (current != nullptr) ? new Index(*current) : new Index();
+    auto it = std::lower_bound(index->begin(), index->end(), start,
+                               [](const Range& range, uintptr_t key) { return range.start_ < key; });
+    if (((it != index->end()) && (it->start_ == start)) ||
+        (exclusive && (it != index->begin()) && (start < (it - 1)->end_))) {
+      delete index;
+      return false;
+    }
+    index->insert(it, {start, end, value});
+    publish(index);
+    return true;
+  }
+
+  //! Removes the range with the start. Returns the object of the range or nullptr
+  T* erase(uintptr_t start) {
+    ScopedLock lock(lock_);
+    const Index* current = index_.load(std::memory_order_relaxed);
+    if (current == nullptr) {
+      return nullptr;
+    }
+    auto found = std::lower_bound(current->begin(), current->end(), start,
+                                  [](const Range& range, uintptr_t key) { return range.start_ < key; });
+    if ((found == current->end()) || (found->start_ != start)) {
+      return nullptr;
+    }
+    T* value = found->value_;
+    Index* index = new Index(*current);
+    index->erase(index->begin() + (found - current->begin()));
+    publish(index);
+    return value;
+  }
+
+  //! Finds the range with the address. Returns the object and the range start or nullptr
+  T* find(uintptr_t key, uintptr_t* start = nullptr) const {
+    T* value = nullptr;
+    ReaderCount* slot;
+    const Index* index = acquire(&slot);
+    if (index != nullptr) {
+      // Find the last range, which starts before or at the address
+      auto it = std::upper_bound(index->begin(), index->end(), key,
+                                 [](uintptr_t key, const Range& range) { return key < range.start_; });
+      if (it != index->begin()) {
+        --it;
+        if (key < it->end_) {
+          value = it->value_;
+          if (start != nullptr) {
+            *start = it->start_;
+          }
+        }
+      }
+    }
+    release(slot);
+    return value;
+  }
+
+  //! Calls the function for each range under the update lock
+  template <typename F> void forEach(F func) {
+    ScopedLock lock(lock_);
+    const Index* index = index_.load(std::memory_order_relaxed);
+    if (index != nullptr) {
+      for (const auto& range : *index) {
+        func(range);
+      }
+    }
+  }
+
+  //! Removes all ranges, for which the predicate returns TRUE
+  template <typename F> void removeIf(F pred) {
+    ScopedLock lock(lock_);
+    const Index* current = index_.load(std::memory_order_relaxed);
+    if (current == nullptr) {
+      return;
+    }
+    Index* index = new Index();
+    index->reserve(current->size());
+    for (const auto& range : *current) {
+      if (!pred(range)) {
+        index->push_back(range);
+      }
+    }
+    publish(index);
+  }
+
+ private:
+  //! Immutable sorted index of the ranges
+  typedef std::vector<Range> Index;
+
+  //! Counter of the active readers, padded to a cache line to avoid false sharing
+  struct alignas(64) ReaderCount {
+    std::atomic<uint32_t> count_;
+  };
+
+  static constexpr uint kNumReaderSlots = 16;  //!< The number of reader counters per epoch
+
+  //! Registers a reader and returns the current index
+  const Index* acquire(ReaderCount** slot) const {
+    // Spread the readers between the counters to avoid a contention on a single cache line
+    static std::atomic<uint> nextSlot(0);
+    static thread_local uint readerSlot = nextSlot++ % kNumReaderSlots;
+
+    // The counter must be visible before the index load, so the writer can't miss the reader
+    *slot = &readers_[epoch_.load() & 1][readerSlot];
+    (*slot)->count_.fetch_add(1);
+    return index_.load();
+  }
+
+  //! Unregisters a reader
+  void release(ReaderCount* slot) const { slot->count_.fetch_sub(1, std::memory_order_release); }
+
+  //! Publishes a new index and destroys the old one after all readers are done.
+  //! Must be called under the update lock
+  void publish(Index* index) {
+    const Index* old = index_.exchange(index);
+
+    // Wait for the readers, which could see the old index. The epoch is flipped twice,
+    // so the new readers go to the other counters and can't delay the writer
+    for (uint i = 0; i < 2; ++i) {
+      uint parity = epoch_.fetch_add(1) & 1;
+      for (auto& reader : readers_[parity]) {
+        while (reader.count_.load(std::memory_order_acquire) != 0) {
+          Os::yield();
+        }
+      }
+    }
+    delete old;
+  }
+
+  Monitor lock_;                        //!< Serializes the index updates
+  std::atomic<const Index*> index_;     //!< Current index of the ranges
+  std::atomic<uint> epoch_;             //!< Readers epoch for the index reclamation
+  mutable ReaderCount readers_[2][kNumReaderSlots];  //!< Active readers for each epoch parity
+};
+
 }  // namespace amd
 
 #endif /*CONCURRENT_HPP_*/
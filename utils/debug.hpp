@@ -26,6 +26,8 @@
 #include <cstring>
 #include <cstdio>
 #include <cstdint>
+
+#include "utils/bintrace.hpp"
 //! \addtogroup Utils
 #ifdef _WIN32
 #include <process.h>
@@ -196,7 +198,10 @@ inline void warning(const char* msg) { amd::report_warning(msg); }
   do {                                                                                             \
     if (AMD_LOG_LEVEL >= level) {                                                                  \
       if (AMD_LOG_MASK & mask || mask == amd::LOG_ALWAYS) {                                        \
-        if (AMD_LOG_MASK & amd::LOG_LOCATION) {                                                    \
+        if (amd::TraceBuffer::enabled()) {                                                         \
+          static const amd::TraceSite traceSite(level, __FILENAME__, __LINE__, format);            \
+          amd::TraceBuffer::record(traceSite, format, ##__VA_ARGS__);                              \
+        } else if (AMD_LOG_MASK & amd::LOG_LOCATION) {                                             \
           amd::log_printf(level, __FILENAME__, __LINE__, format, ##__VA_ARGS__);                   \
         } else {                                                                                   \
           amd::log_printf(level, "", 0, format, ##__VA_ARGS__);                                    \
@@ -20,6 +20,7 @@
 
 #include "top.hpp"
 #include "utils/flags.hpp"
+#include "utils/timeline.hpp"
 
 #include <unordered_map>
 #include <string>
@@ -155,6 +156,12 @@ bool Flag::init() {
       std::string fileName = AMD_LOG_LEVEL_FILE;
       outFile = fopen(fileName.c_str(), "w");
     }
+    if (!flagIsDefault(AMD_LOG_BINARY)) {
+      TraceBuffer::init(AMD_LOG_BINARY);
+    }
+  }
+  if (!flagIsDefault(AMD_TIMELINE)) {
+    Timeline::init(AMD_TIMELINE);
   }
 
   return true;
@@ -34,6 +34,19 @@ release(uint, GPU_MAX_COMMAND_QUEUES, 300,                                    \
         "The maximum number of concurrent Virtual GPUs")                      \
 release(size_t, CQ_THREAD_STACK_SIZE, 256*Ki, /* @todo: that much! */         \
         "The default command queue thread stack size")                        \
+release(uint, CQ_THREAD_SPIN_COUNT, 2000,                                     \
+        "The number of spin iterations on the empty queue before the command queue thread sleeps") \
+release(size_t, CQ_COALESCE_SIZE, 0,                                          \
+        "Max size of merged adjacent buffer writes or fills, 0 - disabled")   \
+release(bool, AMD_QUEUE_LAZY_THREAD, true,                                    \
+        "Start the host queue thread on the first enqueue")                   \
+release(bool, AMD_QUEUE_THREAD_POOL, false,                                   \
+        "1 = Service the host queues with a shared pool of worker threads")   \
+release(uint, AMD_QUEUE_THREAD_POOL_SIZE, 0,                                  \
+        "The pool workers, 0 = two per device, up to the core count")         \
+release(uint, AMD_QUEUE_OOO_LANES, 0,                                         \
+        "The extra HW queues of an out of order host queue for the independent "\
+        "commands, 0 - disabled")                                             \
 release(int, GPU_MAX_WORKGROUP_SIZE, 0,                                       \
         "Maximum number of workitems in a workgroup for GPU, 0 -use default") \
 release(int, GPU_MAX_WORKGROUP_SIZE_2D_X, 0,                                  \
@@ -66,12 +79,16 @@ release(uint, GPU_MAX_HEAP_SIZE, 100,                                         \
         "Set maximum size of the GPU heap to % of board memory")              \
 release(uint, GPU_STAGING_BUFFER_SIZE, 1024,                                  \
         "Size of the GPU staging buffer in KiB")                              \
+release(uint, GPU_STAGING_BUFFER_CHUNKS, 2,                                   \
+        "The number of pipelined chunks in a staged copy, 1 - no pipelining") \
 release(bool, GPU_DUMP_BLIT_KERNELS, false,                                   \
         "Dump the kernels for blit manager")                                  \
 release(uint, GPU_BLIT_ENGINE_TYPE, 0x0,                                      \
         "Blit engine type: 0 - Default, 1 - Host, 2 - CAL, 3 - Kernel")       \
 release(bool, GPU_FLUSH_ON_EXECUTION, false,                                  \
         "Submit commands to HW on every operation. 0 - Disable, 1 - Enable")  \
+release(bool, GPU_FLUSH_ADAPTIVE, false,                                      \
+        "Submit commands to HW early, when GPU is about to go idle")          \
 release(bool, GPU_USE_SYNC_OBJECTS, true,                                     \
         "If enabled, use sync objects instead of polling")                    \
 release(bool, CL_KHR_FP64, true,                                              \
@@ -92,8 +109,14 @@ release(size_t, GPU_PINNED_XFER_SIZE, 32,                                     \
         "The pinned buffer size for pinning in read/write transfers")         \
 release(size_t, GPU_PINNED_MIN_XFER_SIZE, 1024,                               \
         "The minimal buffer size for pinned read/write transfers in KBytes")  \
+release(size_t, GPU_PINNED_CACHE_SIZE, 0,                                     \
+        "The cache size of pinned host memory for transfers in MB, 0 - disabled") \
 release(size_t, GPU_RESOURCE_CACHE_SIZE, 64,                                  \
         "The resource cache size in MB")                                      \
+release(bool, GPU_RESOURCE_CACHE_ASYNC_TRIM, true,                            \
+        "Trim the resource cache in a background thread")                     \
+release(size_t, GPU_MAP_CACHE_SIZE, 256,                                      \
+        "The cache size of the staging buffers for the indirect maps in MB")  \
 release(size_t, GPU_MAX_SUBALLOC_SIZE, 4096,                                  \
         "The maximum size accepted for suballocaitons in KB")                 \
 release(bool, GPU_FORCE_64BIT_PTR, 0,                                         \
@@ -103,7 +126,7 @@ release(bool, GPU_FORCE_OCL20_32BIT, 0,                                       \
 release(bool, GPU_RAW_TIMESTAMP, 0,                                           \
         "Reports GPU raw timestamps in GPU timeline")                         \
 release(size_t, GPU_NUM_MEM_DEPENDENCY, 256,                                  \
-        "Number of memory objects for dependency tracking")                   \
+        "Number of memory objects for dependency tracking, 0 - disabled")     \
 release(size_t, GPU_XFER_BUFFER_SIZE, 0,                                      \
         "Transfer buffer size for image copy optimization in KB")             \
 release(bool, GPU_IMAGE_DMA, true,                                            \
@@ -118,6 +141,9 @@ release(uint, GPU_WORKLOAD_SPLIT, 22,                                         \
         "Workload split size")                                                \
 release(bool, GPU_USE_SINGLE_SCRATCH, false,                                  \
         "Use single scratch buffer per device instead of per HW ring")        \
+release(uint, GPU_SCRATCH_SHRINK_TIMEOUT, 10000,                              \
+        "Time in ms, after which a queue shrinks the unused scratch, "        \
+        "0 = never shrink")                                                   \
 release(bool, AMD_OCL_WAIT_COMMAND, false,                                    \
         "1 = Enable a wait for every submitted command")                      \
 release(uint, GPU_PRINT_CHILD_KERNEL, 0,                                      \
@@ -134,6 +160,10 @@ release(bool, HSA_LOCAL_MEMORY_ENABLE, true,                                  \
         "Enable HSA device local memory usage")                               \
 release(uint, HSA_KERNARG_POOL_SIZE, 512 * 1024,                              \
         "Kernarg pool size")                                                  \
+release(uint, HSA_KERNARG_POOL_CHUNKS, 4,                                     \
+        "The number of chunks in the kernarg pool ring")                      \
+release(uint, HSA_KERNARG_POOL_MAX_SIZE, 4 * 1024 * 1024,                     \
+        "Max kernarg pool size with the growth, HSA_KERNARG_POOL_SIZE - no growth") \
 release(bool, HSA_ENABLE_COARSE_GRAIN_SVM, true,                              \
         "Enable device memory for coarse grain SVM allocations")              \
 release(bool, GPU_IFH_MODE, false,                                            \
@@ -170,18 +200,48 @@ release_on_stg(uint, GPU_WAVE_LIMIT_MAX_WAVE, 10,                             \
         "Set maximum waves per SIMD to try for wave limiter")                 \
 release_on_stg(uint, GPU_WAVE_LIMIT_RUN, 20,                                  \
         "Set running factor for wave limiter")                                \
+release_on_stg(uint, GPU_WAVE_LIMIT_SAMPLE, 8,                                \
+        "Profile 1 in N dispatches for wave limiter out of the adaptation")   \
 release_on_stg(cstring, GPU_WAVE_LIMIT_DUMP, "",                              \
         "File path prefix for dumping wave limiter output")                   \
 release_on_stg(cstring, GPU_WAVE_LIMIT_TRACE, "",                             \
         "File path prefix for tracing wave limiter")                          \
+release(cstring, GPU_TUNING_PROFILE_PATH, "",                                 \
+        "Path of the persistent tuning profile, empty - disabled")            \
+release(bool, GPU_WORKGROUP_TUNING, false,                                    \
+        "Tune the local workgroup size, if the app doesn't set it")           \
+release(uint, OCL_KERNEL_SPECIALIZE, 0,                                       \
+        "Specialize kernels on int args, constant for N launches, 0 - off")   \
 release(bool, OCL_CODE_CACHE_ENABLE, false,                                   \
         "1 = Enable compiler code cache")                                     \
 release(bool, OCL_CODE_CACHE_RESET, false,                                    \
         "1 =  Reset the compiler code cache storage")                         \
+release(cstring, OCL_CODE_CACHE_PATH, "",                                     \
+        "Path to the compiler code cache storage, default is the temp path")  \
+release(uint, OCL_CODE_CACHE_SIZE, 512,                                       \
+        "The compiler code cache storage budget in MB")                       \
+release(bool, GPU_BLIT_CODE_CACHE, true,                                      \
+        "1 = Cache the blit kernels, even if the code cache is disabled")     \
+release(bool, AMD_PARALLEL_BUILD, true,                                       \
+        "1 = Build programs for the different LC targets in parallel")        \
+release(bool, AMD_ASYNC_BUILD, false,                                         \
+        "1 = Build on the compile threads, if the app passes a callback")     \
+release(uint, AMD_BUILD_THREADS, 0,                                           \
+        "The number of the compile threads, 0 - the processor count up to 4") \
+release(bool, AMD_LAZY_KERNEL_INIT, true,                                     \
+        "1 = Parse the kernel metadata on the first use of the kernel")       \
 release_on_stg(bool, PAL_DISABLE_SDMA, false,                                 \
         "1 = Disable SDMA for PAL")                                           \
 release(uint, PAL_RGP_DISP_COUNT, 50,                                         \
         "The number of dispatches for RGP capture with SQTT")                 \
+release(cstring, PAL_RGP_TRIGGER_KERNEL, "",                                  \
+        "Only the dispatches of the named kernel start RGP capture")          \
+release(uint, PAL_RGP_TRIGGER_FIRST, 0,                                       \
+        "The first dispatch of the trigger kernel in RGP capture, 0 - any")   \
+release(uint, PAL_RGP_TRIGGER_LAST, 0,                                        \
+        "The last dispatch of the trigger kernel in RGP capture")             \
+release(uint, PAL_RGP_TRIGGER_DURATION, 0,                                    \
+        "Start RGP capture after a dispatch slower than the time in us")      \
 release(uint, PAL_MALL_POLICY, 0,                                             \
         "Controls the behaviour of allocations with respect to the MALL"      \
         "0 = MALL policy is decided by KMD"                                   \
@@ -197,8 +257,14 @@ release(bool, GPU_ENABLE_COOP_GROUPS, true,                                   \
          "Enables cooperative group launch")                                  \
 release(uint, GPU_MAX_COMMAND_BUFFERS, 8,                                     \
          "The maximum number of command buffers allocated per queue")         \
+release(uint, GPU_COMMAND_BUFFERS_BUDGET, 2048,                               \
+         "Memory budget in KB for the extra command buffers per queue")       \
 release(uint, GPU_MAX_HW_QUEUES, 4,                                           \
          "The maximum number of HW queues allocated per device")              \
+release(uint, ROC_WARM_QUEUES, 2,                                             \
+         "The number of HW queues, pre-created in the background for streams" \
+release(uint, ROC_XFER_QUEUES, 4,                                             \
+         "The number of internal transfer queues per device, 1 - one queue")  \
 release(bool, GPU_IMAGE_BUFFER_WAR, true,                                     \
         "Enables image buffer workaround")                                    \
 release(cstring, HIP_VISIBLE_DEVICES, "",                                     \
@@ -214,12 +280,16 @@ release(uint, GPU_MAX_USWC_ALLOC_SIZE, 2048,                                  \
         "-1 = No limit")                                                      \
 release(uint, AMD_SERIALIZE_KERNEL, 0,                                        \
         "Serialize kernel enqueue, 0x1 = Wait for completion before enqueue"  \
-        "0x2 = Wait for completion after enqueue 0x3 = both")                 \
+        "0x2 = Wait for completion after enqueue 0x3 = both"                  \
+        "0x4 = Serialize on GPU only 0x8 = Log the command timestamps")       \
 release(uint, AMD_SERIALIZE_COPY, 0,                                          \
         "Serialize copies, 0x1 = Wait for completion before enqueue"          \
-        "0x2 = Wait for completion after enqueue 0x3 = both")                 \
+        "0x2 = Wait for completion after enqueue 0x3 = both"                  \
+        "0x4 = Serialize on GPU only 0x8 = Log the command timestamps")       \
 release(bool, PAL_ALWAYS_RESIDENT, false,                                     \
         "Force memory resources to become resident at allocation time")       \
+release(uint, PAL_INTEROP_CACHE_SIZE, 0,                                      \
+        "The number of opened D3D shared resources, kept for the reuse")      \
 release(uint, HIP_HOST_COHERENT, 0,                                           \
         "Coherent memory in hipHostMalloc, 0x1 = memory is coherent with host"\
         "0x0 = memory is not coherent between host and GPU")                  \
@@ -235,16 +305,95 @@ release(size_t, GPU_FORCE_BLIT_COPY_SIZE, 0,                                  \
         "Size in KB of the threshold below which to force blit instead for sdma") \
 release(uint, ROC_ACTIVE_WAIT_TIMEOUT, 50,                                    \
         "Forces active wait of GPU interrup for the timeout(us)")             \
+release(uint, ROC_HANG_TIMEOUT, 0,                                            \
+        "Time in ms without the queue progress in a signal wait, after "      \
+        "which the hang state is printed, 0 = disable")                       \
+release(bool, ROC_HANG_ABORT, false,                                          \
+        "Inactivate the hung queue, detected with ROC_HANG_TIMEOUT")          \
+release(uint, ROC_WAIT_POLICY_HIGH, 0,                                        \
+        "Host wait for high priority queues: 0 = default, 1 = spin, "         \
+        "2 = spin and yield, 3 = adaptive spin, then interrupt")              \
+release(uint, ROC_WAIT_POLICY_NORMAL, 0,                                      \
+        "Host wait for normal priority queues, see ROC_WAIT_POLICY_HIGH")     \
+release(uint, ROC_WAIT_POLICY_LOW, 0,                                         \
+        "Host wait for low priority queues, see ROC_WAIT_POLICY_HIGH")        \
+release(cstring, ROC_PMC_SAMPLE_COUNTERS, "",                                 \
+        "Perf counters, sampled continuously on each queue: "                 \
+        "block:counter:event,... The empty string disables sampling")         \
+release(uint, ROC_PMC_SAMPLE_PERIOD, 16,                                      \
+        "Sample the perf counters on every Nth kernel dispatch")              \
+release(uint, ROC_PMC_SAMPLE_SLOTS, 32,                                       \
+        "The number of the pending perf counter samples per queue")           \
+release(cstring, ROC_THREAD_TRACE_STREAM, "",                                 \
+        "Stream the thread traces into the files with the path prefix, "      \
+        "using two trace buffers. The empty string disables streaming")       \
+release(uint, ROC_THREAD_TRACE_STREAM_PERIOD, 64,                             \
+        "Switch the streamed thread trace buffer every Nth kernel dispatch")  \
+release(bool, ROC_MARKER_ELISION, true,                                       \
+        "Skip the barrier of a marker without waits after a fenced packet")   \
+release(bool, ROC_COMPLETION_DOORBELL, true,                                  \
+        "Wait for the stream sync on a per stream interrupt signal"           \
+release(uint, ROC_TIMESTAMP_CALIBRATION, 1000,                                \
+        "The period in ms of the GPU timestamp drift correction, 0 - disable")\
 release(bool, ROC_ENABLE_LARGE_BAR, true,                                     \
         "Enable Large Bar if supported by the device")                        \
+release(uint, ROC_LARGE_BAR_WRITE_SIZE, 64,                                   \
+        "Max size in KB of the host to device writes, which CPU does "        \
+        "directly over the large BAR, 0 - disable")                           \
+release(bool, ROC_ASYNC_HOST_SVM, true,                                       \
+        "Run the big host SVM copies and fills on a helper thread, "          \
+        "the queue waits for them as for another engine")                     \
 release(bool, ROC_CPU_WAIT_FOR_SIGNAL, true,                                  \
         "Enable CPU wait for dependent HSA signals.")                         \
 release(bool, ROC_SYSTEM_SCOPE_SIGNAL, true,                                  \
         "Enable system scope for signals (uses interrupts).")                 \
+release(bool, ROC_INFER_FENCE_SCOPE, false,                                   \
+        "1 = Use the system acquire only for kernels with host memory args")  \
+release(bool, ROC_DIRECT_BLIT, true,                                          \
+        "1 = Write the blit arguments straight into the kernarg memory")      \
 release(bool, ROC_SKIP_COPY_SYNC, false,                                      \
         "Skips copy syncs if runtime can predict the same engine.")           \
+release(bool, ROC_ENGINE_RANGE_DEPS, false,                                   \
+        "1 = Compute and SDMA wait for each other only on overlapped memory") \
+release(uint, ROC_AQL_BATCH_SIZE, 1,                                          \
+        "The number of AQL packets without a signal per doorbell ring, 1 - no batching") \
+release(uint, ROC_AQL_BATCH_TIMEOUT, 20,                                      \
+        "Max delay (us) of the doorbell ring for batched AQL packets")        \
+release(bool, ROC_DIRECT_KERNARG, true,                                       \
+        "Serialize kernel arguments straight into kernarg memory on direct dispatch") \
+release(size_t, ROC_SLAB_MAX_SIZE, 64,                                        \
+        "Max buffer size in KB, sub-allocated from device memory slabs, 0 - disabled") \
+release(size_t, ROC_HOST_POOL_SIZE, 64,                                       \
+        "Max size in MiB of the freed pinned host memory, kept for the reuse")\
+release(bool, ROC_ASYNC_SCHEDULER, true,                                      \
+        "Wait for the device enqueue scheduler on GPU instead of the host")   \
+release(bool, ROC_MULTI_GRID_SWEEP, true,                                     \
+        "Ring multi-device launch doorbells together on the last grid")       \
+release(size_t, ROC_COPY_STRIPE_SIZE, 16,                                     \
+        "Min size in MiB of a copy, striped between SDMA and blit kernels")   \
+release(bool, ROC_COPY_ENGINE_MODEL, false,                                   \
+        "Select SDMA or blit kernels for copies with a measured cost model")  \
+release(size_t, ROC_HMM_DIRECT_XFER_SIZE, 8192,                               \
+        "Max KiB of the pageable transfers with direct GPU access, 0 - off")  \
+release(uint, ROC_RECLAIM_WATERMARK, 0,                                       \
+        "Trim the caches under the percent of free device memory, 0 - off")   \
+release(bool, ROC_OVERSUBSCRIBE, false,                                       \
+        "1 = Evict the cold device buffers into host memory if VRAM is full") \
+release(uint, ROC_IPC_CACHE_SIZE, 16,                                         \
+        "The number of unused IPC imports, kept attached for the reuse")      \
+release(uint, ROC_PERSISTENT_MAP_COUNT, 4,                                    \
+        "Keep the map target attached after the number of maps, 0 - off")     \
+release(bool, ROC_P2P_BROADCAST, true,                                        \
+        "Copy the host uploads of buffers to the other devices over P2P")     \
+release(bool, ROC_P2P_FIRST_TOUCH, false,                                     \
+        "1 = Access the buffer on the first touched device over P2P, instead" \
+        "of a copy on each device of the context")                            \
+release(bool, ROC_LAZY_CODE_OBJECT_LOAD, false,                               \
+        "1 = Load the code object on the first use of a kernel or a global")  \
 release(bool, HIP_FORCE_QUEUE_PROFILING, false,                               \
         "Force command queue profiling by default")                           \
+release(uint, HIP_ACTIVITY_FLUSH_INTERVAL, 10,                                \
+        "Interval in ms of the buffered activity delivery to the tracer")     \
 release(uint, PAL_FORCE_ASIC_REVISION, 0,                                     \
         "Force a specific asic revision for all devices")                     \
 release(bool, PAL_EMBED_KERNEL_MD, false,                                     \
@@ -254,10 +403,58 @@ release(cstring, ROC_GLOBAL_CU_MASK, "",                                      \
         "Each active bit represents using one CU (e.g., 0xf enables only 4 CUs)") \
 release(cstring, AMD_LOG_LEVEL_FILE, "",                                      \
         "Set output file for AMD_LOG_LEVEL, Default is stderr")               \
+release(cstring, AMD_LOG_BINARY, "",                                          \
+        "Write the log records into the binary trace file, decoded offline")  \
+release(cstring, AMD_CMD_RECORD, "",                                          \
+"Record the submitted commands into the file for the offline replay")         \
+release(bool, AMD_CMD_RECORD_DATA, false,                                     \
+"Record the host data of the write commands with AMD_CMD_RECORD")             \
+release(cstring, AMD_TIMELINE, "",                                            \
+"Write the Chrome trace JSON timeline of the runtime into the file on exit")  \
 release(size_t, PAL_PREPINNED_MEMORY_SIZE, 64,                                \
         "Size in KBytes of prepinned memory")                                 \
 release(bool, AMD_CPU_AFFINITY, false,                                        \
-        "Reset CPU affinity of any runtime threads")
+        "Reset CPU affinity of any runtime threads")                          \
+release(bool, AMD_NUMA_AFFINITY, true,                                        \
+        "Place the device threads on the closest NUMA node")                  \
+release(bool, AMD_QUEUE_THREAD_PRIORITY, true,                                \
+        "Apply the queue priority to the host thread of the queue")           \
+release(bool, AMD_SLAB_CACHE, true,                                           \
+        "Use per thread slab caches for the command allocations")             \
+release(bool, AMD_COMMAND_ARENA, true,                                        \
+        "Allocate the transient command metadata from a per command arena")   \
+release(uint, AMD_HOSTCALL_LISTENERS, 1,                                      \
+        "The maximum number of hostcall listener threads")                    \
+release(uint, AMD_CALLBACK_THREADS, 2,                                        \
+        "The number of threads for HIP stream callbacks, keeping the order "  \
+        "per stream. 0 = run the callbacks on the completion thread")         \
+release(uint, AMD_DEVMEM_HEAP_CHUNK, 16,                                      \
+        "The chunk size in MB of the heap for the small device allocations,"  \
+        "0 = create a buffer for each device allocation")                     \
+release(bool, AMD_MONITOR_STATS, false,                                       \
+        "Collect the lock statistics and dump them at the runtime shutdown")  \
+release(bool, AMD_KERNEL_STATS, false,                                        \
+        "Collect the kernel launch statistics and dump them at the shutdown") \
+release(bool, AMD_INIT_PROFILE, false,                                        \
+        "Print the time breakdown of the initialization phases on exit")      \
+release(bool, AMD_METRICS, true,                                              \
+        "Collect the runtime event counters for the metrics query API")       \
+release(uint, AMD_METRICS_DUMP_INTERVAL, 0,                                   \
+        "Interval in ms of the metrics dump into the log, 0 - disabled")      \
+release(bool, AMD_DEFERRED_RELEASE, false,                                    \
+        "Destroy commands and memory objects in batches on a thread")         \
+release(uint, AMD_DEFERRED_RELEASE_INTERVAL, 1,                               \
+        "Interval in ms of the batched AMD_DEFERRED_RELEASE destruction")     \
+release(bool, AMD_TSC_CLOCK, true,                                            \
+        "Use the invariant TSC for the runtime timestamps, if the CPU has it")\
+release(uint, AMD_PARALLEL_COPY_THREADS, 0,                                   \
+        "The number of host threads for big CPU copies, 0 = single thread")   \
+release(size_t, AMD_PARALLEL_COPY_SIZE, 4096,                                 \
+        "The minimum size in KB of a CPU copy, split between the host threads") \
+release(cstring, AMD_TUNING_FILE, "",                                         \
+        "Config file with the tunable flag overrides, reloaded on the changes")\
+release(uint, AMD_TUNING_FILE_INTERVAL, 1000,                                 \
+        "Interval in ms of the AMD_TUNING_FILE change checks")
 
 namespace amd {
 
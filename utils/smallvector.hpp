@@ -0,0 +1,220 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#ifndef SMALLVECTOR_HPP_
+#define SMALLVECTOR_HPP_
+
+#include "top.hpp"
+#include "utils/debug.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+
+namespace amd {
+
+/*! \brief Vector with the inline storage for the first N elements.
+ *
+ *  The container allocates the heap memory only if it grows over N elements, so the short
+ *  lists are created and copied without malloc. The interface follows std::vector.
+ *  The elements must be trivially copyable, since the storage is moved with memcpy.
+ */
+template <typename T, uint N> class SmallVector {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SmallVector supports the trivially copyable types only");
+
+ public:
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef T* iterator;
+  typedef const T* const_iterator;
+
+  SmallVector() : data_(inline_), size_(0), capacity_(N) {}
+
+  explicit SmallVector(size_t count, const T& value = T()) : SmallVector() {
+    resize(count, value);
+  }
+
+  template <typename InputIt,
+            typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+  SmallVector(InputIt first, InputIt last) : SmallVector() {
+    insert(end(), first, last);
+  }
+
+  SmallVector(std::initializer_list<T> list) : SmallVector() {
+    insert(end(), list.begin(), list.end());
+  }
+
+  SmallVector(const SmallVector& other) : SmallVector() {
+    insert(end(), other.begin(), other.end());
+  }
+
+  SmallVector(SmallVector&& other) : SmallVector() { *this = std::move(other); }
+
+  ~SmallVector() {
+    if (data_ != inline_) {
+      free(data_);
+    }
+  }
+
+  SmallVector& operator=(const SmallVector& other) {
+    if (this != &other) {
+      clear();
+      insert(end(), other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  SmallVector& operator=(SmallVector&& other) {
+    if (this == &other) {
+      return *this;
+    }
+    if (other.data_ == other.inline_) {
+      clear();
+      insert(end(), other.begin(), other.end());
+    } else {
+      // Take the heap storage of the other container
+      if (data_ != inline_) {
+        free(data_);
+      }
+      data_ = other.data_;
+      size_ = other.size_;
+      capacity_ = other.capacity_;
+      other.data_ = other.inline_;
+      other.capacity_ = N;
+    }
+    other.size_ = 0;
+    return *this;
+  }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  const_iterator cbegin() const { return data_; }
+  const_iterator cend() const { return data_ + size_; }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+
+  T& operator[](size_t index) { return data_[index]; }
+  const T& operator[](size_t index) const { return data_[index]; }
+
+  T& front() { return data_[0]; }
+  const T& front() const { return data_[0]; }
+  T& back() { return data_[size_ - 1]; }
+  const T& back() const { return data_[size_ - 1]; }
+
+  void push_back(const T& value) {
+    if (size_ == capacity_) {
+      // The value can be an element of this container
+      const T copy = value;
+      grow(size_ + 1);
+      data_[size_++] = copy;
+    } else {
+      data_[size_++] = value;
+    }
+  }
+
+  void pop_back() { --size_; }
+
+  void clear() { size_ = 0; }
+
+  void reserve(size_t capacity) {
+    if (capacity > capacity_) {
+      grow(capacity);
+    }
+  }
+
+  void resize(size_t size, const T& value = T()) {
+    reserve(size);
+    for (size_t i = size_; i < size; ++i) {
+      data_[i] = value;
+    }
+    size_ = size;
+  }
+
+  iterator insert(const_iterator pos, const T& value) { return insert(pos, &value, &value + 1); }
+
+  template <typename InputIt,
+            typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    const size_t offset = pos - data_;
+    const size_t count = std::distance(first, last);
+    if (count == 0) {
+      return data_ + offset;
+    }
+    if ((size_ + count) > capacity_) {
+      // The range can't be in this container, since std::vector doesn't allow it either
+      grow(size_ + count);
+    }
+    memmove(data_ + offset + count, data_ + offset, (size_ - offset) * sizeof(T));
+    T* dst = data_ + offset;
+    for (; first != last; ++first) {
+      *dst++ = *first;
+    }
+    size_ += count;
+    return data_ + offset;
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    const size_t offset = first - data_;
+    const size_t count = last - first;
+    memmove(data_ + offset, data_ + offset + count, (size_ - offset - count) * sizeof(T));
+    size_ -= count;
+    return data_ + offset;
+  }
+
+ private:
+  //! Moves the elements into the heap storage with at least the requested capacity
+  void grow(size_t capacity) {
+    size_t newCapacity = capacity_ * 2;
+    if (newCapacity < capacity) {
+      newCapacity = capacity;
+    }
+    T* storage = reinterpret_cast<T*>(malloc(newCapacity * sizeof(T)));
+    guarantee(storage != nullptr, "out of memory");
+    memcpy(storage, data_, size_ * sizeof(T));
+    if (data_ != inline_) {
+      free(data_);
+    }
+    data_ = storage;
+    capacity_ = newCapacity;
+  }
+
+  T* data_;            //!< The elements, inline_ or the heap storage
+  uint32_t size_;      //!< The number of the elements
+  uint32_t capacity_;  //!< The capacity of the current storage
+  T inline_[N];        //!< The inline storage for the first N elements
+};
+
+}  // namespace amd
+
+#endif /*SMALLVECTOR_HPP_*/
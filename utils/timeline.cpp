@@ -0,0 +1,205 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "utils/timeline.hpp"
+#include "os/os.hpp"
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace amd {
+
+bool Timeline::enabled_ = false;
+
+namespace {
+
+//! The names of the categories in the trace
+const char* const categoryNames[Timeline::kNumCategories] = {
+    "enqueue", "submit", "doorbell", "complete", "gpu", "wait", "lock", "staging", "compile", "init"};
+
+//! The events buffer of a thread. The chunks are allocated on demand and never freed,
+//! since the events of the finished threads must survive until the flush
+struct ThreadBuffer {
+  uint32_t index_;                   //!< The thread track in the trace
+  std::atomic<size_t> count_;        //!< The number of the published events
+  std::atomic<uint64_t> dropped_;    //!< The events over the buffer limit
+  Timeline::Event* chunks_[Timeline::kMaxChunks];
+};
+
+std::mutex timelineLock;                 //!< Lock for the buffers, the names and the file
+std::vector<ThreadBuffer*> buffers;      //!< All thread buffers
+std::unordered_set<std::string> names;   //!< The interned names
+std::string timelinePath;                //!< The timeline file
+thread_local ThreadBuffer* threadBuffer = nullptr;
+
+//! Writes the timeline on the process exit, since the runtime doesn't tear down
+struct TimelineFlusher {
+  ~TimelineFlusher() { Timeline::flush(); }
+} timelineFlusher;
+
+//! Writes the string with the JSON escapes
+void writeString(FILE* file, const char* str) {
+  fputc('"', file);
+  for (const char* c = str; *c != '\0'; ++c) {
+    if ((*c == '"') || (*c == '\\')) {
+      fputc('\\', file);
+      fputc(*c, file);
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      fprintf(file, "\\u%04x", *c);
+    } else {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+}  // namespace
+
+// ================================================================================================
+uint64_t TimelineScope::now() {
+  return Os::timeNanos();
+}
+
+// ================================================================================================
+bool Timeline::init(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Can't open the timeline file: %s\n", path);
+    return false;
+  }
+  fclose(file);
+  std::lock_guard<std::mutex> lock(timelineLock);
+  timelinePath = path;
+  enabled_ = true;
+  return true;
+}
+
+// ================================================================================================
+const char* Timeline::intern(const std::string& name) {
+  std::lock_guard<std::mutex> lock(timelineLock);
+  // The elements of unordered_set don't move on the rehash
+  return names.insert(name).first->c_str();
+}
+
+// ================================================================================================
+void Timeline::instant(Category category, const char* name, uint64_t arg) {
+  const uint64_t now = Os::timeNanos();
+  add(category, name, now, now, 0, arg);
+}
+
+// ================================================================================================
+void Timeline::add(Category category, const char* name, uint64_t start, uint64_t end,
+                   uint64_t track, uint64_t arg) {
+  ThreadBuffer* buffer = threadBuffer;
+  if (buffer == nullptr) {
+    buffer = new ThreadBuffer();
+    std::lock_guard<std::mutex> lock(timelineLock);
+    buffer->index_ = static_cast<uint32_t>(buffers.size());
+    buffers.push_back(buffer);
+    threadBuffer = buffer;
+  }
+  // Only the owner thread appends, so the count can't change under the write
+  const size_t index = buffer->count_.load(std::memory_order_relaxed);
+  const size_t chunk = index / kChunkSize;
+  if (chunk >= kMaxChunks) {
+    // Keep the beginning of the run, the memory of a thread is limited to kMaxChunks
+    buffer->dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (buffer->chunks_[chunk] == nullptr) {
+    buffer->chunks_[chunk] = new Event[kChunkSize];
+  }
+  Event& event = buffer->chunks_[chunk][index % kChunkSize];
+  event.name_ = name;
+  event.start_ = start;
+  event.end_ = end;
+  event.track_ = track;
+  event.arg_ = arg;
+  event.category_ = category;
+  buffer->count_.store(index + 1, std::memory_order_release);
+}
+
+// ================================================================================================
+void Timeline::flush() {
+  std::lock_guard<std::mutex> lock(timelineLock);
+  if (!enabled_) {
+    return;
+  }
+  FILE* file = fopen(timelinePath.c_str(), "w");
+  if (file == nullptr) {
+    return;
+  }
+
+  // The CPU threads are in the process 1, the device queues are in the process 2
+  constexpr uint32_t kCpuPid = 1;
+  constexpr uint32_t kGpuPid = 2;
+  std::map<uint64_t, uint32_t> queues;
+
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  fprintf(file, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+          "\"args\":{\"name\":\"ROCclr CPU\"}}", kCpuPid);
+  fprintf(file, ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+          "\"args\":{\"name\":\"ROCclr GPU\"}}", kGpuPid);
+
+  uint64_t dropped = 0;
+  for (const auto buffer : buffers) {
+    // @note: The threads can still add events, the dump has the published ones only
+    const size_t count = buffer->count_.load(std::memory_order_acquire);
+    dropped += buffer->dropped_.load(std::memory_order_relaxed);
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,"
+            "\"args\":{\"name\":\"Thread %u\"}}", kCpuPid, buffer->index_,
+            buffer->index_);
+    for (size_t i = 0; i < count; ++i) {
+      const Event& event = buffer->chunks_[i / kChunkSize][i % kChunkSize];
+      uint32_t pid = kCpuPid;
+      uint32_t tid = buffer->index_;
+      if (event.track_ != 0) {
+        auto it = queues.emplace(event.track_, static_cast<uint32_t>(queues.size())).first;
+        pid = kGpuPid;
+        tid = it->second;
+      }
+      fprintf(file, ",\n{\"name\":");
+      writeString(file, event.name_);
+      fprintf(file, ",\"cat\":\"%s\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f",
+              categoryNames[event.category_], pid, tid, event.start_ / 1e3);
+      if (event.end_ != event.start_) {
+        fprintf(file, ",\"ph\":\"X\",\"dur\":%.3f", (event.end_ - event.start_) / 1e3);
+      } else {
+        fprintf(file, ",\"ph\":\"i\",\"s\":\"t\"");
+      }
+      fprintf(file, ",\"args\":{\"arg\":\"0x%llx\"}}",
+              static_cast<unsigned long long>(event.arg_));
+    }
+  }
+
+  for (const auto& it : queues) {
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,"
+            "\"args\":{\"name\":\"Queue 0x%llx\"}}", kGpuPid, it.second,
+            static_cast<unsigned long long>(it.first));
+  }
+  fprintf(file, "\n],\"otherData\":{\"dropped\":%llu}}\n",
+          static_cast<unsigned long long>(dropped));
+  fclose(file);
+}
+
+}  // namespace amd
@@ -0,0 +1,131 @@
+/* Copyright (c) 2021 - 2021 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#ifndef TIMELINE_HPP_
+#define TIMELINE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//! \addtogroup Utils
+//  @{
+
+namespace amd { /*@{*/
+
+//! Built-in timeline of the runtime internals.
+//! Each thread appends the events into its own buffer without any locks. The buffers are
+//! written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) on the process exit.
+//! The CPU events are on the tracks of the threads, the GPU times of the commands
+//! are on the tracks of the device queues.
+class Timeline {
+ public:
+  static constexpr size_t kChunkSize = 4096;  //!< The number of events per buffer chunk
+  static constexpr size_t kMaxChunks = 256;   //!< The maximum chunks per thread
+
+  //! The event categories
+  enum Category : uint8_t {
+    kEnqueue = 0,   //!< The command enqueue by the application thread
+    kSubmit = 1,    //!< The command submission to the device queue
+    kDoorbell = 2,  //!< The doorbell ring of the hardware queue
+    kComplete = 3,  //!< The command completion on CPU
+    kGpu = 4,       //!< The GPU execution of the command
+    kWait = 5,      //!< The CPU wait for the device
+    kLock = 6,      //!< The wait for a contended lock
+    kStaging = 7,   //!< The staged copy through the host buffers
+    kCompile = 8,   //!< The program compile phases
+    kInit = 9,      //!< The runtime initialization phases
+    kNumCategories
+  };
+
+  //! An event in the thread buffer
+  struct Event {
+    const char* name_;   //!< The static or the interned event name
+    uint64_t start_;     //!< Os::timeNanos() of the start
+    uint64_t end_;       //!< Os::timeNanos() of the end, the same as the start for the instants
+    uint64_t track_;     //!< The queue of the GPU events or 0 for the thread track
+    uint64_t arg_;       //!< The event argument (the command, the queue or the size)
+    uint32_t category_;  //!< Category
+  };
+
+  //! Returns TRUE if the timeline is collected
+  static bool enabled() { return enabled_; }
+
+  //! Enables the timeline, which is written into the file on exit
+  static bool init(const char* path);
+
+  //! Writes all events into the timeline file
+  static void flush();
+
+  //! Adds an event with the duration on the track of the current thread
+  static void complete(Category category, const char* name, uint64_t start, uint64_t end,
+                       uint64_t arg = 0) {
+    add(category, name, start, end, 0, arg);
+  }
+
+  //! Adds an instant event on the track of the current thread
+  static void instant(Category category, const char* name, uint64_t arg = 0);
+
+  //! Adds the GPU execution of a command on the track of the queue
+  static void gpu(const char* name, const void* queue, uint64_t start, uint64_t end,
+                  uint64_t arg = 0) {
+    add(kGpu, name, start, end, reinterpret_cast<uint64_t>(queue), arg);
+  }
+
+  //! Returns a copy of the dynamic name, which lives until the process exit
+  static const char* intern(const std::string& name);
+
+ private:
+  static void add(Category category, const char* name, uint64_t start, uint64_t end,
+                  uint64_t track, uint64_t arg);
+
+  static bool enabled_;  //!< The timeline is enabled
+};
+
+//! Adds an event for the scope, if the timeline is enabled
+class TimelineScope {
+ public:
+  TimelineScope(Timeline::Category category, const char* name, uint64_t arg = 0)
+      : name_(name), arg_(arg), start_(0), category_(category) {
+    if (Timeline::enabled()) {
+      start_ = now();
+    }
+  }
+  ~TimelineScope() {
+    if (start_ != 0) {
+      Timeline::complete(category_, name_, start_, now(), arg_);
+    }
+  }
+
+  //! Changes the argument of the event, i.e. when the size is known at the end of the scope
+  void setArg(uint64_t arg) { arg_ = arg; }
+
+ private:
+  static uint64_t now();
+
+  const char* name_;
+  uint64_t arg_;
+  uint64_t start_;
+  Timeline::Category category_;
+};
+
+/*@}*/} // namespace amd
+
+#endif /*TIMELINE_HPP_*/